@@ -106,7 +106,6 @@ BlurManipulator::PreviewBitmap(bool full_quality, BRegion* updated_region)
 	if ((settings == previous_settings) == FALSE) {
 		// The blur will be done separably. First in the vertical direction and then in horizontal
 		// direction.
-		thread_count = GetSystemCpuCount();
 		tall_bits = (uint32*)tall_copy_of_the_preview_bitmap->Bits();
 		wide_bits = (uint32*)wide_copy_of_the_preview_bitmap->Bits();
 		final_bits = (uint32*)preview_bitmap->Bits();
@@ -128,61 +127,32 @@ BlurManipulator::PreviewBitmap(bool full_quality, BRegion* updated_region)
 void
 BlurManipulator::CalculateBlur()
 {
-	thread_id* threads = new thread_id[thread_count];
+	if (ParallelFor(0, final_width + 1, vertical_blur_entry, this, status_bar, 50.0) != B_OK)
+		return;
 
-	for (int32 i = 0; i < thread_count; i++) {
-		threads[i] = spawn_thread(thread_entry, "vertical_blur_thread", B_NORMAL_PRIORITY, this);
-		resume_thread(threads[i]);
-		send_data(threads[i], VERTICAL_THREAD, NULL, 0);
-		send_data(threads[i], i, NULL, 0);
-	}
-	for (int32 i = 0; i < thread_count; i++) {
-		int32 return_value;
-		wait_for_thread(threads[i], &return_value);
-	}
+	ParallelFor(0, final_height + 1, horizontal_blur_entry, this, status_bar, 50.0);
+}
 
-	for (int32 i = 0; i < thread_count; i++) {
-		threads[i] = spawn_thread(thread_entry, "horizontal_blur_thread", B_NORMAL_PRIORITY, this);
-		resume_thread(threads[i]);
-		send_data(threads[i], HORIZONTAL_THREAD, NULL, 0);
-		send_data(threads[i], i, NULL, 0);
-	}
-	for (int32 i = 0; i < thread_count; i++) {
-		int32 return_value;
-		wait_for_thread(threads[i], &return_value);
-	}
 
-	delete[] threads;
+void
+BlurManipulator::vertical_blur_entry(void* data, int32 first, int32 last)
+{
+	((BlurManipulator*)data)->VerticalBlur(first, last - 1);
 }
 
 
-int32
-BlurManipulator::thread_entry(void* data)
+void
+BlurManipulator::horizontal_blur_entry(void* data, int32 first, int32 last)
 {
-	BlurManipulator* this_pointer = (BlurManipulator*)data;
-	thread_id sender;
-	int32 type = receive_data(&sender, NULL, 0);
-	int32 thread_number = receive_data(&sender, NULL, 0);
-	if (this_pointer != NULL) {
-		if (type == VERTICAL_THREAD)
-			this_pointer->VerticalBlur(thread_number);
-		else
-			this_pointer->HorizontalBlur(thread_number);
-
-		return B_OK;
-	}
-	return B_ERROR;
+	((BlurManipulator*)data)->HorizontalBlur(first, last - 1);
 }
 
 
 int32
-BlurManipulator::VerticalBlur(int32 thread_number)
+BlurManipulator::VerticalBlur(int32 left, int32 right)
 {
 	// vertical blur will be done columnwise so that we can use the
 	// partial sums.
-	int32 left = (final_width) / thread_count * thread_number;
-	int32 right = min_c(left + (final_width + 1) / thread_count, final_width);
-	float status_bar_update_amount = 50.0 / thread_count / (right - left) * 40;
 	int32 height = final_height;
 	uint32* source_bits = tall_bits;
 	int32 source_bpr = tall_bpr;
@@ -199,10 +169,6 @@ BlurManipulator::VerticalBlur(int32 thread_number)
 	float blue;
 	float alpha;
 	float divider = 1.0 / (2 * blur_amount + 1);
-	BWindow* status_bar_window = NULL;
-	if (status_bar != NULL)
-		status_bar_window = status_bar->Window();
-
 	for (int32 x = left; x <= right; x++) {
 		// Calculate the first pixel for this column.
 		red = green = blue = alpha = 0;
@@ -250,22 +216,14 @@ BlurManipulator::VerticalBlur(int32 thread_number)
 			negative_source_y_offset += source_bpr;
 			target_y_offset += target_bpr;
 		}
-		if (((x % 40) == 0) && (status_bar_window != NULL)
-			&& (status_bar_window->LockWithTimeout(0) == B_OK)) {
-			status_bar->Update(status_bar_update_amount);
-			status_bar_window->Unlock();
-		}
 	}
 	return B_OK;
 }
 
 
 int32
-BlurManipulator::HorizontalBlur(int32 thread_number)
+BlurManipulator::HorizontalBlur(int32 top, int32 bottom)
 {
-	int32 top = (final_height) / thread_count * thread_number;
-	int32 bottom = min_c(top + (final_height + 1) / thread_count, final_height);
-	float status_bar_update_amount = 50.0 / thread_count / (bottom - top) * 40.0;
 	int32 width = final_width;
 	uint32* source_bits = wide_bits;
 	int32 source_bpr = wide_bpr;
@@ -283,10 +241,6 @@ BlurManipulator::HorizontalBlur(int32 thread_number)
 	// In this loop we can use the sums that we already have calculated to remove the innermost
 	// loop.
 
-	BWindow* status_bar_window = NULL;
-	if (status_bar != NULL)
-		status_bar_window = status_bar->Window();
-
 	source_bits += top * source_bpr;
 	target_bits += top * target_bpr;
 
@@ -340,11 +294,6 @@ BlurManipulator::HorizontalBlur(int32 thread_number)
 				++source_bits;
 			}
 			source_bits += MAX_BLUR_AMOUNT;
-			if (((y % 40) == 0) && (status_bar_window != NULL)
-				&& (status_bar_window->LockWithTimeout(0) == B_OK)) {
-				status_bar->Update(status_bar_update_amount);
-				status_bar_window->Unlock();
-			}
 		}
 	} else if (selection->IsEmpty() == false) {
 		for (int32 y = top; y <= bottom; y++) {
@@ -406,11 +355,6 @@ BlurManipulator::HorizontalBlur(int32 thread_number)
 				}
 			}
 			source_bits += MAX_BLUR_AMOUNT;
-			if (((y % 40) == 0) && (status_bar_window != NULL)
-				&& (status_bar_window->LockWithTimeout(0) == B_OK)) {
-				status_bar->Update(status_bar_update_amount);
-				status_bar_window->Unlock();
-			}
 		}
 	}
 	return B_OK;
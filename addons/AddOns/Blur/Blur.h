@@ -18,11 +18,6 @@
 #define	BLUR_TRANSPARENCY_CHANGED	'Btpc'
 #define	MAX_BLUR_AMOUNT		30
 
-enum {
-	VERTICAL_THREAD,
-	HORIZONTAL_THREAD
-};
-
 class BlurManipulatorSettings : public ManipulatorSettings {
 public:
 	BlurManipulatorSettings()
@@ -62,7 +57,6 @@ class BlurManipulator : public WindowGUIManipulator {
 
 // These variables will be used by the threads that calculate the Blur
 // The threads take a local copy of these when they start.
-	int32		thread_count;
 	uint32*		tall_bits;
 	uint32*		wide_bits;
 	uint32*		final_bits;
@@ -77,14 +71,15 @@ class BlurManipulator : public WindowGUIManipulator {
 	Selection	*selection;
 	BStatusBar	*status_bar;
 
-// These functions calculate the blur. The function CalculateBlur is
-// used to start a few threads for the calclation. It will return after the
-// threads have finished their jobs. Before calling it the above variables
-// should have been initialized.
+// These functions calculate the blur. The function CalculateBlur
+// divides the columns and then the rows between the worker threads. It will
+// return after the threads have finished their jobs. Before calling it the
+// above variables should have been initialized.
 		void	CalculateBlur();
-static	int32	thread_entry(void*);
-		int32	VerticalBlur(int32 thread_number);
-		int32	HorizontalBlur(int32 thread_number);
+static	void	vertical_blur_entry(void*, int32, int32);
+static	void	horizontal_blur_entry(void*, int32, int32);
+		int32	VerticalBlur(int32 left, int32 right);
+		int32	HorizontalBlur(int32 top, int32 bottom);
 
 BlurManipulatorSettings	settings;
 BlurManipulatorSettings	previous_settings;
@@ -18,6 +18,7 @@
 #include "AddOns.h"
 #include "Brightness.h"
 #include "ManipulatorInformer.h"
+#include "PointOperation.h"
 #include "Selection.h"
 
 #undef B_TRANSLATION_CONTEXT
@@ -44,6 +45,35 @@ instantiate_add_on(BBitmap* bm, ManipulatorInformer* i)
 }
 
 
+static PointOperation*
+brightness_operation(const BrightnessManipulatorSettings& settings)
+{
+	// This interpolates the image with a degenerate version, which in this
+	// case is black. The black image is not actually used, but the idea
+	// a*X + (1-a)*0 = a*X is used instead. The alpha-channel is not touched.
+	float coeff = settings.brightness / 100.0;
+	uint8 table[256];
+	for (int32 i = 0; i < 256; i++)
+		table[i] = min_c(255, i * coeff);
+
+	ChannelMapOperation* operation = new ChannelMapOperation();
+	operation->SetTables(table);
+	return operation;
+}
+
+
+PointOperation*
+instantiate_point_operation(ManipulatorSettings* settings)
+{
+	BrightnessManipulatorSettings* brightness_settings
+		= dynamic_cast<BrightnessManipulatorSettings*>(settings);
+	if (brightness_settings == NULL)
+		return NULL;
+
+	return brightness_operation(*brightness_settings);
+}
+
+
 BrightnessManipulator::BrightnessManipulator(BBitmap* bm)
 	:
 	WindowGUIManipulator(),
@@ -136,153 +166,10 @@ BrightnessManipulator::PreviewBitmap(bool full_quality, BRegion* updated_region)
 void
 BrightnessManipulator::start_threads()
 {
-	number_of_threads = GetSystemCpuCount();
-
-	thread_id* threads = new thread_id[number_of_threads];
-
-	for (int32 i = 0; i < number_of_threads; i++) {
-		threads[i] = spawn_thread(thread_entry, "brightness_thread", B_NORMAL_PRIORITY, this);
-		resume_thread(threads[i]);
-		send_data(threads[i], i, NULL, 0);
-	}
-
-	for (int32 i = 0; i < number_of_threads; i++) {
-		int32 return_value;
-		wait_for_thread(threads[i], &return_value);
-	}
-
-	delete[] threads;
-}
-
-
-int32
-BrightnessManipulator::thread_entry(void* data)
-{
-	int32 thread_number;
-	thread_number = receive_data(NULL, NULL, 0);
-
-	BrightnessManipulator* this_pointer = (BrightnessManipulator*)data;
-
-	return this_pointer->thread_function(thread_number);
-}
-
-
-int32
-BrightnessManipulator::thread_function(int32 thread_number)
-{
-	// This function interpolates the image with a degenerate version,
-	// which in this case is black. The black image is not actually
-	// used, but the idea a*X + (1-a)*0 = a*X is used instead. This function
-	// does not touch the alpha-channel.
-
-	int32 step = current_resolution;
-	uint32 brightness = settings.brightness;
-
-	BWindow* progress_bar_window = NULL;
-	if (progress_bar != NULL)
-		progress_bar_window = progress_bar->Window();
-
-	uint32* source_bits = (uint32*)source_bitmap->Bits();
-	uint32* target_bits = (uint32*)target_bitmap->Bits();
-	int32 source_bpr = source_bitmap->BytesPerRow() / 4;
-	int32 target_bpr = target_bitmap->BytesPerRow() / 4;
-
-	// This union must be used to guarantee endianness compatibility.
-	union {
-		uint8 bytes[4];
-		uint32 word;
-	} color;
-
-	float coeff = current_settings.brightness / 100.0;
-
-	if (selection->IsEmpty()) {
-		// Here handle the whole image.
-		int32 left = target_bitmap->Bounds().left;
-		int32 right = target_bitmap->Bounds().right;
-		int32 top = target_bitmap->Bounds().top;
-		int32 bottom = target_bitmap->Bounds().bottom;
-
-		float height = bottom - top;
-		top = height / number_of_threads * thread_number;
-		top = ceil(top / (float)step);
-		top *= step;
-		bottom = min_c(bottom, top + (height + 1) / number_of_threads);
-		int32 update_interval = 10;
-		float update_amount = 100.0 / (bottom - top) * update_interval / (float)number_of_threads;
-		float missed_update = 0;
-
-		// Loop through all pixels in original.
-		brightness *= 3;
-		uint8 brighness_array[256];
-		for (int32 i = 0; i < 256; i++)
-			brighness_array[i] = min_c(255, i * coeff);
-
-		for (int32 y = top; y <= bottom; y += step) {
-			int32 y_times_source_bpr = y * source_bpr;
-			int32 y_times_target_bpr = y * target_bpr;
-			for (int32 x = left; x <= right; x += step) {
-				color.word = *(source_bits + x + y_times_source_bpr);
-				color.bytes[0] = brighness_array[color.bytes[0]];
-				color.bytes[1] = brighness_array[color.bytes[1]];
-				color.bytes[2] = brighness_array[color.bytes[2]];
-				*(target_bits + x + y_times_target_bpr) = color.word;
-			}
-
-			// Update the status-bar
-			if (((y % update_interval) == 0) && (progress_bar_window != NULL)
-				&& (progress_bar_window->LockWithTimeout(0) == B_OK)) {
-				progress_bar->Update(update_amount + missed_update);
-				progress_bar_window->Unlock();
-				missed_update = 0;
-			} else if ((y % update_interval) == 0)
-				missed_update += update_amount;
-		}
-	} else {
-		// Here handle only those pixels for which selection->ContainsPoint(x,y) is true.
-		BRect rect = selection->GetBoundingRect();
-
-		int32 left = rect.left;
-		int32 right = rect.right;
-		int32 top = rect.top;
-		int32 bottom = rect.bottom;
-
-		float height = bottom - top;
-		top += height / number_of_threads * thread_number;
-		top *= step;
-		top /= step;
-
-		bottom = min_c(bottom, top + (height + 1) / number_of_threads);
-
-		int32 update_interval = 10;
-		float update_amount = 100.0 / (bottom - top) * update_interval / (float)number_of_threads;
-		uint8 brighness_array[256];
-		for (int32 i = 0; i < 256; i++)
-			brighness_array[i] = min_c(255, i * coeff);
-
-		// Loop through all pixels in original.
-		for (int32 y = top; y <= bottom; y += step) {
-			int32 y_times_source_bpr = y * source_bpr;
-			int32 y_times_target_bpr = y * target_bpr;
-			for (int32 x = left; x <= right; x += step) {
-				if (selection->ContainsPoint(x, y)) {
-					color.word = *(source_bits + x + y_times_source_bpr);
-					color.bytes[0] = brighness_array[color.bytes[0]];
-					color.bytes[1] = brighness_array[color.bytes[1]];
-					color.bytes[2] = brighness_array[color.bytes[2]];
-					*(target_bits + x + y_times_target_bpr) = color.word;
-				}
-			}
-
-			// Update the status-bar
-			if (((y % update_interval) == 0) && (progress_bar_window != NULL)
-				&& (progress_bar_window->LockWithTimeout(0) == B_OK)) {
-				progress_bar->Update(update_amount);
-				progress_bar_window->Unlock();
-			}
-		}
-	}
-
-	return B_OK;
+	PointOperationPipeline pipeline;
+	pipeline.AddOperation(brightness_operation(current_settings));
+	pipeline.Apply(source_bitmap, target_bitmap, selection, current_resolution,
+		progress_bar);
 }
 
 
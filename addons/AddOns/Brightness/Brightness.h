@@ -61,8 +61,7 @@ class BrightnessManipulator : public WindowGUIManipulator {
 			BrightnessManipulatorView*		config_view;
 
 
-			// The next attributes will be used by the thread_function.
-			int32	number_of_threads;
+			// The next attributes will be used by start_threads().
 			int32	current_resolution;
 
 			BrightnessManipulatorSettings	current_settings;
@@ -75,8 +74,6 @@ class BrightnessManipulator : public WindowGUIManipulator {
 
 			void	start_threads();
 
-	static	int32	thread_entry(void*);
-			int32	thread_function(int32);
 
 public:
 				BrightnessManipulator(BBitmap*);
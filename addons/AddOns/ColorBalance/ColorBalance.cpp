@@ -9,6 +9,7 @@
 #include "ColorBalance.h"
 #include "AddOns.h"
 #include "ManipulatorInformer.h"
+#include "PointOperation.h"
 #include "Selection.h"
 
 #include <Bitmap.h>
@@ -40,6 +41,36 @@ instantiate_add_on(BBitmap* bm, ManipulatorInformer* i)
 }
 
 
+static PointOperation*
+color_balance_operation(const ColorBalanceManipulatorSettings& settings)
+{
+	ChannelMapOperation* operation = new ChannelMapOperation();
+	uint8* blue_array = operation->Table(0);
+	uint8* green_array = operation->Table(1);
+	uint8* red_array = operation->Table(2);
+
+	for (int32 i = 0; i < 256; i++) {
+		blue_array[i] = max_c(min_c(255, i + settings.blue_difference), 0);
+		green_array[i] = max_c(min_c(255, i + settings.green_difference), 0);
+		red_array[i] = max_c(min_c(255, i + settings.red_difference), 0);
+	}
+
+	return operation;
+}
+
+
+PointOperation*
+instantiate_point_operation(ManipulatorSettings* settings)
+{
+	ColorBalanceManipulatorSettings* color_balance_settings
+		= dynamic_cast<ColorBalanceManipulatorSettings*>(settings);
+	if (color_balance_settings == NULL)
+		return NULL;
+
+	return color_balance_operation(*color_balance_settings);
+}
+
+
 ColorBalanceManipulator::ColorBalanceManipulator(BBitmap* bm)
 	:
 	WindowGUIManipulator(),
@@ -97,49 +128,10 @@ ColorBalanceManipulator::ManipulateBitmap(
 		source_bitmap = new_bitmap;
 	}
 
-	uint32* source_bits = (uint32*)source_bitmap->Bits();
-	uint32* target_bits = (uint32*)target_bitmap->Bits();
-
-	int32 left = target_bitmap->Bounds().left;
-	int32 right = target_bitmap->Bounds().right;
-	int32 top = target_bitmap->Bounds().top;
-	int32 bottom = target_bitmap->Bounds().bottom;
-
-	union {
-		uint8 bytes[4];
-		uint32 word;
-	} color;
-
-	if (selection->IsEmpty() == TRUE) {
-		for (int32 y = top; y <= bottom; y++) {
-			for (int32 x = left; x <= right; x++) {
-				color.word = *source_bits++;
-				color.bytes[0]
-					= max_c(min_c(255, color.bytes[0] + new_settings->blue_difference), 0);
-				color.bytes[1]
-					= max_c(min_c(255, color.bytes[1] + new_settings->green_difference), 0);
-				color.bytes[2]
-					= max_c(min_c(255, color.bytes[2] + new_settings->red_difference), 0);
-				*target_bits++ = color.word;
-			}
-		}
-	} else {
-		for (int32 y = top; y <= bottom; y++) {
-			for (int32 x = left; x <= right; x++) {
-				if (selection->ContainsPoint(x, y)) {
-					color.word = *source_bits++;
-					color.bytes[0]
-						= max_c(min_c(255, color.bytes[0] + new_settings->blue_difference), 0);
-					color.bytes[1]
-						= max_c(min_c(255, color.bytes[1] + new_settings->green_difference), 0);
-					color.bytes[2]
-						= max_c(min_c(255, color.bytes[2] + new_settings->red_difference), 0);
-					*target_bits++ = color.word;
-				} else
-					*target_bits++ = *source_bits++;
-			}
-		}
-	}
+	PointOperationPipeline pipeline;
+	pipeline.AddOperation(color_balance_operation(*new_settings));
+	pipeline.Apply(source_bitmap, target_bitmap, selection, 1, NULL);
+
 	if (new_bitmap != NULL)
 		delete new_bitmap;
 
@@ -159,56 +151,11 @@ ColorBalanceManipulator::PreviewBitmap(bool full_quality, BRegion* updated_regio
 	if (full_quality == TRUE)
 		last_used_quality = min_c(last_used_quality, 1);
 
-	uint32* source_bits = (uint32*)copy_of_the_preview_bitmap->Bits();
-	uint32* target_bits = (uint32*)preview_bitmap->Bits();
-	int32 source_bpr = copy_of_the_preview_bitmap->BytesPerRow() / 4;
-	int32 target_bpr = preview_bitmap->BytesPerRow() / 4;
-
-	int32 left = preview_bitmap->Bounds().left;
-	int32 right = preview_bitmap->Bounds().right;
-	int32 top = preview_bitmap->Bounds().top;
-	int32 bottom = preview_bitmap->Bounds().bottom;
-
-
 	if (last_used_quality > 0) {
-		union {
-			uint8 bytes[4];
-			uint32 word;
-		} color;
-		uint8 blue_array[256];
-		uint8 green_array[256];
-		uint8 red_array[256];
-
-		for (int32 i = 0; i < 256; i++) {
-			blue_array[i] = max_c(min_c(255, i + settings.blue_difference), 0);
-			green_array[i] = max_c(min_c(255, i + settings.green_difference), 0);
-			red_array[i] = max_c(min_c(255, i + settings.red_difference), 0);
-		}
-
-		if (selection->IsEmpty() == TRUE) {
-			for (int32 y = top; y <= bottom; y += last_used_quality) {
-				for (int32 x = left; x <= right; x += last_used_quality) {
-					color.word = *(source_bits + x + y * source_bpr);
-					color.bytes[0] = blue_array[color.bytes[0]];
-					color.bytes[1] = green_array[color.bytes[1]];
-					color.bytes[2] = red_array[color.bytes[2]];
-					*(target_bits + x + y * target_bpr) = color.word;
-				}
-			}
-		} else {
-			for (int32 y = top; y <= bottom; y += last_used_quality) {
-				for (int32 x = left; x <= right; x += last_used_quality) {
-					if (selection->ContainsPoint(x, y)) {
-						color.word = *(source_bits + x + y * source_bpr);
-						color.bytes[0] = blue_array[color.bytes[0]];
-						color.bytes[1] = green_array[color.bytes[1]];
-						color.bytes[2] = red_array[color.bytes[2]];
-						*(target_bits + x + y * target_bpr) = color.word;
-					} else
-						*(target_bits + x + y * target_bpr) = *(source_bits + x + y * source_bpr);
-				}
-			}
-		}
+		PointOperationPipeline pipeline;
+		pipeline.AddOperation(color_balance_operation(settings));
+		pipeline.Apply(copy_of_the_preview_bitmap, preview_bitmap, selection,
+			last_used_quality, NULL);
 	}
 
 	updated_region->Set(preview_bitmap->Bounds());
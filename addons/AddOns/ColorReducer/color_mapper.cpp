@@ -18,122 +18,222 @@
 */
 
 #include <Bitmap.h>
+#include <OS.h>
+#include <new>
 #include <stdio.h>
+#include <string.h>
 
 #include "BitmapAnalyzer.h"
 #include "ImageProcessingLibrary.h"
 #include "RandomNumberGenerator.h"
 #include "Selection.h"
+#include "WorkerPool.h"
 #include "color_mapper.h"
 
 
-BBitmap*
-nearest_color_mapper(BBitmap* inSource, const rgb_color* inPalette, int inPaletteSize)
+int32
+color_reducer_thread_count()
 {
-	int32* map_function = new int32[32768]; // using 15 bit colors to do the mapping
-	for (int i = 0; i < 32768; i++)
-		map_function[i] = -1; // the nearest color is not yet found
+	WorkerPool* pool = WorkerPool::Instance();
+	if (pool == NULL)
+		return 1;
 
-	BBitmap* outDestination = new BBitmap(inSource->Bounds(), B_CMAP8, false);
+	return pool->CountThreads();
+}
 
-	uint32* source_bits = (uint32*)inSource->Bits();
-	uint32 source_bpr = inSource->BytesPerRow() / 4;
 
-	uint8* destination_bits = (uint8*)outDestination->Bits();
-	uint32 destination_bpr = outDestination->BytesPerRow();
+struct thread_job {
+	void	(*function)(void*, int32, int32);
+	void*	data;
+	int32	thread_count;
+};
 
-	int32 width = inSource->Bounds().IntegerWidth();
-	int32 height = inSource->Bounds().IntegerHeight();
 
-	int32 source_padding = source_bpr - width - 1;
-	int32 destination_padding = destination_bpr - width - 1;
+static void
+thread_job_range(void* data, int32 first, int32 last)
+{
+	thread_job* job = (thread_job*)data;
+	for (int32 i = first; i < last; i++)
+		job->function(job->data, i, job->thread_count);
+}
 
-	// Use this union to guarantee endianness compatibility.
-	union {
-		uint8 bytes[4];
-		uint32 word;
-	} bgra32;
 
-	for (int32 y = 0; y <= height; y++) {
-		for (int32 x = 0; x <= width; x++) {
-			bgra32.word = *source_bits++;
-			// squeeze the 32-bit color to 15 bit index. See BeBook
-			// BScreen chapter for the reference on this.
-			uint16 rgb15 = ((bgra32.bytes[2] & 0xf8) << 7) | ((bgra32.bytes[1] & 0xf8) << 2)
-				| ((bgra32.bytes[0] & 0xf8) >> 3);
-			if (map_function[rgb15] < 0) {
-				// The mapping for the color has not yet been found.
-				map_function[rgb15] = find_palette_index(bgra32.word, inPalette, inPaletteSize);
+void
+run_in_threads(void (*function)(void*, int32, int32), void* data, int32 thread_count)
+{
+	thread_job job;
+	job.function = function;
+	job.data = data;
+	job.thread_count = thread_count;
+
+	WorkerPool* pool = WorkerPool::Instance();
+	if (pool != NULL)
+		pool->ParallelFor(0, thread_count, thread_job_range, &job);
+	else
+		thread_job_range(&job, 0, thread_count);
+}
+
+
+static int32
+thread_job_entry(void* data)
+{
+	int32 thread_number = receive_data(NULL, NULL, 0);
+	thread_job* job = (thread_job*)data;
+	job->function(job->data, thread_number, job->thread_count);
+	return B_OK;
+}
+
+
+void
+run_in_own_threads(void (*function)(void*, int32, int32), void* data, int32 thread_count)
+{
+	if (thread_count <= 1) {
+		function(data, 0, 1);
+		return;
+	}
+
+	thread_job job;
+	job.function = function;
+	job.data = data;
+	job.thread_count = thread_count;
+
+	thread_id* threads = new thread_id[thread_count];
+	for (int32 i = 0; i < thread_count; i++) {
+		threads[i] = spawn_thread(thread_job_entry, "color_reducer_thread",
+			B_NORMAL_PRIORITY, &job);
+		resume_thread(threads[i]);
+		send_data(threads[i], i, NULL, 0);
+	}
+
+	for (int32 i = 0; i < thread_count; i++) {
+		int32 return_value;
+		wait_for_thread(threads[i], &return_value);
+	}
+	delete[] threads;
+}
+
+
+struct inverse_map_job {
+	uint8*				map;
+	const rgb_color*	palette;
+	int					palette_size;
+};
+
+
+static void
+inverse_map_thread(void* data, int32 thread_number, int32 thread_count)
+{
+	inverse_map_job* job = (inverse_map_job*)data;
+
+	int32 first = 32768 * thread_number / thread_count;
+	int32 last = 32768 * (thread_number + 1) / thread_count;
+	for (int32 i = first; i < last; i++) {
+		// The middle of the cell.
+		int32 red = ((i >> 7) & 0xf8) | 0x04;
+		int32 green = ((i >> 2) & 0xf8) | 0x04;
+		int32 blue = ((i << 3) & 0xf8) | 0x04;
+
+		// The squared distance has the same minimum as the distance.
+		int32 min_distance = 1000000;
+		int32 selected_index = 0;
+		for (int32 j = 0; j < job->palette_size; j++) {
+			int32 dr = job->palette[j].red - red;
+			int32 dg = job->palette[j].green - green;
+			int32 db = job->palette[j].blue - blue;
+			int32 distance = dr * dr + dg * dg + db * db;
+			if (distance < min_distance) {
+				selected_index = j;
+				min_distance = distance;
 			}
-			*destination_bits++ = (uint8)map_function[rgb15];
 		}
-		destination_bits += destination_padding;
-		source_bits += source_padding;
+		job->map[i] = selected_index;
 	}
+}
 
-	delete[] map_function;
 
-	return outDestination;
+uint8*
+inverse_color_map(const rgb_color* inPalette, int inPaletteSize)
+{
+	inverse_map_job job;
+	job.map = new uint8[32768];
+	job.palette = inPalette;
+	job.palette_size = inPaletteSize;
+
+	run_in_threads(inverse_map_thread, &job, color_reducer_thread_count());
+
+	return job.map;
 }
 
 
-/*
-	This function maps the colors by using Floyd-Steinberg error diffusion dithering.
-	The main idea is to distribute the quantization error to the neighbouring
-	(unprocessed) pixels. The following weights are used in this version:
+struct mapper_job {
+	uint32*		source_bits;
+	int32		source_bpr;
+	uint8*		destination_bits;
+	int32		destination_bpr;
+	int32		width;
+	int32		height;
 
-				X		7/16
+	const uint8*		map;
+	const rgb_color*	palette;
 
-		3/16	5/16	1/16
+	// Used by the error diffusion only.
+	int32		ring_size;
+	int32**		errors;
+	vint64*		progress;
+};
 
-	Every other scanline is processed from left to right and every other from right to left.
-	This reduces the dithering artifacts and helps with the cache on big images. Currently
-	this is not the case and every scanline is processed from left to right.
 
-	Note that Floyd-Steinberg (or any other EDD) is almost impossible to parellelize properly.
-	This is because error propagates through image from pixel to pixel. Any attemp to divide the
-	image in blocks and dither them separately leads to unwanted visible lines between the
-	different parts.
-*/
-BBitmap*
-floyd_steinberg_edd_color_mapper(BBitmap* inSource, const rgb_color* inPalette, int inPaletteSize)
+static void
+nearest_color_thread(void* data, int32 thread_number, int32 thread_count)
 {
-	int32* map_function = new int32[32768]; // using 15 bit colors to do the mapping
-	for (int i = 0; i < 32768; i++)
-		map_function[i] = -1; // the nearest color is not yet found
+	mapper_job* job = (mapper_job*)data;
+
+	int32 first = job->height * thread_number / thread_count;
+	int32 last = job->height * (thread_number + 1) / thread_count;
+	for (int32 y = first; y < last; y++) {
+		uint32* source = job->source_bits + y * job->source_bpr;
+		uint8* destination = job->destination_bits + y * job->destination_bpr;
+		for (int32 x = 0; x < job->width; x++)
+			destination[x] = job->map[rgb15_index(source[x])];
+	}
+}
+
 
+BBitmap*
+nearest_color_mapper(BBitmap* inSource, const rgb_color* inPalette, int inPaletteSize)
+{
 	BBitmap* outDestination = new BBitmap(inSource->Bounds(), B_CMAP8, false);
 
-	uint32* source_bits = (uint32*)inSource->Bits();
-	uint32 source_bpr = inSource->BytesPerRow() / 4;
+	mapper_job job;
+	job.source_bits = (uint32*)inSource->Bits();
+	job.source_bpr = inSource->BytesPerRow() / 4;
+	job.destination_bits = (uint8*)outDestination->Bits();
+	job.destination_bpr = outDestination->BytesPerRow();
+	job.width = inSource->Bounds().IntegerWidth() + 1;
+	job.height = inSource->Bounds().IntegerHeight() + 1;
+	job.map = inverse_color_map(inPalette, inPaletteSize);
+	job.palette = inPalette;
 
-	uint8* destination_bits = (uint8*)outDestination->Bits();
-	uint32 destination_bpr = outDestination->BytesPerRow();
+	run_in_threads(nearest_color_thread, &job, color_reducer_thread_count());
 
-	int32 width = inSource->Bounds().IntegerWidth();
-	int32 height = inSource->Bounds().IntegerHeight();
+	delete[] job.map;
 
-	int32 source_padding = source_bpr - width - 1;
-	int32 destination_padding = destination_bpr - width - 1;
+	return outDestination;
+}
 
-	// We use three error arrays and three side error variables.
-	// The error arrays are a little bit wider than the image to
-	// avoid cheking for border conditions
-	int32* red_error = new int32[width + 1 + 2];
-	red_error = &red_error[1]; // Allow index of -1 too.
-	int16 red_side_error = 0;
 
-	int32* green_error = new int32[width + 1 + 2];
-	green_error = &green_error[1]; // Allow index of -1 too.
-	int16 green_side_error = 0;
+// The pixels of a row are processed in chunks of this size. The progress of
+// the rows is published after every chunk.
+const int32 kWavefrontChunk = 128;
 
-	int32* blue_error = new int32[width + 1 + 2];
-	blue_error = &blue_error[1]; // Allow index of -1 too.
-	int16 blue_side_error = 0;
 
-	// Initialize the errors to 0.
-	for (int32 i = -1; i <= width + 1; i++)
-		red_error[i] = green_error[i] = blue_error[i] = 0;
+static void
+floyd_steinberg_thread(void* data, int32 thread_number, int32 thread_count)
+{
+	mapper_job* job = (mapper_job*)data;
+
+	int32 width = job->width;
+	int32 error_length = width + 3;
 
 	// We use fixed point arithmetic to avoid type conversions.
 	int32 one_sixteenth = (1.0 / 16.0) * 32768;
@@ -147,54 +247,138 @@ floyd_steinberg_edd_color_mapper(BBitmap* inSource, const rgb_color* inPalette,
 		uint32 word;
 	} bgra32;
 
-	for (int32 y = 0; y <= height; y++) {
-		red_side_error = green_side_error = blue_side_error = 0;
-		// Go from left to right.
-		for (int32 x = 0; x <= width; x++) {
-			bgra32.word = *source_bits++;
-			// Add the error.
-			bgra32.bytes[0] = min_c(255, max_c(0, bgra32.bytes[0] - blue_side_error));
-			bgra32.bytes[1] = min_c(255, max_c(0, bgra32.bytes[1] - green_side_error));
-			bgra32.bytes[2] = min_c(255, max_c(0, bgra32.bytes[2] - red_side_error));
-
-			// squeeze the 32-bit color to 15 bit index. See BeBook
-			// BScreen chapter for the reference on this.
-			uint16 rgb15 = ((bgra32.bytes[2] & 0xf8) << 7) | ((bgra32.bytes[1] & 0xf8) << 2)
-				| ((bgra32.bytes[0] & 0xf8) >> 3);
-
-			if (map_function[rgb15] < 0) {
-				// The mapping for the color has not yet been found.
-				map_function[rgb15] = find_palette_index(bgra32.word, inPalette, inPaletteSize);
+	for (int32 y = thread_number; y < job->height; y += thread_count) {
+		// The errors that the previous row left for this row and the ones
+		// that this row leaves for the next. Both allow the index of -1.
+		int32* errors_in = job->errors[(y + job->ring_size - 1) % job->ring_size] + 1;
+		int32* errors_out = job->errors[y % job->ring_size] + 1;
+		int32* red_error = errors_in;
+		int32* green_error = errors_in + error_length;
+		int32* blue_error = errors_in + 2 * error_length;
+		int32* red_error_out = errors_out;
+		int32* green_error_out = errors_out + error_length;
+		int32* blue_error_out = errors_out + 2 * error_length;
+		memset(errors_out - 1, 0, 3 * error_length * sizeof(int32));
+
+		int16 red_side_error = 0;
+		int16 green_side_error = 0;
+		int16 blue_side_error = 0;
+
+		uint32* source_bits = job->source_bits + y * job->source_bpr;
+		uint8* destination_bits = job->destination_bits + y * job->destination_bpr;
+		vint64* previous_progress = &job->progress[(y + thread_count - 1) % thread_count];
+		vint64* progress = &job->progress[thread_number];
+
+		for (int32 chunk = 0; chunk < width; chunk += kWavefrontChunk) {
+			int32 chunk_end = min_c(chunk + kWavefrontChunk, width);
+
+			// The pixel x uses the errors of the pixels up to x + 2 on the
+			// previous row.
+			if (y > 0) {
+				int64 needed = (int64)(y - 1) * width + min_c(chunk_end + 2, width);
+				int32 spins = 0;
+				while (atomic_get64(previous_progress) < needed) {
+					if (++spins > 1000)
+						snooze(10);
+				}
 			}
 
-			uint8 color_index = *destination_bits++ = (uint8)map_function[rgb15];
+			for (int32 x = chunk; x < chunk_end; x++) {
+				bgra32.word = source_bits[x];
+				// Add the error.
+				bgra32.bytes[0] = min_c(255, max_c(0, bgra32.bytes[0] - blue_side_error));
+				bgra32.bytes[1] = min_c(255, max_c(0, bgra32.bytes[1] - green_side_error));
+				bgra32.bytes[2] = min_c(255, max_c(0, bgra32.bytes[2] - red_side_error));
+
+				uint8 color_index = destination_bits[x] = job->map[rgb15_index(bgra32.word)];
 
-			int32 red_total_error = inPalette[color_index].red - bgra32.bytes[2];
-			int32 green_total_error = inPalette[color_index].green - bgra32.bytes[1];
-			int32 blue_total_error = inPalette[color_index].blue - bgra32.bytes[0];
+				int32 red_total_error = job->palette[color_index].red - bgra32.bytes[2];
+				int32 green_total_error = job->palette[color_index].green - bgra32.bytes[1];
+				int32 blue_total_error = job->palette[color_index].blue - bgra32.bytes[0];
 
-			red_side_error = (red_error[x + 1] + (red_total_error * seven_sixteenth)) >> 15;
-			blue_side_error = (blue_error[x + 1] + (blue_total_error * seven_sixteenth)) >> 15;
-			green_side_error
-				= (green_error[x + 1] + (green_total_error * seven_sixteenth)) >> 15;
+				red_side_error = (red_error[x + 1] + (red_total_error * seven_sixteenth)) >> 15;
+				blue_side_error = (blue_error[x + 1] + (blue_total_error * seven_sixteenth)) >> 15;
+				green_side_error
+					= (green_error[x + 1] + (green_total_error * seven_sixteenth)) >> 15;
 
-			red_error[x + 1] = (red_total_error * one_sixteenth);
-			green_error[x + 1] = (green_total_error * one_sixteenth);
-			blue_error[x + 1] = (blue_total_error * one_sixteenth);
+				red_error_out[x + 1] += (red_total_error * one_sixteenth);
+				green_error_out[x + 1] += (green_total_error * one_sixteenth);
+				blue_error_out[x + 1] += (blue_total_error * one_sixteenth);
 
-			red_error[x] += (red_total_error * five_sixteenth);
-			green_error[x] += (green_total_error * five_sixteenth);
-			blue_error[x] += (blue_total_error * five_sixteenth);
+				red_error_out[x] += (red_total_error * five_sixteenth);
+				green_error_out[x] += (green_total_error * five_sixteenth);
+				blue_error_out[x] += (blue_total_error * five_sixteenth);
 
-			red_error[x - 1] += (red_total_error * three_sixteenth);
-			green_error[x - 1] += (green_total_error * three_sixteenth);
-			blue_error[x - 1] += (blue_total_error * three_sixteenth);
+				red_error_out[x - 1] += (red_total_error * three_sixteenth);
+				green_error_out[x - 1] += (green_total_error * three_sixteenth);
+				blue_error_out[x - 1] += (blue_total_error * three_sixteenth);
+			}
+
+			atomic_set64(progress, (int64)y * width + chunk_end);
 		}
-		destination_bits += destination_padding;
-		source_bits += source_padding;
 	}
+}
 
-	delete[] map_function;
+
+/*
+	This function maps the colors by using Floyd-Steinberg error diffusion dithering.
+	The main idea is to distribute the quantization error to the neighbouring
+	(unprocessed) pixels. The following weights are used in this version:
+
+				X		7/16
+
+		3/16	5/16	1/16
+
+	Every scanline is processed from left to right.
+
+	The error propagates through the image from pixel to pixel, so the image
+	cannot be divided into blocks that are dithered separately without
+	visible lines between them. Instead the rows are dealt out to the threads
+	and each row follows the previous one a few pixels behind, as soon as the
+	errors that it needs have been calculated. The result is the same as
+	with a single thread.
+*/
+BBitmap*
+floyd_steinberg_edd_color_mapper(BBitmap* inSource, const rgb_color* inPalette, int inPaletteSize)
+{
+	BBitmap* outDestination = new BBitmap(inSource->Bounds(), B_CMAP8, false);
+
+	int32 thread_count = color_reducer_thread_count();
+
+	mapper_job job;
+	job.source_bits = (uint32*)inSource->Bits();
+	job.source_bpr = inSource->BytesPerRow() / 4;
+	job.destination_bits = (uint8*)outDestination->Bits();
+	job.destination_bpr = outDestination->BytesPerRow();
+	job.width = inSource->Bounds().IntegerWidth() + 1;
+	job.height = inSource->Bounds().IntegerHeight() + 1;
+	job.map = inverse_color_map(inPalette, inPaletteSize);
+	job.palette = inPalette;
+
+	// A row writes its errors to one buffer while the next row reads them.
+	// The buffer of a row can be used again when the thread that reads it
+	// has started its next row, so one buffer more than there are threads
+	// is enough. The buffer before the first row stays zero.
+	job.ring_size = thread_count + 1;
+	int32 error_length = job.width + 3;
+	job.errors = new int32*[job.ring_size];
+	for (int32 i = 0; i < job.ring_size; i++) {
+		job.errors[i] = new int32[3 * error_length];
+		memset(job.errors[i], 0, 3 * error_length * sizeof(int32));
+	}
+	job.progress = new vint64[thread_count];
+	for (int32 i = 0; i < thread_count; i++)
+		job.progress[i] = -1;
+
+	// Every row waits for the one above it, so each band of rows needs a
+	// thread of its own.
+	run_in_own_threads(floyd_steinberg_thread, &job, thread_count);
+
+	for (int32 i = 0; i < job.ring_size; i++)
+		delete[] job.errors[i];
+	delete[] job.errors;
+	delete[] job.progress;
+	delete[] job.map;
 
 	return outDestination;
 }
@@ -203,9 +387,7 @@ floyd_steinberg_edd_color_mapper(BBitmap* inSource, const rgb_color* inPalette,
 BBitmap*
 preserve_solids_fs_color_mapper(BBitmap* inSource, const rgb_color* inPalette, int inPaletteSize)
 {
-	int32* map_function = new int32[32768]; // using 15 bit colors to do the mapping
-	for (int i = 0; i < 32768; i++)
-		map_function[i] = -1; // the nearest color is not yet found
+	uint8* map_function = inverse_color_map(inPalette, inPaletteSize);
 
 	BBitmap* outDestination = new BBitmap(inSource->Bounds(), B_CMAP8, false);
 
@@ -266,21 +448,8 @@ preserve_solids_fs_color_mapper(BBitmap* inSource, const rgb_color* inPalette, i
 				bgra32.bytes[1] = min_c(255, max_c(0, bgra32.bytes[1] - green_side_error));
 				bgra32.bytes[2] = min_c(255, max_c(0, bgra32.bytes[2] - red_side_error));
 
-				// squeeze the 32-bit color to 15 bit index. See BeBook
-				// BScreen chapter for the reference on this.
-				uint16 rgb15
-					= ((bgra32.bytes[2] & 0xf8) << 7)
-					| ((bgra32.bytes[1] & 0xf8) << 2)
-					| ((bgra32.bytes[0] & 0xf8) >> 3);
-
-				if (map_function[rgb15] < 0) {
-					// The mapping for the color has not yet been found.
-					map_function[rgb15]
-						= find_palette_index(bgra32.word, inPalette, inPaletteSize);
-				}
-
-				uint8 color_index = *(destination_bits + x + y * destination_bpr) 
-					= (uint8)map_function[rgb15];
+				uint8 color_index = *(destination_bits + x + y * destination_bpr)
+					= map_function[rgb15_index(bgra32.word)];
 
 				int32 red_total_error = inPalette[color_index].red - bgra32.bytes[2];
 				int32 green_total_error = inPalette[color_index].green - bgra32.bytes[1];
@@ -306,19 +475,8 @@ preserve_solids_fs_color_mapper(BBitmap* inSource, const rgb_color* inPalette, i
 				blue_error[x - 1] += (blue_total_error * three_sixteenth);
 			} else {
 				bgra32.word = *(source_bits + x + y * source_bpr);
-
-				// squeeze the 32-bit color to 15 bit index. See BeBook
-				// BScreen chapter for the reference on this.
-				uint16 rgb15
-					= ((bgra32.bytes[2] & 0xf8) << 7)
-					| ((bgra32.bytes[1] & 0xf8) << 2)
-					| ((bgra32.bytes[0] & 0xf8) >> 3);
-
-				if (map_function[rgb15] < 0) {
-					// The mapping for the color has not yet been found.
-					map_function[rgb15]
-						= find_palette_index(bgra32.word, inPalette, inPaletteSize);
-				}
+				*(destination_bits + x + y * destination_bpr)
+					= map_function[rgb15_index(bgra32.word)];
 
 				red_side_error = red_error[x + 1] >> 15;
 				blue_side_error = blue_error[x + 1] >> 15;
@@ -363,6 +521,7 @@ n_candidate_color_mapper(
 		candidates.candidate_table[i] = new Candidate[maxCandidates];
 		candidates.candidate_count[i] = 0; // the candidates have not yet been found
 	}
+	palette_candidate* nearest = new palette_candidate[maxCandidates];
 
 	BBitmap* outDestination = new BBitmap(inSource->Bounds(), B_CMAP8, false);
 
@@ -387,36 +546,26 @@ n_candidate_color_mapper(
 	for (int32 y = 0; y <= height; y++) {
 		for (int32 x = 0; x <= width; x++) {
 			bgra32.word = *source_bits++;
-			// squeeze the 32-bit color to 15 bit index. See BeBook
-			// BScreen chapter for the reference on this.
-			uint16 rgb15
-				= ((bgra32.bytes[2] & 0xf8) << 7)
-				| ((bgra32.bytes[1] & 0xf8) << 2)
-				| ((bgra32.bytes[0] & 0xf8) >> 3);
+			uint16 rgb15 = rgb15_index(bgra32.word);
 			if (candidates.candidate_count[rgb15] <= 0) {
-				// The candidates for the color have not yet been found.
-//				map_function[rgb15] = find_palette_index(bgra32.word,inPalette,inPaletteSize);
+				// The candidates for the color have not yet been found. All
+				// of them are found with one pass over the palette.
+				find_candidates(bgra32.word, inPalette, inPaletteSize, maxCandidates,
+					nearest);
 				float max_error = -1;
 				float inverse_error_sum = 0;
 				int32 number_of_candidates = 0;
 				for (int32 i = 0; i < maxCandidates; i++) {
-					float distance;
-					candidates.candidate_table[rgb15][i].index
-						= find_candidate(bgra32.word, inPalette, inPaletteSize, i + 1, &distance);
+					float distance = nearest[i].distance;
+					candidates.candidate_table[rgb15][i].index = nearest[i].index;
 					candidates.candidate_table[rgb15][i].prob = distance;
 					if (max_error < 0) {
 						max_error = 5.0 * distance;
 						number_of_candidates++;
 						if (distance > 0)
 							inverse_error_sum += 1.0 / distance;
-						printf("color:\t%d\t%d\t%d\n", bgra32.bytes[2], bgra32.bytes[1],
-							bgra32.bytes[0]);
-						rgb_color pc = inPalette[candidates.candidate_table[rgb15][i].index];
-						printf("\tcandidate:\t%d\t%d\t%d\n", pc.red, pc.green, pc.blue);
 					} else if (distance <= max_error) {
 						number_of_candidates++;
-						rgb_color pc = inPalette[candidates.candidate_table[rgb15][i].index];
-						printf("\tcandidate:\t%d\t%d\t%d\n", pc.red, pc.green, pc.blue);
 						if (distance > 0)
 							inverse_error_sum += 1.0 / distance;
 					}
@@ -451,5 +600,12 @@ n_candidate_color_mapper(
 		source_bits += source_padding;
 	}
 
+	for (int i = 0; i < 32768; i++)
+		delete[] candidates.candidate_table[i];
+	delete[] candidates.candidate_table;
+	delete[] candidates.candidate_count;
+	delete[] nearest;
+	delete generator;
+
 	return outDestination;
 }
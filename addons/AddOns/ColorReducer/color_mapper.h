@@ -18,58 +18,63 @@ BBitmap* n_candidate_color_mapper(BBitmap *inSource, const rgb_color* inPalette,
 
 
 /*
-	This function can be called at most 32768 times for an image.
-	For this reason it should be as fast as possible. Using some other
-	distance metric instead of the euclidian rgb-distance might very well
-	be useful. For example the sum of r,g and b component absolute
-	differences could be used thus removing the sqrts.
+	Returns a table that gives the index of the nearest palette color for
+	each of the 32768 15-bit colors. The color in the middle of each 15-bit
+	cell is used for the search, so the table does not depend on the order
+	in which the image is processed. The table is calculated in parallel and
+	must be deleted with delete[].
 */
+uint8* inverse_color_map(const rgb_color* inPalette, int inPaletteSize);
 
-inline int32 find_palette_index(uint32 bgra_word,const rgb_color *inPalette, int inPaletteSize)
+
+// Squeezes the 32-bit color to a 15 bit index. See BeBook BScreen chapter
+// for the reference on this.
+inline uint16 rgb15_index(uint32 bgra_word)
 {
+	// Use this union to guarantee endianness compatibility.
 	union {
 		uint8 bytes[4];
 		uint32 word;
 	} bgra32;
 
 	bgra32.word = bgra_word;
+	return ((bgra32.bytes[2] & 0xf8) << 7) | ((bgra32.bytes[1] & 0xf8) << 2)
+		| ((bgra32.bytes[0] & 0xf8) >> 3);
+}
 
-	float min_distance = 1000000.0;
-	uint8 red = bgra32.bytes[2];
-	uint8 green = bgra32.bytes[1];
-	uint8 blue = bgra32.bytes[0];
-
-	int32 selected_index = -1;
-
-	for (int i=0;i<inPaletteSize;i++) {
-		float distance = sqrt(
-			pow(inPalette[i].red-red, 2)
-			+ pow(inPalette[i].green-green, 2)
-			+ pow(inPalette[i].blue-blue, 2));
-		if (distance < min_distance) {
-			selected_index = i;
-			min_distance = distance;
-		}
-	}
 
-	return selected_index;
-}
+// The number of threads in the WorkerPool.
+int32 color_reducer_thread_count();
 
+// Calls function(data, thread_number, thread_count) for each thread_number
+// from 0 to thread_count - 1 on the WorkerPool and returns when all of them
+// have finished. The calls do not necessarily run at the same time.
+void run_in_threads(void (*function)(void*, int32, int32), void* data,
+	int32 thread_count);
 
+// Like run_in_threads(), but each call gets a thread of its own, so that
+// the calls can wait for each other.
+void run_in_own_threads(void (*function)(void*, int32, int32), void* data,
+	int32 thread_count);
 
-inline int32 find_candidate(uint32 bgra_word,const rgb_color* inPalette, int inPaletteSize,
-	int candidateNumber, float* outDistance)
-{
-	struct Candidate {
-		int32 index;
-		float distance;
-	};
 
-	Candidate* candidates = new Candidate[candidateNumber];
+struct palette_candidate {
+	int32	index;
+	float	distance;
+};
 
-	for (int32 i = 0; i < candidateNumber; i++) {
-		candidates[i].index = 0;
-		candidates[i].distance = 1000000.0;
+
+/*
+	Finds the candidateCount palette colors that are nearest to the color,
+	the nearest first. If the palette has fewer colors, the remaining
+	candidates get the index 0 and a distance of 1000000.
+*/
+inline void find_candidates(uint32 bgra_word, const rgb_color* inPalette, int inPaletteSize,
+	int candidateCount, palette_candidate* outCandidates)
+{
+	for (int32 i = 0; i < candidateCount; i++) {
+		outCandidates[i].index = 0;
+		outCandidates[i].distance = 1000000.0;
 	}
 
 	union {
@@ -79,40 +84,27 @@ inline int32 find_candidate(uint32 bgra_word,const rgb_color* inPalette, int inP
 
 	bgra32.word = bgra_word;
 
-	float min_distance = 1000000.0;
-	uint8 red = bgra32.bytes[2];
-	uint8 green = bgra32.bytes[1];
-	uint8 blue = bgra32.bytes[0];
-
-	int32 selected_index = -1;
-
-	if (candidateNumber > inPaletteSize) {
-		*outDistance = min_distance;
-		delete[] candidates;
-		return 0;
-	}
+	int32 red = bgra32.bytes[2];
+	int32 green = bgra32.bytes[1];
+	int32 blue = bgra32.bytes[0];
 
+	int32 found_count = min_c(candidateCount, inPaletteSize);
 	for (int i = 0; i < inPaletteSize; i++) {
-		float distance = sqrt(
-			pow(inPalette[i].red-red, 2)
-			+ pow(inPalette[i].green-green, 2)
-			+ pow(inPalette[i].blue-blue, 2));
-		int k=0;
-		while ((k<candidateNumber) && (candidates[k].distance < distance))
+		int32 dr = inPalette[i].red - red;
+		int32 dg = inPalette[i].green - green;
+		int32 db = inPalette[i].blue - blue;
+		float distance = sqrt(dr * dr + dg * dg + db * db);
+
+		int k = 0;
+		while ((k < found_count) && (outCandidates[k].distance < distance))
 			k++;
 
-		for (int j = candidateNumber - 1; j > k; j--)
-			candidates[j] = candidates[j - 1];
+		for (int j = found_count - 1; j > k; j--)
+			outCandidates[j] = outCandidates[j - 1];
 
-		if (k < candidateNumber) {
-			candidates[k].distance = distance;
-			candidates[k].index = i;
+		if (k < found_count) {
+			outCandidates[k].distance = distance;
+			outCandidates[k].index = i;
 		}
 	}
-
-	selected_index = candidates[candidateNumber - 1].index;
-	*outDistance = candidates[candidateNumber - 1].distance;
-
-	delete[] candidates;
-	return selected_index;
 }
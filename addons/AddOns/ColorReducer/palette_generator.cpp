@@ -8,164 +8,291 @@
  *
  */
 #include <Bitmap.h>
+#include <new>
 #include <stdio.h>
+#include <string.h>
 
 
-#include "ColorDistanceMetric.h"
 #include "RandomNumberGenerator.h"
-#include "Selection.h"
 #include "color_mapper.h"
 #include "palette_generator.h"
 
 
-/* 'Generalized Lloyd's Algorithm' Palette Generation */
+// One bit for every 24-bit color.
+const int32 kColorSetLength = (1 << 24) / 32;
 
-rgb_color*
-gla_palette(BBitmap* inBitmap, int paletteSize)
+
+/*
+	The input colors are collected to 15-bit cells. Each cell holds the
+	number of different colors that fall into it and the sums of their
+	components. Every color of the image is counted once, however many
+	pixels have it.
+*/
+struct color_cells {
+	uint32	count[32768];
+	uint32	red[32768];
+	uint32	green[32768];
+	uint32	blue[32768];
+};
+
+
+struct palette_sums {
+	double	count;
+	double	red;
+	double	green;
+	double	blue;
+};
+
+
+struct palette_job {
+	BBitmap*		bitmap;
+
+	// The colors that the image contains, one set per thread.
+	uint32**		color_sets;
+
+	color_cells*	cells;
+
+	// The cells that are not empty and their average colors.
+	int32*			used_cells;
+	rgb_color*		cell_colors;
+	int32			used_cell_count;
+
+	const rgb_color*	palette;
+	int32			palette_size;
+
+	// The sums of the cells that are mapped to each palette entry, one
+	// array per thread.
+	palette_sums**	sums;
+};
+
+
+static void
+collect_colors_thread(void* data, int32 thread_number, int32 thread_count)
 {
-	ColorDistanceMetric* color_metric = new (std::nothrow) ColorDistanceMetric();
-	if (color_metric == NULL)
-		return NULL;
+	palette_job* job = (palette_job*)data;
+
+	uint32* color_set = job->color_sets[thread_number];
+	memset(color_set, 0, kColorSetLength * sizeof(uint32));
+
+	uint32* bits = (uint32*)job->bitmap->Bits();
+	int32 bpr = job->bitmap->BytesPerRow() / 4;
+	int32 width = job->bitmap->Bounds().IntegerWidth() + 1;
+	int32 height = job->bitmap->Bounds().IntegerHeight() + 1;
+
+	int32 first = height * thread_number / thread_count;
+	int32 last = height * (thread_number + 1) / thread_count;
+	for (int32 y = first; y < last; y++) {
+		uint32* row = bits + y * bpr;
+		for (int32 x = 0; x < width; x++) {
+			uint32 rgb = row[x] & 0x00ffffff;
+			color_set[rgb >> 5] |= 1 << (rgb & 31);
+		}
+	}
+}
 
-	rgb_color* palette = new (std::nothrow) rgb_color[paletteSize];
-	if (palette == NULL) {
-		delete color_metric;
 
-		return NULL;
+static void
+merge_colors_thread(void* data, int32 thread_number, int32 thread_count)
+{
+	palette_job* job = (palette_job*)data;
+
+	// The sets of all threads are combined to the first one.
+	int32 first = kColorSetLength * thread_number / thread_count;
+	int32 last = kColorSetLength * (thread_number + 1) / thread_count;
+	for (int32 i = 1; i < thread_count; i++) {
+		uint32* set = job->color_sets[i];
+		for (int32 j = first; j < last; j++)
+			job->color_sets[0][j] |= set[j];
 	}
+}
 
-	rgb_color* previous_palette = new (std::nothrow) rgb_color[paletteSize];
-	if (previous_palette == NULL) {
-		delete color_metric;
 
-		return palette;
+static void
+fill_cells_thread(void* data, int32 thread_number, int32 thread_count)
+{
+	palette_job* job = (palette_job*)data;
+
+	// Each thread fills the cells of its own reds. The colors with the
+	// same red value are stored next to each other in the set, and the
+	// eight reds of a cell are given to the same thread.
+	color_cells* cells = job->cells;
+	uint32* color_set = job->color_sets[0];
+	int32 first_red = 32 * thread_number / thread_count * 8;
+	int32 last_red = 32 * (thread_number + 1) / thread_count * 8;
+	for (int32 red = first_red; red < last_red; red++) {
+		for (int32 green = 0; green < 256; green++) {
+			uint32* words = color_set + ((red << 16) | (green << 8)) / 32;
+			for (int32 w = 0; w < 8; w++) {
+				uint32 word = words[w];
+				while (word != 0) {
+					int32 blue = w * 32 + __builtin_ctz(word);
+					word &= word - 1;
+
+					int32 cell = ((red & 0xf8) << 7) | ((green & 0xf8) << 2)
+						| ((blue & 0xf8) >> 3);
+					cells->count[cell]++;
+					cells->red[cell] += red;
+					cells->green[cell] += green;
+					cells->blue[cell] += blue;
+				}
+			}
+		}
 	}
+}
 
-	struct color_chain {
-		color_chain* next;
-		rgb_color color;
-	};
 
-	color_chain** selected_colors = new (std::nothrow) color_chain*[paletteSize];
-	if (selected_colors == NULL) {
-		delete color_metric;
-		delete[] previous_palette;
+static void
+lloyd_thread(void* data, int32 thread_number, int32 thread_count)
+{
+	palette_job* job = (palette_job*)data;
+
+	palette_sums* sums = job->sums[thread_number];
+	memset(sums, 0, job->palette_size * sizeof(palette_sums));
+
+	int32 first = job->used_cell_count * thread_number / thread_count;
+	int32 last = job->used_cell_count * (thread_number + 1) / thread_count;
+	for (int32 i = first; i < last; i++) {
+		rgb_color c = job->cell_colors[i];
+
+		// The squared distance has the same minimum as the distance.
+		int32 min_distance = 1000000;
+		int32 index = 0;
+		for (int32 j = 0; j < job->palette_size; j++) {
+			int32 dr = job->palette[j].red - c.red;
+			int32 dg = job->palette[j].green - c.green;
+			int32 db = job->palette[j].blue - c.blue;
+			int32 distance = dr * dr + dg * dg + db * db;
+			if (distance < min_distance) {
+				index = j;
+				min_distance = distance;
+			}
+		}
 
-		return palette;
+		int32 cell = job->used_cells[i];
+		sums[index].count += job->cells->count[cell];
+		sums[index].red += job->cells->red[cell];
+		sums[index].green += job->cells->green[cell];
+		sums[index].blue += job->cells->blue[cell];
 	}
+}
+
+
+/* 'Generalized Lloyd's Algorithm' Palette Generation */
 
-	color_chain** input_colors = new (std::nothrow) color_chain*[32768];
-	if (input_colors == NULL) {
-		delete color_metric;
-		delete[] selected_colors;
+rgb_color*
+gla_palette(BBitmap* inBitmap, int paletteSize)
+{
+	int32 thread_count = color_reducer_thread_count();
+
+	rgb_color* palette = new (std::nothrow) rgb_color[paletteSize];
+	rgb_color* previous_palette = new (std::nothrow) rgb_color[paletteSize];
+	uint32** color_sets = new (std::nothrow) uint32*[thread_count];
+	color_cells* cells = new (std::nothrow) color_cells;
+	palette_sums** sums = new (std::nothrow) palette_sums*[thread_count];
+	if (palette == NULL || previous_palette == NULL || color_sets == NULL
+		|| cells == NULL || sums == NULL) {
+		delete[] palette;
 		delete[] previous_palette;
+		delete[] color_sets;
+		delete cells;
+		delete[] sums;
+
+		return NULL;
+	}
 
-		return palette;
+	bool out_of_memory = false;
+	for (int32 i = 0; i < thread_count; i++) {
+		color_sets[i] = new (std::nothrow) uint32[kColorSetLength];
+		sums[i] = new (std::nothrow) palette_sums[paletteSize];
+		if (color_sets[i] == NULL || sums[i] == NULL)
+			out_of_memory = true;
 	}
 
-	for (int32 i = 0; i < 32768; i++)
-		input_colors[i] = NULL;
+	palette_job job;
+	job.bitmap = inBitmap;
+	job.color_sets = color_sets;
+	job.cells = cells;
+	job.used_cells = NULL;
+	job.cell_colors = NULL;
+	job.used_cell_count = 0;
+	job.palette = palette;
+	job.palette_size = paletteSize;
+	job.sums = sums;
+
+	if (!out_of_memory) {
+		memset(cells, 0, sizeof(color_cells));
+		run_in_threads(collect_colors_thread, &job, thread_count);
+		run_in_threads(merge_colors_thread, &job, thread_count);
+		run_in_threads(fill_cells_thread, &job, thread_count);
+
+		job.used_cells = new (std::nothrow) int32[32768];
+		job.cell_colors = new (std::nothrow) rgb_color[32768];
+		if (job.used_cells == NULL || job.cell_colors == NULL)
+			out_of_memory = true;
+	}
 
-	uint32* bits = (uint32*)inBitmap->Bits();
-	int32 bits_length = inBitmap->BitsLength() / 4;
+	for (int32 i = 0; i < thread_count; i++)
+		delete[] color_sets[i];
+	delete[] color_sets;
+
+	if (out_of_memory) {
+		for (int32 i = 0; i < thread_count; i++)
+			delete[] sums[i];
+		delete[] sums;
+		delete[] job.used_cells;
+		delete[] job.cell_colors;
+		delete cells;
+		delete[] previous_palette;
+		delete[] palette;
 
-	union {
-		uint8 bytes[4];
-		uint32 word;
-	} color;
-	color.word = 0x00000000; // Silence the warnings
+		return NULL;
+	}
 
-	int32 color_count = 0;
-	for (int32 i = 0; i < bits_length; i++) {
-		color.word = *bits++;
-		uint16 hash_value
-			= ((color.bytes[2] & 0x1f) << 10)
-			| ((color.bytes[1] & 0x1f) << 5)
-			| ((color.bytes[0] & 0x1f) >> 0);
+	// The cells are mapped to the palette by their average colors.
+	for (int32 i = 0; i < 32768; i++) {
+		uint32 count = cells->count[i];
+		if (count == 0)
+			continue;
 
-		color_chain* test_entry = input_colors[hash_value];
-		bool found = false;
 		rgb_color c;
-		c.red = color.bytes[2];
-		c.green = color.bytes[1];
-		c.blue = color.bytes[0];
+		c.red = (cells->red[i] + count / 2) / count;
+		c.green = (cells->green[i] + count / 2) / count;
+		c.blue = (cells->blue[i] + count / 2) / count;
 		c.alpha = 255;
 
-		while ((test_entry != NULL) && !found) {
-			rgb_color old_color = test_entry->color;
-			if ((c.red == old_color.red) && (c.green == old_color.green)
-				&& (c.blue == old_color.blue))
-				found = true;
-
-			test_entry = test_entry->next;
-		}
-
-		if (!found) {
-			color_chain* entry = new color_chain();
-			entry->next = input_colors[hash_value];
-			input_colors[hash_value] = entry;
-			entry->color = c;
-			color_count++;
-		}
+		job.used_cells[job.used_cell_count] = i;
+		job.cell_colors[job.used_cell_count] = c;
+		job.used_cell_count++;
 	}
-	int32 total_length = 0;
-	int32 list_count = 0;
-	for (int32 i = 0; i < 32768; i++) {
-		int32 length = 0;
-		color_chain* entry = input_colors[i];
-		while (entry != NULL) {
-			length++;
-			entry = entry->next;
-		}
-		if (length > 0) {
-			total_length += length;
-			list_count++;
-		}
-	}
-	printf("Number of lists is %" B_PRId32 ", average length %f\n", list_count,
-		total_length / (float)list_count);
 
 	// Initialize the palette.
 	RandomNumberGenerator generator(123071, 25000);
 	for (int32 i = 0; i < paletteSize; i++) {
-		// Choose a random input color
-		int32 index = generator.IntegerUniformDistribution(0, 32767);
-		while (input_colors[index] == NULL)
-			index = (index + 1) % 32768;
-
-		palette[i] = input_colors[index]->color;
+		if (job.used_cell_count == 0) {
+			palette[i].red = palette[i].green = palette[i].blue = 0;
+		} else {
+			// Choose a random input color
+			int32 index = generator.IntegerUniformDistribution(0, 32767);
+			while (cells->count[index] == 0)
+				index = (index + 1) % 32768;
+
+			uint32 count = cells->count[index];
+			palette[i].red = cells->red[index] / count;
+			palette[i].green = cells->green[index] / count;
+			palette[i].blue = cells->blue[index] / count;
+		}
 
 		palette[i].alpha = 255;
 		previous_palette[i] = palette[i];
-		selected_colors[i] = NULL;
 	}
 
-	bool palette_still_improving = true;
+	bool palette_still_improving = job.used_cell_count > 0;
 	int32 number_of_iterations = 0;
 	while (palette_still_improving && (number_of_iterations < 100)) {
 		number_of_iterations++;
-		printf("Still improving\n");
+
 		// Map all of the input colors
-		for (uint16 i = 0; i < 32768; i++) {
-			color_chain* input_entry = input_colors[i];
-			while (input_entry != NULL) {
-				color.bytes[0] = input_entry->color.blue;
-				color.bytes[1] = input_entry->color.green;
-				color.bytes[2] = input_entry->color.red;
-				color.bytes[3] = 255;
-
-				int32 index = color_metric->find_palette_index(color.word, palette, paletteSize);
-				color_chain* entry = new color_chain();
-				entry->next = selected_colors[index];
-				selected_colors[index] = entry;
-				entry->color.red = color.bytes[2];
-				entry->color.green = color.bytes[1];
-				entry->color.blue = color.bytes[0];
-				entry->color.alpha = 255;
-
-				input_entry = input_entry->next;
-			}
-		}
+		run_in_threads(lloyd_thread, &job, thread_count);
 
 		// Store the current palette
 		for (int32 i = 0; i < paletteSize; i++)
@@ -173,60 +300,40 @@ gla_palette(BBitmap* inBitmap, int paletteSize)
 
 		// Take the average of mappings as the new palette
 		for (int32 i = 0; i < paletteSize; i++) {
-			color_chain* entry = selected_colors[i];
-			float entry_count = 0;
-			float red = 0;
-			float green = 0;
-			float blue = 0;
-			while (entry != NULL) {
-				red += entry->color.red;
-				green += entry->color.green;
-				blue += entry->color.blue;
-
-				entry_count++;
-				entry = entry->next;
+			palette_sums total = sums[0][i];
+			for (int32 t = 1; t < thread_count; t++) {
+				total.count += sums[t][i].count;
+				total.red += sums[t][i].red;
+				total.green += sums[t][i].green;
+				total.blue += sums[t][i].blue;
 			}
-			if (entry_count > 0) {
-				red /= entry_count;
-				green /= entry_count;
-				blue /= entry_count;
-
-				palette[i].red = (uint8)red;
-				palette[i].green = (uint8)green;
-				palette[i].blue = (uint8)blue;
-			}
-		}
 
-		// Here we destroy the linked list
-		for (int32 i = 0; i < paletteSize; i++) {
-			color_chain* entry = selected_colors[i];
-			while (entry != NULL) {
-				color_chain* spare_entry = entry->next;
-				delete entry;
-				entry = spare_entry;
+			if (total.count > 0) {
+				palette[i].red = (uint8)(total.red / total.count);
+				palette[i].green = (uint8)(total.green / total.count);
+				palette[i].blue = (uint8)(total.blue / total.count);
 			}
-			selected_colors[i] = NULL;
 		}
 
 		// Here compare if the palette actually improved
 		palette_still_improving = false;
-		float error_amount = 0;
-		for (int32 i = 0; i < paletteSize; i++)
-			error_amount += color_metric->color_distance(palette[i], previous_palette[i]);
-
-		if (error_amount > 0)
-			palette_still_improving = true;
+		for (int32 i = 0; i < paletteSize; i++) {
+			if (palette[i].red != previous_palette[i].red
+				|| palette[i].green != previous_palette[i].green
+				|| palette[i].blue != previous_palette[i].blue)
+				palette_still_improving = true;
+		}
 	}
 
 	printf("Number of iterations %" B_PRId32 "\n", number_of_iterations);
 
+	for (int32 i = 0; i < thread_count; i++)
+		delete[] sums[i];
+	delete[] sums;
+	delete[] job.used_cells;
+	delete[] job.cell_colors;
+	delete cells;
 	delete[] previous_palette;
-	delete color_metric;
-
-	// Here destroy the input color array/lists
-
-	delete[] input_colors;
-	delete[] selected_colors;
 
 	return palette;
 }
@@ -18,6 +18,7 @@
 #include "AddOns.h"
 #include "Contrast.h"
 #include "ManipulatorInformer.h"
+#include "PointOperation.h"
 #include "Selection.h"
 
 #undef B_TRANSLATION_CONTEXT
@@ -163,152 +164,24 @@ ContrastManipulator::CalculateAverageLuminance(BBitmap* bitmap)
 void
 ContrastManipulator::start_threads()
 {
-	number_of_threads = GetSystemCpuCount();
-
-	thread_id* threads = new thread_id[number_of_threads];
-
-	for (int32 i = 0; i < number_of_threads; i++) {
-		threads[i] = spawn_thread(thread_entry, "contrast_thread", B_NORMAL_PRIORITY, this);
-		resume_thread(threads[i]);
-		send_data(threads[i], i, NULL, 0);
-	}
-
-	for (int32 i = 0; i < number_of_threads; i++) {
-		int32 return_value;
-		wait_for_thread(threads[i], &return_value);
-	}
-
-	delete[] threads;
-}
-
-
-int32
-ContrastManipulator::thread_entry(void* data)
-{
-	int32 thread_number;
-	thread_number = receive_data(NULL, NULL, 0);
-
-	ContrastManipulator* this_pointer = (ContrastManipulator*)data;
-
-	return this_pointer->thread_function(thread_number);
-}
-
-
-int32
-ContrastManipulator::thread_function(int32 thread_number)
-{
-	// This function interpolates the image with a degenerate version,
-	// which in this case is the average luminance. The luminance image is not actually
-	// used, but only implied. This function does not touch the alpha-channel.
-
-	int32 step = current_resolution;
-	uint32 contrast = settings.contrast;
-
-	BWindow* progress_bar_window = NULL;
-	if (progress_bar != NULL)
-		progress_bar_window = progress_bar->Window();
-
-
-	uint32* source_bits = (uint32*)source_bitmap->Bits();
-	uint32* target_bits = (uint32*)target_bitmap->Bits();
-	int32 source_bpr = source_bitmap->BytesPerRow() / 4;
-	int32 target_bpr = target_bitmap->BytesPerRow() / 4;
-
-	// This union must be used to guarantee endianness compatibility.
-	union {
-		uint8 bytes[4];
-		uint32 word;
-	} color;
-
+	// This interpolates the image with a degenerate version, which in this
+	// case is the average luminance. The luminance image is not actually
+	// used, but only implied. The alpha-channel is not touched.
 	float coeff = current_settings.contrast / 100.0;
 	float one_minus_coeff = 1.0 - coeff;
 	int32 luminance_factor = current_average_luminance * one_minus_coeff;
 
-	uint8 luminance_values[256];
+	uint8 table[256];
 	for (int32 i = 0; i < 256; i++)
-		luminance_values[i] = max_c(0, min_c(255, i * coeff + luminance_factor));
-
-	if (selection->IsEmpty()) {
-		// Here handle the whole image.
-		int32 left = target_bitmap->Bounds().left;
-		int32 right = target_bitmap->Bounds().right;
-		int32 top = target_bitmap->Bounds().top;
-		int32 bottom = target_bitmap->Bounds().bottom;
-
-		float height = bottom - top;
-		top = height / number_of_threads * thread_number;
-		top = ceil(top / (float)step);
-		top *= step;
-		bottom = min_c(bottom, top + (height + 1) / number_of_threads);
-		int32 update_interval = 10;
-		float update_amount = 100.0 / (bottom - top) * update_interval / (float)number_of_threads;
-		float missed_update = 0;
-
-		// Loop through all pixels in original.
-		contrast *= 3;
-		for (int32 y = top; y <= bottom; y += step) {
-			int32 y_times_source_bpr = y * source_bpr;
-			int32 y_times_target_bpr = y * target_bpr;
-			for (int32 x = left; x <= right; x += step) {
-				color.word = *(source_bits + x + y_times_source_bpr);
-				color.bytes[0] = luminance_values[color.bytes[0]];
-				color.bytes[1] = luminance_values[color.bytes[1]];
-				color.bytes[2] = luminance_values[color.bytes[2]];
-				*(target_bits + x + y_times_target_bpr) = color.word;
-			}
+		table[i] = max_c(0, min_c(255, i * coeff + luminance_factor));
 
-			// Update the status-bar
-			if (((y % update_interval) == 0) && (progress_bar_window != NULL)
-				&& (progress_bar_window->LockWithTimeout(0) == B_OK)) {
-				progress_bar->Update(update_amount + missed_update);
-				progress_bar_window->Unlock();
-				missed_update = 0;
-			} else if ((y % update_interval) == 0)
-				missed_update += update_amount;
-		}
-	} else {
-		// Here handle only those pixels for which selection->ContainsPoint(x,y) is true.
-		BRect rect = selection->GetBoundingRect();
-
-		int32 left = rect.left;
-		int32 right = rect.right;
-		int32 top = rect.top;
-		int32 bottom = rect.bottom;
-
-		float height = bottom - top;
-		top += height / number_of_threads * thread_number;
-		top *= step;
-		top /= step;
-
-		bottom = min_c(bottom, top + (height + 1) / number_of_threads);
-
-		int32 update_interval = 10;
-		float update_amount = 100.0 / (bottom - top) * update_interval / (float)number_of_threads;
-
-		// Loop through all pixels in original.
-		for (int32 y = top; y <= bottom; y += step) {
-			int32 y_times_source_bpr = y * source_bpr;
-			int32 y_times_target_bpr = y * target_bpr;
-			for (int32 x = left; x <= right; x += step) {
-				if (selection->ContainsPoint(x, y)) {
-					color.word = *(source_bits + x + y_times_source_bpr);
-					color.bytes[0] = luminance_values[color.bytes[0]];
-					color.bytes[1] = luminance_values[color.bytes[1]];
-					color.bytes[2] = luminance_values[color.bytes[2]];
-					*(target_bits + x + y_times_target_bpr) = color.word;
-				}
-			}
-
-			// Update the status-bar
-			if (((y % update_interval) == 0) && (progress_bar_window != NULL)
-				&& (progress_bar_window->LockWithTimeout(0) == B_OK)) {
-				progress_bar->Update(update_amount);
-				progress_bar_window->Unlock();
-			}
-		}
-	}
+	ChannelMapOperation* operation = new ChannelMapOperation();
+	operation->SetTables(table);
 
-	return B_OK;
+	PointOperationPipeline pipeline;
+	pipeline.AddOperation(operation);
+	pipeline.Apply(source_bitmap, target_bitmap, selection, current_resolution,
+		progress_bar);
 }
 
 
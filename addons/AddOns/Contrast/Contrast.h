@@ -60,8 +60,7 @@ class ContrastManipulator : public WindowGUIManipulator {
 
 			ContrastManipulatorView		*config_view;
 
-			// The next attributes will be used by the thread_function.
-			int32		number_of_threads;
+			// The next attributes will be used by start_threads().
 			int32		current_resolution;
 
 			uint8		current_average_luminance;
@@ -76,8 +75,6 @@ class ContrastManipulator : public WindowGUIManipulator {
 
 			void		start_threads();
 
-	static	int32		thread_entry(void*);
-			int32		thread_function(int32);
 
 			uint8		CalculateAverageLuminance(BBitmap*);
 
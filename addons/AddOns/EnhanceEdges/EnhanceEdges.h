@@ -12,15 +12,8 @@
 #include "Manipulator.h"
 
 class EnhanceEdgesManipulator : public Manipulator {
-		BBitmap*	source_bitmap;
-		BBitmap*	target_bitmap;
-		BStatusBar*	progress_bar;
 		Selection*	selection;
 
-static	int32		thread_entry(void*);
-		int32		thread_function(int32);
-		int			processor_count;
-
 public:
 					EnhanceEdgesManipulator();
 
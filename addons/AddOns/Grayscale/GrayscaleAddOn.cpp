@@ -15,6 +15,7 @@
 #include "AddOns.h"
 #include "GrayscaleAddOn.h"
 #include "ManipulatorInformer.h"
+#include "PointOperation.h"
 #include "Selection.h"
 
 #undef B_TRANSLATION_CONTEXT
@@ -41,6 +42,33 @@ instantiate_add_on(BBitmap* bm, ManipulatorInformer* i)
 }
 
 
+class GrayscaleOperation : public PointOperation {
+public:
+	uint32 Apply(uint32 bgra) const
+	{
+		union {
+			uint8 bytes[4];
+			uint32 word;
+		} color;
+
+		color.word = bgra;
+		float sum = color.bytes[0] * 0.114 + color.bytes[1] * 0.587
+			+ color.bytes[2] * 0.299;
+		color.bytes[0] = sum;
+		color.bytes[1] = sum;
+		color.bytes[2] = sum;
+		return color.word;
+	}
+};
+
+
+PointOperation*
+instantiate_point_operation(ManipulatorSettings*)
+{
+	return new GrayscaleOperation();
+}
+
+
 GrayscaleAddOnManipulator::GrayscaleAddOnManipulator(BBitmap*)
 	:
 	Manipulator(),
@@ -63,45 +91,10 @@ GrayscaleAddOnManipulator::ManipulateBitmap(BBitmap* original, BStatusBar* statu
 		status_bar->Window()->PostMessage(&progress_message, status_bar);
 	}
 
-	int32 bits_length = original->BitsLength() / 4;
-	uint32* bits = (uint32*)original->Bits();
-	float blue, red, green;
-	union {
-		uint8 bytes[4];
-		uint32 word;
-	} color;
-	if ((selection == NULL) || (selection->IsEmpty() == TRUE)) {
-		for (int32 i = 0; i < bits_length; i++) {
-			color.word = *bits;
-			blue = color.bytes[0] * 0.114;
-			green = color.bytes[1] * 0.587;
-			red = color.bytes[2] * 0.299;
-			float sum = blue + red + green;
-			color.bytes[0] = sum;
-			color.bytes[1] = sum;
-			color.bytes[2] = sum;
-			*bits++ = color.word;
-		}
-	} else {
-		int32 width = original->Bounds().Width();
-		int32 height = original->Bounds().Height();
-		for (int32 y = 0; y <= height; y++) {
-			for (int32 x = 0; x <= width; x++) {
-				if (selection->ContainsPoint(x, y)) {
-					color.word = *bits;
-					blue = color.bytes[0] * 0.114;
-					green = color.bytes[1] * 0.587;
-					red = color.bytes[2] * 0.299;
-					float sum = blue + red + green;
-					color.bytes[0] = sum;
-					color.bytes[1] = sum;
-					color.bytes[2] = sum;
-					*bits++ = color.word;
-				} else
-					++bits;
-			}
-		}
-	}
+	PointOperationPipeline pipeline;
+	pipeline.AddOperation(new GrayscaleOperation());
+	pipeline.Apply(original, original, selection, 1, NULL);
+
 	return original;
 }
 
@@ -8,7 +8,18 @@
  */
 #include <Bitmap.h>
 #include <Catalog.h>
+#include <LayoutBuilder.h>
+#include <MenuField.h>
+#include <MenuItem.h>
+#include <Node.h>
+#include <PopUpMenu.h>
+#include <Slider.h>
+#include <StatusBar.h>
 #include <Window.h>
+#include <math.h>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
 
 #include "AddOns.h"
 #include "Halftone.h"
@@ -23,7 +34,7 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
-	char name[255] = B_TRANSLATE_MARK("Halftone");
+	char name[255] = B_TRANSLATE_MARK("Halftone" B_UTF8_ELLIPSIS);
 	char menu_help_string[255]
 		= B_TRANSLATE_MARK("Makes a halftone-pattern with fore- and background colors.");
 	int32 add_on_api_version = ADD_ON_API_VERSION;
@@ -33,623 +44,831 @@ extern "C" {
 #endif
 
 
-Manipulator*
-instantiate_add_on(BBitmap*, ManipulatorInformer* i)
+// The width of the column blocks in error diffusion.
+const int32 kDiffusionBlockWidth = 64;
+
+// A block writes the errors of the next row and reads the errors of its own
+// row. By the time a row writes to a slot of the ring, the row that read the
+// slot before has already passed those columns, so three rows are enough.
+const int32 kErrorRowCount = 3;
+
+
+struct screen_point {
+	float	order;
+	int32	index;
+};
+
+
+static int
+compare_screen_points(const void* a, const void* b)
 {
-	return new Halftone(i);
+	float order_a = ((const screen_point*)a)->order;
+	float order_b = ((const screen_point*)b)->order;
+	if (order_a < order_b)
+		return -1;
+	if (order_a > order_b)
+		return 1;
+
+	return ((const screen_point*)a)->index - ((const screen_point*)b)->index;
 }
 
 
-Halftone::Halftone(ManipulatorInformer* i)
-	:
-	Manipulator(),
-	round_dot_size(ROUND_DOT_SIZE),
-	diagonal_line_size(DIAGONAL_LINE_SIZE),
-	ordered_matrix_size(ORDERED_MATRIX_SIZE),
-	selection(NULL)
-{
-	informer = i;
-	round_dot_pattern[0][0] = 1;
-	round_dot_pattern[0][1] = 8;
-	round_dot_pattern[0][2] = 16;
-	round_dot_pattern[0][3] = 29;
-	round_dot_pattern[0][4] = 25;
-	round_dot_pattern[0][5] = 22;
-	round_dot_pattern[0][6] = 6;
-	round_dot_pattern[0][7] = 2;
-
-	round_dot_pattern[1][0] = 5;
-	round_dot_pattern[1][1] = 12;
-	round_dot_pattern[1][2] = 33;
-	round_dot_pattern[1][3] = 42;
-	round_dot_pattern[1][4] = 46;
-	round_dot_pattern[1][5] = 38;
-	round_dot_pattern[1][6] = 13;
-	round_dot_pattern[1][7] = 9;
-
-	round_dot_pattern[2][0] = 21;
-	round_dot_pattern[2][1] = 37;
-	round_dot_pattern[2][2] = 49;
-	round_dot_pattern[2][3] = 58;
-	round_dot_pattern[2][4] = 54;
-	round_dot_pattern[2][5] = 50;
-	round_dot_pattern[2][6] = 34;
-	round_dot_pattern[2][7] = 17;
-
-	round_dot_pattern[3][0] = 24;
-	round_dot_pattern[3][1] = 45;
-	round_dot_pattern[3][2] = 53;
-	round_dot_pattern[3][3] = 62;
-	round_dot_pattern[3][4] = 63;
-	round_dot_pattern[3][5] = 59;
-	round_dot_pattern[3][6] = 43;
-	round_dot_pattern[3][7] = 30;
-
-	round_dot_pattern[4][0] = 28;
-	round_dot_pattern[4][1] = 41;
-	round_dot_pattern[4][2] = 57;
-	round_dot_pattern[4][3] = 61;
-	round_dot_pattern[4][4] = 60;
-	round_dot_pattern[4][5] = 55;
-	round_dot_pattern[4][6] = 47;
-	round_dot_pattern[4][7] = 26;
-
-	round_dot_pattern[5][0] = 19;
-	round_dot_pattern[5][1] = 32;
-	round_dot_pattern[5][2] = 48;
-	round_dot_pattern[5][3] = 52;
-	round_dot_pattern[5][4] = 56;
-	round_dot_pattern[5][5] = 51;
-	round_dot_pattern[5][6] = 39;
-	round_dot_pattern[5][7] = 23;
-
-	round_dot_pattern[6][0] = 11;
-	round_dot_pattern[6][1] = 15;
-	round_dot_pattern[6][2] = 36;
-	round_dot_pattern[6][3] = 44;
-	round_dot_pattern[6][4] = 40;
-	round_dot_pattern[6][5] = 35;
-	round_dot_pattern[6][6] = 14;
-	round_dot_pattern[6][7] = 7;
-
-	round_dot_pattern[7][0] = 0;
-	round_dot_pattern[7][1] = 4;
-	round_dot_pattern[7][2] = 20;
-	round_dot_pattern[7][3] = 27;
-	round_dot_pattern[7][4] = 31;
-	round_dot_pattern[7][5] = 18;
-	round_dot_pattern[7][6] = 10;
-	round_dot_pattern[7][7] = 3;
-
-
-	diagonal_line_pattern[2][2] = 24;
-	diagonal_line_pattern[1][3] = 23;
-	diagonal_line_pattern[3][1] = 22;
-	diagonal_line_pattern[0][4] = 21;
-	diagonal_line_pattern[4][0] = 20;
-
-	diagonal_line_pattern[1][0] = 19;
-	diagonal_line_pattern[0][1] = 18;
-
-	diagonal_line_pattern[4][3] = 17;
-	diagonal_line_pattern[3][4] = 16;
-
-	diagonal_line_pattern[1][1] = 15;
-	diagonal_line_pattern[0][2] = 14;
-	diagonal_line_pattern[2][0] = 13;
-
-	diagonal_line_pattern[3][3] = 12;
-	diagonal_line_pattern[2][4] = 11;
-	diagonal_line_pattern[4][2] = 10;
-
-	diagonal_line_pattern[2][1] = 9;
-	diagonal_line_pattern[1][2] = 8;
-	diagonal_line_pattern[3][0] = 7;
-	diagonal_line_pattern[0][3] = 6;
-
-	diagonal_line_pattern[3][2] = 5;
-	diagonal_line_pattern[2][3] = 4;
-	diagonal_line_pattern[4][1] = 3;
-	diagonal_line_pattern[1][4] = 2;
-
-	diagonal_line_pattern[0][0] = 1;
-	diagonal_line_pattern[4][4] = 0;
-
-	ordered_matrix[0][0] = 0;
-	ordered_matrix[0][1] = 8;
-	ordered_matrix[0][2] = 2;
-	ordered_matrix[0][3] = 10;
-
-	ordered_matrix[1][0] = 12;
-	ordered_matrix[1][1] = 4;
-	ordered_matrix[1][2] = 14;
-	ordered_matrix[1][3] = 16;
-
-	ordered_matrix[2][0] = 3;
-	ordered_matrix[2][1] = 11;
-	ordered_matrix[2][2] = 1;
-	ordered_matrix[2][3] = 9;
-
-	ordered_matrix[3][0] = 15;
-	ordered_matrix[3][1] = 7;
-	ordered_matrix[3][2] = 13;
-	ordered_matrix[3][3] = 5;
-}
-
-
-Halftone::~Halftone()
+static int32
+greatest_common_divisor(int32 a, int32 b)
 {
-	delete informer;
+	while (b != 0) {
+		int32 remainder = a % b;
+		a = b;
+		b = remainder;
+	}
+	return a;
 }
 
 
-BBitmap*
-Halftone::ManipulateBitmap(BBitmap* original, BStatusBar* status_bar)
+Manipulator*
+instantiate_add_on(BBitmap* bm, ManipulatorInformer* i)
 {
-	return round_dot_halftone(original, selection, status_bar);
+	return new HalftoneManipulator(bm, i);
 }
 
 
-const char*
-Halftone::ReturnHelpString()
+HalftoneManipulator::HalftoneManipulator(BBitmap* bm, ManipulatorInformer* i)
+	:
+	WindowGUIManipulator(),
+	selection(NULL)
 {
-	return B_TRANSLATE("Makes a halftone-pattern with fore- and background colors.");
+	preview_bitmap = NULL;
+	copy_of_the_preview_bitmap = NULL;
+	config_view = NULL;
+
+	informer = i;
+
+	threshold_tile = NULL;
+	tile_size = 0;
+
+	error_rows = NULL;
+	right_errors = NULL;
+
+	previous_settings.cell_size = settings.cell_size + 1;
+
+	SetPreviewBitmap(bm);
 }
 
 
-const char*
-Halftone::ReturnName()
+HalftoneManipulator::~HalftoneManipulator()
 {
-	return B_TRANSLATE("Halftone");
+	delete copy_of_the_preview_bitmap;
+	delete config_view;
+	delete[] threshold_tile;
+	delete informer;
 }
 
 
 BBitmap*
-Halftone::round_dot_halftone(BBitmap* original, Selection* selection, BStatusBar* status_bar)
+HalftoneManipulator::ManipulateBitmap(ManipulatorSettings* set, BBitmap* original,
+	BStatusBar* status_bar)
 {
+	HalftoneManipulatorSettings* new_settings
+		= dynamic_cast<HalftoneManipulatorSettings*>(set);
+
+	if (new_settings == NULL)
+		return NULL;
+
 	if (original == NULL)
 		return NULL;
 
-	uint32* source_bits = (uint32*)original->Bits();
-	int32 source_bpr = original->BytesPerRow() / 4;
-	int32 top, bottom, left, right;
+	if (original == preview_bitmap) {
+		if ((*new_settings == previous_settings) && (last_calculated_resolution <= 1))
+			return original;
 
-	left = original->Bounds().left;
-	right = original->Bounds().right + 1;
-	top = original->Bounds().top;
-	bottom = original->Bounds().bottom + 1;
+		source_bitmap = copy_of_the_preview_bitmap;
+		target_bitmap = original;
+	} else {
+		// Every pixel is read before it is written, so the bitmap can be
+		// changed in place.
+		source_bitmap = original;
+		target_bitmap = original;
+	}
 
-	union {
-		uint8 bytes[4];
-		uint32 word;
-	} color, c1, c2;
-	rgb_color c = informer->GetBackgroundColor();
-	c1.bytes[0] = c.blue;
-	c1.bytes[1] = c.green;
-	c1.bytes[2] = c.red;
-	c1.bytes[3] = c.alpha;
-
-	c = informer->GetForegroundColor();
-	c2.bytes[0] = c.blue;
-	c2.bytes[1] = c.green;
-	c2.bytes[2] = c.red;
-	c2.bytes[3] = c.alpha;
-
-	if (selection->IsEmpty()) {
-		// Here handle the whole image.
-		float normalizer = 1.0 / 255.0 * round_dot_size * round_dot_size;
-		for (int32 y = top; y < bottom; y += round_dot_size) {
-			for (int32 x = left; x < right; x += round_dot_size) {
-				int32 r = min_c(x + round_dot_size, right);
-				int32 b = min_c(y + round_dot_size, bottom);
-				uint32* s_delta_bits;
-
-				for (int32 dy = y; dy < b; dy++) {
-					s_delta_bits = source_bits + dy * source_bpr + x;
-					for (int32 dx = x; dx < r; dx++) {
-						color.word = *s_delta_bits;
-						float luminance
-							= color.bytes[0] * .114
-							+ color.bytes[1] * .587
-							+ color.bytes[2] * .299;
-						uint threshold = luminance * normalizer;
-						*s_delta_bits++
-							= (round_dot_pattern[dy - y][dx - x] > threshold ? c1.word : c2.word);
-					}
-				}
+	current_resolution = 1;
+	current_settings = *new_settings;
+	progress_bar = status_bar;
+
+	start_threads();
+
+	return target_bitmap;
+}
+
+
+int32
+HalftoneManipulator::PreviewBitmap(bool full_quality, BRegion* updated_region)
+{
+	progress_bar = NULL;
+	if (settings == previous_settings) {
+		if ((last_calculated_resolution != highest_available_quality)
+			&& (last_calculated_resolution > 0))
+			last_calculated_resolution
+				= max_c(highest_available_quality, floor(last_calculated_resolution / 2.0));
+		else
+			last_calculated_resolution = 0;
+	} else
+		last_calculated_resolution = lowest_available_quality;
+
+	if (full_quality)
+		last_calculated_resolution = min_c(1, last_calculated_resolution);
+
+	previous_settings = settings;
+
+	if (last_calculated_resolution > 0) {
+		current_resolution = last_calculated_resolution;
+		updated_region->Set(preview_bitmap->Bounds());
+
+		target_bitmap = preview_bitmap;
+		source_bitmap = copy_of_the_preview_bitmap;
+		current_settings = settings;
+
+		start_threads();
+	}
+
+	return last_calculated_resolution;
+}
+
+
+void
+HalftoneManipulator::make_threshold_tile()
+{
+	if (threshold_tile != NULL && tile_settings.mode == current_settings.mode
+		&& (current_settings.mode == ORDERED_DITHER_HALFTONE
+			|| (tile_settings.cell_size == current_settings.cell_size
+				&& tile_settings.angle == current_settings.angle)))
+		return;
+
+	delete[] threshold_tile;
+	threshold_tile = NULL;
+	tile_settings = current_settings;
+
+	screen_point* points;
+	if (current_settings.mode == ORDERED_DITHER_HALFTONE) {
+		tile_size = ORDERED_MATRIX_SIZE;
+		points = new (std::nothrow) screen_point[tile_size * tile_size];
+		if (points == NULL)
+			return;
+
+		// The Bayer matrix: each pair of coordinate bits, starting from the
+		// lowest, selects the next digit from the 2x2 matrix.
+		const int32 base[2][2] = { { 0, 2 }, { 3, 1 } };
+		for (int32 y = 0; y < tile_size; y++) {
+			for (int32 x = 0; x < tile_size; x++) {
+				int32 order = 0;
+				for (int32 bit = 1; bit < tile_size; bit <<= 1)
+					order = order * 4 + base[(y & bit) ? 1 : 0][(x & bit) ? 1 : 0];
+
+				points[y * tile_size + x].order = order;
+				points[y * tile_size + x].index = y * tile_size + x;
 			}
 		}
 	} else {
-		// Here handle only those pixels for which selection->ContainsPoint(x,y) is true.
-		float normalizer = 1.0 / 255.0 * round_dot_size * round_dot_size;
-		for (int32 y = top; y < bottom; y += round_dot_size) {
-			for (int32 x = left; x < right; x += round_dot_size) {
-				int32 r = min_c(x + round_dot_size, right);
-				int32 b = min_c(y + round_dot_size, bottom);
-				uint32* s_delta_bits;
-
-				for (int32 dy = y; dy < b; dy++) {
-					s_delta_bits = source_bits + dy * source_bpr + x;
-					for (int32 dx = x; dx < r; dx++) {
-						if (selection->ContainsPoint(dx, dy)) {
-							color.word = *s_delta_bits;
-							float luminance
-								= color.bytes[0] * .114
-								+ color.bytes[1] * .587
-								+ color.bytes[2] * .299;
-							uint threshold = luminance * normalizer;
-							*s_delta_bits = (round_dot_pattern[dy - y][dx - x] > threshold
-								? c1.word : c2.word);
-						}
-						s_delta_bits++;
-					}
-				}
+		// The cells of the screen are squares with the sides (p, q) and
+		// (-q, p). The screen repeats after (p * p + q * q) / gcd(p, q)
+		// pixels both horizontally and vertically.
+		float angle = current_settings.angle * M_PI / 180.0;
+		int32 p = (int32)round(current_settings.cell_size * cos(angle));
+		int32 q = (int32)round(current_settings.cell_size * sin(angle));
+		if (p == 0 && q == 0)
+			p = 1;
+
+		int32 area = p * p + q * q;
+		tile_size = area / greatest_common_divisor(p, q);
+		points = new (std::nothrow) screen_point[tile_size * tile_size];
+		if (points == NULL)
+			return;
+
+		// The position of each pixel center inside its cell is calculated
+		// with integers, in units of 1 / (2 * area), so that the tile
+		// wraps around exactly.
+		int32 unit = 2 * area;
+		for (int32 y = 0; y < tile_size; y++) {
+			for (int32 x = 0; x < tile_size; x++) {
+				int32 u = ((2 * x + 1) * p + (2 * y + 1) * q) % unit;
+				int32 v = ((2 * y + 1) * p - (2 * x + 1) * q) % unit;
+				if (v < 0)
+					v += unit;
+
+				float du = (float)u / unit - 0.5;
+				float dv = (float)v / unit - 0.5;
+
+				// The pixels that get the foreground color first are at the
+				// middle of the dot or of the line.
+				float order;
+				if (current_settings.mode == LINE_HALFTONE)
+					order = -fabs(dv) - 0.001 * fabs(du);
+				else
+					order = -(du * du + dv * dv);
+
+				points[y * tile_size + x].order = order;
+				points[y * tile_size + x].index = y * tile_size + x;
 			}
 		}
 	}
 
-	return original;
-}
+	// The thresholds are evenly spread, so that the share of foreground
+	// pixels follows the luminance.
+	int32 count = tile_size * tile_size;
+	qsort(points, count, sizeof(screen_point), compare_screen_points);
 
+	threshold_tile = new (std::nothrow) uint8[count];
+	if (threshold_tile != NULL) {
+		for (int32 rank = 0; rank < count; rank++)
+			threshold_tile[points[rank].index] = 1 + (int64)rank * 255 / count;
+	}
 
-BBitmap*
-Halftone::diagonal_line_halftone(BBitmap* original, Selection* selection, BStatusBar* status_bar)
-{
-	if (original == NULL)
-		return NULL;
+	delete[] points;
+}
 
-	uint32* source_bits = (uint32*)original->Bits();
-	int32 source_bpr = original->BytesPerRow() / 4;
-	int32 top, bottom, left, right;
 
-	left = original->Bounds().left;
-	right = original->Bounds().right + 1;
-	top = original->Bounds().top;
-	bottom = original->Bounds().bottom + 1;
+void
+HalftoneManipulator::start_threads()
+{
+	rect = target_bitmap->Bounds();
+	if (selection != NULL && selection->IsEmpty() == false)
+		rect = rect & selection->GetBoundingRect();
+	if (rect.IsValid() == false)
+		return;
 
+	// This union must be used to guarantee endianness compatibility.
 	union {
 		uint8 bytes[4];
 		uint32 word;
-	} color, c1, c2;
+	} color;
 	rgb_color c = informer->GetForegroundColor();
-	c1.bytes[0] = c.blue;
-	c1.bytes[1] = c.green;
-	c1.bytes[2] = c.red;
-	c1.bytes[3] = c.alpha;
+	color.bytes[0] = c.blue;
+	color.bytes[1] = c.green;
+	color.bytes[2] = c.red;
+	color.bytes[3] = c.alpha;
+	foreground = color.word;
 
 	c = informer->GetBackgroundColor();
-	c2.bytes[0] = c.blue;
-	c2.bytes[1] = c.green;
-	c2.bytes[2] = c.red;
-	c2.bytes[3] = c.alpha;
-
-	if (selection->IsEmpty()) {
-		// Here handle the whole image.
-		float normalizer = 1.0 / 255.0 * diagonal_line_size * diagonal_line_size;
-		for (int32 y = top; y < bottom; y += diagonal_line_size) {
-			for (int32 x = left; x < right; x += diagonal_line_size) {
-				int32 r = min_c(x + diagonal_line_size, right);
-				int32 b = min_c(y + diagonal_line_size, bottom);
-				uint32* s_delta_bits;
-
-				for (int32 dy = y; dy < b; dy++) {
-					s_delta_bits = source_bits + dy * source_bpr + x;
-					for (int32 dx = x; dx < r; dx++) {
-						color.word = *s_delta_bits;
-						float luminance
-							= color.bytes[0] * .114
-							+ color.bytes[1] * .587
-							+ color.bytes[2] * .299;
-						uint threshold = luminance * normalizer;
-						*s_delta_bits++ = (diagonal_line_pattern[dy - y][dx - x] > threshold
-							? c1.word : c2.word);
-					}
-				}
-			}
-		}
-	} else {
-		// Here handle only those pixels for which selection->ContainsPoint(x,y) is true.
-		float normalizer = 1.0 / 255.0 * diagonal_line_size * diagonal_line_size;
-		for (int32 y = top; y < bottom; y += diagonal_line_size) {
-			for (int32 x = left; x < right; x += diagonal_line_size) {
-				int32 r = min_c(x + diagonal_line_size, right);
-				int32 b = min_c(y + diagonal_line_size, bottom);
-				uint32* s_delta_bits;
-
-				for (int32 dy = y; dy < b; dy++) {
-					s_delta_bits = source_bits + dy * source_bpr + x;
-					for (int32 dx = x; dx < r; dx++) {
-						if (selection->ContainsPoint(dx, dy)) {
-							color.word = *s_delta_bits;
-							float luminance
-								= color.bytes[0] * .114
-								+ color.bytes[1] * .587
-								+ color.bytes[2] * .299;
-							uint threshold = luminance * normalizer;
-							*s_delta_bits = (diagonal_line_pattern[dy - y][dx - x] > threshold
-								? c1.word : c2.word);
-						}
-						s_delta_bits++;
-					}
-				}
-			}
-		}
+	color.bytes[0] = c.blue;
+	color.bytes[1] = c.green;
+	color.bytes[2] = c.red;
+	color.bytes[3] = c.alpha;
+	background = color.word;
+
+	// Only every current_resolution'th row is calculated.
+	int32 row_count = ((int32)rect.bottom - (int32)rect.top) / current_resolution + 1;
+
+	switch (current_settings.mode) {
+		case FS_DITHER_HALFTONE:
+			fs_dither();
+			break;
+		case N_CANDIDATE_DITHER_HALFTONE:
+			ParallelFor(0, row_count, n_candidate_entry, this, progress_bar);
+			break;
+		default:
+			make_threshold_tile();
+			if (threshold_tile != NULL)
+				ParallelFor(0, row_count, threshold_entry, this, progress_bar);
+			break;
 	}
+}
 
-	return original;
+
+void
+HalftoneManipulator::threshold_entry(void* data, int32 first_row, int32 last_row)
+{
+	HalftoneManipulator* this_pointer = (HalftoneManipulator*)data;
+	this_pointer->threshold_rows(first_row, last_row);
 }
 
 
-BBitmap*
-Halftone::ordered_dither_halftone(BBitmap* original, Selection* selection, BStatusBar* status_bar)
+void
+HalftoneManipulator::threshold_rows(int32 first_row, int32 last_row)
 {
-	if (original == NULL)
-		return NULL;
+	int32 step = current_resolution;
+
+	uint32* source_bits = (uint32*)source_bitmap->Bits();
+	uint32* target_bits = (uint32*)target_bitmap->Bits();
+	int32 source_bpr = source_bitmap->BytesPerRow() / 4;
+	int32 target_bpr = target_bitmap->BytesPerRow() / 4;
 
-	uint32* source_bits = (uint32*)original->Bits();
-	int32 source_bpr = original->BytesPerRow() / 4;
-	int32 top, bottom, left, right;
+	bool use_selection = (selection != NULL) && (selection->IsEmpty() == false);
 
-	left = original->Bounds().left;
-	right = original->Bounds().right + 1;
-	top = original->Bounds().top;
-	bottom = original->Bounds().bottom + 1;
+	int32 left = rect.left;
+	int32 right = rect.right;
+	int32 top = (int32)rect.top + first_row * step;
+	int32 bottom = (int32)rect.top + (last_row - 1) * step;
 
 	union {
 		uint8 bytes[4];
 		uint32 word;
-	} color, c1, c2;
-	rgb_color c = informer->GetForegroundColor();
-	c1.bytes[0] = c.blue;
-	c1.bytes[1] = c.green;
-	c1.bytes[2] = c.red;
-	c1.bytes[3] = c.alpha;
-
-	c = informer->GetBackgroundColor();
-	c2.bytes[0] = c.blue;
-	c2.bytes[1] = c.green;
-	c2.bytes[2] = c.red;
-	c2.bytes[3] = c.alpha;
-
-	if (selection->IsEmpty()) {
-		// Here handle the whole image.
-		float normalizer = 1.0 / 255.0 * ordered_matrix_size * ordered_matrix_size;
-		for (int32 y = top; y < bottom; y += ordered_matrix_size) {
-			for (int32 x = left; x < right; x += ordered_matrix_size) {
-				int32 r = min_c(x + ordered_matrix_size, right);
-				int32 b = min_c(y + ordered_matrix_size, bottom);
-				uint32* s_delta_bits;
-
-				for (int32 dy = y; dy < b; dy++) {
-					s_delta_bits = source_bits + dy * source_bpr + x;
-					for (int32 dx = x; dx < r; dx++) {
-						color.word = *s_delta_bits;
-						float luminance
-							= color.bytes[0] * .114
-							+ color.bytes[1] * .587
-							+ color.bytes[2] * .299;
-						uint threshold = luminance * normalizer;
-						*s_delta_bits++ = (ordered_matrix[dy - y][dx - x] > threshold
-							? c1.word : c2.word);
-					}
-				}
+	} color;
+
+	for (int32 y = top; y <= bottom; y += step) {
+		const uint32* source = source_bits + y * source_bpr;
+		uint32* target = target_bits + y * target_bpr;
+		const uint8* thresholds = threshold_tile + (y % tile_size) * tile_size;
+
+		if (use_selection || step > 1) {
+			for (int32 x = left; x <= right; x += step) {
+				if (use_selection && selection->ContainsPoint(x, y) == false)
+					continue;
+
+				color.word = source[x];
+				int32 luminance
+					= (color.bytes[0] * 29 + color.bytes[1] * 150 + color.bytes[2] * 77) >> 8;
+				target[x] = luminance < thresholds[x % tile_size] ? foreground : background;
 			}
+			continue;
 		}
-	} else {
-		// Here handle only those pixels for which selection->ContainsPoint(x,y) is true.
-		float normalizer = 1.0 / 255.0 * ordered_matrix_size * ordered_matrix_size;
-		for (int32 y = top; y < bottom; y += ordered_matrix_size) {
-			for (int32 x = left; x < right; x += ordered_matrix_size) {
-				int32 r = min_c(x + ordered_matrix_size, right);
-				int32 b = min_c(y + ordered_matrix_size, bottom);
-				uint32* s_delta_bits;
-
-				for (int32 dy = y; dy < b; dy++) {
-					s_delta_bits = source_bits + dy * source_bpr + x;
-					for (int32 dx = x; dx < r; dx++) {
-						if (selection->ContainsPoint(dx, dy)) {
-							color.word = *s_delta_bits;
-							float luminance
-								= color.bytes[0] * .114
-								+ color.bytes[1] * .587
-								+ color.bytes[2] * .299;
-							uint threshold = luminance * normalizer;
-							*s_delta_bits = (ordered_matrix[dy - y][dx - x] > threshold
-								? c1.word : c2.word);
-						}
-						s_delta_bits++;
-					}
-				}
+
+		// The row is handled in pieces that do not wrap around the tile.
+		// The loop has no branches, so that the compiler can vectorize it.
+		int32 x = left;
+		while (x <= right) {
+			int32 tile_x = x % tile_size;
+			int32 length = min_c(tile_size - tile_x, right - x + 1);
+			const uint32* s = source + x;
+			uint32* t = target + x;
+			const uint8* threshold = thresholds + tile_x;
+			for (int32 i = 0; i < length; i++) {
+				color.word = s[i];
+				int32 luminance
+					= (color.bytes[0] * 29 + color.bytes[1] * 150 + color.bytes[2] * 77) >> 8;
+				uint32 mask = -(uint32)(luminance < threshold[i]);
+				t[i] = (foreground & mask) | (background & ~mask);
 			}
+			x += length;
 		}
 	}
-
-	return original;
 }
 
 
-BBitmap*
-Halftone::fs_dither_halftone(BBitmap* original, Selection* selection, BStatusBar* status_bar)
+void
+HalftoneManipulator::n_candidate_entry(void* data, int32 first_row, int32 last_row)
 {
-	if (original == NULL)
-		return NULL;
+	HalftoneManipulator* this_pointer = (HalftoneManipulator*)data;
+	this_pointer->n_candidate_rows(first_row, last_row);
+}
+
 
-	uint32* source_bits = (uint32*)original->Bits();
-	int32 source_bpr = original->BytesPerRow() / 4;
-	int32 top, bottom, left, right;
+void
+HalftoneManipulator::n_candidate_rows(int32 first_row, int32 last_row)
+{
+	int32 step = current_resolution;
 
-	left = original->Bounds().left;
-	right = original->Bounds().right + 1;
-	top = original->Bounds().top;
-	bottom = original->Bounds().bottom + 1;
+	uint32* source_bits = (uint32*)source_bitmap->Bits();
+	uint32* target_bits = (uint32*)target_bitmap->Bits();
+	int32 source_bpr = source_bitmap->BytesPerRow() / 4;
+	int32 target_bpr = target_bitmap->BytesPerRow() / 4;
+	int32 width = source_bitmap->Bounds().IntegerWidth() + 1;
 
-	float* errors = new float[right - left + 3];
-	for (int32 i = 0; i < right - left + 3; i++)
-		errors[i] = 0;
+	bool use_selection = (selection != NULL) && (selection->IsEmpty() == false);
 
-	float right_error = 0;
+	int32 left = rect.left;
+	int32 right = rect.right;
+	int32 top = (int32)rect.top + first_row * step;
+	int32 bottom = (int32)rect.top + (last_row - 1) * step;
 
 	union {
 		uint8 bytes[4];
 		uint32 word;
-	} color, c1, c2;
-	rgb_color c = informer->GetForegroundColor();
-	c1.bytes[0] = c.blue;
-	c1.bytes[1] = c.green;
-	c1.bytes[2] = c.red;
-	c1.bytes[3] = c.alpha;
-
-	c = informer->GetBackgroundColor();
-	c2.bytes[0] = c.blue;
-	c2.bytes[1] = c.green;
-	c2.bytes[2] = c.red;
-	c2.bytes[3] = c.alpha;
-
-	if (selection->IsEmpty()) {
-		// Here handle the whole image.
-		for (int32 y = top; y < bottom; y++) {
-			for (int32 x = left; x < right; x++) {
-				color.word = *source_bits;
-				float threshold
-					= color.bytes[0] * .114
-					+ color.bytes[1] * .587
-					+ color.bytes[2] * .299;
-				float value = min_c(255, max_c(threshold + right_error + errors[x + 1], 0));
-				errors[x + 1] = 0;
-				float error;
-				if (value > 127) {
-					error = -(255 - value);
-					*source_bits++ = c2.word;
-				} else {
-					error = -(0 - value);
-					*source_bits++ = c1.word;
-				}
-				right_error = .4375 * error;
-				errors[x] += .1875 * error;
-				errors[x + 1] += .3125 * error;
-				errors[x + 2] += .0625 * error;
-			}
+	} color;
+
+	for (int32 y = top; y <= bottom; y += step) {
+		// The noise depends on the position of the pixel in the image, so
+		// the rows can be processed in any order and the preview shows the
+		// same pattern as the final image.
+		RandomNumberGenerator generator(1027 + y * width, 1000000);
+
+		const uint32* source = source_bits + y * source_bpr;
+		uint32* target = target_bits + y * target_bpr;
+		for (int32 x = 0; x <= right; x++) {
+			float r = generator.UniformDistribution(0.0, 1.0);
+			if (x < left || (x - left) % step != 0)
+				continue;
+
+			if (use_selection && selection->ContainsPoint(x, y) == false)
+				continue;
+
+			color.word = source[x];
+			int32 luminance
+				= (color.bytes[0] * 29 + color.bytes[1] * 150 + color.bytes[2] * 77) >> 8;
+
+			// The probability to get the background color.
+			if (luminance / 256.0 >= r)
+				target[x] = background;
+			else
+				target[x] = foreground;
 		}
-	} else {
-		// Here handle only those pixels for which selection->ContainsPoint(x,y) is true.
-		float normalizer = 1.0 / 255.0 * ordered_matrix_size * ordered_matrix_size;
-		for (int32 y = top; y < bottom; y += ordered_matrix_size) {
-			for (int32 x = left; x < right; x += ordered_matrix_size) {
-				int32 r = min_c(x + ordered_matrix_size, right);
-				int32 b = min_c(y + ordered_matrix_size, bottom);
-				uint32* s_delta_bits;
-
-				for (int32 dy = y; dy < b; dy++) {
-					s_delta_bits = source_bits + dy * source_bpr + x;
-					for (int32 dx = x; dx < r; dx++) {
-						if (selection->ContainsPoint(dx, dy)) {
-							color.word = *s_delta_bits;
-							float luminance
-								= color.bytes[0] * .114
-								+ color.bytes[1] * .587
-								+ color.bytes[2] * .299;
-							uint threshold = luminance * normalizer;
-							*s_delta_bits = (ordered_matrix[dy - y][dx - x] > threshold
-								? c1.word : c2.word);
-						}
-						s_delta_bits++;
-					}
-				}
-			}
+	}
+}
+
+
+void
+HalftoneManipulator::fs_dither()
+{
+	int32 step = current_resolution;
+	int32 column_count = ((int32)rect.right - (int32)rect.left) / step + 1;
+	int32 row_count = ((int32)rect.bottom - (int32)rect.top) / step + 1;
+	int32 block_count = (column_count + kDiffusionBlockWidth - 1) / kDiffusionBlockWidth;
+
+	// The rows have an extra element on both sides for the errors that
+	// spread over the edges.
+	error_row_length = column_count + 2;
+	error_rows = new (std::nothrow) float[kErrorRowCount * error_row_length];
+	right_errors = new (std::nothrow) float[row_count];
+	if (error_rows != NULL && right_errors != NULL) {
+		memset(error_rows, 0, kErrorRowCount * error_row_length * sizeof(float));
+
+		// The block (row, block) is processed at the time 2 * row + block,
+		// after the block on its left and the blocks above it.
+		int32 last_time = 2 * (row_count - 1) + block_count - 1;
+		float progress_per_block = 100.0 / (row_count * block_count);
+		for (int32 time = 0; time <= last_time; time++) {
+			first_block = max_c(0, time - 2 * (row_count - 1));
+			if (((time - first_block) & 1) != 0)
+				first_block++;
+			int32 last_block = min_c(block_count - 1, time);
+			if (first_block > last_block)
+				continue;
+
+			diffusion_time = time;
+			int32 count = (last_block - first_block) / 2 + 1;
+			if (ParallelFor(0, count, diffusion_entry, this, progress_bar,
+					count * progress_per_block) != B_OK)
+				break;
 		}
 	}
 
-	delete[] errors;
+	delete[] error_rows;
+	delete[] right_errors;
+	error_rows = NULL;
+	right_errors = NULL;
+}
 
-	return original;
+
+void
+HalftoneManipulator::diffusion_entry(void* data, int32 first, int32 last)
+{
+	HalftoneManipulator* this_pointer = (HalftoneManipulator*)data;
+	for (int32 i = first; i < last; i++) {
+		int32 block = this_pointer->first_block + 2 * i;
+		this_pointer->diffuse_block((this_pointer->diffusion_time - block) / 2, block);
+	}
 }
 
 
-BBitmap*
-Halftone::ncandidate_dither_halftone(
-	BBitmap* original, Selection* selection, BStatusBar* status_bar)
+void
+HalftoneManipulator::diffuse_block(int32 row, int32 block)
 {
-	if (original == NULL)
-		return NULL;
+	int32 step = current_resolution;
+
+	uint32* source = (uint32*)source_bitmap->Bits();
+	uint32* target = (uint32*)target_bitmap->Bits();
+	int32 y = (int32)rect.top + row * step;
+	source += y * (source_bitmap->BytesPerRow() / 4);
+	target += y * (target_bitmap->BytesPerRow() / 4);
+
+	bool use_selection = (selection != NULL) && (selection->IsEmpty() == false);
 
-	uint32* source_bits = (uint32*)original->Bits();
-	int32 source_bpr = original->BytesPerRow() / 4;
-	int32 top, bottom, left, right;
+	float* errors = error_rows + (row % kErrorRowCount) * error_row_length + 1;
+	float* next_errors = error_rows + ((row + 1) % kErrorRowCount) * error_row_length + 1;
 
-	left = original->Bounds().left;
-	right = original->Bounds().right + 1;
-	top = original->Bounds().top;
-	bottom = original->Bounds().bottom + 1;
+	int32 first_column = block * kDiffusionBlockWidth;
+	int32 last_column = min_c(first_column + kDiffusionBlockWidth, error_row_length - 2) - 1;
 
-	float* errors = new float[right - left + 3];
-	for (int32 i = 0; i < right - left + 3; i++)
-		errors[i] = 0;
+	float right_error = (block > 0 ? right_errors[row] : 0);
 
 	union {
 		uint8 bytes[4];
 		uint32 word;
-	} color, c1, c2;
-	rgb_color c = informer->GetForegroundColor();
-	c1.bytes[0] = c.blue;
-	c1.bytes[1] = c.green;
-	c1.bytes[2] = c.red;
-	c1.bytes[3] = c.alpha;
+	} color;
 
-	c = informer->GetBackgroundColor();
-	c2.bytes[0] = c.blue;
-	c2.bytes[1] = c.green;
-	c2.bytes[2] = c.red;
-	c2.bytes[3] = c.alpha;
-
-	float probs[256];
-	for (int32 i = 0; i < 256; i++)
-		probs[i] = (float)i / 256.0; // probability to get white
-
-	RandomNumberGenerator* generator = new RandomNumberGenerator(1027, 1000000);
-	if (selection->IsEmpty()) {
-		// Here handle the whole image.
-		for (int32 y = top; y < bottom; y++) {
-			for (int32 x = left; x < right; x++) {
-				color.word = *source_bits;
-				int32 threshold
-					= color.bytes[0] * .114
-					+ color.bytes[1] * .587
-					+ color.bytes[2] * .299;
-				float r = generator->UniformDistribution(0.0, 1.0);
-				if (probs[threshold] >= r)
-					*source_bits++ = c2.word;
-				else
-					*source_bits++ = c1.word;
-			}
+	for (int32 column = first_column; column <= last_column; column++) {
+		int32 x = (int32)rect.left + column * step;
+
+		// The errors are cleared when they are used, so that the row is
+		// empty when it is written to again.
+		float below_error = errors[column];
+		errors[column] = 0;
+
+		if (use_selection && selection->ContainsPoint(x, y) == false) {
+			right_error = 0;
+			continue;
 		}
+
+		color.word = source[x];
+		float luminance
+			= color.bytes[0] * .114
+			+ color.bytes[1] * .587
+			+ color.bytes[2] * .299;
+		float value = min_c(255, max_c(luminance + right_error + below_error, 0));
+		float error;
+		if (value > 127) {
+			error = value - 255;
+			target[x] = background;
+		} else {
+			error = value;
+			target[x] = foreground;
+		}
+		right_error = .4375 * error;
+		next_errors[column - 1] += .1875 * error;
+		next_errors[column] += .3125 * error;
+		next_errors[column + 1] += .0625 * error;
+	}
+
+	right_errors[row] = right_error;
+}
+
+
+void
+HalftoneManipulator::SetPreviewBitmap(BBitmap* bm)
+{
+	if (preview_bitmap != bm) {
+		delete copy_of_the_preview_bitmap;
+
+		if (bm != NULL) {
+			preview_bitmap = bm;
+			copy_of_the_preview_bitmap = DuplicateBitmap(bm, 0);
+		} else {
+			preview_bitmap = NULL;
+			copy_of_the_preview_bitmap = NULL;
+		}
+
+		previous_settings.cell_size = settings.cell_size + 1;
+	}
+
+	if (preview_bitmap != NULL) {
+		// Let's select a resolution that can handle all the pixels at least
+		// 10 times in a second while assuming that one pixel calculation takes
+		// about 20 CPU cycles.
+		double speed = GetSystemClockSpeed() / (10 * 20);
+		BRect bounds = preview_bitmap->Bounds();
+		float num_pixels = (bounds.Width() + 1) * (bounds.Height() + 1);
+		lowest_available_quality = 1;
+		while ((num_pixels / lowest_available_quality / lowest_available_quality) > speed)
+			lowest_available_quality *= 2;
+
+		lowest_available_quality = min_c(lowest_available_quality, 16);
+		highest_available_quality = max_c(lowest_available_quality / 2, 1);
 	} else {
-		// Here handle only those pixels for which selection->ContainsPoint(x,y) is true.
-		float normalizer = 1.0 / 255.0 * ordered_matrix_size * ordered_matrix_size;
-		for (int32 y = top; y < bottom; y += ordered_matrix_size) {
-			for (int32 x = left; x < right; x += ordered_matrix_size) {
-				int32 r = min_c(x + ordered_matrix_size, right);
-				int32 b = min_c(y + ordered_matrix_size, bottom);
-				uint32* s_delta_bits;
-
-				for (int32 dy = y; dy < b; dy++) {
-					s_delta_bits = source_bits + dy * source_bpr + x;
-					for (int32 dx = x; dx < r; dx++) {
-						if (selection->ContainsPoint(dx, dy)) {
-							color.word = *s_delta_bits;
-							float luminance
-								= color.bytes[0] * .114
-								+ color.bytes[1] * .587
-								+ color.bytes[2] * .299;
-							uint threshold = luminance * normalizer;
-							*s_delta_bits = (ordered_matrix[dy - y][dx - x] > threshold
-								? c1.word : c2.word);
-						}
-						s_delta_bits++;
-					}
-				}
+		lowest_available_quality = 1;
+		highest_available_quality = 1;
+	}
+	last_calculated_resolution = lowest_available_quality;
+}
+
+
+void
+HalftoneManipulator::Reset()
+{
+	if (copy_of_the_preview_bitmap != NULL) {
+		uint32* source = (uint32*)copy_of_the_preview_bitmap->Bits();
+		uint32* target = (uint32*)preview_bitmap->Bits();
+		uint32 bits_length = preview_bitmap->BitsLength();
+
+		memcpy(target, source, bits_length);
+	}
+}
+
+
+BView*
+HalftoneManipulator::MakeConfigurationView(const BMessenger& target)
+{
+	if (config_view == NULL) {
+		config_view = new HalftoneManipulatorView(this, target);
+		config_view->ChangeSettings(&settings);
+	}
+
+	return config_view;
+}
+
+
+ManipulatorSettings*
+HalftoneManipulator::ReturnSettings()
+{
+	return new HalftoneManipulatorSettings(settings);
+}
+
+
+void
+HalftoneManipulator::ChangeSettings(ManipulatorSettings* s)
+{
+	HalftoneManipulatorSettings* new_settings = dynamic_cast<HalftoneManipulatorSettings*>(s);
+	if (new_settings != NULL)
+		settings = *new_settings;
+}
+
+
+status_t
+HalftoneManipulator::ReadSettings(BNode* node)
+{
+	if (node == NULL)
+		return B_ERROR;
+
+	int32 new_mode;
+	int32 new_cell_size;
+	int32 new_angle;
+	if (node->ReadAttr("halftone_mode", B_INT32_TYPE, 0, &new_mode, sizeof(int32))
+			!= sizeof(int32)
+		|| node->ReadAttr("halftone_cell_size", B_INT32_TYPE, 0, &new_cell_size,
+			sizeof(int32)) != sizeof(int32)
+		|| node->ReadAttr("halftone_angle", B_INT32_TYPE, 0, &new_angle, sizeof(int32))
+			!= sizeof(int32))
+		return B_ERROR;
+
+	settings.mode = min_c(max_c(new_mode, ROUND_DOT_HALFTONE), N_CANDIDATE_DITHER_HALFTONE);
+	settings.cell_size
+		= min_c(max_c(new_cell_size, MIN_HALFTONE_CELL_SIZE), MAX_HALFTONE_CELL_SIZE);
+	settings.angle = min_c(max_c(new_angle, 0), MAX_HALFTONE_ANGLE);
+	previous_settings.cell_size = settings.cell_size + 1;
+	return B_OK;
+}
+
+
+status_t
+HalftoneManipulator::WriteSettings(BNode* node)
+{
+	if (node == NULL)
+		return B_ERROR;
+
+	if (node->WriteAttr("halftone_mode", B_INT32_TYPE, 0, &settings.mode, sizeof(int32))
+			!= sizeof(int32)
+		|| node->WriteAttr("halftone_cell_size", B_INT32_TYPE, 0, &settings.cell_size,
+			sizeof(int32)) != sizeof(int32)
+		|| node->WriteAttr("halftone_angle", B_INT32_TYPE, 0, &settings.angle,
+			sizeof(int32)) != sizeof(int32))
+		return B_ERROR;
+
+	return B_OK;
+}
+
+
+const char*
+HalftoneManipulator::ReturnHelpString()
+{
+	return B_TRANSLATE("Makes a halftone-pattern with fore- and background colors.");
+}
+
+
+const char*
+HalftoneManipulator::ReturnName()
+{
+	return B_TRANSLATE("Halftone");
+}
+
+
+HalftoneManipulatorView::HalftoneManipulatorView(HalftoneManipulator* manip,
+	const BMessenger& t)
+	:
+	WindowGUIManipulatorView()
+{
+	target = t;
+	manipulator = manip;
+	started_adjusting = FALSE;
+
+	BMenu* mode_menu = new BPopUpMenu("SELECT");
+
+	BMessage* message;
+	message = new BMessage(HALFTONE_MODE_CHANGED);
+	message->AddInt32("mode", ROUND_DOT_HALFTONE);
+	mode_menu->AddItem(new BMenuItem(B_TRANSLATE("Round dots"), message));
+
+	message = new BMessage(HALFTONE_MODE_CHANGED);
+	message->AddInt32("mode", LINE_HALFTONE);
+	mode_menu->AddItem(new BMenuItem(B_TRANSLATE("Lines"), message));
+
+	message = new BMessage(HALFTONE_MODE_CHANGED);
+	message->AddInt32("mode", ORDERED_DITHER_HALFTONE);
+	mode_menu->AddItem(new BMenuItem(B_TRANSLATE("Ordered dither"), message));
+
+	message = new BMessage(HALFTONE_MODE_CHANGED);
+	message->AddInt32("mode", FS_DITHER_HALFTONE);
+	mode_menu->AddItem(new BMenuItem(B_TRANSLATE("Floyd-Steinberg"), message));
+
+	message = new BMessage(HALFTONE_MODE_CHANGED);
+	message->AddInt32("mode", N_CANDIDATE_DITHER_HALFTONE);
+	mode_menu->AddItem(new BMenuItem(B_TRANSLATE("N-Candidate"), message));
+
+	mode_menu_field = new BMenuField("mode_menu_field", B_TRANSLATE("Pattern:"), mode_menu);
+
+	size_slider = new BSlider("size_slider", B_TRANSLATE("Cell size:"),
+		new BMessage(HALFTONE_SIZE_ADJUSTING_FINISHED), MIN_HALFTONE_CELL_SIZE,
+		MAX_HALFTONE_CELL_SIZE, B_HORIZONTAL, B_TRIANGLE_THUMB);
+	size_slider->SetModificationMessage(new BMessage(HALFTONE_SIZE_ADJUSTED));
+	size_slider->SetLimitLabels(B_TRANSLATE("Small"), B_TRANSLATE("Large"));
+	size_slider->SetHashMarks(B_HASH_MARKS_BOTTOM);
+	size_slider->SetHashMarkCount(MAX_HALFTONE_CELL_SIZE - MIN_HALFTONE_CELL_SIZE + 1);
+
+	angle_slider = new BSlider("angle_slider", B_TRANSLATE("Angle:"),
+		new BMessage(HALFTONE_ANGLE_ADJUSTING_FINISHED), 0, MAX_HALFTONE_ANGLE,
+		B_HORIZONTAL, B_TRIANGLE_THUMB);
+	angle_slider->SetModificationMessage(new BMessage(HALFTONE_ANGLE_ADJUSTED));
+	angle_slider->SetLimitLabels("0°", "90°");
+	angle_slider->SetHashMarks(B_HASH_MARKS_BOTTOM);
+	angle_slider->SetHashMarkCount(7);
+
+	BLayoutBuilder::Group<>(this, B_VERTICAL, B_USE_ITEM_SPACING)
+		.AddGrid(B_USE_DEFAULT_SPACING, B_USE_SMALL_SPACING)
+			.Add(mode_menu_field->CreateLabelLayoutItem(), 0, 0)
+			.Add(mode_menu_field->CreateMenuBarLayoutItem(), 1, 0)
+		.End()
+		.Add(size_slider)
+		.Add(angle_slider)
+		.SetInsets(B_USE_SMALL_INSETS)
+	.End();
+}
+
+
+void
+HalftoneManipulatorView::AttachedToWindow()
+{
+	WindowGUIManipulatorView::AttachedToWindow();
+	size_slider->SetTarget(BMessenger(this));
+	angle_slider->SetTarget(BMessenger(this));
+}
+
+
+void
+HalftoneManipulatorView::AllAttached()
+{
+	mode_menu_field->Menu()->SetTargetForItems(this);
+	update_controls();
+}
+
+
+void
+HalftoneManipulatorView::MessageReceived(BMessage* message)
+{
+	switch (message->what) {
+		case HALFTONE_MODE_CHANGED:
+		{
+			int32 mode;
+			if (message->FindInt32("mode", &mode) == B_OK) {
+				settings.mode = mode;
+				manipulator->ChangeSettings(&settings);
+				update_controls();
+				target.SendMessage(HS_MANIPULATOR_ADJUSTING_FINISHED);
 			}
-		}
+		} break;
+		case HALFTONE_SIZE_ADJUSTED:
+		case HALFTONE_ANGLE_ADJUSTED:
+		{
+			settings.cell_size = size_slider->Value();
+			settings.angle = angle_slider->Value();
+			manipulator->ChangeSettings(&settings);
+			if (!started_adjusting) {
+				target.SendMessage(HS_MANIPULATOR_ADJUSTING_STARTED);
+				started_adjusting = TRUE;
+			}
+		} break;
+		case HALFTONE_SIZE_ADJUSTING_FINISHED:
+		case HALFTONE_ANGLE_ADJUSTING_FINISHED:
+		{
+			started_adjusting = FALSE;
+			settings.cell_size = size_slider->Value();
+			settings.angle = angle_slider->Value();
+			manipulator->ChangeSettings(&settings);
+			target.SendMessage(HS_MANIPULATOR_ADJUSTING_FINISHED);
+		} break;
+		default:
+			WindowGUIManipulatorView::MessageReceived(message);
 	}
-	delete generator;
-	return original;
+}
+
+
+void
+HalftoneManipulatorView::ChangeSettings(ManipulatorSettings* set)
+{
+	HalftoneManipulatorSettings* new_settings
+		= dynamic_cast<HalftoneManipulatorSettings*>(set);
+
+	if (new_settings != NULL) {
+		settings = *new_settings;
+
+		BWindow* window = Window();
+		if (window != NULL) {
+			window->Lock();
+			update_controls();
+			window->Unlock();
+		} else
+			update_controls();
+	}
+}
+
+
+void
+HalftoneManipulatorView::update_controls()
+{
+	BMenuItem* item = mode_menu_field->Menu()->ItemAt(settings.mode);
+	if (item != NULL)
+		item->SetMarked(true);
+
+	size_slider->SetValue(settings.cell_size);
+	angle_slider->SetValue(settings.angle);
+
+	// The size and the angle only change the dot and line screens.
+	bool screen = (settings.mode == ROUND_DOT_HALFTONE) || (settings.mode == LINE_HALFTONE);
+	size_slider->SetEnabled(screen);
+	angle_slider->SetEnabled(screen);
 }
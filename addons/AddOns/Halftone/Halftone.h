@@ -9,41 +9,192 @@
 #ifndef HALFTONE_H
 #define HALFTONE_H
 
-#include "Manipulator.h"
+#include "ManipulatorSettings.h"
+#include "WindowGUIManipulator.h"
 
+
+class BMenuField;
+class BSlider;
 class ManipulatorInformer;
 
 
-#define	ROUND_DOT_SIZE		8
-#define	DIAGONAL_LINE_SIZE	5
-#define	ORDERED_MATRIX_SIZE	4
+#define	HALFTONE_MODE_CHANGED				'Htmc'
+#define	HALFTONE_SIZE_ADJUSTED				'Htsa'
+#define	HALFTONE_SIZE_ADJUSTING_FINISHED	'Htsf'
+#define	HALFTONE_ANGLE_ADJUSTED				'Htaa'
+#define	HALFTONE_ANGLE_ADJUSTING_FINISHED	'Htaf'
+
+#define	MIN_HALFTONE_CELL_SIZE	3
+#define	MAX_HALFTONE_CELL_SIZE	16
+#define	MAX_HALFTONE_ANGLE		90
+
+#define	ORDERED_MATRIX_SIZE		8
+
+
+enum halftone_modes {
+	ROUND_DOT_HALFTONE = 0,
+	LINE_HALFTONE,
+	ORDERED_DITHER_HALFTONE,
+	FS_DITHER_HALFTONE,
+	N_CANDIDATE_DITHER_HALFTONE
+};
+
+
+class HalftoneManipulatorSettings : public ManipulatorSettings {
+public:
+	HalftoneManipulatorSettings()
+		: ManipulatorSettings() {
+		mode = ROUND_DOT_HALFTONE;
+		cell_size = 8;
+		angle = 45;
+	}
+
+	HalftoneManipulatorSettings(const HalftoneManipulatorSettings& s)
+		: ManipulatorSettings() {
+		mode = s.mode;
+		cell_size = s.cell_size;
+		angle = s.angle;
+	}
+
+	HalftoneManipulatorSettings& operator=(const HalftoneManipulatorSettings& s) {
+		mode = s.mode;
+		cell_size = s.cell_size;
+		angle = s.angle;
+		return *this;
+	}
+
+	bool operator==(HalftoneManipulatorSettings s) {
+		return (mode == s.mode) && (cell_size == s.cell_size) && (angle == s.angle);
+	}
+
+	bool operator!=(HalftoneManipulatorSettings s) {
+		return !(*this == s);
+	}
+
+	int32	mode;
+	int32	cell_size;
+	int32	angle;
+};
+
+
+class HalftoneManipulatorView;
+
+
+/*
+	The dot and line screens and the ordered dither are a comparison of each
+	pixel's luminance with a threshold from a tile that repeats over the
+	image. The tile is made once when the settings change, so applying it is
+	a simple pass over the rows that the worker threads share. A rotated
+	screen repeats after a whole number of cells in both directions, which
+	gives the size of its tile.
+
+	Floyd-Steinberg diffusion is processed in blocks of columns. A block
+	only needs the block to its left and the three blocks above it, so all
+	blocks on the same diagonal of the block grid are processed in
+	parallel, one diagonal after another.
+*/
+class HalftoneManipulator : public WindowGUIManipulator {
+			BBitmap*	preview_bitmap;
+			BBitmap*	copy_of_the_preview_bitmap;
+
+			int32		lowest_available_quality;
+			int32		highest_available_quality;
+			int32		last_calculated_resolution;
+
+			HalftoneManipulatorSettings	settings;
+			HalftoneManipulatorSettings	previous_settings;
 
-class Halftone : public Manipulator {
-	const	int32	round_dot_size;
-	const	int32	diagonal_line_size;
-	const	int32	ordered_matrix_size;
+			HalftoneManipulatorView*	config_view;
 
-			uint32	round_dot_pattern[ROUND_DOT_SIZE][ROUND_DOT_SIZE];
-			uint32	diagonal_line_pattern[DIAGONAL_LINE_SIZE][DIAGONAL_LINE_SIZE];
-			uint32	ordered_matrix[ORDERED_MATRIX_SIZE][ORDERED_MATRIX_SIZE];
+			ManipulatorInformer*	informer;
 
-ManipulatorInformer	*informer;
+			// The thresholds of the screen, tile_size * tile_size values
+			// between 1 and 255. A pixel whose luminance is below its
+			// threshold gets the foreground color.
+			uint8*		threshold_tile;
+			int32		tile_size;
+			HalftoneManipulatorSettings	tile_settings;
 
-	BBitmap*	round_dot_halftone(BBitmap*, Selection*, BStatusBar*);
-	BBitmap*	diagonal_line_halftone(BBitmap*, Selection*, BStatusBar*);
-	BBitmap*	ordered_dither_halftone(BBitmap*, Selection*, BStatusBar*);
-	BBitmap*	fs_dither_halftone(BBitmap*, Selection*, BStatusBar*);
-	BBitmap*	ncandidate_dither_halftone(BBitmap*, Selection*, BStatusBar*);
-	Selection*	selection;
+			void		make_threshold_tile();
+
+			// The next attributes will be used by the thread functions.
+			int32		current_resolution;
+
+			HalftoneManipulatorSettings	current_settings;
+
+			Selection*	selection;
+
+			BBitmap*	source_bitmap;
+			BBitmap*	target_bitmap;
+			BStatusBar*	progress_bar;
+
+			BRect		rect;
+			uint32		foreground;
+			uint32		background;
+
+			// The state of the error diffusion. The errors for the next rows
+			// are kept in a small ring of rows, each row carries the error of
+			// its last pixel to the next block.
+			float*		error_rows;
+			int32		error_row_length;
+			float*		right_errors;
+			int32		diffusion_time;
+			int32		first_block;
+
+			void		start_threads();
+
+	static	void		threshold_entry(void*, int32, int32);
+			void		threshold_rows(int32, int32);
+	static	void		n_candidate_entry(void*, int32, int32);
+			void		n_candidate_rows(int32, int32);
+	static	void		diffusion_entry(void*, int32, int32);
+			void		diffuse_block(int32 row, int32 block);
+
+			void		fs_dither();
 
 public:
-				Halftone(ManipulatorInformer*);
-				~Halftone();
-
-	BBitmap*	ManipulateBitmap(BBitmap*, BStatusBar*);
-	const char*	ReturnHelpString();
-	const char*	ReturnName();
-	void		SetSelection(Selection* new_selection)
-					{ selection = new_selection; };
+						HalftoneManipulator(BBitmap*, ManipulatorInformer*);
+						~HalftoneManipulator();
+
+			int32		PreviewBitmap(bool full_quality = FALSE, BRegion* = NULL);
+			BBitmap*	ManipulateBitmap(ManipulatorSettings*, BBitmap*, BStatusBar*);
+			void		Reset();
+			void		SetPreviewBitmap(BBitmap*);
+			const char*	ReturnHelpString();
+			const char*	ReturnName();
+
+			ManipulatorSettings*	ReturnSettings();
+
+			BView*		MakeConfigurationView(const BMessenger& target);
+
+			void		ChangeSettings(ManipulatorSettings*);
+
+			status_t	ReadSettings(BNode*);
+			status_t	WriteSettings(BNode*);
+			void		SetSelection(Selection* new_selection)
+							{ selection = new_selection; };
 };
+
+
+class HalftoneManipulatorView : public WindowGUIManipulatorView {
+	BMessenger	target;
+	HalftoneManipulator*		manipulator;
+	HalftoneManipulatorSettings	settings;
+
+	BMenuField*	mode_menu_field;
+	BSlider*	size_slider;
+	BSlider*	angle_slider;
+
+	bool		started_adjusting;
+
+	void		update_controls();
+public:
+				HalftoneManipulatorView(HalftoneManipulator*, const BMessenger&);
+
+	void		AllAttached();
+	void		AttachedToWindow();
+	void		MessageReceived(BMessage*);
+	void		ChangeSettings(ManipulatorSettings*);
+};
+
 #endif
@@ -49,7 +49,6 @@ MarbleManipulator::MarbleManipulator(ManipulatorInformer* i)
 	selection(NULL)
 {
 	informer = i;
-	processor_count = GetSystemCpuCount();
 }
 
 
@@ -68,22 +67,13 @@ MarbleManipulator::ManipulateBitmap(BBitmap* original, BStatusBar* status_bar)
 	target_bitmap = original;
 	progress_bar = status_bar;
 
-	thread_id* threads = new thread_id[processor_count];
-
 	spare_copy_bitmap = DuplicateBitmap(original, -1);
 
-	for (int32 i = 0; i < processor_count; i++) {
-		threads[i] = spawn_thread(thread_entry, "perlin_fade_thread", B_NORMAL_PRIORITY, this);
-		resume_thread(threads[i]);
-		send_data(threads[i], i, NULL, 0);
-	}
-
-	for (int32 i = 0; i < processor_count; i++) {
-		int32 return_value;
-		wait_for_thread(threads[i], &return_value);
-	}
-
-	delete[] threads;
+	BRect rect = target_bitmap->Bounds();
+	if (selection->IsEmpty() == false)
+		rect = rect & selection->GetBoundingRect();
+	if (rect.IsValid() == true)
+		ParallelFor((int32)rect.top, (int32)rect.bottom + 1, thread_entry, this, progress_bar);
 
 	delete spare_copy_bitmap;
 
@@ -106,25 +96,17 @@ MarbleManipulator::ReturnName()
 }
 
 
-int32
-MarbleManipulator::thread_entry(void* data)
+void
+MarbleManipulator::thread_entry(void* data, int32 first_row, int32 last_row)
 {
-	int32 thread_number;
-	thread_number = receive_data(NULL, NULL, 0);
-
 	MarbleManipulator* this_pointer = (MarbleManipulator*)data;
-
-	return this_pointer->thread_function(thread_number);
+	this_pointer->thread_function(first_row, last_row);
 }
 
 
 int32
-MarbleManipulator::thread_function(int32 thread_number)
+MarbleManipulator::thread_function(int32 first_row, int32 last_row)
 {
-	BWindow* progress_bar_window = NULL;
-	if (progress_bar != NULL)
-		progress_bar_window = progress_bar->Window();
-
 	uint32* source = (uint32*)source_bitmap->Bits();
 	int32 source_bpr = source_bitmap->BytesPerRow() / 4;
 
@@ -140,16 +122,8 @@ MarbleManipulator::thread_function(int32 thread_number)
 		// Here handle the whole image.
 		float left = target_bitmap->Bounds().left;
 		float right = target_bitmap->Bounds().right;
-		float top = target_bitmap->Bounds().top;
-		float bottom = target_bitmap->Bounds().bottom;
-
-		int32 height = (bottom - top + 1) / processor_count;
-		top = min_c(bottom, top + thread_number * height);
-		bottom = min_c(bottom, top + height - 1);
-
-		int32 update_interval = 10;
-		float update_amount = 100.0 / (bottom - top) * update_interval / (float)processor_count;
-		float missed_update = 0;
+		float top = first_row;
+		float bottom = last_row - 1;
 
 		// Loop through all pixels in original.
 		float one_per_width = 1.0 / 128;
@@ -171,31 +145,15 @@ MarbleManipulator::thread_function(int32 thread_number)
 				}
 				++source;
 			}
-			// Update the status-bar
-			if ((((int32)y % update_interval) == 0) && (progress_bar_window != NULL)
-				&& (progress_bar_window->LockWithTimeout(0) == B_OK)) {
-				progress_bar->Update(update_amount + missed_update);
-				progress_bar_window->Unlock();
-				missed_update = 0;
-			} else if (((int32)y % update_interval) == 0)
-				missed_update += update_amount;
 		}
 	} else {
 		// Here handle only those pixels for which selection->ContainsPoint(x,y) is true.
-		BRect rect = selection->GetBoundingRect();
+		BRect rect = selection->GetBoundingRect() & target_bitmap->Bounds();
 
 		int32 left = rect.left;
 		int32 right = rect.right;
-		int32 top = rect.top;
-		int32 bottom = rect.bottom;
-
-		int32 height = (bottom - top + 1) / processor_count;
-		top = min_c(bottom, top + thread_number * height);
-		bottom = min_c(bottom, top + height - 1);
-
-		int32 update_interval = 10;
-		float update_amount = 100.0 / (bottom - top) * update_interval / (float)processor_count;
-		float missed_update = 0;
+		int32 top = first_row;
+		int32 bottom = last_row - 1;
 
 		// Loop through all pixels in original.
 		float one_per_width = 1.0 / 128;
@@ -219,15 +177,6 @@ MarbleManipulator::thread_function(int32 thread_number)
 					}
 				}
 			}
-
-			// Update the status-bar
-			if ((((int32)y % update_interval) == 0) && (progress_bar_window != NULL)
-				&& (progress_bar_window->LockWithTimeout(0) == B_OK)) {
-				progress_bar->Update(update_amount + missed_update);
-				progress_bar_window->Unlock();
-				missed_update = 0;
-			} else if (((int32)y % update_interval) == 0)
-				missed_update += update_amount;
 		}
 	}
 
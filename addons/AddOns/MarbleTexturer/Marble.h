@@ -22,11 +22,10 @@ class MarbleManipulator : public Manipulator {
 
 		ManipulatorInformer	*informer;
 
-static	int32		thread_entry(void*);
-		int32		thread_function(int32);
+static	void		thread_entry(void*, int32, int32);
+		int32		thread_function(int32, int32);
 
 		float		marble_amount(float);
-		int			processor_count;
 		Selection*	selection;
 
 public:
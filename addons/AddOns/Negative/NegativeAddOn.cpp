@@ -15,6 +15,7 @@
 #include "AddOns.h"
 #include "ManipulatorInformer.h"
 #include "NegativeAddOn.h"
+#include "PointOperation.h"
 #include "Selection.h"
 
 #undef B_TRANSLATION_CONTEXT
@@ -41,6 +42,19 @@ instantiate_add_on(BBitmap* bm, ManipulatorInformer* i)
 }
 
 
+PointOperation*
+instantiate_point_operation(ManipulatorSettings*)
+{
+	uint8 table[256];
+	for (int32 i = 0; i < 256; i++)
+		table[i] = 255 - i;
+
+	ChannelMapOperation* operation = new ChannelMapOperation();
+	operation->SetTables(table);
+	return operation;
+}
+
+
 NegativeAddOnManipulator::NegativeAddOnManipulator(BBitmap*)
 	:
 	Manipulator(),
@@ -59,38 +73,10 @@ NegativeAddOnManipulator::ManipulateBitmap(BBitmap* original, BStatusBar* status
 		status_bar->Window()->PostMessage(&progress_message, status_bar);
 	}
 
-	int32 bits_length = original->BitsLength() / 4;
-	uint32* bits = (uint32*)original->Bits();
-	union {
-		uint8 bytes[4];
-		uint32 word;
-	} color;
-
-	if (selection->IsEmpty() == TRUE) {
-		for (int32 i = 0; i < bits_length; i++) {
-			color.word = *bits;
-			color.bytes[0] = 255 - color.bytes[0];
-			color.bytes[1] = 255 - color.bytes[1];
-			color.bytes[2] = 255 - color.bytes[2];
-			*bits++ = color.word;
-		}
-	} else {
-		int32 width = original->Bounds().Width();
-		int32 height = original->Bounds().Height();
-
-		for (int32 y = 0; y <= height; y++) {
-			for (int32 x = 0; x <= width; x++) {
-				if (selection->ContainsPoint(x, y)) {
-					color.word = *bits;
-					color.bytes[0] = 255 - color.bytes[0];
-					color.bytes[1] = 255 - color.bytes[1];
-					color.bytes[2] = 255 - color.bytes[2];
-					*bits++ = color.word;
-				} else
-					++bits;
-			}
-		}
-	}
+	PointOperationPipeline pipeline;
+	pipeline.AddOperation(instantiate_point_operation(NULL));
+	pipeline.Apply(original, original, selection, 1, NULL);
+
 	return original;
 }
 
@@ -8,13 +8,14 @@
  */
 #include <Bitmap.h>
 #include <Catalog.h>
-#include <Message.h>
+#include <LayoutBuilder.h>
+#include <Node.h>
+#include <Slider.h>
 #include <StatusBar.h>
 #include <Window.h>
-#include <stdlib.h>
+#include <string.h>
 
 #include "AddOns.h"
-#include "BitmapDrawer.h"
 #include "ManipulatorInformer.h"
 #include "OilAddOn.h"
 #include "Selection.h"
@@ -26,7 +27,7 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
-	char name[255] = B_TRANSLATE_MARK("Oil");
+	char name[255] = B_TRANSLATE_MARK("Oil" B_UTF8_ELLIPSIS);
 	char menu_help_string[255] = B_TRANSLATE_MARK("Creates an \"oil\" effect.");
 	int32 add_on_api_version = ADD_ON_API_VERSION;
 	add_on_types add_on_type = EFFECT_FILTER_ADD_ON;
@@ -35,6 +36,45 @@ extern "C" {
 #endif
 
 
+struct oil_histogram {
+	int32	count[OIL_INTENSITY_LEVELS];
+	uint32	red[OIL_INTENSITY_LEVELS];
+	uint32	green[OIL_INTENSITY_LEVELS];
+	uint32	blue[OIL_INTENSITY_LEVELS];
+	uint32	alpha[OIL_INTENSITY_LEVELS];
+};
+
+
+// Adds (sign = 1) or removes (sign = -1) the pixels of column x between
+// the rows top and bottom.
+static inline void
+update_histogram(oil_histogram* histogram, const uint32* bits, int32 bpr,
+	int32 x, int32 top, int32 bottom, int32 sign)
+{
+	// This union must be used to guarantee endianness compatibility.
+	union {
+		uint8 bytes[4];
+		uint32 word;
+	} color;
+
+	const uint32* pixel = bits + x + top * bpr;
+	for (int32 y = top; y <= bottom; y++) {
+		color.word = *pixel;
+		int32 intensity
+			= (color.bytes[2] * 77 + color.bytes[1] * 150 + color.bytes[0] * 29) >> 8;
+		int32 level = intensity * OIL_INTENSITY_LEVELS >> 8;
+
+		histogram->count[level] += sign;
+		histogram->red[level] += sign * color.bytes[2];
+		histogram->green[level] += sign * color.bytes[1];
+		histogram->blue[level] += sign * color.bytes[0];
+		histogram->alpha[level] += sign * color.bytes[3];
+
+		pixel += bpr;
+	}
+}
+
+
 Manipulator*
 instantiate_add_on(BBitmap* bm, ManipulatorInformer* i)
 {
@@ -43,104 +83,269 @@ instantiate_add_on(BBitmap* bm, ManipulatorInformer* i)
 }
 
 
-OilManipulator::OilManipulator(BBitmap*)
+OilManipulator::OilManipulator(BBitmap* bm)
 	:
-	Manipulator(),
+	WindowGUIManipulator(),
 	selection(NULL)
 {
+	preview_bitmap = NULL;
+	copy_of_the_preview_bitmap = NULL;
+	config_view = NULL;
+
+	previous_settings.radius = settings.radius + 1;
+
+	SetPreviewBitmap(bm);
+}
+
+
+OilManipulator::~OilManipulator()
+{
+	delete copy_of_the_preview_bitmap;
+	delete config_view;
 }
 
 
 BBitmap*
-OilManipulator::ManipulateBitmap(BBitmap* original, BStatusBar* status_bar)
+OilManipulator::ManipulateBitmap(ManipulatorSettings* set, BBitmap* original,
+	BStatusBar* status_bar)
 {
-	BWindow* status_bar_window = NULL;
-	if (status_bar != NULL)
-		status_bar_window = status_bar->Window();
+	OilManipulatorSettings* new_settings = dynamic_cast<OilManipulatorSettings*>(set);
 
-	BBitmap* spare_buffer = DuplicateBitmap(original);
+	if (new_settings == NULL)
+		return NULL;
 
-	BitmapDrawer* target = new BitmapDrawer(original);
-	BitmapDrawer* source = new BitmapDrawer(spare_buffer);
+	if (original == NULL)
+		return NULL;
 
-	int32 width = original->Bounds().Width() + 1;
-	int32 height = original->Bounds().Height() + 1;
+	if (original == preview_bitmap) {
+		if (*new_settings == previous_settings)
+			return original;
 
-	float status_bar_update_step = 100.0 / (width * height) * 1000.0;
+		source_bitmap = copy_of_the_preview_bitmap;
+		target_bitmap = original;
+	} else {
+		// The pixels outside of the selection are kept as they are.
+		source_bitmap = original;
+		target_bitmap = DuplicateBitmap(original);
+	}
 
-	BMessage progress_message = BMessage(B_UPDATE_STATUS_BAR);
-	progress_message.AddFloat("delta", 0.0);
+	current_settings = *new_settings;
+	progress_bar = status_bar;
 
-	// We must select all pixels between 0 and width*height in a
-	// pseudo-random order.
-	int32* offsets = new int32[width * height];
-	for (int32 i = 0; i < width * height; i++)
-		offsets[i] = i;
+	start_threads();
 
-	/*
-		We copy each pixel with the following pattern:
+	return target_bitmap;
+}
 
-						 O
-						OOO
-			X	->		 OXOO
-						  O
 
-	*/
+int32
+OilManipulator::PreviewBitmap(bool full_quality, BRegion* updated_region)
+{
+	if (settings == previous_settings)
+		return DRAW_NOTHING;
 
-	int32 size_of_area = width * height - 1;
-	uint32 moved_pixel;
-	union {
-		uint8 bytes[4];
-		uint32 word;
-	} color;
+	previous_settings = settings;
+
+	progress_bar = NULL;
+	source_bitmap = copy_of_the_preview_bitmap;
+	target_bitmap = preview_bitmap;
+	current_settings = settings;
+
+	start_threads();
+
+	updated_region->Set(preview_bitmap->Bounds());
+	return DRAW_1_X_1;
+}
 
-	int32 random_array_size = 32;
-	int32* random_array = new int32[random_array_size];
-	for (int32 i = 0; i < random_array_size; i++)
-		random_array[i] = random() % 10 * (random() % 2 == 0 ? -1 : 1);
-
-	while (size_of_area > 0) {
-		// Select one pixel at random
-		int32 new_offset = rand() % size_of_area;
-		int32 spare = offsets[new_offset];
-		offsets[new_offset] = offsets[size_of_area];
-		size_of_area--;
-		int32 x = spare % width;
-		int32 y = spare / width;
-		color.word = source->GetPixel(BPoint(x, y));
-		// randomize the color a bit
-		color.bytes[0] = min_c(
-			255, max_c(0, (int32)color.bytes[0] + random_array[size_of_area % random_array_size]));
-		color.bytes[1] = min_c(
-			255, max_c(0, (int32)color.bytes[1] + random_array[size_of_area % random_array_size]));
-		color.bytes[2] = min_c(
-			255, max_c(0, (int32)color.bytes[2] + random_array[size_of_area % random_array_size]));
-
-		moved_pixel = color.word;
-
-		target->SetPixel(BPoint(x - 2, y - 1), moved_pixel, selection);
-		target->SetPixel(BPoint(x - 1, y - 1), moved_pixel, selection);
-		target->SetPixel(BPoint(x, y - 1), moved_pixel, selection);
-		target->SetPixel(BPoint(x - 1, y - 2), moved_pixel, selection);
-		target->SetPixel(BPoint(x - 1, y), moved_pixel, selection);
-		target->SetPixel(BPoint(x, y), moved_pixel, selection);
-		target->SetPixel(BPoint(x + 1, y), moved_pixel, selection);
-		target->SetPixel(BPoint(x + 2, y), moved_pixel, selection);
-		target->SetPixel(BPoint(x, y + 1), moved_pixel, selection);
-		if (((size_of_area % 1000) == 0) && (status_bar != NULL) && (status_bar_window != NULL)
-			&& (status_bar_window->LockWithTimeout(0) == B_OK)) {
-			status_bar->Update(status_bar_update_step);
-			status_bar_window->Unlock();
+
+void
+OilManipulator::start_threads()
+{
+	BRect rect = source_bitmap->Bounds();
+	if (selection != NULL && selection->IsEmpty() == false)
+		rect = rect & selection->GetBoundingRect();
+	if (rect.IsValid() == false)
+		return;
+
+	// The rows take a different time depending on how much of them is
+	// selected, the worker threads balance the load between them.
+	ParallelFor((int32)rect.top, (int32)rect.bottom + 1, thread_entry, this, progress_bar);
+}
+
+
+void
+OilManipulator::thread_entry(void* data, int32 first_row, int32 last_row)
+{
+	OilManipulator* this_pointer = (OilManipulator*)data;
+	this_pointer->thread_function(first_row, last_row);
+}
+
+
+int32
+OilManipulator::thread_function(int32 first_row, int32 last_row)
+{
+	uint32* source_bits = (uint32*)source_bitmap->Bits();
+	uint32* target_bits = (uint32*)target_bitmap->Bits();
+	int32 source_bpr = source_bitmap->BytesPerRow() / 4;
+	int32 target_bpr = target_bitmap->BytesPerRow() / 4;
+
+	BRect bounds = source_bitmap->Bounds();
+	int32 width = bounds.IntegerWidth() + 1;
+	int32 height = bounds.IntegerHeight() + 1;
+
+	bool use_selection = (selection != NULL) && (selection->IsEmpty() == false);
+	BRect rect = bounds;
+	if (use_selection)
+		rect = selection->GetBoundingRect() & bounds;
+	if (rect.IsValid() == false)
+		return B_OK;
+
+	int32 left = rect.left;
+	int32 right = rect.right;
+	int32 top = first_row;
+	int32 bottom = last_row - 1;
+
+	int32 radius = current_settings.radius;
+
+	oil_histogram histogram;
+
+	for (int32 y = top; y <= bottom; y++) {
+		int32 window_top = max_c(y - radius, 0);
+		int32 window_bottom = min_c(y + radius, height - 1);
+
+		// Start with the window of the pixel left of the first one, the
+		// loop below then moves it one column to the right for each pixel.
+		memset(&histogram, 0, sizeof(oil_histogram));
+		for (int32 x = max_c(left - radius, 0); x <= min_c(left + radius - 1, width - 1); x++) {
+			update_histogram(&histogram, source_bits, source_bpr, x, window_top,
+				window_bottom, 1);
+		}
+
+		uint32* target = target_bits + y * target_bpr;
+		for (int32 x = left; x <= right; x++) {
+			if (x + radius < width) {
+				update_histogram(&histogram, source_bits, source_bpr, x + radius,
+					window_top, window_bottom, 1);
+			}
+			if (x > left && x - radius - 1 >= 0) {
+				update_histogram(&histogram, source_bits, source_bpr, x - radius - 1,
+					window_top, window_bottom, -1);
+			}
+
+			if (use_selection && selection->ContainsPoint(x, y) == false)
+				continue;
+
+			int32 level = 0;
+			for (int32 i = 1; i < OIL_INTENSITY_LEVELS; i++) {
+				if (histogram.count[i] > histogram.count[level])
+					level = i;
+			}
+
+			int32 count = histogram.count[level];
+			union {
+				uint8 bytes[4];
+				uint32 word;
+			} color;
+			color.bytes[0] = histogram.blue[level] / count;
+			color.bytes[1] = histogram.green[level] / count;
+			color.bytes[2] = histogram.red[level] / count;
+			color.bytes[3] = histogram.alpha[level] / count;
+			target[x] = color.word;
 		}
 	}
 
-	// we should also delete the spare-bitmap
-	delete spare_buffer;
-	delete target;
-	delete source;
-	delete[] offsets;
+	return B_OK;
+}
+
+
+void
+OilManipulator::SetPreviewBitmap(BBitmap* bm)
+{
+	if (preview_bitmap != bm) {
+		delete copy_of_the_preview_bitmap;
 
-	return original;
+		if (bm != NULL) {
+			preview_bitmap = bm;
+			copy_of_the_preview_bitmap = DuplicateBitmap(bm, 0);
+		} else {
+			preview_bitmap = NULL;
+			copy_of_the_preview_bitmap = NULL;
+		}
+
+		previous_settings.radius = settings.radius + 1;
+	}
+}
+
+
+void
+OilManipulator::Reset()
+{
+	if (copy_of_the_preview_bitmap != NULL) {
+		uint32* source = (uint32*)copy_of_the_preview_bitmap->Bits();
+		uint32* target = (uint32*)preview_bitmap->Bits();
+		uint32 bits_length = preview_bitmap->BitsLength();
+
+		memcpy(target, source, bits_length);
+	}
+}
+
+
+BView*
+OilManipulator::MakeConfigurationView(const BMessenger& target)
+{
+	if (config_view == NULL) {
+		config_view = new OilManipulatorView(this, target);
+		config_view->ChangeSettings(&settings);
+	}
+
+	return config_view;
+}
+
+
+ManipulatorSettings*
+OilManipulator::ReturnSettings()
+{
+	return new OilManipulatorSettings(settings);
+}
+
+
+void
+OilManipulator::ChangeSettings(ManipulatorSettings* s)
+{
+	OilManipulatorSettings* new_settings = dynamic_cast<OilManipulatorSettings*>(s);
+	if (new_settings != NULL)
+		settings = *new_settings;
+}
+
+
+status_t
+OilManipulator::ReadSettings(BNode* node)
+{
+	if (node == NULL)
+		return B_ERROR;
+
+	int32 new_radius;
+	if (node->ReadAttr("oil_radius", B_INT32_TYPE, 0, &new_radius, sizeof(int32))
+		!= sizeof(int32))
+		return B_ERROR;
+
+	settings.radius = min_c(max_c(new_radius, 1), MAX_OIL_RADIUS);
+	previous_settings.radius = settings.radius + 1;
+	return B_OK;
+}
+
+
+status_t
+OilManipulator::WriteSettings(BNode* node)
+{
+	if (node == NULL)
+		return B_ERROR;
+
+	if (node->WriteAttr("oil_radius", B_INT32_TYPE, 0, &settings.radius, sizeof(int32))
+		!= sizeof(int32))
+		return B_ERROR;
+
+	return B_OK;
 }
 
 
@@ -156,3 +361,85 @@ OilManipulator::ReturnName()
 {
 	return B_TRANSLATE("Oil");
 }
+
+
+OilManipulatorView::OilManipulatorView(OilManipulator* manip, const BMessenger& t)
+	:
+	WindowGUIManipulatorView()
+{
+	target = t;
+	manipulator = manip;
+	started_adjusting = FALSE;
+
+	radius_slider = new BSlider("radius_slider", B_TRANSLATE("Brush size:"),
+		new BMessage(OIL_RADIUS_ADJUSTING_FINISHED), 1, MAX_OIL_RADIUS, B_HORIZONTAL,
+		B_TRIANGLE_THUMB);
+	radius_slider->SetModificationMessage(new BMessage(OIL_RADIUS_ADJUSTED));
+	radius_slider->SetLimitLabels(B_TRANSLATE("Small"), B_TRANSLATE("Large"));
+	radius_slider->SetHashMarks(B_HASH_MARKS_BOTTOM);
+	radius_slider->SetHashMarkCount(MAX_OIL_RADIUS);
+
+	BLayoutBuilder::Group<>(this, B_VERTICAL, B_USE_ITEM_SPACING)
+		.Add(radius_slider)
+		.SetInsets(B_USE_SMALL_INSETS)
+	.End();
+}
+
+
+void
+OilManipulatorView::AttachedToWindow()
+{
+	WindowGUIManipulatorView::AttachedToWindow();
+	radius_slider->SetTarget(BMessenger(this));
+}
+
+
+void
+OilManipulatorView::AllAttached()
+{
+	radius_slider->SetValue(settings.radius);
+}
+
+
+void
+OilManipulatorView::MessageReceived(BMessage* message)
+{
+	switch (message->what) {
+		case OIL_RADIUS_ADJUSTED:
+		{
+			settings.radius = radius_slider->Value();
+			manipulator->ChangeSettings(&settings);
+			if (!started_adjusting) {
+				target.SendMessage(HS_MANIPULATOR_ADJUSTING_STARTED);
+				started_adjusting = TRUE;
+			}
+		} break;
+		case OIL_RADIUS_ADJUSTING_FINISHED:
+		{
+			started_adjusting = FALSE;
+			settings.radius = radius_slider->Value();
+			manipulator->ChangeSettings(&settings);
+			target.SendMessage(HS_MANIPULATOR_ADJUSTING_FINISHED);
+		} break;
+		default:
+			WindowGUIManipulatorView::MessageReceived(message);
+	}
+}
+
+
+void
+OilManipulatorView::ChangeSettings(ManipulatorSettings* set)
+{
+	OilManipulatorSettings* new_settings = dynamic_cast<OilManipulatorSettings*>(set);
+
+	if (new_settings != NULL) {
+		settings = *new_settings;
+
+		BWindow* window = Window();
+		if (window != NULL) {
+			window->Lock();
+			radius_slider->SetValue(settings.radius);
+			window->Unlock();
+		}
+	}
+}
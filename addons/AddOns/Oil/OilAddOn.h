@@ -9,23 +9,123 @@
 #ifndef OIL_ADD_ON_H
 #define OIL_ADD_ON_H
 
-#include "Manipulator.h"
+#include "ManipulatorSettings.h"
+#include "WindowGUIManipulator.h"
 
 
-class OilManipulator : public Manipulator {
-	Selection*	selection;
+class BSlider;
 
+
+#define	OIL_RADIUS_ADJUSTED				'Olra'
+#define	OIL_RADIUS_ADJUSTING_FINISHED	'Olrf'
+
+#define	MAX_OIL_RADIUS	10
+
+// The number of intensity levels in the histograms.
+#define	OIL_INTENSITY_LEVELS	20
+
+
+class OilManipulatorSettings : public ManipulatorSettings {
 public:
-				OilManipulator(BBitmap*);
+	OilManipulatorSettings()
+		: ManipulatorSettings() {
+		radius = 3;
+	}
+
+	OilManipulatorSettings(const OilManipulatorSettings& s)
+		: ManipulatorSettings() {
+		radius = s.radius;
+	}
+
+	OilManipulatorSettings& operator=(const OilManipulatorSettings& s) {
+		radius = s.radius;
+		return *this;
+	}
+
+	bool operator==(OilManipulatorSettings s) {
+		return radius == s.radius;
+	}
+
+	bool operator!=(OilManipulatorSettings s) {
+		return !(*this == s);
+	}
 
-	BBitmap*	ManipulateBitmap(BBitmap*, BStatusBar*);
-	const char*	ReturnHelpString();
-	const char*	ReturnName();
-	void		SetSelection(Selection* new_selection)
-					{ selection = new_selection; };
+	int32	radius;
 };
 
-#endif
 
+class OilManipulatorView;
+
+
+/*
+	The oil effect replaces each pixel with the average color of the most
+	common intensity level around it. The intensity histogram of the window
+	is updated one column at a time when moving along a row, so each pixel
+	only costs two columns of the window. The rows are divided between the
+	worker threads and each range only needs one histogram.
+*/
+class OilManipulator : public WindowGUIManipulator {
+			BBitmap*	preview_bitmap;
+			BBitmap*	copy_of_the_preview_bitmap;
+
+			OilManipulatorSettings	settings;
+			OilManipulatorSettings	previous_settings;
+
+			OilManipulatorView*		config_view;
+
+			// The next attributes will be used by the thread_function.
+			OilManipulatorSettings	current_settings;
+
+			Selection*	selection;
+
+			BBitmap*	source_bitmap;
+			BBitmap*	target_bitmap;
+			BStatusBar*	progress_bar;
 
+			void		start_threads();
 
+	static	void		thread_entry(void*, int32, int32);
+			int32		thread_function(int32, int32);
+
+public:
+						OilManipulator(BBitmap*);
+						~OilManipulator();
+
+			int32		PreviewBitmap(bool full_quality = FALSE, BRegion* = NULL);
+			BBitmap*	ManipulateBitmap(ManipulatorSettings*, BBitmap*, BStatusBar*);
+			void		Reset();
+			void		SetPreviewBitmap(BBitmap*);
+			const char*	ReturnHelpString();
+			const char*	ReturnName();
+
+			ManipulatorSettings*	ReturnSettings();
+
+			BView*		MakeConfigurationView(const BMessenger& target);
+
+			void		ChangeSettings(ManipulatorSettings*);
+
+			status_t	ReadSettings(BNode*);
+			status_t	WriteSettings(BNode*);
+			void		SetSelection(Selection* new_selection)
+							{ selection = new_selection; };
+};
+
+
+class OilManipulatorView : public WindowGUIManipulatorView {
+	BMessenger	target;
+	OilManipulator*			manipulator;
+	OilManipulatorSettings	settings;
+
+	BSlider*	radius_slider;
+
+	bool		started_adjusting;
+public:
+				OilManipulatorView(OilManipulator*, const BMessenger&);
+
+	void		AllAttached();
+	void		AttachedToWindow();
+	void		MessageReceived(BMessage*);
+	void		ChangeSettings(ManipulatorSettings*);
+};
+
+#endif
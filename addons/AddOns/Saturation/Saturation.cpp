@@ -16,6 +16,7 @@
 
 #include "AddOns.h"
 #include "ManipulatorInformer.h"
+#include "PointOperation.h"
 #include "Saturation.h"
 #include "Selection.h"
 
@@ -43,6 +44,53 @@ instantiate_add_on(BBitmap* bm, ManipulatorInformer* i)
 }
 
 
+// Interpolates the pixel with its luminance. The luminance is calculated
+// on the fly instead of being stored in a separate image.
+class SaturationOperation : public PointOperation {
+public:
+	SaturationOperation(const SaturationManipulatorSettings& settings)
+	{
+		coeff = settings.saturation / 100.0;
+		one_minus_coeff = 1.0 - coeff;
+	}
+
+	uint32 Apply(uint32 bgra) const
+	{
+		union {
+			uint8 bytes[4];
+			uint32 word;
+		} color;
+
+		color.word = bgra;
+		uint8 luminance = min_c(255,
+			max_c(0, 0.144 * color.bytes[0] + 0.587 * color.bytes[1] + 0.299 * color.bytes[2]));
+		color.bytes[0]
+			= max_c(0, min_c(255, color.bytes[0] * coeff + luminance * one_minus_coeff));
+		color.bytes[1]
+			= max_c(0, min_c(255, color.bytes[1] * coeff + luminance * one_minus_coeff));
+		color.bytes[2]
+			= max_c(0, min_c(255, color.bytes[2] * coeff + luminance * one_minus_coeff));
+		return color.word;
+	}
+
+private:
+	float	coeff;
+	float	one_minus_coeff;
+};
+
+
+PointOperation*
+instantiate_point_operation(ManipulatorSettings* settings)
+{
+	SaturationManipulatorSettings* saturation_settings
+		= dynamic_cast<SaturationManipulatorSettings*>(settings);
+	if (saturation_settings == NULL)
+		return NULL;
+
+	return new SaturationOperation(*saturation_settings);
+}
+
+
 SaturationManipulator::SaturationManipulator(BBitmap* bm)
 	:
 	WindowGUIManipulator(),
@@ -51,7 +99,6 @@ SaturationManipulator::SaturationManipulator(BBitmap* bm)
 	preview_bitmap = NULL;
 	config_view = NULL;
 	copy_of_the_preview_bitmap = NULL;
-	luminance_image = NULL;
 
 	previous_settings.saturation = settings.saturation + 1;
 
@@ -63,7 +110,6 @@ SaturationManipulator::~SaturationManipulator()
 {
 	delete copy_of_the_preview_bitmap;
 	delete config_view;
-	delete luminance_image;
 }
 
 
@@ -94,47 +140,12 @@ SaturationManipulator::ManipulateBitmap(
 	current_settings = *new_settings;
 	progress_bar = status_bar;
 
-	delete luminance_image;
-	luminance_image = new BBitmap(source_bitmap->Bounds(), B_CMAP8);
-	CalculateLuminanceImage(source_bitmap);
-
 	start_threads();
 
 	return target_bitmap;
 }
 
 
-void
-SaturationManipulator::CalculateLuminanceImage(BBitmap* bitmap)
-{
-	uint8* luminance_bits = (uint8*)luminance_image->Bits();
-	uint32 luminance_bpr = luminance_image->BytesPerRow();
-
-	uint32* bits = (uint32*)bitmap->Bits();
-	uint32 bpr = bitmap->BytesPerRow() / 4;
-
-	int32 width = bitmap->Bounds().Width();
-	int32 height = bitmap->Bounds().Height();
-
-	union {
-		uint8 bytes[4];
-		uint32 word;
-	} color;
-
-	for (int32 y = 0; y <= height; y++) {
-		int32 y_times_bpr = y * bpr;
-		int32 y_times_luminance_bpr = y * luminance_bpr;
-		for (int32 x = 0; x <= width; x++) {
-			color.word = *(bits + x + y_times_bpr);
-			uint8 luminance;
-			luminance = min_c(255,
-				max_c(0, 0.144 * color.bytes[0] + 0.587 * color.bytes[1] + 0.299 * color.bytes[2]));
-			*(luminance_bits + x + y_times_luminance_bpr) = luminance;
-		}
-	}
-}
-
-
 int32
 SaturationManipulator::PreviewBitmap(bool full_quality, BRegion* updated_region)
 {
@@ -172,161 +183,10 @@ SaturationManipulator::PreviewBitmap(bool full_quality, BRegion* updated_region)
 void
 SaturationManipulator::start_threads()
 {
-	number_of_threads = GetSystemCpuCount();
-
-	thread_id* threads = new thread_id[number_of_threads];
-
-	for (int32 i = 0; i < number_of_threads; i++) {
-		threads[i] = spawn_thread(thread_entry, "saturation_thread", B_NORMAL_PRIORITY, this);
-		resume_thread(threads[i]);
-		send_data(threads[i], i, NULL, 0);
-	}
-
-	for (int32 i = 0; i < number_of_threads; i++) {
-		int32 return_value;
-		wait_for_thread(threads[i], &return_value);
-	}
-
-	delete[] threads;
-}
-
-
-int32
-SaturationManipulator::thread_entry(void* data)
-{
-	int32 thread_number;
-	thread_number = receive_data(NULL, NULL, 0);
-
-	SaturationManipulator* this_pointer = (SaturationManipulator*)data;
-
-	return this_pointer->thread_function(thread_number);
-}
-
-
-int32
-SaturationManipulator::thread_function(int32 thread_number)
-{
-	// This function interpolates the image with a degenerate version,
-	// which in this case is the luminance image. The luminance image
-	// is in bitmap luminance_image, which is in B_CMAP8 color-space.
-
-	int32 step = current_resolution;
-	uint32 saturation = settings.saturation;
-
-	BWindow* progress_bar_window = NULL;
-	if (progress_bar != NULL)
-		progress_bar_window = progress_bar->Window();
-
-
-	uint32* source_bits = (uint32*)source_bitmap->Bits();
-	uint32* target_bits = (uint32*)target_bitmap->Bits();
-	int32 source_bpr = source_bitmap->BytesPerRow() / 4;
-	int32 target_bpr = target_bitmap->BytesPerRow() / 4;
-	uint8* luminance_bits = (uint8*)luminance_image->Bits();
-	uint32 luminance_bpr = luminance_image->BytesPerRow();
-
-	// This union must be used to guarantee endianness compatibility.
-	union {
-		uint8 bytes[4];
-		uint32 word;
-	} color;
-
-	float coeff = current_settings.saturation / 100.0;
-	float one_minus_coeff = 1.0 - coeff;
-
-	if (selection->IsEmpty()) {
-		// Here handle the whole image.
-		int32 left = target_bitmap->Bounds().left;
-		int32 right = target_bitmap->Bounds().right;
-		int32 top = target_bitmap->Bounds().top;
-		int32 bottom = target_bitmap->Bounds().bottom;
-
-		float height = bottom - top;
-		top = height / number_of_threads * thread_number;
-		top = ceil(top / (float)step);
-		top *= step;
-		bottom = min_c(bottom, top + (height + 1) / number_of_threads);
-		int32 update_interval = 10;
-		float update_amount = 100.0 / (bottom - top) * update_interval / (float)number_of_threads;
-		float missed_update = 0;
-
-		// Loop through all pixels in original.
-		saturation *= 3;
-		for (int32 y = top; y <= bottom; y += step) {
-			int32 y_times_source_bpr = y * source_bpr;
-			int32 y_times_target_bpr = y * target_bpr;
-			int32 y_times_luminance_bpr = y * luminance_bpr;
-			uint8 luminance;
-			for (int32 x = left; x <= right; x += step) {
-				color.word = *(source_bits + x + y_times_source_bpr);
-				luminance = *(luminance_bits + x + y_times_luminance_bpr);
-				color.bytes[0]
-					= max_c(0, min_c(255, color.bytes[0] * coeff + luminance * one_minus_coeff));
-				color.bytes[1]
-					= max_c(0, min_c(255, color.bytes[1] * coeff + luminance * one_minus_coeff));
-				color.bytes[2]
-					= max_c(0, min_c(255, color.bytes[2] * coeff + luminance * one_minus_coeff));
-				*(target_bits + x + y_times_target_bpr) = color.word;
-			}
-
-			// Update the status-bar
-			if (((y % update_interval) == 0) && (progress_bar_window != NULL)
-				&& (progress_bar_window->LockWithTimeout(0) == B_OK)) {
-				progress_bar->Update(update_amount + missed_update);
-				progress_bar_window->Unlock();
-				missed_update = 0;
-			} else if ((y % update_interval) == 0)
-				missed_update += update_amount;
-		}
-	} else {
-		// Here handle only those pixels for which selection->ContainsPoint(x,y) is true.
-		BRect rect = selection->GetBoundingRect();
-
-		int32 left = rect.left;
-		int32 right = rect.right;
-		int32 top = rect.top;
-		int32 bottom = rect.bottom;
-
-		float height = bottom - top;
-		top += height / number_of_threads * thread_number;
-		top *= step;
-		top /= step;
-
-		bottom = min_c(bottom, top + (height + 1) / number_of_threads);
-
-		int32 update_interval = 10;
-		float update_amount = 100.0 / (bottom - top) * update_interval / (float)number_of_threads;
-
-		// Loop through all pixels in original.
-		for (int32 y = top; y <= bottom; y += step) {
-			int32 y_times_source_bpr = y * source_bpr;
-			int32 y_times_target_bpr = y * target_bpr;
-			int32 y_times_luminance_bpr = y * luminance_bpr;
-			uint8 luminance;
-			for (int32 x = left; x <= right; x += step) {
-				if (selection->ContainsPoint(x, y)) {
-					color.word = *(source_bits + x + y_times_source_bpr);
-					luminance = *(luminance_bits + x + y_times_luminance_bpr);
-					color.bytes[0] = max_c(
-						0, min_c(255, color.bytes[0] * coeff + luminance * one_minus_coeff));
-					color.bytes[1] = max_c(
-						0, min_c(255, color.bytes[1] * coeff + luminance * one_minus_coeff));
-					color.bytes[2] = max_c(
-						0, min_c(255, color.bytes[2] * coeff + luminance * one_minus_coeff));
-					*(target_bits + x + y_times_target_bpr) = color.word;
-				}
-			}
-
-			// Update the status-bar
-			if (((y % update_interval) == 0) && (progress_bar_window != NULL)
-				&& (progress_bar_window->LockWithTimeout(0) == B_OK)) {
-				progress_bar->Update(update_amount);
-				progress_bar_window->Unlock();
-			}
-		}
-	}
-
-	return B_OK;
+	PointOperationPipeline pipeline;
+	pipeline.AddOperation(new SaturationOperation(current_settings));
+	pipeline.Apply(source_bitmap, target_bitmap, selection, current_resolution,
+		progress_bar);
 }
 
 
@@ -335,17 +195,13 @@ SaturationManipulator::SetPreviewBitmap(BBitmap* bm)
 {
 	if (preview_bitmap != bm) {
 		delete copy_of_the_preview_bitmap;
-		delete luminance_image;
 
 		if (bm != NULL) {
 			preview_bitmap = bm;
 			copy_of_the_preview_bitmap = DuplicateBitmap(bm, 0);
-			luminance_image = new BBitmap(preview_bitmap->Bounds(), B_CMAP8);
-			CalculateLuminanceImage(preview_bitmap);
 		} else {
 			preview_bitmap = NULL;
 			copy_of_the_preview_bitmap = NULL;
-			luminance_image = NULL;
 		}
 	}
 
@@ -51,8 +51,6 @@ class SaturationManipulator : public WindowGUIManipulator {
 			BBitmap*	preview_bitmap;
 			BBitmap*	copy_of_the_preview_bitmap;
 
-			BBitmap*	luminance_image;
-
 			int32		lowest_available_quality;
 			int32		highest_available_quality;
 			int32		last_calculated_resolution;
@@ -62,8 +60,7 @@ class SaturationManipulator : public WindowGUIManipulator {
 
 			SaturationManipulatorView*		config_view;
 
-			// The next attributes will be used by the thread_function.
-			int32		number_of_threads;
+			// The next attributes will be used by start_threads().
 			int32		current_resolution;
 
 			SaturationManipulatorSettings	current_settings;
@@ -76,12 +73,6 @@ class SaturationManipulator : public WindowGUIManipulator {
 
 			void		start_threads();
 
-	static	int32		thread_entry(void*);
-			int32		thread_function(int32);
-
-
-			void		CalculateLuminanceImage(BBitmap*);
-
 public:
 						SaturationManipulator(BBitmap*);
 						~SaturationManipulator();
@@ -156,37 +156,28 @@ SharpnessManipulator::PreviewBitmap(bool full_quality, BRegion* updated_region)
 void
 SharpnessManipulator::start_threads()
 {
-	thread_id* threads = new thread_id[processor_count];
-
-	for (int32 i = 0; i < processor_count; i++) {
-		threads[i] = spawn_thread(thread_entry, "sharpness_thread", B_NORMAL_PRIORITY, this);
-		resume_thread(threads[i]);
-		send_data(threads[i], i, NULL, 0);
-	}
-
-	for (int32 i = 0; i < processor_count; i++) {
-		int32 return_value;
-		wait_for_thread(threads[i], &return_value);
-	}
-
-	delete[] threads;
+	BRect rect = target_bitmap->Bounds();
+	if (selection->IsEmpty() == false)
+		rect = rect & selection->GetBoundingRect();
+	if (rect.IsValid() == false)
+		return;
+
+	// Only every current_resolution'th row is calculated.
+	int32 row_count = ((int32)rect.bottom - (int32)rect.top) / current_resolution + 1;
+	ParallelFor(0, row_count, thread_entry, this, progress_bar);
 }
 
 
-int32
-SharpnessManipulator::thread_entry(void* data)
+void
+SharpnessManipulator::thread_entry(void* data, int32 first_row, int32 last_row)
 {
-	int32 thread_number;
-	thread_number = receive_data(NULL, NULL, 0);
-
 	SharpnessManipulator* this_pointer = (SharpnessManipulator*)data;
-
-	return this_pointer->thread_function(thread_number);
+	this_pointer->thread_function(first_row, last_row);
 }
 
 
 int32
-SharpnessManipulator::thread_function(int32 thread_number)
+SharpnessManipulator::thread_function(int32 first_row, int32 last_row)
 {
 	// This function interpolates the image with a degenerate version,
 	// which in this case is the luminance image. The luminance image
@@ -195,11 +186,6 @@ SharpnessManipulator::thread_function(int32 thread_number)
 	int32 step = current_resolution;
 	float sharpness_coeff = current_settings.sharpness / 100.0;
 
-	BWindow* progress_bar_window = NULL;
-	if (progress_bar != NULL)
-		progress_bar_window = progress_bar->Window();
-
-
 	uint32* source_bits = (uint32*)source_bitmap->Bits();
 	uint32* target_bits = (uint32*)target_bitmap->Bits();
 	int32 source_bpr = source_bitmap->BytesPerRow() / 4;
@@ -222,17 +208,8 @@ SharpnessManipulator::thread_function(int32 thread_number)
 		// Here handle the whole image.
 		int32 left = target_bitmap->Bounds().left;
 		int32 right = target_bitmap->Bounds().right;
-		int32 top = target_bitmap->Bounds().top;
-		int32 bottom = target_bitmap->Bounds().bottom;
-
-		float height = bottom - top;
-		top = height / processor_count * thread_number;
-		top = ceil(top / (float)step);
-		top *= step;
-		bottom = min_c(bottom, top + (height + 1) / processor_count);
-		int32 update_interval = 10;
-		float update_amount = 100.0 / (bottom - top) * update_interval / (float)processor_count;
-		float missed_update = 0;
+		int32 top = target_bitmap->Bounds().top + first_row * step;
+		int32 bottom = target_bitmap->Bounds().top + (last_row - 1) * step;
 
 		// Loop through all pixels in original.
 		for (int32 y = top; y <= bottom; y += step) {
@@ -253,34 +230,15 @@ SharpnessManipulator::thread_function(int32 thread_number)
 						+ ((b_color.bytes[2] * one_minus_coeff_fixed) >> 15)));
 				*(target_bits + x + y_times_target_bpr) = color.word;
 			}
-
-			// Update the status-bar
-			if (((y % update_interval) == 0) && (progress_bar_window != NULL)
-				&& (progress_bar_window->LockWithTimeout(0) == B_OK)) {
-				progress_bar->Update(update_amount + missed_update);
-				progress_bar_window->Unlock();
-				missed_update = 0;
-			} else if ((y % update_interval) == 0)
-				missed_update += update_amount;
 		}
 	} else {
 		// Here handle only those pixels for which selection->ContainsPoint(x,y) is true.
-		BRect rect = selection->GetBoundingRect();
+		BRect rect = selection->GetBoundingRect() & target_bitmap->Bounds();
 
 		int32 left = rect.left;
 		int32 right = rect.right;
-		int32 top = rect.top;
-		int32 bottom = rect.bottom;
-
-		float height = bottom - top;
-		top += height / processor_count * thread_number;
-		top *= step;
-		top /= step;
-
-		bottom = min_c(bottom, top + (height + 1) / processor_count);
-
-		int32 update_interval = 10;
-		float update_amount = 100.0 / (bottom - top) * update_interval / (float)processor_count;
+		int32 top = (int32)rect.top + first_row * step;
+		int32 bottom = (int32)rect.top + (last_row - 1) * step;
 
 		// Loop through all pixels in original.
 		for (int32 y = top; y <= bottom; y += step) {
@@ -303,13 +261,6 @@ SharpnessManipulator::thread_function(int32 thread_number)
 					*(target_bits + x + y_times_target_bpr) = color.word;
 				}
 			}
-
-			// Update the status-bar
-			if (((y % update_interval) == 0) && (progress_bar_window != NULL)
-				&& (progress_bar_window->LockWithTimeout(0) == B_OK)) {
-				progress_bar->Update(update_amount);
-				progress_bar_window->Unlock();
-			}
 		}
 	}
 
@@ -83,8 +83,8 @@ class SharpnessManipulator : public WindowGUIManipulator {
 
 			void		start_threads();
 
-	static	int32		thread_entry(void*);
-			int32		thread_function(int32);
+	static	void		thread_entry(void*, int32, int32);
+			int32		thread_function(int32, int32);
 
 			int32		processor_count;
 
@@ -23,6 +23,7 @@
 
 #include "AddOns.h"
 #include "ManipulatorInformer.h"
+#include "PointOperation.h"
 #include "Selection.h"
 #include "Threshold.h"
 #include "ThresholdView.h"
@@ -50,6 +51,62 @@ instantiate_add_on(BBitmap* bm, ManipulatorInformer* i)
 }
 
 
+// Replaces the pixels below the threshold with the dark color and the
+// others with the light color.
+class ThresholdOperation : public PointOperation {
+public:
+	ThresholdOperation(const ThresholdManipulatorSettings& settings,
+		rgb_color dark_color, rgb_color light_color)
+	{
+		threshold = settings.threshold;
+		mode = settings.mode;
+
+		dark.bytes[0] = dark_color.blue;
+		dark.bytes[1] = dark_color.green;
+		dark.bytes[2] = dark_color.red;
+		dark.bytes[3] = dark_color.alpha;
+
+		light.bytes[0] = light_color.blue;
+		light.bytes[1] = light_color.green;
+		light.bytes[2] = light_color.red;
+		light.bytes[3] = light_color.alpha;
+	}
+
+	uint32 Apply(uint32 bgra) const
+	{
+		union {
+			uint8 bytes[4];
+			uint32 word;
+		} color;
+
+		color.word = bgra;
+		uint32 value = 0;
+		if (mode == HISTOGRAM_MODE_INTENSITY) {
+			value
+				= (0.114 * color.bytes[0]
+				+ 0.587 * color.bytes[1]
+				+ 0.299 * color.bytes[2]);
+		} else if (mode == HISTOGRAM_MODE_RED)
+			value = color.bytes[2];
+		else if (mode == HISTOGRAM_MODE_GREEN)
+			value = color.bytes[1];
+		else if (mode == HISTOGRAM_MODE_BLUE)
+			value = color.bytes[0];
+
+		return (value < threshold) ? dark.word : light.word;
+	}
+
+private:
+	uint32	threshold;
+	int32	mode;
+
+	union {
+		uint8 bytes[4];
+		uint32 word;
+	} dark, light;
+};
+
+
 ThresholdManipulator::ThresholdManipulator(BBitmap* bm, ManipulatorInformer* i)
 	:
 	WindowGUIManipulator(),
@@ -148,176 +205,10 @@ ThresholdManipulator::PreviewBitmap(bool full_quality, BRegion* updated_region)
 void
 ThresholdManipulator::start_threads()
 {
-	number_of_threads = GetSystemCpuCount();
-
-	thread_id* threads = new thread_id[number_of_threads];
-
-	for (int32 i = 0; i < number_of_threads; i++) {
-		threads[i] = spawn_thread(thread_entry, "threshold_thread", B_NORMAL_PRIORITY, this);
-		resume_thread(threads[i]);
-		send_data(threads[i], i, NULL, 0);
-	}
-
-	for (int32 i = 0; i < number_of_threads; i++) {
-		int32 return_value;
-		wait_for_thread(threads[i], &return_value);
-	}
-
-	delete[] threads;
-}
-
-
-int32
-ThresholdManipulator::thread_entry(void* data)
-{
-	int32 thread_number;
-	thread_number = receive_data(NULL, NULL, 0);
-
-	ThresholdManipulator* this_pointer = (ThresholdManipulator*)data;
-
-	return this_pointer->thread_function(thread_number);
-}
-
-
-int32
-ThresholdManipulator::thread_function(int32 thread_number)
-{
-	int32 step = current_resolution;
-	uint32 threshold = settings.threshold;
-	int32 mode = settings.mode;
-
-	BWindow* progress_bar_window = NULL;
-	if (progress_bar != NULL)
-		progress_bar_window = progress_bar->Window();
-
-	uint32* source_bits = (uint32*)source_bitmap->Bits();
-	uint32* target_bits = (uint32*)target_bitmap->Bits();
-	int32 source_bpr = source_bitmap->BytesPerRow() / 4;
-	int32 target_bpr = target_bitmap->BytesPerRow() / 4;
-
-	// This union must be used to guarantee endianness compatibility.
-	union {
-		uint8 bytes[4];
-		uint32 word;
-	} color, dark, light;
-
-	dark.bytes[0] = dark_color.blue;
-	dark.bytes[1] = dark_color.green;
-	dark.bytes[2] = dark_color.red;
-	dark.bytes[3] = dark_color.alpha;
-
-	light.bytes[0] = light_color.blue;
-	light.bytes[1] = light_color.green;
-	light.bytes[2] = light_color.red;
-	light.bytes[3] = light_color.alpha;
-
-	if (selection->IsEmpty()) {
-		// Here handle the whole image.
-		int32 left = target_bitmap->Bounds().left;
-		int32 right = target_bitmap->Bounds().right;
-		int32 top = target_bitmap->Bounds().top;
-		int32 bottom = target_bitmap->Bounds().bottom;
-
-		float height = bottom - top;
-		top = height / number_of_threads * thread_number;
-		top = ceil(top / (float)step);
-		top *= step;
-		bottom = min_c(bottom, top + (height + 1) / number_of_threads);
-		int32 update_interval = 10;
-		float update_amount = 100.0 / (bottom - top) * update_interval / (float)number_of_threads;
-		float missed_update = 0;
-
-		// Loop through all pixels in original.
-		uint32 value = 0;
-
-		for (int32 y = top; y <= bottom; y += step) {
-			int32 y_times_source_bpr = y * source_bpr;
-			int32 y_times_target_bpr = y * target_bpr;
-			for (int32 x = left; x <= right; x += step) {
-				color.word = *(source_bits + x + y_times_source_bpr);
-
-				if (mode == HISTOGRAM_MODE_INTENSITY) {
-					value
-						= (0.114 * color.bytes[0]
-						+ 0.587 * color.bytes[1]
-						+ 0.299 * color.bytes[2]);
-				} else if (mode == HISTOGRAM_MODE_RED)
-					value = color.bytes[2];
-				else if (mode == HISTOGRAM_MODE_GREEN)
-					value = color.bytes[1];
-				else if (mode == HISTOGRAM_MODE_BLUE)
-					value = color.bytes[0];
-
-				*(target_bits + x + y_times_target_bpr)
-					= ((value < threshold) ? dark.word : light.word);
-			}
-
-			// Update the status-bar
-			if (((y % update_interval) == 0) && (progress_bar_window != NULL)
-				&& (progress_bar_window->LockWithTimeout(0) == B_OK)) {
-				progress_bar->Update(update_amount + missed_update);
-				progress_bar_window->Unlock();
-				missed_update = 0;
-			} else if ((y % update_interval) == 0)
-				missed_update += update_amount;
-		}
-	} else {
-		// Here handle only those pixels for which selection->ContainsPoint(x,y) is true.
-		BRect rect = selection->GetBoundingRect();
-
-		int32 left = rect.left;
-		int32 right = rect.right;
-		int32 top = rect.top;
-		int32 bottom = rect.bottom;
-
-		float height = bottom - top;
-		top += height / number_of_threads * thread_number;
-		top *= step;
-		top /= step;
-
-		bottom = min_c(bottom, top + (height + 1) / number_of_threads);
-
-		int32 update_interval = 10;
-		float update_amount = 100.0 / (bottom - top) * update_interval / (float)number_of_threads;
-
-		// Loop through all pixels in original.
-		uint32 value = 0;
-
-		for (int32 y = top; y <= bottom; y += step) {
-			int32 y_times_source_bpr = y * source_bpr;
-			int32 y_times_target_bpr = y * target_bpr;
-			for (int32 x = left; x <= right; x += step) {
-				// Adjust only the pixels inside the selection.
-				if (selection->ContainsPoint(x, y)) {
-					color.word = *(source_bits + x + y_times_source_bpr);
-
-					if (mode == HISTOGRAM_MODE_INTENSITY) {
-						value
-							= (0.114 * color.bytes[0]
-							+ 0.587 * color.bytes[1]
-							+ 0.299 * color.bytes[2]);
-					} else if (mode == HISTOGRAM_MODE_RED)
-						value = color.bytes[2];
-					else if (mode == HISTOGRAM_MODE_GREEN)
-						value = color.bytes[1];
-					else if (mode == HISTOGRAM_MODE_BLUE)
-						value = color.bytes[0];
-
-					*(target_bits + x + y_times_target_bpr)
-						= ((value < threshold) ? dark.word : light.word);
-				}
-			}
-
-			// Update the status-bar
-			if (((y % update_interval) == 0) && (progress_bar_window != NULL)
-				&& (progress_bar_window->LockWithTimeout(0) == B_OK)) {
-				progress_bar->Update(update_amount);
-				progress_bar_window->Unlock();
-			}
-		}
-	}
-
-	return B_OK;
+	PointOperationPipeline pipeline;
+	pipeline.AddOperation(new ThresholdOperation(current_settings, dark_color, light_color));
+	pipeline.Apply(source_bitmap, target_bitmap, selection, current_resolution,
+		progress_bar);
 }
 
 
@@ -64,8 +64,7 @@ class ThresholdManipulator : public WindowGUIManipulator {
 			ThresholdManipulatorView*		config_view;
 
 
-			// The next attributes will be used by the thread_function.
-			int32	number_of_threads;
+			// The next attributes will be used by start_threads().
 			int32	current_resolution;
 
 			ThresholdManipulatorSettings	current_settings;
@@ -78,9 +77,6 @@ class ThresholdManipulator : public WindowGUIManipulator {
 
 			void		start_threads();
 
-	static	int32		thread_entry(void*);
-			int32		thread_function(int32);
-
 			rgb_color	light_color;
 			rgb_color	dark_color;
 
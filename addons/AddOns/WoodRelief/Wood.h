@@ -19,9 +19,8 @@ class WoodManipulator : public Manipulator {
 
 		BBitmap*	spare_copy_bitmap;
 
-static	int32		thread_entry(void*);
-		int32		thread_function(int32);
-		int			processor_count;
+static	void		thread_entry(void*, int32, int32);
+		int32		thread_function(int32, int32);
 
 public:
 					WoodManipulator();
@@ -0,0 +1,271 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+
+#include "BandOperation.h"
+
+#include "Selection.h"
+#include "WorkerPool.h"
+
+
+#include <Bitmap.h>
+#include <StatusBar.h>
+#include <Window.h>
+
+
+#include <new>
+#include <string.h>
+
+
+const int32 kBandHeight = 64;
+
+
+BandProcessor::BandProcessor()
+	:
+	fOperation(NULL),
+	fSelection(NULL),
+	fBandCount(1),
+	fInput(NULL),
+	fOutput(NULL),
+	fBandTop(NULL),
+	fPendingTop(NULL),
+	fSavedRows(NULL)
+{
+}
+
+
+BandProcessor::~BandProcessor()
+{
+	_FreeBuffers();
+}
+
+
+status_t
+BandProcessor::Apply(BandOperation* operation, BBitmap* bitmap,
+	Selection* selection, BStatusBar* progress_bar, int32 band_count)
+{
+	if (operation == NULL || bitmap == NULL)
+		return B_BAD_VALUE;
+
+	fOperation = operation;
+	fSelection = selection;
+	if (fSelection != NULL && fSelection->IsEmpty())
+		fSelection = NULL;
+	fBandCount = max_c(band_count, 1);
+
+	fBits = (uint32*)bitmap->Bits();
+	fBpr = bitmap->BytesPerRow() / 4;
+	fWidth = bitmap->Bounds().IntegerWidth() + 1;
+	fHeight = bitmap->Bounds().IntegerHeight() + 1;
+	fHalo = max_c(operation->Halo(), 0);
+
+	// The halo rows of a round must all come from the previous round, so
+	// a band is never lower than the halo.
+	fBandHeight = max_c(kBandHeight, fHalo);
+
+	BRect area = bitmap->Bounds();
+	if (fSelection != NULL)
+		area = area & fSelection->GetBoundingRect();
+	if (area.IsValid() == false)
+		return B_OK;
+
+	fLeft = (int32)area.left;
+	fTop = (int32)area.top;
+	fRight = (int32)area.right;
+	fBottom = (int32)area.bottom;
+
+	fInputBpr = fWidth + 2 * fHalo;
+	fInput = new (std::nothrow) uint32*[fBandCount];
+	fOutput = new (std::nothrow) uint32*[fBandCount];
+	if (fInput == NULL || fOutput == NULL) {
+		_FreeBuffers();
+		return B_NO_MEMORY;
+	}
+
+	for (int32 i = 0; i < fBandCount; i++)
+		fInput[i] = fOutput[i] = NULL;
+
+	bool out_of_memory = false;
+	for (int32 i = 0; i < fBandCount; i++) {
+		fInput[i] = new (std::nothrow) uint32[(fBandHeight + 2 * fHalo) * fInputBpr];
+		fOutput[i] = new (std::nothrow) uint32[fBandHeight * fWidth];
+		if (fInput[i] == NULL || fOutput[i] == NULL)
+			out_of_memory = true;
+	}
+
+	fBandTop = new (std::nothrow) int32[fBandCount];
+	fPendingTop = new (std::nothrow) int32[fBandCount];
+	fSavedRows = new (std::nothrow) uint32[max_c(fHalo, 1) * fWidth];
+	if (out_of_memory || fBandTop == NULL || fPendingTop == NULL
+		|| fSavedRows == NULL) {
+		_FreeBuffers();
+		return B_NO_MEMORY;
+	}
+
+	for (int32 i = 0; i < fBandCount; i++)
+		fPendingTop[i] = -1;
+
+	BWindow* progress_bar_window = NULL;
+	if (progress_bar != NULL)
+		progress_bar_window = progress_bar->Window();
+
+	int32 round_height = fBandHeight * fBandCount;
+	float update_amount = 100.0 * round_height / (fBottom - fTop + 1);
+	float missed_update = 0;
+
+	fRoundTop = fTop;
+	fSavedTop = fTop;
+	while (fRoundTop <= fBottom) {
+		for (int32 i = 0; i < fBandCount; i++) {
+			fBandTop[i] = fRoundTop + i * fBandHeight;
+			if (fBandTop[i] > fBottom)
+				fBandTop[i] = -1;
+		}
+
+		// The threads first write back the results of the previous round.
+		// None of those rows is read from the bitmap in this round.
+		_RunThreads();
+
+		// The rows above the next round have not been written back yet,
+		// save their original values for its halo.
+		int32 next_top = fRoundTop + round_height;
+		fSavedTop = next_top - fHalo;
+		for (int32 y = max_c(fSavedTop, 0); y < min_c(next_top, fHeight); y++) {
+			memcpy(fSavedRows + (y - fSavedTop) * fWidth, fBits + y * fBpr,
+				fWidth * sizeof(uint32));
+		}
+		fRoundTop = next_top;
+
+		if ((progress_bar_window != NULL)
+			&& (progress_bar_window->LockWithTimeout(0) == B_OK)) {
+			progress_bar->Update(min_c(update_amount + missed_update, 100.0));
+			progress_bar_window->Unlock();
+			missed_update = 0;
+		} else
+			missed_update += update_amount;
+	}
+
+	// Write back the results of the last round.
+	for (int32 i = 0; i < fBandCount; i++)
+		fBandTop[i] = -1;
+	_RunThreads();
+
+	_FreeBuffers();
+
+	return B_OK;
+}
+
+
+void
+BandProcessor::_RangeEntry(void* data, int32 first, int32 last)
+{
+	BandProcessor* processor = (BandProcessor*)data;
+
+	for (int32 i = first; i < last; i++) {
+		processor->_CommitBand(i);
+		if (processor->fBandTop[i] >= 0) {
+			processor->_ProcessBand(i);
+			processor->fPendingTop[i] = processor->fBandTop[i];
+		}
+	}
+}
+
+
+void
+BandProcessor::_RunThreads()
+{
+	WorkerPool* pool = WorkerPool::Instance();
+	if (pool != NULL)
+		pool->ParallelFor(0, fBandCount, _RangeEntry, this);
+	else
+		_RangeEntry(this, 0, fBandCount);
+}
+
+
+void
+BandProcessor::_ProcessBand(int32 band)
+{
+	int32 top = fBandTop[band];
+	int32 row_count = min_c(fBandHeight, fBottom - top + 1);
+
+	uint32* input = fInput[band];
+	for (int32 row = -fHalo; row < row_count + fHalo; row++)
+		_CopyRow(top + row, input + (row + fHalo) * fInputBpr);
+
+	fOperation->ProcessBand(input + fHalo * fInputBpr + fHalo, fInputBpr,
+		fOutput[band], fWidth, fWidth, top, row_count);
+}
+
+
+void
+BandProcessor::_CommitBand(int32 band)
+{
+	int32 top = fPendingTop[band];
+	if (top < 0)
+		return;
+
+	int32 row_count = min_c(fBandHeight, fBottom - top + 1);
+	uint32* output = fOutput[band];
+
+	for (int32 row = 0; row < row_count; row++) {
+		int32 y = top + row;
+		uint32* source = output + row * fWidth;
+		uint32* target = fBits + y * fBpr;
+		if (fSelection == NULL) {
+			memcpy(target, source, fWidth * sizeof(uint32));
+			continue;
+		}
+
+		for (int32 x = fLeft; x <= fRight; x++) {
+			if (fSelection->ContainsPoint(x, y))
+				target[x] = source[x];
+		}
+	}
+
+	fPendingTop[band] = -1;
+}
+
+
+void
+BandProcessor::_CopyRow(int32 y, uint32* target) const
+{
+	y = min_c(max_c(y, 0), fHeight - 1);
+
+	const uint32* source;
+	if (y < fRoundTop && y >= fSavedTop)
+		source = fSavedRows + (y - fSavedTop) * fWidth;
+	else
+		source = fBits + y * fBpr;
+
+	memcpy(target + fHalo, source, fWidth * sizeof(uint32));
+	for (int32 x = 0; x < fHalo; x++) {
+		target[x] = source[0];
+		target[fHalo + fWidth + x] = source[fWidth - 1];
+	}
+}
+
+
+void
+BandProcessor::_FreeBuffers()
+{
+	if (fInput != NULL && fOutput != NULL) {
+		for (int32 i = 0; i < fBandCount; i++) {
+			delete[] fInput[i];
+			delete[] fOutput[i];
+		}
+	}
+
+	delete[] fInput;
+	delete[] fOutput;
+	delete[] fBandTop;
+	delete[] fPendingTop;
+	delete[] fSavedRows;
+
+	fInput = NULL;
+	fOutput = NULL;
+	fBandTop = NULL;
+	fPendingTop = NULL;
+	fSavedRows = NULL;
+}
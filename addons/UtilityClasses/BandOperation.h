@@ -0,0 +1,100 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+#ifndef BAND_OPERATION_H
+#define	BAND_OPERATION_H
+
+#include <SupportDefs.h>
+
+
+class BBitmap;
+class BStatusBar;
+class Selection;
+
+
+/*
+	A BandOperation computes the new value of a pixel from the old values
+	of the pixels around it, at most Halo() pixels away in each direction.
+	The add-on only processes bands of rows: a BandProcessor copies each
+	band together with its halo to a small buffer, lets the operation write
+	the result to another buffer and copies the selected pixels back. The
+	add-on thus never needs a copy of the whole bitmap, and the bands are
+	processed in parallel.
+*/
+class BandOperation {
+public:
+	virtual					~BandOperation() {}
+
+	virtual	int32			Halo() const = 0;
+
+	// Filters row_count rows of width pixels. The source can be read
+	// Halo() pixels beyond the band on every side, the pixels outside of
+	// the image repeat the nearest edge pixel. first_row is the row of
+	// the image that the band starts from.
+	virtual	void			ProcessBand(const uint32* source, int32 source_bpr,
+								uint32* target, int32 target_bpr, int32 width,
+								int32 first_row, int32 row_count) = 0;
+};
+
+
+class BandProcessor {
+public:
+							BandProcessor();
+							~BandProcessor();
+
+			// Applies the operation to the bitmap in place. Only the
+			// selected pixels are changed. band_count bands are processed
+			// at a time by the threads of the WorkerPool, usually one for
+			// each processor. The extra memory is two buffers per band,
+			// whatever the size of the bitmap.
+			status_t		Apply(BandOperation* operation, BBitmap* bitmap,
+								Selection* selection, BStatusBar* progress_bar,
+								int32 band_count);
+
+private:
+	static	void			_RangeEntry(void* data, int32 first, int32 last);
+			void			_ProcessBand(int32 band);
+			void			_CommitBand(int32 band);
+			void			_CopyRow(int32 y, uint32* target) const;
+			void			_RunThreads();
+			void			_FreeBuffers();
+
+			BandOperation*	fOperation;
+			Selection*		fSelection;
+			int32			fBandCount;
+
+			uint32*			fBits;
+			int32			fBpr;
+			int32			fWidth;
+			int32			fHeight;
+			int32			fHalo;
+			int32			fBandHeight;
+
+			// The area that is changed.
+			int32			fLeft;
+			int32			fTop;
+			int32			fRight;
+			int32			fBottom;
+
+			// One input and one output buffer for each band. The input
+			// rows are Halo() pixels wider than the image on both sides.
+			uint32**		fInput;
+			uint32**		fOutput;
+			int32			fInputBpr;
+
+			// The bands that are processed in this round and the ones whose
+			// results still have to be written back.
+			int32*			fBandTop;
+			int32*			fPendingTop;
+
+			// The original values of the halo rows above this round. The
+			// rows themselves may already have been written back.
+			int32			fRoundTop;
+			uint32*			fSavedRows;
+			int32			fSavedTop;
+};
+
+
+#endif	// BAND_OPERATION_H
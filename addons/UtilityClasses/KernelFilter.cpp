@@ -0,0 +1,265 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+
+#include "KernelFilter.h"
+
+
+#include <Bitmap.h>
+
+
+#include <new>
+#include <string.h>
+
+
+// Boxes with at least this radius are summed from the summed-area table.
+const int32 kSummedAreaRadius = 2;
+
+// The table sums at most this many pixels without overflowing.
+const int32 kMaxSummedAreaPixels = 0x1000000;
+
+
+KernelFilter::KernelFilter()
+	:
+	fKind(BOX_BLUR),
+	fRadius(1),
+	fAmount(100),
+	fWeights(NULL),
+	fWeightSum(1),
+	fInputStride(0)
+{
+}
+
+
+KernelFilter::~KernelFilter()
+{
+	delete[] fWeights;
+}
+
+
+void
+KernelFilter::SetBlur(int32 radius)
+{
+	fKind = BOX_BLUR;
+	fRadius = max_c(radius, 1);
+}
+
+
+void
+KernelFilter::SetSharpen(int32 radius, int32 amount)
+{
+	fKind = UNSHARP_MASK;
+	fRadius = max_c(radius, 1);
+	fAmount = max_c(amount, 0);
+}
+
+
+status_t
+KernelFilter::SetKernel(const int32* weights, int32 size)
+{
+	if (weights == NULL || size < 1 || size % 2 == 0)
+		return B_BAD_VALUE;
+
+	int32* new_weights = new (std::nothrow) int32[size * size];
+	if (new_weights == NULL)
+		return B_NO_MEMORY;
+
+	delete[] fWeights;
+	fWeights = new_weights;
+	memcpy(fWeights, weights, size * size * sizeof(int32));
+
+	fWeightSum = 0;
+	for (int32 i = 0; i < size * size; i++)
+		fWeightSum += fWeights[i];
+	if (fWeightSum <= 0)
+		fWeightSum = 1;
+
+	fKind = CUSTOM_KERNEL;
+	fRadius = size / 2;
+
+	return B_OK;
+}
+
+
+status_t
+KernelFilter::Apply(BBitmap* source, BRect area, const uint8* mask,
+	int32 mask_bpr, uint32* target, int32 target_bpr)
+{
+	area = area & source->Bounds();
+	if (area.IsValid() == false)
+		return B_OK;
+
+	int32 left = (int32)area.left;
+	int32 top = (int32)area.top;
+	int32 width = area.IntegerWidth() + 1;
+	int32 height = area.IntegerHeight() + 1;
+	int32 r = fRadius;
+	int32 input_width = width + 2 * r;
+	int32 input_height = height + 2 * r;
+
+	bool summed_area = (fKind != CUSTOM_KERNEL) && (r >= kSummedAreaRadius)
+		&& (input_width * input_height <= kMaxSummedAreaPixels);
+
+	if (_ReserveBuffers(input_width, input_height, summed_area) != B_OK)
+		return B_NO_MEMORY;
+
+	_CopyArea(source, left - r, top - r, input_width, input_height);
+	if (summed_area)
+		_MakeSummedAreaTable(input_width, input_height);
+
+	int32 side = 2 * r + 1;
+	uint32 count = side * side;
+
+	for (int32 y = 0; y < height; y++) {
+		const uint32* input_row = fInput.Row<uint32>(y + r) + r;
+		const uint8* mask_row = (mask != NULL) ? mask + y * mask_bpr : NULL;
+		uint32* target_row = target + y * target_bpr;
+
+		for (int32 x = 0; x < width; x++) {
+			if (mask_row != NULL && mask_row[x] == 0) {
+				target_row[x] = input_row[x];
+				continue;
+			}
+
+			uint8 result[4];
+			const uint8* pixel = (const uint8*)(input_row + x);
+
+			if (fKind == CUSTOM_KERNEL) {
+				int32 sums[4] = { 0, 0, 0, 0 };
+				const int32* weight = fWeights;
+				for (int32 dy = -r; dy <= r; dy++) {
+					const uint8* p = (const uint8*)(input_row + dy * fInputStride + x - r);
+					for (int32 dx = 0; dx < side; dx++) {
+						for (int32 c = 0; c < 4; c++)
+							sums[c] += *weight * p[c];
+						weight++;
+						p += 4;
+					}
+				}
+				for (int32 c = 0; c < 4; c++) {
+					int32 value = (sums[c] + fWeightSum / 2) / fWeightSum;
+					result[c] = min_c(max_c(value, 0), 255);
+				}
+			} else {
+				uint32 sums[4];
+				if (summed_area)
+					_BoxSum(x, y, sums);
+				else {
+					sums[0] = sums[1] = sums[2] = sums[3] = 0;
+					for (int32 dy = -r; dy <= r; dy++) {
+						const uint8* p
+							= (const uint8*)(input_row + dy * fInputStride + x - r);
+						for (int32 dx = 0; dx < side; dx++) {
+							for (int32 c = 0; c < 4; c++)
+								sums[c] += p[c];
+							p += 4;
+						}
+					}
+				}
+
+				// The division is exact, a rounded reciprocal would make
+				// some radii overflow to 256 or come out dark.
+				for (int32 c = 0; c < 4; c++)
+					result[c] = min_c((sums[c] + count / 2) / count, 255);
+
+				if (fKind == UNSHARP_MASK) {
+					for (int32 c = 0; c < 3; c++) {
+						int32 value = pixel[c] + (pixel[c] - result[c]) * fAmount / 100;
+						result[c] = min_c(max_c(value, 0), 255);
+					}
+					result[3] = pixel[3];
+				}
+			}
+
+			memcpy(target_row + x, result, sizeof(uint32));
+		}
+	}
+
+	return B_OK;
+}
+
+
+status_t
+KernelFilter::_ReserveBuffers(int32 width, int32 height, bool summed_area)
+{
+	// The buffers are kept between the dabs and keep their memory when the
+	// dab gets smaller.
+	if (fInput.SetTo(BRect(0, 0, width - 1, height - 1), 4) != B_OK)
+		return B_NO_MEMORY;
+	fInputStride = fInput.BytesPerRow() / 4;
+
+	if (summed_area) {
+		// Four sums for each pixel.
+		if (fSums.SetTo(BRect(0, 0, width, height), 16) != B_OK)
+			return B_NO_MEMORY;
+	}
+
+	return B_OK;
+}
+
+
+void
+KernelFilter::_CopyArea(BBitmap* source, int32 left, int32 top,
+	int32 width, int32 height)
+{
+	const uint32* bits = (const uint32*)source->Bits();
+	int32 bpr = source->BytesPerRow() / 4;
+	int32 source_width = source->Bounds().IntegerWidth() + 1;
+	int32 source_height = source->Bounds().IntegerHeight() + 1;
+
+	int32 first_x = min_c(max_c(-left, 0), width);
+	int32 last_x = max_c(min_c(source_width - left, width), first_x);
+
+	for (int32 y = 0; y < height; y++) {
+		int32 source_y = min_c(max_c(top + y, 0), source_height - 1);
+		const uint32* source_row = bits + source_y * bpr;
+		uint32* row = fInput.Row<uint32>(y);
+
+		for (int32 x = 0; x < first_x; x++)
+			row[x] = source_row[0];
+		memcpy(row + first_x, source_row + left + first_x,
+			(last_x - first_x) * sizeof(uint32));
+		for (int32 x = last_x; x < width; x++)
+			row[x] = source_row[source_width - 1];
+	}
+}
+
+
+void
+KernelFilter::_MakeSummedAreaTable(int32 width, int32 height)
+{
+	memset(fSums.Row<uint32>(0), 0, (width + 1) * 4 * sizeof(uint32));
+
+	for (int32 y = 0; y < height; y++) {
+		const uint8* p = fInput.Row<uint8>(y);
+		const uint32* above = fSums.Row<uint32>(y);
+		uint32* row = fSums.Row<uint32>(y + 1);
+		uint32 row_sums[4] = { 0, 0, 0, 0 };
+
+		row[0] = row[1] = row[2] = row[3] = 0;
+		for (int32 x = 0; x < width; x++) {
+			for (int32 c = 0; c < 4; c++) {
+				row_sums[c] += p[c];
+				row[(x + 1) * 4 + c] = above[(x + 1) * 4 + c] + row_sums[c];
+			}
+			p += 4;
+		}
+	}
+}
+
+
+void
+KernelFilter::_BoxSum(int32 x, int32 y, uint32 sums[4]) const
+{
+	// The box of the pixel x, y of the area starts at x, y of the input.
+	int32 side = 2 * fRadius + 1;
+	const uint32* top_row = fSums.Row<uint32>(y);
+	const uint32* bottom_row = fSums.Row<uint32>(y + side);
+
+	for (int32 c = 0; c < 4; c++) {
+		sums[c] = bottom_row[(x + side) * 4 + c] - bottom_row[x * 4 + c]
+			- top_row[(x + side) * 4 + c] + top_row[x * 4 + c];
+	}
+}
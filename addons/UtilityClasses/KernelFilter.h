@@ -0,0 +1,89 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+#ifndef KERNEL_FILTER_H
+#define	KERNEL_FILTER_H
+
+#include "PixelBuffer.h"
+
+#include <Rect.h>
+#include <SupportDefs.h>
+
+
+class BBitmap;
+
+
+/*
+	A KernelFilter computes the new value of a pixel as a weighted sum of the
+	pixels around it. The filter brushes only filter the pixels under the
+	dab, so the filter is applied to a small area of the bitmap at a time.
+
+	The weights are integers and the sums are divided by the total weight.
+	Blurring with a box and sharpening by unsharp masking use a summed-area
+	table of the area when the box is large, which makes their cost per pixel
+	independent of the radius. Any other kernel, for example one that an
+	add-on supplies, is convolved directly.
+*/
+class KernelFilter {
+public:
+	enum filter_kind {
+		BOX_BLUR = 0,
+		UNSHARP_MASK,
+		CUSTOM_KERNEL
+	};
+
+							KernelFilter();
+							~KernelFilter();
+
+			// Averages the pixels in a (2 * radius + 1) sized square.
+			void			SetBlur(int32 radius);
+
+			// Adds the difference of the pixel and the box blur of the given
+			// radius to the pixel, amount is in percents. Alpha is not
+			// changed.
+			void			SetSharpen(int32 radius, int32 amount);
+
+			// The kernel has size * size weights in rows, size must be odd.
+			// The sum of the weights should be positive.
+			status_t		SetKernel(const int32* weights, int32 size);
+
+			filter_kind		Kind() const { return fKind; }
+			int32			Radius() const { return fRadius; }
+
+			// Filters the pixels of area whose mask value is not zero and
+			// writes them to target, which has room for the area. The other
+			// pixels are copied as they are. The mask has one value for each
+			// pixel of the area, mask_bpr per row, NULL filters all of them.
+			// The pixels outside of the bitmap repeat the nearest edge pixel.
+			status_t		Apply(BBitmap* source, BRect area,
+								const uint8* mask, int32 mask_bpr,
+								uint32* target, int32 target_bpr);
+
+private:
+			status_t		_ReserveBuffers(int32 width, int32 height,
+								bool summed_area);
+			void			_CopyArea(BBitmap* source, int32 left,
+								int32 top, int32 width, int32 height);
+			void			_MakeSummedAreaTable(int32 width, int32 height);
+	inline	void			_BoxSum(int32 x, int32 y, uint32 sums[4]) const;
+
+			filter_kind		fKind;
+			int32			fRadius;
+			int32			fAmount;
+
+			int32*			fWeights;
+			int32			fWeightSum;
+
+			// The area and the radius around it as a copy of the bitmap, and
+			// the summed-area table of each channel. The table has one extra
+			// row and column of zeros at the top and left. Both are taken
+			// from the PixelBufferPool, the stride of the input is in pixels.
+			PixelBuffer		fInput;
+			int32			fInputStride;
+			PixelBuffer		fSums;
+};
+
+
+#endif	// KERNEL_FILTER_H
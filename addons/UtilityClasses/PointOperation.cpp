@@ -0,0 +1,252 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+
+#include "PointOperation.h"
+
+#include "Selection.h"
+#include "WorkerPool.h"
+
+
+#include <Bitmap.h>
+
+
+#include <string.h>
+
+
+ChannelMapOperation::ChannelMapOperation()
+{
+	for (int32 i = 0; i < 256; i++)
+		fTables[0][i] = fTables[1][i] = fTables[2][i] = i;
+}
+
+
+void
+ChannelMapOperation::SetTables(const uint8* table)
+{
+	// Uses the same table for all of the color channels.
+	for (int32 channel = 0; channel < 3; channel++)
+		memcpy(fTables[channel], table, 256);
+}
+
+
+uint32
+ChannelMapOperation::Apply(uint32 bgra) const
+{
+	union {
+		uint8 bytes[4];
+		uint32 word;
+	} color;
+
+	color.word = bgra;
+	color.bytes[0] = fTables[0][color.bytes[0]];
+	color.bytes[1] = fTables[1][color.bytes[1]];
+	color.bytes[2] = fTables[2][color.bytes[2]];
+	return color.word;
+}
+
+
+bool
+ChannelMapOperation::GetChannelTables(uint8 tables[3][256]) const
+{
+	memcpy(tables, fTables, sizeof(fTables));
+	return true;
+}
+
+
+PointOperationPipeline::PointOperationPipeline()
+	:
+	fStages(NULL),
+	fStageCount(0),
+	fSource(NULL),
+	fTarget(NULL),
+	fSelection(NULL),
+	fStep(1),
+	fLeft(0),
+	fRight(-1),
+	fTop(0)
+{
+}
+
+
+PointOperationPipeline::~PointOperationPipeline()
+{
+	MakeEmpty();
+}
+
+
+void
+PointOperationPipeline::AddOperation(PointOperation* operation)
+{
+	if (operation != NULL)
+		fOperations.AddItem(operation);
+}
+
+
+void
+PointOperationPipeline::MakeEmpty()
+{
+	for (int32 i = 0; i < fOperations.CountItems(); i++)
+		delete (PointOperation*)fOperations.ItemAt(i);
+	fOperations.MakeEmpty();
+
+	delete[] fStages;
+	fStages = NULL;
+	fStageCount = 0;
+}
+
+
+void
+PointOperationPipeline::Apply(BBitmap* source, BBitmap* target,
+	Selection* selection, int32 step, BStatusBar* progress_bar)
+{
+	if (source == NULL || target == NULL || source->Bounds() != target->Bounds())
+		return;
+
+	_Compile();
+
+	fSource = source;
+	fTarget = target;
+	fSelection = selection;
+	fStep = max_c(step, 1);
+
+	// The pixels outside of the selection are not touched by the loop, so a
+	// separate target must start out as a copy of the source.
+	if (source != target && fStep == 1 && selection != NULL
+		&& selection->IsEmpty() == false)
+		memcpy(target->Bits(), source->Bits(), target->BitsLength());
+
+	BRect rect = target->Bounds();
+	if (selection != NULL && selection->IsEmpty() == false)
+		rect = rect & selection->GetBoundingRect();
+
+	if (rect.IsValid() == true) {
+		fLeft = (int32)rect.left;
+		fRight = (int32)rect.right;
+		fTop = (int32)rect.top;
+
+		// The range is over the rows that are calculated, not over all of
+		// the rows of the bitmap.
+		int32 row_count = ((int32)rect.bottom - fTop) / fStep + 1;
+		WorkerPool* pool = WorkerPool::Instance();
+		if (pool != NULL)
+			pool->ParallelFor(0, row_count, _RangeEntry, this, progress_bar);
+		else
+			_ProcessRows(0, row_count);
+	}
+
+	fSource = fTarget = NULL;
+	fSelection = NULL;
+}
+
+
+void
+PointOperationPipeline::_Compile()
+{
+	// Consecutive channel maps are composed into one set of tables. Every
+	// other operation becomes a stage of its own.
+	delete[] fStages;
+	fStages = new stage[max_c(fOperations.CountItems(), 1)];
+	fStageCount = 0;
+
+	uint8 tables[3][256];
+	for (int32 i = 0; i < fOperations.CountItems(); i++) {
+		PointOperation* operation = (PointOperation*)fOperations.ItemAt(i);
+		if (operation->GetChannelTables(tables) == false) {
+			fStages[fStageCount].operation = operation;
+			fStageCount++;
+			continue;
+		}
+
+		if (fStageCount > 0 && fStages[fStageCount - 1].operation == NULL) {
+			stage& previous = fStages[fStageCount - 1];
+			for (int32 channel = 0; channel < 3; channel++) {
+				for (int32 value = 0; value < 256; value++) {
+					previous.tables[channel][value]
+						= tables[channel][previous.tables[channel][value]];
+				}
+			}
+		} else {
+			fStages[fStageCount].operation = NULL;
+			memcpy(fStages[fStageCount].tables, tables, sizeof(tables));
+			fStageCount++;
+		}
+	}
+}
+
+
+inline uint32
+PointOperationPipeline::_ApplyStages(uint32 bgra) const
+{
+	union {
+		uint8 bytes[4];
+		uint32 word;
+	} color;
+
+	color.word = bgra;
+	for (int32 i = 0; i < fStageCount; i++) {
+		const stage& current = fStages[i];
+		if (current.operation != NULL)
+			color.word = current.operation->Apply(color.word);
+		else {
+			color.bytes[0] = current.tables[0][color.bytes[0]];
+			color.bytes[1] = current.tables[1][color.bytes[1]];
+			color.bytes[2] = current.tables[2][color.bytes[2]];
+		}
+	}
+	return color.word;
+}
+
+
+void
+PointOperationPipeline::_RangeEntry(void* data, int32 first_row, int32 last_row)
+{
+	((PointOperationPipeline*)data)->_ProcessRows(first_row, last_row);
+}
+
+
+void
+PointOperationPipeline::_ProcessRows(int32 first_row, int32 last_row)
+{
+	bool has_selection = fSelection != NULL && fSelection->IsEmpty() == false;
+
+	int32 left = fLeft;
+	int32 right = fRight;
+	int32 top = fTop + first_row * fStep;
+	int32 bottom = fTop + (last_row - 1) * fStep;
+
+	uint32* source_bits = (uint32*)fSource->Bits();
+	uint32* target_bits = (uint32*)fTarget->Bits();
+	int32 source_bpr = fSource->BytesPerRow() / 4;
+	int32 target_bpr = fTarget->BytesPerRow() / 4;
+
+	// A single channel map is the common case and gets a loop of its own.
+	const stage* single_map = NULL;
+	if (fStageCount == 1 && fStages[0].operation == NULL)
+		single_map = &fStages[0];
+
+	union {
+		uint8 bytes[4];
+		uint32 word;
+	} color;
+
+	for (int32 y = top; y <= bottom; y += fStep) {
+		uint32* source = source_bits + y * source_bpr;
+		uint32* target = target_bits + y * target_bpr;
+		for (int32 x = left; x <= right; x += fStep) {
+			if (has_selection && fSelection->ContainsPoint(x, y) == false)
+				continue;
+
+			if (single_map != NULL) {
+				color.word = source[x];
+				color.bytes[0] = single_map->tables[0][color.bytes[0]];
+				color.bytes[1] = single_map->tables[1][color.bytes[1]];
+				color.bytes[2] = single_map->tables[2][color.bytes[2]];
+				target[x] = color.word;
+			} else
+				target[x] = _ApplyStages(source[x]);
+		}
+	}
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+#ifndef POINT_OPERATION_H
+#define	POINT_OPERATION_H
+
+#include <List.h>
+#include <SupportDefs.h>
+
+
+class BBitmap;
+class BStatusBar;
+class Selection;
+
+
+/*
+	A PointOperation computes the new value of a pixel from the old value of
+	the same pixel only. The color add-ons describe their adjustment with a
+	PointOperation and let a PointOperationPipeline apply it, so that several
+	adjustments can be done in one pass over the bitmap.
+
+	Operations that treat each color channel separately should derive from
+	ChannelMapOperation. The pipeline composes consecutive channel maps into
+	a single set of tables.
+*/
+class PointOperation {
+public:
+	virtual					~PointOperation() {}
+
+	virtual	uint32			Apply(uint32 bgra) const = 0;
+
+	// Returns true if the operation is a channel map and copies its tables.
+	virtual	bool			GetChannelTables(uint8 tables[3][256]) const
+								{ return false; }
+};
+
+
+// Maps the blue, green and red channels through tables, alpha is left as
+// it is. The tables start out as the identity.
+class ChannelMapOperation : public PointOperation {
+public:
+							ChannelMapOperation();
+
+			uint8*			Table(int32 channel) { return fTables[channel]; }
+			void			SetTables(const uint8* table);
+
+	virtual	uint32			Apply(uint32 bgra) const;
+	virtual	bool			GetChannelTables(uint8 tables[3][256]) const;
+
+private:
+			uint8			fTables[3][256];
+};
+
+
+class PointOperationPipeline {
+public:
+							PointOperationPipeline();
+							~PointOperationPipeline();
+
+			// The pipeline takes the ownership of the operation.
+			void			AddOperation(PointOperation* operation);
+			void			MakeEmpty();
+			int32			CountOperations() const
+								{ return fOperations.CountItems(); }
+
+			// Applies the operations to every step'th pixel of every
+			// step'th row and writes the results to target. Source and
+			// target must have the same bounds and may be the same bitmap.
+			// Only the selected pixels are changed. The rows are divided
+			// between the threads of the WorkerPool.
+			void			Apply(BBitmap* source, BBitmap* target,
+								Selection* selection, int32 step,
+								BStatusBar* progress_bar);
+
+private:
+	struct stage {
+		PointOperation*	operation;
+		uint8			tables[3][256];
+	};
+
+			void			_Compile();
+	static	void			_RangeEntry(void* data, int32 first_row,
+								int32 last_row);
+			void			_ProcessRows(int32 first_row, int32 last_row);
+	inline	uint32			_ApplyStages(uint32 bgra) const;
+
+			BList			fOperations;
+
+			stage*			fStages;
+			int32			fStageCount;
+
+			// These are only valid while Apply() is running.
+			BBitmap*		fSource;
+			BBitmap*		fTarget;
+			Selection*		fSelection;
+			int32			fStep;
+			int32			fLeft;
+			int32			fRight;
+			int32			fTop;
+};
+
+
+#endif	// POINT_OPERATION_H
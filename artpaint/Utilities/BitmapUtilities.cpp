@@ -10,14 +10,22 @@
 
 #include "BitmapUtilities.h"
 
+#include "BitmapDrawer.h"
+#include "CompositeOperators.h"
 #include "HSPolygon.h"
 #include "PixelOperations.h"
 #include "UtilityClasses.h"
 
 
+#include <OS.h>
 #include <Screen.h>
 
 
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+
 status_t
 BitmapUtilities::FixMissingAlpha(BBitmap* bitmap)
 {
@@ -161,8 +169,20 @@ BitmapUtilities::ConvertToMask(BBitmap* inBitmap, uint8 color)
 void
 BitmapUtilities::CompositeBitmapOnSource(BBitmap* toBuffer, BBitmap* srcBuffer, BBitmap* fromBuffer,
 	BRect updated_rect, uint32 (*composite_func)(uint32, uint32), uint32 color)
+{
+	RETURN_WITH_COMPOSITE_OPERATOR(composite_func, _CompositeBitmapOnSource,
+		toBuffer, srcBuffer, fromBuffer, updated_rect, color);
+}
+
+
+template<class Operator>
+void
+BitmapUtilities::_CompositeBitmapOnSource(BBitmap* toBuffer, BBitmap* srcBuffer,
+	BBitmap* fromBuffer, BRect updated_rect, uint32 color, Operator op)
 {
 	updated_rect = updated_rect & toBuffer->Bounds();
+	if (updated_rect.IsValid() == false)
+		return;
 
 	int32 bpr = toBuffer->BytesPerRow() / 4;
 	int32 width = updated_rect.IntegerWidth() + 1;
@@ -180,18 +200,19 @@ BitmapUtilities::CompositeBitmapOnSource(BBitmap* toBuffer, BBitmap* srcBuffer,
 	src_bits += bpr * start_y + start_x;
 	from_bits += bpr * start_y + start_x;
 
-	for (int y = 0; y < height; y++) {
-		int32 ypos = y * bpr;
-		for (int x = 0; x < width; x++) {
-			union color_conversion from_color, mix_color;
-			from_color.word = *(from_bits + x + ypos);
-			mix_color.word = color;
-			for (int i = 0; i < 4; ++i)
-				from_color.bytes[i] = (uint8)((from_color.bytes[i] * mix_color.bytes[i]) / 255);
-
-			*bits++ = (*composite_func)(*(src_bits + x + ypos), from_color.word);
+	// Multiplying by white does not change anything, so the common case
+	// gets a loop without it.
+	for (int32 y = 0; y < height; y++) {
+		if (color == 0xffffffff) {
+			for (int32 x = 0; x < width; x++)
+				bits[x] = op(src_bits[x], from_bits[x]);
+		} else {
+			for (int32 x = 0; x < width; x++)
+				bits[x] = op(src_bits[x], multiply_pixel(from_bits[x], color));
 		}
-		bits += bpr - width;
+		bits += bpr;
+		src_bits += bpr;
+		from_bits += bpr;
 	}
 }
 
@@ -310,7 +331,8 @@ BitmapUtilities::GetPixel(BBitmap* bitmap, BPoint location)
 
 
 void
-BitmapUtilities::RasterToPolygonsMoore(BBitmap* bitmap, BRect bounds, BList* polygons)
+BitmapUtilities::RasterToPolygonsMoore(BBitmap* bitmap, BRect bounds, BList* polygons,
+	uint32 threshold)
 {
 	// This function uses the selection_map to make
 	// a new set of polygons that make up the selection.
@@ -353,7 +375,7 @@ BitmapUtilities::RasterToPolygonsMoore(BBitmap* bitmap, BRect bounds, BList* pol
 
 			pos = BPoint(x, y);
 
-			bool containsPoint = (BitmapUtilities::GetPixel(bitmap, (int32)x, (int32)y) != 0x00);
+			bool containsPoint = (BitmapUtilities::GetPixel(bitmap, (int32)x, (int32)y) >= threshold);
 
 			if (included_points->HasPoint(x, y) && inside == false)
 				inside = true;
@@ -386,7 +408,7 @@ BitmapUtilities::RasterToPolygonsMoore(BBitmap* bitmap, BRect bounds, BList* pol
 					int newCheckLocation = next[checkLocation - 1];
 
 					bool containsPoint
-						= (GetPixel(bitmap, (int32)check.x, (int32)check.y) != 0x00);
+						= (GetPixel(bitmap, (int32)check.x, (int32)check.y) >= threshold);
 					if (containsPoint) {
 						int prevCheckLocation = checkLocation;
 						checkLocation = newCheckLocation;
@@ -546,3 +568,148 @@ BitmapUtilities::RasterToPolygonsMoore(BBitmap* bitmap, BRect bounds, BList* pol
 
 	delete included_points;
 }
+
+
+static uint32
+replace_pixel(uint32 dst, uint32 src)
+{
+	return src;
+}
+
+
+static uint32
+multiply_blend_fixed(uint32 dst, uint32 src)
+{
+	return src_over_fixed_blend(dst, src, BLEND_MULTIPLY);
+}
+
+
+// Used for the function pointer column of FillRectangle(), which would
+// otherwise recognize src_over_fixed.
+static uint32
+src_over_through_pointer(uint32 dst, uint32 src)
+{
+	return src_over_fixed(dst, src);
+}
+
+
+template<class Operator>
+bigtime_t
+BitmapUtilities::_TimeComposite(BBitmap* toBuffer, BBitmap* srcBuffer,
+	BBitmap* fromBuffer, uint32 color, int32 rounds, Operator op)
+{
+	bigtime_t start = system_time();
+	for (int32 r = 0; r < rounds; r++) {
+		_CompositeBitmapOnSource(toBuffer, srcBuffer, fromBuffer,
+			toBuffer->Bounds(), color, op);
+	}
+	return system_time() - start;
+}
+
+
+void
+BitmapUtilities::RunCompositeBenchmark(int32 width, int32 height, int32 rounds)
+{
+	BRect bounds(0, 0, width - 1, height - 1);
+	BBitmap* to = new (std::nothrow) BBitmap(bounds, B_RGBA32);
+	BBitmap* src = new (std::nothrow) BBitmap(bounds, B_RGBA32);
+	BBitmap* from = new (std::nothrow) BBitmap(bounds, B_RGBA32);
+
+	if (to == NULL || src == NULL || from == NULL || to->IsValid() == false
+		|| src->IsValid() == false || from->IsValid() == false) {
+		printf("Not enough memory for a %" B_PRId32 "x%" B_PRId32 " benchmark\n",
+			width, height);
+		delete to;
+		delete src;
+		delete from;
+		return;
+	}
+
+	// Semi-transparent noise so that none of the early outs in the
+	// operators are taken. The source is not written to, so every round
+	// does the same work.
+	uint32* src_bits = (uint32*)src->Bits();
+	uint32* from_bits = (uint32*)from->Bits();
+	int32 pixel_count = src->BitsLength() / 4;
+	srand(1);
+	for (int32 i = 0; i < pixel_count; i++) {
+		union color_conversion c;
+		c.word = rand();
+		c.bytes[3] = 64 + (c.bytes[3] & 0x7F);
+		from_bits[i] = c.word;
+		c.word = rand();
+		c.bytes[3] = 128 + (c.bytes[3] & 0x7F);
+		src_bits[i] = c.word;
+	}
+
+	struct {
+		const char*	name;
+		uint32		(*function)(uint32, uint32);
+		uint32		color;
+	} cases[] = {
+		{ "src_over", src_over_fixed, 0xffffffff },
+		{ "src_over with color", src_over_fixed, 0xc08040ff },
+		{ "dst_out (erase)", dst_out_fixed, 0xffffffff },
+		{ "replace", NULL, 0xffffffff },
+		{ "blend (multiply)", multiply_blend_fixed, 0xffffffff }
+	};
+
+	double megapixels = (double)width * height * rounds / 1000000.0;
+
+	printf("Compositing %" B_PRId32 "x%" B_PRId32 " pixels, %" B_PRId32 " rounds\n",
+		width, height, rounds);
+	printf("  %-28s %10s %10s  (Mpixels/s)\n", "", "pointer", "inlined");
+
+	for (uint32 i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		// The pointer is read through a volatile so that the compiler
+		// cannot see which function it calls.
+		uint32 (* volatile function)(uint32, uint32) = cases[i].function;
+		if (function == NULL)
+			function = replace_pixel;
+
+		bigtime_t pointer_time = _TimeComposite(to, src, from, cases[i].color,
+			rounds, function_operator(function));
+
+		bigtime_t inlined_time;
+		if (cases[i].function == NULL) {
+			inlined_time = _TimeComposite(to, src, from, cases[i].color, rounds,
+				replace_operator());
+		} else if (cases[i].function == src_over_fixed) {
+			inlined_time = _TimeComposite(to, src, from, cases[i].color, rounds,
+				src_over_operator());
+		} else if (cases[i].function == dst_out_fixed) {
+			inlined_time = _TimeComposite(to, src, from, cases[i].color, rounds,
+				dst_out_operator());
+		} else {
+			inlined_time = _TimeComposite(to, src, from, cases[i].color, rounds,
+				blend_operator(BLEND_MULTIPLY));
+		}
+
+		printf("  %-28s %10.1f %10.1f\n", cases[i].name,
+			megapixels / (pointer_time / 1000000.0),
+			megapixels / (inlined_time / 1000000.0));
+	}
+
+	// A whole tool stroke goes through BitmapDrawer, time its span fill too.
+	BPoint corners[4] = { BPoint(0, 0), BPoint(width - 1, 0),
+		BPoint(width - 1, height - 1), BPoint(0, height - 1) };
+	BitmapDrawer drawer(to);
+
+	bigtime_t start = system_time();
+	for (int32 r = 0; r < rounds; r++)
+		drawer.FillRectangle(corners, 0x80406080, NULL, src_over_through_pointer);
+	bigtime_t pointer_time = system_time() - start;
+
+	start = system_time();
+	for (int32 r = 0; r < rounds; r++)
+		drawer.FillRectangle(corners, 0x80406080, NULL, src_over_fixed);
+	bigtime_t inlined_time = system_time() - start;
+
+	printf("  %-28s %10.1f %10.1f\n", "FillRectangle (src_over)",
+		megapixels / (pointer_time / 1000000.0),
+		megapixels / (inlined_time / 1000000.0));
+
+	delete to;
+	delete src;
+	delete from;
+}
@@ -32,7 +32,23 @@ public:
 							uint32 grid_size, BRect* area = NULL);
 	static	uint32		GetPixel(BBitmap* bitmap, int32 x, int32 y);
 	static	uint32		GetPixel(BBitmap* bitmap, BPoint location);
-	static 	void		RasterToPolygonsMoore(BBitmap* bitmap, BRect bounds, BList* polygons);
+	// Traces the outlines of the pixels that are at least threshold.
+	static 	void		RasterToPolygonsMoore(BBitmap* bitmap, BRect bounds, BList* polygons,
+							uint32 threshold = 0x01);
+
+	// Prints the speed of the compositing loops for each operator, called
+	// through the function pointer and with the operator inlined.
+	static	void		RunCompositeBenchmark(int32 width, int32 height, int32 rounds);
+
+private:
+	template<class Operator>
+	static	void		_CompositeBitmapOnSource(BBitmap* toBuffer,
+							BBitmap* srcBuffer, BBitmap* fromBuffer,
+							BRect updated_rect, uint32 color, Operator op);
+	template<class Operator>
+	static	bigtime_t	_TimeComposite(BBitmap* toBuffer, BBitmap* srcBuffer,
+							BBitmap* fromBuffer, uint32 color, int32 rounds,
+							Operator op);
 };
 
 
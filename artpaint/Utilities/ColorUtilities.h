@@ -9,9 +9,65 @@
 #ifndef COLOR_UTILITIES_H
 #define COLOR_UTILITIES_H
 
+#include <SupportDefs.h>
+
 #include <math.h>
 
 
+// Conversions between the 8-bit sRGB encoded and the 16-bit linear light
+// values. The tables are in LinearBitmap.cpp.
+extern const uint16* srgb_to_linear_table;
+extern const uint16* linear_to_srgb_table;
+
+
+// The sRGB transfer function for a value between 0 and 255, interpolated
+// from the table. Gives the linear value between 0 and 1.
+inline float
+srgb_to_linear(float value)
+{
+	value = max_c(0, min_c(255, value));
+	int32 index = (int32)value;
+	if (index >= 255)
+		return srgb_to_linear_table[255] / 65535.;
+
+	float fraction = value - index;
+	return (srgb_to_linear_table[index] * (1 - fraction)
+		+ srgb_to_linear_table[index + 1] * fraction) / 65535.;
+}
+
+
+// The inverse of srgb_to_linear(), gives the encoded value between 0 and 255.
+inline float
+linear_to_srgb(float value)
+{
+	value = max_c(0, min_c(1, value));
+	return linear_to_srgb_table[(int32)(value * 65535. + 0.5)] / 256.;
+}
+
+
+// The bits of a float give an estimate of its cube root that three Newton
+// iterations refine to about float precision.
+inline float
+cube_root(float value)
+{
+	if (value <= 0)
+		return 0;
+
+	union {
+		float number;
+		uint32 bits;
+	} estimate;
+	estimate.number = value;
+	estimate.bits = estimate.bits / 3 + 709921077;
+
+	float root = estimate.number;
+	for (int32 i = 0; i < 3; i++)
+		root = (2 * root + value / (root * root)) / 3;
+
+	return root;
+}
+
+
 inline void
 lab2rgb(float l, float a, float bb,
 	float& r, float& g, float& b)
@@ -20,16 +76,16 @@ lab2rgb(float l, float a, float bb,
 	double x = (a / 500.) + y;
 	double z = y - (bb / 200.);
 
-	if (pow(y, 3) > 0.008856)
-		y = pow(y, 3);
+	if (y * y * y > 0.008856)
+		y = y * y * y;
 	else
 		y = (y - (16. / 116.)) / 7.787;
-	if (pow(x, 3) > 0.008856)
-		x = pow(x, 3);
+	if (x * x * x > 0.008856)
+		x = x * x * x;
 	else
 		x = (x - (16. / 116.)) / 7.787;
-	if (pow(z, 3) > 0.008856)
-		z = pow(z, 3);
+	if (z * z * z > 0.008856)
+		z = z * z * z;
 	else
 		z = (z - (16. / 116.)) / 7.787;
 
@@ -46,27 +102,9 @@ lab2rgb(float l, float a, float bb,
 	double dg = x * -0.9689 + y * 1.8758 + z * 0.0415;
 	double db = x * 0.0557 + y * -0.2040 + z * 1.0570;
 
-	float power = 1. / 2.4;
-	if (dr > 0.0031308)
-		dr = 1.055 * pow(dr, power) - 0.055;
-	else
-		dr *= 12.92;
-	if (dg > 0.0031308)
-		dg = 1.055 * pow(dg, power) - 0.055;
-	else
-		dg *= 12.92;
-	if (db > 0.0031308)
-		db = 1.055 * pow(db, power) - 0.055;
-	else
-		db *= 12.92;
-
-	dr *= 255.;
-	dg *= 255.;
-	db *= 255.;
-
-	r = max_c(0, min_c(255, dr));
-	g = max_c(0, min_c(255, dg));
-	b = max_c(0, min_c(255, db));
+	r = linear_to_srgb(dr);
+	g = linear_to_srgb(dg);
+	b = linear_to_srgb(db);
 }
 
 
@@ -74,28 +112,9 @@ inline void
 rgb2lab(float r, float g, float b,
 	float& l, float& a, float& bb)
 {
-	r /= 255.;
-	g /= 255.;
-	b /= 255.;
-
-	if (r > 0.04045)
-		r = pow(((r + 0.055) / 1.055), 2.4);
-	else
-		r /= 12.92;
-
-	if (g > 0.04045)
-		g = pow(((g + 0.055) / 1.055), 2.4);
-	else
-		g /= 12.92;
-
-	if (b > 0.04045)
-		b = pow(((b + 0.055) / 1.055), 2.4);
-	else
-		b /= 12.92;
-
-	r *= 100.;
-	g *= 100.;
-	b *= 100.;
+	r = srgb_to_linear(r) * 100.;
+	g = srgb_to_linear(g) * 100.;
+	b = srgb_to_linear(b) * 100.;
 
 	float x = r * 0.4125 + g * 0.3576 + b * 0.1804;
 	float y = r * 0.2127 + g * 0.7152 + b * 0.0722;
@@ -107,15 +126,15 @@ rgb2lab(float r, float g, float b,
 	z /= 108.883;
 
 	if (x > 0.008856)
-		x = pow(x, 1. / 3.);
+		x = cube_root(x);
 	else
 		x = 7.787 * x  + (16. / 116.);
 	if (y > 0.008856)
-		y = pow(y, 1./3.);
+		y = cube_root(y);
 	else
 		y = 7.787 * y  + (16. / 116.);
 	if (z > 0.008856)
-		z = pow(z, 1. / 3.);
+		z = cube_root(z);
 	else
 		z = 7.787 * z  + (16. / 116.);
 
@@ -380,5 +399,57 @@ rgb2hsl(float r, float g, float b,
 		h += 360.0;
 }
 
+// The saturation and lightness of rgb2hsl(), between 0 and 1, without the
+// hue.
+inline void
+rgb2sl(uint8 r, uint8 g, uint8 b, float& s, float& l)
+{
+	int32 max = max_c(r, max_c(g, b));
+	int32 min = min_c(r, min_c(g, b));
+	int32 delta = max - min;
+
+	l = (max + min) / 510.;
+	if (delta == 0)
+		s = 0;
+	else if (max + min < 255)
+		s = (float)delta / (max + min);
+	else
+		s = (float)delta / (510 - max - min);
+}
+
+
+// The same as hsl2rgb() with the hue of the color (hr, hg, hb). The hue
+// only decides which channel gets the largest and which the smallest value
+// and where the third one is between them, so it is never calculated.
+inline void
+hue_sl2rgb(uint8 hr, uint8 hg, uint8 hb, float s, float l,
+	float& r, float& g, float& b)
+{
+	float v2;
+	if (l < 0.5)
+		v2 = l * (1. + s);
+	else
+		v2 = (l + s) - (s * l);
+	float v1 = 2 * l - v2;
+
+	v1 *= 255;
+	v2 *= 255;
+
+	int32 max = max_c(hr, max_c(hg, hb));
+	int32 min = min_c(hr, min_c(hg, hb));
+	if (max == min) {
+		// Gray has the hue 0, which is red.
+		r = v2;
+		g = v1;
+		b = v1;
+		return;
+	}
+
+	float scale = (v2 - v1) / (max - min);
+	r = v1 + (hr - min) * scale;
+	g = v1 + (hg - min) * scale;
+	b = v1 + (hb - min) * scale;
+}
+
 
 #endif // COLOR_UTILITIES_H
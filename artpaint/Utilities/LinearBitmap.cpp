@@ -0,0 +1,240 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+
+#include "LinearBitmap.h"
+
+#include "PixelOperations.h"
+
+
+#include <OS.h>
+
+
+#include <math.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static uint16 sSRGBToLinear[256];
+static uint16 sLinearToSRGB[65536];
+
+
+// Fills the conversion tables when the application is loaded. The linear to
+// sRGB table stores the encoded value multiplied by 256, so that the dither
+// can be added before the value is truncated to 8 bits.
+static struct linear_table_initializer {
+	linear_table_initializer()
+	{
+		for (int32 i = 0; i < 256; i++) {
+			double value = i / 255.0;
+			if (value <= 0.04045)
+				value = value / 12.92;
+			else
+				value = pow((value + 0.055) / 1.055, 2.4);
+			sSRGBToLinear[i] = (uint16)round(value * 65535.0);
+		}
+
+		for (int32 i = 0; i < 65536; i++) {
+			double value = i / 65535.0;
+			if (value <= 0.0031308)
+				value = value * 12.92;
+			else
+				value = 1.055 * pow(value, 1.0 / 2.4) - 0.055;
+			sLinearToSRGB[i] = (uint16)min_c(round(value * 255.0 * 256.0), 65535.0);
+		}
+	}
+} sLinearTableInitializer;
+
+
+const uint16* srgb_to_linear_table = sSRGBToLinear;
+const uint16* linear_to_srgb_table = sLinearToSRGB;
+
+
+LinearBitmap::LinearBitmap(BRect bounds)
+	:
+	fBounds(bounds),
+	fBits(NULL),
+	fPixelsPerRow(0)
+{
+	fBounds.OffsetTo(B_ORIGIN);
+
+	if (fBuffer.SetTo(fBounds, sizeof(pixel16)) == B_OK) {
+		fBits = fBuffer.Row<pixel16>(0);
+		fPixelsPerRow = fBuffer.BytesPerRow() / sizeof(pixel16);
+	}
+}
+
+
+void
+LinearBitmap::Clear(pixel16 color, BRect* area)
+{
+	if (fBits == NULL)
+		return;
+
+	BRect rect = fBounds;
+	if (area != NULL)
+		rect = rect & *area;
+	if (rect.IsValid() == false)
+		return;
+
+	for (int32 y = (int32)rect.top; y <= (int32)rect.bottom; y++) {
+		pixel16* bits = PixelAt((int32)rect.left, y);
+		for (int32 x = (int32)rect.left; x <= (int32)rect.right; x++)
+			*bits++ = color;
+	}
+}
+
+
+void
+LinearBitmap::Import(const BBitmap* bitmap, BRect area)
+{
+	if (fBits == NULL || bitmap == NULL)
+		return;
+
+	area = area & fBounds & bitmap->Bounds();
+	if (area.IsValid() == false)
+		return;
+
+	uint32* source_bits = (uint32*)bitmap->Bits();
+	int32 source_bpr = bitmap->BytesPerRow() / 4;
+
+	for (int32 y = (int32)area.top; y <= (int32)area.bottom; y++) {
+		uint32* source = source_bits + (int32)area.left + y * source_bpr;
+		pixel16* target = PixelAt((int32)area.left, y);
+		for (int32 x = (int32)area.left; x <= (int32)area.right; x++)
+			*target++ = to_pixel16(*source++);
+	}
+}
+
+
+void
+LinearBitmap::Export(BBitmap* bitmap, BRect area, bool dither) const
+{
+	if (fBits == NULL || bitmap == NULL)
+		return;
+
+	area = area & fBounds & bitmap->Bounds();
+	if (area.IsValid() == false)
+		return;
+
+	uint32* target_bits = (uint32*)bitmap->Bits();
+	int32 target_bpr = bitmap->BytesPerRow() / 4;
+
+	for (int32 y = (int32)area.top; y <= (int32)area.bottom; y++) {
+		uint32* target = target_bits + (int32)area.left + y * target_bpr;
+		const pixel16* source = PixelAt((int32)area.left, y);
+		for (int32 x = (int32)area.left; x <= (int32)area.right; x++) {
+			if (dither == true)
+				*target++ = to_pixel8(*source++, ordered_dither(x, y));
+			else
+				*target++ = to_pixel8(*source++);
+		}
+	}
+}
+
+
+void
+LinearBitmap::CompositeOver(const LinearBitmap* source, BRect area)
+{
+	if (fBits == NULL || source == NULL || source->IsValid() == false)
+		return;
+
+	area = area & fBounds & source->Bounds();
+	if (area.IsValid() == false)
+		return;
+
+	for (int32 y = (int32)area.top; y <= (int32)area.bottom; y++) {
+		const pixel16* src = source->PixelAt((int32)area.left, y);
+		pixel16* dst = PixelAt((int32)area.left, y);
+		for (int32 x = (int32)area.left; x <= (int32)area.right; x++) {
+			*dst = src_over<pixel16>(*dst, *src++);
+			dst++;
+		}
+	}
+}
+
+
+void
+LinearBitmap::RunBenchmark(int32 width, int32 height, int32 rounds)
+{
+	BRect bounds(0, 0, width - 1, height - 1);
+	BBitmap* dst8 = new (std::nothrow) BBitmap(bounds, B_RGBA32);
+	BBitmap* src8 = new (std::nothrow) BBitmap(bounds, B_RGBA32);
+	LinearBitmap* dst16 = new (std::nothrow) LinearBitmap(bounds);
+	LinearBitmap* src16 = new (std::nothrow) LinearBitmap(bounds);
+
+	if (dst8 == NULL || src8 == NULL || dst16 == NULL || src16 == NULL
+		|| dst8->IsValid() == false || src8->IsValid() == false
+		|| dst16->IsValid() == false || src16->IsValid() == false) {
+		printf("Not enough memory for a %" B_PRId32 "x%" B_PRId32 " benchmark\n",
+			width, height);
+		delete dst8;
+		delete src8;
+		delete dst16;
+		delete src16;
+		return;
+	}
+
+	// Semi-transparent noise so that none of the early outs in the kernels
+	// are taken.
+	uint32* dst_bits = (uint32*)dst8->Bits();
+	uint32* src_bits = (uint32*)src8->Bits();
+	int32 pixel_count = dst8->BitsLength() / 4;
+	srand(1);
+	for (int32 i = 0; i < pixel_count; i++) {
+		union color_conversion c;
+		c.word = rand();
+		c.bytes[3] = 64 + (c.bytes[3] & 0x7F);
+		src_bits[i] = c.word;
+		c.word = rand();
+		c.bytes[3] = 128 + (c.bytes[3] & 0x7F);
+		dst_bits[i] = c.word;
+	}
+	dst16->Import(dst8, bounds);
+	src16->Import(src8, bounds);
+
+	double megapixels = (double)width * height * rounds / 1000000.0;
+
+	bigtime_t start = system_time();
+	for (int32 r = 0; r < rounds; r++) {
+		for (int32 i = 0; i < pixel_count; i++)
+			dst_bits[i] = src_over_fixed(dst_bits[i], src_bits[i]);
+	}
+	bigtime_t fixed_time = system_time() - start;
+
+	start = system_time();
+	for (int32 r = 0; r < rounds; r++) {
+		for (int32 i = 0; i < pixel_count; i++)
+			dst_bits[i] = src_over<uint32>(dst_bits[i], src_bits[i]);
+	}
+	bigtime_t template8_time = system_time() - start;
+
+	start = system_time();
+	for (int32 r = 0; r < rounds; r++)
+		dst16->CompositeOver(src16, bounds);
+	bigtime_t template16_time = system_time() - start;
+
+	start = system_time();
+	for (int32 r = 0; r < rounds; r++)
+		dst16->Export(dst8, bounds);
+	bigtime_t export_time = system_time() - start;
+
+	printf("Compositing %" B_PRId32 "x%" B_PRId32 " pixels, %" B_PRId32 " rounds\n",
+		width, height, rounds);
+	printf("  src_over_fixed (8-bit):      %8.1f Mpixels/s\n",
+		megapixels / (fixed_time / 1000000.0));
+	printf("  src_over<uint32> (8-bit):    %8.1f Mpixels/s\n",
+		megapixels / (template8_time / 1000000.0));
+	printf("  src_over<pixel16> (16-bit):  %8.1f Mpixels/s\n",
+		megapixels / (template16_time / 1000000.0));
+	printf("  16-bit to 8-bit with dither: %8.1f Mpixels/s\n",
+		megapixels / (export_time / 1000000.0));
+
+	delete dst8;
+	delete src8;
+	delete dst16;
+	delete src16;
+}
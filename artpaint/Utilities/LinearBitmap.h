@@ -0,0 +1,52 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+#ifndef _LINEAR_BITMAP_H
+#define	_LINEAR_BITMAP_H
+
+#include "PixelBuffer.h"
+#include "PixelFormats.h"
+
+#include <Bitmap.h>
+#include <Rect.h>
+
+
+// A 16-bit per channel linear light pixel buffer for intermediate results
+// that would lose precision in the 8-bit BGRA bitmaps. The buffer is
+// converted back to a normal B_RGBA32 bitmap with ordered dithering. The
+// layers themselves are still stored as B_RGBA32, so a filter that is
+// applied many times still rounds to 8 bits each time. The memory is taken
+// from the PixelBufferPool, so the rows may be padded.
+class LinearBitmap {
+public:
+						LinearBitmap(BRect bounds);
+
+			bool		IsValid() const { return fBits != NULL; }
+			BRect		Bounds() const { return fBounds; }
+			pixel16*	Bits() const { return fBits; }
+			int32		PixelsPerRow() const { return fPixelsPerRow; }
+
+			pixel16*	PixelAt(int32 x, int32 y) const
+							{ return fBits + x + y * fPixelsPerRow; }
+
+			void		Clear(pixel16 color, BRect* area = NULL);
+			void		Import(const BBitmap* bitmap, BRect area);
+			void		Export(BBitmap* bitmap, BRect area,
+							bool dither = true) const;
+			void		CompositeOver(const LinearBitmap* source, BRect area);
+
+	// Composites a buffer of the given size with both the 8-bit and the
+	// 16-bit kernels and prints the throughput of each.
+	static	void		RunBenchmark(int32 width, int32 height, int32 rounds);
+
+private:
+			BRect		fBounds;
+			PixelBuffer	fBuffer;
+			pixel16*	fBits;
+			int32		fPixelsPerRow;
+};
+
+
+#endif	// _LINEAR_BITMAP_H
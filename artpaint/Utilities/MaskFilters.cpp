@@ -0,0 +1,390 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+
+#include "MaskFilters.h"
+
+#include "WorkerPool.h"
+
+
+#include <math.h>
+#include <new>
+#include <string.h>
+
+
+// The columns are filtered in tiles of this many pixels, so that the rows
+// that a tile reads stay in the cache.
+const int32 kColumnTileWidth = 64;
+
+// The gaussian weights add up to this.
+const int32 kWeightShift = 14;
+
+
+struct max_operator {
+	inline uint8 operator()(uint8 a, uint8 b) const { return a > b ? a : b; }
+};
+
+
+struct min_operator {
+	inline uint8 operator()(uint8 a, uint8 b) const { return a < b ? a : b; }
+};
+
+
+struct filter_job {
+	PixelView		mask;
+	// The rows that have been filtered horizontally. They cover the columns
+	// of the area and the rows that the columns of the area need.
+	PixelView		rows;
+	int32			first_row;
+
+	int32			left;
+	int32			right;
+	int32			top;
+	int32			bottom;
+
+	int32			radius;
+	const uint32*	weights;
+
+	vint32			failed;
+};
+
+
+static status_t
+parallel_for(int32 first, int32 last, range_function function, void* data)
+{
+	WorkerPool* pool = WorkerPool::Instance();
+	if (pool == NULL) {
+		function(data, first, last);
+		return B_OK;
+	}
+
+	return pool->ParallelFor(first, last, function, data);
+}
+
+
+// The running extremes of in from the start (g) and from the end (h) of each
+// block of window values. The extreme of the window that starts at i is then
+// op(h[i], g[i + window - 1]), because that window spans at most two blocks.
+template<class Operator>
+static inline void
+running_extremes(const uint8* in, uint8* g, uint8* h, int32 length,
+	int32 window, Operator op)
+{
+	for (int32 start = 0; start < length; start += window) {
+		int32 end = min_c(start + window, length);
+
+		g[start] = in[start];
+		for (int32 i = start + 1; i < end; i++)
+			g[i] = op(g[i - 1], in[i]);
+
+		h[end - 1] = in[end - 1];
+		for (int32 i = end - 2; i >= start; i--)
+			h[i] = op(h[i + 1], in[i]);
+	}
+}
+
+
+template<class Operator>
+static void
+horizontal_morphology(void* data, int32 first, int32 last)
+{
+	filter_job* job = (filter_job*)data;
+	Operator op;
+
+	int32 radius = job->radius;
+	int32 width = job->right - job->left + 1;
+	int32 length = width + 2 * radius;
+	int32 mask_width = job->mask.Width();
+
+	PixelBuffer scratch(BRect(0, 0, length - 1, 2), 1);
+	if (!scratch.IsValid()) {
+		atomic_set(&job->failed, 1);
+		return;
+	}
+	uint8* in = scratch.Row<uint8>(0);
+	uint8* g = scratch.Row<uint8>(1);
+	uint8* h = scratch.Row<uint8>(2);
+
+	// The pixels outside of the mask are zero.
+	int32 x0 = job->left - radius;
+	int32 begin = max_c(-x0, 0);
+	int32 end = min_c(mask_width - x0, length);
+	memset(in, 0, begin);
+	memset(in + end, 0, length - end);
+
+	for (int32 y = first; y < last; y++) {
+		memcpy(in + begin, job->mask.Row<uint8>(y) + x0 + begin, end - begin);
+		running_extremes(in, g, h, length, 2 * radius + 1, op);
+
+		uint8* target = job->rows.Row<uint8>(y - job->first_row);
+		for (int32 x = 0; x < width; x++)
+			target[x] = op(h[x], g[x + 2 * radius]);
+	}
+}
+
+
+template<class Operator>
+static void
+vertical_morphology(void* data, int32 first, int32 last)
+{
+	filter_job* job = (filter_job*)data;
+	Operator op;
+
+	int32 radius = job->radius;
+	int32 window = 2 * radius + 1;
+	int32 height = job->bottom - job->top + 1;
+	int32 length = height + 2 * radius;
+	int32 mask_height = job->mask.Height();
+
+	PixelBuffer scratch(BRect(0, 0, kColumnTileWidth - 1, 2 * length - 1), 1);
+	if (!scratch.IsValid()) {
+		atomic_set(&job->failed, 1);
+		return;
+	}
+
+	uint8 zeros[kColumnTileWidth];
+	memset(zeros, 0, kColumnTileWidth);
+
+	for (int32 tile = first; tile < last; tile++) {
+		int32 offset = tile * kColumnTileWidth;
+		int32 tile_width = min_c(kColumnTileWidth,
+			job->right - job->left + 1 - offset);
+
+		// The same as running_extremes(), but for a row of columns at once.
+		for (int32 start = 0; start < length; start += window) {
+			int32 end = min_c(start + window, length);
+			for (int32 i = start; i < end; i++) {
+				int32 y = job->top - radius + i;
+				const uint8* in = zeros;
+				if (y >= 0 && y < mask_height)
+					in = job->rows.Row<uint8>(y - job->first_row) + offset;
+
+				uint8* g = scratch.Row<uint8>(i);
+				if (i == start)
+					memcpy(g, in, tile_width);
+				else {
+					const uint8* previous = scratch.Row<uint8>(i - 1);
+					for (int32 x = 0; x < tile_width; x++)
+						g[x] = op(previous[x], in[x]);
+				}
+			}
+			for (int32 i = end - 1; i >= start; i--) {
+				int32 y = job->top - radius + i;
+				const uint8* in = zeros;
+				if (y >= 0 && y < mask_height)
+					in = job->rows.Row<uint8>(y - job->first_row) + offset;
+
+				uint8* h = scratch.Row<uint8>(length + i);
+				if (i == end - 1)
+					memcpy(h, in, tile_width);
+				else {
+					const uint8* next = scratch.Row<uint8>(length + i + 1);
+					for (int32 x = 0; x < tile_width; x++)
+						h[x] = op(next[x], in[x]);
+				}
+			}
+		}
+
+		for (int32 i = 0; i < height; i++) {
+			const uint8* h = scratch.Row<uint8>(length + i);
+			const uint8* g = scratch.Row<uint8>(i + 2 * radius);
+			uint8* target = job->mask.Row<uint8>(job->top + i) + job->left
+				+ offset;
+			for (int32 x = 0; x < tile_width; x++)
+				target[x] = op(h[x], g[x]);
+		}
+	}
+}
+
+
+static void
+horizontal_feather(void* data, int32 first, int32 last)
+{
+	filter_job* job = (filter_job*)data;
+
+	int32 radius = job->radius;
+	int32 width = job->right - job->left + 1;
+	int32 length = width + 2 * radius;
+	int32 mask_width = job->mask.Width();
+	const uint32* weights = job->weights;
+
+	PixelBuffer scratch(BRect(0, 0, length - 1, 0), 1);
+	if (!scratch.IsValid()) {
+		atomic_set(&job->failed, 1);
+		return;
+	}
+	uint8* in = scratch.Row<uint8>(0);
+
+	// The pixels outside of the mask repeat the edge pixels.
+	int32 x0 = job->left - radius;
+	int32 begin = max_c(-x0, 0);
+	int32 end = min_c(mask_width - x0, length);
+
+	for (int32 y = first; y < last; y++) {
+		const uint8* source = job->mask.Row<uint8>(y);
+		memset(in, source[0], begin);
+		memcpy(in + begin, source + x0 + begin, end - begin);
+		memset(in + end, source[mask_width - 1], length - end);
+
+		// The rows keep eight bits of fraction for the vertical pass.
+		uint16* target = job->rows.Row<uint16>(y - job->first_row);
+		for (int32 x = 0; x < width; x++) {
+			uint32 sum = 0;
+			for (int32 i = 0; i <= 2 * radius; i++)
+				sum += weights[i] * in[x + i];
+			target[x] = (sum + (1 << (kWeightShift - 9))) >> (kWeightShift - 8);
+		}
+	}
+}
+
+
+static void
+vertical_feather(void* data, int32 first, int32 last)
+{
+	filter_job* job = (filter_job*)data;
+
+	int32 radius = job->radius;
+	int32 mask_height = job->mask.Height();
+	const uint32* weights = job->weights;
+
+	uint32 sums[kColumnTileWidth];
+	for (int32 tile = first; tile < last; tile++) {
+		int32 offset = tile * kColumnTileWidth;
+		int32 tile_width = min_c(kColumnTileWidth,
+			job->right - job->left + 1 - offset);
+
+		for (int32 y = job->top; y <= job->bottom; y++) {
+			memset(sums, 0, sizeof(sums));
+			for (int32 i = 0; i <= 2 * radius; i++) {
+				int32 row = min_c(max_c(y - radius + i, 0), mask_height - 1);
+				const uint16* in = job->rows.Row<uint16>(row - job->first_row)
+					+ offset;
+				for (int32 x = 0; x < tile_width; x++)
+					sums[x] += weights[i] * in[x];
+			}
+
+			uint8* target = job->mask.Row<uint8>(y) + job->left + offset;
+			for (int32 x = 0; x < tile_width; x++) {
+				target[x] = (sums[x] + (1 << (kWeightShift + 7)))
+					>> (kWeightShift + 8);
+			}
+		}
+	}
+}
+
+
+status_t
+MaskFilters::Dilate(const PixelView& mask, BRect area, int32 radius)
+{
+	return _Morphology<max_operator>(mask, area, radius);
+}
+
+
+status_t
+MaskFilters::Erode(const PixelView& mask, BRect area, int32 radius)
+{
+	return _Morphology<min_operator>(mask, area, radius);
+}
+
+
+status_t
+MaskFilters::Feather(const PixelView& mask, BRect area, float radius)
+{
+	if (!mask.IsValid() || mask.BytesPerPixel() != 1)
+		return B_BAD_VALUE;
+
+	area = area & mask.Bounds();
+	int32 kernel_radius = (int32)ceil(radius);
+	if (!area.IsValid() || kernel_radius <= 0)
+		return B_OK;
+
+	// The gaussian is cut off at three sigmas. The rounding error is given
+	// to the center weight, so that the weights add up exactly.
+	int32 kernel_size = 2 * kernel_radius + 1;
+	uint32* weights = new (std::nothrow) uint32[kernel_size];
+	if (weights == NULL)
+		return B_NO_MEMORY;
+
+	float sigma = radius / 3.0;
+	float total = 0;
+	for (int32 i = 0; i < kernel_size; i++) {
+		float d = i - kernel_radius;
+		total += exp(-d * d / (2 * sigma * sigma));
+	}
+	uint32 sum = 0;
+	for (int32 i = 0; i < kernel_size; i++) {
+		float d = i - kernel_radius;
+		weights[i] = (uint32)((1 << kWeightShift)
+			* exp(-d * d / (2 * sigma * sigma)) / total);
+		sum += weights[i];
+	}
+	weights[kernel_radius] += (1 << kWeightShift) - sum;
+
+	filter_job job;
+	job.mask = mask;
+	job.left = (int32)area.left;
+	job.right = (int32)area.right;
+	job.top = (int32)area.top;
+	job.bottom = (int32)area.bottom;
+	job.radius = kernel_radius;
+	job.weights = weights;
+	job.failed = 0;
+	job.first_row = max_c(job.top - kernel_radius, 0);
+	int32 last_row = min_c(job.bottom + kernel_radius, mask.Height() - 1);
+
+	PixelBuffer rows(BRect(area.left, job.first_row, area.right, last_row), 2);
+	if (!rows.IsValid()) {
+		delete[] weights;
+		return B_NO_MEMORY;
+	}
+	job.rows = rows.View();
+
+	int32 tiles = (job.right - job.left + kColumnTileWidth) / kColumnTileWidth;
+	parallel_for(job.first_row, last_row + 1, horizontal_feather, &job);
+	if (job.failed == 0)
+		parallel_for(0, tiles, vertical_feather, &job);
+
+	delete[] weights;
+
+	return job.failed == 0 ? B_OK : B_NO_MEMORY;
+}
+
+
+template<class Operator>
+status_t
+MaskFilters::_Morphology(const PixelView& mask, BRect area, int32 radius)
+{
+	if (!mask.IsValid() || mask.BytesPerPixel() != 1)
+		return B_BAD_VALUE;
+
+	area = area & mask.Bounds();
+	if (!area.IsValid() || radius <= 0)
+		return B_OK;
+
+	filter_job job;
+	job.mask = mask;
+	job.left = (int32)area.left;
+	job.right = (int32)area.right;
+	job.top = (int32)area.top;
+	job.bottom = (int32)area.bottom;
+	job.radius = radius;
+	job.weights = NULL;
+	job.failed = 0;
+	job.first_row = max_c(job.top - radius, 0);
+	int32 last_row = min_c(job.bottom + radius, mask.Height() - 1);
+
+	PixelBuffer rows(BRect(area.left, job.first_row, area.right, last_row), 1);
+	if (!rows.IsValid())
+		return B_NO_MEMORY;
+	job.rows = rows.View();
+
+	int32 tiles = (job.right - job.left + kColumnTileWidth) / kColumnTileWidth;
+	parallel_for(job.first_row, last_row + 1, horizontal_morphology<Operator>,
+		&job);
+	if (job.failed == 0)
+		parallel_for(0, tiles, vertical_morphology<Operator>, &job);
+
+	return job.failed == 0 ? B_OK : B_NO_MEMORY;
+}
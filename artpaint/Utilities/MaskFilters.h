@@ -0,0 +1,45 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+#ifndef _MASK_FILTERS_H
+#define	_MASK_FILTERS_H
+
+#include "PixelBuffer.h"
+
+#include <Rect.h>
+
+
+/*
+	Filters for the one byte per pixel maps of the selections. Only the
+	pixels in area are changed, but they are computed from the whole mask,
+	so the area should include every pixel that can change (the bounds of
+	the selection grown by the radius, for example).
+
+	Dilate() and Erode() set every pixel to the largest or the smallest
+	value in the square of 2 * radius + 1 pixels around it. They use the van
+	Herk/Gil-Werman algorithm, which takes three comparisons per pixel and
+	pass whatever the radius is. The pixels outside of the mask count as
+	not selected, so the edges of the image are eroded.
+
+	Feather() blurs the mask with a gaussian that fades out at radius. The
+	pixels outside of the mask repeat the nearest edge pixel, so that a
+	selection that touches the edge of the image is not faded there.
+
+	The rows and the columns are processed in parallel with the WorkerPool.
+*/
+class MaskFilters {
+public:
+	static	status_t	Dilate(const PixelView& mask, BRect area, int32 radius);
+	static	status_t	Erode(const PixelView& mask, BRect area, int32 radius);
+	static	status_t	Feather(const PixelView& mask, BRect area, float radius);
+
+private:
+	template<class Operator>
+	static	status_t	_Morphology(const PixelView& mask, BRect area,
+							int32 radius);
+};
+
+
+#endif	// _MASK_FILTERS_H
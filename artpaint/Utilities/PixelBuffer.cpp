@@ -0,0 +1,263 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+
+#include "PixelBuffer.h"
+
+
+#include <Autolock.h>
+#include <Bitmap.h>
+
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+
+// There are four size classes between each power of two, so at most a fifth
+// of a block is unused. Larger blocks are not kept.
+const size_t kSmallestBlock = 4096;
+const size_t kLargestPooledBlock = 256 * 1024 * 1024;
+
+// How many blocks of one size and how much memory in all are kept idle.
+const size_t kIdleBlocksPerClass = 4;
+const int64 kMaxIdleBytes = 128 * 1024 * 1024;
+
+
+PixelView::PixelView()
+	:
+	fBits(NULL),
+	fBytesPerRow(0),
+	fBytesPerPixel(0),
+	fBounds()
+{
+}
+
+
+PixelView::PixelView(void* bits, int32 bytesPerRow, int32 bytesPerPixel,
+	BRect bounds)
+	:
+	fBits((uint8*)bits),
+	fBytesPerRow(bytesPerRow),
+	fBytesPerPixel(bytesPerPixel),
+	fBounds(bounds)
+{
+}
+
+
+PixelView::PixelView(BBitmap* bitmap)
+	:
+	fBits(NULL),
+	fBytesPerRow(0),
+	fBytesPerPixel(0),
+	fBounds()
+{
+	if (bitmap != NULL && bitmap->IsValid()) {
+		fBits = (uint8*)bitmap->Bits();
+		fBytesPerRow = bitmap->BytesPerRow();
+		fBounds = bitmap->Bounds();
+		fBytesPerPixel = bitmap->ColorSpace() == B_GRAY8
+			|| bitmap->ColorSpace() == B_CMAP8 ? 1 : 4;
+	}
+}
+
+
+void
+PixelView::CopyFrom(const PixelView& source) const
+{
+	if (!IsValid() || !source.IsValid() || fBytesPerPixel != source.fBytesPerPixel)
+		return;
+
+	int32 row_length = min_c(Width(), source.Width()) * fBytesPerPixel;
+	int32 height = min_c(Height(), source.Height());
+	for (int32 y = 0; y < height; y++)
+		memcpy(Row<uint8>(y), source.Row<uint8>(y), row_length);
+}
+
+
+// #pragma mark -- PixelBuffer
+
+
+PixelBuffer::PixelBuffer()
+	:
+	fBlock(NULL),
+	fCapacity(0)
+{
+}
+
+
+PixelBuffer::PixelBuffer(BRect bounds, int32 bytesPerPixel, bool clear)
+	:
+	fBlock(NULL),
+	fCapacity(0)
+{
+	SetTo(bounds, bytesPerPixel, clear);
+}
+
+
+PixelBuffer::~PixelBuffer()
+{
+	Unset();
+}
+
+
+status_t
+PixelBuffer::SetTo(BRect bounds, int32 bytesPerPixel, bool clear)
+{
+	int32 width = bounds.IntegerWidth() + 1;
+	int32 height = bounds.IntegerHeight() + 1;
+	if (!bounds.IsValid() || bytesPerPixel <= 0) {
+		Unset();
+		return B_BAD_VALUE;
+	}
+
+	int32 bpr = (width * bytesPerPixel + kPixelRowAlignment - 1)
+		& ~(kPixelRowAlignment - 1);
+	size_t bytes = (size_t)bpr * height;
+	if (bytes > fCapacity) {
+		Unset();
+		fBlock = PixelBufferPool::Instance()->Acquire(bytes, &fCapacity);
+		if (fBlock == NULL) {
+			fCapacity = 0;
+			return B_NO_MEMORY;
+		}
+	}
+
+	fView = PixelView(fBlock, bpr, bytesPerPixel, bounds);
+	if (clear)
+		memset(fBlock, 0, bytes);
+
+	return B_OK;
+}
+
+
+void
+PixelBuffer::Unset()
+{
+	if (fBlock != NULL)
+		PixelBufferPool::Instance()->Release(fBlock, fCapacity);
+
+	fBlock = NULL;
+	fCapacity = 0;
+	fView = PixelView();
+}
+
+
+// #pragma mark -- PixelBufferPool
+
+
+PixelBufferPool*
+PixelBufferPool::Instance()
+{
+	// The pool is never deleted, because the buffers of other static
+	// objects may be given back to it while the application exits.
+	static PixelBufferPool* pool = new PixelBufferPool();
+	return pool;
+}
+
+
+PixelBufferPool::PixelBufferPool()
+	:
+	fLocker("pixel buffer pool lock"),
+	fIdleBytes(0)
+{
+	for (size_t size = kSmallestBlock; size <= kLargestPooledBlock; size *= 2) {
+		for (int32 i = 4; i < 8 && size / 4 * i <= kLargestPooledBlock; i++)
+			fClassSizes.push_back(size / 4 * i);
+	}
+	fIdleBlocks.resize(fClassSizes.size());
+
+	MemoryBudget::AddReclaimer(this, kCacheReclaimPriority);
+}
+
+
+void*
+PixelBufferPool::Acquire(size_t bytes, size_t* capacity)
+{
+	int32 size_class = _SizeClass(bytes);
+	size_t size = (bytes + kPixelRowAlignment - 1) & ~(kPixelRowAlignment - 1);
+	if (size_class >= 0)
+		size = fClassSizes[size_class];
+
+	void* block = NULL;
+	{
+		BAutolock _(fLocker);
+
+		if (size_class >= 0 && !fIdleBlocks[size_class].empty()) {
+			block = fIdleBlocks[size_class].back();
+			fIdleBlocks[size_class].pop_back();
+			fIdleBytes -= size;
+			MemoryBudget::Track(this, fIdleBytes, NULL, CACHE_MEMORY);
+		}
+	}
+
+	if (block == NULL && posix_memalign(&block, kPixelRowAlignment, size) != 0)
+		return NULL;
+
+	MemoryBudget::Track(block, size, NULL, TOOL_MEMORY);
+	*capacity = size;
+	return block;
+}
+
+
+void
+PixelBufferPool::Release(void* block, size_t capacity)
+{
+	if (block == NULL)
+		return;
+
+	MemoryBudget::Untrack(block);
+
+	int32 size_class = _SizeClass(capacity);
+	if (size_class >= 0 && fClassSizes[size_class] == capacity) {
+		BAutolock _(fLocker);
+
+		std::vector<void*>& idle = fIdleBlocks[size_class];
+		if (idle.size() < kIdleBlocksPerClass
+			&& fIdleBytes + (int64)capacity <= kMaxIdleBytes) {
+			idle.push_back(block);
+			fIdleBytes += capacity;
+			MemoryBudget::Track(this, fIdleBytes, NULL, CACHE_MEMORY);
+			return;
+		}
+	}
+
+	free(block);
+}
+
+
+int64
+PixelBufferPool::ReclaimMemory(int64 bytes)
+{
+	BAutolock _(fLocker);
+
+	// The largest blocks are freed first.
+	int64 freed = 0;
+	for (int32 i = fClassSizes.size() - 1; i >= 0 && freed < bytes; i--) {
+		std::vector<void*>& idle = fIdleBlocks[i];
+		while (!idle.empty() && freed < bytes) {
+			free(idle.back());
+			idle.pop_back();
+			freed += fClassSizes[i];
+		}
+	}
+
+	fIdleBytes -= freed;
+	MemoryBudget::Track(this, fIdleBytes, NULL, CACHE_MEMORY);
+
+	return freed;
+}
+
+
+int32
+PixelBufferPool::_SizeClass(size_t bytes) const
+{
+	if (bytes > kLargestPooledBlock)
+		return -1;
+
+	std::vector<size_t>::const_iterator it
+		= std::lower_bound(fClassSizes.begin(), fClassSizes.end(), bytes);
+	return it - fClassSizes.begin();
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+#ifndef _PIXEL_BUFFER_H
+#define	_PIXEL_BUFFER_H
+
+#include "MemoryBudget.h"
+
+#include <Locker.h>
+#include <Rect.h>
+
+
+#include <vector>
+
+
+class BBitmap;
+
+
+// The rows of the pooled buffers start at this alignment, so that the
+// kernels can use aligned vector loads and stores.
+const int32 kPixelRowAlignment = 64;
+
+
+// The pixels of a buffer or of a bitmap, for the kernels that do not need a
+// BBitmap. The rows are counted from the top of the bounds.
+class PixelView {
+public:
+						PixelView();
+						PixelView(void* bits, int32 bytesPerRow,
+							int32 bytesPerPixel, BRect bounds);
+						PixelView(BBitmap* bitmap);
+
+			bool		IsValid() const { return fBits != NULL; }
+			uint8*		Bits() const { return fBits; }
+			int32		BytesPerRow() const { return fBytesPerRow; }
+			int32		BytesPerPixel() const { return fBytesPerPixel; }
+			BRect		Bounds() const { return fBounds; }
+			int32		Width() const { return fBounds.IntegerWidth() + 1; }
+			int32		Height() const { return fBounds.IntegerHeight() + 1; }
+
+			template<class T>
+			T*			Row(int32 y) const
+							{ return (T*)(fBits + y * fBytesPerRow); }
+
+			// Copies the pixels that both views have, row by row. The views
+			// must have the same number of bytes per pixel.
+			void		CopyFrom(const PixelView& source) const;
+
+private:
+			uint8*		fBits;
+			int32		fBytesPerRow;
+			int32		fBytesPerPixel;
+			BRect		fBounds;
+};
+
+
+// A buffer that is taken from the PixelBufferPool and given back to it when
+// the buffer is deleted. The pixels are not cleared unless asked to, and a
+// buffer that is set to a smaller size keeps its memory.
+class PixelBuffer {
+public:
+						PixelBuffer();
+						PixelBuffer(BRect bounds, int32 bytesPerPixel,
+							bool clear = false);
+						~PixelBuffer();
+
+			status_t	SetTo(BRect bounds, int32 bytesPerPixel,
+							bool clear = false);
+			void		Unset();
+
+			bool		IsValid() const { return fView.IsValid(); }
+			const PixelView&	View() const { return fView; }
+			uint8*		Bits() const { return fView.Bits(); }
+			int32		BytesPerRow() const { return fView.BytesPerRow(); }
+			BRect		Bounds() const { return fView.Bounds(); }
+
+			template<class T>
+			T*			Row(int32 y) const { return fView.Row<T>(y); }
+
+private:
+						PixelBuffer(const PixelBuffer& buffer);
+			PixelBuffer&	operator=(const PixelBuffer& buffer);
+
+			void*		fBlock;
+			size_t		fCapacity;
+			PixelView	fView;
+};
+
+
+/*
+	The PixelBufferPool keeps the memory of the buffers that have been given
+	back, sorted into size classes, so that the tools and the filters that
+	need a buffer of the same size for every dab or every frame do not have
+	to allocate and clear one each time. The blocks are aligned to
+	kPixelRowAlignment. The buffers in use are counted as tool memory and
+	the idle blocks as a cache, which is emptied first when the memory
+	budget is exceeded.
+*/
+class PixelBufferPool : public MemoryReclaimer {
+public:
+	static	PixelBufferPool*	Instance();
+
+			void*		Acquire(size_t bytes, size_t* capacity);
+			void		Release(void* block, size_t capacity);
+
+	virtual	int64		ReclaimMemory(int64 bytes);
+
+private:
+						PixelBufferPool();
+
+			int32		_SizeClass(size_t bytes) const;
+
+			BLocker		fLocker;
+			std::vector<size_t>	fClassSizes;
+			std::vector<std::vector<void*> >	fIdleBlocks;
+			int64		fIdleBytes;
+};
+
+
+#endif	// _PIXEL_BUFFER_H
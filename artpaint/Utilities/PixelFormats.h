@@ -0,0 +1,191 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+#ifndef _PIXEL_FORMATS_H
+#define	_PIXEL_FORMATS_H
+
+#include "PixelOperations.h"
+
+#include <SupportDefs.h>
+
+
+// The pixel formats that the templated kernels below work with. uint32 is
+// the BGRA word that is used everywhere in ArtPaint (see color_conversion),
+// pixel16 stores 16 bits per channel in the same channel order. The color
+// channels of a pixel16 are normally in linear light, so that mixing and
+// repeated filtering do not lose precision or darken the midtones.
+struct pixel16 {
+	uint16	bytes[4];
+};
+
+
+template<class Pixel>
+struct pixel_traits;
+
+
+template<>
+struct pixel_traits<uint32> {
+	typedef uint32	wide_type;
+	enum { max_value = 255 };
+
+	static inline void Unpack(uint32 pixel, wide_type channels[4])
+	{
+		union color_conversion c;
+		c.word = pixel;
+		channels[0] = c.bytes[0];
+		channels[1] = c.bytes[1];
+		channels[2] = c.bytes[2];
+		channels[3] = c.bytes[3];
+	}
+
+	static inline uint32 Pack(const wide_type channels[4])
+	{
+		union color_conversion c;
+		c.bytes[0] = channels[0];
+		c.bytes[1] = channels[1];
+		c.bytes[2] = channels[2];
+		c.bytes[3] = channels[3];
+		return c.word;
+	}
+};
+
+
+template<>
+struct pixel_traits<pixel16> {
+	typedef uint64	wide_type;
+	enum { max_value = 65535 };
+
+	static inline void Unpack(const pixel16& pixel, wide_type channels[4])
+	{
+		channels[0] = pixel.bytes[0];
+		channels[1] = pixel.bytes[1];
+		channels[2] = pixel.bytes[2];
+		channels[3] = pixel.bytes[3];
+	}
+
+	static inline pixel16 Pack(const wide_type channels[4])
+	{
+		pixel16 pixel;
+		pixel.bytes[0] = channels[0];
+		pixel.bytes[1] = channels[1];
+		pixel.bytes[2] = channels[2];
+		pixel.bytes[3] = channels[3];
+		return pixel;
+	}
+};
+
+
+// Porter-Duff source over destination, same as src_over_fixed() but for
+// any pixel format.
+template<class Pixel>
+inline Pixel src_over(Pixel dst, Pixel src)
+{
+	typedef pixel_traits<Pixel> traits;
+	typedef typename traits::wide_type wide_type;
+	const wide_type max_value = traits::max_value;
+
+	wide_type s[4], d[4], r[4];
+	traits::Unpack(src, s);
+	traits::Unpack(dst, d);
+
+	if (s[3] == max_value)
+		return src;
+
+	wide_type inv_dst_alpha = (d[3] * (max_value - s[3])) / max_value;
+	wide_type result_alpha = s[3] + inv_dst_alpha;
+	if (result_alpha == 0) {
+		r[0] = r[1] = r[2] = r[3] = 0;
+		return traits::Pack(r);
+	}
+
+	for (int32 i = 0; i < 3; i++)
+		r[i] = (s[i] * s[3] + d[i] * inv_dst_alpha) / result_alpha;
+	r[3] = result_alpha;
+
+	return traits::Pack(r);
+}
+
+
+// Mixes p1 and p2 so that the weight of p1 is c / max_value.
+template<class Pixel>
+inline Pixel mix_pixels(Pixel p1, Pixel p2, uint32 c)
+{
+	typedef pixel_traits<Pixel> traits;
+	typedef typename traits::wide_type wide_type;
+	const wide_type max_value = traits::max_value;
+
+	wide_type a[4], b[4], r[4];
+	traits::Unpack(p1, a);
+	traits::Unpack(p2, b);
+
+	for (int32 i = 0; i < 4; i++)
+		r[i] = (a[i] * c + b[i] * (max_value - c) + max_value / 2) / max_value;
+
+	return traits::Pack(r);
+}
+
+
+// Conversions between the 8-bit sRGB encoded and the 16-bit linear light
+// values, the tables are declared in ColorUtilities.h.
+inline uint16
+srgb_to_linear16(uint8 value)
+{
+	return srgb_to_linear_table[value];
+}
+
+
+// The dither value (0 - 255) is added before the result is truncated to
+// 8 bits. Passing values from an ordered dither matrix hides the banding
+// that would otherwise appear in smooth gradients.
+inline uint8
+linear16_to_srgb(uint16 value, uint8 dither = 128)
+{
+	uint32 encoded = linear_to_srgb_table[value] + dither;
+	return min_c(encoded >> 8, 255);
+}
+
+
+inline pixel16
+to_pixel16(uint32 bgra)
+{
+	union color_conversion c;
+	c.word = bgra;
+
+	pixel16 pixel;
+	pixel.bytes[0] = srgb_to_linear16(c.bytes[0]);
+	pixel.bytes[1] = srgb_to_linear16(c.bytes[1]);
+	pixel.bytes[2] = srgb_to_linear16(c.bytes[2]);
+	pixel.bytes[3] = c.bytes[3] * 257;
+	return pixel;
+}
+
+
+inline uint32
+to_pixel8(const pixel16& pixel, uint8 dither = 128)
+{
+	union color_conversion c;
+	c.bytes[0] = linear16_to_srgb(pixel.bytes[0], dither);
+	c.bytes[1] = linear16_to_srgb(pixel.bytes[1], dither);
+	c.bytes[2] = linear16_to_srgb(pixel.bytes[2], dither);
+	c.bytes[3] = (pixel.bytes[3] * 255 + dither * 257) / 65535;
+	return c.word;
+}
+
+
+// A 4x4 ordered dither threshold for the pixel at x, y.
+inline uint8
+ordered_dither(int32 x, int32 y)
+{
+	static const uint8 kBayer[16] = {
+		8, 136, 40, 168,
+		200, 72, 232, 104,
+		56, 184, 24, 152,
+		248, 120, 216, 88
+	};
+	return kBayer[(x & 3) + ((y & 3) << 2)];
+}
+
+
+#endif	// _PIXEL_FORMATS_H
@@ -0,0 +1,260 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+
+#include "PolygonRasterizer.h"
+
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+
+const int32 kSubScanlines = 16;
+
+// The coverage of one sub-scanline over a whole pixel.
+const int32 kFullCoverage = 256;
+
+// Sharp corners are not extended further than this many outsets.
+const float kMiterLimit = 2.0;
+
+
+PolygonRasterizer::PolygonRasterizer(fill_rule rule)
+	:
+	fRule(rule)
+{
+	MakeEmpty();
+}
+
+
+void
+PolygonRasterizer::AddPolygon(const BPoint* points, int32 count, float outset)
+{
+	// Remove the repeated points, also the closing one.
+	std::vector<BPoint> vertices;
+	for (int32 i = 0; i < count; i++) {
+		if (vertices.empty() || vertices.back() != points[i])
+			vertices.push_back(points[i]);
+	}
+	while (vertices.size() > 1 && vertices.back() == vertices.front())
+		vertices.pop_back();
+
+	int32 vertex_count = vertices.size();
+	if (vertex_count == 0)
+		return;
+
+	if (outset > 0 && vertex_count > 1) {
+		// The outward side depends on the direction of the polygon. The
+		// y-axis points down, so a positive area means clockwise on screen.
+		float area = 0;
+		for (int32 i = 0; i < vertex_count; i++) {
+			BPoint p1 = vertices[i];
+			BPoint p2 = vertices[(i + 1) % vertex_count];
+			area += p1.x * p2.y - p2.x * p1.y;
+		}
+		float side = (area >= 0) ? outset : -outset;
+
+		std::vector<BPoint> moved(vertex_count);
+		for (int32 i = 0; i < vertex_count; i++) {
+			BPoint prev = vertices[(i + vertex_count - 1) % vertex_count];
+			BPoint next = vertices[(i + 1) % vertex_count];
+			BPoint current = vertices[i];
+
+			// The normals of the edges before and after the vertex.
+			BPoint d1 = current - prev;
+			BPoint d2 = next - current;
+			float l1 = sqrt(d1.x * d1.x + d1.y * d1.y);
+			float l2 = sqrt(d2.x * d2.x + d2.y * d2.y);
+			BPoint n1(d1.y / l1, -d1.x / l1);
+			BPoint n2(d2.y / l2, -d2.x / l2);
+
+			// The corner moves along the bisector of the normals so that
+			// both edges move by the outset.
+			BPoint bisector = n1 + n2;
+			float length = sqrt(bisector.x * bisector.x + bisector.y * bisector.y);
+			if (length < 0.0001) {
+				moved[i] = current + BPoint(n1.x * side, n1.y * side);
+				continue;
+			}
+			bisector.x /= length;
+			bisector.y /= length;
+			float scale = 1 / max_c(bisector.x * n1.x + bisector.y * n1.y,
+				1 / kMiterLimit);
+			moved[i] = current + BPoint(bisector.x * side * scale,
+				bisector.y * side * scale);
+		}
+		vertices.swap(moved);
+	} else if (vertex_count == 1 && outset > 0) {
+		// A single point becomes a square.
+		BPoint point = vertices[0];
+		vertices.clear();
+		vertices.push_back(point + BPoint(-outset, -outset));
+		vertices.push_back(point + BPoint(outset, -outset));
+		vertices.push_back(point + BPoint(outset, outset));
+		vertices.push_back(point + BPoint(-outset, outset));
+		vertex_count = 4;
+	}
+
+	for (int32 i = 0; i < vertex_count; i++) {
+		// Move the pixel centers to the middle of the pixels.
+		BPoint from = vertices[i] + BPoint(0.5, 0.5);
+		BPoint to = vertices[(i + 1) % vertex_count] + BPoint(0.5, 0.5);
+		_AddEdge(from, to);
+
+		fLeft = min_c(fLeft, from.x);
+		fRight = max_c(fRight, from.x);
+		fTop = min_c(fTop, from.y);
+		fBottom = max_c(fBottom, from.y);
+	}
+}
+
+
+void
+PolygonRasterizer::MakeEmpty()
+{
+	fEdges.clear();
+	fLeft = fTop = 1000000;
+	fRight = fBottom = -1000000;
+}
+
+
+BRect
+PolygonRasterizer::Bounds() const
+{
+	if (fEdges.empty())
+		return BRect();
+
+	return BRect(floorf(fLeft), floorf(fTop), ceilf(fRight) - 1, ceilf(fBottom) - 1);
+}
+
+
+void
+PolygonRasterizer::Render(uint8* bits, int32 bpr, BRect map_bounds,
+	raster_mode mode) const
+{
+	BRect area = Bounds() & map_bounds;
+	if (area.IsValid() == false)
+		return;
+
+	int32 left = (int32)area.left;
+	int32 right = (int32)area.right;
+	int32 top = (int32)area.top;
+	int32 bottom = (int32)area.bottom;
+	int32 width = right - left + 1;
+
+	std::vector<edge> edges(fEdges);
+	std::sort(edges.begin(), edges.end());
+
+	std::vector<const edge*> active;
+	std::vector<crossing> crossings;
+	size_t next_edge = 0;
+
+	// One extra entry for the end of the spans that reach the right side.
+	int32* coverage = new int32[width + 1];
+
+	for (int32 y = top; y <= bottom; y++) {
+		memset(coverage, 0, (width + 1) * sizeof(int32));
+		bool row_touched = false;
+
+		for (int32 s = 0; s < kSubScanlines; s++) {
+			float sample_y = y + (s + 0.5) / kSubScanlines;
+
+			while (next_edge < edges.size() && edges[next_edge].top <= sample_y)
+				active.push_back(&edges[next_edge++]);
+
+			crossings.clear();
+			for (size_t i = 0; i < active.size();) {
+				const edge* current = active[i];
+				if (current->bottom <= sample_y) {
+					active[i] = active.back();
+					active.pop_back();
+					continue;
+				}
+				crossing c;
+				c.x = current->x + (sample_y - current->top) * current->slope;
+				c.winding = current->winding;
+				crossings.push_back(c);
+				i++;
+			}
+			if (crossings.empty())
+				continue;
+
+			std::sort(crossings.begin(), crossings.end());
+
+			int32 winding = 0;
+			for (size_t i = 0; i + 1 < crossings.size(); i++) {
+				winding += crossings[i].winding;
+				bool inside = (fRule == FILL_RULE_NON_ZERO)
+					? winding != 0 : (winding & 1) != 0;
+				if (inside && crossings[i + 1].x > crossings[i].x) {
+					_AccumulateSpan(coverage, left, right, crossings[i].x,
+						crossings[i + 1].x);
+					row_touched = true;
+				}
+			}
+		}
+
+		if (row_touched == false)
+			continue;
+
+		uint8* row = bits + y * bpr;
+		for (int32 x = 0; x < width; x++) {
+			int32 value = min_c(coverage[x] / kSubScanlines, 255);
+			if (mode == RASTER_ADD)
+				row[left + x] = max_c(row[left + x], value);
+			else
+				row[left + x] = min_c(row[left + x], 255 - value);
+		}
+	}
+
+	delete[] coverage;
+}
+
+
+void
+PolygonRasterizer::_AddEdge(BPoint from, BPoint to)
+{
+	if (from.y == to.y)
+		return;
+
+	edge new_edge;
+	new_edge.winding = 1;
+	if (from.y > to.y) {
+		BPoint temp = from;
+		from = to;
+		to = temp;
+		new_edge.winding = -1;
+	}
+
+	new_edge.top = from.y;
+	new_edge.bottom = to.y;
+	new_edge.x = from.x;
+	new_edge.slope = (to.x - from.x) / (to.y - from.y);
+	fEdges.push_back(new_edge);
+}
+
+
+void
+PolygonRasterizer::_AccumulateSpan(int32* coverage, int32 left, int32 right,
+	float from, float to) const
+{
+	// The coordinates here are relative to the left side of the area.
+	from = max_c(from - left, 0);
+	to = min_c(to - left, right - left + 1);
+	if (to <= from)
+		return;
+
+	int32 first = (int32)from;
+	int32 last = (int32)to;
+	if (first == last) {
+		coverage[first] += (int32)((to - from) * kFullCoverage);
+		return;
+	}
+
+	coverage[first] += (int32)((first + 1 - from) * kFullCoverage);
+	for (int32 x = first + 1; x < last; x++)
+		coverage[x] += kFullCoverage;
+	coverage[last] += (int32)((to - last) * kFullCoverage);
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+#ifndef _POLYGON_RASTERIZER_H
+#define	_POLYGON_RASTERIZER_H
+
+#include <Point.h>
+#include <Rect.h>
+#include <SupportDefs.h>
+
+#include <vector>
+
+
+enum fill_rule {
+	FILL_RULE_NON_ZERO,
+	FILL_RULE_EVEN_ODD
+};
+
+
+enum raster_mode {
+	// The coverage is added to the map, map = max(map, coverage).
+	RASTER_ADD,
+	// The coverage is removed from the map, map = min(map, 255 - coverage).
+	RASTER_SUBTRACT
+};
+
+
+/*
+	PolygonRasterizer draws polygons to an 8-bit coverage map (e.g. the
+	selection map) without the app_server. The coverage of the pixels on the
+	edges is calculated with 16 sub-scanlines per row and exact horizontal
+	coverage on each of them. Only the rows of the map that the polygons
+	touch are changed.
+
+	The coordinates are the same as for BView: the center of the pixel x, y
+	is at x, y. The outset grows the polygons by the given distance, an
+	outset of 0.5 makes a polygon also cover the pixels that its outline
+	goes through, the same way as FillPolygon() followed by StrokePolygon().
+*/
+class PolygonRasterizer {
+public:
+						PolygonRasterizer(fill_rule rule = FILL_RULE_NON_ZERO);
+
+			void		SetFillRule(fill_rule rule) { fRule = rule; }
+
+			void		AddPolygon(const BPoint* points, int32 count,
+							float outset = 0);
+			void		MakeEmpty();
+
+			// The pixels that the polygons might touch.
+			BRect		Bounds() const;
+
+			void		Render(uint8* bits, int32 bpr, BRect map_bounds,
+							raster_mode mode) const;
+
+private:
+	struct edge {
+		float	top;
+		float	bottom;
+		float	x;		// at top
+		float	slope;	// dx / dy
+		int32	winding;
+
+		bool	operator<(const edge& other) const
+					{ return top < other.top; }
+	};
+
+	struct crossing {
+		float	x;
+		int32	winding;
+
+		bool	operator<(const crossing& other) const
+					{ return x < other.x; }
+	};
+
+			void		_AddEdge(BPoint from, BPoint to);
+			void		_AccumulateSpan(int32* coverage, int32 left,
+							int32 right, float from, float to) const;
+
+			fill_rule	fRule;
+			std::vector<edge>	fEdges;
+			float		fLeft;
+			float		fTop;
+			float		fRight;
+			float		fBottom;
+};
+
+
+#endif	// _POLYGON_RASTERIZER_H
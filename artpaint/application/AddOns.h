@@ -13,6 +13,8 @@
 class BBitmap;
 class Manipulator;
 class ManipulatorInformer;
+class ManipulatorSettings;
+class PointOperation;
 
 
 enum add_on_types {
@@ -28,5 +30,9 @@ enum add_on_types {
 
 extern "C" Manipulator* instantiate_add_on(BBitmap*, ManipulatorInformer*);
 
+// This is optional. The color add-ons whose adjustment is a single point
+// operation export it, so that several of them can be applied in one pass.
+extern "C" PointOperation* instantiate_point_operation(ManipulatorSettings*);
+
 
 #endif // ADD_ONS_H
@@ -0,0 +1,565 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+
+#include "BatchProcessor.h"
+
+#include "BitmapUtilities.h"
+#include "GUIManipulator.h"
+#include "ManipulatorServer.h"
+#include "PointOperation.h"
+#include "ScaleCanvasManipulator.h"
+#include "Selection.h"
+
+
+#include <Bitmap.h>
+#include <BitmapStream.h>
+#include <Entry.h>
+#include <File.h>
+#include <FindDirectory.h>
+#include <Path.h>
+#include <TranslationUtils.h>
+#include <TranslatorFormats.h>
+#include <TranslatorRoster.h>
+
+
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+const int32 kDefaultMemoryBudget = 512;
+
+
+// Adds a setting that is given as <attribute>=<value> in the script.
+static status_t
+parse_setting(const char* text, BMessage* settings)
+{
+	const char* equals = strchr(text, '=');
+	if (equals == NULL || equals == text || equals[1] == '\0')
+		return B_BAD_VALUE;
+
+	BString name(text, equals - text);
+	const char* value = equals + 1;
+
+	char* end;
+	long integer = strtol(value, &end, 10);
+	if (*end == '\0')
+		return settings->AddInt32(name.String(), integer);
+
+	double number = strtod(value, &end);
+	if (*end == '\0')
+		return settings->AddFloat(name.String(), number);
+
+	return settings->AddString(name.String(), value);
+}
+
+
+BatchProcessor::BatchProcessor()
+	:
+	fJobCount(1),
+	fMemoryBudget(kDefaultMemoryBudget),
+	fNextFile(0),
+	fFailedFiles(0),
+	fLoadLock("batch load lock"),
+	fMemorySemaphore(-1)
+{
+	system_info info;
+	if (get_system_info(&info) == B_OK)
+		fJobCount = max_c(info.cpu_count, 1);
+}
+
+
+BatchProcessor::~BatchProcessor()
+{
+	if (fMemorySemaphore >= 0)
+		delete_sem(fMemorySemaphore);
+
+	for (size_t i = 0; i < fSteps.size(); i++) {
+		if (fSteps[i].settings_path.Length() > 0)
+			BEntry(fSteps[i].settings_path.String()).Remove();
+	}
+}
+
+
+status_t
+BatchProcessor::ReadScript(const char* path)
+{
+	FILE* file = fopen(path, "r");
+	if (file == NULL) {
+		fprintf(stderr, "Cannot open the script '%s'\n", path);
+		return B_ENTRY_NOT_FOUND;
+	}
+
+	status_t status = B_OK;
+	char line[1024];
+	int32 line_number = 0;
+	while (status == B_OK && fgets(line, sizeof(line), file) != NULL) {
+		line_number++;
+
+		BString text(line);
+		text.Trim();
+		if (text.Length() == 0 || text.ByteAt(0) == '#')
+			continue;
+
+		batch_step step;
+		step.add_on_id = -1;
+		step.point_operation = NULL;
+		step.width = 0;
+		step.height = 0;
+
+		char command[64];
+		if (sscanf(text.String(), "%63s", command) != 1)
+			continue;
+
+		if (strcmp(command, "scale") == 0) {
+			step.type = SCALE_CANVAS_MANIPULATOR;
+			if (sscanf(text.String(), "%*s %" B_SCNd32 " %" B_SCNd32,
+					&step.width, &step.height) != 2
+				|| step.width <= 0 || step.height <= 0)
+				status = B_BAD_VALUE;
+		} else if (strcmp(command, "rotate-cw") == 0)
+			step.type = ROTATE_CW_CANVAS_MANIPULATOR;
+		else if (strcmp(command, "rotate-ccw") == 0)
+			step.type = ROTATE_CCW_CANVAS_MANIPULATOR;
+		else if (strcmp(command, "flip-horizontal") == 0)
+			step.type = HORIZ_FLIP_MANIPULATOR;
+		else if (strcmp(command, "flip-vertical") == 0)
+			step.type = VERT_FLIP_MANIPULATOR;
+		else if (strcmp(command, "add-on") == 0) {
+			step.type = ADD_ON_MANIPULATOR;
+
+			// The words with a '=' at the end of the line are the settings,
+			// the words before them are the name.
+			BString arguments = text;
+			arguments.Remove(0, strlen(command));
+			arguments.Trim();
+			while (status == B_OK) {
+				int32 start = max_c(arguments.FindLast(' '), arguments.FindLast('\t')) + 1;
+				if (arguments.FindFirst('=', start) < 0)
+					break;
+
+				status = parse_setting(arguments.String() + start, &step.settings);
+				arguments.Truncate(start);
+				arguments.Trim();
+			}
+			step.add_on_name = arguments;
+			if (step.add_on_name.Length() == 0)
+				status = B_BAD_VALUE;
+		} else
+			status = B_BAD_VALUE;
+
+		if (status != B_OK)
+			fprintf(stderr, "%s:%" B_PRId32 ": cannot parse '%s'\n", path, line_number,
+				text.String());
+		else
+			fSteps.push_back(step);
+	}
+	fclose(file);
+
+	return status;
+}
+
+
+void
+BatchProcessor::SetOutputDirectory(const char* path)
+{
+	fOutputDirectory = path;
+}
+
+
+void
+BatchProcessor::SetJobCount(int32 count)
+{
+	fJobCount = max_c(count, 1);
+}
+
+
+void
+BatchProcessor::SetMemoryBudget(int32 megabytes)
+{
+	fMemoryBudget = max_c(megabytes, 1);
+}
+
+
+void
+BatchProcessor::AddFile(const char* path)
+{
+	fFiles.push_back(BString(path));
+}
+
+
+int32
+BatchProcessor::Run()
+{
+	if (_ResolveAddOns() != B_OK)
+		return fFiles.size();
+
+	fMemorySemaphore = create_sem(fMemoryBudget, "batch memory budget");
+	if (fMemorySemaphore < 0)
+		return fFiles.size();
+
+	fOutputNames.clear();
+	for (size_t i = 0; i < fFiles.size(); i++)
+		fOutputNames.push_back(_OutputName(i));
+
+	fNextFile = 0;
+	fFailedFiles = 0;
+
+	int32 thread_count = min_c(fJobCount, (int32)fFiles.size());
+	thread_id* threads = new thread_id[thread_count];
+	for (int32 i = 0; i < thread_count; i++) {
+		threads[i] = spawn_thread(_WorkerThread, "batch worker", B_NORMAL_PRIORITY, this);
+		resume_thread(threads[i]);
+	}
+
+	for (int32 i = 0; i < thread_count; i++) {
+		status_t exit_value;
+		wait_for_thread(threads[i], &exit_value);
+	}
+	delete[] threads;
+
+	return fFailedFiles;
+}
+
+
+int
+BatchProcessor::Main(int argc, char* argv[])
+{
+	BatchProcessor processor;
+	int32 position_argument = 0;
+	for (int32 i = 0; i < argc; i++) {
+		if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+			processor.SetJobCount(atoi(argv[++i]));
+		else if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc)
+			processor.SetMemoryBudget(atoi(argv[++i]));
+		else if (position_argument == 0) {
+			if (processor.ReadScript(argv[i]) != B_OK)
+				return 1;
+			position_argument++;
+		} else if (position_argument == 1) {
+			processor.SetOutputDirectory(argv[i]);
+			position_argument++;
+		} else
+			processor.AddFile(argv[i]);
+	}
+
+	if (position_argument < 2 || processor.fFiles.empty()) {
+		fprintf(stderr, "Usage: ArtPaint --batch <script> <output directory> "
+			"[--jobs <count>] [--memory <megabytes>] <file> ...\n");
+		return 1;
+	}
+
+	return processor.Run() == 0 ? 0 : 1;
+}
+
+
+status_t
+BatchProcessor::_WorkerThread(void* data)
+{
+	((BatchProcessor*)data)->_Work();
+	return B_OK;
+}
+
+
+void
+BatchProcessor::_Work()
+{
+	int32 index;
+	while ((index = atomic_add(&fNextFile, 1)) < (int32)fFiles.size()) {
+		if (_ProcessFile(fFiles[index].String(), fOutputNames[index].String()) != B_OK)
+			atomic_add(&fFailedFiles, 1);
+	}
+}
+
+
+status_t
+BatchProcessor::_ProcessFile(const char* path, const char* output_name)
+{
+	fLoadLock.Lock();
+	BBitmap* bitmap = BTranslationUtils::GetBitmapFile(path);
+	if (bitmap == NULL) {
+		fLoadLock.Unlock();
+		fprintf(stderr, "%s: cannot read the image\n", path);
+		return B_ERROR;
+	}
+
+	bitmap = BitmapUtilities::ConvertColorSpace(bitmap, B_RGBA32);
+	BitmapUtilities::FixMissingAlpha(bitmap);
+
+	int32 reserved = _EstimateMegabytes(bitmap);
+	acquire_sem_etc(fMemorySemaphore, reserved, 0, 0);
+	fLoadLock.Unlock();
+
+	bigtime_t start = system_time();
+	status_t status = B_OK;
+	try {
+		for (size_t i = 0; i < fSteps.size(); i++) {
+			if (fSteps[i].point_operation == NULL) {
+				bitmap = _ApplyStep(fSteps[i], bitmap);
+				continue;
+			}
+
+			PointOperationPipeline pipeline;
+			for (; i < fSteps.size() && fSteps[i].point_operation != NULL; i++)
+				pipeline.AddOperation(_PointOperationFor(fSteps[i]));
+			i--;
+
+			// Everything is selected. The pipeline splits the rows over the
+			// WorkerPool, also while other files are being processed.
+			Selection selection(bitmap->Bounds());
+			pipeline.Apply(bitmap, bitmap, &selection, 1, NULL);
+		}
+	} catch (const std::bad_alloc&) {
+		status = B_NO_MEMORY;
+	}
+
+	BPath output(fOutputDirectory.String());
+	output.Append(output_name);
+
+	if (status == B_OK) {
+		// The result is written in the same format as the file was in.
+		uint32 type = B_PNG_FORMAT;
+		BTranslatorRoster* roster = BTranslatorRoster::Default();
+		BFile input(path, B_READ_ONLY);
+		translator_info info;
+		if (roster->Identify(&input, NULL, &info) == B_OK)
+			type = info.type;
+
+		BFile file(output.Path(), B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+		status = file.InitCheck();
+		if (status == B_OK) {
+			BBitmapStream stream(bitmap);
+			status = roster->Translate(&stream, NULL, NULL, &file, type,
+				B_TRANSLATOR_BITMAP);
+			stream.DetachBitmap(&bitmap);
+		}
+	}
+
+	if (status == B_OK) {
+		printf("%s -> %s (%" B_PRId64 " ms)\n", path, output.Path(),
+			(system_time() - start) / 1000);
+	} else
+		fprintf(stderr, "%s: %s\n", path, strerror(status));
+
+	delete bitmap;
+	release_sem_etc(fMemorySemaphore, reserved, 0);
+
+	return status;
+}
+
+
+BBitmap*
+BatchProcessor::_ApplyStep(const batch_step& step, BBitmap* bitmap)
+{
+	ManipulatorServer* server = ManipulatorServer::Instance();
+	if (server == NULL)
+		throw std::bad_alloc();
+
+	Manipulator* manipulator = server->ManipulatorFor(step.type, step.add_on_id);
+	if (manipulator == NULL)
+		return bitmap;
+
+	_ReadStepSettings(step, manipulator);
+
+	// Everything is selected.
+	Selection selection(bitmap->Bounds());
+	manipulator->SetSelection(&selection);
+
+	BBitmap* result = NULL;
+	try {
+		if (step.type == SCALE_CANVAS_MANIPULATOR) {
+			ScaleCanvasManipulatorSettings settings;
+			settings.right = step.width;
+			settings.bottom = step.height;
+			result = ((GUIManipulator*)manipulator)->ManipulateBitmap(&settings, bitmap, NULL);
+		} else if (GUIManipulator* gui_manipulator
+				= dynamic_cast<GUIManipulator*>(manipulator)) {
+			ManipulatorSettings* settings = gui_manipulator->ReturnSettings();
+			result = gui_manipulator->ManipulateBitmap(settings, bitmap, NULL);
+			delete settings;
+		} else
+			result = manipulator->ManipulateBitmap(bitmap, NULL);
+	} catch (...) {
+		delete manipulator;
+		throw;
+	}
+	delete manipulator;
+
+	if (result != NULL && result != bitmap) {
+		delete bitmap;
+		bitmap = result;
+	}
+	return bitmap;
+}
+
+
+PointOperation*
+BatchProcessor::_PointOperationFor(const batch_step& step) const
+{
+	ManipulatorServer* server = ManipulatorServer::Instance();
+	Manipulator* manipulator = server->ManipulatorFor(step.type, step.add_on_id);
+	if (manipulator == NULL)
+		return NULL;
+
+	// The manipulator is only needed for the stored settings.
+	_ReadStepSettings(step, manipulator);
+	ManipulatorSettings* settings = NULL;
+	if (GUIManipulator* gui_manipulator = dynamic_cast<GUIManipulator*>(manipulator))
+		settings = gui_manipulator->ReturnSettings();
+
+	PointOperation* operation = step.point_operation(settings);
+
+	delete settings;
+	delete manipulator;
+	return operation;
+}
+
+
+void
+BatchProcessor::_ReadStepSettings(const batch_step& step, Manipulator* manipulator) const
+{
+	GUIManipulator* gui_manipulator = dynamic_cast<GUIManipulator*>(manipulator);
+	if (gui_manipulator == NULL || step.settings_path.Length() == 0)
+		return;
+
+	BNode node(step.settings_path.String());
+	gui_manipulator->ReadSettings(&node);
+}
+
+
+BString
+BatchProcessor::_OutputName(int32 index) const
+{
+	// The name is numbered if an earlier input file has the same name.
+	BString leaf = BPath(fFiles[index].String()).Leaf();
+	BString base = leaf;
+	BString extension;
+	int32 dot = leaf.FindLast('.');
+	if (dot > 0) {
+		leaf.CopyInto(extension, dot, leaf.Length() - dot);
+		base.Truncate(dot);
+	}
+
+	BString name = leaf;
+	for (int32 number = 2; ; number++) {
+		bool used = false;
+		for (int32 i = 0; i < index && used == false; i++)
+			used = fOutputNames[i] == name;
+		if (used == false)
+			return name;
+
+		name.SetToFormat("%s-%" B_PRId32 "%s", base.String(), number,
+			extension.String());
+	}
+}
+
+
+int32
+BatchProcessor::_EstimateMegabytes(const BBitmap* bitmap) const
+{
+	// The largest bitmap in the sequence is needed about three times: as the
+	// source, as the result and as an intermediate buffer of the manipulator.
+	int64 largest = bitmap->BitsLength();
+	int64 width = bitmap->Bounds().IntegerWidth() + 1;
+	int64 height = bitmap->Bounds().IntegerHeight() + 1;
+	for (size_t i = 0; i < fSteps.size(); i++) {
+		if (fSteps[i].type == SCALE_CANVAS_MANIPULATOR) {
+			width = fSteps[i].width;
+			height = fSteps[i].height;
+		} else if (fSteps[i].type == ROTATE_CW_CANVAS_MANIPULATOR
+			|| fSteps[i].type == ROTATE_CCW_CANVAS_MANIPULATOR) {
+			int64 temp = width;
+			width = height;
+			height = temp;
+		}
+		largest = max_c(largest, width * height * 4);
+	}
+
+	int64 megabytes = (largest * 3 + (1 << 20) - 1) >> 20;
+	return (int32)min_c(max_c(megabytes, 1), fMemoryBudget);
+}
+
+
+status_t
+BatchProcessor::_WriteStepSettings(batch_step& step, int32 index)
+{
+	// The add-ons read their settings from the attributes of a node, so the
+	// settings of the script are written to a temporary file.
+	BPath path;
+	status_t status = find_directory(B_SYSTEM_TEMP_DIRECTORY, &path);
+	if (status != B_OK)
+		return status;
+
+	BString name;
+	name.SetToFormat("ArtPaint batch %" B_PRId32 " step %" B_PRId32,
+		(int32)find_thread(NULL), index);
+	path.Append(name.String());
+
+	BFile file(path.Path(), B_READ_WRITE | B_CREATE_FILE | B_ERASE_FILE);
+	status = file.InitCheck();
+	if (status != B_OK)
+		return status;
+	step.settings_path = path.Path();
+
+	char* attribute;
+	type_code type;
+	for (int32 i = 0; step.settings.GetInfo(B_ANY_TYPE, i, &attribute, &type) == B_OK; i++) {
+		const void* data;
+		ssize_t size;
+		if (step.settings.FindData(attribute, type, &data, &size) != B_OK
+			|| file.WriteAttr(attribute, type, 0, data, size) != size)
+			return B_ERROR;
+	}
+
+	// The add-on tells whether it found its settings.
+	Manipulator* manipulator
+		= ManipulatorServer::Instance()->ManipulatorFor(step.type, step.add_on_id);
+	GUIManipulator* gui_manipulator = dynamic_cast<GUIManipulator*>(manipulator);
+	status = gui_manipulator != NULL ? gui_manipulator->ReadSettings(&file) : B_BAD_VALUE;
+	delete manipulator;
+
+	return status;
+}
+
+
+status_t
+BatchProcessor::_ResolveAddOns()
+{
+	ManipulatorServer* server = ManipulatorServer::Instance();
+	if (server == NULL)
+		return B_NO_MEMORY;
+
+	// The add-ons are looked up in a thread of their own.
+	while (server->AddOnsLoaded() == false)
+		snooze(50000);
+
+	for (size_t i = 0; i < fSteps.size(); i++) {
+		if (fSteps[i].type != ADD_ON_MANIPULATOR)
+			continue;
+
+		fSteps[i].add_on_id = server->FindAddOn(fSteps[i].add_on_name.String());
+		image_id image = server->AddOnImage(fSteps[i].add_on_id);
+		if (image < 0 || get_image_symbol(image, "instantiate_point_operation",
+				B_SYMBOL_TYPE_TEXT, (void**)&fSteps[i].point_operation) != B_OK)
+			fSteps[i].point_operation = NULL;
+
+		if (fSteps[i].add_on_id < 0) {
+			fprintf(stderr, "Cannot find the add-on '%s'\n",
+				fSteps[i].add_on_name.String());
+			return B_ENTRY_NOT_FOUND;
+		}
+
+		if (fSteps[i].settings.CountNames(B_ANY_TYPE) > 0
+			&& _WriteStepSettings(fSteps[i], i) != B_OK) {
+			fprintf(stderr, "The add-on '%s' does not accept the settings\n",
+				fSteps[i].add_on_name.String());
+			return B_BAD_VALUE;
+		}
+	}
+
+	return B_OK;
+}
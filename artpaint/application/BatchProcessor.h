@@ -0,0 +1,117 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+#ifndef BATCH_PROCESSOR_H
+#define BATCH_PROCESSOR_H
+
+#include "Manipulator.h"
+
+#include <Locker.h>
+#include <Message.h>
+#include <OS.h>
+#include <String.h>
+
+#include <vector>
+
+
+class BBitmap;
+class PointOperation;
+
+
+/*
+	BatchProcessor applies a fixed sequence of manipulators to a number of
+	image files without opening any windows. The sequence is read from a
+	script that has one step per line:
+
+		scale <width> <height>
+		rotate-cw
+		rotate-ccw
+		flip-horizontal
+		flip-vertical
+		add-on <add-on file name> [<attribute>=<value> ...]
+
+	Add-ons are run with the settings that were stored the last time they
+	were used in the user interface. Several files are processed at the same
+	time, but a file is only started when its estimated memory use fits in
+	the memory budget.
+
+	Consecutive add-ons that only change each pixel on its own are fused
+	into a single pass.
+
+	The settings that are given after the name of an add-on replace the
+	stored ones, so that a script gives the same result everywhere. They are
+	the attributes that the add-on stores its settings in (for example
+	"add-on Blur blur_amount=5"). Whole numbers are given to the add-on as
+	int32, other numbers as float and the rest as strings.
+
+	The results are written to the output directory with the names of the
+	input files. If two input files have the same name, the later ones get a
+	number before the extension instead of overwriting the first.
+*/
+class BatchProcessor {
+public:
+							BatchProcessor();
+							~BatchProcessor();
+
+			status_t		ReadScript(const char* path);
+			void			SetOutputDirectory(const char* path);
+			void			SetJobCount(int32 count);
+			void			SetMemoryBudget(int32 megabytes);
+			void			AddFile(const char* path);
+
+			// Returns the number of files that could not be processed.
+			int32			Run();
+
+	// Parses the arguments that follow --batch on the command line and runs
+	// the batch. The return value is the exit status of the application.
+	static	int				Main(int argc, char* argv[]);
+
+private:
+	struct batch_step {
+		manipulator_type	type;
+		BString				add_on_name;
+		int32				add_on_id;
+		PointOperation*		(*point_operation)(ManipulatorSettings*);
+		int32				width;
+		int32				height;
+
+		// The settings from the script, and the file that they are written
+		// to as attributes for the add-on's ReadSettings().
+		BMessage			settings;
+		BString				settings_path;
+	};
+
+	static	status_t		_WorkerThread(void* data);
+			void			_Work();
+			status_t		_ProcessFile(const char* path, const char* output_name);
+			BBitmap*		_ApplyStep(const batch_step& step, BBitmap* bitmap);
+			PointOperation*	_PointOperationFor(const batch_step& step) const;
+			void			_ReadStepSettings(const batch_step& step,
+								Manipulator* manipulator) const;
+			BString			_OutputName(int32 index) const;
+			int32			_EstimateMegabytes(const BBitmap* bitmap) const;
+			status_t		_WriteStepSettings(batch_step& step, int32 index);
+			status_t		_ResolveAddOns();
+
+private:
+			std::vector<batch_step>	fSteps;
+			std::vector<BString>	fFiles;
+			std::vector<BString>	fOutputNames;
+			BString			fOutputDirectory;
+			int32			fJobCount;
+			int32			fMemoryBudget;
+
+			int32			fNextFile;
+			int32			fFailedFiles;
+
+			// Files are decoded one at a time and the memory for processing
+			// them is reserved before the lock is released. This way at most
+			// one decoded image is outside the budget.
+			BLocker			fLoadLock;
+			sem_id			fMemorySemaphore;
+};
+
+
+#endif // BATCH_PROCESSOR_H
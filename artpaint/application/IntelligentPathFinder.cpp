@@ -8,14 +8,164 @@
  */
 
 #include <Bitmap.h>
-#include <StopWatch.h>
+#include <math.h>
+#include <new>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "IntelligentPathFinder.h"
+#include "PixelOperations.h"
+
+
+// The search is first limited to this distance from the seed-point.
+const int32 kWindowRadius = 512;
+
+// The local costs are less than this, see local_cost().
+const int32 kBucketCount = 256;
+
+// This many points are expanded before the path_lock is released.
+const int32 kExpansionBatch = 4096;
+
+enum {
+	POINT_UNVISITED = 0,
+	POINT_ACTIVE,
+	POINT_EXPANDED
+};
+
+
+static inline uint8
+channel_byte(uint32 pixel, int32 channel)
+{
+	union color_conversion color;
+	color.word = pixel;
+	return color.bytes[channel];
+}
+
+
+static inline int32
+channel_cost(const uint32* above, const uint32* middle, const uint32* below,
+	int32 l, int32 c, int32 r, int32 channel, int32* gradient)
+{
+	int32 lt = channel_byte(above[l], channel);
+	int32 t = channel_byte(above[c], channel);
+	int32 rt = channel_byte(above[r], channel);
+	int32 lm = channel_byte(middle[l], channel);
+	int32 cm = channel_byte(middle[c], channel);
+	int32 rm = channel_byte(middle[r], channel);
+	int32 lb = channel_byte(below[l], channel);
+	int32 b = channel_byte(below[c], channel);
+	int32 rb = channel_byte(below[r], channel);
+
+	// Sobel operator in both directions.
+	gradient[0] += abs(lb - lt) + abs(2 * b - 2 * t) + abs(rb - rt);
+	gradient[1] += abs(rt - lt) + abs(2 * rm - 2 * lm) + abs(rb - lb);
+
+	// Zero-crossing of the laplacian.
+	return abs(8 * cm - (lt + t + rt + lm + rm + lb + b + rb)) < 2 ? 32 : 0;
+}
+
+
+static inline uint8
+local_cost(const uint32* above, const uint32* middle, const uint32* below,
+	int32 l, int32 c, int32 r)
+{
+	// Costs are calculated for each RGB-element and then summed. The cost
+	// is small on edges, that is where the gradient magnitude is large or
+	// the laplacian crosses zero.
+	int32 gradient[2] = { 0, 0 };
+	int32 zero = channel_cost(above, middle, below, l, c, r, 0, gradient)
+		+ channel_cost(above, middle, below, l, c, r, 1, gradient)
+		+ channel_cost(above, middle, below, l, c, r, 2, gradient);
+
+	int32 gradient_magnitude = max_c(gradient[0], gradient[1]);
+	gradient_magnitude = (int32)(32 - (gradient_magnitude / 3000.0) * 32);
+
+	// Zero would mean a free step, so the smallest cost is one.
+	return max_c(zero + gradient_magnitude, 1);
+}
+
+
+BucketQueue::BucketQueue(int32 capacity)
+{
+	bucket_heads = new int32[kBucketCount];
+	next_points = new int32[capacity];
+	prev_points = new int32[capacity];
+
+	MakeEmpty();
+}
+
+
+BucketQueue::~BucketQueue()
+{
+	delete[] bucket_heads;
+	delete[] next_points;
+	delete[] prev_points;
+}
+
+
+void
+BucketQueue::Insert(int32 index, uint32 cost)
+{
+	int32 bucket = cost % kBucketCount;
+	next_points[index] = bucket_heads[bucket];
+	prev_points[index] = -1;
+	if (bucket_heads[bucket] >= 0)
+		prev_points[bucket_heads[bucket]] = index;
+	bucket_heads[bucket] = index;
+
+	if (point_count == 0 || cost < lowest_cost)
+		lowest_cost = cost;
+	point_count++;
+}
+
+
+void
+BucketQueue::Remove(int32 index, uint32 cost)
+{
+	if (prev_points[index] >= 0)
+		next_points[prev_points[index]] = next_points[index];
+	else
+		bucket_heads[cost % kBucketCount] = next_points[index];
+
+	if (next_points[index] >= 0)
+		prev_points[next_points[index]] = prev_points[index];
+
+	point_count--;
+}
+
+
+int32
+BucketQueue::RemoveLowestCostPoint(uint32* cost)
+{
+	if (point_count == 0)
+		return -1;
+
+	while (bucket_heads[lowest_cost % kBucketCount] < 0)
+		lowest_cost++;
+
+	int32 index = bucket_heads[lowest_cost % kBucketCount];
+	*cost = lowest_cost;
+	Remove(index, lowest_cost);
+
+	return index;
+}
+
+
+void
+BucketQueue::MakeEmpty()
+{
+	for (int32 i = 0; i < kBucketCount; i++)
+		bucket_heads[i] = -1;
+
+	lowest_cost = 0;
+	point_count = 0;
+}
 
 
 IntelligentPathFinder::IntelligentPathFinder(BBitmap* bm)
+	:
+	path_lock("path lock")
 {
 	original_bitmap = bm;
 	bitmap_bits = (uint32*)bm->Bits();
@@ -23,39 +173,35 @@ IntelligentPathFinder::IntelligentPathFinder(BBitmap* bm)
 	right_border = (int32)bm->Bounds().right + 1;
 	bottom_border = (int32)bm->Bounds().bottom + 1;
 
-	local_cost_map = new uint8*[right_border];
-	for (int32 i = 0; i < right_border; i++)
-		local_cost_map[i] = new uint8[bottom_border];
-
-	for (int32 y = 0; y < bottom_border; y++) {
-		for (int32 x = 0; x < right_border; x++)
-			local_cost_map[x][y] = 0x00;
-	}
-
-	total_cost_map = new uint16*[right_border];
-	path_pointers_map = new uint32*[right_border];
-	for (int32 i = 0; i < right_border; i++) {
-		total_cost_map[i] = new uint16[bottom_border];
-		path_pointers_map[i] = new uint32[bottom_border];
-		for (int32 y = 0; y < bottom_border; y++) {
-			total_cost_map[i][y] = 0x0000;
-			path_pointers_map[i][y] = 0x00000000;
-		}
-	}
-
-	expanded_bits = new uint8*[(right_border >> 3) + 1];
-	for (int32 i = 0; i < (right_border >> 3) + 1; i++) {
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Walloc-size-larger-than="
-		expanded_bits[i] = new uint8[bottom_border];
-#pragma GCC diagnostic pop
-		for (int32 y = 0; y < bottom_border; y++)
-			expanded_bits[i][y] = 0x00;
-	}
+	// The maps are allocated for the first window, and again when the
+	// window grows larger than that.
+	local_cost_map = NULL;
+	total_cost_map = NULL;
+	path_pointers_map = NULL;
+	point_states = NULL;
+	active_point_list = NULL;
+	map_size = 0;
+	if (!ReserveMaps(min_c(right_border, 2 * kWindowRadius + 1)
+			* min_c(bottom_border, 2 * kWindowRadius + 1)))
+		throw std::bad_alloc();
+
+	for (int32 i = 0; i < 256; i++)
+		straight_costs[i] = (uint8)(i / sqrt(2.0));
+
+	window_left = window_top = 0;
+	window_width = window_height = 0;
+	window_radius = kWindowRadius;
+	largest_window_radius = max_c(right_border, bottom_border);
+
+	system_info info;
+	get_system_info(&info);
+	lc_thread_count = max_c(info.cpu_count, 1);
 
 	calculation_continuing = TRUE;
+	seed_point_changed = FALSE;
 	seed_point_x = -1;
 	seed_point_y = -1;
+	seed_index = -1;
 
 	dp_thread = spawn_thread(dp_thread_entry, "dp_thread", B_NORMAL_PRIORITY, this);
 	resume_thread(dp_thread);
@@ -68,66 +214,75 @@ IntelligentPathFinder::~IntelligentPathFinder()
 	int32 return_value;
 	wait_for_thread(dp_thread, &return_value);
 
-	for (int32 x = 0; x < right_border; x++) {
-		delete[] local_cost_map[x];
-		local_cost_map[x] = NULL;
-	}
-	for (int32 i = 0; i < right_border; i++) {
-		delete[] total_cost_map[i];
-		total_cost_map[i] = NULL;
-
-		delete[] path_pointers_map[i];
-		path_pointers_map[i] = NULL;
-	}
+	delete active_point_list;
 	delete[] local_cost_map;
 	delete[] total_cost_map;
 	delete[] path_pointers_map;
-
-	for (int32 i = 0; i < (right_border >> 3) + 1; i++) {
-		delete[] expanded_bits[i];
-		expanded_bits[i] = NULL;
-	}
-	delete[] expanded_bits;
+	delete[] point_states;
 }
 
 
 void
 IntelligentPathFinder::SetSeedPoint(int32 x, int32 y)
 {
-	seed_point_x = x;
-	seed_point_y = y;
+	path_lock.Lock();
+	seed_point_x = max_c(0, min_c(right_border - 1, x));
+	seed_point_y = max_c(0, min_c(bottom_border - 1, y));
+	window_radius = kWindowRadius;
 	seed_point_changed = TRUE;
+	path_lock.Unlock();
 }
 
 
 BPoint*
 IntelligentPathFinder::ReturnPath(int32 x, int32 y, int32* num_points)
 {
+	*num_points = 0;
+
+	path_lock.Lock();
+	if (seed_index < 0 || seed_point_changed) {
+		path_lock.Unlock();
+		return NULL;
+	}
+
+	// The window is grown to reach the point and searched again, in the
+	// meantime the path goes to the border of the window.
 	x = max_c(0, min_c(right_border - 1, x));
 	y = max_c(0, min_c(bottom_border - 1, y));
+	int32 distance = max_c(abs(x - seed_point_x), abs(y - seed_point_y));
+	if (distance > window_radius && window_radius < largest_window_radius) {
+		while (window_radius < distance)
+			window_radius *= 2;
+		window_radius = min_c(window_radius, largest_window_radius);
+		seed_point_changed = TRUE;
+	}
+
+	x = max_c(0, min_c(window_width - 1, x - window_left));
+	y = max_c(0, min_c(window_height - 1, y - window_top));
+	int32 index = x + y * window_width;
+	if (point_states[index] == POINT_UNVISITED) {
+		path_lock.Unlock();
+		return NULL;
+	}
+
 	int32 point_array_length = 128;
 	BPoint* point_array = new BPoint[point_array_length];
-
-	int32 next_x = x;
-	int32 next_y = y;
 	int32 point_count = 0;
+	int32 max_point_count = window_width * window_height;
 
-	while (((next_x != seed_point_x) || (next_y != seed_point_y))
-		&& ((next_x >= 0) && (next_y >= 0))) {
+	while (index != seed_index && point_count < max_point_count) {
 		if (point_count == point_array_length) {
 			point_array_length *= 2;
 			BPoint* new_array = new BPoint[point_array_length];
-			for (int32 i = 0; i < point_count; i++) {
-				new_array[i] = point_array[i];
-			}
+			memcpy(new_array, point_array, point_count * sizeof(BPoint));
 			delete[] point_array;
 			point_array = new_array;
 		}
-		BPoint point = ReturnNextPointInPath(next_x, next_y);
-		next_x = (int32)point.x;
-		next_y = (int32)point.y;
-		point_array[point_count++] = point;
+		index = path_pointers_map[index];
+		point_array[point_count++] = BPoint(window_left + index % window_width,
+			window_top + index / window_width);
 	}
+	path_lock.Unlock();
 
 	*num_points = point_count;
 
@@ -140,185 +295,153 @@ IntelligentPathFinder::ReturnPath(int32 x, int32 y, int32* num_points)
 }
 
 
-uint8
-IntelligentPathFinder::LocalCost(int32 x, int32 y, int32 dx, int32 dy)
+bool
+IntelligentPathFinder::ReserveMaps(int32 size)
 {
-	if (local_cost_map[x][y] != 0x00) {
-		if (abs(dx) + abs(dy) > 1)
-			return local_cost_map[x][y];
-		else
-			return (uint8)(local_cost_map[x][y] / sqrt(2.0));
-	} else {
-		// Here we must calculate the local cost between x,y and all of its neighbours.
-		union {
-			uint8 bytes[4];
-			uint32 word;
-		} lt, t, rt, l, r, lb, b, rb, c;
-		int32 new_x, new_y;
-		new_x = max_c(min_c(x - 1, right_border - 1), 0);
-		new_y = max_c(min_c(y - 1, bottom_border - 1), 0);
-		lt.word = *(bitmap_bits + new_x + new_y * bitmap_bpr);
-
-		new_x = max_c(min_c(x, right_border - 1), 0);
-		new_y = max_c(min_c(y - 1, bottom_border - 1), 0);
-		t.word = *(bitmap_bits + new_x + new_y * bitmap_bpr);
-
-		new_x = max_c(min_c(x + 1, right_border - 1), 0);
-		new_y = max_c(min_c(y - 1, bottom_border - 1), 0);
-		rt.word = *(bitmap_bits + new_x + new_y * bitmap_bpr);
-
-		new_x = max_c(min_c(x - 1, right_border - 1), 0);
-		new_y = max_c(min_c(y, bottom_border - 1), 0);
-		l.word = *(bitmap_bits + new_x + new_y * bitmap_bpr);
-
-		new_x = max_c(min_c(x + 1, right_border - 1), 0);
-		new_y = max_c(min_c(y, bottom_border - 1), 0);
-		r.word = *(bitmap_bits + new_x + new_y * bitmap_bpr);
-
-		new_x = max_c(min_c(x - 1, right_border - 1), 0);
-		new_y = max_c(min_c(y + 1, bottom_border - 1), 0);
-		lb.word = *(bitmap_bits + new_x + new_y * bitmap_bpr);
-
-		new_x = max_c(min_c(x, right_border - 1), 0);
-		new_y = max_c(min_c(y + 1, bottom_border - 1), 0);
-		b.word = *(bitmap_bits + new_x + new_y * bitmap_bpr);
-
-		new_x = max_c(min_c(x + 1, right_border - 1), 0);
-		new_y = max_c(min_c(y + 1, bottom_border - 1), 0);
-		rb.word = *(bitmap_bits + new_x + new_y * bitmap_bpr);
-
-		c.word = *(bitmap_bits + x + y * bitmap_bpr);
-
-		// Here we can calculate the costs. Costs are calculated
-		// for each RGB(A)-element and then summed.
-		// For now lets just use the inverse of gradient magnitude as the cost.
-		int32 gradient_magnitude;
-		int32 red_magn, green_magn, blue_magn;
-		red_magn = abs(lb.bytes[2] - lt.bytes[2])
-			+ abs(2 * b.bytes[2] - 2 * t.bytes[2])
-			+ abs(rb.bytes[2] - rt.bytes[2]);
-
-		green_magn = abs(lb.bytes[1] - lt.bytes[1])
-			+ abs(2 * b.bytes[1] - 2 * t.bytes[1])
-			+ abs(rb.bytes[1] - rt.bytes[1]);
-
-		blue_magn = abs(lb.bytes[0] - lt.bytes[0])
-			+ abs(2 * b.bytes[0] - 2 * t.bytes[0])
-			+ abs(rb.bytes[0] - rt.bytes[0]);
-
-		gradient_magnitude = red_magn + blue_magn + green_magn;
-
-		red_magn = abs(rt.bytes[2] - lt.bytes[2])
-			+ abs(2 * r.bytes[2] - 2 * l.bytes[2])
-			+ abs(rb.bytes[2] - lb.bytes[2]);
-
-		green_magn = abs(rt.bytes[1] - lt.bytes[1])
-			+ abs(2 * r.bytes[1] - 2 * l.bytes[1])
-			+ abs(rb.bytes[1] - lb.bytes[1]);
-
-		blue_magn = abs(rt.bytes[0] - lt.bytes[0])
-			+ abs(2 * r.bytes[0] - 2 * l.bytes[0])
-			+ abs(rb.bytes[0] - lb.bytes[0]);
-
-		gradient_magnitude = max_c(gradient_magnitude, red_magn + blue_magn + green_magn);
-
-		uint8 red_zero, green_zero, blue_zero;
-
-		red_zero = (abs(8 * c.bytes[2] - (lt.bytes[2]
-			+ t.bytes[2] + rt.bytes[2] + l.bytes[2] + r.bytes[2]
-			+ lb.bytes[2] + b.bytes[2] + rb.bytes[2])) < 2 ? 32 : 0);
-
-		green_zero = (abs(8 * c.bytes[1] - (lt.bytes[1]
-			+ t.bytes[1] + rt.bytes[1] + l.bytes[1] + r.bytes[1]
-			+ lb.bytes[1] + b.bytes[1] + rb.bytes[1])) < 2 ? 32 : 0);
-
-		blue_zero = (abs(8 * c.bytes[0] - (lt.bytes[0]
-			+ t.bytes[0] + rt.bytes[0] + l.bytes[0] + r.bytes[0]
-			+ lb.bytes[0] + b.bytes[0] + rb.bytes[0])) < 2 ? 32 : 0);
-
-		gradient_magnitude = (int32)(32 - (gradient_magnitude / 3000.0) * 32);
-		uint8 value = red_zero + green_zero + blue_zero + gradient_magnitude;
-
-		local_cost_map[x][y] = value;
-
-		if (abs(dx) + abs(dy) > 1)
-			return value;
-		else
-			return (uint8)(value / sqrt(2.0));
+	if (size <= map_size)
+		return true;
+
+	uint8* new_local_costs = new (std::nothrow) uint8[size];
+	uint32* new_total_costs = new (std::nothrow) uint32[size];
+	int32* new_path_pointers = new (std::nothrow) int32[size];
+	uint8* new_point_states = new (std::nothrow) uint8[size];
+	BucketQueue* new_point_list = NULL;
+	if (new_local_costs != NULL && new_total_costs != NULL
+		&& new_path_pointers != NULL && new_point_states != NULL) {
+		try {
+			new_point_list = new BucketQueue(size);
+		} catch (...) {
+			new_point_list = NULL;
+		}
 	}
-}
 
+	if (new_point_list == NULL) {
+		delete[] new_local_costs;
+		delete[] new_total_costs;
+		delete[] new_path_pointers;
+		delete[] new_point_states;
+		return false;
+	}
 
-uint16
-IntelligentPathFinder::ReturnTotalCost(int32 x, int32 y)
-{
-	return total_cost_map[x][y];
-}
+	delete[] local_cost_map;
+	delete[] total_cost_map;
+	delete[] path_pointers_map;
+	delete[] point_states;
+	delete active_point_list;
 
+	local_cost_map = new_local_costs;
+	total_cost_map = new_total_costs;
+	path_pointers_map = new_path_pointers;
+	point_states = new_point_states;
+	active_point_list = new_point_list;
+	map_size = size;
 
-void
-IntelligentPathFinder::SetTotalCost(int32 x, int32 y, uint16 cost)
-{
-	total_cost_map[x][y] = cost;
+	return true;
 }
 
 
-BPoint
-IntelligentPathFinder::ReturnNextPointInPath(int32 x, int32 y)
+inline uint8
+IntelligentPathFinder::LocalCost(int32 index, int32 dx, int32 dy)
 {
-	if (ReturnTotalCost(x, y) > 0) {
-		int32 value = path_pointers_map[x][y];
-		BPoint point;
-		point.x = (value >> 16) & 0xFFFF;
-		point.y = value & 0xFFFF;
-
-		return point;
-	} else {
-		BPoint point(-1, -1);
-		return point;
-	}
+	if (abs(dx) + abs(dy) > 1)
+		return local_cost_map[index];
+	else
+		return straight_costs[local_cost_map[index]];
 }
 
 
 void
-IntelligentPathFinder::SetNextPointInPath(int32 x, int32 y, int32 nx, int32 ny)
+IntelligentPathFinder::CalculateLocalCosts()
 {
-	path_pointers_map[x][y] = (nx << 16) | ny;
-}
+	if (lc_thread_count == 1) {
+		lc_thread_function(0);
+		return;
+	}
 
+	thread_id* threads = new thread_id[lc_thread_count];
+	for (int32 i = 0; i < lc_thread_count; i++) {
+		threads[i] = spawn_thread(lc_thread_entry, "lc_thread", B_NORMAL_PRIORITY, this);
+		resume_thread(threads[i]);
+		send_data(threads[i], i, NULL, 0);
+	}
 
-void
-IntelligentPathFinder::ResetTotalCostsAndPaths()
-{
-	for (int32 i = 0; i < right_border; i++) {
-		for (int32 y = 0; y < bottom_border; y++) {
-			total_cost_map[i][y] = 0x0000;
-			path_pointers_map[i][y] = 0x00000000;
-		}
+	for (int32 i = 0; i < lc_thread_count; i++) {
+		int32 return_value;
+		wait_for_thread(threads[i], &return_value);
 	}
+	delete[] threads;
 }
 
 
-bool
-IntelligentPathFinder::IsExpanded(int32 x, int32 y)
+void
+IntelligentPathFinder::CalculateLocalCostRow(int32 y)
 {
-	return (expanded_bits[x >> 3][y] >> ((7 - x) & 0x7)) & 0x01;
+	int32 bitmap_y = window_top + y;
+	const uint32* above = bitmap_bits + max_c(bitmap_y - 1, 0) * bitmap_bpr;
+	const uint32* middle = bitmap_bits + bitmap_y * bitmap_bpr;
+	const uint32* below = bitmap_bits + min_c(bitmap_y + 1, bottom_border - 1) * bitmap_bpr;
+	uint8* costs = local_cost_map + y * window_width;
+
+	int32 left = window_left;
+	int32 right = window_left + window_width - 1;
+
+	// The columns at the edges of the bitmap are repeated, the other
+	// columns do not need any clamping.
+	if (left == 0) {
+		costs[0] = local_cost(above, middle, below, 0, 0, min_c(1, right_border - 1));
+		left++;
+	}
+	if (right == right_border - 1 && right >= left) {
+		costs[right - window_left] = local_cost(above, middle, below, max_c(right - 1, 0), right, right);
+		right--;
+	}
+
+	for (int32 x = left; x <= right; x++)
+		costs[x - window_left] = local_cost(above, middle, below, x - 1, x, x + 1);
 }
 
 
 void
-IntelligentPathFinder::SetExpanded(int32 x, int32 y)
+IntelligentPathFinder::ResetTotalCostsAndPaths()
 {
-	expanded_bits[x >> 3][y] |= 0x01 << ((7 - x) & 0x7);
+	int32 size = window_width * window_height;
+	memset(total_cost_map, 0, size * sizeof(uint32));
+	memset(point_states, POINT_UNVISITED, size);
+	active_point_list->MakeEmpty();
 }
 
 
 void
-IntelligentPathFinder::ResetExpanded()
+IntelligentPathFinder::ExpandPoint(int32 index, uint32 cost)
 {
-	for (int32 i = 0; i < (right_border >> 3) + 1; i++) {
-		for (int32 y = 0; y < bottom_border; y++)
-			expanded_bits[i][y] = 0x00;
+	point_states[index] = POINT_EXPANDED;
+
+	int32 x = index % window_width;
+	int32 y = index / window_width;
+	for (int32 dy = -1; dy <= 1; dy++) {
+		if (y + dy < 0 || y + dy >= window_height)
+			continue;
+
+		for (int32 dx = -1; dx <= 1; dx++) {
+			if ((dx == 0 && dy == 0) || x + dx < 0 || x + dx >= window_width)
+				continue;
+
+			int32 neighbour = index + dx + dy * window_width;
+			if (point_states[neighbour] == POINT_EXPANDED)
+				continue;
+
+			uint32 new_cost = cost + LocalCost(index, dx, dy);
+			if (point_states[neighbour] == POINT_ACTIVE) {
+				if (new_cost >= total_cost_map[neighbour])
+					continue;
+				active_point_list->Remove(neighbour, total_cost_map[neighbour]);
+			}
+
+			total_cost_map[neighbour] = new_cost;
+			path_pointers_map[neighbour] = index;
+			point_states[neighbour] = POINT_ACTIVE;
+			active_point_list->Insert(neighbour, new_cost);
+		}
 	}
 }
 
@@ -338,49 +461,46 @@ IntelligentPathFinder::dp_thread_function()
 	while ((seed_point_x == -1) && (seed_point_y == -1) && calculation_continuing)
 		snooze(50 * 1000);
 
-	seed_point_changed = FALSE;
-
 	while (calculation_continuing) {
-		active_point_list = new OrderedPointList();
-		active_point_list->InsertPoint(seed_point_x, seed_point_y, 0);
-		SetTotalCost(seed_point_x, seed_point_y, 0);
+		path_lock.Lock();
+		seed_point_changed = FALSE;
+
+		// If there is not enough memory for a larger window, the window
+		// is not grown that large again.
+		while (true) {
+			window_left = max_c(0, seed_point_x - window_radius);
+			window_top = max_c(0, seed_point_y - window_radius);
+			window_width = min_c(right_border - 1, seed_point_x + window_radius)
+				- window_left + 1;
+			window_height = min_c(bottom_border - 1, seed_point_y + window_radius)
+				- window_top + 1;
+			if (ReserveMaps(window_width * window_height))
+				break;
+
+			largest_window_radius = max_c(window_radius / 2, kWindowRadius);
+			window_radius = largest_window_radius;
+		}
+
+		CalculateLocalCosts();
+		ResetTotalCostsAndPaths();
+
+		seed_index = (seed_point_x - window_left) + (seed_point_y - window_top) * window_width;
+		point_states[seed_index] = POINT_ACTIVE;
+		active_point_list->Insert(seed_index, 0);
+		path_lock.Unlock();
+
 		while (!active_point_list->IsEmpty() && !seed_point_changed && calculation_continuing) {
-			int32 x, y;
-			uint16 cost;
-			active_point_list->RemoveLowestCostPoint(&x, &y, &cost);
-			SetExpanded(x, y);
-
-			for (int32 dy = -1; dy <= 1; dy++) {
-				for (int32 dx = -1; dx <= 1; dx++) {
-					if ((dx != 0) || (dy != 0)) {
-						if ((x + dx >= 0) && (x + dx < right_border) && (y + dy >= 0)
-							&& (y + dy < bottom_border)) {
-							if (IsExpanded(x + dx, y + dy) == FALSE) {
-								uint16 temp_cost = ReturnTotalCost(x, y) + LocalCost(x, y, dx, dy);
-								uint16 previous_cost = ReturnTotalCost(x + dx, y + dy);
-								if ((previous_cost > 0) && (temp_cost < previous_cost))
-									active_point_list->RemovePoint(x + dx, y + dy, previous_cost);
-								if (((previous_cost == 0) || (temp_cost < previous_cost))
-									&&  (x >= 0 && y >= 0)) {
-									SetTotalCost(x + dx, y + dy, temp_cost);
-									SetNextPointInPath(x + dx, y + dy, x, y);
-									active_point_list->InsertPoint(x + dx, y + dy, temp_cost);
-								}
-							}
-						}
-					}
-				}
+			path_lock.Lock();
+			for (int32 i = 0; i < kExpansionBatch && !active_point_list->IsEmpty(); i++) {
+				uint32 cost;
+				int32 index = active_point_list->RemoveLowestCostPoint(&cost);
+				ExpandPoint(index, cost);
 			}
+			path_lock.Unlock();
 		}
-		while (!seed_point_changed && calculation_continuing)
-			snooze(100 * 1000); // Calculated all costs.
 
-		if (calculation_continuing) {
-			delete active_point_list;
-			ResetExpanded();
-			ResetTotalCostsAndPaths();
-			seed_point_changed = FALSE;
-		}
+		while (!seed_point_changed && calculation_continuing)
+			snooze(20 * 1000); // Calculated all costs.
 	}
 
 	return B_OK;
@@ -390,13 +510,21 @@ IntelligentPathFinder::dp_thread_function()
 int32
 IntelligentPathFinder::lc_thread_entry(void* data)
 {
-	return B_OK;
+	int32 thread_number = receive_data(NULL, NULL, 0);
+	IntelligentPathFinder* this_pointer = (IntelligentPathFinder*)data;
+	return this_pointer->lc_thread_function(thread_number);
 }
 
 
 int32
-IntelligentPathFinder::lc_thread_function()
+IntelligentPathFinder::lc_thread_function(int32 thread_number)
 {
+	// The rows of the window are divided evenly between the threads.
+	int32 first_row = window_height * thread_number / lc_thread_count;
+	int32 last_row = window_height * (thread_number + 1) / lc_thread_count;
+	for (int32 y = first_row; y < last_row; y++)
+		CalculateLocalCostRow(y);
+
 	return B_OK;
 }
 
@@ -404,185 +532,9 @@ IntelligentPathFinder::lc_thread_function()
 void
 IntelligentPathFinder::PrintCostMap()
 {
-	for (int32 y = 0; y < bottom_border; y++) {
-		for (int32 x = 0; x < right_border; x++)
-			printf("%d ", ReturnTotalCost(x, y));
+	for (int32 y = 0; y < window_height; y++) {
+		for (int32 x = 0; x < window_width; x++)
+			printf("%" B_PRIu32 " ", total_cost_map[x + y * window_width]);
 		printf("\n");
 	}
 }
-
-
-OrderedPointList::OrderedPointList()
-{
-	point_list_head = NULL;
-	cost_limits = new point*[(int32)pow(2, 16)];
-	for (int32 i = 0; i < pow(2, 16); i++)
-		cost_limits[i] = NULL;
-
-	highest_cost = 0;
-}
-
-
-OrderedPointList::~OrderedPointList()
-{
-	point* spare = point_list_head;
-	while (spare != NULL) {
-		point* helper = spare->next_point;
-		delete spare;
-		spare = helper;
-	}
-
-	for (int32 i = 0; i < pow(2, 16); i++)
-		cost_limits[i] = NULL;
-
-	delete[] cost_limits;
-}
-
-
-void
-OrderedPointList::RemoveLowestCostPoint(int32* x, int32* y, uint16* cost)
-{
-	if (point_list_head != NULL) {
-		point* spare = point_list_head;
-		point_list_head = spare->next_point;
-		*x = spare->x;
-		*y = spare->y;
-		*cost = spare->cost;
-		if (point_list_head != NULL) {
-			point_list_head->prev_point = NULL;
-			if (point_list_head->cost == *cost)
-				cost_limits[*cost] = point_list_head;
-			else
-				cost_limits[*cost] = NULL;
-		} else {
-			highest_cost = 0;
-			cost_limits[*cost] = NULL;
-		}
-		delete spare;
-	} else {
-		*x = -1;
-		*y = -1;
-		*cost = 0;
-	}
-}
-
-
-void
-OrderedPointList::RemovePoint(int32 x, int32 y, uint16 cost)
-{
-	point* spare = cost_limits[cost];
-	while ((spare != NULL) && ((spare->x != x) && (spare->y != y) && (spare->cost == cost)))
-		spare = spare->next_point;
-
-	if ((spare != NULL) && (spare->cost != cost))
-		spare = NULL;
-
-	if (spare != NULL) {
-		if (spare->prev_point != NULL)
-			spare->prev_point->next_point = spare->next_point;
-
-		if (spare->next_point != NULL)
-			spare->next_point->prev_point = spare->prev_point;
-
-		if (spare == cost_limits[cost]) {
-			if ((spare->next_point != NULL) && (spare->next_point->cost == cost))
-				cost_limits[cost] = spare->next_point;
-			else {
-				cost_limits[cost] = NULL;
-				if (highest_cost == cost) {
-					while ((highest_cost > 0) && (cost_limits[highest_cost] == NULL))
-						highest_cost--;
-				}
-			}
-		}
-		if (point_list_head == spare)
-			point_list_head = spare->next_point;
-
-		delete spare;
-	}
-}
-
-
-void
-OrderedPointList::InsertPoint(int32 x, int32 y, uint16 cost)
-{
-	point* spare = new point;
-	spare->x = x;
-	spare->y = y;
-	spare->cost = cost;
-	spare->next_point = NULL;
-	spare->prev_point = NULL;
-
-	if (cost_limits[cost] != NULL) {
-		spare->next_point = cost_limits[cost];
-		spare->prev_point = cost_limits[cost]->prev_point;
-		if (spare->next_point != NULL)
-			spare->next_point->prev_point = spare;
-		if (spare->prev_point != NULL)
-			spare->prev_point->next_point = spare;
-		cost_limits[cost] = spare;
-	} else {
-		if (cost < highest_cost) {
-			int32 next_cost = cost + 1;
-			while (cost_limits[next_cost] == NULL)
-				next_cost++;
-
-			spare->next_point = cost_limits[next_cost];
-			spare->prev_point = cost_limits[next_cost]->prev_point;
-			if (spare->next_point != NULL)
-				spare->next_point->prev_point = spare;
-			if (spare->prev_point != NULL)
-				spare->prev_point->next_point = spare;
-			cost_limits[cost] = spare;
-		} else {
-			int32 prev_cost = cost - 1;
-			while ((prev_cost >= 0) && (cost_limits[prev_cost] == NULL))
-				prev_cost--;
-
-			if (prev_cost >= 0) {
-				point* helper = cost_limits[prev_cost];
-
-				if (helper != NULL) {
-					while ((helper->next_point != NULL) && (helper->cost < cost))
-						helper = helper->next_point;
-
-					spare->next_point = helper;
-					spare->prev_point = helper->prev_point;
-					if (spare->next_point != NULL)
-						spare->next_point->prev_point = spare;
-					if (spare->prev_point != NULL)
-						spare->prev_point->next_point = spare;
-					cost_limits[cost] = spare;
-				} else
-					cost_limits[cost] = spare;
-			} else
-				cost_limits[cost] = spare;
-		}
-	}
-
-	if (spare->prev_point == NULL)
-		point_list_head = spare;
-
-	highest_cost = max_c(highest_cost, cost);
-}
-
-
-int32
-OrderedPointList::ContainsPoint(int32 x, int32 y, uint16 min_cost)
-{
-	if (min_cost > highest_cost)
-		return -1;
-	while (cost_limits[min_cost] == NULL)
-		min_cost++;
-
-	point* spare = cost_limits[min_cost];
-
-	while (spare != NULL) {
-		if ((spare->x == x) && (spare->y == y))
-			return spare->cost;
-
-		spare = spare->next_point;
-	}
-
-	return -1;
-}
@@ -9,39 +9,56 @@
 #ifndef INTELLIGENT_PATH_FINDER_H
 #define	INTELLIGENT_PATH_FINDER_H
 
+#include <Locker.h>
 #include <OS.h>
+#include <Point.h>
 #include <SupportDefs.h>
 
+
+class BBitmap;
+
+
 /*
-	This class calculates shortest paths between seed-point and other points.
-	This is primarily intended to be used with intelligent scissors but it could
-	be used for other purposes too.
+	BucketQueue is a Dial's queue for the active points of the shortest path
+	search. The points are identified by their index and every point can be
+	in the queue only once. Because the cost of a single step is always less
+	than the number of buckets, the costs in the queue always fit in the
+	circular array of buckets. All memory is allocated in the constructor.
 */
-class OrderedPointList {
-		struct point {
-			point*	next_point;
-			point*	prev_point;
-			int32	x;
-			int32	y;
-			uint16	cost;
-		};
-
-		uint16		highest_cost;
-		point*		point_list_head;
-		point**		cost_limits;
-
+class BucketQueue {
 public:
-					OrderedPointList();
-					~OrderedPointList();
-
-		void		RemoveLowestCostPoint(int32* x, int32* y, uint16* cost);
-		void		RemovePoint(int32 x,int32 y, uint16 cost);
-		void		InsertPoint(int32 x, int32 y, uint16 cost);
-		int32		ContainsPoint(int32 x, int32 y, uint16 min_cost);
-		bool		IsEmpty() { return point_list_head == NULL; }
+					BucketQueue(int32 capacity);
+					~BucketQueue();
+
+		void		Insert(int32 index, uint32 cost);
+		void		Remove(int32 index, uint32 cost);
+		// Returns -1 if the queue is empty.
+		int32		RemoveLowestCostPoint(uint32* cost);
+		void		MakeEmpty();
+		bool		IsEmpty() const { return point_count == 0; }
+
+private:
+		int32*		bucket_heads;
+		int32*		next_points;
+		int32*		prev_points;
+		uint32		lowest_cost;
+		int32		point_count;
 };
 
 
+/*
+	This class calculates shortest paths between seed-point and other points.
+	This is primarily intended to be used with intelligent scissors but it could
+	be used for other purposes too.
+
+	The search is limited to a window around the seed-point, so that the paths
+	can be shown while the mouse moves even on very large images. When a path
+	is asked to a point outside of the window, the window is made larger and
+	the search starts again from the seed-point. Until then the point is
+	moved to the border of the window. All of the maps are stored row by row
+	for the window only and the local costs of the window are calculated in
+	parallel whenever the seed-point or the window changes.
+*/
 class IntelligentPathFinder {
 		BBitmap*	original_bitmap;
 		uint32*		bitmap_bits;
@@ -49,32 +66,40 @@ class IntelligentPathFinder {
 		int32		right_border;
 		int32		bottom_border;
 
-		// Entry that is 0 in local cost map means that the value for that particular pixel
-		// has not yet been calculated.
-		uint8**		local_cost_map;
-		uint8		LocalCost(int32 x, int32 y,int32 dx, int32 dy);
-
-		// The total costs and the paths are stored here.
-		uint16**	total_cost_map;
-		uint32**	path_pointers_map;	// High 16 bits is the x coordinate while the
-										//rest is y coordinate
-		uint16		ReturnTotalCost(int32 x, int32 y);
-		void		SetTotalCost(int32 x, int32 y, uint16 cost);
-		BPoint		ReturnNextPointInPath(int32 x, int32 y);
-		void		SetNextPointInPath(int32 x, int32 y, int32 nx, int32 ny);
+		// The window that is being searched.
+		int32		window_left;
+		int32		window_top;
+		int32		window_width;
+		int32		window_height;
+		int32		window_radius;
+		int32		largest_window_radius;
+
+		// The maps have room for this many points.
+		int32		map_size;
+		bool		ReserveMaps(int32 size);
+
+		// The cost of moving from a pixel to its diagonal neighbours. Moving
+		// to the other neighbours costs straight_costs[local_cost].
+		uint8*		local_cost_map;
+		uint8		straight_costs[256];
+		uint8		LocalCost(int32 index, int32 dx, int32 dy);
+		void		CalculateLocalCosts();
+		void		CalculateLocalCostRow(int32 y);
+
+		// The total costs and the paths are stored here. The path of a point
+		// is the index of the previous point.
+		uint32*		total_cost_map;
+		int32*		path_pointers_map;
+		uint8*		point_states;
 		void		ResetTotalCostsAndPaths();
-
-		// The expanded pixels are stored here.
-		uint8**		expanded_bits; // 1 means that the pixel is expanded, 0 means it is not.
-		bool		IsExpanded(int32 x, int32 y);
-		void		SetExpanded(int32 x, int32 y);
-		void		ResetExpanded();
+		void		ExpandPoint(int32 index, uint32 cost);
 
 		// Here is the list that holds the active points.
-		OrderedPointList*	active_point_list;
+		BucketQueue*	active_point_list;
 
 		int32		seed_point_x;
 		int32		seed_point_y;
+		int32		seed_index;
 
 		thread_id	dp_thread;
 
@@ -82,12 +107,17 @@ static	int32		dp_thread_entry(void*);
 		int32		dp_thread_function();
 
 static	int32		lc_thread_entry(void*);
-		int32		lc_thread_function();
+		int32		lc_thread_function(int32 thread_number);
+
+		int32		lc_thread_count;
 
 		// The next variables are used in controlling the two threads.
 		bool		calculation_continuing;
 		bool		seed_point_changed;
 
+		// Protects the maps while they are read in ReturnPath().
+		BLocker		path_lock;
+
 		void		PrintCostMap();
 
 public:
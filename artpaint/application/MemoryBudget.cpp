@@ -0,0 +1,280 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+
+#include "MemoryBudget.h"
+
+#include "SettingsServer.h"
+
+
+#include <Autolock.h>
+#include <Bitmap.h>
+
+
+#include <algorithm>
+#include <map>
+#include <string.h>
+#include <vector>
+
+
+struct tracked_block {
+	const void*		document;
+	memory_category	category;
+	int64			bytes;
+};
+
+
+struct reclaimer_entry {
+	MemoryReclaimer*	reclaimer;
+	int32				priority;
+	const void*			document;
+};
+
+
+static bool
+compare_priority(const reclaimer_entry& a, const reclaimer_entry& b)
+{
+	return a.priority < b.priority;
+}
+
+
+typedef std::map<const void*, tracked_block> BlockMap;
+typedef std::map<const void*, memory_usage> UsageMap;
+
+static BlockMap sBlocks;
+static UsageMap sDocumentUsage;
+static memory_usage sTotalUsage;
+static std::vector<reclaimer_entry> sReclaimers;
+
+
+static void
+add_usage(memory_usage& usage, memory_category category, int64 bytes)
+{
+	usage.live[category] += bytes;
+	usage.live_total += bytes;
+
+	usage.peak[category] = max_c(usage.peak[category], usage.live[category]);
+	usage.peak_total = max_c(usage.peak_total, usage.live_total);
+}
+
+
+static memory_usage&
+usage_for_document(const void* document)
+{
+	UsageMap::iterator it = sDocumentUsage.find(document);
+	if (it == sDocumentUsage.end()) {
+		memory_usage usage;
+		memset(&usage, 0, sizeof(memory_usage));
+		it = sDocumentUsage.insert(UsageMap::value_type(document, usage)).first;
+	}
+
+	return it->second;
+}
+
+
+int32 MemoryBudget::fBudget = 0;
+BLocker MemoryBudget::fLocker("memory budget lock");
+
+
+void
+MemoryBudget::Track(const BBitmap* bitmap, const void* document,
+	memory_category category)
+{
+	if (bitmap == NULL || !bitmap->IsValid())
+		return;
+
+	Track(bitmap, bitmap->BitsLength(), document, category);
+}
+
+
+void
+MemoryBudget::Track(const void* block, int64 bytes, const void* document,
+	memory_category category)
+{
+	if (block == NULL)
+		return;
+
+	BAutolock _(fLocker);
+
+	BlockMap::iterator it = sBlocks.find(block);
+	if (it != sBlocks.end()) {
+		tracked_block& tracked = it->second;
+		add_usage(usage_for_document(tracked.document), tracked.category,
+			-tracked.bytes);
+		add_usage(sTotalUsage, tracked.category, -tracked.bytes);
+	}
+
+	tracked_block& tracked = sBlocks[block];
+	tracked.document = document;
+	tracked.category = category;
+	tracked.bytes = bytes;
+
+	add_usage(usage_for_document(document), category, bytes);
+	add_usage(sTotalUsage, category, bytes);
+}
+
+
+void
+MemoryBudget::Untrack(const void* block)
+{
+	if (block == NULL)
+		return;
+
+	BAutolock _(fLocker);
+
+	BlockMap::iterator it = sBlocks.find(block);
+	if (it == sBlocks.end())
+		return;
+
+	tracked_block& tracked = it->second;
+	add_usage(usage_for_document(tracked.document), tracked.category,
+		-tracked.bytes);
+	add_usage(sTotalUsage, tracked.category, -tracked.bytes);
+	sBlocks.erase(it);
+}
+
+
+void
+MemoryBudget::DeleteBitmap(BBitmap* bitmap)
+{
+	Untrack(bitmap);
+	delete bitmap;
+}
+
+
+void
+MemoryBudget::RemoveDocument(const void* document)
+{
+	BAutolock _(fLocker);
+
+	// The blocks that were not untracked are moved to the shared ones, so
+	// that the totals still add up.
+	for (BlockMap::iterator it = sBlocks.begin(); it != sBlocks.end(); it++) {
+		tracked_block& tracked = it->second;
+		if (tracked.document == document) {
+			tracked.document = NULL;
+			add_usage(usage_for_document(NULL), tracked.category, tracked.bytes);
+		}
+	}
+
+	sDocumentUsage.erase(document);
+}
+
+
+bool
+MemoryBudget::GetUsage(const void* document, memory_usage* usage)
+{
+	BAutolock _(fLocker);
+
+	UsageMap::iterator it = sDocumentUsage.find(document);
+	if (it == sDocumentUsage.end())
+		return false;
+
+	*usage = it->second;
+	return true;
+}
+
+
+void
+MemoryBudget::GetTotalUsage(memory_usage* usage)
+{
+	BAutolock _(fLocker);
+
+	*usage = sTotalUsage;
+}
+
+
+void
+MemoryBudget::SetBudget(int32 megabytes)
+{
+	fBudget = max_c(megabytes, 0);
+
+	if (SettingsServer* server = SettingsServer::Instance())
+		server->SetValue(SettingsServer::Application, skMemoryBudget, fBudget);
+}
+
+
+void
+MemoryBudget::AddReclaimer(MemoryReclaimer* reclaimer, int32 priority,
+	const void* document)
+{
+	BAutolock _(fLocker);
+
+	reclaimer_entry entry;
+	entry.reclaimer = reclaimer;
+	entry.priority = priority;
+	entry.document = document;
+	sReclaimers.push_back(entry);
+}
+
+
+void
+MemoryBudget::RemoveReclaimer(MemoryReclaimer* reclaimer)
+{
+	BAutolock _(fLocker);
+
+	for (size_t i = 0; i < sReclaimers.size(); i++) {
+		if (sReclaimers[i].reclaimer == reclaimer) {
+			sReclaimers.erase(sReclaimers.begin() + i);
+			break;
+		}
+	}
+}
+
+
+int64
+MemoryBudget::Enforce(const void* document)
+{
+	if (fBudget == 0)
+		return 0;
+
+	std::vector<reclaimer_entry> reclaimers;
+	int64 excess;
+	{
+		BAutolock _(fLocker);
+
+		excess = sTotalUsage.live_total - (int64)fBudget * 1024 * 1024;
+		if (excess <= 0)
+			return 0;
+
+		for (size_t i = 0; i < sReclaimers.size(); i++) {
+			if (sReclaimers[i].document == NULL
+				|| sReclaimers[i].document == document)
+				reclaimers.push_back(sReclaimers[i]);
+		}
+	}
+
+	// The lock is not held while the reclaimers run, because they untrack
+	// the bitmaps that they delete.
+	std::stable_sort(reclaimers.begin(), reclaimers.end(), compare_priority);
+
+	int64 freed = 0;
+	for (size_t i = 0; i < reclaimers.size() && freed < excess; i++)
+		freed += reclaimers[i].reclaimer->ReclaimMemory(excess - freed);
+
+	return freed;
+}
+
+
+const char*
+MemoryBudget::CategoryName(memory_category category)
+{
+	switch (category) {
+		case LAYER_MEMORY:
+			return "layers";
+		case RENDER_MEMORY:
+			return "rendering";
+		case UNDO_MEMORY:
+			return "undo";
+		case PREVIEW_MEMORY:
+			return "previews";
+		case TOOL_MEMORY:
+			return "tools";
+		case CACHE_MEMORY:
+			return "caches";
+		default:
+			return "";
+	}
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#include <Locker.h>
+#include <SupportDefs.h>
+
+
+class BBitmap;
+
+
+enum memory_category {
+	LAYER_MEMORY = 0,
+	RENDER_MEMORY,
+	UNDO_MEMORY,
+	PREVIEW_MEMORY,
+	TOOL_MEMORY,
+	CACHE_MEMORY,
+	MEMORY_CATEGORY_COUNT
+};
+
+
+// The reclaimers with a lower priority give their memory back first.
+const int32 kCacheReclaimPriority = 0;
+const int32 kUndoReclaimPriority = 10;
+
+
+struct memory_usage {
+	int64	live[MEMORY_CATEGORY_COUNT];
+	int64	peak[MEMORY_CATEGORY_COUNT];
+	int64	live_total;
+	int64	peak_total;
+};
+
+
+class MemoryReclaimer {
+public:
+	virtual				~MemoryReclaimer() {}
+
+	// Should free about the given amount of memory, if it can, and return
+	// how many bytes were actually freed.
+	virtual	int64		ReclaimMemory(int64 bytes) = 0;
+};
+
+
+/*
+	MemoryBudget keeps count of the memory that the pixel buffers take. Each
+	buffer is registered with the document it belongs to (the ImageView of
+	the document, or NULL for the buffers that are shared) and with the part
+	of the program that allocated it, so that the live and the peak usage can
+	be reported per document.
+
+	A budget can be set in the settings window. When the buffers take more
+	than that, Enforce() asks the caches and then the undo queue of the
+	document to give memory back, instead of waiting for an allocation to
+	fail. Enforce() is only called at points where it is safe for the undo
+	queue to drop events, and it must be called from the thread of the
+	document, because that is the thread that uses the undo queue.
+*/
+class MemoryBudget {
+public:
+	// Registering a bitmap that is already registered just moves it to the
+	// new document and category, because the layers and the undo queue hand
+	// their bitmaps to each other. NULL and invalid bitmaps are ignored.
+	// Memory that is not in a BBitmap is registered by its address.
+	static	void			Track(const BBitmap* bitmap, const void* document,
+								memory_category category);
+	static	void			Track(const void* block, int64 bytes,
+								const void* document, memory_category category);
+	static	void			Untrack(const void* block);
+	static	void			DeleteBitmap(BBitmap* bitmap);
+
+	// Forgets the usage of a document when it is closed.
+	static	void			RemoveDocument(const void* document);
+
+	static	bool			GetUsage(const void* document, memory_usage* usage);
+	static	void			GetTotalUsage(memory_usage* usage);
+
+	// The budget is in megabytes, 0 means that there is no budget.
+	static	void			SetBudget(int32 megabytes);
+	static	int32			Budget() { return fBudget; }
+
+	// A reclaimer that is added without a document is asked to give memory
+	// back whichever document is over the budget.
+	static	void			AddReclaimer(MemoryReclaimer* reclaimer,
+								int32 priority, const void* document = NULL);
+	static	void			RemoveReclaimer(MemoryReclaimer* reclaimer);
+
+	// Returns the number of bytes that were freed.
+	static	int64			Enforce(const void* document);
+
+	static	const char*		CategoryName(memory_category category);
+
+private:
+	static	int32			fBudget;
+	static	BLocker			fLocker;
+};
+
+
+#endif	// MEMORY_BUDGET_H
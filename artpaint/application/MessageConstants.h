@@ -96,6 +96,7 @@
 #define HS_SELECT_ALL				'SlAl'
 #define HS_GROW_SELECTION			'GrSl'
 #define HS_SHRINK_SELECTION			'SrSL'
+#define HS_FEATHER_SELECTION		'FeSl'
 #define HS_HIDE_SELECTION_BORDERS	'HbSL'
 #define HS_SELECT_LAYER_PIXELS		'SlPx'
 
@@ -115,6 +116,9 @@
 // This constant is used in the Help-menu
 #define	HS_SHOW_USER_DOCUMENTATION	'Sudc'
 
+// Writes the trace when ArtPaint was started with --trace.
+#define	HS_EXPORT_TRACE				'Extr'
+
 // This is the message constant that is sent from the status-view's
 // OK- and Cancel-buttons.
 
@@ -130,5 +134,8 @@
 
 #define HS_BRUSH_CHANGED			'BrCh'
 
+// The SettingsServer sends this when the settings used for rendering change.
+#define	HS_RENDER_SETTINGS_CHANGED	'RsCh'
+
 
 #endif // MESSAGE_CONSTANTS_H
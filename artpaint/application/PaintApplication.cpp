@@ -12,6 +12,7 @@
 
 #include "PaintApplication.h"
 
+#include "BatchProcessor.h"
 #include "BitmapUtilities.h"
 #include "BrushStoreWindow.h"
 #include "ColorPalette.h"
@@ -21,17 +22,23 @@
 #include "Image.h"
 #include "ImageView.h"
 #include "LayerWindow.h"
+#include "LinearBitmap.h"
 #include "ManipulatorServer.h"
+#include "MemoryBudget.h"
 #include "MessageConstants.h"
 #include "PaintWindow.h"
 #include "ProjectFileFunctions.h"
 #include "RefFilters.h"
 #include "ResourceServer.h"
 #include "SettingsServer.h"
+#include "StartupProfile.h"
+#include "StrokeReplay.h"
 #include "ToolManager.h"
 #include "ToolSelectionWindow.h"
 #include "ToolSetupWindow.h"
+#include "TraceRecorder.h"
 #include "UndoQueue.h"
+#include "WorkerPool.h"
 
 
 #include <AboutWindow.h>
@@ -71,12 +78,14 @@ PaintApplication::PaintApplication()
 	SettingsServer::Instantiate();
 	ResourceServer::Instantiate();
 	ManipulatorServer::Instantiate();
+	StartupProfile::Phase("servers");
 
 	// Some of the things in this function depend on the previously initialized
 	// things, so the order may be important. This should be fixed in future.
 	BMessage settings;
 	if (SettingsServer* server = SettingsServer::Instance())
 		server->GetApplicationSettings(&settings);
+	StartupProfile::Phase("settings");
 
 	// create the settings
 	_ReadPreferences();
@@ -84,10 +93,15 @@ PaintApplication::PaintApplication()
 	int32 tool = FREE_LINE_TOOL;
 	settings.FindInt32(skTool, &tool);
 	ToolManager::Instance().ChangeTool(tool);
+	StartupProfile::Phase("current tool");
 
 	int32 depth = 20;
 	settings.FindInt32(skUndoQueueDepth, &depth);
 	UndoQueue::SetQueueDepth(depth);
+
+	int32 budget = 0;
+	settings.FindInt32(skMemoryBudget, &budget);
+	MemoryBudget::SetBudget(budget);
 }
 
 
@@ -107,6 +121,7 @@ PaintApplication::~PaintApplication()
 	ResourceServer::DestroyServer();
 	SettingsServer::DestroyServer();
 	ManipulatorServer::DestroyServer();
+	WorkerPool::DestroyPool();
 }
 
 
@@ -199,6 +214,9 @@ PaintApplication::MessageReceived(BMessage* message)
 			set_filepanel_strings(fProjectOpenPanel);
 			fProjectOpenPanel->Show();
 		} break;
+		case HS_EXPORT_TRACE:
+			TraceRecorder::Export();
+			break;
 		case HS_SHOW_USER_DOCUMENTATION:
 		{
 			// issued from paint-window's menubar->"ArtPaint"->"User documentation"
@@ -313,6 +331,7 @@ PaintApplication::ReadyToRun()
 	settings.FindBool(skToolSetupWindowVisible, &visible);
 	if (visible)
 		ToolSetupWindow::ShowToolSetupWindow(settings.FindInt32(skTool));
+	StartupProfile::Phase("tool windows");
 
 	visible = true;
 	settings.FindBool(skBrushWindowVisible, &visible);
@@ -320,16 +339,19 @@ PaintApplication::ReadyToRun()
 		BrushStoreWindow* brush_window = new BrushStoreWindow();
 		brush_window->Show();
 	}
+	StartupProfile::Phase("brush window");
 
 	visible = true;
 	settings.FindBool(skPaletteWindowVisible, &visible);
 	if (visible)
 		ColorPaletteWindow::showPaletteWindow(); // TODO: was (false)
+	StartupProfile::Phase("palette window");
 
 	visible = true;
 	settings.FindBool(skLayerWindowVisible, &visible);
 	if (visible)
 		LayerWindow::showLayerWindow();
+	StartupProfile::Phase("layer window");
 
 	// Here we will open a PaintWindow if no image was loaded on startup. This
 	// should be the last window opened so that it will be the active window.
@@ -338,6 +360,7 @@ PaintApplication::ReadyToRun()
 		if (window)
 			window->Show();
 	}
+	StartupProfile::Phase("first window");
 }
 
 
@@ -579,6 +602,7 @@ PaintApplication::_ReadPreferences()
 
 			if (status != B_OK)
 				; // We might create some default brushes.
+			StartupProfile::Phase("brushes");
 
 			// Create a tool-manager object. Depends on the language being set.
 			ToolManager::CreateToolManager();
@@ -594,6 +618,7 @@ PaintApplication::_ReadPreferences()
 						createDefaultTools = false;
 				}
 			}
+			StartupProfile::Phase("tools");
 
 			status = settingsDir.FindEntry("color_preferences", &entry, true);
 			if ((status != B_OK) && spareDirExists)
@@ -606,6 +631,7 @@ PaintApplication::_ReadPreferences()
 						createDefaultColorset = false;
 				}
 			}
+			StartupProfile::Phase("color sets");
 		}
 	}
 
@@ -618,6 +644,7 @@ PaintApplication::_ReadPreferences()
 	// Create a tool-manager object.
 	if (createDefaultTools)
 		ToolManager::CreateToolManager();
+	StartupProfile::Phase("defaults");
 }
 
 
@@ -870,10 +897,56 @@ PaintApplication::_GetParentPath(const entry_ref& entryRef)
 int
 main(int argc, char* argv[])
 {
+	// Prints the time spent in each phase of the startup.
+	if (argc > 1 && strcmp(argv[1], "--trace-startup") == 0)
+		StartupProfile::Enable();
+
+	// Records where the time goes while rendering and using the tools, and
+	// writes it to the given file as a Chrome trace when quitting.
+	if (argc > 2 && strcmp(argv[1], "--trace") == 0)
+		TraceRecorder::Enable(argv[2]);
+
+	// Appends every stroke that is drawn to the given file.
+	if (argc > 2 && strcmp(argv[1], "--record-strokes") == 0)
+		StrokeReplay::SetRecordFile(argv[2]);
+
 	PaintApplication* paintApp = new PaintApplication();
 	if (paintApp) {
+		// Measures the 8-bit and the 16-bit compositing paths instead of
+		// starting the user interface.
+		if (argc > 1 && strcmp(argv[1], "--benchmark-pixels") == 0) {
+			LinearBitmap::RunBenchmark(2048, 2048, 4);
+			delete paintApp;
+			return B_OK;
+		}
+
+		// Compares the compositing operators called through a function
+		// pointer with the inlined ones that the tools use.
+		if (argc > 1 && strcmp(argv[1], "--benchmark-composite") == 0) {
+			BitmapUtilities::RunCompositeBenchmark(2048, 2048, 4);
+			delete paintApp;
+			return B_OK;
+		}
+
+		// Applies a script of manipulators to the given files and quits.
+		if (argc > 1 && strcmp(argv[1], "--batch") == 0) {
+			int status = BatchProcessor::Main(argc - 2, argv + 2);
+			delete paintApp;
+			return status;
+		}
+
+		// Draws recorded strokes without windows and measures the tools.
+		if (argc > 1 && strcmp(argv[1], "--replay-strokes") == 0) {
+			int status = StrokeReplay::Main(argc - 2, argv + 2);
+			delete paintApp;
+			return status;
+		}
+
 		paintApp->Run();
 		delete paintApp;
+
+		if (TraceRecorder::IsEnabled())
+			TraceRecorder::Export();
 	}
 
 	return B_OK;
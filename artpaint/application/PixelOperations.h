@@ -415,21 +415,28 @@ inline uint32 colorblend(uint32 dst, uint32 src, uint32 mode)
 	dest_rgb.word = dst;
 	src_rgb.word = src;
 
-	float dh, ds, dl;
-	float sh, ss, sl;
-	float tr, tg, tb;
-
-	rgb2hsl(dest_rgb.bytes[2], dest_rgb.bytes[1], dest_rgb.bytes[0], dh, ds, dl);
-	rgb2hsl(src_rgb.bytes[2], src_rgb.bytes[1], src_rgb.bytes[0], sh, ss, sl);
-
-	if (mode == BLEND_HUE)
-		hsl2rgb(sh, ds, dl, tr, tg, tb);
-	else if (mode == BLEND_SATURATION)
-		hsl2rgb(dh, ss, dl, tr, tg, tb);
-	else if (mode == BLEND_LIGHTNESS)
-		hsl2rgb(dh, ds, sl, tr, tg, tb);
-	else if (mode == BLEND_COLOR)
-		hsl2rgb(sh, ss, dl, tr, tg, tb);
+	float ds, dl;
+	float ss, sl;
+	float tr = 0, tg = 0, tb = 0;
+
+	// The hue is taken directly from the channels of the color that gives
+	// it, so it is never converted to an angle and back.
+	rgb2sl(dest_rgb.bytes[2], dest_rgb.bytes[1], dest_rgb.bytes[0], ds, dl);
+	rgb2sl(src_rgb.bytes[2], src_rgb.bytes[1], src_rgb.bytes[0], ss, sl);
+
+	if (mode == BLEND_HUE) {
+		hue_sl2rgb(src_rgb.bytes[2], src_rgb.bytes[1], src_rgb.bytes[0], ds, dl,
+			tr, tg, tb);
+	} else if (mode == BLEND_SATURATION) {
+		hue_sl2rgb(dest_rgb.bytes[2], dest_rgb.bytes[1], dest_rgb.bytes[0], ss, dl,
+			tr, tg, tb);
+	} else if (mode == BLEND_LIGHTNESS) {
+		hue_sl2rgb(dest_rgb.bytes[2], dest_rgb.bytes[1], dest_rgb.bytes[0], ds, sl,
+			tr, tg, tb);
+	} else if (mode == BLEND_COLOR) {
+		hue_sl2rgb(src_rgb.bytes[2], src_rgb.bytes[1], src_rgb.bytes[0], ss, dl,
+			tr, tg, tb);
+	}
 
 	target_rgb.bytes[0] = (uint8)max_c(0, min_c(255, tb));
 	target_rgb.bytes[1] = (uint8)max_c(0, min_c(255, tg));
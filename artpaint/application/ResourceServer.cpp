@@ -30,11 +30,18 @@ ResourceServer* ResourceServer::fResourceServer = NULL;
 ResourceServer::ResourceServer()
 	: fResource(NULL)
 {
+	MemoryBudget::AddReclaimer(this, kCacheReclaimPriority);
 }
 
 
 ResourceServer::~ResourceServer()
 {
+	MemoryBudget::RemoveReclaimer(this);
+
+	BitmapCache::iterator it;
+	for (it = fBitmapCache.begin(); it != fBitmapCache.end(); ++it)
+		MemoryBudget::DeleteBitmap(it->second);
+
 	delete fResource;
 	fResourceServer = NULL;
 }
@@ -67,6 +74,20 @@ ResourceServer::GetBitmap(type_code type, int32 id, float width, float height, B
 	if (!_Init())
 		return B_ERROR;
 
+	BAutolock _(&fCacheLocker);
+
+	bitmap_key key;
+	key.type = type;
+	key.id = id;
+	key.width = (int32)width;
+	key.height = (int32)height;
+
+	BitmapCache::const_iterator it = fBitmapCache.find(key);
+	if (it != fBitmapCache.end()) {
+		*bitmap = new (std::nothrow) BBitmap(it->second);
+		return (*bitmap != NULL) ? B_OK : B_NO_MEMORY;
+	}
+
 	size_t length;
 	const void* data = fResource->LoadResource(type, id, &length);
 	if (data) {
@@ -86,14 +107,38 @@ ResourceServer::GetBitmap(type_code type, int32 id, float width, float height, B
 			BMemoryIO memio(data, length);
 			*bitmap = BTranslationUtils::GetBitmap(&memio);
 		}
-		if (*bitmap)
+		if (*bitmap) {
+			BBitmap* copy = new (std::nothrow) BBitmap(*bitmap);
+			if (copy != NULL && copy->IsValid()) {
+				fBitmapCache[key] = copy;
+				MemoryBudget::Track(copy, NULL, CACHE_MEMORY);
+			} else
+				delete copy;
 			return B_OK;
+		}
 	}
 
 	return B_ERROR;
 }
 
 
+int64
+ResourceServer::ReclaimMemory(int64 bytes)
+{
+	BAutolock _(&fCacheLocker);
+
+	int64 freed = 0;
+	while (freed < bytes && !fBitmapCache.empty()) {
+		BitmapCache::iterator it = fBitmapCache.begin();
+		freed += it->second->BitsLength();
+		MemoryBudget::DeleteBitmap(it->second);
+		fBitmapCache.erase(it);
+	}
+
+	return freed;
+}
+
+
 status_t
 ResourceServer::GetPicture(int32 id, BPicture* picture)
 {
@@ -153,6 +198,19 @@ ResourceServer::GetPicture(type_code type, int32 id, float width, float height,
 }
 
 
+bool
+ResourceServer::bitmap_key::operator<(const bitmap_key& key) const
+{
+	if (type != key.type)
+		return type < key.type;
+	if (id != key.id)
+		return id < key.id;
+	if (width != key.width)
+		return width < key.width;
+	return height < key.height;
+}
+
+
 ResourceServer*
 ResourceServer::Instantiate()
 {
@@ -13,6 +13,10 @@
 #include <Locker.h>
 #include <Resources.h>
 
+#include <map>
+
+#include "MemoryBudget.h"
+
 
 class BBitmap;
 class BPicture;
@@ -32,7 +36,7 @@ enum {
 };
 
 
-class ResourceServer {
+class ResourceServer : public MemoryReclaimer {
 	friend class PaintApplication;
 
 public:
@@ -47,6 +51,9 @@ public:
 			status_t			GetPicture(type_code type, int32 id, float width,
 									float height, BPicture** picture);
 
+	// Empties the bitmap cache, the bitmaps are decoded again when needed.
+	virtual	int64				ReclaimMemory(int64 bytes);
+
 private:
 								ResourceServer();
 								ResourceServer(const ResourceServer& server);
@@ -60,9 +67,28 @@ private:
 	static	ResourceServer*		Instantiate();
 	static	void				DestroyServer();
 
+private:
+	// The color space of a bitmap follows from the type of its resource, so
+	// the type, id and size identify a rasterized icon.
+	struct bitmap_key {
+			type_code			type;
+			int32				id;
+			int32				width;
+			int32				height;
+
+			bool				operator<(const bitmap_key& key) const;
+	};
+
+	typedef std::map<bitmap_key, BBitmap*> BitmapCache;
+
 private:
 			BResources*			fResource;
 
+			// The tool buttons, cursors and pop-up lists ask for the same
+			// bitmaps many times. They get copies of the decoded ones.
+			BitmapCache			fBitmapCache;
+			BLocker				fCacheLocker;
+
 	static	BLocker				fLocker;
 	static	ResourceServer*		fResourceServer;
 };
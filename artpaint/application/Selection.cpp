@@ -15,7 +15,10 @@
 #include "BitmapUtilities.h"
 #include "HSPolygon.h"
 #include "ImageView.h"
+#include "MaskFilters.h"
 #include "Patterns.h"
+#include "PixelBuffer.h"
+#include "PolygonRasterizer.h"
 #include "UtilityClasses.h"
 
 
@@ -23,6 +26,7 @@
 #include <Window.h>
 
 
+#include <math.h>
 #include <new>
 #include <stdio.h>
 #include <string.h>
@@ -33,13 +37,13 @@ Selection::Selection(BRect imageBounds)
 	selection_data(NULL),
 	original_selections(NULL),
 	selection_map(NULL),
-	selection_view(NULL),
 	selection_bits(NULL),
 	selection_bpr(0),
 	selection_bounds(imageBounds),
 	image_bounds(imageBounds),
 	image_view(NULL),
 	needs_recalculating(false),
+	untransformed_map(NULL),
 	view_magnifying_scale(0),
 	animation_offset(0),
 	drawer_thread(-1),
@@ -48,6 +52,8 @@ Selection::Selection(BRect imageBounds)
 {
 	selection_data = new SelectionData();
 	selection_mutex = create_sem(1, "selection_mutex");
+
+	discardTransform();
 }
 
 
@@ -61,6 +67,7 @@ Selection::~Selection()
 	}
 
 	delete selection_data;
+	delete untransformed_map;
 
 	if (continue_drawing) {
 		continue_drawing = false;
@@ -84,19 +91,8 @@ Selection::SetSelectionData(const SelectionData* data)
 
 	if (selection_data->SelectionCount() == 0)
 		Clear();
-	else if (selection_map == NULL) {
-		selection_map = new BBitmap(image_bounds, B_GRAY8, true);
-		selection_view = new BView(image_bounds, "", B_FOLLOW_NONE, B_WILL_DRAW);
-		selection_map->AddChild(selection_view);
-		selection_bits = (uint8*)selection_map->Bits();
-		selection_bpr = selection_map->BytesPerRow();
-
-		if (selection_map->Lock()) {
-			selection_view->FillRect(image_bounds, B_SOLID_HIGH);
-			selection_view->StrokeRect(image_bounds, B_SOLID_HIGH);
-			selection_map->Unlock();
-		}
-	}
+	else if (selection_map == NULL)
+		createSelectionMap();
 
 	needs_recalculating = true;
 	Recalculate();
@@ -171,58 +167,14 @@ Selection::AddSelection(HSPolygon* poly, bool add_to_selection)
 
 	selection_data->AddSelection(poly);
 
-	if (selection_map == NULL) {
-		selection_map = new BBitmap(image_bounds, B_GRAY8, true);
-		selection_view = new BView(image_bounds, "", B_FOLLOW_NONE, B_WILL_DRAW);
-		selection_map->AddChild(selection_view);
-		selection_bits = (uint8*)selection_map->Bits();
-		selection_bpr = selection_map->BytesPerRow();
-
-		if (selection_map->Lock()) {
-			rgb_color low = selection_view->LowColor();
-			rgb_color high = selection_view->HighColor();
-
-			selection_view->SetLowColor(255, 255, 255, 255);
-			selection_view->SetHighColor(0, 0, 0, 255);
-
-			selection_view->FillRect(image_bounds, B_SOLID_HIGH);
-			selection_view->StrokeRect(image_bounds, B_SOLID_HIGH);
-
-			selection_view->SetLowColor(low);
-			selection_view->SetHighColor(high);
-			selection_map->Unlock();
-		}
-	}
-
-	if (selection_map->Lock()) {
-		rgb_color low = selection_view->LowColor();
-		rgb_color high = selection_view->HighColor();
-
-		selection_view->SetLowColor(255, 255, 255, 255);
-		selection_view->SetHighColor(0, 0, 0, 255);
+	if (selection_map == NULL)
+		createSelectionMap();
 
-		selection_view->DrawBitmap(selection_map);
-		BPolygon* p = poly->GetBPolygon();
-		if (!add_to_selection) {
-			if (bound_poly) {
-				BPolygon* polygon = bound_poly->GetBPolygon();
-				selection_view->FillPolygon(polygon, B_SOLID_LOW);
-				selection_view->StrokePolygon(polygon, true, B_SOLID_LOW);
-				delete polygon;
-			}
-			selection_view->FillPolygon(p, B_SOLID_HIGH);
-			selection_view->StrokePolygon(p, true, B_SOLID_HIGH);
-		} else {
-			selection_view->FillPolygon(p, B_SOLID_LOW);
-			selection_view->StrokePolygon(p, true, B_SOLID_LOW);
-		}
-
-		selection_view->Sync();
-		selection_view->SetLowColor(low);
-		selection_view->SetHighColor(high);
-		selection_map->Unlock();
-		delete p;
-	}
+	// Only the rows of the new polygon are changed. The polygon also covers
+	// the pixels that its outline goes through.
+	if (bound_poly != NULL)
+		memset(selection_bits, 0xff, selection_map->BitsLength());
+	rasterizePolygon(poly, add_to_selection, 0.5);
 
 	SimplifySelection();
 
@@ -248,31 +200,9 @@ Selection::AddSelection(BBitmap* bitmap, bool add_to_selection)
 	selection_bounds = BRect();
 
 	if (selection_map == NULL) {
-		selection_map = new BBitmap(image_bounds, B_GRAY8, true);
-		selection_view = new BView(image_bounds, "", B_FOLLOW_NONE, B_WILL_DRAW);
-		selection_map->AddChild(selection_view);
-		selection_bits = (uint8*)selection_map->Bits();
-		selection_bpr = selection_map->BytesPerRow();
-
-		if (selection_map->Lock()) {
-			rgb_color low = selection_view->LowColor();
-			rgb_color high = selection_view->HighColor();
-
-			selection_view->SetLowColor(255, 255, 255, 255);
-			selection_view->SetHighColor(0, 0, 0, 255);
-
-			selection_view->FillRect(image_bounds, B_SOLID_HIGH);
-			selection_view->StrokeRect(image_bounds, B_SOLID_HIGH);
-
-			if (!add_to_selection) {
-				selection_view->FillRect(selection_map->Bounds(), B_SOLID_LOW);
-				selection_view->StrokeRect(selection_map->Bounds(), B_SOLID_LOW);
-			}
-			selection_view->Sync();
-			selection_view->SetHighColor(high);
-			selection_view->SetLowColor(low);
-			selection_map->Unlock();
-		}
+		createSelectionMap();
+		if (!add_to_selection)
+			memset(selection_bits, 0xff, selection_map->BitsLength());
 	}
 
 	uint32 new_bpr = bitmap->BytesPerRow();
@@ -314,12 +244,7 @@ Selection::ReplaceSelection(BBitmap* bitmap)
 	selection_bounds = BRect();
 
 	delete selection_map;
-	selection_map = new BBitmap(image_bounds, B_GRAY8, true);
-	selection_view = new BView(image_bounds, "", B_FOLLOW_NONE,
-		B_WILL_DRAW);
-	selection_map->AddChild(selection_view);
-	selection_bits = (uint8*)selection_map->Bits();
-	selection_bpr = selection_map->BytesPerRow();
+	createSelectionMap();
 
 	uint32 new_bpr = bitmap->BytesPerRow();
 	uint8* new_bits = (uint8*)bitmap->Bits();
@@ -368,6 +293,8 @@ Selection::Clear()
 		original_selections = NULL;
 	}
 
+	discardTransform();
+
 	if (!IsEmpty()) {
 		delete selection_map;
 		selection_map = NULL;
@@ -382,67 +309,18 @@ Selection::Clear()
 
 
 void
-Selection::Dilate()
+Selection::Dilate(int32 radius)
 {
 	acquire_sem(selection_mutex);
 
-	/*
-		This uses two bitmaps to dilate the selection. Dilation is done with
-		the following pattern:
-
-		0	0	0
-		0	X	0
-		0	0	0
-
-		The pattern is moved over the original selection and whenever the x is
-		inside the selection, all 0s and X will be marked selected in the new
-		selection. Otherwise x will be marked not selected. First and last
-		row/column must be handled as a special case
-	*/
-	selection_bounds = BRect();
-
-	if (selection_map != NULL) {
-		BBitmap* new_map = new BBitmap(selection_map->Bounds(), B_GRAY8);
-		int32 new_bpr = new_map->BytesPerRow();
-		int8* new_bits = (int8*)new_map->Bits();
-
-		memcpy(new_bits, selection_map->Bits(), selection_map->BitsLength());
-
-		int32 width = selection_map->Bounds().IntegerWidth();
-		int32 height = selection_map->Bounds().IntegerHeight();
-		for (int32 y = 0; y <= height; ++y) {
-			for (int32 x = 0; x <= width; ++x) {
-				if (ContainsPoint(x, y)) {
-					if (x > 0) {
-						*(new_bits + y * new_bpr + (x - 1)) = 0xff;
-						if (y > 0) {
-							*(new_bits + (y - 1) * new_bpr + (x - 1)) = 0xff;
-							*(new_bits + (y - 1) * new_bpr + x) = 0xff;
-						}
-						if (y < height) {
-							*(new_bits + (y + 1) * new_bpr + (x - 1)) = 0xff;
-							*(new_bits + (y + 1) * new_bpr + x) = 0xff;
-						}
-					}
-					if (x < width) {
-						*(new_bits + y * new_bpr + (x + 1)) = 0xff;
-						if (y > 0) {
-							*(new_bits + (y - 1) * new_bpr + (x + 1)) = 0xff;
-							*(new_bits + (y - 1) * new_bpr + x) = 0xff;
-						}
-						if (y < height) {
-							*(new_bits + (y + 1) * new_bpr + (x + 1)) = 0xff;
-							*(new_bits + (y + 1) * new_bpr + x) = 0xff;
-						}
-					}
-				}
-			}
+	// The selection can only grow by the radius, so only the pixels around
+	// its bounds are filtered.
+	if (selection_map != NULL && radius > 0) {
+		BRect area = GetBoundingRect().InsetByCopy(-radius, -radius);
+		if (MaskFilters::Dilate(PixelView(selection_map), area, radius) == B_OK) {
+			selection_bounds = BRect();
+			SimplifySelection();
 		}
-
-		memcpy(selection_map->Bits(), new_bits, selection_map->BitsLength());
-		delete new_map;
-
-		SimplifySelection();
 	}
 
 	release_sem(selection_mutex);
@@ -450,68 +328,35 @@ Selection::Dilate()
 
 
 void
-Selection::Erode()
+Selection::Erode(int32 radius)
 {
 	acquire_sem(selection_mutex);
 
-	/*
-		This uses two bitmaps to erode the selection. Erosion is done with
-		the following pattern:
-
-		1	1	1
-		1	X	1
-		1	1	1
-
-		All 1s must be contained in the selection for every X, otherwise X is
-		not included in the new selection. The image edges are always eroded
-		because they cannot satisfy this condition.
-	*/
-	selection_bounds = GetBoundingRect();
+	// The pixels at the edges of the image are eroded as if there were
+	// unselected pixels outside of it.
+	if (selection_map != NULL && radius > 0) {
+		BRect area = GetBoundingRect();
+		if (MaskFilters::Erode(PixelView(selection_map), area, radius) == B_OK) {
+			selection_bounds = BRect();
+			SimplifySelection();
+		}
+	}
 
-	if (selection_map != NULL) {
-		BBitmap* new_map = new BBitmap(selection_map->Bounds(), B_GRAY8);
-		int32 new_bpr = new_map->BytesPerRow();
-		int8* new_bits = (int8*)new_map->Bits();
+	release_sem(selection_mutex);
+}
 
-		memcpy(new_bits, selection_map->Bits(), selection_map->BitsLength());
 
-		int32 width = selection_map->Bounds().IntegerWidth();
-		int32 height = selection_map->Bounds().IntegerHeight();
-		int32 left = selection_bounds.left;
-		int32 right = selection_bounds.right;
-		int32 top = selection_bounds.top;
-		int32 bottom = selection_bounds.bottom;
+void
+Selection::Feather(int32 radius)
+{
+	acquire_sem(selection_mutex);
 
-		for (int32 y = top; y <= bottom; ++y) {
-			for (int32 x = left; x <= right; ++x) {
-				if (ContainsPoint(x, y)) {
-					// edge pixels get eroded
-					if (x == 0 || y == 0 ||
-						x == width || y == height)
-						*(new_bits + y * new_bpr + x) = 0x00;
-					else {
-						bool all = true;
-						for (int32 yy = y - 1; yy <= y + 1; ++yy) {
-							for (int32 xx = x - 1; xx <= x + 1; ++xx) {
-								if (ContainsPoint(xx, yy) == false) {
-									all = false;
-									xx = x + 1;
-									yy = y + 1;
-								}
-							}
-						}
-
-						if (all == false)
-							*(new_bits + y * new_bpr + x) = 0x00;
-					}
-				}
-			}
+	if (selection_map != NULL && radius > 0) {
+		BRect area = GetBoundingRect().InsetByCopy(-radius, -radius);
+		if (MaskFilters::Feather(PixelView(selection_map), area, radius) == B_OK) {
+			selection_bounds = BRect();
+			SimplifySelection();
 		}
-
-		memcpy(selection_map->Bits(), new_bits, selection_map->BitsLength());
-		delete new_map;
-
-		SimplifySelection();
 	}
 
 	release_sem(selection_mutex);
@@ -563,10 +408,12 @@ void
 Selection::RotateTo(BPoint pivot, float angle)
 {
 	acquire_sem(selection_mutex); // This might actually not be useful.
+	beginTransform();
 	if (original_selections == NULL) {
 		original_selections = new HSPolygon*[selection_data->SelectionCount()];
 		for (int32 i = 0; i < selection_data->SelectionCount(); i++)
 			original_selections[i] = new HSPolygon(selection_data->ReturnSelectionAt(i));
+		memcpy(rotation_base, map_transform, sizeof(rotation_base));
 	}
 
 	int32 item_count = selection_data->SelectionCount();
@@ -578,6 +425,16 @@ Selection::RotateTo(BPoint pivot, float angle)
 		selection_data->AddSelection(p);
 	}
 
+	// The rotation is from the original_selections, like the polygons.
+	float rad_angle = angle / 180.0 * M_PI;
+	float cosine = cos(rad_angle);
+	float sine = sin(rad_angle);
+	const float rotation[6] = {
+		cosine, -sine, pivot.x - cosine * pivot.x + sine * pivot.y,
+		sine, cosine, pivot.y - sine * pivot.x - cosine * pivot.y };
+	memcpy(map_transform, rotation_base, sizeof(map_transform));
+	applyTransform(rotation);
+
 	needs_recalculating = TRUE;
 	release_sem(selection_mutex);
 }
@@ -600,6 +457,10 @@ Selection::Translate(int32 dx, int32 dy)
 		p->TranslateBy(dx, dy);
 	}
 
+	beginTransform();
+	const float translation[6] = { 1, 0, (float)dx, 0, 1, (float)dy };
+	applyTransform(translation);
+
 	needs_recalculating = TRUE;
 	release_sem(selection_mutex);
 }
@@ -622,6 +483,11 @@ Selection::ScaleBy(BPoint origin, float dx, float dy)
 		p->ScaleBy(origin, dx, dy);
 	}
 
+	beginTransform();
+	const float scale[6] = { dx, 0, origin.x - origin.x * dx,
+		0, dy, origin.y - origin.y * dy };
+	applyTransform(scale);
+
 	needs_recalculating = TRUE;
 	release_sem(selection_mutex);
 }
@@ -652,6 +518,11 @@ Selection::ScaleTo(BPoint origin, float x_scale, float y_scale)
 		p->ScaleBy(origin, dx, dy);
 	}
 
+	beginTransform();
+	const float scale[6] = { dx, 0, origin.x - origin.x * dx,
+		0, dy, origin.y - origin.y * dy };
+	applyTransform(scale);
+
 	selection_bounds.right = selection_bounds.left + x_scale;
 	selection_bounds.bottom = selection_bounds.top + y_scale;
 	needs_recalculating = TRUE;
@@ -678,6 +549,10 @@ Selection::FlipHorizontally()
 		p->FlipX(x_axis);
 	}
 
+	beginTransform();
+	const float flip[6] = { -1, 0, 2 * x_axis, 0, 1, 0 };
+	applyTransform(flip);
+
 	needs_recalculating = TRUE;
 	release_sem(selection_mutex);
 }
@@ -702,6 +577,10 @@ Selection::FlipVertically()
 		p->FlipY(y_axis);
 	}
 
+	beginTransform();
+	const float flip[6] = { 1, 0, 0, 0, -1, 2 * y_axis };
+	applyTransform(flip);
+
 	needs_recalculating = TRUE;
 	release_sem(selection_mutex);
 }
@@ -718,39 +597,27 @@ Selection::Recalculate()
 			original_selections = NULL;
 		}
 
-		if (selection_map && selection_map->Lock()) {
+		if (selection_map != NULL && untransformed_map != NULL) {
+			// The map itself is transformed, so that its soft edges are
+			// not lost to the outlines.
+			resampleSelectionMap();
+		} else if (selection_map != NULL) {
 			// First clear the selection
-			rgb_color low = selection_view->LowColor();
-			rgb_color high = selection_view->HighColor();
-
-			selection_view->SetLowColor(255, 255, 255, 255);
-			selection_view->SetHighColor(0, 0, 0, 255);
-
-			selection_view->FillRect(selection_map->Bounds(), B_SOLID_HIGH);
-			selection_view->StrokeRect(selection_map->Bounds(), B_SOLID_HIGH);
-			selection_view->Sync();
+			memset(selection_bits, 0, selection_map->BitsLength());
 
+			// The polygons follow the outlines of the selected pixels, so
+			// they are not grown.
 			for (int32 i = 0; i < selection_data->SelectionCount(); ++i) {
 				if (HSPolygon* p = selection_data->ReturnSelectionAt(i)) {
-					BPolygon* bPoly = p->GetBPolygon();
-					if (p->GetDirection() == HS_POLYGON_CLOCKWISE) {
-						// selection
-						selection_view->FillPolygon(bPoly, B_SOLID_LOW);
-						selection_view->StrokePolygon(bPoly, true, B_SOLID_LOW);
-					} else if (p->GetDirection() == HS_POLYGON_COUNTERCLOCKWISE) {
-						// a de-selection
-						selection_view->FillPolygon(bPoly, B_SOLID_HIGH);
-						selection_view->StrokePolygon(bPoly, true, B_SOLID_HIGH);
-					}
-					delete bPoly;
+					if (p->GetDirection() == HS_POLYGON_CLOCKWISE)
+						rasterizePolygon(p, true, 0);
+					else if (p->GetDirection() == HS_POLYGON_COUNTERCLOCKWISE)
+						rasterizePolygon(p, false, 0);
 				}
 			}
-			selection_view->SetHighColor(high);
-			selection_view->SetLowColor(low);
-			selection_view->Sync();
-			selection_map->Unlock();
 		}
 
+		discardTransform();
 		needs_recalculating = false;
 		selection_bounds = BRect(0, 0, -1, -1);
 	}
@@ -765,16 +632,7 @@ Selection::ImageSizeChanged(BRect rect)
 		image_bounds = rect;
 		if (selection_map != NULL) {
 			BBitmap* previous_map = selection_map;
-			selection_map = new BBitmap(image_bounds, B_GRAY8, true);
-			selection_view = new BView(image_bounds, "selection view", B_FOLLOW_NONE, B_WILL_DRAW);
-			selection_map->AddChild(selection_view);
-			selection_bits = (uint8*)selection_map->Bits();
-			selection_bpr = selection_map->BytesPerRow();
-
-			if (selection_map->Lock()) {
-				selection_view->FillRect(image_bounds, B_SOLID_HIGH);
-				selection_map->Unlock();
-			}
+			createSelectionMap();
 
 			int32 height = min_c(
 				previous_map->Bounds().IntegerHeight(), selection_map->Bounds().IntegerHeight());
@@ -878,6 +736,149 @@ Selection::deSelect()
 }
 
 
+void
+Selection::createSelectionMap()
+{
+	selection_map = new BBitmap(image_bounds, B_GRAY8);
+	selection_bits = (uint8*)selection_map->Bits();
+	selection_bpr = selection_map->BytesPerRow();
+	memset(selection_bits, 0, selection_map->BitsLength());
+}
+
+
+void
+Selection::rasterizePolygon(HSPolygon* poly, bool add_to_selection, float outset)
+{
+	PolygonRasterizer rasterizer;
+	rasterizer.AddPolygon(poly->GetPointList(), poly->GetPointCount(), outset);
+	rasterizer.Render(selection_bits, selection_bpr, image_bounds,
+		add_to_selection ? RASTER_ADD : RASTER_SUBTRACT);
+}
+
+
+void
+Selection::beginTransform()
+{
+	// The map is copied when the first transform of a series is made.
+	if (untransformed_map != NULL || selection_map == NULL)
+		return;
+
+	untransformed_map = new (std::nothrow) BBitmap(selection_map);
+	if (untransformed_map != NULL && !untransformed_map->IsValid()) {
+		delete untransformed_map;
+		untransformed_map = NULL;
+	}
+	untransformed_bounds = GetBoundingRect();
+}
+
+
+void
+Selection::applyTransform(const float transform[6])
+{
+	const float* m = map_transform;
+	const float* t = transform;
+	float result[6] = {
+		t[0] * m[0] + t[1] * m[3], t[0] * m[1] + t[1] * m[4],
+		t[0] * m[2] + t[1] * m[5] + t[2],
+		t[3] * m[0] + t[4] * m[3], t[3] * m[1] + t[4] * m[4],
+		t[3] * m[2] + t[4] * m[5] + t[5] };
+	memcpy(map_transform, result, sizeof(map_transform));
+}
+
+
+void
+Selection::discardTransform()
+{
+	delete untransformed_map;
+	untransformed_map = NULL;
+
+	const float identity[6] = { 1, 0, 0, 0, 1, 0 };
+	memcpy(map_transform, identity, sizeof(map_transform));
+	memcpy(rotation_base, identity, sizeof(rotation_base));
+}
+
+
+void
+Selection::resampleSelectionMap()
+{
+	const float* m = map_transform;
+	const uint8* source_bits = (const uint8*)untransformed_map->Bits();
+	int32 source_bpr = untransformed_map->BytesPerRow();
+	int32 width = image_bounds.IntegerWidth() + 1;
+	int32 height = image_bounds.IntegerHeight() + 1;
+
+	memset(selection_bits, 0, selection_map->BitsLength());
+
+	float determinant = m[0] * m[4] - m[1] * m[3];
+	if (fabs(determinant) < 1e-6 || !untransformed_bounds.IsValid())
+		return;
+
+	// Whole pixel translations are copied as they are.
+	if (m[0] == 1 && m[1] == 0 && m[3] == 0 && m[4] == 1
+		&& m[2] == floor(m[2]) && m[5] == floor(m[5])) {
+		int32 dx = (int32)m[2];
+		int32 dy = (int32)m[5];
+		for (int32 y = max_c(dy, 0); y < min_c(height + dy, height); y++) {
+			int32 left = max_c(dx, 0);
+			int32 right = min_c(width + dx, width);
+			if (right > left) {
+				memcpy(selection_bits + y * selection_bpr + left,
+					source_bits + (y - dy) * source_bpr + left - dx, right - left);
+			}
+		}
+		return;
+	}
+
+	// Only the pixels that the transformed bounds cover can be selected.
+	BPoint corners[4] = { untransformed_bounds.LeftTop(),
+		untransformed_bounds.RightTop(), untransformed_bounds.LeftBottom(),
+		untransformed_bounds.RightBottom() };
+	BRect area(1000000, 1000000, -1000000, -1000000);
+	for (int32 i = 0; i < 4; i++) {
+		float x = m[0] * corners[i].x + m[1] * corners[i].y + m[2];
+		float y = m[3] * corners[i].x + m[4] * corners[i].y + m[5];
+		area.left = min_c(area.left, floor(x) - 1);
+		area.top = min_c(area.top, floor(y) - 1);
+		area.right = max_c(area.right, ceil(x) + 1);
+		area.bottom = max_c(area.bottom, ceil(y) + 1);
+	}
+	area = area & image_bounds;
+
+	// Each pixel is sampled bilinearly from the untransformed map through
+	// the inverse transform.
+	float inverse[6] = {
+		m[4] / determinant, -m[1] / determinant,
+		(m[1] * m[5] - m[4] * m[2]) / determinant,
+		-m[3] / determinant, m[0] / determinant,
+		(m[3] * m[2] - m[0] * m[5]) / determinant };
+
+	for (int32 y = (int32)area.top; y <= (int32)area.bottom; y++) {
+		uint8* target = selection_bits + y * selection_bpr;
+		for (int32 x = (int32)area.left; x <= (int32)area.right; x++) {
+			float source_x = inverse[0] * x + inverse[1] * y + inverse[2];
+			float source_y = inverse[3] * x + inverse[4] * y + inverse[5];
+			int32 x0 = (int32)floor(source_x);
+			int32 y0 = (int32)floor(source_y);
+			if (x0 < -1 || y0 < -1 || x0 >= width || y0 >= height)
+				continue;
+
+			float fx = source_x - x0;
+			float fy = source_y - y0;
+			float values[4];
+			for (int32 i = 0; i < 4; i++) {
+				int32 sx = x0 + (i & 1);
+				int32 sy = y0 + (i >> 1);
+				values[i] = (sx < 0 || sy < 0 || sx >= width || sy >= height)
+					? 0 : source_bits[sy * source_bpr + sx];
+			}
+			float value = (values[0] * (1 - fx) + values[1] * fx) * (1 - fy)
+				+ (values[2] * (1 - fx) + values[3] * fx) * fy;
+			target[x] = (uint8)min_c(value + 0.5, 255);
+		}
+	}
+}
+
+
 int32
 Selection::thread_entry_func(void* data)
 {
@@ -918,12 +919,22 @@ Selection::ChangeMagnifyingScale(float mag_scale)
 void
 Selection::SimplifySelection()
 {
+	// The polygons are traced from the map again, so a transform that has
+	// not been applied to the map is forgotten with the old polygons.
+	discardTransform();
+	needs_recalculating = false;
+
 	selection_data->EmptySelectionData();
 
 	BRect bounds = GetBoundingRect();
 
+	// The outlines go through the middle of the soft edges, so that a
+	// feathered selection is not outlined at its faintest pixels. A
+	// selection that is faint everywhere is outlined where it is non-zero.
 	BList polygons;
-	BitmapUtilities::RasterToPolygonsMoore(selection_map, bounds, &polygons);
+	BitmapUtilities::RasterToPolygonsMoore(selection_map, bounds, &polygons, 0x80);
+	if (polygons.CountItems() == 0 && bounds.IsValid())
+		BitmapUtilities::RasterToPolygonsMoore(selection_map, bounds, &polygons);
 
 	for (int32 i = 0; i < polygons.CountItems(); ++i) {
 		HSPolygon* new_polygon = (HSPolygon*)polygons.ItemAt(i);
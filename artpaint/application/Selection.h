@@ -52,11 +52,11 @@ class Selection {
 			HSPolygon**		original_selections;
 
 
-			// This is a binary-bitmap that has one bit for each pixel in the image.
-			// If a bit is 1 then the corresponding pixel belongs to the selection.
-			// Otherwise it doesn't belong to the selection.
+			// This is a B_GRAY8 bitmap that has one byte for each pixel in the
+			// image. If the byte is not 0 then the corresponding pixel belongs to
+			// the selection. Otherwise it doesn't belong to the selection. The
+			// values between 0 and 255 are used for the soft edges.
 			BBitmap*		selection_map;
-			BView*			selection_view;
 
 			uint8*			selection_bits;
 			uint32			selection_bpr;
@@ -74,6 +74,18 @@ class Selection {
 
 			bool			needs_recalculating;
 
+			// The selection_map as it was before the selection was translated,
+			// scaled, flipped or rotated, and the transform from it to the
+			// current polygons (x' = a x + b y + tx, y' = c x + d y + ty in
+			// the order a, b, tx, c, d, ty). Recalculate() resamples the map
+			// with the transform, so that the soft edges are kept.
+			BBitmap*		untransformed_map;
+			BRect			untransformed_bounds;
+			float			map_transform[6];
+
+			// The transform when RotateTo() stored the original_selections.
+			float			rotation_base[6];
+
 			float			view_magnifying_scale;
 
 			// This is used to animate the lines that bound the selected area.
@@ -92,6 +104,20 @@ class Selection {
 			// This function deselects everything.
 			void			deSelect();
 
+			// This function creates the selection_map. Nothing is selected in
+			// the new map.
+			void			createSelectionMap();
+
+			// This function draws the polygon to the selection_map.
+			void			rasterizePolygon(HSPolygon*, bool add_to_selection,
+								float outset);
+
+			// These keep track of the transforms of the selection_map.
+			void			beginTransform();
+			void			applyTransform(const float transform[6]);
+			void			discardTransform();
+			void			resampleSelectionMap();
+
 	static	int32			thread_entry_func(void*);
 			int32			thread_func();
 
@@ -125,13 +151,17 @@ public:
 			// this function selects the entire canvas
 			void			SelectAll();
 
-			// This dilates the selection map so that the size of the selection will
-			// increase
-			void			Dilate();
+			// This dilates the selection map so that the selection will grow
+			// by radius pixels in every direction
+			void			Dilate(int32 radius = 1);
+
+			// This erodes the selection so that the selection will shrink by
+			// radius pixels in every direction
+			void			Erode(int32 radius = 1);
 
-			// This erodes the selection so that the size of the selection will
-			// decrease
-			void			Erode();
+			// This softens the edges of the selection so that they fade out
+			// over radius pixels
+			void			Feather(int32 radius);
 
 			// This will draw the selection. This function does not care about
 			// clipping region.
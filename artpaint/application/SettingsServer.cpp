@@ -11,8 +11,10 @@
 
 #include "ColorPalette.h"
 #include "Cursors.h"
+#include "MessageConstants.h"
 #include "PaintWindow.h"
 #include "Tools.h"
+#include "UtilityClasses.h"
 
 
 #include <Autolock.h>
@@ -48,16 +50,27 @@ SettingsServer::Instance()
 
 
 SettingsServer::SettingsServer()
+	:
+	fRenderSettings(NULL),
+	fRenderSettingsReaders(0)
 {
 	BMessage dummy;
 	if (GetApplicationSettings(&dummy) != B_OK)
 		_GetDefaultAppSettings(&fApplicationSettings);
+
+	_PublishRenderSettings();
 }
 
 
 SettingsServer::~SettingsServer()
 {
 	Sync();
+
+	delete fRenderSettings;
+	std::list<render_settings*>::iterator it;
+	for (it = fOldRenderSettings.begin(); it != fOldRenderSettings.end(); ++it)
+		delete *it;
+
 	fSettingsServer = NULL;
 }
 
@@ -242,8 +255,11 @@ status_t
 SettingsServer::SetValue(Setting type, const BString& field, int32 value)
 {
 	if (BMessage* settings = _SettingsForType(type)) {
-		if (settings->RemoveName(field.String()) != B_ERROR)
-			return settings->AddInt32(field.String(), value);
+		if (settings->RemoveName(field.String()) != B_ERROR) {
+			status_t status = settings->AddInt32(field.String(), value);
+			_SettingChanged(type, field);
+			return status;
+		}
 	}
 	return B_ERROR;
 }
@@ -253,8 +269,11 @@ status_t
 SettingsServer::SetValue(Setting type, const BString& field, uint32 value)
 {
 	if (BMessage* settings = _SettingsForType(type)) {
-		if (settings->RemoveName(field.String()) != B_ERROR)
-			return settings->AddUInt32(field.String(), value);
+		if (settings->RemoveName(field.String()) != B_ERROR) {
+			status_t status = settings->AddUInt32(field.String(), value);
+			_SettingChanged(type, field);
+			return status;
+		}
 	}
 	return B_ERROR;
 }
@@ -448,6 +467,7 @@ SettingsServer::_GetDefaultAppSettings(BMessage* message)
 	message->AddInt32(skSettingsWindowTab, 0);
 	message->AddInt32(skQuitConfirmMode, B_CONTROL_ON);
 	message->AddInt32(skUndoQueueDepth, 20);
+	message->AddInt32(skMemoryBudget, 0);
 	message->AddInt32(skPaletteColorMode, HS_RGB_COLOR_MODE);
 
 	rgb_color black = {0, 0, 0, 255};
@@ -497,3 +517,87 @@ SettingsServer::_GetDefaultAppSettings(BMessage* message)
 	message->AddString(skProjectOpenPath, path.Path());
 	message->AddString(skProjectSavePath, path.Path());
 }
+
+
+status_t
+SettingsServer::GetRenderSettings(render_settings* settings)
+{
+	// While the count is not zero, the publisher keeps the retired snapshots.
+	atomic_add(&fRenderSettingsReaders, 1);
+	const render_settings* current = atomic_pointer_get(&fRenderSettings);
+	if (current != NULL)
+		*settings = *current;
+	atomic_add(&fRenderSettingsReaders, -1);
+
+	return current != NULL ? B_OK : B_ERROR;
+}
+
+
+void
+SettingsServer::StartWatchingRenderSettings(const BMessenger& target)
+{
+	BAutolock _(&fRenderSettingsLocker);
+	fRenderSettingsWatchers.push_back(target);
+}
+
+
+void
+SettingsServer::StopWatchingRenderSettings(const BMessenger& target)
+{
+	BAutolock _(&fRenderSettingsLocker);
+	fRenderSettingsWatchers.remove(target);
+}
+
+
+void
+SettingsServer::_PublishRenderSettings()
+{
+	render_settings* settings = new (std::nothrow) render_settings;
+	if (settings == NULL)
+		return;
+
+	rgb_color rgb1 = {0xBB, 0xBB, 0xBB, 0xFF};
+	rgb_color rgb2 = {0x99, 0x99, 0x99, 0xFF};
+
+	settings->bg_grid_size = fApplicationSettings.GetInt32(skBgGridSize, 20);
+	settings->bg_color1 = fApplicationSettings.GetUInt32(skBgColor1, RGBColorToBGRA(rgb1));
+	settings->bg_color2 = fApplicationSettings.GetUInt32(skBgColor2, RGBColorToBGRA(rgb2));
+
+	BAutolock _(&fRenderSettingsLocker);
+
+	// The readers may still be copying the previous snapshot. A reader that
+	// starts after the new one is set only sees the new one, so the retired
+	// snapshots can go when no reader is busy.
+	render_settings* previous = fRenderSettings;
+	settings->version = (previous != NULL) ? previous->version + 1 : 1;
+	if (previous != NULL)
+		fOldRenderSettings.push_back(previous);
+	atomic_pointer_set(&fRenderSettings, settings);
+
+	if (atomic_get(&fRenderSettingsReaders) == 0) {
+		std::list<render_settings*>::iterator old;
+		for (old = fOldRenderSettings.begin(); old != fOldRenderSettings.end(); ++old)
+			delete *old;
+		fOldRenderSettings.clear();
+	}
+
+	BMessage message(HS_RENDER_SETTINGS_CHANGED);
+	message.AddInt32("version", settings->version);
+
+	MessengerList::iterator it = fRenderSettingsWatchers.begin();
+	while (it != fRenderSettingsWatchers.end()) {
+		if (it->SendMessage(&message, (BHandler*)NULL, 0) == B_BAD_PORT_ID)
+			it = fRenderSettingsWatchers.erase(it);
+		else
+			++it;
+	}
+}
+
+
+void
+SettingsServer::_SettingChanged(Setting type, const BString& field)
+{
+	if (type == Application
+		&& (field == skBgGridSize || field == skBgColor1 || field == skBgColor2))
+		_PublishRenderSettings();
+}
@@ -11,6 +11,7 @@
 
 #include <Locker.h>
 #include <Message.h>
+#include <Messenger.h>
 #include <String.h>
 
 #include <list>
@@ -18,6 +19,7 @@
 
 typedef std::list<BString> StringList;
 typedef std::list<BSize> ImageSizeList;
+typedef std::list<BMessenger> MessengerList;
 
 
 // application
@@ -27,6 +29,7 @@ static const char skCursorMode[]				= "cursor_mode";
 static const char skSettingsWindowTab[]			= "settings_window_tab";
 static const char skQuitConfirmMode[]			= "quit_confirm_mode";
 static const char skUndoQueueDepth[]			= "undo_queue_depth";
+static const char skMemoryBudget[]				= "memory_budget";
 static const char skPaletteColorMode[]			= "palette_color_mode";
 static const char skPaletteSelectedColor[]		= "palette_color_index";
 
@@ -78,6 +81,21 @@ static const char skBgColor1[]					= "bg_color1";
 static const char skBgColor2[]					= "bg_color2";
 
 
+/*
+	The settings that are needed while rendering. The SettingsServer
+	publishes a new snapshot whenever one of them changes, a published
+	snapshot is never changed. The render threads copy the snapshot without
+	locking, so they need not copy the whole application settings. The
+	retired snapshots are deleted once no thread is copying one of them.
+*/
+struct render_settings {
+	int32	version;
+	int32	bg_grid_size;
+	uint32	bg_color1;
+	uint32	bg_color2;
+};
+
+
 class SettingsServer
 {
 	friend class PaintApplication;
@@ -132,6 +150,16 @@ public:
 
 			void					Sync();
 
+			status_t				GetRenderSettings(
+										render_settings* settings);
+
+			// The watchers get a HS_RENDER_SETTINGS_CHANGED message with the
+			// new "version" after each change.
+			void					StartWatchingRenderSettings(
+										const BMessenger& target);
+			void					StopWatchingRenderSettings(
+										const BMessenger& target);
+
 private:
 									SettingsServer();
 									SettingsServer(const SettingsServer& server);
@@ -149,6 +177,9 @@ private:
 										StringList& list);
 			BMessage*				_SettingsForType(Setting type);
 			void					_GetDefaultAppSettings(BMessage* message);
+			void					_PublishRenderSettings();
+			void					_SettingChanged(Setting type,
+										const BString& field);
 
 private:
 			BMessage				fWindowSettings;
@@ -161,6 +192,12 @@ private:
 
 			ImageSizeList			fRecentImageSizeList;
 
+			render_settings*		fRenderSettings;
+			std::list<render_settings*>	fOldRenderSettings;
+			int32					fRenderSettingsReaders;
+			MessengerList			fRenderSettingsWatchers;
+			BLocker					fRenderSettingsLocker;
+
 	static	BLocker					fLocker;
 	static	SettingsServer*			fSettingsServer;
 };
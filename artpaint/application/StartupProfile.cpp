@@ -0,0 +1,47 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+
+#include "StartupProfile.h"
+
+
+#include <stdio.h>
+
+
+bool StartupProfile::fEnabled = false;
+bigtime_t StartupProfile::fStartTime = 0;
+bigtime_t StartupProfile::fPhaseStart = 0;
+
+
+void
+StartupProfile::Enable()
+{
+	fEnabled = true;
+	fStartTime = fPhaseStart = system_time();
+}
+
+
+void
+StartupProfile::Phase(const char* name)
+{
+	if (!fEnabled)
+		return;
+
+	Phase(name, fPhaseStart);
+	fPhaseStart = system_time();
+}
+
+
+void
+StartupProfile::Phase(const char* name, bigtime_t start)
+{
+	if (!fEnabled)
+		return;
+
+	bigtime_t now = system_time();
+	printf("startup: %-16s %8.1f ms (at %8.1f ms)\n", name, (now - start) / 1000.0,
+		(now - fStartTime) / 1000.0);
+	fflush(stdout);
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+#ifndef STARTUP_PROFILE_H
+#define STARTUP_PROFILE_H
+
+#include <OS.h>
+
+
+/*
+	When ArtPaint is started with --trace-startup, the time spent in each
+	phase of the startup is printed to the standard output. A phase lasts
+	from the end of the previous one, except for the phases that run in
+	threads of their own, which report their own durations.
+*/
+class StartupProfile {
+public:
+	static	void			Enable();
+
+	// Ends the current phase of the main thread.
+	static	void			Phase(const char* name);
+
+	// Reports a phase that started at the given time.
+	static	void			Phase(const char* name, bigtime_t start);
+
+private:
+	static	bool			fEnabled;
+	static	bigtime_t		fStartTime;
+	static	bigtime_t		fPhaseStart;
+};
+
+
+#endif	// STARTUP_PROFILE_H
@@ -0,0 +1,231 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+
+#include "StrokeReplay.h"
+
+#include "BitmapUtilities.h"
+#include "DrawingTool.h"
+#include "ToolManager.h"
+#include "ToolScript.h"
+
+
+#include <Autolock.h>
+#include <Bitmap.h>
+#include <File.h>
+#include <Message.h>
+
+
+#include <map>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+
+// The canvas that is used when the strokes did not record one.
+const BRect kDefaultCanvas(0, 0, 1023, 767);
+
+
+struct replay_stats {
+	int32		strokes;
+	int64		dabs;
+	int64		changed_pixels;
+	bigtime_t	time;
+};
+
+
+static uint32
+canvas_checksum(BBitmap* bitmap)
+{
+	// FNV-1a over the pixels, row by row so that the padding is not included.
+	uint32 hash = 2166136261U;
+	int32 width = (bitmap->Bounds().IntegerWidth() + 1) * 4;
+	int32 height = bitmap->Bounds().IntegerHeight() + 1;
+	for (int32 y = 0; y < height; y++) {
+		const uint8* row = (const uint8*)bitmap->Bits() + y * bitmap->BytesPerRow();
+		for (int32 x = 0; x < width; x++) {
+			hash ^= row[x];
+			hash *= 16777619U;
+		}
+	}
+
+	return hash;
+}
+
+
+static int64
+changed_pixels(BBitmap* bitmap, const uint32* before)
+{
+	const uint32* bits = (const uint32*)bitmap->Bits();
+	int32 count = bitmap->BitsLength() / 4;
+
+	int64 changed = 0;
+	for (int32 i = 0; i < count; i++) {
+		if (bits[i] != before[i])
+			changed++;
+	}
+
+	return changed;
+}
+
+
+BFile* StrokeReplay::fFile = NULL;
+BLocker StrokeReplay::fLocker("stroke replay lock");
+
+
+void
+StrokeReplay::SetRecordFile(const char* path)
+{
+	BAutolock _(fLocker);
+
+	delete fFile;
+	fFile = new (std::nothrow) BFile(path, B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	if (fFile != NULL && fFile->InitCheck() != B_OK) {
+		fprintf(stderr, "Cannot record the strokes to '%s'\n", path);
+		delete fFile;
+		fFile = NULL;
+	}
+}
+
+
+void
+StrokeReplay::Record(ToolScript* script, BRect image_bounds)
+{
+	if (fFile == NULL || script == NULL)
+		return;
+
+	BMessage archive;
+	if (script->Archive(&archive) != B_OK
+		|| archive.AddRect("image_bounds", image_bounds) != B_OK)
+		return;
+
+	BAutolock _(fLocker);
+	if (fFile != NULL)
+		archive.Flatten(fFile);
+}
+
+
+int
+StrokeReplay::Main(int argc, char* argv[])
+{
+	int32 repeat_count = 1;
+	std::vector<const char*> files;
+	for (int32 i = 0; i < argc; i++) {
+		if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+			repeat_count = max_c(atoi(argv[++i]), 1);
+		else
+			files.push_back(argv[i]);
+	}
+
+	if (files.empty()) {
+		fprintf(stderr, "Usage: ArtPaint --replay-strokes [--repeat <count>] "
+			"<file> ...\n");
+		return 1;
+	}
+
+	std::map<int32, replay_stats> stats;
+	int32 skipped = 0;
+	int32 mismatches = 0;
+
+	for (size_t f = 0; f < files.size(); f++) {
+		BFile file(files[f], B_READ_ONLY);
+		if (file.InitCheck() != B_OK) {
+			fprintf(stderr, "%s: cannot open the file\n", files[f]);
+			return 1;
+		}
+
+		std::vector<BMessage*> strokes;
+		BMessage* archive = new BMessage();
+		while (archive->Unflatten(&file) == B_OK) {
+			strokes.push_back(archive);
+			archive = new BMessage();
+		}
+		delete archive;
+
+		BRect canvas_bounds = kDefaultCanvas;
+		if (!strokes.empty())
+			strokes[0]->FindRect("image_bounds", &canvas_bounds);
+
+		BBitmap* canvas = new (std::nothrow) BBitmap(canvas_bounds, B_RGBA32);
+		uint32* before = NULL;
+		if (canvas != NULL && canvas->IsValid())
+			before = new (std::nothrow) uint32[canvas->BitsLength() / 4];
+		if (before == NULL) {
+			fprintf(stderr, "%s: not enough memory for the canvas\n", files[f]);
+			delete canvas;
+			for (size_t i = 0; i < strokes.size(); i++)
+				delete strokes[i];
+			return 1;
+		}
+
+		uint32 first_checksum = 0;
+		for (int32 r = 0; r < repeat_count; r++) {
+			BitmapUtilities::ClearBitmap(canvas, 0xFFFFFFFF);
+
+			for (size_t i = 0; i < strokes.size(); i++) {
+				ToolScript script(strokes[i]);
+				DrawingTool* tool = ToolManager::Instance().ReturnTool(script.ToolType());
+				if (tool == NULL) {
+					skipped++;
+					continue;
+				}
+
+				// The pixels are compared outside of the timed part.
+				memcpy(before, canvas->Bits(), canvas->BitsLength());
+
+				bigtime_t start = system_time();
+				int32 status = tool->UseToolWithScript(&script, canvas);
+				bigtime_t time = system_time() - start;
+
+				if (status == B_ERROR) {
+					skipped++;
+					continue;
+				}
+
+				replay_stats& tool_stats = stats[script.ToolType()];
+				tool_stats.strokes++;
+				tool_stats.dabs += script.PointCount();
+				tool_stats.changed_pixels += changed_pixels(canvas, before);
+				tool_stats.time += time;
+			}
+
+			uint32 checksum = canvas_checksum(canvas);
+			if (r == 0) {
+				first_checksum = checksum;
+				printf("%s: %d strokes, checksum %08" B_PRIx32 "\n", files[f],
+					(int)strokes.size(), checksum);
+			} else if (checksum != first_checksum) {
+				printf("%s: repeat %" B_PRId32 " has checksum %08" B_PRIx32 "\n",
+					files[f], r + 1, checksum);
+				mismatches++;
+			}
+		}
+
+		delete[] before;
+		delete canvas;
+		for (size_t i = 0; i < strokes.size(); i++)
+			delete strokes[i];
+	}
+
+	printf("%-24s %8s %10s %10s %12s %10s\n", "tool", "strokes", "dabs", "ms",
+		"dabs/s", "Mpix/s");
+	std::map<int32, replay_stats>::iterator it;
+	for (it = stats.begin(); it != stats.end(); it++) {
+		DrawingTool* tool = ToolManager::Instance().ReturnTool(it->first);
+		const replay_stats& tool_stats = it->second;
+		double seconds = max_c(tool_stats.time, 1) / 1000000.0;
+		printf("%-24s %8" B_PRId32 " %10" B_PRId64 " %10.1f %12.0f %10.2f\n",
+			tool->Name().String(), tool_stats.strokes, tool_stats.dabs,
+			tool_stats.time / 1000.0, tool_stats.dabs / seconds,
+			tool_stats.changed_pixels / seconds / 1000000.0);
+	}
+
+	if (skipped > 0)
+		printf("%" B_PRId32 " strokes could not be replayed\n", skipped);
+
+	return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+#ifndef STROKE_REPLAY_H
+#define STROKE_REPLAY_H
+
+#include <Locker.h>
+#include <Rect.h>
+
+
+class BFile;
+class ToolScript;
+
+
+/*
+	StrokeReplay records the strokes that are drawn in the user interface and
+	draws them again without any windows. When ArtPaint is started with
+	--record-strokes <file>, the script of every stroke is appended to the
+	file. Starting it with
+
+		--replay-strokes [--repeat <count>] <file> ...
+
+	draws the strokes of each file to an empty canvas with the tools'
+	UseToolWithScript and prints how fast each tool was, together with a
+	checksum of the resulting canvas. The checksum must not change between
+	the repeats or between two versions of a tool that should draw the same.
+*/
+class StrokeReplay {
+public:
+	static	void			SetRecordFile(const char* path);
+
+	// Appends the stroke to the record file, if there is one.
+	static	void			Record(ToolScript* script, BRect image_bounds);
+
+	// Parses the arguments that follow --replay-strokes on the command line
+	// and replays the files. The return value is the exit status of the
+	// application.
+	static	int				Main(int argc, char* argv[]);
+
+private:
+	static	BFile*			fFile;
+	static	BLocker			fLocker;
+};
+
+
+#endif	// STROKE_REPLAY_H
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+
+#include "TraceRecorder.h"
+
+
+#include <Autolock.h>
+#include <String.h>
+#include <TLS.h>
+
+
+#include <map>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+const int32 kEventsPerBuffer = 8192;
+
+
+struct TraceRecorder::trace_event {
+	const char*		category;
+	const char*		name;
+	bigtime_t		start;
+	bigtime_t		duration;
+	int64			pixels;
+	thread_id		thread;
+};
+
+
+// The buffers are never freed. When a thread exits its buffer is given to
+// the next thread that records something, because the render threads only
+// live for one frame.
+struct TraceRecorder::thread_buffer {
+	thread_buffer*	next;
+	vint32			in_use;
+	vint32			count;
+	trace_event		events[kEventsPerBuffer];
+};
+
+
+// The names of the threads that have recorded something, so that the
+// threads that have exited can be named too. A new render thread is
+// spawned for every frame, so only the first ones are named.
+static std::map<thread_id, BString> sThreadNames;
+const size_t kMaxThreadNames = 4096;
+
+
+bool TraceRecorder::fEnabled = false;
+char* TraceRecorder::fPath = NULL;
+bigtime_t TraceRecorder::fStartTime = 0;
+int32 TraceRecorder::fBufferSlot = -1;
+BLocker TraceRecorder::fLocker("trace recorder lock");
+TraceRecorder::thread_buffer* TraceRecorder::fBuffers = NULL;
+
+
+void
+TraceRecorder::Enable(const char* path)
+{
+	BAutolock _(fLocker);
+
+	if (fBufferSlot < 0)
+		fBufferSlot = tls_allocate();
+
+	free(fPath);
+	fPath = strdup(path);
+	fStartTime = system_time();
+	fEnabled = true;
+}
+
+
+void
+TraceRecorder::Record(const char* category, const char* name, bigtime_t start,
+	bigtime_t end, int64 pixels)
+{
+	if (!fEnabled)
+		return;
+
+	thread_buffer* buffer = _BufferForThread();
+	if (buffer == NULL)
+		return;
+
+	// Only this thread writes to the buffer. The count is increased after
+	// the event has been written, so Export() knows which events are whole.
+	trace_event& event = buffer->events[buffer->count % kEventsPerBuffer];
+	event.category = category;
+	event.name = name;
+	event.start = start;
+	event.duration = end - start;
+	event.pixels = pixels;
+	event.thread = find_thread(NULL);
+	atomic_add(&buffer->count, 1);
+}
+
+
+status_t
+TraceRecorder::Export()
+{
+	if (!fEnabled || fPath == NULL)
+		return B_NO_INIT;
+
+	return Export(fPath);
+}
+
+
+status_t
+TraceRecorder::Export(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (file == NULL) {
+		fprintf(stderr, "Cannot write the trace to '%s'\n", path);
+		return B_ERROR;
+	}
+
+	BAutolock _(fLocker);
+
+	int32 team = getpid();
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%" B_PRId32
+		",\"tid\":0,\"args\":{\"name\":\"ArtPaint\"}}", team);
+
+	std::map<thread_id, BString>::iterator it;
+	for (it = sThreadNames.begin(); it != sThreadNames.end(); it++) {
+		fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%" B_PRId32
+			",\"tid\":%" B_PRId32 ",\"args\":{\"name\":\"%s\"}}", team, it->first,
+			it->second.String());
+	}
+
+	trace_event* events = new (std::nothrow) trace_event[kEventsPerBuffer];
+	for (thread_buffer* buffer = fBuffers; buffer != NULL && events != NULL;
+			buffer = buffer->next) {
+		// The thread may go on recording while its events are copied. The
+		// ones that it could have overwritten in the meantime are skipped.
+		int32 last = atomic_get(&buffer->count);
+		int32 copied = max_c(last - kEventsPerBuffer, 0);
+		for (int32 i = copied; i < last; i++)
+			events[i - copied] = buffer->events[i % kEventsPerBuffer];
+		int32 first = max_c(copied, atomic_get(&buffer->count) - kEventsPerBuffer);
+
+		for (int32 i = first; i < last; i++) {
+			const trace_event& event = events[i - copied];
+			fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+				"\"ts\":%.3f,\"dur\":%.3f,\"pid\":%" B_PRId32 ",\"tid\":%" B_PRId32,
+				event.name, event.category, (double)(event.start - fStartTime),
+				(double)event.duration, team, event.thread);
+			if (event.pixels >= 0)
+				fprintf(file, ",\"args\":{\"pixels\":%" B_PRId64 "}", event.pixels);
+			fprintf(file, "}");
+		}
+	}
+	delete[] events;
+
+	fprintf(file, "\n]}\n");
+	fclose(file);
+
+	return B_OK;
+}
+
+
+TraceRecorder::thread_buffer*
+TraceRecorder::_BufferForThread()
+{
+	thread_buffer* buffer = (thread_buffer*)tls_get(fBufferSlot);
+	if (buffer != NULL)
+		return buffer;
+
+	BAutolock _(fLocker);
+
+	for (buffer = fBuffers; buffer != NULL; buffer = buffer->next) {
+		if (buffer->in_use == 0)
+			break;
+	}
+	if (buffer == NULL) {
+		buffer = new (std::nothrow) thread_buffer;
+		if (buffer == NULL)
+			return NULL;
+
+		buffer->count = 0;
+		buffer->next = fBuffers;
+		fBuffers = buffer;
+	}
+	buffer->in_use = 1;
+
+	thread_info info;
+	if (sThreadNames.size() < kMaxThreadNames
+		&& get_thread_info(find_thread(NULL), &info) == B_OK)
+		sThreadNames[info.thread] = info.name;
+
+	tls_set(fBufferSlot, buffer);
+	on_exit_thread(_ReleaseBuffer, buffer);
+
+	return buffer;
+}
+
+
+void
+TraceRecorder::_ReleaseBuffer(void* data)
+{
+	BAutolock _(fLocker);
+
+	((thread_buffer*)data)->in_use = 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <Locker.h>
+#include <OS.h>
+
+
+/*
+	The TraceRecorder keeps a record of how long the rendering, the tools and
+	the manipulator previews take, so that a slow frame can be looked at
+	afterwards. It is enabled by starting ArtPaint with --trace <file>, and
+	the record is written to the file as a Chrome trace (which Perfetto can
+	open too) when ArtPaint quits or when Export() is called.
+
+	Each thread writes its events to a buffer of its own, so recording does
+	not take any locks. A buffer keeps the latest kEventsPerBuffer events of
+	its thread. When tracing is not enabled, a TRACE_SCOPE only tests a flag.
+*/
+class TraceRecorder {
+public:
+	static	void			Enable(const char* path);
+	static	bool			IsEnabled() { return fEnabled; }
+
+	// Records an event of the calling thread. The name and the category must
+	// be string constants, because they are only copied when the trace is
+	// exported. If pixels is not negative, it is shown with the event.
+	static	void			Record(const char* category, const char* name,
+								bigtime_t start, bigtime_t end,
+								int64 pixels = -1);
+
+	// Writes the events to the file that was given to Enable().
+	static	status_t		Export();
+	static	status_t		Export(const char* path);
+
+private:
+	struct trace_event;
+	struct thread_buffer;
+
+	static	thread_buffer*	_BufferForThread();
+	static	void			_ReleaseBuffer(void* data);
+
+	static	bool			fEnabled;
+	static	char*			fPath;
+	static	bigtime_t		fStartTime;
+	static	int32			fBufferSlot;
+
+	// Only taken when a thread gets a buffer and when exporting.
+	static	BLocker			fLocker;
+	static	thread_buffer*	fBuffers;
+};
+
+
+// Records the time from its creation to the end of the scope.
+class TraceScope {
+public:
+							TraceScope(const char* category, const char* name,
+								int64 pixels = -1)
+								:
+								fCategory(category),
+								fName(name),
+								fPixels(pixels),
+								fStart(TraceRecorder::IsEnabled() ? system_time() : 0)
+							{
+							}
+
+							~TraceScope()
+							{
+								if (fStart != 0) {
+									TraceRecorder::Record(fCategory, fName, fStart,
+										system_time(), fPixels);
+								}
+							}
+
+			void			SetPixels(int64 pixels) { fPixels = pixels; }
+
+private:
+			const char*		fCategory;
+			const char*		fName;
+			int64			fPixels;
+			bigtime_t		fStart;
+};
+
+
+#define TRACE_SCOPE_NAME2(line) _trace_scope_ ## line
+#define TRACE_SCOPE_NAME(line) TRACE_SCOPE_NAME2(line)
+#define TRACE_SCOPE(category, name) \
+	TraceScope TRACE_SCOPE_NAME(__LINE__)(category, name)
+#define TRACE_SCOPE_PIXELS(category, name, pixels) \
+	TraceScope TRACE_SCOPE_NAME(__LINE__)(category, name, pixels)
+
+
+#endif	// TRACE_RECORDER_H
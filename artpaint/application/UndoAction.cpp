@@ -10,6 +10,7 @@
 #include "UndoAction.h"
 
 #include "ManipulatorSettings.h"
+#include "MemoryBudget.h"
 #include "UndoQueue.h"
 
 
@@ -40,6 +41,7 @@ UndoAction::UndoAction(int32 layer, action_type t, BRect rect)
 	queue = NULL;
 
 	size_has_changed = FALSE;
+	offset_has_changed = FALSE;
 }
 
 
@@ -63,6 +65,7 @@ UndoAction::UndoAction(int32 layer, int32 merged_layer, BRect rect)
 	queue = NULL;
 
 	size_has_changed = FALSE;
+	offset_has_changed = FALSE;
 }
 
 
@@ -85,6 +88,7 @@ UndoAction::UndoAction(int32 layer, ToolScript* script, BRect rect)
 	undo_bitmap_count = 0;
 
 	size_has_changed = FALSE;
+	offset_has_changed = FALSE;
 
 	if (type == TOOL_ACTION)
 		tool_script = script;
@@ -112,6 +116,7 @@ UndoAction::UndoAction(
 	undo_bitmap_count = 0;
 
 	size_has_changed = FALSE;
+	offset_has_changed = FALSE;
 
 	if (type == MANIPULATOR_ACTION) {
 		manipulator_settings = settings;
@@ -121,11 +126,36 @@ UndoAction::UndoAction(
 }
 
 
+UndoAction::UndoAction(int32 layer, BPoint old_offset, BRect rect)
+{
+	layer_id = layer;
+	type = OFFSET_LAYER_ACTION;
+	if (rect.IsValid() == TRUE)
+		bounding_rect = rect;
+	else
+		type = NO_ACTION;
+
+	tool_script = NULL;
+	manipulator_settings = NULL;
+	add_on_id = -1;
+	queue = NULL;
+	undo_bitmaps = NULL;
+	undo_rects = NULL;
+	undo_bitmap_count = 0;
+
+	size_has_changed = FALSE;
+	offset_has_changed = FALSE;
+
+	if (type == OFFSET_LAYER_ACTION)
+		SetOldLayerOffset(old_offset);
+}
+
+
 UndoAction::~UndoAction()
 {
 	if (undo_bitmaps != NULL) {
 		for (int32 i = 0; i < undo_bitmap_count; i++) {
-			delete undo_bitmaps[i];
+			MemoryBudget::DeleteBitmap(undo_bitmaps[i]);
 			undo_bitmaps[i] = NULL;
 		}
 		delete[] undo_bitmaps;
@@ -137,6 +167,23 @@ UndoAction::~UndoAction()
 }
 
 
+void
+UndoAction::SetOldLayerOffset(BPoint old_offset)
+{
+	layer_offset = old_offset;
+	offset_has_changed = TRUE;
+}
+
+
+BPoint
+UndoAction::SwapLayerOffset(BPoint current_offset)
+{
+	BPoint offset = layer_offset;
+	layer_offset = current_offset;
+	return offset;
+}
+
+
 status_t
 UndoAction::StoreUndo(BBitmap* bitmap)
 {
@@ -151,7 +198,7 @@ UndoAction::StoreUndo(BBitmap* bitmap)
 				|| (type == CLEAR_LAYER_ACTION) || (type == MERGE_LAYER_ACTION)) {
 				BBitmap* spare_bitmap = queue->ReturnLayerSpareBitmap(layer_id, bitmap);
 				StoreDifferences(spare_bitmap, bitmap, bounding_rect);
-				if (undo_bitmap_count == 0)
+				if (undo_bitmap_count == 0 && offset_has_changed == FALSE)
 					type = NO_ACTION;
 			} else if (type == ADD_LAYER_ACTION) {
 				queue->ChangeLayerSpareBitmap(layer_id, bitmap);
@@ -216,12 +263,24 @@ UndoAction::ApplyUndo(BBitmap* bitmap, BRect& updated_rect)
 
 		if ((type == CHANGE_LAYER_CONTENT_ACTION) || (type == TOOL_ACTION)
 			|| (type == CLEAR_LAYER_ACTION) || (type == MERGE_LAYER_ACTION)) {
-			if (undo_bitmaps == NULL)
+			if (undo_bitmaps == NULL) {
+				// Only the offset of the layer changed.
+				if (offset_has_changed == TRUE) {
+					updated_rect = bounding_rect;
+					return bitmap;
+				}
 				return NULL;
+			}
 
 			BBitmap* spare_bitmap = queue->ReturnLayerSpareBitmap(layer_id, bitmap);
 			updated_rect = RestoreDifference(bitmap, spare_bitmap);
+			if (offset_has_changed == TRUE)
+				updated_rect = updated_rect | bounding_rect;
 
+			return bitmap;
+		} else if (type == OFFSET_LAYER_ACTION) {
+			// The pixels do not change, the caller swaps the offsets.
+			updated_rect = bounding_rect;
 			return bitmap;
 		} else if (type == ADD_LAYER_ACTION) {
 			if (undo_bitmaps == NULL) {
@@ -396,6 +455,8 @@ UndoAction::StoreDifferences(BBitmap* old, BBitmap* current, BRect area)
 			undo_bitmaps[undo_bitmap_count - 1] = new BBitmap(bitmap_rect, B_RGB32);
 			if (undo_bitmaps[undo_bitmap_count - 1]->IsValid() == FALSE)
 				throw std::bad_alloc();
+			MemoryBudget::Track(undo_bitmaps[undo_bitmap_count - 1], queue->image_view,
+				UNDO_MEMORY);
 
 			undo_rects[undo_bitmap_count - 1] = area;
 			uint32* undo_bits = (uint32*)undo_bitmaps[undo_bitmap_count - 1]->Bits();
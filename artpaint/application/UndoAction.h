@@ -26,7 +26,8 @@ enum action_type {
 	DELETE_LAYER_ACTION,
 	CLEAR_LAYER_ACTION,
 	CHANGE_LAYER_CONTENT_ACTION,
-	MERGE_LAYER_ACTION
+	MERGE_LAYER_ACTION,
+	OFFSET_LAYER_ACTION
 };
 
 
@@ -56,6 +57,11 @@ class UndoAction {
 
 	bool				size_has_changed;
 
+	// The other layer offset. It is swapped with the layer's offset whenever
+	// the action is undone or redone.
+	BPoint				layer_offset;
+	bool				offset_has_changed;
+
 	void				StoreDifferences(BBitmap*old,	BBitmap* current, BRect area);
 	BRect				RestoreDifference(BBitmap*, BBitmap*);
 
@@ -71,6 +77,7 @@ public:
 				UndoAction(int32 layer, ToolScript* script, BRect rect);
 				UndoAction(int32 layer, ManipulatorSettings*, BRect rect, manipulator_type type,
 					int32 aoid = -1);
+				UndoAction(int32 layer, BPoint old_offset, BRect rect);
 
 				~UndoAction();
 
@@ -81,6 +88,10 @@ public:
 	void		SetEvent(UndoEvent* e) { event = e; }
 	void		SetQueue(UndoQueue* q) { queue = q; }
 
+	void		SetOldLayerOffset(BPoint old_offset);
+	bool		ChangesLayerOffset() { return offset_has_changed; }
+	BPoint		SwapLayerOffset(BPoint current_offset);
+
 	int32		LayerId() { return layer_id; }
 	bool		IsEmpty() { return type == NO_ACTION; }
 };
@@ -8,7 +8,9 @@
  */
 
 #include "UndoEvent.h"
+#include "MemoryBudget.h"
 #include "Selection.h"
+#include "UndoQueue.h"
 
 
 #include <Bitmap.h>
@@ -28,6 +30,7 @@ UndoEvent::UndoEvent(const BString& name, const BBitmap*)
 
 	next_event = NULL;
 	previous_event = NULL;
+	queue = NULL;
 
 	selection_data = NULL;
 	selection_map = NULL;
@@ -46,7 +49,7 @@ UndoEvent::~UndoEvent()
 	delete[] actions;
 
 	delete selection_data;
-	delete selection_map;
+	MemoryBudget::DeleteBitmap(selection_map);
 
 	delete layer_data;
 }
@@ -116,8 +119,10 @@ UndoEvent::SetSelectionData(const SelectionData *s)
 void
 UndoEvent::SetSelectionMap(const BBitmap* new_map)
 {
-	delete selection_map;
+	MemoryBudget::DeleteBitmap(selection_map);
 	selection_map = new BBitmap(new_map);
+	if (queue != NULL)
+		MemoryBudget::Track(selection_map, queue->ReturnImageView(), UNDO_MEMORY);
 }
 
 
@@ -130,4 +135,5 @@ UndoEvent::SetLayerData(Layer* src_layer)
 	layer_data->SetVisibility(src_layer->IsVisible());
 	layer_data->SetTransparency(src_layer->GetOldTransparency());
 	layer_data->SetBlendMode(src_layer->GetBlendMode());
+	layer_data->SetOffset(src_layer->Offset());
 }
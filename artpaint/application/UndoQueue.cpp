@@ -50,6 +50,8 @@ UndoQueue::UndoQueue(BMenuItem* undo_item, BMenuItem* redo_item, ImageView* iv)
 	selection_data = new SelectionData();
 	selection_map = NULL;
 
+	MemoryBudget::AddReclaimer(this, kUndoReclaimPriority, image_view);
+
 	UpdateMenuItems();
 }
 
@@ -61,6 +63,8 @@ UndoQueue::UndoQueue(BFile&)
 
 UndoQueue::~UndoQueue()
 {
+	MemoryBudget::RemoveReclaimer(this);
+
 	UndoEvent* spare_event = first_event;
 	while (spare_event != NULL) {
 		first_event = spare_event->next_event;
@@ -71,13 +75,13 @@ UndoQueue::~UndoQueue()
 	queue_list->RemoveItem(this);
 
 	for (int32 i = 0; i < layer_bitmap_count; i++) {
-		delete layer_bitmaps[i];
+		MemoryBudget::DeleteBitmap(layer_bitmaps[i]);
 		layer_bitmaps[i] = NULL;
 	}
 	delete[] layer_bitmaps;
 
 	delete selection_data;
-	delete selection_map;
+	MemoryBudget::DeleteBitmap(selection_map);
 
 }
 
@@ -88,6 +92,10 @@ UndoQueue::AddUndoEvent(const char* name, const BBitmap* thumbnail, bool remove_
 	if (maximum_queue_depth == 0)
 		return NULL;
 
+	// The previous events have stored all of their bitmaps by now, so this
+	// is a safe point to drop the oldest ones if memory is running short.
+	MemoryBudget::Enforce(image_view);
+
 	UndoEvent* event = new UndoEvent(name, thumbnail);
 	current_queue_depth++;
 
@@ -195,6 +203,7 @@ UndoQueue::ReturnLayerSpareBitmap(int32 layer_id, BBitmap* layer_bitmap)
 			layer_bitmaps[layer_id] = new BBitmap(layer_bitmap->Bounds(), B_RGB32);
 			if (layer_bitmaps[layer_id]->IsValid() == FALSE)
 				throw std::bad_alloc();
+			MemoryBudget::Track(layer_bitmaps[layer_id], image_view, UNDO_MEMORY);
 		}
 	}
 
@@ -224,6 +233,7 @@ UndoQueue::ChangeLayerSpareBitmap(int32 layer_id, BBitmap* layer_bitmap)
 		layer_bitmaps[layer_id] = new BBitmap(layer_bitmap->Bounds(), B_RGB32);
 		if (layer_bitmaps[layer_id]->IsValid() == FALSE)
 			throw std::bad_alloc();
+		MemoryBudget::Track(layer_bitmaps[layer_id], image_view, UNDO_MEMORY);
 
 		uint32* spare_bits = (uint32*)layer_bitmaps[layer_id]->Bits();
 		uint32* bits = (uint32*)layer_bitmap->Bits();
@@ -260,6 +270,7 @@ UndoQueue::RegisterLayer(int32 layer_id, BBitmap* layer_bitmap)
 				layer_bitmaps[layer_id] = new BBitmap(layer_bitmap->Bounds(), B_RGB32);
 				if (layer_bitmaps[layer_id]->IsValid() == FALSE)
 					throw std::bad_alloc();
+				MemoryBudget::Track(layer_bitmaps[layer_id], image_view, UNDO_MEMORY);
 
 				uint32* source_bits = (uint32*)layer_bitmap->Bits();
 				uint32* target_bits = (uint32*)layer_bitmaps[layer_id]->Bits();
@@ -451,70 +462,21 @@ UndoQueue::SetQueueDepth(int32 depth)
 void
 UndoQueue::TruncateQueue()
 {
-	if ((maximum_queue_depth != INFINITE_QUEUE_DEPTH)
-		&& (current_queue_depth > maximum_queue_depth)) {
+	if (maximum_queue_depth != INFINITE_QUEUE_DEPTH) {
 		while (current_queue_depth > maximum_queue_depth) {
-			// We should remove the events so that the nearest events to the current
-			// event from both sides are removed last, and the furthest away events
-			// first. If needed the actual current event is then removed at the end.
-
-			// search the furthest away event from the current_event, or if current event
-			// is NULL, from the first_event. If both are NULL, put the current_queue_length to
-			// zero.
-			UndoEvent* furthest_event = NULL;
-			if (current_event != NULL) {
-				UndoEvent* redo_direction = current_event;
-				UndoEvent* undo_direction = current_event;
-				while ((undo_direction != NULL) && (redo_direction != NULL)) {
-					undo_direction = undo_direction->previous_event;
-					redo_direction = redo_direction->next_event;
-				}
-				if (undo_direction != NULL) {
-					while (undo_direction->previous_event != NULL)
-						undo_direction = undo_direction->previous_event;
-					furthest_event = undo_direction;
-				} else if (redo_direction != NULL) {
-					while (redo_direction->next_event != NULL)
-						redo_direction = redo_direction->next_event;
-					furthest_event = redo_direction;
-				} else
-					furthest_event = first_event;
-			} else if (first_event != NULL) {
-				furthest_event = first_event;
-				while (furthest_event->next_event != NULL)
-					furthest_event = furthest_event->next_event;
-			} else
+			UndoEvent* furthest_event = FurthestEvent();
+			if (furthest_event == NULL) {
 				current_queue_depth = 0;
-
-			if (furthest_event == first_event) {
-				if (first_event != NULL)
-					first_event = first_event->next_event;
-			}
-
-			if (current_event == furthest_event)
-				current_event = NULL;
-
-			// Here we should unlink the furthest_event and delete it.
-			// Also decrease the current undo-depth by one
-			if (furthest_event != NULL) {
-				if (furthest_event->next_event != NULL)
-					furthest_event->next_event->previous_event = furthest_event->previous_event;
-				if (furthest_event->previous_event != NULL)
-					furthest_event->previous_event->next_event = furthest_event->next_event;
-
-				furthest_event->next_event = NULL;
-				furthest_event->previous_event = NULL;
-
-				delete furthest_event;
+				break;
 			}
-			current_queue_depth--;
+			DeleteEvent(furthest_event);
 		}
 	}
 
 	if (maximum_queue_depth == 0) {
 		// Delete everything.
 		for (int32 i = 0; i < layer_bitmap_count; i++) {
-			delete layer_bitmaps[i];
+			MemoryBudget::DeleteBitmap(layer_bitmaps[i]);
 			layer_bitmaps[i] = NULL;
 		}
 		delete[] layer_bitmaps;
@@ -527,6 +489,92 @@ UndoQueue::TruncateQueue()
 }
 
 
+UndoEvent*
+UndoQueue::FurthestEvent()
+{
+	// We should remove the events so that the nearest events to the current
+	// event from both sides are removed last, and the furthest away events
+	// first. If needed the actual current event is then removed at the end.
+
+	// search the furthest away event from the current_event, or if current event
+	// is NULL, from the first_event.
+	UndoEvent* furthest_event = NULL;
+	if (current_event != NULL) {
+		UndoEvent* redo_direction = current_event;
+		UndoEvent* undo_direction = current_event;
+		while ((undo_direction != NULL) && (redo_direction != NULL)) {
+			undo_direction = undo_direction->previous_event;
+			redo_direction = redo_direction->next_event;
+		}
+		if (undo_direction != NULL) {
+			while (undo_direction->previous_event != NULL)
+				undo_direction = undo_direction->previous_event;
+			furthest_event = undo_direction;
+		} else if (redo_direction != NULL) {
+			while (redo_direction->next_event != NULL)
+				redo_direction = redo_direction->next_event;
+			furthest_event = redo_direction;
+		} else
+			furthest_event = first_event;
+	} else if (first_event != NULL) {
+		furthest_event = first_event;
+		while (furthest_event->next_event != NULL)
+			furthest_event = furthest_event->next_event;
+	}
+
+	return furthest_event;
+}
+
+
+void
+UndoQueue::DeleteEvent(UndoEvent* event)
+{
+	if (event == first_event)
+		first_event = first_event->next_event;
+
+	if (current_event == event)
+		current_event = NULL;
+
+	// Here we should unlink the event and delete it.
+	// Also decrease the current undo-depth by one
+	if (event->next_event != NULL)
+		event->next_event->previous_event = event->previous_event;
+	if (event->previous_event != NULL)
+		event->previous_event->next_event = event->next_event;
+
+	event->next_event = NULL;
+	event->previous_event = NULL;
+
+	delete event;
+	current_queue_depth--;
+}
+
+
+int64
+UndoQueue::ReclaimMemory(int64 bytes)
+{
+	memory_usage usage;
+	if (!MemoryBudget::GetUsage(image_view, &usage))
+		return 0;
+
+	int64 undo_memory = usage.live[UNDO_MEMORY];
+	int64 freed = 0;
+	while (freed < bytes && current_queue_depth > 1) {
+		// The current event is kept so that the latest change can be undone.
+		UndoEvent* furthest_event = FurthestEvent();
+		if (furthest_event == NULL || furthest_event == current_event)
+			break;
+
+		DeleteEvent(furthest_event);
+		MemoryBudget::GetUsage(image_view, &usage);
+		freed = undo_memory - usage.live[UNDO_MEMORY];
+	}
+
+	UpdateMenuItems();
+	return freed;
+}
+
+
 void
 UndoQueue::SetSelectionData(const SelectionData* s)
 {
@@ -538,8 +586,9 @@ UndoQueue::SetSelectionData(const SelectionData* s)
 void
 UndoQueue::SetSelectionMap(const BBitmap* new_map)
 {
-	delete selection_map;
+	MemoryBudget::DeleteBitmap(selection_map);
 	selection_map = new BBitmap(new_map);
+	MemoryBudget::Track(selection_map, image_view, UNDO_MEMORY);
 }
 
 
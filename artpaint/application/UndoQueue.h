@@ -13,6 +13,7 @@
 #include <File.h>
 
 #include "ImageView.h"
+#include "MemoryBudget.h"
 #include "UndoEvent.h"
 
 
@@ -20,7 +21,7 @@ class Selection;
 
 #define	INFINITE_QUEUE_DEPTH	-1
 
-class UndoQueue {
+class UndoQueue : public MemoryReclaimer {
 	friend class UndoAction;
 
 			BBitmap**	layer_bitmaps;
@@ -42,6 +43,8 @@ class UndoQueue {
 			void		HandleLowMemorySituation();
 
 			void		TruncateQueue();
+			UndoEvent*	FurthestEvent();
+			void		DeleteEvent(UndoEvent*);
 
 	static	BList*		queue_list;
 	const	char*		ReturnUndoEventName();
@@ -57,6 +60,10 @@ public:
 
 			~UndoQueue();
 
+			// Drops the events that are furthest from the current one when
+			// the memory budget is exceeded.
+	virtual	int64		ReclaimMemory(int64 bytes);
+
 			UndoEvent*	AddUndoEvent(const char*, const BBitmap*, bool remove_tail = TRUE);
 			UndoEvent*	ReturnCurrentEvent() { return current_event; }
 
@@ -90,6 +97,8 @@ public:
 
 			void		SetLayerData(Layer*);
 			Layer*		ReturnLayerData() { return layer_data; }
+
+			ImageView*	ReturnImageView() { return image_view; }
 };
 
 
@@ -14,10 +14,12 @@
 #include "ImageView.h"
 #include "LayerView.h"
 #include "LayerWindow.h"
+#include "MemoryBudget.h"
 #include "MessageConstants.h"
 #include "PixelOperations.h"
 #include "ProjectFileFunctions.h"
 #include "Selection.h"
+#include "TraceRecorder.h"
 #include "SettingsServer.h"
 #include "UtilityClasses.h"
 
@@ -29,12 +31,49 @@
 #include "zlib.h"
 #include <new>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// Moves the contents of a 32-bit bitmap by (dx, dy) in place. The pixels
+// that are uncovered are set to the background.
+static void
+shift_bits(uint32* bits, int32 width, int32 height, int32 bpr, int32 dx, int32 dy,
+	uint32 background)
+{
+	int32 count = width - abs(dx);
+	for (int32 i = 0; i < height; ++i) {
+		// Rows are processed in the order that never overwrites a row that
+		// is still needed as a source.
+		int32 y = (dy > 0) ? height - 1 - i : i;
+		int32 source_y = y - dy;
+		uint32* target = bits + y * bpr;
+
+		if (source_y < 0 || source_y >= height || count <= 0) {
+			for (int32 x = 0; x < width; ++x)
+				target[x] = background;
+			continue;
+		}
+
+		uint32* source = bits + source_y * bpr;
+		if (dx >= 0) {
+			memmove(target + dx, source, count * sizeof(uint32));
+			for (int32 x = 0; x < dx; ++x)
+				target[x] = background;
+		} else {
+			memmove(target, source - dx, count * sizeof(uint32));
+			for (int32 x = count; x < width; ++x)
+				target[x] = background;
+		}
+	}
+}
 
 
 Layer::Layer(
 	BRect frame, int32 id, ImageView* imageView, layer_type type, BBitmap* bitmap, BRect* offset)
 	:
 	fLayerData(NULL),
+	fOffset(B_ORIGIN),
 	fLayerPreview(NULL),
 	fLayerId(id),
 	fLayerPreviewSem(-1),
@@ -61,6 +100,7 @@ Layer::Layer(
 
 		if (!fLayerData->IsValid())
 			throw std::bad_alloc();
+		MemoryBudget::Track(fLayerData, fImageView, LAYER_MEMORY);
 
 		union color_conversion color;
 		color.word = 0x00000000;
@@ -85,6 +125,7 @@ Layer::Layer(
 		// create the miniature image for this layer and a semaphore for it
 		fLayerPreview = new BBitmap(
 			BRect(0, 0, HS_MINIATURE_IMAGE_WIDTH - 1, HS_MINIATURE_IMAGE_HEIGHT - 1), B_RGB_32_BIT);
+		MemoryBudget::Track(fLayerPreview, fImageView, PREVIEW_MEMORY);
 		fLayerPreviewSem = create_sem(1, "mini image semaphore");
 	}
 
@@ -98,8 +139,8 @@ Layer::~Layer()
 {
 	delete fLayerView;
 
-	delete fLayerData;
-	delete fLayerPreview;
+	MemoryBudget::DeleteBitmap(fLayerData);
+	MemoryBudget::DeleteBitmap(fLayerPreview);
 }
 
 
@@ -177,6 +218,8 @@ Layer::CreateMiniatureImage(void* data)
 int32
 Layer::calc_mini_image()
 {
+	TRACE_SCOPE("thumbnail", "layer miniature");
+
 	// This function might crash if it is executing while the layer is
 	// destroyed. This is because the bitmap and miniature image are destroyed.
 	// We need something to stop this thread when the layer is being destroyed.
@@ -194,12 +237,12 @@ Layer::calc_mini_image()
 	color2 = RGBColorToBGRA(rgb2);
 
 	if (SettingsServer* server = SettingsServer::Instance()) {
-		BMessage settings;
-		server->GetApplicationSettings(&settings);
-
-		gridSize = settings.GetInt32(skBgGridSize, gridSize);
-		color1 = settings.GetUInt32(skBgColor1, color1);
-		color2 = settings.GetUInt32(skBgColor2, color2);
+		render_settings settings;
+		if (server->GetRenderSettings(&settings) == B_OK) {
+			gridSize = settings.bg_grid_size;
+			color1 = settings.bg_color1;
+			color2 = settings.bg_color2;
+		}
 	}
 
 	gridSize = max_c(gridSize / 5, 4);
@@ -241,13 +284,23 @@ Layer::calc_mini_image()
 	// Clear the parts that we do not set.
 	small_image += HS_MINIATURE_IMAGE_WIDTH * y_offset;
 
+	// The miniature shows the bitmap's area of the canvas, so the layer's
+	// offset moves the contents within the miniature.
+	int32 offset_x = (int32)fOffset.x;
+	int32 offset_y = (int32)fOffset.y;
+	int32 b_right = fLayerData->Bounds().IntegerWidth();
+	int32 b_bottom = fLayerData->Bounds().IntegerHeight();
+
 	while ((y < miniature_height) && (fLayerPreviewThreads == 0)) {
 		small_image += x_offset_left;
 
+		int32 source_y = (int32)(y * dy) - offset_y;
 		while ((x < miniature_width) && (fLayerPreviewThreads == 0)) {
-			color.word = *(big_image + ((int32)(y * dy)) * b_bpr + (int32)(x * dx));
-
-			*small_image = src_over_fixed(*small_image, color.word);
+			int32 source_x = (int32)(x * dx) - offset_x;
+			if (source_x >= 0 && source_x <= b_right && source_y >= 0 && source_y <= b_bottom) {
+				color.word = *(big_image + source_y * b_bpr + source_x);
+				*small_image = src_over_fixed(*small_image, color.word);
+			}
 			small_image++;
 			x++;
 		}
@@ -280,8 +333,45 @@ Layer::calc_mini_image()
 void
 Layer::ChangeBitmap(BBitmap* newBitmap)
 {
-	delete fLayerData;
+	MemoryBudget::DeleteBitmap(fLayerData);
 	fLayerData = newBitmap;
+	MemoryBudget::Track(fLayerData, fImageView, LAYER_MEMORY);
+}
+
+
+void
+Layer::SetOffset(BPoint offset)
+{
+	fOffset.x = floor(offset.x);
+	fOffset.y = floor(offset.y);
+}
+
+
+BRect
+Layer::Frame() const
+{
+	BRect frame = fLayerData->Bounds();
+	frame.OffsetBy(fOffset);
+	return frame;
+}
+
+
+bool
+Layer::ApplyOffset()
+{
+	if (!HasOffset() || fLayerData == NULL)
+		return false;
+
+	union color_conversion background;
+	background.word = 0xFFFFFFFF;
+	background.bytes[3] = 0x00;
+
+	shift_bits((uint32*)fLayerData->Bits(), fLayerData->Bounds().IntegerWidth() + 1,
+		fLayerData->Bounds().IntegerHeight() + 1, fLayerData->BytesPerRow() / 4,
+		(int32)fOffset.x, (int32)fOffset.y, background.word);
+
+	fOffset = B_ORIGIN;
+	return true;
 }
 
 
@@ -618,7 +708,20 @@ Layer::writeLayer(BFile& file, int32 compression_method)
 	written_bytes += file.Write(&fLayerType, sizeof(int32));
 	written_bytes += file.Write(&visi, sizeof(int32));
 
-	int64 data_length = fLayerData->BitsLength();
+	// A pending offset is applied to a copy so that the file always
+	// contains the pixels at their canvas positions.
+	BBitmap* layer_data = fLayerData;
+	if (HasOffset()) {
+		layer_data = new BBitmap(fLayerData);
+		union color_conversion background;
+		background.word = 0xFFFFFFFF;
+		background.bytes[3] = 0x00;
+
+		shift_bits((uint32*)layer_data->Bits(), width, height, layer_data->BytesPerRow() / 4,
+			(int32)fOffset.x, (int32)fOffset.y, background.word);
+	}
+
+	int64 data_length = layer_data->BitsLength();
 	int z_result = Z_OK;
 
 	if (compression_method == ZLIB_COMPRESSION) {
@@ -628,7 +731,7 @@ Layer::writeLayer(BFile& file, int32 compression_method)
 		z_result = compress(
 			dataCompressed,
 			&dataLengthCompressedULong,
-			(uint8*)fLayerData->Bits(),
+			(uint8*)layer_data->Bits(),
 			static_cast<unsigned long>(data_length));
 
 		if (z_result == Z_OK) {
@@ -638,15 +741,18 @@ Layer::writeLayer(BFile& file, int32 compression_method)
 			written_bytes += file.Write(dataCompressed, dataLengthCompressed);
 		} else {
 			written_bytes += file.Write(&data_length, sizeof(int64));
-			written_bytes += file.Write(fLayerData->Bits(), data_length);
+			written_bytes += file.Write(layer_data->Bits(), data_length);
 		}
 
 		free(dataCompressed);
 	} else {
 		written_bytes += file.Write(&data_length, sizeof(int64));
-		written_bytes += file.Write(fLayerData->Bits(), data_length);
+		written_bytes += file.Write(layer_data->Bits(), data_length);
 	}
 
+	if (layer_data != fLayerData)
+		delete layer_data;
+
 	marker = PROJECT_FILE_LAYER_END_MARKER;
 	written_bytes += file.Write(&marker, sizeof(int32));
 
@@ -11,13 +11,14 @@
 
 #include <GraphicsDefs.h>
 #include <OS.h>
+#include <Point.h>
+#include <Rect.h>
 #include <String.h>
 #include <SupportDefs.h>
 
 
 class BBitmap;
 class BFile;
-class BRect;
 class BView;
 class Image;
 class ImageView;
@@ -79,6 +80,20 @@ public:
 									return fLayerPreview;
 								}
 			void				ChangeBitmap(BBitmap* new_bitmap);
+
+			// The offset tells where the top-left corner of the layer's
+			// bitmap lies on the canvas. Moving a layer only changes the
+			// offset, the pixels are moved when ApplyOffset is called.
+			BPoint				Offset() const { return fOffset; }
+			void				SetOffset(BPoint offset);
+			bool				HasOffset() const
+									{ return fOffset != B_ORIGIN; }
+			// This returns the bitmap's bounds in canvas coordinates.
+			BRect				Frame() const;
+			// This moves the bitmap data by the offset and resets the offset.
+			// Returns false if there was no offset to apply.
+			bool				ApplyOffset();
+
 			LayerView*			GetView() const {
 									return fLayerView;
 								}
@@ -136,6 +151,9 @@ private:
 			// this bitmap holds the actual image-data of this layer
 			BBitmap*			fLayerData;
 
+			// the position of fLayerData on the canvas, always integral
+			BPoint				fOffset;
+
 			// this bitmap holds the miniature image of layers visible area
 			BBitmap*			fLayerPreview;
 
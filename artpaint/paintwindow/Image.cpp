@@ -12,12 +12,15 @@
 
 
 #include "BitmapUtilities.h"
+#include "CompositeOperators.h"
 #include "ImageView.h"
 #include "Layer.h"
+#include "MemoryBudget.h"
 #include "PixelOperations.h"
 #include "ProjectFileFunctions.h"
 #include "Selection.h"
 #include "SettingsServer.h"
+#include "TraceRecorder.h"
 #include "UndoEvent.h"
 #include "UndoQueue.h"
 #include "UtilityClasses.h"
@@ -35,6 +38,7 @@
 #include <new>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 
@@ -43,10 +47,15 @@
 
 
 color_entry* Image::color_candidates = NULL;
+uint8 Image::dither_matrix[16 * 16];
 int32 Image::color_candidate_users = 0;
 rgb_color* Image::color_list = new rgb_color[256];
 
 
+// The dithered image is kept up to date in tiles of this size.
+const int32 kDitherTileSize = 64;
+
+
 Image::Image(ImageView* view, float width, float height, UndoQueue* q)
 {
 	image_view = view;
@@ -55,6 +64,7 @@ Image::Image(ImageView* view, float width, float height, UndoQueue* q)
 	next_layer_id = 0;
 	current_layer_index = 0;
 	thumbnail_image = new BBitmap(BRect(0, 0, 64, 64), B_RGB32);
+	MemoryBudget::Track(thumbnail_image, image_view, RENDER_MEMORY);
 	layer_list = new BList(10);
 	layer_id_list = NULL;
 
@@ -67,6 +77,9 @@ Image::Image(ImageView* view, float width, float height, UndoQueue* q)
 	dithered_users = new BList();
 
 	dithered_up_to_date = FALSE;
+	dither_dirty_tiles = NULL;
+	dither_tile_columns = 0;
+	dither_tile_rows = 0;
 
 	system_info info;
 	get_system_info(&info);
@@ -88,9 +101,10 @@ Image::~Image()
 	delete layer_list;
 
 	delete dithered_users;
-	delete dithered_image;
-	delete rendered_image;
-	delete thumbnail_image;
+	MemoryBudget::DeleteBitmap(dithered_image);
+	delete[] dither_dirty_tiles;
+	MemoryBudget::DeleteBitmap(rendered_image);
+	MemoryBudget::DeleteBitmap(thumbnail_image);
 }
 
 
@@ -109,6 +123,9 @@ Image::Render(BRect area, bool bg)
 	dithered_up_to_date = FALSE;
 	area = area & rendered_image->Bounds();
 
+	TRACE_SCOPE_PIXELS("render", "Render",
+		(int64)(area.IntegerWidth() + 1) * (area.IntegerHeight() + 1));
+
 	int32 number_of_threads = 1; // At least one thread
 
 	// Only start multiple threads if the area is big enough
@@ -117,6 +134,7 @@ Image::Render(BRect area, bool bg)
 
 	thread_id* threads = new thread_id[number_of_threads];
 
+	bigtime_t spawn_start = system_time();
 	int32 height = area.IntegerHeight() / number_of_threads + 1;
 	for (int32 i = 0; i < number_of_threads; i++) {
 		if (bg)
@@ -131,37 +149,18 @@ Image::Render(BRect area, bool bg)
 		rect.bottom = min_c(area.bottom, rect.top + height - 1);
 		send_data(threads[i], 0, &rect, sizeof(BRect));
 	}
+	TraceRecorder::Record("render", "spawn render threads", spawn_start, system_time());
 
 	for (int32 i = 0; i < number_of_threads; i++) {
 		int32 return_value;
 		wait_for_thread(threads[i], &return_value);
 	}
-	if (dithered_image != NULL) {
-		for (int32 i = 0; i < number_of_threads; i++) {
-			threads[i] = spawn_thread(enter_dither, "dither_thread", B_NORMAL_PRIORITY, this);
-			resume_thread(threads[i]);
-
-			BRect rect = area;
-			rect.top = min_c(area.bottom, area.top + i * height);
-			rect.bottom = min_c(area.bottom, rect.top + height - 1);
-
-			send_data(threads[i], 0, &rect, sizeof(BRect));
-		}
-
-		bool is_ready = TRUE;
-		for (int32 i = 0; i < number_of_threads; i++) {
-			int32 return_value;
-			wait_for_thread(threads[i], &return_value);
-			if (return_value != B_OK)
-				is_ready = FALSE;
-		}
-		if (is_ready == TRUE)
-			dithered_up_to_date = TRUE;
-		else
-			dithered_up_to_date = FALSE;
-	}
 	delete[] threads;
 
+	MarkDitherDirty(area);
+	if (dithered_image != NULL)
+		UpdateDitheredImage();
+
 	// finally call the function that creates the mini-pictures of layers
 	// and the rendered_image
 	CalculateThumbnails();
@@ -183,6 +182,10 @@ Image::RenderPreview(BRect area, int32 resolution)
 	area.right *= resolution;
 
 	area = area & rendered_image->Bounds();
+	MarkDitherDirty(area);
+
+	TRACE_SCOPE_PIXELS("render", "RenderPreview",
+		(int64)(area.IntegerWidth() + 1) * (area.IntegerHeight() + 1) / (resolution * resolution));
 
 	int32 number_of_threads = 1; // At least one thread
 
@@ -227,6 +230,11 @@ Image::RenderPreview(BRegion& region, int32 resolution)
 	// Start a thread for each rectangle in the region
 	int32 rect_count = region.CountRects();
 	if (rect_count > 0) {
+		TRACE_SCOPE("render", "RenderPreview");
+		dithered_up_to_date = FALSE;
+		for (int32 i = 0; i < rect_count; i++)
+			MarkDitherDirty(region.RectAt(i));
+
 		thread_id* threads = new thread_id[rect_count];
 
 		for (int32 i = 0; i < rect_count; i++) {
@@ -251,6 +259,7 @@ Image::MultiplyRenderedImagePixels(int32 blocksize)
 {
 	if (rendered_image != NULL) {
 		dithered_up_to_date = FALSE;
+		MarkDitherDirty(rendered_image->Bounds());
 		if (blocksize > 1) {
 			int32 height = rendered_image->Bounds().IntegerHeight();
 			int32 width = rendered_image->Bounds().IntegerWidth();
@@ -295,16 +304,20 @@ Image::SetImageSize()
 		if (rendered_image == NULL) {
 			// Here we create new composite picture.
 			rendered_image = new BBitmap(BRect(0, 0, image_width - 1, image_height - 1), B_RGBA32);
+			MemoryBudget::Track(rendered_image, image_view, RENDER_MEMORY);
 		} else if ((rendered_image->Bounds().Width() != (image_width - 1))
 			|| (rendered_image->Bounds().Height() != (image_height - 1))) {
 			// Here we change the bitmap for the composite picture. Also
 			// if the dithered picture is required we change that too.
-			delete rendered_image;
+			MemoryBudget::DeleteBitmap(rendered_image);
 			rendered_image = new BBitmap(BRect(0, 0, image_width - 1, image_height - 1), B_RGBA32);
+			MemoryBudget::Track(rendered_image, image_view, RENDER_MEMORY);
 			if (dithered_image != NULL) {
-				delete dithered_image;
+				MemoryBudget::DeleteBitmap(dithered_image);
 				dithered_image
 					= new BBitmap(BRect(0, 0, image_width - 1, image_height - 1), B_CMAP8);
+				MemoryBudget::Track(dithered_image, image_view, RENDER_MEMORY);
+				ResetDitherTiles();
 			}
 
 			if (rendered_image->IsValid() == FALSE) {
@@ -384,11 +397,12 @@ Image::AddLayer(BBitmap* bitmap, Layer* next_layer, bool add_to_front,
 		// if this is the first layer we should create the composite picture
 		if ((layer_list->CountItems() == 1) && (rendered_image == NULL)) {
 			rendered_image = new BBitmap(BRect(0, 0, image_width - 1, image_height - 1), B_RGBA32);
+			MemoryBudget::Track(rendered_image, image_view, RENDER_MEMORY);
 			if (rendered_image->IsValid() == FALSE) {
 				// If the creation of composite picture fails we should remove the newly added
 				// layer and inform the user that we cannot add a layer. The method that called
 				// this function will take care of informing the user.
-				delete rendered_image;
+				MemoryBudget::DeleteBitmap(rendered_image);
 				rendered_image = NULL;
 				layer_id_list[layer_id] = NULL;
 				layer_list->RemoveItem(new_layer);
@@ -487,6 +501,7 @@ bool
 Image::ClearCurrentLayer(rgb_color& c)
 {
 	Layer* cleared_layer = (Layer*)layer_list->ItemAt(current_layer_index);
+	ApplyLayerOffset(cleared_layer);
 	cleared_layer->Clear(c);
 
 	// Store the undo.
@@ -519,12 +534,87 @@ Image::ClearCurrentLayer(rgb_color& c)
 }
 
 
+bool
+Image::ApplyLayerOffset(Layer* offset_layer)
+{
+	// Bakes the virtual offset of the layer (or of all layers if offset_layer
+	// is NULL) into its pixels. The offset is recorded in the undo so that
+	// undoing restores both the pixels and the offset.
+	bool offset_applied = FALSE;
+	for (int32 i = 0; i < layer_list->CountItems(); i++) {
+		Layer* layer = (Layer*)layer_list->ItemAt(i);
+		if ((offset_layer == NULL || layer == offset_layer) && layer->HasOffset())
+			offset_applied = TRUE;
+	}
+	if (offset_applied == FALSE)
+		return FALSE;
+
+	UndoEvent* new_event
+		= undo_queue->AddUndoEvent(B_TRANSLATE("Apply layer offset"), ReturnThumbnailImage());
+	for (int32 i = 0; i < layer_list->CountItems(); i++) {
+		Layer* layer = (Layer*)layer_list->ItemAt(i);
+		UndoAction* new_action = NULL;
+		if ((offset_layer == NULL || layer == offset_layer) && layer->HasOffset()) {
+			BPoint old_offset = layer->Offset();
+			layer->ApplyOffset();
+			if (new_event != NULL) {
+				new_action = new UndoAction(
+					layer->Id(), CHANGE_LAYER_CONTENT_ACTION, layer->Bitmap()->Bounds());
+				new_action->SetOldLayerOffset(old_offset);
+			}
+			thread_id a_thread = spawn_thread(
+				Layer::CreateMiniatureImage, "create mini picture", B_LOW_PRIORITY, layer);
+			resume_thread(a_thread);
+		} else if (new_event != NULL)
+			new_action = new UndoAction(layer->Id());
+
+		if (new_action != NULL) {
+			new_event->AddAction(new_action);
+			new_action->StoreUndo(layer->Bitmap());
+		}
+	}
+
+	return TRUE;
+}
+
+
+void
+Image::StoreLayerOffsetUndo(Layer* offset_layer, BPoint old_offset)
+{
+	// Records an offset that has already been applied to the pixels of the
+	// layer, when the action that needed it did not store its own undo.
+	UndoEvent* new_event
+		= undo_queue->AddUndoEvent(B_TRANSLATE("Apply layer offset"), ReturnThumbnailImage());
+	if (new_event == NULL)
+		return;
+
+	for (int32 i = 0; i < layer_list->CountItems(); i++) {
+		Layer* layer = (Layer*)layer_list->ItemAt(i);
+		UndoAction* new_action;
+		if (layer == offset_layer) {
+			new_action = new UndoAction(
+				layer->Id(), CHANGE_LAYER_CONTENT_ACTION, layer->Bitmap()->Bounds());
+			new_action->SetOldLayerOffset(old_offset);
+		} else
+			new_action = new UndoAction(layer->Id());
+
+		new_event->AddAction(new_action);
+		new_action->StoreUndo(layer->Bitmap());
+	}
+}
+
+
 bool
 Image::DuplicateLayer(Layer* duplicated_layer, int32)
 {
 	if (duplicated_layer != NULL) {
 		BBitmap* new_bitmap = new BBitmap(duplicated_layer->Bitmap());
-		AddLayer(new_bitmap, duplicated_layer, TRUE, duplicated_layer->GetTransparency());
+		Layer* new_layer = AddLayer(
+			new_bitmap, duplicated_layer, TRUE, duplicated_layer->GetTransparency());
+		if (new_layer != NULL && duplicated_layer->HasOffset()) {
+			new_layer->SetOffset(duplicated_layer->Offset());
+			Render(new_layer->Frame() | duplicated_layer->Bitmap()->Bounds());
+		}
 
 		return TRUE;
 	}
@@ -548,6 +638,8 @@ Image::MergeLayers(Layer* merged_layer, int32, bool merge_with_upper)
 	}
 
 	if ((target != NULL) && (other != NULL)) {
+		ApplyLayerOffset(target);
+		ApplyLayerOffset(other);
 		target->Merge(other);
 
 		// Store the undo.
@@ -761,6 +853,11 @@ Image::UpdateImageStructure(UndoEvent* event)
 				// The bitmap has changed size
 				layer->ChangeBitmap(bitmap);
 			}
+			if (layer != NULL && actions[i]->ChangesLayerOffset() == TRUE) {
+				BRect old_frame = layer->Frame();
+				layer->SetOffset(actions[i]->SwapLayerOffset(layer->Offset()));
+				a_rect = a_rect | old_frame | layer->Frame();
+			}
 			if (layer != NULL) {
 				// This should be here in order to crete a miniature picture for
 				// each layer that changes.
@@ -787,8 +884,9 @@ Image::UpdateImageStructure(UndoEvent* event)
 				layer_id_list[layer_id]->SetTransparency(new_transparency);
 				layer_id_list[layer_id]->SetBlendMode(new_blend_mode);
 				layer_id_list[layer_id]->SetVisibility(new_visibility);
+				layer_id_list[layer_id]->SetOffset(layer_data->Offset());
 			}
-			delete bitmap;
+			MemoryBudget::DeleteBitmap(bitmap);
 		}
 		updated_rect.left = min_c(updated_rect.left, a_rect.left);
 		updated_rect.right = max_c(updated_rect.right, a_rect.right);
@@ -927,11 +1025,12 @@ Image::ReadLayers(BFile& file)
 			if ((layer_list->CountItems() == 1) && (rendered_image == NULL)) {
 				rendered_image
 					= new BBitmap(BRect(0, 0, image_width - 1, image_height - 1), B_RGBA32);
+				MemoryBudget::Track(rendered_image, image_view, RENDER_MEMORY);
 				if (rendered_image->IsValid() == FALSE) {
 					// If the creatioin of composite picture fails we should remove the newly added
 					// layer and inform the user that we cannot add a layer. The method that called
 					// this function will take care of informing the user.
-					delete rendered_image;
+					MemoryBudget::DeleteBitmap(rendered_image);
 					rendered_image = NULL;
 					layer_id_list[layer->Id()] = NULL;
 					layer_list->RemoveItem(layer);
@@ -1007,11 +1106,12 @@ Image::ReadLayersOldStyle(BFile& file, int32 count)
 			if ((layer_list->CountItems() == 1) && (rendered_image == NULL)) {
 				rendered_image
 					= new BBitmap(BRect(0, 0, image_width - 1, image_height - 1), B_RGBA32);
+				MemoryBudget::Track(rendered_image, image_view, RENDER_MEMORY);
 				if (rendered_image->IsValid() == FALSE) {
 					// If the creatioin of composite picture fails we should remove the newly added
 					// layer and inform the user that we cannot add a layer. The method that called
 					// this function will take care of informing the user.
-					delete rendered_image;
+					MemoryBudget::DeleteBitmap(rendered_image);
 					rendered_image = NULL;
 					layer_id_list[layer->Id()] = NULL;
 					layer_list->RemoveItem(layer);
@@ -1055,6 +1155,8 @@ Image::CalculateThumbnails()
 int32
 Image::calculate_thumbnail_image(void* data)
 {
+	TRACE_SCOPE("thumbnail", "image thumbnail");
+
 	Image* this_pointer = (Image*)data;
 
 	BBitmap* from = this_pointer->rendered_image;
@@ -1124,8 +1226,9 @@ Image::RegisterDitheredUser(void* user)
 {
 	if (dithered_users->CountItems() == 0) {
 		dithered_image = new BBitmap(BRect(0, 0, image_width - 1, image_height - 1), B_CMAP8);
+		MemoryBudget::Track(dithered_image, image_view, RENDER_MEMORY);
 		if (dithered_image->IsValid() == FALSE) {
-			delete dithered_image;
+			MemoryBudget::DeleteBitmap(dithered_image);
 			dithered_image = NULL;
 			return FALSE;
 		}
@@ -1139,7 +1242,8 @@ Image::RegisterDitheredUser(void* user)
 			resume_thread(candidate_creator_thread);
 		}
 
-		DoDither(dithered_image->Bounds());
+		ResetDitherTiles();
+		UpdateDitheredImage();
 	}
 
 	if (dithered_users->HasItem(user) == FALSE)
@@ -1155,8 +1259,10 @@ Image::UnregisterDitheredUser(void* user)
 	dithered_users->RemoveItem(user);
 
 	if (dithered_users->CountItems() == 0) {
-		delete dithered_image;
+		MemoryBudget::DeleteBitmap(dithered_image);
 		dithered_image = NULL;
+		delete[] dither_dirty_tiles;
+		dither_dirty_tiles = NULL;
 	}
 
 	return B_OK;
@@ -1174,7 +1280,7 @@ Image::candidate_creator(void*)
 			color_list[i] = map->color_list[i];
 		}
 
-		color_entry* candidates = new color_entry[2 * 32768];
+		color_entry* candidates = new color_entry[32768];
 		rgb_color* rgb_color_map = new rgb_color[32768];
 		for (int32 i = 0; i < 32768; i++) {
 			rgb_color_map[i].blue = (i & 0x1F) << 3;
@@ -1185,7 +1291,7 @@ Image::candidate_creator(void*)
 		for (int32 i = 0; i < 32768; i++) {
 			// Find the two closest color-indexes for the RGB15 color i.
 			uint8 c1 = 0, c2 = 0; // The color indexes
-			float p1, p2; // and their probabilities.
+			float p1; // and the probability of the first one.
 
 			int32 dist1 = 1000000;
 			int32 dist2 = 1000000;
@@ -1207,21 +1313,31 @@ Image::candidate_creator(void*)
 				}
 			}
 
-			// Here calculate the probabilities for the colors.
-			if (dist2 > 3 * dist1) {
+			// Here calculate the probability for the first color.
+			if (dist2 > 3 * dist1 || dist1 == 0)
 				p1 = 1.0;
-				p2 = 0.0;
-			} else {
-				p1 = 0.5 + (float)(dist1 - dist2) / (float)(3 * dist1) * 0.5;
-				p2 = 1.0 - p1;
-			}
+			else
+				p1 = 0.5 + (float)(dist2 - dist1) / (float)(3 * dist1) * 0.5;
 
-			candidates[2 * i].value = c1;
-			candidates[2 * i].probability = p1;
+			candidates[i].first = c1;
+			candidates[i].second = c2;
+			candidates[i].level = (uint16)(p1 * 256 + 0.5);
+		}
 
-			candidates[2 * i + 1].value = c2;
-			candidates[2 * i + 1].probability = p1 + p2;
+		// The 16x16 Bayer matrix. Each bit pair of the coordinates adds
+		// a level of the 2x2 matrix, the lowest bits being the most
+		// significant.
+		for (int32 y = 0; y < 16; y++) {
+			for (int32 x = 0; x < 16; x++) {
+				uint8 threshold = 0;
+				for (int32 bit = 0; bit < 4; bit++) {
+					int32 pair = ((((x ^ y) >> bit) & 1) << 1) | ((y >> bit) & 1);
+					threshold |= pair << (6 - 2 * bit);
+				}
+				dither_matrix[y * 16 + x] = threshold;
+			}
 		}
+
 		color_candidates = candidates;
 		delete[] rgb_color_map;
 	}
@@ -1258,6 +1374,31 @@ Image::enter_render_nobg(void* data)
 }
 
 
+// Mixes the rows of a layer over the rendered image. The operator is a
+// template parameter, so that it is inlined into the loop.
+template<class Operator>
+static void
+render_layer_rows(const uint32* s_bits, int32 srl, uint32* d_bits, int32 drl,
+	int32 width, int32 height, float transparency, Operator blend_op)
+{
+	// Alpha-value is presence of pixel, hence 0x00 is transparent and 0xff for alpha
+	// is fully visible.
+	for (int32 y = 0; y < height; ++y) {
+		for (int32 x = 0; x < width; ++x) {
+			union color_conversion src;
+			src.word = *s_bits++;
+			src.bytes[3] *= transparency;
+
+			*d_bits = blend_op(*d_bits, src.word);
+			++d_bits;
+		}
+
+		s_bits += srl - width;
+		d_bits += drl - width;
+	}
+}
+
+
 int32
 Image::DoRender(BRect area, bool bg)
 {
@@ -1268,20 +1409,17 @@ Image::DoRender(BRect area, bool bg)
 	// Ensure that bounds of rendered_image are not exceeded.
 	area = area & rendered_image->Bounds();
 
+	TRACE_SCOPE_PIXELS("render", "DoRender",
+		(int64)(area.IntegerWidth() + 1) * (area.IntegerHeight() + 1));
+
 	// these variables are for row-length of the bitmaps in uint32
 	// e.g how many 32-bit groups there are in a row
 	int32 srl;
 	int32 drl = rendered_image->BytesPerRow() / 4;
 
-	// these variables are for width and height of area
-	int32 width = area.IntegerWidth() + 1;
-	int32 height = area.IntegerHeight() + 1;
-
 	// these variables are for source and destination bitmaps' start-coordinates
 	int32 s_start_x, s_start_y;
 	int32 d_start_x, d_start_y;
-	d_start_x = (int32)area.left;
-	d_start_y = (int32)area.top;
 
 	// these are the pointers to source and destination bitmaps.
 	uint32* s_bits;
@@ -1305,13 +1443,15 @@ Image::DoRender(BRect area, bool bg)
 		color1 = RGBColorToBGRA(rgb1);
 		color2 = RGBColorToBGRA(rgb2);
 
+		// This is done for every band that is rendered, so only the small
+		// snapshot of the settings is copied.
 		if (SettingsServer* server = SettingsServer::Instance()) {
-			BMessage settings;
-			server->GetApplicationSettings(&settings);
-
-			gridSize = settings.GetInt32(skBgGridSize, gridSize);
-			color1 = settings.GetUInt32(skBgColor1, color1);
-			color2 = settings.GetUInt32(skBgColor2, color2);
+			render_settings settings;
+			if (server->GetRenderSettings(&settings) == B_OK) {
+				gridSize = settings.bg_grid_size;
+				color1 = settings.bg_color1;
+				color2 = settings.bg_color2;
+			}
 		}
 
 		BitmapUtilities::CheckerBitmap(rendered_image, color1, color2, gridSize, &area);
@@ -1327,38 +1467,34 @@ Image::DoRender(BRect area, bool bg)
 	while (layer_number < layer_count) {
 		layer = (Layer*)layer_list->ItemAt(layer_number);
 
-		if (layer->IsVisible()) {
+		// Only the part of the area that the layer covers needs to be mixed,
+		// elsewhere the layer is fully transparent.
+		BRect layer_area = area & layer->Frame();
+		if (layer->IsVisible() && layer_area.IsValid()) {
+			BPoint offset = layer->Offset();
+			int32 width = layer_area.IntegerWidth() + 1;
+			int32 height = layer_area.IntegerHeight() + 1;
+
 			srl = layer->Bitmap()->BytesPerRow() / 4;
-			s_start_x = d_start_x;
-			s_start_y = d_start_y;
+			s_start_x = (int32)(layer_area.left - offset.x);
+			s_start_y = (int32)(layer_area.top - offset.y);
+			d_start_x = (int32)layer_area.left;
+			d_start_y = (int32)layer_area.top;
 			s_bits = (uint32*)layer->Bitmap()->Bits();
 			d_bits = (uint32*)rendered_image->Bits();
-			uint32 s;
-			uint32 d;
-			uint32 target;
 
 			// adjust the pointers to correct starting-positions
 			s_bits += srl * s_start_y + s_start_x;
 			d_bits += drl * d_start_y + d_start_x;
 
-			// Alpha-value is presence of pixel, hence 0x00 is transparent and 0xff for alpha
-			// is fully visible.
-			for (int32 y = 0; y < height; ++y) {
-				for (int32 x = 0; x < width; ++x) {
-					s = *s_bits;
-					d = *d_bits;
-
-					union color_conversion src;
-					src.word = s;
-					src.bytes[3] *= layer->GetTransparency();
-
-					target = src_over_fixed_blend(d, src.word, layer->GetBlendMode());
-					*d_bits++ = target;
-					++s_bits;
-				}
-
-				s_bits += srl - width;
-				d_bits += drl - width;
+			float transparency = layer->GetTransparency();
+			uint32 mode = layer->GetBlendMode();
+			if (mode == BLEND_NORMAL) {
+				render_layer_rows(s_bits, srl, d_bits, drl, width, height,
+					transparency, normal_blend_operator());
+			} else {
+				render_layer_rows(s_bits, srl, d_bits, drl, width, height,
+					transparency, blend_operator(mode));
 			}
 		}
 		layer_number++;
@@ -1368,6 +1504,97 @@ Image::DoRender(BRect area, bool bg)
 }
 
 
+void
+Image::ResetDitherTiles()
+{
+	delete[] dither_dirty_tiles;
+
+	dither_tile_columns = ((int32)image_width + kDitherTileSize - 1) / kDitherTileSize;
+	dither_tile_rows = ((int32)image_height + kDitherTileSize - 1) / kDitherTileSize;
+	dither_dirty_tiles = new uint8[dither_tile_columns * dither_tile_rows];
+	memset(dither_dirty_tiles, 1, dither_tile_columns * dither_tile_rows);
+
+	dithered_up_to_date = FALSE;
+}
+
+
+void
+Image::MarkDitherDirty(BRect area)
+{
+	if (dither_dirty_tiles == NULL)
+		return;
+
+	area = area & BRect(0, 0, image_width - 1, image_height - 1);
+	if (area.IsValid() == FALSE)
+		return;
+
+	int32 left = (int32)area.left / kDitherTileSize;
+	int32 right = (int32)area.right / kDitherTileSize;
+	int32 top = (int32)area.top / kDitherTileSize;
+	int32 bottom = (int32)area.bottom / kDitherTileSize;
+	for (int32 row = top; row <= bottom; row++) {
+		memset(dither_dirty_tiles + row * dither_tile_columns + left, 1,
+			right - left + 1);
+	}
+}
+
+
+void
+Image::UpdateDitheredImage()
+{
+	if (dithered_image == NULL || dither_dirty_tiles == NULL)
+		return;
+
+	// Only the rows of tiles between the first and the last dirty ones
+	// are given to the threads.
+	int32 first_row = -1;
+	int32 last_row = -1;
+	for (int32 row = 0; row < dither_tile_rows; row++) {
+		uint8* tiles = dither_dirty_tiles + row * dither_tile_columns;
+		if (memchr(tiles, 1, dither_tile_columns) != NULL) {
+			if (first_row < 0)
+				first_row = row;
+			last_row = row;
+		}
+	}
+	if (first_row < 0) {
+		dithered_up_to_date = TRUE;
+		return;
+	}
+
+	TRACE_SCOPE("dither", "UpdateDitheredImage");
+
+	int32 row_count = last_row - first_row + 1;
+	int32 number_of_threads = max_c(min_c(number_of_cpus, row_count), 1);
+	thread_id* threads = new thread_id[number_of_threads];
+
+	// The threads get whole rows of tiles, so that they never touch the
+	// same tiles.
+	for (int32 i = 0; i < number_of_threads; i++) {
+		threads[i] = spawn_thread(enter_dither, "dither_thread", B_NORMAL_PRIORITY, this);
+		resume_thread(threads[i]);
+
+		BRect rect = dithered_image->Bounds();
+		rect.top = (first_row + row_count * i / number_of_threads) * kDitherTileSize;
+		rect.bottom
+			= (first_row + row_count * (i + 1) / number_of_threads) * kDitherTileSize - 1;
+
+		send_data(threads[i], 0, &rect, sizeof(BRect));
+	}
+
+	bool is_ready = TRUE;
+	for (int32 i = 0; i < number_of_threads; i++) {
+		int32 return_value;
+		wait_for_thread(threads[i], &return_value);
+		if (return_value != B_OK)
+			is_ready = FALSE;
+	}
+	delete[] threads;
+
+	dithered_up_to_date = is_ready;
+}
+
+
 int32
 Image::enter_dither(void* data)
 {
@@ -1385,57 +1612,69 @@ Image::enter_dither(void* data)
 int32
 Image::DoDither(BRect area)
 {
-	// Here we try to dither with the N-candidate method.
-	// The candidates for a color are in the array color_candidates.
-	// each color has four entries of struct candidate. We take a
-	// random number which decides which of those four entries to use.
-
-	if (color_candidates != NULL) {
-		if (dithered_image != NULL) {
-			area = area & dithered_image->Bounds();
-			if (area.IsValid() == TRUE) {
-				uint8* dithered_bits = (uint8*)dithered_image->Bits();
-				uint32 dithered_bpr = dithered_image->BytesPerRow();
-
-				uint32* bgra_bits = (uint32*)rendered_image->Bits();
-				uint32 bgra_bpr = rendered_image->BytesPerRow() / 4;
-
-				int32 left = (int32)area.left;
-				int32 right = (int32)area.right;
-				int32 top = (int32)area.top;
-				int32 bottom = (int32)area.bottom;
-
-				float one_per_1024 = 1.0 / 1024;
-
-				union {
-					uint8 bytes[4];
-					uint32 word;
-				} color;
-
-				for (int32 y = top; y <= bottom; y++) {
-					for (int32 x = left; x <= right; x++) {
-						float random_number = (rand() % 1024) * one_per_1024;
-
-						color.word = *(bgra_bits + x + y * bgra_bpr);
-
-						int32 rgb15
-							= (((color.bytes[2] & 0xf8) << 7)
-							| ((color.bytes[1] & 0xf8) << 2)
-							| ((color.bytes[0] & 0xf8) >> 3));
-						int8 value;
-						if (color_candidates[2 * rgb15].probability < random_number)
-							value = color_candidates[2 * rgb15].value;
-						else
-							value = color_candidates[2 * rgb15 + 1].value;
-
-						*(dithered_bits + x + y * dithered_bpr) = value;
-					}
+	// Here we dither the dirty tiles that are inside the area with an
+	// ordered dither. Each 15-bit color has two candidates in the array
+	// color_candidates, and the threshold of the dither matrix at the pixel
+	// decides which one of them is used. The result only depends on the
+	// position of the pixel, not on the order in which the tiles are done.
+
+	if (color_candidates == NULL || dithered_image == NULL)
+		return B_ERROR;
+
+	TRACE_SCOPE("dither", "DoDither");
+
+	uint8* dithered_bits = (uint8*)dithered_image->Bits();
+	uint32 dithered_bpr = dithered_image->BytesPerRow();
+
+	uint32* bgra_bits = (uint32*)rendered_image->Bits();
+	uint32 bgra_bpr = rendered_image->BytesPerRow() / 4;
+
+	BRect bounds = dithered_image->Bounds() & rendered_image->Bounds();
+	area = area & bounds;
+	if (area.IsValid() == FALSE)
+		return B_OK;
+
+	int32 first_row = (int32)area.top / kDitherTileSize;
+	int32 last_row = (int32)area.bottom / kDitherTileSize;
+	int32 first_column = (int32)area.left / kDitherTileSize;
+	int32 last_column = (int32)area.right / kDitherTileSize;
+
+	for (int32 row = first_row; row <= last_row; row++) {
+		for (int32 column = first_column; column <= last_column; column++) {
+			uint8* dirty = dither_dirty_tiles + row * dither_tile_columns + column;
+			if (*dirty == 0)
+				continue;
+
+			*dirty = 0;
+
+			int32 left = column * kDitherTileSize;
+			int32 top = row * kDitherTileSize;
+			int32 right = min_c(left + kDitherTileSize - 1, (int32)bounds.right);
+			int32 bottom = min_c(top + kDitherTileSize - 1, (int32)bounds.bottom);
+
+			for (int32 y = top; y <= bottom; y++) {
+				const uint32* source = bgra_bits + y * bgra_bpr;
+				uint8* target = dithered_bits + y * dithered_bpr;
+				const uint8* thresholds = dither_matrix + (y & 15) * 16;
+
+				// No branches in this loop, so that the compiler can
+				// vectorize the index calculation and the selection.
+				for (int32 x = left; x <= right; x++) {
+					union color_conversion color;
+					color.word = source[x];
+					int32 rgb15
+						= (((color.bytes[2] & 0xf8) << 7)
+						| ((color.bytes[1] & 0xf8) << 2)
+						| ((color.bytes[0] & 0xf8) >> 3));
+					color_entry entry = color_candidates[rgb15];
+					target[x] = (thresholds[x & 15] < entry.level)
+						? entry.first : entry.second;
 				}
 			}
 		}
-		return B_OK;
-	} else
-		return B_ERROR;
+	}
+
+	return B_OK;
 }
 
 
@@ -1456,21 +1695,25 @@ Image::enter_render_preview(void* data)
 int32
 Image::DoRenderPreview(BRect area, int32 resolution)
 {
+	TRACE_SCOPE("render", "DoRenderPreview");
+
 	if (layer_list->CountItems() >= 1) {
 		// We take pointers to bitmaps of all visible layers.
 		uint32** layer_bits = new uint32*[layer_list->CountItems()];
 		uint32* layer_bprs = new uint32[layer_list->CountItems()];
 		float* alpha = new float[layer_list->CountItems()];
 		uint8* blend = new uint8[layer_list->CountItems()];
+		BRect* frames = new BRect[layer_list->CountItems()];
 
 		int32 visible_layer_count = 0;
 		for (int32 i = 0; i < layer_list->CountItems(); i++) {
 			Layer* layer = (Layer*)layer_list->ItemAt(i);
-			if (layer->IsVisible() == TRUE) {
+			if (layer->IsVisible() == TRUE && layer->Frame().Intersects(area)) {
 				layer_bits[visible_layer_count] = (uint32*)layer->Bitmap()->Bits();
 				layer_bprs[visible_layer_count] = layer->Bitmap()->BytesPerRow() / 4;
 				alpha[visible_layer_count] = layer->GetTransparency();
 				blend[visible_layer_count] = layer->GetBlendMode();
+				frames[visible_layer_count] = layer->Frame();
 				visible_layer_count++;
 			}
 		}
@@ -1498,7 +1741,13 @@ Image::DoRenderPreview(BRect area, int32 resolution)
 				// Get the target value by combining the layers' pixels
 				uint32 target = *(composite_bits + x + y * composite_bpr);
 				for (int32 j = 0; j < visible_layer_count; j++) {
-					uint32 layer = layer_bits[j][x + y * layer_bprs[j]];
+					if (x < frames[j].left || x > frames[j].right
+						|| y < frames[j].top || y > frames[j].bottom)
+						continue;
+
+					int32 layer_x = x - (int32)frames[j].left;
+					int32 layer_y = y - (int32)frames[j].top;
+					uint32 layer = layer_bits[j][layer_x + layer_y * layer_bprs[j]];
 
 					union color_conversion src;
 					src.word = layer;
@@ -1519,6 +1768,7 @@ Image::DoRenderPreview(BRect area, int32 resolution)
 		for (int32 i = 0; i < visible_layer_count; i++)
 			layer_bits[i] = NULL;
 
+		delete[] frames;
 		delete[] blend;
 		delete[] alpha;
 		delete[] layer_bits;
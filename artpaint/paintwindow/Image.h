@@ -25,9 +25,13 @@ class UndoEvent;
 class UndoQueue;
 
 
+// The two screen colors that are mixed for one 15-bit color. The first
+// one is used where the threshold of the dither matrix is below the level,
+// so the level is its share of the pixels in 256ths.
 struct color_entry {
-	float	probability;
-	int8	value;
+	uint8	first;
+	uint8	second;
+	uint16	level;
 };
 
 
@@ -56,6 +60,12 @@ class Image {
 
 			bool		dithered_up_to_date;
 
+			// One flag for each tile of the dithered image whose rendered
+			// pixels have changed since it was dithered.
+			uint8*		dither_dirty_tiles;
+			int32		dither_tile_columns;
+			int32		dither_tile_rows;
+
 			// these are the real width and height of canvas in pixels
 			float		image_width;
 			float 		image_height;
@@ -72,10 +82,14 @@ class Image {
 
 	static	rgb_color*	color_list;
 	static	color_entry* color_candidates;
+	static	uint8		dither_matrix[16 * 16];
 	static	int32		color_candidate_users;
 
 			int32		number_of_cpus;
 
+			void		ResetDitherTiles();
+			void		MarkDitherDirty(BRect);
+			void		UpdateDitheredImage();
 	static	int32		enter_dither(void*);
 			int32		DoDither(BRect);
 
@@ -108,6 +122,8 @@ public:
 			bool		ChangeLayerPosition(Layer*, int32, int32);
 			bool		ClearCurrentLayer(rgb_color&);
 			bool		ClearLayers(rgb_color&);
+			bool		ApplyLayerOffset(Layer* layer = NULL);
+			void		StoreLayerOffsetUndo(Layer* layer, BPoint old_offset);
 			bool		DuplicateLayer(Layer*, int32);
 			bool		MergeLayers(Layer*, int32, bool merge_with_upper);
 			bool		RemoveLayer(Layer*, int32);
@@ -11,6 +11,7 @@
 
 #include "ImageUpdater.h"
 #include "ImageView.h"
+#include "TraceRecorder.h"
 
 
 #include <Window.h>
@@ -65,9 +66,12 @@ ImageUpdater::AddRect(const BRect& rect)
 void
 ImageUpdater::ForceUpdate()
 {
+	bigtime_t wait_start = system_time();
 	EnterCriticalSection();
+	TraceRecorder::Record("update", "ImageUpdater wait", wait_start, system_time());
 
 	if (fUpdatedRect.IsValid()) {
+		TRACE_SCOPE("update", "ImageUpdater update");
 		if (fImageView->LockLooper()) {
 			fUpdatedRect.left = floor(fUpdatedRect.left);
 			fUpdatedRect.top = floor(fUpdatedRect.top);
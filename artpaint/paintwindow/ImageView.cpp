@@ -20,6 +20,7 @@
 #include "Manipulator.h"
 #include "ManipulatorServer.h"
 #include "ManipulatorWindow.h"
+#include "MemoryBudget.h"
 #include "MessageConstants.h"
 #include "PaintApplication.h"
 #include "PaintWindow.h"
@@ -29,15 +30,19 @@
 #include "SettingsServer.h"
 #include "StatusBarGUIManipulator.h"
 #include "StatusView.h"
+#include "StrokeReplay.h"
 #include "TextManipulator.h"
 #include "ToolManager.h"
 #include "Tools.h"
+#include "TraceRecorder.h"
+#include "TranslationManipulator.h"
 #include "UndoQueue.h"
 #include "UtilityClasses.h"
 #include "WindowGUIManipulator.h"
 
 
 #include <Alert.h>
+#include <Beep.h>
 #include <Catalog.h>
 #include <ClassInfo.h>
 #include <Clipboard.h>
@@ -45,6 +50,8 @@
 #include <MenuBar.h>
 #include <MenuItem.h>
 #include <Message.h>
+#include <MessageRunner.h>
+#include <Messenger.h>
 #include <Polygon.h>
 #include <PopUpMenu.h>
 #include <Screen.h>
@@ -56,6 +63,7 @@
 
 
 #include <new>
+#include <string.h>
 #include <iostream>
 
 
@@ -63,6 +71,38 @@
 #define B_TRANSLATION_CONTEXT "ImageView"
 
 
+// The state of a manipulator that is applied to a snapshot of a single layer
+// in the background. The job is created and committed in the window thread,
+// only the ManipulateBitmap call runs in the background thread.
+struct background_finisher_job {
+	thread_id				thread;
+	Manipulator*			manipulator;
+	ManipulatorSettings*	settings;
+	int32					layer_id;
+	int32					manip_type;
+	int32					add_on_id;
+	BBitmap*				source;
+	BBitmap*				result;
+	Selection*				selection;
+	BStatusBar*				status_bar;
+	BList					postponed_messages;
+	bool					started;
+	bool					failed;
+};
+
+
+static bool
+is_selection_manipulator(Manipulator* manipulator)
+{
+	BString manipName = manipulator->ReturnName();
+	return manipName == B_TRANSLATE("Translate selection")
+		|| manipName == B_TRANSLATE("Rotate selection")
+		|| manipName == B_TRANSLATE("Scale selection")
+		|| manipName == B_TRANSLATE("Flip selection horizontally")
+		|| manipName == B_TRANSLATE("Flip selection vertically");
+}
+
+
 ImageView::ImageView(BRect frame, float width, float height)
 	:
 	BView(frame, "image_view", B_FOLLOW_NONE, B_WILL_DRAW)
@@ -90,6 +130,7 @@ ImageView::ImageView(BRect frame, float width, float height)
 	fManipulator = NULL;
 	manipulator_window = NULL;
 	manipulator_finishing_message = NULL;
+	fBackgroundJob = NULL;
 
 	// Create an empty selection.
 	selection = new Selection(BRect(0, 0, width - 1, height - 1));
@@ -146,6 +187,11 @@ ImageView::~ImageView()
 {
 	// Here we free all allocated memory.
 
+	// A manipulator that is still running in the background must be finished
+	// before the image goes away.
+	if (fBackgroundJob != NULL)
+		CommitBackgroundFinisher(true);
+
 	// Delete the view manipulator and close it's possible window.
 	if (manipulator_window != NULL) {
 		manipulator_window->Lock();
@@ -172,6 +218,8 @@ ImageView::~ImageView()
 	delete_sem(action_semaphore);
 
 	delete background;
+
+	MemoryBudget::RemoveDocument(this);
 }
 
 
@@ -198,6 +246,23 @@ ImageView::AttachedToWindow()
 	SetEventMask(B_KEYBOARD_EVENTS);
 
 	MakeBackground();
+
+	if (SettingsServer* server = SettingsServer::Instance())
+		server->StartWatchingRenderSettings(BMessenger(this));
+}
+
+
+void
+ImageView::DetachedFromWindow()
+{
+	// The result goes to the image while the window is still there.
+	if (fBackgroundJob != NULL)
+		CommitBackgroundFinisher(true);
+
+	if (SettingsServer* server = SettingsServer::Instance())
+		server->StopWatchingRenderSettings(BMessenger(this));
+
+	BView::DetachedFromWindow();
 }
 
 
@@ -217,12 +282,12 @@ ImageView::MakeBackground()
 	color2 = RGBColorToBGRA(rgb2);
 
 	if (SettingsServer* server = SettingsServer::Instance()) {
-		BMessage settings;
-		server->GetApplicationSettings(&settings);
-
-		gridSize = settings.GetInt32(skBgGridSize, gridSize);
-		color1 = settings.GetUInt32(skBgColor1, color1);
-		color2 = settings.GetUInt32(skBgColor2, color2);
+		render_settings settings;
+		if (server->GetRenderSettings(&settings) == B_OK) {
+			gridSize = settings.bg_grid_size;
+			color1 = settings.bg_color1;
+			color2 = settings.bg_color2;
+		}
 	}
 
 	if (background != NULL)
@@ -309,7 +374,14 @@ ImageView::UpdateImage(BRect bitmap_rect)
 {
 	bitmap_rect = bitmap_rect & the_image->ReturnRenderedImage()->Bounds();
 	if (bitmap_rect.IsValid()) {
+		bigtime_t start = system_time();
 		the_image->Render(bitmap_rect);
+		if (TraceRecorder::IsEnabled()) {
+			((PaintWindow*)Window())->ReturnStatusView()->AddRenderedFrame(
+				system_time() - start,
+				(int64)(bitmap_rect.IntegerWidth() + 1) * (bitmap_rect.IntegerHeight() + 1),
+				this);
+		}
 		Invalidate(convertBitmapRectToView(bitmap_rect));
 	}
 }
@@ -419,6 +491,21 @@ ImageView::MessageReceived(BMessage* message)
 
 	// here check what the message is all about and initiate proper action
 	switch (message->what) {
+		case HS_RENDER_SETTINGS_CHANGED:
+		{
+			// Several settings are often changed at once, only the last
+			// change needs to be rendered.
+			int32 version;
+			render_settings settings;
+			if (message->FindInt32("version", &version) == B_OK
+				&& SettingsServer::Instance()->GetRenderSettings(&settings) == B_OK
+				&& version < settings.version)
+				break;
+
+			MakeBackground();
+			the_image->Render();
+			Invalidate();
+		} break;
 		case B_MOUSE_WHEEL_CHANGED:
 		{
 			float delta;
@@ -850,6 +937,7 @@ ImageView::MessageReceived(BMessage* message)
 		case HS_SELECT_LAYER_PIXELS:
 		{
 			if (!fManipulator) {
+				the_image->ApplyLayerOffset(the_image->ReturnActiveLayer());
 				BBitmap* layerBitmap = the_image->ReturnActiveBitmap();
 				BBitmap* selection_map = BitmapUtilities::ConvertToMask(layerBitmap, 0xFF);
 				selection->AddSelection(selection_map, true);
@@ -874,7 +962,10 @@ ImageView::MessageReceived(BMessage* message)
 		case HS_GROW_SELECTION:
 		{
 			if (!fManipulator) {
-				selection->Dilate();
+				int32 radius;
+				if (message->FindInt32("radius", &radius) != B_OK)
+					radius = 1;
+				selection->Dilate(radius);
 				if (!(undo_queue->ReturnSelectionMap() == selection->ReturnSelectionMap())) {
 					UndoEvent* new_event =
 						undo_queue->AddUndoEvent(B_TRANSLATE("Grow selection"),
@@ -890,7 +981,10 @@ ImageView::MessageReceived(BMessage* message)
 		case HS_SHRINK_SELECTION:
 		{
 			if (!fManipulator) {
-				selection->Erode();
+				int32 radius;
+				if (message->FindInt32("radius", &radius) != B_OK)
+					radius = 1;
+				selection->Erode(radius);
 				if (!(undo_queue->ReturnSelectionMap() == selection->ReturnSelectionMap())) {
 					UndoEvent* new_event =
 						undo_queue->AddUndoEvent(B_TRANSLATE("Shrink selection"),
@@ -903,6 +997,23 @@ ImageView::MessageReceived(BMessage* message)
 				Invalidate();
 			}
 		} break;
+		case HS_FEATHER_SELECTION:
+		{
+			int32 radius;
+			if (!fManipulator && message->FindInt32("radius", &radius) == B_OK) {
+				selection->Feather(radius);
+				if (!(undo_queue->ReturnSelectionMap() == selection->ReturnSelectionMap())) {
+					UndoEvent* new_event =
+						undo_queue->AddUndoEvent(B_TRANSLATE("Feather selection"),
+							the_image->ReturnThumbnailImage());
+					if (new_event != NULL) {
+						new_event->SetSelectionMap(undo_queue->ReturnSelectionMap());
+						undo_queue->SetSelectionMap(selection->ReturnSelectionMap());
+					}
+				}
+				Invalidate();
+			}
+		} break;
 		case HS_HIDE_SELECTION_BORDERS:
 		{
 			BMenuItem* showBorders = Window()->KeyMenuBar()->FindItem(HS_HIDE_SELECTION_BORDERS);
@@ -922,6 +1033,9 @@ ImageView::MessageReceived(BMessage* message)
 		// recalculate the composite picture and redisplay the image.
 		case HS_EDIT_DELETE:
 		{
+			if (PostponeMessageAndFinishManipulator())
+				break;
+
 			if (acquire_sem_etc(action_semaphore, 1, B_TIMEOUT, 0) == B_OK) {
 				rgb_color c = BGRAColorToRGB(0);
 				if (the_image->ClearCurrentLayer(c) == TRUE) {
@@ -947,17 +1061,13 @@ ImageView::MessageReceived(BMessage* message)
 		} break;
 		case HS_UNDO:
 		{
-			if (!fManipulator)
+			if (!PostponeMessageAndFinishManipulator())
 				Undo();
-			else
-				PostponeMessageAndFinishManipulator();
 		} break;
 		case HS_REDO:
 		{
-			if (!fManipulator)
+			if (!PostponeMessageAndFinishManipulator())
 				Redo();
-			else
-				PostponeMessageAndFinishManipulator();
 		} break;
 		case HS_START_MANIPULATOR:
 		{
@@ -967,7 +1077,7 @@ ImageView::MessageReceived(BMessage* message)
 			if (message->FindInt32("manipulator_type", &manip_type) != B_OK)
 				break;
 
-			message->FindInt32("image_id", &add_on_id);
+			message->FindInt32("add_on_id", &add_on_id);
 			try {
 				ManipulatorServer* server = ManipulatorServer::Instance();
 				if (!server)
@@ -981,19 +1091,34 @@ ImageView::MessageReceived(BMessage* message)
 					if (adapter != NULL)
 						adapter->SetImage(the_image);
 
+					// Translating whole layers only moves their offsets, every
+					// other manipulator needs the offsets applied to the pixels.
+					TranslationManipulator* translation_manipulator
+						= dynamic_cast<TranslationManipulator*>(fManipulator);
+					if (translation_manipulator == NULL || selection->IsEmpty() == false) {
+						if (manipulated_layers == HS_MANIPULATE_CURRENT_LAYER)
+							the_image->ApplyLayerOffset(the_image->ReturnActiveLayer());
+						else
+							the_image->ApplyLayerOffset();
+					}
+
 					SetCursor();
 					// If the manipulator is not a GUIManipulator we put it to finish its
 					// business. If the manipulator is actually a GUIManipulator we give the
 					// correct preview-bitmap to the manipulator and set up its GUI.
 					if (gui_manipulator == NULL) {
 						fManipulator->SetSelection(selection);
-						start_thread(MANIPULATOR_FINISHER_THREAD);
-						AddChange();
+						if (StartBackgroundFinisher() == false) {
+							start_thread(MANIPULATOR_FINISHER_THREAD);
+							AddChange();
+						}
 					} else {
 						// The order is important, first set the preview-bitmap
 						// and only after that open the GUI for the manipulator.
 						if (manipulated_layers == HS_MANIPULATE_CURRENT_LAYER) {
 							gui_manipulator->SetPreviewBitmap(the_image->ReturnActiveBitmap());
+							if (translation_manipulator != NULL)
+								translation_manipulator->SetLayer(the_image->ReturnActiveLayer());
 						} else
 							gui_manipulator->SetPreviewBitmap(the_image->ReturnRenderedImage());
 
@@ -1066,11 +1191,15 @@ ImageView::MessageReceived(BMessage* message)
 				}
 
 				if (finish_status) {
-					start_thread(MANIPULATOR_FINISHER_THREAD);
-					AddChange();
+					if (StartBackgroundFinisher() == false) {
+						start_thread(MANIPULATOR_FINISHER_THREAD);
+						AddChange();
+					}
 				} else {
 					// The manipulator should be instructed to restore
 					// whatever changes it has made and should be quit then.
+					// A preview that is still being calculated is not needed.
+					guiManipulator->CancelProcessing();
 					guiManipulator->Reset();
 					((PaintWindow*)Window())->ReturnStatusView()->DisplayToolsAndColors();
 					delete fManipulator;
@@ -1096,6 +1225,19 @@ ImageView::MessageReceived(BMessage* message)
 				continue_manipulator_updating = true;
 			start_thread(MANIPULATOR_UPDATER_THREAD);
 		} break;
+		case HS_BACKGROUND_FINISHER_STARTED:
+		{
+			// The preview has been removed from the layer and the snapshot
+			// has been taken, so the other layers can be manipulated.
+			if (fBackgroundJob != NULL)
+				fBackgroundJob->started = true;
+			Invalidate();
+		} break;
+		case HS_BACKGROUND_FINISHER_DONE:
+		{
+			if (fBackgroundJob != NULL)
+				CommitBackgroundFinisher(false);
+		} break;
 		default:
 			BView::MessageReceived(message);
 	}
@@ -1347,6 +1489,11 @@ ImageView::DrawBrush(BPoint where)
 bool
 ImageView::Quit()
 {
+	// The manipulator that runs in the background is finished first, so
+	// that its change is counted when asking to save the project.
+	if (fBackgroundJob != NULL)
+		CommitBackgroundFinisher(true);
+
 	int32 mode = B_CONTROL_ON;
 	if (SettingsServer* server = SettingsServer::Instance()) {
 		BMessage settings;
@@ -1396,6 +1543,14 @@ ImageView::Quit()
 status_t
 ImageView::Freeze()
 {
+	// The image is saved with the result of the manipulator that might still
+	// be running in the background.
+	if (LockLooper() == true) {
+		if (fBackgroundJob != NULL)
+			CommitBackgroundFinisher(true);
+		UnlockLooper();
+	}
+
 	if (acquire_sem(mouse_mutex) == B_OK) {
 		if (acquire_sem(action_semaphore) == B_OK)
 			return B_OK;
@@ -1577,6 +1732,9 @@ ImageView::ActiveLayerChanged()
 	if ((gui_manipulator != NULL) && (manipulated_layers == HS_MANIPULATE_CURRENT_LAYER)) {
 		gui_manipulator->Reset();
 		gui_manipulator->SetPreviewBitmap(the_image->ReturnActiveBitmap());
+		if (TranslationManipulator* translation_manipulator
+			= dynamic_cast<TranslationManipulator*>(gui_manipulator))
+			translation_manipulator->SetLayer(the_image->ReturnActiveLayer());
 
 		// We should also tell the manipulator to recalculate its preview.
 		// This can be best achieved by sending a HS_MANIPULATOR_ADJUSTING_FINISHED
@@ -1743,6 +1901,27 @@ ImageView::PaintToolThread()
 	if (modifiers() & B_CONTROL_KEY)
 		tool_type = COLOR_SELECTOR_TOOL;
 
+	// The layer that a manipulator is processing in the background cannot be
+	// drawn to until the result has been committed.
+	if (fBackgroundJob != NULL && tool_type != NO_TOOL
+		&& tool_type != SELECTOR_TOOL && tool_type != COLOR_SELECTOR_TOOL
+		&& the_image->ReturnActiveLayer()->Id() == fBackgroundJob->layer_id) {
+		beep();
+		return B_ERROR;
+	}
+
+	// The tools work in canvas coordinates, so the pixels of the active layer
+	// must be where they are shown. The drawing tools store the offset in
+	// their own undo action, the others get an undo step for it.
+	Layer* active_layer = the_image->ReturnActiveLayer();
+	BPoint old_offset = active_layer->Offset();
+	bool offset_applied = FALSE;
+	if (tool_type == TEXT_TOOL || tool_type == SELECTOR_TOOL
+		|| tool_type == COLOR_SELECTOR_TOOL)
+		the_image->ApplyLayerOffset(active_layer);
+	else if (tool_type != NO_TOOL)
+		offset_applied = active_layer->ApplyOffset();
+
 	if (tool_type != TEXT_TOOL) {
 		if (tool_type != NO_TOOL) {
 			// When this function returns the tool has finished. This function
@@ -1750,6 +1929,7 @@ ImageView::PaintToolThread()
 			// which case for example a double-click might make it return).
 			ToolScript* script
 				= ToolManager::Instance().StartTool(this, buttons, point, view_point, tool_type);
+			StrokeReplay::Record(script, the_image->ReturnActiveBitmap()->Bounds());
 			if (script && tool_type != SELECTOR_TOOL) {
 				const DrawingTool* tool = ToolManager::Instance().ReturnTool(tool_type);
 				UndoEvent* new_event
@@ -1762,8 +1942,12 @@ ImageView::PaintToolThread()
 						if (layer->IsActive() == FALSE)
 							new_action = new UndoAction(layer->Id());
 						else {
-							new_action = new UndoAction(
-								layer->Id(), script, ToolManager::Instance().LastUpdatedRect(this));
+							BRect updated_rect = ToolManager::Instance().LastUpdatedRect(this);
+							if (offset_applied == TRUE)
+								updated_rect = updated_rect | layer->Bitmap()->Bounds();
+							new_action = new UndoAction(layer->Id(), script, updated_rect);
+							if (offset_applied == TRUE)
+								new_action->SetOldLayerOffset(old_offset);
 						}
 						new_event->AddAction(new_action);
 						new_action->StoreUndo(layer->Bitmap());
@@ -1777,6 +1961,10 @@ ImageView::PaintToolThread()
 					delete script;
 					ToolManager::Instance().LastUpdatedRect(this);
 				}
+			} else if (offset_applied == TRUE) {
+				// The tool did not change anything, but the offset must still
+				// be undoable.
+				the_image->StoreLayerOffsetUndo(active_layer, old_offset);
 			} else if (tool_type == SELECTOR_TOOL) {
 				// Add selection-change to the undo-queue.
 
@@ -1862,7 +2050,9 @@ ImageView::ManipulatorMouseTrackerThread()
 			first_call_to_mouse_down = FALSE;
 			if (show_selection == true)
 				selection->StopDrawing();
+			bigtime_t preview_start = system_time();
 			preview_quality = gui_manipulator->PreviewBitmap(FALSE, updated_region);
+			TraceRecorder::Record("manipulator", "PreviewBitmap", preview_start, system_time());
 			if (show_selection == true)
 				selection->StartDrawing(this, magnify_scale);
 
@@ -1898,7 +2088,9 @@ ImageView::ManipulatorMouseTrackerThread()
 	SetCursor();
 
 	updated_region->Set(BRect(0, 0, -1, -1));
+	bigtime_t preview_start = system_time();
 	preview_quality = gui_manipulator->PreviewBitmap(TRUE, updated_region);
+	TraceRecorder::Record("manipulator", "PreviewBitmap", preview_start, system_time());
 	if (preview_quality != DRAW_NOTHING) {
 		if ((preview_quality != DRAW_ONLY_GUI)
 			&& (updated_region->Frame().IsValid())) {
@@ -1948,7 +2140,9 @@ ImageView::GUIManipulatorUpdaterThread()
 
 	while (continue_manipulator_updating) {
 		if (LockLooper() == TRUE) {
+			bigtime_t preview_start = system_time();
 			preview_quality = gui_manipulator->PreviewBitmap(FALSE, updated_region);
+			TraceRecorder::Record("manipulator", "PreviewBitmap", preview_start, system_time());
 			lowest_quality = max_c(lowest_quality, preview_quality);
 
 			if ((preview_quality != DRAW_NOTHING)
@@ -1984,7 +2178,9 @@ ImageView::GUIManipulatorUpdaterThread()
 	cursor_mode = BLOCKING_CURSOR_MODE;
 	SetCursor();
 
+	bigtime_t preview_start = system_time();
 	preview_quality = gui_manipulator->PreviewBitmap(TRUE, updated_region);
+	TraceRecorder::Record("manipulator", "PreviewBitmap", preview_start, system_time());
 
 	if (preview_quality != DRAW_NOTHING) {
 		if ((preview_quality != DRAW_ONLY_GUI)
@@ -2046,15 +2242,13 @@ ImageView::ManipulatorFinisherThread()
 		}
 	}
 	GUIManipulator* gui_manipulator = cast_as(fManipulator, GUIManipulator);
+	TranslationManipulator* translation_manipulator
+		= dynamic_cast<TranslationManipulator*>(fManipulator);
 	UndoEvent* new_event = NULL;
 
 	try {
 		BString manipName = fManipulator->ReturnName();
-		if (manipName == B_TRANSLATE("Translate selection")
-			|| manipName == B_TRANSLATE("Rotate selection")
-			|| manipName == B_TRANSLATE("Scale selection")
-			|| manipName == B_TRANSLATE("Flip selection horizontally")
-			|| manipName == B_TRANSLATE("Flip selection vertically")) {
+		if (is_selection_manipulator(fManipulator)) {
 			// Add selection-change to the undo-queue.
 
 			if (gui_manipulator != NULL) {
@@ -2079,6 +2273,41 @@ ImageView::ManipulatorFinisherThread()
 					undo_queue->SetSelectionMap(selection->ReturnSelectionMap());
 				}
 			}
+		} else if (translation_manipulator != NULL
+			&& translation_manipulator->UsesLayerOffset() == true) {
+			// Translating whole layers only changes their offsets. The pixels
+			// are moved when something needs to draw into the layer.
+			ManipulatorSettings* settings = translation_manipulator->ReturnSettings();
+			new_event = undo_queue->AddUndoEvent(
+				fManipulator->ReturnName(), the_image->ReturnThumbnailImage());
+
+			BList* layer_list = the_image->LayerList();
+			for (int32 i = 0; i < layer_list->CountItems(); i++) {
+				Layer* layer = (Layer*)layer_list->ItemAt(i);
+				UndoAction* new_action = NULL;
+				if (manipulated_layers == HS_MANIPULATE_ALL_LAYERS
+					|| layer == the_image->ReturnActiveLayer()) {
+					BPoint old_offset;
+					translation_manipulator->ManipulateLayer(settings, layer, &old_offset);
+					if (old_offset != layer->Offset()) {
+						BRect old_frame = layer->Bitmap()->Bounds().OffsetByCopy(old_offset);
+						new_action = new UndoAction(
+							layer->Id(), old_offset, old_frame | layer->Frame());
+						thread_id a_thread = spawn_thread(Layer::CreateMiniatureImage,
+							"create mini picture", B_LOW_PRIORITY, layer);
+						resume_thread(a_thread);
+					}
+				}
+				if (new_action == NULL)
+					new_action = new UndoAction(layer->Id());
+
+				if (new_event != NULL) {
+					new_event->AddAction(new_action);
+					new_action->StoreUndo(layer->Bitmap());
+				} else
+					delete new_action;
+			}
+			delete settings;
 		} else {
 			if (manipulated_layers == HS_MANIPULATE_CURRENT_LAYER) {
 				Layer* the_layer = the_image->ReturnActiveLayer();
@@ -2233,6 +2462,243 @@ ImageView::ManipulatorFinisherThread()
 }
 
 
+bool
+ImageView::StartBackgroundFinisher()
+{
+	// Only manipulators that change the pixels of the current layer are run
+	// in the background. The selection manipulators and translating a whole
+	// layer are fast, and processing all of the layers would leave nothing
+	// to edit in the meantime.
+	if (fManipulator == NULL || fBackgroundJob != NULL
+		|| manipulated_layers != HS_MANIPULATE_CURRENT_LAYER
+		|| is_selection_manipulator(fManipulator)
+		|| dynamic_cast<TranslationManipulator*>(fManipulator) != NULL)
+		return false;
+
+	Layer* layer = the_image->ReturnActiveLayer();
+	if (layer == NULL)
+		return false;
+
+	background_finisher_job* job = new (std::nothrow) background_finisher_job;
+	if (job == NULL)
+		return false;
+
+	job->manipulator = fManipulator;
+	job->settings = NULL;
+	job->layer_id = layer->Id();
+	job->manip_type = manip_type;
+	job->add_on_id = add_on_id;
+	job->source = NULL;
+	job->result = NULL;
+	job->selection = NULL;
+	job->started = false;
+	job->failed = false;
+
+	// The settings must be read here, the manipulator's window might still
+	// be changing them.
+	if (GUIManipulator* gui_manipulator = dynamic_cast<GUIManipulator*>(fManipulator))
+		job->settings = gui_manipulator->ReturnSettings();
+
+	job->status_bar
+		= ((PaintWindow*)Window())->ReturnStatusView()->DisplayProgressIndicator();
+	if (job->status_bar != NULL) {
+		job->status_bar->Reset();
+		job->status_bar->SetText(B_TRANSLATE("Processing" B_UTF8_ELLIPSIS));
+	}
+
+	if (manipulator_finishing_message != NULL) {
+		job->postponed_messages.AddItem(manipulator_finishing_message);
+		manipulator_finishing_message = NULL;
+	}
+
+	job->thread = spawn_thread(enter_background_finisher, "background finisher",
+		B_NORMAL_PRIORITY, this);
+	if (job->thread < 0) {
+		manipulator_finishing_message = (BMessage*)job->postponed_messages.RemoveItem((int32)0);
+		delete job->settings;
+		delete job;
+		((PaintWindow*)Window())->ReturnStatusView()->DisplayToolsAndColors();
+		return false;
+	}
+
+	fBackgroundJob = job;
+	fManipulator = NULL;
+	manipulated_layers = HS_MANIPULATE_NO_LAYER;
+
+	resume_thread(job->thread);
+	return true;
+}
+
+
+int32
+ImageView::enter_background_finisher(void* data)
+{
+	return ((ImageView*)data)->BackgroundFinisherThread();
+}
+
+
+int32
+ImageView::BackgroundFinisherThread()
+{
+	background_finisher_job* job = fBackgroundJob;
+	GUIManipulator* gui_manipulator = dynamic_cast<GUIManipulator*>(job->manipulator);
+
+	// Take a snapshot of the layer and the selection while nothing else can
+	// touch them. After that the image is free for editing again.
+	acquire_sem(action_semaphore);
+	try {
+		if (gui_manipulator != NULL)
+			gui_manipulator->Reset();
+
+		Layer* layer = the_image->ReturnLayerById(job->layer_id);
+		if (layer == NULL)
+			throw std::bad_alloc();
+
+		job->source = new BBitmap(layer->Bitmap());
+		if (job->source->IsValid() == false)
+			throw std::bad_alloc();
+
+		BRect image_bounds(0, 0, the_image->Width() - 1, the_image->Height() - 1);
+		job->selection = new Selection(image_bounds);
+		if (selection->IsEmpty() == false)
+			job->selection->ReplaceSelection(selection->ReturnSelectionMap());
+		job->manipulator->SetSelection(job->selection);
+	} catch (const std::bad_alloc&) {
+		job->failed = true;
+	}
+	the_image->Render();
+	release_sem(action_semaphore);
+
+	if (BWindow* window = Window())
+		window->PostMessage(HS_BACKGROUND_FINISHER_STARTED, this);
+
+	if (job->failed == false) {
+		try {
+			if (gui_manipulator != NULL) {
+				job->result = gui_manipulator->ManipulateBitmap(
+					job->settings, job->source, job->status_bar);
+			} else {
+				job->result = job->manipulator->ManipulateBitmap(
+					job->source, job->status_bar);
+			}
+		} catch (const std::bad_alloc&) {
+			job->failed = true;
+		}
+	}
+
+	if (BWindow* window = Window())
+		window->PostMessage(HS_BACKGROUND_FINISHER_DONE, this);
+
+	return B_OK;
+}
+
+
+void
+ImageView::CommitBackgroundFinisher(bool wait)
+{
+	background_finisher_job* job = fBackgroundJob;
+	if (job == NULL)
+		return;
+
+	// The thread takes the action_semaphore for its snapshot, so it must
+	// be waited for before taking the semaphore here. The window is often
+	// locked while waiting, so the manipulators must never block on its
+	// lock when they update the progress bar.
+	status_t exit_value;
+	if (wait == true) {
+		wait_for_thread(job->thread, &exit_value);
+		acquire_sem(action_semaphore);
+	} else if (acquire_sem_etc(action_semaphore, 1, B_TIMEOUT, 0) != B_OK) {
+		// Something is drawing into the image, try again a bit later.
+		BMessage message(HS_BACKGROUND_FINISHER_DONE);
+		BMessageRunner::StartSending(BMessenger(this), &message, 50000, 1);
+		return;
+	} else
+		wait_for_thread(job->thread, &exit_value);
+
+	Layer* layer = the_image->ReturnLayerById(job->layer_id);
+	if (job->failed == false && layer != NULL && job->result != NULL) {
+		BBitmap* buffer = layer->Bitmap();
+		if (job->result->Bounds() == buffer->Bounds()) {
+			memcpy(buffer->Bits(), job->result->Bits(), buffer->BitsLength());
+		} else {
+			// The layer takes the ownership of the resized bitmap.
+			layer->ChangeBitmap(job->result);
+			if (job->result == job->source)
+				job->source = NULL;
+			job->result = NULL;
+		}
+
+		UndoEvent* new_event = undo_queue->AddUndoEvent(
+			job->manipulator->ReturnName(), the_image->ReturnThumbnailImage());
+		if (new_event != NULL) {
+			BList* layer_list = the_image->LayerList();
+			for (int32 i = 0; i < layer_list->CountItems(); i++) {
+				Layer* a_layer = (Layer*)layer_list->ItemAt(i);
+
+				UndoAction* new_action;
+				if (a_layer != layer)
+					new_action = new UndoAction(a_layer->Id());
+				else {
+					new_action = new UndoAction(a_layer->Id(),
+						job->manipulator->ReturnSettings(), a_layer->Bitmap()->Bounds(),
+						(manipulator_type)job->manip_type, job->add_on_id);
+				}
+				new_event->AddAction(new_action);
+				new_action->StoreUndo(a_layer->Bitmap());
+			}
+
+			if (new_event->IsEmpty() == TRUE) {
+				undo_queue->RemoveEvent(new_event);
+				delete new_event;
+			}
+		}
+
+		thread_id a_thread = spawn_thread(Layer::CreateMiniatureImage,
+			"create mini picture", B_LOW_PRIORITY, layer);
+		resume_thread(a_thread);
+
+		AddChange();
+		the_image->SetImageSize();
+		the_image->Render();
+		MakeBackground();
+	}
+
+	if (ManipulatorServer* server = ManipulatorServer::Instance())
+		server->StoreManipulatorSettings(job->manipulator);
+
+	if (job->result != job->source)
+		delete job->result;
+	delete job->source;
+	delete job->settings;
+	delete job->manipulator;
+	delete job->selection;
+
+	fBackgroundJob = NULL;
+	release_sem(action_semaphore);
+
+	// The view might already be leaving its window when it is destroyed.
+	BWindow* window = Window();
+	if (PaintWindow* paint_window = dynamic_cast<PaintWindow*>(window))
+		paint_window->ReturnStatusView()->DisplayToolsAndColors();
+	if (BView* parent = Parent())
+		parent->Invalidate();
+	Invalidate();
+
+	if (job->failed == true)
+		ShowAlert(CANNOT_FINISH_MANIPULATOR_ALERT);
+
+	// Now the messages that had to wait for the manipulator can be handled.
+	for (int32 i = 0; i < job->postponed_messages.CountItems(); i++) {
+		BMessage* message = (BMessage*)job->postponed_messages.ItemAt(i);
+		if (window != NULL)
+			window->PostMessage(message, this);
+		delete message;
+	}
+	delete job;
+}
+
+
 void
 ImageView::Undo()
 {
@@ -2255,6 +2721,9 @@ ImageView::Undo()
 				// possible gui_manipulator should be informed about it.
 				if (gui_manipulator != NULL) {
 					gui_manipulator->SetPreviewBitmap(the_image->ReturnActiveBitmap());
+					if (TranslationManipulator* translation_manipulator
+						= dynamic_cast<TranslationManipulator*>(gui_manipulator))
+						translation_manipulator->SetLayer(the_image->ReturnActiveLayer());
 					// We should also tell the manipulator to recalculate its preview.
 					Window()->PostMessage(HS_MANIPULATOR_ADJUSTING_FINISHED, this);
 					cursor_mode = MANIPULATOR_CURSOR_MODE;
@@ -2343,6 +2812,9 @@ ImageView::Redo()
 				// possible gui_manipulator should be informed about it.
 				if (gui_manipulator != NULL) {
 					gui_manipulator->SetPreviewBitmap(the_image->ReturnActiveBitmap());
+					if (TranslationManipulator* translation_manipulator
+						= dynamic_cast<TranslationManipulator*>(gui_manipulator))
+						translation_manipulator->SetLayer(the_image->ReturnActiveLayer());
 					// We should also tell the manipulator to recalculate its preview.
 					Window()->PostMessage(HS_MANIPULATOR_ADJUSTING_FINISHED, this);
 				}
@@ -2407,9 +2879,10 @@ ImageView::DoCopyOrCut(int32 layers, bool cut)
 	if (acquire_sem_etc(action_semaphore, 1, B_TIMEOUT, 0) == B_OK) {
 		BBitmap* buffer;
 		bool ok_to_archive = TRUE;
-		if (layers == HS_MANIPULATE_CURRENT_LAYER)
+		if (layers == HS_MANIPULATE_CURRENT_LAYER) {
+			the_image->ApplyLayerOffset(the_image->ReturnActiveLayer());
 			buffer = the_image->ReturnActiveBitmap();
-		else
+		} else
 			buffer = the_image->ReturnRenderedImage();
 		BMessage* bitmap_archive = new BMessage();
 		if (selection->IsEmpty() == TRUE) {
@@ -2732,6 +3205,13 @@ ImageView::ResetChangeStatistics(bool project, bool image)
 bool
 ImageView::PostponeMessageAndFinishManipulator(bool status)
 {
+	// While a manipulator is running in the background the messages that
+	// might touch its layer wait until the result has been committed.
+	if (fBackgroundJob != NULL && TouchesBackgroundLayer(Window()->CurrentMessage())) {
+		fBackgroundJob->postponed_messages.AddItem(Window()->DetachCurrentMessage());
+		return true;
+	}
+
 	if (fManipulator) {
 		manipulator_finishing_message = Window()->DetachCurrentMessage();
 
@@ -2745,6 +3225,28 @@ ImageView::PostponeMessageAndFinishManipulator(bool status)
 }
 
 
+bool
+ImageView::TouchesBackgroundLayer(BMessage* message)
+{
+	// Only a manipulator that processes another layer can start while the
+	// background manipulator runs, and only after it has taken its snapshot
+	// of the layer and the selection.
+	if (fBackgroundJob == NULL)
+		return false;
+	if (message == NULL || message->what != HS_START_MANIPULATOR
+		|| fBackgroundJob->started == false)
+		return true;
+
+	int32 layers;
+	if (message->FindInt32("layers", &layers) != B_OK
+		|| layers != HS_MANIPULATE_CURRENT_LAYER)
+		return true;
+
+	Layer* layer = the_image->ReturnActiveLayer();
+	return layer == NULL || layer->Id() == fBackgroundJob->layer_id;
+}
+
+
 filter_result
 KeyFilterFunction(BMessage* message, BHandler** handler, BMessageFilter*)
 {
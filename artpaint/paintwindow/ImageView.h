@@ -25,6 +25,10 @@
 // These constants are used in communication between ImageView and PaintWindow
 #define	HS_HIDE_FILE_PANELS			'HiFp'
 
+// These are sent by the thread that applies a manipulator in the background.
+#define	HS_BACKGROUND_FINISHER_STARTED	'BgFs'
+#define	HS_BACKGROUND_FINISHER_DONE		'BgFd'
+
 
 enum thread_constants {
 	PAINTER_THREAD,
@@ -62,6 +66,7 @@ enum {
 
 class Layer;
 class Selection;
+struct background_finisher_job;
 class UndoEvent;
 class Manipulator;
 class Image;
@@ -136,6 +141,18 @@ private:
 			int32		manip_type;
 			BRegion		region_drawn_by_manipulator;
 
+			// The manipulator that is being applied to a snapshot of a layer
+			// in the background. The rest of the image can be edited while it
+			// runs, only the target layer is off limits until the result has
+			// been committed.
+			background_finisher_job*	fBackgroundJob;
+
+			bool		StartBackgroundFinisher();
+			void		CommitBackgroundFinisher(bool wait);
+			bool		TouchesBackgroundLayer(BMessage* message);
+	static	int32		enter_background_finisher(void*);
+			int32		BackgroundFinisherThread();
+
 			void		DrawManipulatorGUI(bool blit_image);
 
 			// This is the undo-queue.
@@ -193,6 +210,7 @@ public:
 						ImageView(BRect frame, float width, float height);
 						~ImageView();
 			void		AttachedToWindow();
+			void		DetachedFromWindow();
 			void		Draw(BRect updateRect);
 			void		KeyDown(const char*, int32);
 			void		KeyUp(const char*, int32);
@@ -39,6 +39,7 @@
 #include "StatusView.h"
 #include "ToolSelectionWindow.h"
 #include "ToolSetupWindow.h"
+#include "TraceRecorder.h"
 #include "UtilityClasses.h"
 #include "ViewSetupWindow.h"
 
@@ -430,25 +431,6 @@ PaintWindow::FrameMoved(BPoint newPosition)
 }
 
 
-void
-PaintWindow::Redraw()
-{
-	for (int i = 0; i < sgPaintWindowCount; ++i) {
-		PaintWindow* paintWin = (PaintWindow*)sgPaintWindowList.ItemAt(i);
-
-		ImageView* imgView = paintWin->ReturnImageView();
-		if (imgView != NULL) {
-			if (imgView->LockLooper() == true) {
-				imgView->MakeBackground();
-				imgView->ReturnImage()->Render();
-				imgView->Invalidate();
-				imgView->UnlockLooper();
-			}
-		}
-	}
-}
-
-
 void
 PaintWindow::MenusBeginning()
 {
@@ -553,6 +535,14 @@ PaintWindow::MenusBeginning()
 			else
 				item->SetEnabled(true);
 		}
+
+		const char* radiusMenus[] = { B_TRANSLATE("Grow by"),
+			B_TRANSLATE("Shrink by"), B_TRANSLATE("Feather") };
+		for (int32 i = 0; i < 3; i++) {
+			item = selectionMenu->FindItem(radiusMenus[i]);
+			if (item != NULL)
+				item->SetEnabled(!fImageView->GetSelection()->IsEmpty());
+		}
 	}
 
 	if ((fImageEntry.InitCheck() == B_OK) && (fCurrentHandler != 0)) {
@@ -1073,6 +1063,14 @@ PaintWindow::openMenuBar()
 	item->SetTarget(be_app);
 	menu->AddItem(item);
 
+	if (TraceRecorder::IsEnabled()) {
+		item = new PaintWindowMenuItem(B_TRANSLATE("Save trace"),
+			new BMessage(HS_EXPORT_TRACE), 0, 0, this,
+			B_TRANSLATE("Writes the trace of the rendering to the file given with --trace."));
+		item->SetTarget(be_app);
+		menu->AddItem(item);
+	}
+
 	message = new BMessage(B_ABOUT_REQUESTED);
 	item = new PaintWindowMenuItem(B_TRANSLATE("About ArtPaint"), message, 0, 0, this,
 		B_TRANSLATE("Opens a window with information about ArtPaint."));
@@ -1272,6 +1270,34 @@ PaintWindow::openMenuBar()
 		0, this, B_TRANSLATE("Grows the selection in all directions.")));
 	menu->AddItem(new PaintWindowMenuItem(B_TRANSLATE("Shrink"), new BMessage(HS_SHRINK_SELECTION),
 		'G', B_SHIFT_KEY, this, B_TRANSLATE("Shrinks the selection in all directions.")));
+
+	// The same operations by more than one pixel at a time.
+	const int32 radii[] = { 2, 5, 10, 25, 50 };
+	BMenu* growMenu = new BMenu(B_TRANSLATE("Grow by"));
+	BMenu* shrinkMenu = new BMenu(B_TRANSLATE("Shrink by"));
+	BMenu* featherMenu = new BMenu(B_TRANSLATE("Feather"));
+	for (size_t i = 0; i < sizeof(radii) / sizeof(int32); i++) {
+		BString label;
+		label.SetToFormat(B_TRANSLATE("%" B_PRId32 " pixels"), radii[i]);
+
+		a_message = new BMessage(HS_GROW_SELECTION);
+		a_message->AddInt32("radius", radii[i]);
+		growMenu->AddItem(new PaintWindowMenuItem(label, a_message, 0, 0, this,
+			B_TRANSLATE("Grows the selection in all directions.")));
+
+		a_message = new BMessage(HS_SHRINK_SELECTION);
+		a_message->AddInt32("radius", radii[i]);
+		shrinkMenu->AddItem(new PaintWindowMenuItem(label, a_message, 0, 0, this,
+			B_TRANSLATE("Shrinks the selection in all directions.")));
+
+		a_message = new BMessage(HS_FEATHER_SELECTION);
+		a_message->AddInt32("radius", radii[i]);
+		featherMenu->AddItem(new PaintWindowMenuItem(label, a_message, 0, 0, this,
+			B_TRANSLATE("Softens the edges of the selection.")));
+	}
+	menu->AddItem(growMenu);
+	menu->AddItem(shrinkMenu);
+	menu->AddItem(featherMenu);
 	menu->AddSeparatorItem();
 	a_message = new BMessage(HS_START_MANIPULATOR);
 	a_message->AddInt32("manipulator_type", ROTATE_SELECTION_MANIPULATOR);
@@ -1468,57 +1494,26 @@ PaintWindow::_AddAddOnsToMenu(void* data)
 		BMenuItem* item = menuBar->FindItem(B_TRANSLATE("Add-ons"));
 		if (BMenu* addOnMenu = item->Submenu()) {
 			if (paintWindow->Lock()) {
-				ImageList::const_iterator it;
-				const ImageList& imageList = server->AddOnImageList();
+				// The names and help strings come from the manifest of the
+				// add-ons, the add-ons themselves are loaded when used.
+				const AddOnList& addOns = server->AddOns();
 				std::map<BString, int32> manip_map;
 
-				for (it = imageList.begin(); it != imageList.end(); ++it) {
-					int32* add_on_version;
-					status_t status = get_image_symbol(
-						*it, "add_on_api_version", B_SYMBOL_TYPE_DATA, (void**)&add_on_version);
-
-					if (status != B_OK)
-						continue;
-
-					if (*add_on_version == ADD_ON_API_VERSION) {
-						Manipulator* (*Instantiate)(BBitmap*, ManipulatorInformer*);
-						status_t status = get_image_symbol(
-							*it, "instantiate_add_on", B_SYMBOL_TYPE_TEXT, (void**)&Instantiate);
-						if (status == B_OK) {
-							Manipulator* manipulator = Instantiate(NULL, NULL);
-
-							if (manipulator != NULL) {
-								manip_map.insert(std::pair<BString,
-									int32>(BString(manipulator->ReturnName()), *it));
-
-								delete manipulator;
-								manipulator = NULL;
-							}
-						}
-					}
+				for (int32 i = 0; i < server->AddOnCount(); i++) {
+					if (addOns[i].api_version == ADD_ON_API_VERSION
+						&& addOns[i].name.Length() > 0)
+						manip_map.insert(std::pair<BString, int32>(addOns[i].name, i));
 				}
 
 				for (auto it = manip_map.begin(); it != manip_map.end(); ++it) {
 					int32 id = it->second;
-					Manipulator* (*Instantiate)(BBitmap*, ManipulatorInformer*);
-					status_t status = get_image_symbol(
-						id, "instantiate_add_on", B_SYMBOL_TYPE_TEXT, (void**)&Instantiate);
-					if (status == B_OK) {
-						Manipulator* manipulator = Instantiate(NULL, NULL);
-
-						if (manipulator != NULL) {
-							BMessage* message = new BMessage(HS_START_MANIPULATOR);
-							message->AddInt32("image_id", id);
-							message->AddInt32("layers", HS_MANIPULATE_CURRENT_LAYER);
-							message->AddInt32("manipulator_type", ADD_ON_MANIPULATOR);
-
-							addOnMenu->AddItem(new PaintWindowMenuItem(manipulator->ReturnName(),
-								message, 0, 0, paintWindow, manipulator->ReturnHelpString()));
-
-							delete manipulator;
-							manipulator = NULL;
-						}
-					}
+					BMessage* message = new BMessage(HS_START_MANIPULATOR);
+					message->AddInt32("add_on_id", id);
+					message->AddInt32("layers", HS_MANIPULATE_CURRENT_LAYER);
+					message->AddInt32("manipulator_type", ADD_ON_MANIPULATOR);
+
+					addOnMenu->AddItem(new PaintWindowMenuItem(addOns[id].name.String(),
+						message, 0, 0, paintWindow, addOns[id].help.String()));
 				}
 				addOnMenu->SetTargetForItems(paintWindow);
 				paintWindow->Unlock();
@@ -1582,6 +1577,16 @@ PaintWindow::AddImageView()
 		}
 	}
 
+	menu = fMenubar->FindItem(B_TRANSLATE("Selection"))->Submenu();
+	if (menu != NULL) {
+		BMenu* sub_menu;
+		for (int32 i = 0; i < menu->CountItems(); i++) {
+			sub_menu = menu->SubmenuAt(i);
+			if (sub_menu != NULL)
+				sub_menu->SetTargetForItems(fImageView);
+		}
+	}
+
 	fMenubar->FindItem(B_TRANSLATE("Add-ons"))->Submenu()->SetTargetForItems(fImageView);
 	fMenubar->FindItem(HS_ADD_LAYER_FRONT)->SetTarget(fImageView);
 	fMenubar->FindItem(HS_DELETE_LAYER)->SetTarget(fImageView);
@@ -89,8 +89,6 @@ public:
 			// whenever an image is loaded
 			void			ReadAttributes(const BNode& node);
 
-	static  void			Redraw();
-
 			// This returns the number of paint-windows
 	static	int32			CountPaintWindows() { return sgPaintWindowCount; }
 
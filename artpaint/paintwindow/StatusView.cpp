@@ -17,21 +17,25 @@
 #include "ColorPalette.h"
 #include "HSPictureButton.h"
 #include "MagnificationView.h"
+#include "MemoryBudget.h"
 #include "MessageConstants.h"
 #include "PaintApplication.h"
 #include "Patterns.h"
 #include "ResourceServer.h"
 #include "ToolManager.h"
+#include "TraceRecorder.h"
 
 
 #include <Catalog.h>
 #include <LayoutBuilder.h>
 #include <Region.h>
 #include <StatusBar.h>
+#include <String.h>
 #include <Window.h>
 
 
 #include <stdio.h>
+#include <string.h>
 
 
 #undef B_TRANSLATION_CONTEXT
@@ -42,6 +46,10 @@
 #define PROGRESS_VIEW 1
 
 
+// How often the render statistics are updated.
+const bigtime_t kRenderPeriod = 500000;
+
+
 StatusView::StatusView()
 	:
 	BView("status view", B_WILL_DRAW)
@@ -63,6 +71,17 @@ StatusView::StatusView()
 	// It will be under the other views and left from the color container.
 	fHelpView = new BStringView("message view", "");
 
+	// The frame time is only shown when tracing, for finding out where the
+	// stutter comes from.
+	fRenderView = NULL;
+	if (TraceRecorder::IsEnabled())
+		fRenderView = new BStringView("render view", "");
+	fRenderPeriodStart = 0;
+	fRenderTime = 0;
+	fMaxRenderTime = 0;
+	fRenderPixels = 0;
+	fRenderFrames = 0;
+
 	float color_size = font.StringWidth("FGCOLOR");
 	BRect rect = BRect(0, 0, color_size, color_size);
 
@@ -95,6 +114,8 @@ StatusView::StatusView()
 		.AddGlue(2, 0)
 		.Add(fHelpView, 0, 1, 3, 1)
 		.Add(fCardLayout, 3, 0, 2, 2);
+	if (fRenderView != NULL)
+		fStatusView->AddView(fRenderView, 2, 0);
 	fStatusView->SetMinColumnWidth(0, StringWidth("X: 9999 (-9999) , Y: 9999 (-9999)"));
 
 	fCardLayout->SetVisibleItem((int32)TOOLS_VIEW);
@@ -112,6 +133,9 @@ StatusView::~StatusView()
 	if (fHelpView->Parent() == NULL)
 		delete fHelpView;
 
+	if (fRenderView != NULL && fRenderView->Parent() == NULL)
+		delete fRenderView;
+
 	if (selected_colors->Parent() == NULL)
 		delete selected_colors;
 }
@@ -158,6 +182,50 @@ StatusView::SetCoordinates(BPoint point, BPoint reference, bool use_reference)
 }
 
 
+void
+StatusView::AddRenderedFrame(bigtime_t time, int64 pixels, const void* document)
+{
+	if (fRenderView == NULL)
+		return;
+
+	fRenderTime += time;
+	fMaxRenderTime = max_c(fMaxRenderTime, time);
+	fRenderPixels += pixels;
+	fRenderFrames++;
+
+	bigtime_t now = system_time();
+	if (now - fRenderPeriodStart < kRenderPeriod)
+		return;
+
+	memory_usage usage;
+	if (!MemoryBudget::GetUsage(document, &usage))
+		memset(&usage, 0, sizeof(memory_usage));
+
+	char text[128];
+	sprintf(text, "%.1f ms (max %.1f), %.1f Mpix/s, %.1f MB (peak %.1f)",
+		fRenderTime / 1000.0 / fRenderFrames, fMaxRenderTime / 1000.0,
+		fRenderPixels / (double)max_c(fRenderTime, 1),
+		usage.live_total / 1048576.0, usage.peak_total / 1048576.0);
+	fRenderView->SetText(text);
+
+	BString tip;
+	for (int32 i = 0; i < MEMORY_CATEGORY_COUNT; i++) {
+		char line[80];
+		sprintf(line, "%s%s: %.1f MB (peak %.1f)", i > 0 ? "\n" : "",
+			MemoryBudget::CategoryName((memory_category)i),
+			usage.live[i] / 1048576.0, usage.peak[i] / 1048576.0);
+		tip << line;
+	}
+	fRenderView->SetToolTip(tip.String());
+
+	fRenderPeriodStart = now;
+	fRenderTime = 0;
+	fMaxRenderTime = 0;
+	fRenderPixels = 0;
+	fRenderFrames = 0;
+}
+
+
 void
 StatusView::SetMagnifyingScale(float mag)
 {
@@ -40,6 +40,12 @@ public:
 			void				SetCoordinates(BPoint point, BPoint reference,
 									bool use_reference);
 
+			// Adds a rendered frame to the frame time and the rendering
+			// speed that are shown when ArtPaint is tracing. The memory that
+			// the document uses is shown with them.
+			void				AddRenderedFrame(bigtime_t time, int64 pixels,
+									const void* document);
+
 			BStatusBar*			DisplayProgressIndicator();
 			status_t			DisplayToolsAndColors();
 
@@ -47,6 +53,14 @@ private:
 			BStringView*		coordinate_view;
 			MagnificationView*	mag_state_view;
 			BStringView*		fHelpView;
+			BStringView*		fRenderView;
+
+			// The frames since the render statistics were last shown.
+			bigtime_t			fRenderPeriodStart;
+			bigtime_t			fRenderTime;
+			bigtime_t			fMaxRenderTime;
+			int64				fRenderPixels;
+			int32				fRenderFrames;
 
 			// This is the StatusBar that will be used in this status-view.
 			BStatusBar*			status_bar;
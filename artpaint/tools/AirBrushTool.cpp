@@ -20,6 +20,7 @@
 #include "Image.h"
 #include "ImageUpdater.h"
 #include "ImageView.h"
+#include "MemoryBudget.h"
 #include "NumberSliderControl.h"
 #include "PaintApplication.h"
 #include "PixelOperations.h"
@@ -88,12 +89,14 @@ AirBrushTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 		delete coordinate_reader;
 		return NULL;
 	}
+	MemoryBudget::Track(srcBuffer, view, TOOL_MEMORY);
 	BBitmap* tmpBuffer = new (std::nothrow) BBitmap(bitmap);
 	if (tmpBuffer == NULL) {
-		delete srcBuffer;
+		MemoryBudget::DeleteBitmap(srcBuffer);
 		delete coordinate_reader;
 		return NULL;
 	}
+	MemoryBudget::Track(tmpBuffer, view, TOOL_MEMORY);
 
 	bool use_fg_color = true;
 	if (buttons == B_SECONDARY_MOUSE_BUTTON)
@@ -111,15 +114,11 @@ AirBrushTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 	BitmapDrawer* drawer = new BitmapDrawer(tmpBuffer);
 	Selection* selection = view->GetSelection();
 
-	ToolScript* the_script
-		= new ToolScript(Type(), fToolSettings, ((PaintApplication*)be_app)->Color(true));
+	ToolScript* the_script = new ToolScript(Type(), fToolSettings, c);
 
 	ImageUpdater* imageUpdater = new ImageUpdater(view, 20000);
 
 	if (fToolSettings.mode == HS_AIRBRUSH_MODE) { // Do the airbrush
-		BRect bounds = bitmap->Bounds();
-		BRect rc;
-
 		prev_point = point - BPoint(1, 1);
 		SetLastUpdatedRect(BRect(point, point));
 		// while (buttons) {
@@ -127,126 +126,25 @@ AirBrushTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 		while (coordinate_reader->GetPoint(point, step_factor) == B_OK) {
 			the_script->AddPoint(point);
 
-			float half_size = fToolSettings.size / 2;
-			// we should only consider points that are inside this rectangle
-			rc = BRect(point.x - half_size, point.y - half_size, point.x + half_size,
-				point.y + half_size);
-			rc = rc & bounds;
-			rc = rc & selection->GetBoundingRect();
-
-			if (rc.IsValid() == true && point != prev_point) {
-				int32 height = rc.IntegerHeight() / 2;
-				int32 width = rc.IntegerWidth() / 2;
-				int32 left = (int32)rc.left;
-				int32 top = (int32)rc.top;
-				int32 right = (int32)rc.right;
-				int32 bottom = (int32)rc.bottom;
-
-				for (int32 y = 0; y <= height; y++) {
-					int32 y_sqr = (int32)((point.y - rc.top - y) * (point.y - rc.top - y));
-					for (int32 x = 0; x <= width; x++) {
-						int32 dx = (int32)(point.x - rc.left - x);
-						float distance = sqrt_table[dx * dx + y_sqr];
-						if ((distance <= half_size)
-							&& (selection->IsEmpty()
-								|| selection->ContainsPoint(left + x, top + y))) {
-							float change = (half_size - distance) / half_size;
-							change *= ((float)fToolSettings.pressure) / 100.0;
-							change *= 255;
-							float sel_alpha = selection->Value(left + x, top + y) / 255.;
-							if (selection->IsEmpty())
-								sel_alpha = 1.0;
-
-							union color_conversion target2;
-							target2.word = 0xffffff;
-							target2.bytes[3] = change * sel_alpha;
-							if (x < width && y < height)
-								drawer->SetPixel(left + x, top + y,
-									target2.word, selection);
-							drawer->SetPixel(right - x, top + y,
-								target2.word, selection);
-							drawer->SetPixel(left + x, bottom - y,
-								target2.word, selection);
-							if (x < width && y < height)
-								drawer->SetPixel(right - x, bottom - y,
-									target2.word, selection);
-
-						}
-					}
-				}
-			}
+			if (point != prev_point) {
+				BRect rc = _AirBrushDab(drawer, point, fToolSettings, bitmap->Bounds(), selection);
 
+				imageUpdater->AddRect(rc);
+				SetLastUpdatedRect(LastUpdatedRect() | rc);
+				BitmapUtilities::CompositeBitmapOnSource(bitmap, srcBuffer, tmpBuffer, rc,
+					src_over_fixed, target_color);
+			}
 			prev_point = point;
-			imageUpdater->AddRect(rc);
-			SetLastUpdatedRect(LastUpdatedRect() | rc);
-			BitmapUtilities::CompositeBitmapOnSource(bitmap, srcBuffer, tmpBuffer, rc,
-				src_over_fixed, target_color);
 		}
 	} else if (fToolSettings.mode == HS_SPRAY_MODE) { // Do the spray
 		RandomNumberGenerator* generator = new RandomNumberGenerator(0, 10000);
 		prev_point = point;
 
 		while (coordinate_reader->GetPoint(point) == B_OK) {
-			int32 flow = fToolSettings.pressure + 1;
-			float width = fToolSettings.size;
-			float angle;
-			float opacity = 0.4;
-
-			BRect rc(point, point);
-
-			if (point == prev_point) {
-				for (int32 i = 0; i < flow; i++) {
-					float x = generator->UniformDistribution(0, width * .5);
-					float y = generator->UniformDistribution(
-						0, sqrt((width * .5) * (width * .5) - x * x));
-
-					angle = generator->UniformDistribution(0, 1.0) * 2 * M_PI;
-					float old_x = x;
-					x = cos(angle) * x - sin(angle) * y;
-					y = sin(angle) * old_x + cos(angle) * y;
-					BPoint new_point = point + BPoint(x, y);
-					new_point.x = round(new_point.x);
-					new_point.y = round(new_point.y);
-					rc = rc | BRect(new_point, new_point);
-
-					if (selection->IsEmpty() || selection->ContainsPoint(new_point)) {
-						drawer->SetPixel(new_point,
-							mix_2_pixels_fixed(target_color, drawer->GetPixel(new_point),
-								(uint32)(32768 * opacity)),
-							selection, NULL);
-					}
-				}
-			} else {
-				BPoint center;
-				for (int32 i = 0; i < flow; i++) {
-					float x = generator->UniformDistribution(0, width * .5);
-					float y = generator->UniformDistribution(
-						0, sqrt((width * .5) * (width * .5) - x * x));
-
-					// Select center randomly from the line between prev_point and point.
-					// This is done by doing a linear interpolation between the
-					// two points and rounding the result to nearest integer.
-					float a = generator->UniformDistribution(0, 1.0);
-					center.x = round(a * prev_point.x + (1.0 - a) * point.x);
-					center.y = round(a * prev_point.y + (1.0 - a) * point.y);
-
-					angle = generator->UniformDistribution(0, 1.0) * 2 * M_PI;
-					float old_x = x;
-					x = cos(angle) * x - sin(angle) * y;
-					y = sin(angle) * old_x + cos(angle) * y;
-					BPoint new_point = center + BPoint(x, y);
-					new_point.x = round(new_point.x);
-					new_point.y = round(new_point.y);
-					rc = rc | BRect(new_point, new_point);
-
-					if (selection->IsEmpty() || selection->ContainsPoint(new_point)) {
-						drawer->SetPixel(new_point,
-							mix_2_pixels_fixed(target_color, drawer->GetPixel(new_point),
-								(uint32)(32768 * opacity)),
-							selection, NULL);
-					}
-				}
-			}
+			the_script->AddPoint(point);
+
+			BRect rc = _SprayDab(drawer, generator, point, prev_point, fToolSettings,
+				target_color, selection);
 			prev_point = point;
 
 			imageUpdater->AddRect(rc);
@@ -262,20 +160,203 @@ AirBrushTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 	delete coordinate_reader;
 
 	delete drawer;
-	delete srcBuffer;
-	delete tmpBuffer;
+	MemoryBudget::DeleteBitmap(srcBuffer);
+	MemoryBudget::DeleteBitmap(tmpBuffer);
 
 	return the_script;
 }
 
 
 int32
-AirBrushTool::UseToolWithScript(ToolScript*, BBitmap*)
+AirBrushTool::UseToolWithScript(ToolScript* script, BBitmap* bitmap)
 {
+	tool_settings* settings = script->ReturnSettings();
+	BPoint* points = script->ReturnPoints();
+	int32 point_count = script->PointCount();
+	if (point_count == 0)
+		return B_OK;
+
+	BBitmap* srcBuffer = new (std::nothrow) BBitmap(bitmap);
+	BBitmap* tmpBuffer = new (std::nothrow) BBitmap(bitmap);
+	Selection* selection = new (std::nothrow) Selection(bitmap->Bounds());
+	BitmapDrawer* drawer = NULL;
+	if (tmpBuffer != NULL)
+		drawer = new (std::nothrow) BitmapDrawer(tmpBuffer);
+	if (srcBuffer == NULL || tmpBuffer == NULL || selection == NULL || drawer == NULL) {
+		delete srcBuffer;
+		delete tmpBuffer;
+		delete selection;
+		delete drawer;
+		return B_NO_MEMORY;
+	}
+
+	uint32 target_color = RGBColorToBGRA(script->ReturnColor());
+
+	union color_conversion clear_color;
+	clear_color.word = target_color;
+	clear_color.bytes[3] = 0x00;
+
+	BitmapUtilities::ClearBitmap(tmpBuffer, clear_color.word);
+
+	if (settings->mode == HS_AIRBRUSH_MODE) {
+		BPoint prev_point = points[0] - BPoint(1, 1);
+		for (int32 i = 0; i < point_count; i++) {
+			if (points[i] != prev_point) {
+				BRect rc = _AirBrushDab(drawer, points[i], *settings, bitmap->Bounds(),
+					selection);
+				BitmapUtilities::CompositeBitmapOnSource(bitmap, srcBuffer, tmpBuffer, rc,
+					src_over_fixed, target_color);
+			}
+			prev_point = points[i];
+		}
+	} else if (settings->mode == HS_SPRAY_MODE) {
+		// The stroke was sprayed with the same sequence of random numbers.
+		RandomNumberGenerator* generator = new RandomNumberGenerator(0, 10000);
+		BPoint prev_point = points[0];
+		for (int32 i = 0; i < point_count; i++) {
+			BRect rc = _SprayDab(drawer, generator, points[i], prev_point, *settings,
+				target_color, selection);
+			prev_point = points[i];
+			BitmapUtilities::CompositeBitmapOnSource(bitmap, srcBuffer, tmpBuffer, rc);
+		}
+		delete generator;
+	}
+
+	delete drawer;
+	delete srcBuffer;
+	delete tmpBuffer;
+	delete selection;
+
 	return B_OK;
 }
 
 
+BRect
+AirBrushTool::_AirBrushDab(BitmapDrawer* drawer, BPoint point, const tool_settings& settings,
+	BRect bounds, Selection* selection)
+{
+	float half_size = settings.size / 2;
+	// we should only consider points that are inside this rectangle
+	BRect rc = BRect(point.x - half_size, point.y - half_size, point.x + half_size,
+		point.y + half_size);
+	rc = rc & bounds;
+	rc = rc & selection->GetBoundingRect();
+
+	if (rc.IsValid() == false)
+		return rc;
+
+	int32 height = rc.IntegerHeight() / 2;
+	int32 width = rc.IntegerWidth() / 2;
+	int32 left = (int32)rc.left;
+	int32 top = (int32)rc.top;
+	int32 right = (int32)rc.right;
+	int32 bottom = (int32)rc.bottom;
+
+	for (int32 y = 0; y <= height; y++) {
+		int32 y_sqr = (int32)((point.y - rc.top - y) * (point.y - rc.top - y));
+		for (int32 x = 0; x <= width; x++) {
+			int32 dx = (int32)(point.x - rc.left - x);
+			float distance = sqrt_table[dx * dx + y_sqr];
+			if ((distance <= half_size)
+				&& (selection->IsEmpty()
+					|| selection->ContainsPoint(left + x, top + y))) {
+				float change = (half_size - distance) / half_size;
+				change *= ((float)settings.pressure) / 100.0;
+				change *= 255;
+				float sel_alpha = selection->Value(left + x, top + y) / 255.;
+				if (selection->IsEmpty())
+					sel_alpha = 1.0;
+
+				union color_conversion target2;
+				target2.word = 0xffffff;
+				target2.bytes[3] = change * sel_alpha;
+				if (x < width && y < height)
+					drawer->SetPixel(left + x, top + y,
+						target2.word, selection);
+				drawer->SetPixel(right - x, top + y,
+					target2.word, selection);
+				drawer->SetPixel(left + x, bottom - y,
+					target2.word, selection);
+				if (x < width && y < height)
+					drawer->SetPixel(right - x, bottom - y,
+						target2.word, selection);
+			}
+		}
+	}
+
+	return rc;
+}
+
+
+BRect
+AirBrushTool::_SprayDab(BitmapDrawer* drawer, RandomNumberGenerator* generator, BPoint point,
+	BPoint prev_point, const tool_settings& settings, uint32 target_color, Selection* selection)
+{
+	int32 flow = settings.pressure + 1;
+	float width = settings.size;
+	float angle;
+	float opacity = 0.4;
+
+	BRect rc(point, point);
+
+	if (point == prev_point) {
+		for (int32 i = 0; i < flow; i++) {
+			float x = generator->UniformDistribution(0, width * .5);
+			float y = generator->UniformDistribution(
+				0, sqrt((width * .5) * (width * .5) - x * x));
+
+			angle = generator->UniformDistribution(0, 1.0) * 2 * M_PI;
+			float old_x = x;
+			x = cos(angle) * x - sin(angle) * y;
+			y = sin(angle) * old_x + cos(angle) * y;
+			BPoint new_point = point + BPoint(x, y);
+			new_point.x = round(new_point.x);
+			new_point.y = round(new_point.y);
+			rc = rc | BRect(new_point, new_point);
+
+			if (selection->IsEmpty() || selection->ContainsPoint(new_point)) {
+				drawer->SetPixel(new_point,
+					mix_2_pixels_fixed(target_color, drawer->GetPixel(new_point),
+						(uint32)(32768 * opacity)),
+					selection, NULL);
+			}
+		}
+	} else {
+		BPoint center;
+		for (int32 i = 0; i < flow; i++) {
+			float x = generator->UniformDistribution(0, width * .5);
+			float y = generator->UniformDistribution(
+				0, sqrt((width * .5) * (width * .5) - x * x));
+
+			// Select center randomly from the line between prev_point and point.
+			// This is done by doing a linear interpolation between the
+			// two points and rounding the result to nearest integer.
+			float a = generator->UniformDistribution(0, 1.0);
+			center.x = round(a * prev_point.x + (1.0 - a) * point.x);
+			center.y = round(a * prev_point.y + (1.0 - a) * point.y);
+
+			angle = generator->UniformDistribution(0, 1.0) * 2 * M_PI;
+			float old_x = x;
+			x = cos(angle) * x - sin(angle) * y;
+			y = sin(angle) * old_x + cos(angle) * y;
+			BPoint new_point = center + BPoint(x, y);
+			new_point.x = round(new_point.x);
+			new_point.y = round(new_point.y);
+			rc = rc | BRect(new_point, new_point);
+
+			if (selection->IsEmpty() || selection->ContainsPoint(new_point)) {
+				drawer->SetPixel(new_point,
+					mix_2_pixels_fixed(target_color, drawer->GetPixel(new_point),
+						(uint32)(32768 * opacity)),
+					selection, NULL);
+			}
+		}
+	}
+
+	return rc;
+}
+
+
 BView*
 AirBrushTool::ConfigView()
 {
@@ -14,9 +14,12 @@
 #include "DrawingTool.h"
 
 
+class BitmapDrawer;
 class BRadioButton;
 class CoordinateQueue;
 class ImageView;
+class RandomNumberGenerator;
+class Selection;
 
 
 namespace ArtPaint {
@@ -40,6 +43,14 @@ public:
 			const char*			HelpString(bool isInUse) const;
 
 private:
+			BRect				_AirBrushDab(BitmapDrawer* drawer, BPoint point,
+									const tool_settings& settings, BRect bounds,
+									Selection* selection);
+			BRect				_SprayDab(BitmapDrawer* drawer,
+									RandomNumberGenerator* generator, BPoint point,
+									BPoint prev_point, const tool_settings& settings,
+									uint32 target_color, Selection* selection);
+
 			bool				reading_coordinates;
 
 			ImageView*			image_view;
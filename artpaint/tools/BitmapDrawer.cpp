@@ -13,6 +13,7 @@
 
 
 #include "BitmapDrawer.h"
+#include "CompositeOperators.h"
 #include "HSPolygon.h"
 #include "PixelOperations.h"
 #include "Selection.h"
@@ -25,12 +26,110 @@ BitmapDrawer::BitmapDrawer(BBitmap* bitmap)
 	bitmap_bits = (uint32*)bitmap->Bits();
 	bitmap_bpr = bitmap->BytesPerRow() / 4;
 	bitmap_data_length = bitmap->BitsLength();
+
+	_PrepareDraw(NULL);
+}
+
+
+void
+BitmapDrawer::_PrepareDraw(Selection* sel)
+{
+	// The pixels that may be drawn. Like Selection::ContainsPoint(), any
+	// selection excludes the negative coordinates.
+	clip_left = (int32)bitmap_bounds.left;
+	clip_top = (int32)bitmap_bounds.top;
+	clip_right = (int32)bitmap_bounds.right;
+	clip_bottom = (int32)bitmap_bounds.bottom;
+
+	mask_bits = NULL;
+	mask_bpr = 0;
+
+	if (sel == NULL)
+		return;
+
+	clip_left = max_c(clip_left, 0);
+	clip_top = max_c(clip_top, 0);
+
+	if (sel->IsEmpty() == false) {
+		BBitmap* map = sel->ReturnSelectionMap();
+		BRect map_bounds = map->Bounds();
+		clip_right = min_c(clip_right, (int32)map_bounds.right);
+		clip_bottom = min_c(clip_bottom, (int32)map_bounds.bottom);
+
+		mask_bits = (uint8*)map->Bits();
+		mask_bpr = map->BytesPerRow();
+	}
+}
+
+
+template<class Operator>
+inline void
+BitmapDrawer::_SetPixel(int32 x, int32 y, uint32 color, Operator op)
+{
+	if (x < clip_left || x > clip_right || y < clip_top || y > clip_bottom)
+		return;
+
+	if (mask_bits != NULL) {
+		uint8 value = *(mask_bits + y * mask_bpr + x);
+		if (value == 0)
+			return;
+		color = scale_pixel_alpha(color, value);
+	}
+
+	uint32* target = bitmap_bits + x + y * bitmap_bpr;
+	*target = op(*target, color);
+}
+
+
+template<class Operator>
+inline void
+BitmapDrawer::_SetPixel(BPoint location, uint32 color, Operator op)
+{
+	if (bitmap_bounds.Contains(location))
+		_SetPixel((int32)location.x, (int32)location.y, color, op);
+}
+
+
+template<class Operator>
+void
+BitmapDrawer::_FillSpan(int32 left, int32 right, int32 y, uint32 color, Operator op)
+{
+	if (y < clip_top || y > clip_bottom)
+		return;
+
+	left = max_c(left, clip_left);
+	right = min_c(right, clip_right);
+	if (left > right)
+		return;
+
+	uint32* target = bitmap_bits + left + y * bitmap_bpr;
+	if (mask_bits == NULL) {
+		for (int32 x = left; x <= right; x++, target++)
+			*target = op(*target, color);
+	} else {
+		const uint8* mask = mask_bits + y * mask_bpr;
+		for (int32 x = left; x <= right; x++, target++) {
+			if (mask[x] != 0)
+				*target = op(*target, scale_pixel_alpha(color, mask[x]));
+		}
+	}
 }
 
 
 status_t
 BitmapDrawer::DrawHairLine(BPoint start, BPoint end, uint32 color, bool anti_alias, Selection* sel,
 	uint32 (*composite_func)(uint32, uint32))
+{
+	_PrepareDraw(sel);
+	RETURN_WITH_COMPOSITE_OPERATOR(composite_func, _DrawHairLine,
+		start, end, color, anti_alias, sel);
+}
+
+
+template<class Operator>
+status_t
+BitmapDrawer::_DrawHairLine(BPoint start, BPoint end, uint32 color, bool anti_alias, Selection* sel,
+	Operator op)
 {
 	// This function only draws lines with width of 1.
 	// Always draw the lines from left to right or from top to bottom.
@@ -77,8 +176,8 @@ BitmapDrawer::DrawHairLine(BPoint start, BPoint end, uint32 color, bool anti_ali
 				color1.bytes[3] = alpha;
 				color2.bytes[3] += -alpha;
 
-				SetPixel(BPoint(x, ceil(y)), color2.word, sel, composite_func);
-				SetPixel(BPoint(x, floor(y)), color1.word, sel, composite_func);
+				_SetPixel(BPoint(x, ceil(y)), color2.word, op);
+				_SetPixel(BPoint(x, floor(y)), color1.word, op);
 				y += step_y;
 			}
 		} else {
@@ -99,8 +198,8 @@ BitmapDrawer::DrawHairLine(BPoint start, BPoint end, uint32 color, bool anti_ali
 				color1.bytes[3] = alpha;
 				color2.bytes[3] += -alpha;
 
-				SetPixel(BPoint(ceil(x), y), color1.word, sel, composite_func);
-				SetPixel(BPoint(floor(x), y), color2.word, sel, composite_func);
+				_SetPixel(BPoint(ceil(x), y), color1.word, op);
+				_SetPixel(BPoint(floor(x), y), color2.word, op);
 
 				x += step_x;
 			}
@@ -128,7 +227,7 @@ BitmapDrawer::DrawHairLine(BPoint start, BPoint end, uint32 color, bool anti_ali
 			int32 number_of_points = (int32)fabs(start.x - end.x) + 1;
 			float y_add = ((float)fabs(start.y - end.y)) / ((float)fabs(start.x - end.x));
 			for (int32 i = 0; i < number_of_points; i++) {
-				SetPixel(start, color, sel, composite_func);
+				_SetPixel(start, color, op);
 
 				start.x += sign_x;
 				start.y += sign_y * y_add;
@@ -137,7 +236,7 @@ BitmapDrawer::DrawHairLine(BPoint start, BPoint end, uint32 color, bool anti_ali
 			int32 number_of_points = (int32)fabs(start.y - end.y) + 1;
 			float x_add = ((float)fabs(start.x - end.x)) / ((float)fabs(start.y - end.y));
 			for (int32 i = 0; i < number_of_points; i++) {
-				SetPixel(start, color, sel, composite_func);
+				_SetPixel(start, color, op);
 
 				start.y += sign_y;
 				start.x += sign_x * x_add;
@@ -152,6 +251,17 @@ BitmapDrawer::DrawHairLine(BPoint start, BPoint end, uint32 color, bool anti_ali
 status_t
 BitmapDrawer::DrawLine(BPoint start, BPoint end, uint32 color, float width, bool anti_alias,
 	Selection* sel, uint32 (*composite_func)(uint32, uint32))
+{
+	_PrepareDraw(sel);
+	RETURN_WITH_COMPOSITE_OPERATOR(composite_func, _DrawLine,
+		start, end, color, width, anti_alias, sel);
+}
+
+
+template<class Operator>
+status_t
+BitmapDrawer::_DrawLine(BPoint start, BPoint end, uint32 color, float width, bool anti_alias,
+	Selection* sel, Operator op)
 {
 	// The line width is split in to two parts
 	float distance1_from_center = ceil((width - 1.0) / 2.0);
@@ -201,7 +311,7 @@ BitmapDrawer::DrawLine(BPoint start, BPoint end, uint32 color, float width, bool
 	point_list[3] = start - normal2;
 
 	// Then we fill the rectangle.
-	DrawRectanglePolygon(point_list, color, TRUE, anti_alias, sel, composite_func);
+	_DrawRectanglePolygon(point_list, color, TRUE, anti_alias, sel, op);
 
 	return B_OK;
 }
@@ -224,6 +334,18 @@ status_t
 BitmapDrawer::DrawEllipse(BRect rect, uint32 color,
 	bool fill, bool anti_alias, Selection *sel, float angle,
 	uint32 (*composite_func)(uint32, uint32))
+{
+	_PrepareDraw(sel);
+	RETURN_WITH_COMPOSITE_OPERATOR(composite_func, _DrawEllipse,
+		rect, color, fill, anti_alias, sel, angle);
+}
+
+
+template<class Operator>
+status_t
+BitmapDrawer::_DrawEllipse(BRect rect, uint32 color,
+	bool fill, bool anti_alias, Selection *sel, float angle,
+	Operator op)
 {
 	BPoint center;
 	center.x = floor(rect.left + (rect.right-rect.left) / 2.0);
@@ -233,7 +355,7 @@ BitmapDrawer::DrawEllipse(BRect rect, uint32 color,
 	float radius2 = rect.Height() / 2.;
 
 	if (radius1 == radius2 || (int32)angle % 180 == 0)
-		_DrawShearedEllipse(center, radius1, radius2, color, fill, anti_alias, 1, 0, sel, composite_func);
+		_DrawShearedEllipse(center, radius1, radius2, color, fill, anti_alias, 1, 0, sel, op);
 	else {
 		if (abs(angle) > 45) {
 			uint32 temp = radius1;
@@ -248,17 +370,18 @@ BitmapDrawer::DrawEllipse(BRect rect, uint32 color,
 		float shear_dy = (radius1 * cos(theta) * sin(angle)) + (radius2 * sin(theta) * cos(angle));
 		float shear_x = abs(shear_dx);
 		float shear_y = (radius2 * radius1) / shear_x;
-		_DrawShearedEllipse(center, floor(shear_x), floor(shear_y), color, fill, anti_alias, shear_dx, shear_dy, sel, composite_func);
+		_DrawShearedEllipse(center, floor(shear_x), floor(shear_y), color, fill, anti_alias, shear_dx, shear_dy, sel, op);
 	}
 
 	return B_OK;
 }
 
 
+template<class Operator>
 status_t
 BitmapDrawer::_DrawShearedEllipse(BPoint center, float width, float height, uint32 color,
 	bool fill, bool anti_alias, float shear_dx, float shear_dy, Selection* sel,
-	uint32 (*composite_func)(uint32, uint32))
+	Operator op)
 {
 	if (shear_dx != 0) {
 		float a_squared = width * width;
@@ -288,27 +411,27 @@ BitmapDrawer::_DrawShearedEllipse(BPoint center, float width, float height, uint
 			}
 
 			if (fill == true) {
-				_FillShearedColumn(center.x, center.y, x, 0 - fy, fy, shear_dx, shear_dy, color, sel, composite_func);
+				_FillShearedColumn(center.x, center.y, x, 0 - fy, fy, shear_dx, shear_dy, color, op);
 				if (x != 0)
-					_FillShearedColumn(center.x, center.y, 0 - x, 0 - fy, fy, shear_dx, shear_dy, color, sel, composite_func);
+					_FillShearedColumn(center.x, center.y, 0 - x, 0 - fy, fy, shear_dx, shear_dy, color, op);
 
 				if (anti_alias == true) {
-					_SetShearedPixel(center.x, center.y, x, 0 - fy - 1, shear_dx, shear_dy, color2.word, sel, composite_func);
-					_SetShearedPixel(center.x, center.y, 0 - x, 0 - fy - 1, shear_dx, shear_dy, color2.word, sel, composite_func);
-					_SetShearedPixel(center.x, center.y, x, fy + 1, shear_dx, shear_dy, color2.word, sel, composite_func);
-					_SetShearedPixel(center.x, center.y, 0 - x, fy + 1, shear_dx, shear_dy, color2.word, sel, composite_func);
+					_SetShearedPixel(center.x, center.y, x, 0 - fy - 1, shear_dx, shear_dy, color2.word, op);
+					_SetShearedPixel(center.x, center.y, 0 - x, 0 - fy - 1, shear_dx, shear_dy, color2.word, op);
+					_SetShearedPixel(center.x, center.y, x, fy + 1, shear_dx, shear_dy, color2.word, op);
+					_SetShearedPixel(center.x, center.y, 0 - x, fy + 1, shear_dx, shear_dy, color2.word, op);
 				}
 			} else {
-				_SetShearedPixel(center.x, center.y, x, fy, shear_dx, shear_dy, color1.word, sel, composite_func);
-				_SetShearedPixel(center.x, center.y, 0 - x, fy, shear_dx, shear_dy, color1.word, sel, composite_func);
-				_SetShearedPixel(center.x, center.y, x, 0 - fy, shear_dx, shear_dy, color1.word, sel, composite_func);
-				_SetShearedPixel(center.x, center.y, 0 - x, 0 - fy, shear_dx, shear_dy, color1.word, sel, composite_func);
+				_SetShearedPixel(center.x, center.y, x, fy, shear_dx, shear_dy, color1.word, op);
+				_SetShearedPixel(center.x, center.y, 0 - x, fy, shear_dx, shear_dy, color1.word, op);
+				_SetShearedPixel(center.x, center.y, x, 0 - fy, shear_dx, shear_dy, color1.word, op);
+				_SetShearedPixel(center.x, center.y, 0 - x, 0 - fy, shear_dx, shear_dy, color1.word, op);
 
 				if (anti_alias == true) {
-					_SetShearedPixel(center.x, center.y, x, fy + 1, shear_dx, shear_dy, color2.word, sel, composite_func);
-					_SetShearedPixel(center.x, center.y, 0 - x, fy + 1, shear_dx, shear_dy, color2.word, sel, composite_func);
-					_SetShearedPixel(center.x, center.y, x, 0 - fy - 1, shear_dx, shear_dy, color2.word, sel, composite_func);
-					_SetShearedPixel(center.x, center.y, 0 - x, 0 - fy - 1, shear_dx, shear_dy, color2.word, sel, composite_func);
+					_SetShearedPixel(center.x, center.y, x, fy + 1, shear_dx, shear_dy, color2.word, op);
+					_SetShearedPixel(center.x, center.y, 0 - x, fy + 1, shear_dx, shear_dy, color2.word, op);
+					_SetShearedPixel(center.x, center.y, x, 0 - fy - 1, shear_dx, shear_dy, color2.word, op);
+					_SetShearedPixel(center.x, center.y, 0 - x, 0 - fy - 1, shear_dx, shear_dy, color2.word, op);
 				}
 			}
 		}
@@ -335,28 +458,28 @@ BitmapDrawer::_DrawShearedEllipse(BPoint center, float width, float height, uint
 
 			if (fill == true) {
 				if (pfx != fx) {
-					_FillShearedColumn(center.x, center.y, fx, 0 - y, y, shear_dx, shear_dy, color, sel, composite_func);
-					_FillShearedColumn(center.x, center.y, 0 - fx, 0 - y, y, shear_dx, shear_dy, color, sel, composite_func);
+					_FillShearedColumn(center.x, center.y, fx, 0 - y, y, shear_dx, shear_dy, color, op);
+					_FillShearedColumn(center.x, center.y, 0 - fx, 0 - y, y, shear_dx, shear_dy, color, op);
 					pfx = fx;
 				}
 
 				if (anti_alias == true) {
-					_SetShearedPixel(center.x, center.y, fx + 1, y, shear_dx, shear_dy, color2.word, sel, composite_func);
-					_SetShearedPixel(center.x, center.y, 0 - fx - 1, y, shear_dx, shear_dy, color2.word, sel, composite_func);
-					_SetShearedPixel(center.x, center.y, fx + 1, 0 - y, shear_dx, shear_dy, color2.word, sel, composite_func);
-					_SetShearedPixel(center.x, center.y, 0 - fx - 1, 0 - y, shear_dx, shear_dy, color2.word, sel, composite_func);
+					_SetShearedPixel(center.x, center.y, fx + 1, y, shear_dx, shear_dy, color2.word, op);
+					_SetShearedPixel(center.x, center.y, 0 - fx - 1, y, shear_dx, shear_dy, color2.word, op);
+					_SetShearedPixel(center.x, center.y, fx + 1, 0 - y, shear_dx, shear_dy, color2.word, op);
+					_SetShearedPixel(center.x, center.y, 0 - fx - 1, 0 - y, shear_dx, shear_dy, color2.word, op);
 				}
 			} else {
-				_SetShearedPixel(center.x, center.y, fx, y, shear_dx, shear_dy, color1.word, sel, composite_func);
-				_SetShearedPixel(center.x, center.y, 0 - fx, y, shear_dx, shear_dy, color1.word, sel, composite_func);
-				_SetShearedPixel(center.x, center.y, fx, 0 - y, shear_dx, shear_dy, color1.word, sel, composite_func);
-				_SetShearedPixel(center.x, center.y, 0 - fx, 0 - y, shear_dx, shear_dy, color1.word, sel, composite_func);
+				_SetShearedPixel(center.x, center.y, fx, y, shear_dx, shear_dy, color1.word, op);
+				_SetShearedPixel(center.x, center.y, 0 - fx, y, shear_dx, shear_dy, color1.word, op);
+				_SetShearedPixel(center.x, center.y, fx, 0 - y, shear_dx, shear_dy, color1.word, op);
+				_SetShearedPixel(center.x, center.y, 0 - fx, 0 - y, shear_dx, shear_dy, color1.word, op);
 
 				if (anti_alias == true) {
-					_SetShearedPixel(center.x, center.y, fx + 1, y, shear_dx, shear_dy, color2.word, sel, composite_func);
-					_SetShearedPixel(center.x, center.y, 0 - fx - 1, y, shear_dx, shear_dy, color2.word, sel, composite_func);
-					_SetShearedPixel(center.x, center.y, fx + 1, 0 - y, shear_dx, shear_dy, color2.word, sel, composite_func);
-					_SetShearedPixel(center.x, center.y, 0 - fx - 1, 0 - y, shear_dx, shear_dy, color2.word, sel, composite_func);
+					_SetShearedPixel(center.x, center.y, fx + 1, y, shear_dx, shear_dy, color2.word, op);
+					_SetShearedPixel(center.x, center.y, 0 - fx - 1, y, shear_dx, shear_dy, color2.word, op);
+					_SetShearedPixel(center.x, center.y, fx + 1, 0 - y, shear_dx, shear_dy, color2.word, op);
+					_SetShearedPixel(center.x, center.y, 0 - fx - 1, 0 - y, shear_dx, shear_dy, color2.word, op);
 				}
 			}
 		}
@@ -366,10 +489,10 @@ BitmapDrawer::_DrawShearedEllipse(BPoint center, float width, float height, uint
 }
 
 
+template<class Operator>
 void
 BitmapDrawer::_SetShearedPixel(int32 x, int32 y, int32 dx, int32 dy,
-	float shear_dx, float shear_dy, uint32 color, Selection* sel,
-	uint32 (*composite_func)(uint32, uint32))
+	float shear_dx, float shear_dy, uint32 color, Operator op)
 {
 	float shear_delta = ((float)dx * shear_dy) / shear_dx;
 	int32 x0 = x + dx;
@@ -381,14 +504,15 @@ BitmapDrawer::_SetShearedPixel(int32 x, int32 y, int32 dx, int32 dy,
 	if (y0 < 0)
 		y0 = 0;
 
-	SetPixel(x0, y0, color, sel, composite_func);
+	_SetPixel(x0, y0, color, op);
 }
 
 
+template<class Operator>
 void
 BitmapDrawer::_FillShearedColumn(int32 x, int32 y, int32 dx, int32 dy0,
 	int32 dy1, float shear_dx, float shear_dy, uint32 color,
-	Selection* sel, uint32 (*composite_func)(uint32, uint32))
+	Operator op)
 {
 	float shear_delta = ((float)dx * shear_dy) / shear_dx;
 	int32 x0 = x + dx;
@@ -408,7 +532,7 @@ BitmapDrawer::_FillShearedColumn(int32 x, int32 y, int32 dx, int32 dy0,
 	}
 
 	for (int32 yy = y0; yy <= y1; ++yy)
-		SetPixel(x0, yy, color, sel, composite_func);
+		_SetPixel(x0, yy, color, op);
 }
 
 
@@ -610,6 +734,17 @@ BitmapDrawer::MaximumCrossingPoint(BPoint& start, BPoint& end, int32 y)
 status_t
 BitmapDrawer::DrawRectanglePolygon(BPoint* corners, uint32 color, bool fill, bool anti_alias,
 	Selection* sel, uint32 (*composite_func)(uint32, uint32))
+{
+	_PrepareDraw(sel);
+	RETURN_WITH_COMPOSITE_OPERATOR(composite_func, _DrawRectanglePolygon,
+		corners, color, fill, anti_alias, sel);
+}
+
+
+template<class Operator>
+status_t
+BitmapDrawer::_DrawRectanglePolygon(BPoint* corners, uint32 color, bool fill, bool anti_alias,
+	Selection* sel, Operator op)
 {
 	// This is a special-case of the convex-polygon function that draws polygons that are
 	// rectangular. In addition to the convex polygon case we can use the following simplifications:
@@ -636,15 +771,15 @@ BitmapDrawer::DrawRectanglePolygon(BPoint* corners, uint32 color, bool fill, boo
 		corners[3].x = round(corners[3].x);
 		corners[3].y = round(corners[3].y);
 
-		DrawHairLine(corners[0], corners[1], color, anti_alias, sel, composite_func);
-		DrawHairLine(corners[1], corners[2], color, anti_alias, sel, composite_func);
-		DrawHairLine(corners[2], corners[3], color, anti_alias, sel, composite_func);
-		DrawHairLine(corners[3], corners[0], color, anti_alias, sel, composite_func);
+		_DrawHairLine(corners[0], corners[1], color, anti_alias, sel, op);
+		_DrawHairLine(corners[1], corners[2], color, anti_alias, sel, op);
+		_DrawHairLine(corners[2], corners[3], color, anti_alias, sel, op);
+		_DrawHairLine(corners[3], corners[0], color, anti_alias, sel, op);
 	} else {
 		if (anti_alias == TRUE)
-			FillAntiAliasedRectangle(corners, color, sel, composite_func);
+			_FillAntiAliasedRectangle(corners, color, sel, op);
 		else
-			FillRectangle(corners, color, sel, composite_func);
+			_FillRectangle(corners, color, sel, op);
 	}
 
 	return B_OK;
@@ -654,6 +789,17 @@ BitmapDrawer::DrawRectanglePolygon(BPoint* corners, uint32 color, bool fill, boo
 status_t
 BitmapDrawer::FillAntiAliasedRectangle(
 	BPoint* corners, uint32 color, Selection* sel, uint32 (*composite_func)(uint32, uint32))
+{
+	_PrepareDraw(sel);
+	RETURN_WITH_COMPOSITE_OPERATOR(composite_func, _FillAntiAliasedRectangle,
+		corners, color, sel);
+}
+
+
+template<class Operator>
+status_t
+BitmapDrawer::_FillAntiAliasedRectangle(
+	BPoint* corners, uint32 color, Selection* sel, Operator op)
 {
 	// If the rectangle is aligned with the coordinate axis we do not need to
 	// do much.
@@ -664,10 +810,8 @@ BitmapDrawer::FillAntiAliasedRectangle(
 		int32 min_y = (int32)round(min_c(corners[0].y, corners[2].y));
 		int32 max_y = (int32)round(max_c(corners[0].y, corners[2].y));
 
-		for (int32 y = min_y; y <= max_y; y++) {
-			for (int32 x = min_x; x <= max_x; x++)
-				SetPixel(BPoint(x, y), color, sel, composite_func);
-		}
+		for (int32 y = min_y; y <= max_y; y++)
+			_FillSpan(min_x, max_x, y, color, op);
 	}
 	// If the rectangle is not rectilinear we must sort the points
 	// and then fill the resulting rectangular polygon. This is almost
@@ -758,10 +902,10 @@ BitmapDrawer::FillAntiAliasedRectangle(
 							}
 							norm_color.bytes[3] = (uint8)(
 								alpha * ((float(coverage)) / (SUBPIXEL_AMOUNT * SUBPIXEL_AMOUNT)));
-							SetPixel(x, int32(y), norm_color.word, sel, composite_func);
+							_SetPixel(x, int32(y), norm_color.word, op);
 							max_coverage = max_c(coverage, max_coverage);
 						} else
-							SetPixel(x, int32(y), color, sel, composite_func);
+							_SetPixel(x, int32(y), color, op);
 					}
 				}
 				y++;
@@ -804,10 +948,10 @@ BitmapDrawer::FillAntiAliasedRectangle(
 								}
 								norm_color.bytes[3] = (uint8)(alpha
 									* ((float(coverage)) / (SUBPIXEL_AMOUNT * SUBPIXEL_AMOUNT)));
-								SetPixel(x, int32(y), norm_color.word, sel, composite_func);
+								_SetPixel(x, int32(y), norm_color.word, op);
 								max_coverage = max_c(coverage, max_coverage);
 							} else
-								SetPixel(x, int32(y), color, sel, composite_func);
+								_SetPixel(x, int32(y), color, op);
 						}
 					}
 					y++;
@@ -845,10 +989,10 @@ BitmapDrawer::FillAntiAliasedRectangle(
 								}
 								norm_color.bytes[3] = (uint8)(alpha
 									* ((float(coverage)) / (SUBPIXEL_AMOUNT * SUBPIXEL_AMOUNT)));
-								SetPixel(x, int32(y), norm_color.word, sel, composite_func);
+								_SetPixel(x, int32(y), norm_color.word, op);
 								max_coverage = max_c(coverage, max_coverage);
 							} else
-								SetPixel(x, int32(y), color, sel, composite_func);
+								_SetPixel(x, int32(y), color, op);
 						}
 					}
 					y++;
@@ -894,10 +1038,10 @@ BitmapDrawer::FillAntiAliasedRectangle(
 							}
 							norm_color.bytes[3] = (uint8)(
 								alpha * ((float(coverage)) / (SUBPIXEL_AMOUNT * SUBPIXEL_AMOUNT)));
-							SetPixel(x, int32(y), norm_color.word, sel, composite_func);
+							_SetPixel(x, int32(y), norm_color.word, op);
 							max_coverage = max_c(coverage, max_coverage);
 						} else
-							SetPixel(x, int32(y), color, sel, composite_func);
+							_SetPixel(x, int32(y), color, op);
 					}
 				}
 				y++;
@@ -929,10 +1073,10 @@ BitmapDrawer::FillAntiAliasedRectangle(
 							}
 							norm_color.bytes[3] = (uint8)(
 								alpha * ((float(coverage)) / (SUBPIXEL_AMOUNT * SUBPIXEL_AMOUNT)));
-							SetPixel(x, int32(y), norm_color.word, sel, composite_func);
+							_SetPixel(x, int32(y), norm_color.word, op);
 							max_coverage = max_c(coverage, max_coverage);
 						} else
-							SetPixel(x, int32(y), color, sel, composite_func);
+							_SetPixel(x, int32(y), color, op);
 					}
 				}
 				y++;
@@ -974,11 +1118,11 @@ BitmapDrawer::FillAntiAliasedRectangle(
 								}
 								norm_color.bytes[3] = (uint8)(alpha
 									* ((float(coverage)) / (SUBPIXEL_AMOUNT * SUBPIXEL_AMOUNT)));
-								SetPixel(x, int32(y), norm_color.word, sel, composite_func);
+								_SetPixel(x, int32(y), norm_color.word, op);
 
 								max_coverage = max_c(coverage, max_coverage);
 							} else
-								SetPixel(x, int32(y), color, sel, composite_func);
+								_SetPixel(x, int32(y), color, op);
 						}
 					}
 					y++;
@@ -1016,10 +1160,10 @@ BitmapDrawer::FillAntiAliasedRectangle(
 								}
 								norm_color.bytes[3] = (uint8)(alpha
 									* ((float(coverage)) / (SUBPIXEL_AMOUNT * SUBPIXEL_AMOUNT)));
-								SetPixel(x, int32(y), norm_color.word, sel, composite_func);
+								_SetPixel(x, int32(y), norm_color.word, op);
 								max_coverage = max_c(coverage, max_coverage);
 							} else
-								SetPixel(x, int32(y), color, sel, composite_func);
+								_SetPixel(x, int32(y), color, op);
 						}
 					}
 					y++;
@@ -1065,10 +1209,10 @@ BitmapDrawer::FillAntiAliasedRectangle(
 							}
 							norm_color.bytes[3] = (uint8)(
 								alpha * ((float(coverage)) / (SUBPIXEL_AMOUNT * SUBPIXEL_AMOUNT)));
-							SetPixel(x, int32(y), norm_color.word, sel, composite_func);
+							_SetPixel(x, int32(y), norm_color.word, op);
 							max_coverage = max_c(coverage, max_coverage);
 						} else
-							SetPixel(x, int32(y), color, sel, composite_func);
+							_SetPixel(x, int32(y), color, op);
 					}
 				}
 				y++;
@@ -1084,6 +1228,17 @@ BitmapDrawer::FillAntiAliasedRectangle(
 status_t
 BitmapDrawer::FillRectangle(
 	BPoint* corners, uint32 color, Selection* sel, uint32 (*composite_func)(uint32, uint32))
+{
+	_PrepareDraw(sel);
+	RETURN_WITH_COMPOSITE_OPERATOR(composite_func, _FillRectangle,
+		corners, color, sel);
+}
+
+
+template<class Operator>
+status_t
+BitmapDrawer::_FillRectangle(
+	BPoint* corners, uint32 color, Selection* sel, Operator op)
 {
 	// If the rectangle is aligned with the coordinate axis we do not need to
 	// do much.
@@ -1094,10 +1249,8 @@ BitmapDrawer::FillRectangle(
 		int32 min_y = (int32)round(min_c(corners[0].y, corners[2].y));
 		int32 max_y = (int32)round(max_c(corners[0].y, corners[2].y));
 		// Then fill the rectangle.
-		for (int32 y = min_y; y <= max_y; y++) {
-			for (int32 x = min_x; x <= max_x; x++)
-				SetPixel(BPoint(x, y), color, sel, composite_func);
-		}
+		for (int32 y = min_y; y <= max_y; y++)
+			_FillSpan(min_x, max_x, y, color, op);
 	}
 	// If the rectanle is not rectilinear we must sort the points
 	// and then fill the resulting rectangular polygon.
@@ -1149,8 +1302,7 @@ BitmapDrawer::FillRectangle(
 				int32 left_bound = (int32)max_c(ceil(span_left), absolute_left);
 				int32 right_bound = (int32)min_c(absolute_right, floor(span_right));
 
-				for (int32 x = left_bound; x <= right_bound; x++)
-					SetPixel(x, int32(y), color, sel, composite_func);
+				_FillSpan(left_bound, right_bound, int32(y), color, op);
 			}
 			y++;
 			span_left += left_diff;
@@ -1173,8 +1325,7 @@ BitmapDrawer::FillRectangle(
 				int32 left_bound = (int32)max_c(ceil(span_left), absolute_left);
 				int32 right_bound = (int32)min_c(absolute_right, floor(span_right));
 
-				for (int32 x = left_bound; x <= right_bound; x++)
-					SetPixel(x, int32(y), color, sel, composite_func);
+				_FillSpan(left_bound, right_bound, int32(y), color, op);
 			}
 			y++;
 			span_left += left_diff;
@@ -1196,8 +1347,7 @@ BitmapDrawer::FillRectangle(
 				int32 left_bound = (int32)max_c(ceil(span_left), absolute_left);
 				int32 right_bound = (int32)min_c(absolute_right, floor(span_right));
 
-				for (int32 x = left_bound; x <= right_bound; x++)
-					SetPixel(x, int32(y), color, sel, composite_func);
+				_FillSpan(left_bound, right_bound, int32(y), color, op);
 			}
 			y++;
 			span_left += left_diff;
@@ -1209,47 +1359,26 @@ BitmapDrawer::FillRectangle(
 }
 
 
+template<class Operator>
 status_t
-BitmapDrawer::SetPixel(
-	BPoint location, uint32 color, Selection* sel, uint32 (*composite_func)(uint32, uint32))
+BitmapDrawer::_SetSinglePixel(BPoint location, uint32 color, Operator op)
 {
-	if (sel == NULL || sel->ContainsPoint(location)) {
-		float sel_alpha = 1.0;
-		if (sel != NULL && sel->IsEmpty() == false)
-			sel_alpha = sel->Value(location) / 255.;
-
-		if (bitmap_bounds.Contains(location)) {
-			if (composite_func) {
-				union {
-					unsigned char bytes[4];
-					uint32 word;
-				} norm_color, target_color;
-
-				norm_color.word = color;
-				norm_color.bytes[3] *= sel_alpha;
-
-				uint32 target = GetPixel(location);
-				target_color.word = target;
-
-				*(bitmap_bits + (int32)location.x + (int32)location.y * bitmap_bpr)
-					= (*composite_func)(target_color.word, norm_color.word);
-			} else {
-				union {
-					unsigned char bytes[4];
-					uint32 word;
-				} norm_color;
-
-				norm_color.word = color;
-				norm_color.bytes[3] *= sel_alpha;
+	_SetPixel(location, color, op);
+	return B_OK;
+}
 
-				*(bitmap_bits + (int32)location.x + (int32)location.y * bitmap_bpr) = norm_color.word;
-			}
 
-			return B_OK;
-		} else
-			return B_ERROR;
-	} else
+status_t
+BitmapDrawer::SetPixel(
+	BPoint location, uint32 color, Selection* sel, uint32 (*composite_func)(uint32, uint32))
+{
+	if (bitmap_bounds.Contains(location) == false
+		|| (sel != NULL && sel->ContainsPoint(location) == false))
 		return B_ERROR;
+
+	_PrepareDraw(sel);
+	RETURN_WITH_COMPOSITE_OPERATOR(composite_func, _SetSinglePixel,
+		location, color);
 }
 
 
@@ -28,6 +28,60 @@ class BitmapDrawer {
 	float		MinimumCrossingPoint(BPoint&, BPoint&, int32);
 	float		MaximumCrossingPoint(BPoint&, BPoint&, int32);
 
+	// The area that can be drawn to and the selection mask, set up once
+	// per call by _PrepareDraw(). mask_bits is NULL when nothing is
+	// selected.
+	int32		clip_left;
+	int32		clip_top;
+	int32		clip_right;
+	int32		clip_bottom;
+	uint8*		mask_bits;
+	int32		mask_bpr;
+
+	void		_PrepareDraw(Selection* sel);
+
+	// The public functions choose the operator for their composite_func
+	// and call these. See CompositeOperators.h.
+	template<class Operator>
+	status_t	_DrawHairLine(BPoint, BPoint, uint32, bool anti_alias,
+					Selection* sel, Operator op);
+	template<class Operator>
+	status_t	_DrawLine(BPoint, BPoint, uint32, float, bool anti_alias,
+					Selection* sel, Operator op);
+	template<class Operator>
+	status_t	_DrawEllipse(BRect, uint32, bool fill, bool anti_alias,
+					Selection* sel, float angle, Operator op);
+	template<class Operator>
+	status_t	_DrawShearedEllipse(BPoint center, float width, float height,
+					uint32 color, bool fill, bool anti_alias, float shear_dx,
+					float shear_dy, Selection* sel, Operator op);
+	template<class Operator>
+	void		_SetShearedPixel(int32 x, int32 y, int32 dx, int32 dy,
+					float shear_dx, float shear_dy, uint32 color, Operator op);
+	template<class Operator>
+	void		_FillShearedColumn(int32 x, int32 y, int32 dx, int32 dy0,
+					int32 dy1, float shear_dx, float shear_dy, uint32 color,
+					Operator op);
+	template<class Operator>
+	status_t	_DrawRectanglePolygon(BPoint*, uint32, bool fill,
+					bool anti_alias, Selection* sel, Operator op);
+	template<class Operator>
+	status_t	_FillAntiAliasedRectangle(BPoint*, uint32, Selection* sel,
+					Operator op);
+	template<class Operator>
+	status_t	_FillRectangle(BPoint*, uint32, Selection* sel, Operator op);
+
+	template<class Operator>
+	inline void	_SetPixel(int32 x, int32 y, uint32 color, Operator op);
+	template<class Operator>
+	inline void	_SetPixel(BPoint location, uint32 color, Operator op);
+	template<class Operator>
+	status_t	_SetSinglePixel(BPoint location, uint32 color, Operator op);
+	// Draws the pixels from left to right on row y, clipped.
+	template<class Operator>
+	void		_FillSpan(int32 left, int32 right, int32 y, uint32 color,
+					Operator op);
+
 public:
 				BitmapDrawer(BBitmap*);
 
@@ -68,20 +122,6 @@ public:
 
 	uint32		GetPixel(BPoint location);
 	uint32		GetPixel(int32 x, int32 y);
-
-
-	status_t    _DrawShearedEllipse(BPoint center, float width, float height, uint32 color,
-                    bool fill, bool anti_alias, float shear_dx, float shear_dy, Selection* sel,
-                    uint32 (*composite_func)(uint32, uint32));
-    void        _SetShearedPixel(int32 x, int32 y, int32 dx, int32 dy,
-                    float shear_dx, float shear_dy, uint32 color,
-                    Selection* sel, uint32 (*composite_func)(uint32, uint32));
-    void        _FillShearedColumn(int32 x, int32 y, int32 dx, int32 dy0, int32 dy1,
-                    float shear_dx, float shear_dy, uint32 color,
-                    Selection* sel, uint32 (*composite_func)(uint32, uint32));
-    void        _FillShearedRow(int32 x, int32 y, int32 dx0, int32 dx1, int32 dy,
-                    float shear_dx, float shear_dy, uint32 color,
-                    Selection* sel, uint32 (*composite_func)(uint32, uint32));
 };
 
 
@@ -12,13 +12,15 @@
 
 #include "BlurTool.h"
 
-#include "BitmapDrawer.h"
 #include "Brush.h"
 #include "Cursors.h"
 #include "Image.h"
+#include "ImageUpdater.h"
 #include "ImageView.h"
+#include "KernelFilter.h"
 #include "NumberSliderControl.h"
 #include "PaintApplication.h"
+#include "PixelOperations.h"
 #include "Selection.h"
 #include "ToolManager.h"
 #include "ToolScript.h"
@@ -26,12 +28,18 @@
 
 #include <Catalog.h>
 #include <CheckBox.h>
+#include <RadioButton.h>
 #include <GridLayoutBuilder.h>
 #include <GroupLayoutBuilder.h>
 #include <SeparatorView.h>
 #include <Window.h>
 
 
+#include <math.h>
+#include <new>
+#include <string.h>
+
+
 #undef B_TRANSLATION_CONTEXT
 #define B_TRANSLATION_CONTEXT "Tools"
 
@@ -43,12 +51,15 @@ BlurTool::BlurTool()
 	:
 	DrawingTool(B_TRANSLATE("Blur tool"), "u", BLUR_TOOL)
 {
-	fOptions = SIZE_OPTION | CONTINUITY_OPTION | USE_BRUSH_OPTION;
-	fOptionsCount = 3;
+	fOptions = SIZE_OPTION | CONTINUITY_OPTION | USE_BRUSH_OPTION | MODE_OPTION
+		| WIDTH_OPTION;
+	fOptionsCount = 5;
 
 	SetOption(SIZE_OPTION, 1);
 	SetOption(CONTINUITY_OPTION, B_CONTROL_OFF);
 	SetOption(USE_BRUSH_OPTION, B_CONTROL_OFF);
+	SetOption(MODE_OPTION, HS_BLUR_MODE);
+	SetOption(WIDTH_OPTION, 1);
 }
 
 
@@ -56,208 +67,212 @@ ToolScript*
 BlurTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 {
 	/*
-		This function uses a convolution matrix to do the blurring.
-		The matrix is following:
-
-				1/9		1/9		1/9
-
-				1/9		1/9		1/9
-
-				1/9		1/9		1/9
+		The pixels under the dab are filtered with a KernelFilter. With
+		the radius 1 the blur is the average of the 3x3 neighbourhood, as
+		it has always been, and sharpening adds the difference of the pixel
+		and that average. The filter reads the bitmap as it is, so that
+		each dab works on the result of the previous ones.
 	*/
 	// Wait for the last_updated_region to become empty
 	while (LastUpdatedRect().IsValid())
 		snooze(50000);
 
 	BPoint prev_point;
-	bool prev_use_brush = false;
 	BWindow* window = view->Window();
 	BBitmap* bitmap = view->ReturnImage()->ReturnActiveBitmap();
-	BitmapDrawer* drawer = new BitmapDrawer(bitmap);
 
-	ToolScript* the_script
-		= new ToolScript(Type(), fToolSettings, ((PaintApplication*)be_app)->Color(true));
+	ToolScript* the_script = new (std::nothrow)
+		ToolScript(Type(), fToolSettings, ((PaintApplication*)be_app)->Color(true));
+	if (the_script == NULL)
+		return NULL;
 
 	selection = view->GetSelection();
 
-	BRect bounds = bitmap->Bounds();
-	uint32* bits_origin = (uint32*)bitmap->Bits();
-	int32 bpr = bitmap->BytesPerRow() / 4;
+	KernelFilter filter;
+	int32 previous_mode = 0;
+	int32 previous_radius = 0;
 
-	float width = fToolSettings.size;
-	float height = fToolSettings.size;
-	float half_width = (int32)width / 2;
-	float half_height = (int32)height / 2;
-	int32 previous_width = fToolSettings.size;
-	int32 previous_height = fToolSettings.size;
-
-	Brush* brush;
-	BBitmap* brush_bmap;
-	uint32* brush_bits = NULL;
-	uint32 brush_bpr = 0;
+	dab_buffers buffers;
 
-	if (fToolSettings.use_current_brush == true) {
-		brush = ToolManager::Instance().GetCurrentBrush();
-		brush_bmap = brush->GetBitmap();
-		brush_bits = (uint32*)brush_bmap->Bits();
-		brush_bpr = brush_bmap->BytesPerRow() / 4;
-		width = brush->Width();
-		height = brush->Height();
-		half_width = (width - 1) / 2;
-		half_height = (height - 1) / 2;
-		previous_width = width;
-		previous_height = height;
-		prev_use_brush = true;
-	}
-
-	// this is the bitmap where the blurred image will be first made
-	BBitmap* blurred = new BBitmap(BRect(0, 0, width + 1, height + 1), B_RGB_32_BIT);
-	int32* blurred_bits;
-	int32 blurred_bpr = blurred->BytesPerRow() / 4;
+	prev_point = point - BPoint(1, 1);
+	int32 previous_size = -1;
+	bool previous_use_brush = false;
 
-	BRect rc;
-	// for the quick calculation of square-roots
-	int32 sqrt_table[5500];
-	for (int32 i = 0; i < 5500; i++)
-		sqrt_table[i] = (int32)sqrt(i);
+	ImageUpdater* imageUpdater = new ImageUpdater(view, 20000);
 
-	prev_point = point - BPoint(1, 1);
 	SetLastUpdatedRect(BRect(point, point));
 	while (buttons) {
+		bool use_brush = (fToolSettings.use_current_brush == B_CONTROL_ON);
+		Brush* brush = use_brush ? ToolManager::Instance().GetCurrentBrush() : NULL;
+		if (brush == NULL)
+			use_brush = false;
+
+		if (fToolSettings.mode != previous_mode || fToolSettings.width != previous_radius) {
+			if (fToolSettings.mode == HS_SHARPEN_MODE)
+				filter.SetSharpen(fToolSettings.width, 100);
+			else
+				filter.SetBlur(fToolSettings.width);
+			previous_mode = fToolSettings.mode;
+			previous_radius = fToolSettings.width;
+		}
+
 		if ((fToolSettings.continuity == B_CONTROL_ON)
-			|| (fToolSettings.size != previous_width)
-			|| (fToolSettings.use_current_brush == true
-				&& (width != previous_width || height != previous_height))
+			|| (fToolSettings.size != previous_size)
+			|| (use_brush != previous_use_brush)
 			|| (point != prev_point)) {
-			if ((fToolSettings.use_current_brush == false && fToolSettings.size != previous_width)
-				|| (fToolSettings.use_current_brush != prev_use_brush)) {
-
-				delete blurred;
-				width = fToolSettings.size;
-				height = fToolSettings.size;
-				half_width = (int32)width / 2;
-				half_height = (int32)height / 2;
-				if (fToolSettings.use_current_brush == true) {
-					brush = ToolManager::Instance().GetCurrentBrush();
-					brush_bmap = brush->GetBitmap();
-					brush_bits = (uint32*)brush_bmap->Bits();
-					brush_bpr = brush_bmap->BytesPerRow() / 4;
-					width = brush->Width();
-					height = brush->Height();
-					half_width = (width - 1) / 2;
-					half_height = (height - 1) / 2;
-				}
-				blurred = new BBitmap(BRect(0, 0, width + 1, height + 1), B_RGB_32_BIT);
-				previous_width = width;
-				previous_height = height;
-				prev_use_brush = true;
-			} else
-				prev_use_brush = false;
-
-			blurred_bits = (int32*)blurred->Bits();
-
-			rc = BRect(point.x - half_width, point.y - half_height, point.x + half_width,
-				point.y + half_height);
-			rc = rc & bounds;
-
-			BPoint left_top = rc.LeftTop();
-			uint32 new_pixel;
-			float red, green, blue, alpha;
-			int32 x_dist, y_sqr;
-
-			int32 rc_width = rc.IntegerWidth();
-			int32 rc_height = rc.IntegerHeight();
-			if (fToolSettings.use_current_brush == true) {
-				rc_width -= 1;
-				rc_height -= 1;
-			}
+			previous_size = fToolSettings.size;
+			previous_use_brush = use_brush;
 
-			for (int32 y = 0; y < rc_height + 1; y++) {
-				y_sqr = (int32)(point.y - rc.top - y);
-				y_sqr *= y_sqr;
-				for (int32 x = 0; x < rc_width + 1; x++) {
-					x_dist = (int32)(point.x - rc.left - x);
-					float brush_val = 1.0;
-					if (fToolSettings.use_current_brush == true) {
-						union color_conversion brush_color;
-						brush_color.word = *(brush_bits + x + y * brush_bpr);
-						brush_val = brush_color.bytes[3];
-					}
-					if (((fToolSettings.use_current_brush == true && brush_val > 0.0)
-							|| (fToolSettings.use_current_brush == false
-								&& sqrt_table[x_dist * x_dist + y_sqr] <= half_width))
-						&& (selection == NULL || selection->IsEmpty()
-							|| selection->ContainsPoint(left_top + BPoint(x, y)))) {
-						red = 0;
-						green = 0;
-						blue = 0;
-						alpha = 0;
-						for (int32 dy = -1; dy < 2; dy++) {
-							for (int32 dx = -1; dx < 2; dx++) {
-								int32 x_coord
-									= (int32)min_c(max_c(left_top.x + x + dx, 0), rc.right);
-								int32 y_coord
-									= (int32)min_c(max_c(left_top.y + y + dy, 0), rc.bottom);
-								new_pixel = drawer->GetPixel(x_coord, y_coord);
-
-								blue += (float)((new_pixel >> 24) & 0xFF) / 9.0;
-								green += (float)((new_pixel >> 16) & 0xFF) / 9.0;
-								red += (float)((new_pixel >> 8) & 0xFF) / 9.0;
-								alpha += (float)((new_pixel) &0xFF) / 9.0;
-							}
-						}
-						// At this point we should round the values.
-						*blurred_bits = (uint32)blue << 24 | (uint32)green << 16
-							| (uint32)red << 8 | (uint32)alpha;
-					} else
-						*blurred_bits = drawer->GetPixel(left_top + BPoint(x, y));
-
-					blurred_bits++;
-				}
-				blurred_bits += blurred_bpr - (int32)rc.Width();
-			}
+			bitmap->Lock();
+			BRect rc = _FilterDab(bitmap, point, fToolSettings.size, brush, selection, filter,
+				buffers);
+			bitmap->Unlock();
 
-			blurred_bits = (int32*)blurred->Bits();
 			if (rc.IsValid()) {
-				for (int32 y = 0; y < rc_height + 1; y++) {
-					for (int32 x = 0; x < rc_width + 1; x++) {
-						*(bits_origin + (int32)(left_top.x + x) + (int32)((left_top.y + y) * bpr))
-							= *blurred_bits;
-						blurred_bits++;
-					}
-					blurred_bits += blurred_bpr - (int32)rc.Width();
-				}
-			}
+				imageUpdater->AddRect(rc);
+				SetLastUpdatedRect(LastUpdatedRect() | rc);
 
-			prev_point = point;
-			the_script->AddPoint(point);
-		} else
-			rc = BRect(0, 0, -1, -1);
+				prev_point = point;
+				the_script->AddPoint(point);
+				if (brush != NULL)
+					the_script->SetBrush(brush->GetInfo());
+			}
+		}
 
 		window->Lock();
-		if (rc.IsValid()) {
-			view->UpdateImage(rc);
-			view->Sync();
-			SetLastUpdatedRect(LastUpdatedRect() | rc);
-		}
 		view->getCoords(&point, &buttons);
 		window->Unlock();
 
 		snooze(20 * 1000);
 	}
-	delete blurred;
-	delete drawer;
+
+	imageUpdater->ForceUpdate();
+
+	delete imageUpdater;
 	return the_script;
 }
 
 
 int32
-BlurTool::UseToolWithScript(ToolScript*, BBitmap*)
+BlurTool::UseToolWithScript(ToolScript* script, BBitmap* bitmap)
 {
+	tool_settings* settings = script->ReturnSettings();
+
+	Brush* brush = NULL;
+	if (settings->use_current_brush == B_CONTROL_ON && script->ReturnBrush() != NULL) {
+		brush_info info = *script->ReturnBrush();
+		brush = new (std::nothrow) Brush(info);
+		if (brush == NULL)
+			return B_NO_MEMORY;
+	}
+
+	KernelFilter filter;
+	if (settings->mode == HS_SHARPEN_MODE)
+		filter.SetSharpen(settings->width, 100);
+	else
+		filter.SetBlur(settings->width);
+
+	// Each recorded point is a dab that was filtered.
+	dab_buffers buffers;
+	BPoint* points = script->ReturnPoints();
+	for (int32 i = 0; i < script->PointCount(); i++)
+		_FilterDab(bitmap, points[i], settings->size, brush, NULL, filter, buffers);
+
+	delete brush;
+
 	return B_OK;
 }
 
 
+BRect
+BlurTool::_FilterDab(BBitmap* bitmap, BPoint point, int32 size, Brush* brush,
+	Selection* selection, KernelFilter& filter, dab_buffers& buffers)
+{
+	float half_width = size / 2;
+	float half_height = half_width;
+	if (brush != NULL) {
+		half_width = (brush->Width() - 1) / 2;
+		half_height = (brush->Height() - 1) / 2;
+	}
+
+	BRect dab = BRect(floor(point.x - half_width), floor(point.y - half_height),
+		floor(point.x + half_width), floor(point.y + half_height));
+	BRect rc = dab & bitmap->Bounds();
+	if (rc.IsValid() == false)
+		return rc;
+
+	int32 rc_width = rc.IntegerWidth() + 1;
+	int32 rc_height = rc.IntegerHeight() + 1;
+	if (buffers.filtered.SetTo(rc, 4) != B_OK || buffers.mask.SetTo(rc, 1) != B_OK)
+		return BRect();
+
+	uint32* filtered = buffers.filtered.Row<uint32>(0);
+	uint8* mask = buffers.mask.Row<uint8>(0);
+	int32 filtered_stride = buffers.filtered.BytesPerRow() / 4;
+	int32 mask_stride = buffers.mask.BytesPerRow();
+
+	int32 left = (int32)rc.left;
+	int32 top = (int32)rc.top;
+	int32 point_x = (int32)point.x;
+	int32 point_y = (int32)point.y;
+
+	// A pixel is filtered if it is under the brush (or within the
+	// circle) and selected.
+	uint32* brush_bits = NULL;
+	int32 brush_bpr = 0;
+	int32 brush_left = 0;
+	int32 brush_top = 0;
+	BRect brush_bounds;
+	if (brush != NULL) {
+		BBitmap* brush_bmap = brush->GetBitmap();
+		brush_bits = (uint32*)brush_bmap->Bits();
+		brush_bpr = brush_bmap->BytesPerRow() / 4;
+		brush_bounds = brush_bmap->Bounds();
+		brush_left = (int32)(point.x - (brush->Width() - 1) / 2);
+		brush_top = (int32)(point.y - (brush->Height() - 1) / 2);
+	}
+
+	int32 half_size = size / 2;
+	int32 radius_sqr = (half_size + 1) * (half_size + 1);
+	for (int32 y = 0; y < rc_height; y++) {
+		uint8* mask_row = mask + y * mask_stride;
+		int32 dy = point_y - (top + y);
+		for (int32 x = 0; x < rc_width; x++) {
+			bool inside;
+			if (brush_bits != NULL) {
+				BPoint brush_point(left + x - brush_left, top + y - brush_top);
+				inside = false;
+				if (brush_bounds.Contains(brush_point)) {
+					union color_conversion brush_color;
+					brush_color.word = *(brush_bits + (int32)brush_point.x
+						+ (int32)brush_point.y * brush_bpr);
+					inside = brush_color.bytes[3] > 0;
+				}
+			} else {
+				int32 dx = point_x - (left + x);
+				inside = dx * dx + dy * dy < radius_sqr;
+			}
+
+			if (inside && selection != NULL && !selection->IsEmpty())
+				inside = selection->ContainsPoint(left + x, top + y);
+
+			mask_row[x] = inside ? 0xFF : 0x00;
+		}
+	}
+
+	uint32* bits_origin = (uint32*)bitmap->Bits();
+	int32 bpr = bitmap->BytesPerRow() / 4;
+
+	filter.Apply(bitmap, rc, mask, mask_stride, filtered, filtered_stride);
+	for (int32 y = 0; y < rc_height; y++) {
+		memcpy(bits_origin + (top + y) * bpr + left, filtered + y * filtered_stride,
+			rc_width * sizeof(uint32));
+	}
+
+	return rc;
+}
+
+
 BView*
 BlurTool::ConfigView()
 {
@@ -275,6 +290,9 @@ BlurTool::ToolCursor() const
 const char*
 BlurTool::HelpString(bool isInUse) const
 {
+	if (isInUse && fToolSettings.mode == HS_SHARPEN_MODE)
+		return B_TRANSLATE("Sharpening the image.");
+
 	return (isInUse ? B_TRANSLATE("Blurring the image.") : B_TRANSLATE("Blur tool"));
 }
 
@@ -301,23 +319,48 @@ BlurToolConfigView::BlurToolConfigView(DrawingTool* tool)
 
 		BGridLayout* sizeLayout = LayoutSliderGrid(fBlurSize);
 
+		message = new BMessage(OPTION_CHANGED);
+		message->AddInt32("option", WIDTH_OPTION);
+		message->AddInt32("value", tool->GetCurrentValue(WIDTH_OPTION));
+
+		fRadius = new NumberSliderControl(B_TRANSLATE("Radius:"), "1", message, 1, 20, false);
+
+		BGridLayout* radiusLayout = LayoutSliderGrid(fRadius);
+
 		message = new BMessage(OPTION_CHANGED);
 		message->AddInt32("option", USE_BRUSH_OPTION);
 		message->AddInt32("value", 0x00000000);
 		fUseBrush = new BCheckBox(B_TRANSLATE("Use current brush"), message);
 
+		message = new BMessage(OPTION_CHANGED);
+		message->AddInt32("option", MODE_OPTION);
+		message->AddInt32("value", HS_BLUR_MODE);
+
+		fBlur = new BRadioButton(B_TRANSLATE("Blur"), new BMessage(*message));
+
+		message->ReplaceInt32("value", HS_SHARPEN_MODE);
+		fSharpen = new BRadioButton(B_TRANSLATE("Sharpen"), message);
+
 		layout->AddView(BGroupLayoutBuilder(B_VERTICAL, kWidgetSpacing)
 			.Add(sizeLayout)
+			.Add(radiusLayout)
 			.Add(fUseBrush)
 			.AddStrut(kWidgetSpacing)
 			.Add(SeparatorView(B_TRANSLATE("Mode")))
 			.AddGroup(B_VERTICAL, kWidgetSpacing)
+				.Add(fBlur)
+				.Add(fSharpen)
 				.Add(fContinuity)
 				.SetInsets(kWidgetInset, 0.0, 0.0, 0.0)
 			.End()
 			.TopView()
 		);
 
+		if (tool->GetCurrentValue(MODE_OPTION) == HS_SHARPEN_MODE)
+			fSharpen->SetValue(B_CONTROL_ON);
+		else
+			fBlur->SetValue(B_CONTROL_ON);
+
 		if (tool->GetCurrentValue(CONTINUITY_OPTION) != B_CONTROL_OFF)
 			fContinuity->SetValue(B_CONTROL_ON);
 
@@ -334,6 +377,9 @@ BlurToolConfigView::AttachedToWindow()
 	DrawingToolConfigView::AttachedToWindow();
 
 	fBlurSize->SetTarget(this);
+	fRadius->SetTarget(this);
+	fBlur->SetTarget(this);
+	fSharpen->SetTarget(this);
 	fContinuity->SetTarget(this);
 	fUseBrush->SetTarget(this);
 }
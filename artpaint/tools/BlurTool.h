@@ -12,10 +12,14 @@
 #define BLUR_TOOL_H
 
 #include "DrawingTool.h"
+#include "PixelBuffer.h"
 
 
 class BCheckBox;
+class Brush;
+class BRadioButton;
 class ImageView;
+class KernelFilter;
 class Selection;
 
 
@@ -39,6 +43,18 @@ public:
 			const char*			HelpString(bool isInUse) const;
 
 private:
+	// The filtered dab and the pixels of the dab that are filtered. They
+	// are taken from the pool and grow when the dab does.
+	struct dab_buffers {
+		PixelBuffer	filtered;
+		PixelBuffer	mask;
+	};
+
+			BRect				_FilterDab(BBitmap* bitmap, BPoint point,
+									int32 size, Brush* brush,
+									Selection* selection, KernelFilter& filter,
+									dab_buffers& buffers);
+
 			Selection*			selection;
 };
 
@@ -53,6 +69,9 @@ public:
 
 private:
 			NumberSliderControl* fBlurSize;
+			NumberSliderControl* fRadius;
+			BRadioButton*		fBlur;
+			BRadioButton*		fSharpen;
 			BCheckBox*			fContinuity;
 			BCheckBox*			fUseBrush;
 };
@@ -23,7 +23,9 @@
 
 
 #include <math.h>
+#include <new>
 #include <stdio.h>
+#include <string.h>
 
 
 #define PI M_PI
@@ -54,6 +56,10 @@ Brush::Brush(brush_info& info)
 	angle_ = info.angle;
 
 	brush_span = NULL;
+	alpha_rows = NULL;
+	alpha_columns = NULL;
+	alpha_row_limits = NULL;
+	alpha_column_limits = NULL;
 
 	// Here call the function that makes the brush.
 	switch (shape_) {
@@ -68,6 +74,7 @@ Brush::Brush(brush_info& info)
 	}
 
 	brush_span = make_span_list();
+	make_alpha_planes();
 
 	BList polygons;
 	BitmapUtilities::RasterToPolygonsMoore(brush_bmap, brush_bmap->Bounds(), &polygons);
@@ -143,6 +150,7 @@ void
 Brush::CreateDiffBrushes()
 {
 	brush_span = make_span_list();
+	make_alpha_planes();
 }
 
 
@@ -359,6 +367,63 @@ Brush::make_span_list()
 }
 
 
+void
+Brush::make_alpha_planes()
+{
+	if (brush_bmap == NULL)
+		return;
+
+	alpha_width = (int32)ceil(width_);
+	alpha_height = (int32)ceil(height_);
+	int32 count = alpha_width * alpha_height;
+
+	alpha_rows = new (std::nothrow) uint8[count];
+	alpha_columns = new (std::nothrow) uint8[count];
+	alpha_row_limits = new (std::nothrow) int32[2 * alpha_height];
+	alpha_column_limits = new (std::nothrow) int32[2 * alpha_width];
+	if (alpha_rows == NULL || alpha_columns == NULL || alpha_row_limits == NULL
+		|| alpha_column_limits == NULL) {
+		delete[] alpha_rows;
+		delete[] alpha_columns;
+		delete[] alpha_row_limits;
+		delete[] alpha_column_limits;
+		alpha_rows = NULL;
+		alpha_columns = NULL;
+		alpha_row_limits = NULL;
+		alpha_column_limits = NULL;
+		return;
+	}
+
+	for (int32 y = 0; y < alpha_height; y++) {
+		alpha_row_limits[2 * y] = alpha_width;
+		alpha_row_limits[2 * y + 1] = -1;
+	}
+	for (int32 x = 0; x < alpha_width; x++) {
+		alpha_column_limits[2 * x] = alpha_height;
+		alpha_column_limits[2 * x + 1] = -1;
+	}
+
+	uint32* bits = (uint32*)brush_bmap->Bits();
+	uint32 bpr = brush_bmap->BytesPerRow() / 4;
+	for (int32 y = 0; y < alpha_height; y++) {
+		for (int32 x = 0; x < alpha_width; x++) {
+			union color_conversion color;
+			color.word = *(bits + x + y * bpr);
+			uint8 alpha = color.bytes[3];
+
+			alpha_rows[y * alpha_width + x] = alpha;
+			alpha_columns[x * alpha_height + y] = alpha;
+			if (alpha != 0) {
+				alpha_row_limits[2 * y] = min_c(alpha_row_limits[2 * y], x);
+				alpha_row_limits[2 * y + 1] = x;
+				alpha_column_limits[2 * x] = min_c(alpha_column_limits[2 * x], y);
+				alpha_column_limits[2 * x + 1] = y;
+			}
+		}
+	}
+}
+
+
 void
 Brush::delete_all_data()
 {
@@ -373,6 +438,15 @@ Brush::delete_all_data()
 			c = help;
 		}
 	}
+
+	delete[] alpha_rows;
+	delete[] alpha_columns;
+	delete[] alpha_row_limits;
+	delete[] alpha_column_limits;
+	alpha_rows = NULL;
+	alpha_columns = NULL;
+	alpha_row_limits = NULL;
+	alpha_column_limits = NULL;
 }
 
 
@@ -539,6 +613,174 @@ Brush::draw(BBitmap* buffer, BPoint point, Selection* selection)
 }
 
 
+// Dabs that are next to each other on the same row (or column) of the image
+// form a run.
+struct Brush::stamp_run {
+	int32	across;
+	int32	first;
+	int32	last;
+};
+
+
+// Runs up to this long are handled by drawing the brush line at each
+// position of the run.
+const int32 kDirectRunLength = 8;
+
+
+// Takes the maximum of source[i] over window consecutive positions: target[j]
+// becomes at least source[j - s] for each s between 0 and window - 1. The
+// work area must have room for 3 * (length + 2 * (window - 1)) values.
+static void
+dilate_line(const uint8* source, int32 length, int32 window, uint8* target, uint8* work)
+{
+	if (window <= kDirectRunLength) {
+		for (int32 s = 0; s < window; s++) {
+			uint8* t = target + s;
+			for (int32 i = 0; i < length; i++)
+				t[i] = max_c(t[i], source[i]);
+		}
+		return;
+	}
+
+	// The van Herk / Gil-Werman algorithm: the maximum of any window is the
+	// larger of a suffix maximum of one block and a prefix maximum of the
+	// next one, whatever the length of the window.
+	int32 padding = window - 1;
+	int32 count = length + 2 * padding;
+	uint8* padded = work;
+	uint8* prefix = work + count;
+	uint8* suffix = work + 2 * count;
+
+	memset(padded, 0, padding);
+	memcpy(padded + padding, source, length);
+	memset(padded + padding + length, 0, padding);
+
+	for (int32 i = 0; i < count; i++) {
+		if (i % window == 0)
+			prefix[i] = padded[i];
+		else
+			prefix[i] = max_c(prefix[i - 1], padded[i]);
+	}
+	for (int32 i = count - 1; i >= 0; i--) {
+		if (i == count - 1 || i % window == window - 1)
+			suffix[i] = padded[i];
+		else
+			suffix[i] = max_c(suffix[i + 1], padded[i]);
+	}
+
+	for (int32 j = 0; j < length + padding; j++)
+		target[j] = max_c(target[j], max_c(suffix[j], prefix[j + padding]));
+}
+
+
+void
+Brush::sweep_runs(BBitmap* buffer, Selection* selection, stamp_run* runs, int32 run_count,
+	bool horizontal, uint8* scratch)
+{
+	if (runs[0].across > runs[run_count - 1].across) {
+		for (int32 i = 0; i < run_count / 2; i++) {
+			stamp_run run = runs[i];
+			runs[i] = runs[run_count - 1 - i];
+			runs[run_count - 1 - i] = run;
+		}
+	}
+
+	// A horizontal line of the image is covered by the rows of the brush,
+	// a vertical one by its columns.
+	const uint8* plane = horizontal ? alpha_rows : alpha_columns;
+	const int32* limits = horizontal ? alpha_row_limits : alpha_column_limits;
+	int32 along_extent = horizontal ? alpha_width : alpha_height;
+	int32 across_extent = horizontal ? alpha_height : alpha_width;
+
+	int32 along_min = runs[0].first;
+	int32 along_max = runs[0].last;
+	for (int32 i = 0; i < run_count; i++) {
+		along_min = min_c(along_min, runs[i].first);
+		along_max = max_c(along_max, runs[i].last);
+	}
+
+	uint8* line = scratch;
+	uint8* work = scratch + along_max - along_min + along_extent;
+
+	BRect bounds = buffer->Bounds();
+	int32 along_low = (int32)(horizontal ? bounds.left : bounds.top);
+	int32 along_high = (int32)(horizontal ? bounds.right : bounds.bottom);
+	int32 across_low = (int32)(horizontal ? bounds.top : bounds.left);
+	int32 across_high = (int32)(horizontal ? bounds.bottom : bounds.right);
+
+	uint32* bits = (uint32*)buffer->Bits();
+	int32 bpr = buffer->BytesPerRow() / 4;
+	bool use_selection = (selection->IsEmpty() == false);
+
+	int32 first_run = 0;
+	int32 last_run = -1;
+	int32 end = min_c(runs[run_count - 1].across + across_extent - 1, across_high);
+	for (int32 l = runs[0].across; l <= end; l++) {
+		while (last_run + 1 < run_count && runs[last_run + 1].across <= l)
+			last_run++;
+		while (runs[first_run].across + across_extent <= l)
+			first_run++;
+
+		if (l < across_low)
+			continue;
+
+		// Only the part of the line that the runs reach is cleared.
+		int32 line_start = INT32_MAX;
+		int32 line_end = INT32_MIN;
+		for (int32 i = first_run; i <= last_run; i++) {
+			const int32* limit = limits + 2 * (l - runs[i].across);
+			if (limit[0] > limit[1])
+				continue;
+
+			line_start = min_c(line_start, runs[i].first + limit[0]);
+			line_end = max_c(line_end, runs[i].last + limit[1]);
+		}
+		if (line_start > line_end)
+			continue;
+
+		memset(line + line_start - along_min, 0, line_end - line_start + 1);
+		for (int32 i = first_run; i <= last_run; i++) {
+			int32 k = l - runs[i].across;
+			const int32* limit = limits + 2 * k;
+			if (limit[0] > limit[1])
+				continue;
+
+			dilate_line(plane + k * along_extent + limit[0], limit[1] - limit[0] + 1,
+				runs[i].last - runs[i].first + 1,
+				line + runs[i].first + limit[0] - along_min, work);
+		}
+
+		// Then each pixel is combined with the buffer once, in the same way
+		// as draw() does it.
+		line_start = max_c(line_start, along_low);
+		line_end = min_c(line_end, along_high);
+		for (int32 a = line_start; a <= line_end; a++) {
+			uint8 alpha = line[a - along_min];
+			if (alpha == 0)
+				continue;
+
+			int32 x = horizontal ? a : l;
+			int32 y = horizontal ? l : a;
+			if (use_selection) {
+				if (selection->ContainsPoint(x, y) == false)
+					continue;
+				float sel_alpha = selection->Value(x, y) / 255.;
+				alpha *= sel_alpha;
+			}
+
+			union color_conversion color;
+			uint32* target = bits + y * bpr + x;
+			color.word = *target;
+			color.bytes[0] = 0xFF;
+			color.bytes[1] = 0xFF;
+			color.bytes[2] = 0xFF;
+			color.bytes[3] = max_c(color.bytes[3], alpha);
+			*target = color.word;
+		}
+	}
+}
+
+
 BRect
 Brush::draw_line(BBitmap* buffer, BPoint start, BPoint end, Selection* selection)
 {
@@ -547,6 +789,9 @@ Brush::draw_line(BBitmap* buffer, BPoint start, BPoint end, Selection* selection
 	BRect a_rect = MakeRectFromPoints(start, end);
 	a_rect.InsetBy(-brush_width_per_2 - 1, -brush_height_per_2 - 1);
 
+	if (alpha_rows == NULL)
+		return a_rect;
+
 	// first check whether the line is longer in x direction than y
 	bool increase_x = fabs(start.x - end.x) >= fabs(start.y - end.y);
 
@@ -564,37 +809,72 @@ Brush::draw_line(BBitmap* buffer, BPoint start, BPoint end, Selection* selection
 	else
 		sign_y = 0;
 
-	int32 new_x, new_y;
-	BPoint last_point;
-
+	float x_add = sign_x;
+	float y_add = sign_y;
 	if (increase_x) {
-		float y_add = ((float)fabs(start.y - end.y)) / ((float)fabs(start.x - end.x));
+		y_add = sign_y * ((float)fabs(start.y - end.y)) / ((float)fabs(start.x - end.x));
 		number_of_points = (int32)fabs(start.x - end.x);
-		for (int32 i = 0; i < number_of_points; i++) {
-			last_point = start;
-			start.x += sign_x;
-			start.y += sign_y * y_add;
-			new_x = (int32)round(start.x);
-			new_y = (int32)round(start.y);
-
-			this->draw(
-				buffer, BPoint(new_x - brush_width_per_2, new_y - brush_height_per_2), selection);
-		}
 	} else {
-		float x_add = ((float)fabs(start.x - end.x)) / ((float)fabs(start.y - end.y));
+		x_add = sign_x * ((float)fabs(start.x - end.x)) / ((float)fabs(start.y - end.y));
 		number_of_points = (int32)fabs(start.y - end.y);
-		for (int32 i = 0; i < number_of_points; i++) {
-			last_point = start;
-			start.y += sign_y;
-			start.x += sign_x * x_add;
-			new_x = (int32)round(start.x);
-			new_y = (int32)round(start.y);
-
-			this->draw(
-				buffer, BPoint(new_x - brush_width_per_2, new_y - brush_height_per_2), selection);
+	}
+
+	if (number_of_points == 0)
+		return a_rect;
+
+	stamp_run* runs = new (std::nothrow) stamp_run[number_of_points];
+	if (runs == NULL)
+		return a_rect;
+
+	// The dabs are at the same points as they would be when drawing the line
+	// one dab at a time. Along the longer direction consecutive dabs are one
+	// pixel apart, so the dabs on the same row (or column) form runs.
+	int32 run_count = 0;
+	for (int32 i = 0; i < number_of_points; i++) {
+		start.x += x_add;
+		start.y += y_add;
+		int32 new_x = (int32)round(start.x) - brush_width_per_2;
+		int32 new_y = (int32)round(start.y) - brush_height_per_2;
+
+		int32 across = increase_x ? new_y : new_x;
+		int32 along = increase_x ? new_x : new_y;
+		// Rounding skips a position where the coordinate crosses zero, that
+		// starts a new run.
+		stamp_run* run = runs + run_count - 1;
+		if (run_count > 0 && run->across == across
+			&& (along == run->last + 1 || along == run->first - 1)) {
+			run->first = min_c(run->first, along);
+			run->last = max_c(run->last, along);
+		} else {
+			runs[run_count].across = across;
+			runs[run_count].first = along;
+			runs[run_count].last = along;
+			run_count++;
+		}
+	}
+
+	// The dabs span at most number_of_points pixels in the longer direction,
+	// and no run is longer than that.
+	int32 extent = max_c(alpha_width, alpha_height);
+	int32 scratch_size = number_of_points + extent
+		+ 3 * (extent + 2 * number_of_points);
+	uint8* scratch = new (std::nothrow) uint8[scratch_size];
+	if (scratch != NULL)
+		sweep_runs(buffer, selection, runs, run_count, increase_x, scratch);
+	else {
+		for (int32 i = 0; i < run_count; i++) {
+			for (int32 along = runs[i].first; along <= runs[i].last; along++) {
+				if (increase_x)
+					draw(buffer, BPoint(along, runs[i].across), selection);
+				else
+					draw(buffer, BPoint(runs[i].across, along), selection);
+			}
 		}
 	}
 
+	delete[] scratch;
+	delete[] runs;
+
 	return a_rect;
 }
 
@@ -82,6 +82,12 @@ class Brush {
 
 			void		reserve_brush();
 			span*		make_span_list();
+			void		make_alpha_planes();
+
+	struct	stamp_run;
+			void		sweep_runs(BBitmap* buffer, Selection* selection,
+							stamp_run* runs, int32 run_count, bool horizontal,
+							uint8* scratch);
 
 			void		delete_all_data();
 
@@ -93,6 +99,16 @@ class Brush {
 			HSPolygon**	shapes;
 			int32		num_shapes;
 
+			// The alpha values of the brush by rows and by columns, and the
+			// first and last non-zero value of each row and column. These are
+			// used by draw_line().
+			uint8*		alpha_rows;
+			uint8*		alpha_columns;
+			int32*		alpha_row_limits;
+			int32*		alpha_column_limits;
+			int32		alpha_width;
+			int32		alpha_height;
+
 public:
 						Brush(brush_info &info);
 						~Brush();
@@ -21,6 +21,7 @@
 #include "Image.h"
 #include "ImageUpdater.h"
 #include "ImageView.h"
+#include "MemoryBudget.h"
 #include "PaintApplication.h"
 #include "PixelOperations.h"
 #include "Selection.h"
@@ -68,12 +69,17 @@ BrushTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint viewPoi
 	if (coordinate_reader == NULL)
 		return NULL;
 
+	bool use_fg_color = true;
+	if (buttons == B_SECONDARY_MOUSE_BUTTON)
+		use_fg_color = false;
+
 	ToolScript* the_script = new (std::nothrow)
-		ToolScript(Type(), fToolSettings, ((PaintApplication*)be_app)->Color(true));
+		ToolScript(Type(), fToolSettings, ((PaintApplication*)be_app)->Color(use_fg_color));
 	if (the_script == NULL) {
 		delete coordinate_reader;
 		return NULL;
 	}
+	the_script->SetBrush(brush->GetInfo());
 
 	selection = view->GetSelection();
 
@@ -84,6 +90,7 @@ BrushTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint viewPoi
 		delete the_script;
 		return NULL;
 	}
+	MemoryBudget::Track(srcBuffer, view, TOOL_MEMORY);
 
 	BRect bitmap_bounds = buffer->Bounds();
 
@@ -91,9 +98,10 @@ BrushTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint viewPoi
 	if (tmpBuffer == NULL) {
 		delete coordinate_reader;
 		delete the_script;
-		delete srcBuffer;
+		MemoryBudget::DeleteBitmap(srcBuffer);
 		return NULL;
 	}
+	MemoryBudget::Track(tmpBuffer, view, TOOL_MEMORY);
 
 	float brush_width_per_2 = floor(brush->Width() / 2);
 	float brush_height_per_2 = floor(brush->Height() / 2);
@@ -101,11 +109,6 @@ BrushTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint viewPoi
 	BPoint prev_point;
 
 	union color_conversion new_color;
-
-	bool use_fg_color = true;
-	if (buttons == B_SECONDARY_MOUSE_BUTTON)
-		use_fg_color = false;
-
 	new_color.word = RGBColorToBGRA(((PaintApplication*)be_app)->Color(use_fg_color));
 
 	union color_conversion clear_color;
@@ -117,9 +120,8 @@ BrushTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint viewPoi
 	prev_point = last_point = point;
 	BRect updated_rect;
 
-	the_script->AddPoint(point);
-
 	if (coordinate_reader->GetPoint(point) == B_OK) {
+		the_script->AddPoint(point);
 		brush->draw(tmpBuffer, BPoint(point.x - brush_width_per_2, point.y - brush_height_per_2),
 			selection);
 	}
@@ -137,6 +139,7 @@ BrushTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint viewPoi
 	imageUpdater->AddRect(updated_rect);
 
 	while (coordinate_reader->GetPoint(point) == B_OK) {
+		the_script->AddPoint(point);
 		brush->draw(tmpBuffer, BPoint(point.x - brush_width_per_2, point.y - brush_height_per_2),
 			selection);
 		updated_rect = BRect(point.x - brush_width_per_2, point.y - brush_height_per_2,
@@ -154,16 +157,61 @@ BrushTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint viewPoi
 
 	delete imageUpdater;
 	delete coordinate_reader;
-	delete srcBuffer;
-	delete tmpBuffer;
+	MemoryBudget::DeleteBitmap(srcBuffer);
+	MemoryBudget::DeleteBitmap(tmpBuffer);
 
 	return the_script;
 }
 
 
 int32
-BrushTool::UseToolWithScript(ToolScript*, BBitmap*)
+BrushTool::UseToolWithScript(ToolScript* script, BBitmap* bitmap)
 {
+	const brush_info* info = script->ReturnBrush();
+	if (info == NULL)
+		return B_ERROR;
+
+	brush_info script_brush = *info;
+	Brush* brush = new (std::nothrow) Brush(script_brush);
+	BBitmap* srcBuffer = new (std::nothrow) BBitmap(bitmap);
+	BBitmap* tmpBuffer = new (std::nothrow) BBitmap(bitmap->Bounds(), bitmap->ColorSpace());
+	Selection* selection = new (std::nothrow) Selection(bitmap->Bounds());
+	if (brush == NULL || srcBuffer == NULL || tmpBuffer == NULL || selection == NULL) {
+		delete brush;
+		delete srcBuffer;
+		delete tmpBuffer;
+		delete selection;
+		return B_NO_MEMORY;
+	}
+
+	float brush_width_per_2 = floor(brush->Width() / 2);
+	float brush_height_per_2 = floor(brush->Height() / 2);
+
+	union color_conversion new_color;
+	new_color.word = RGBColorToBGRA(script->ReturnColor());
+
+	union color_conversion clear_color;
+	clear_color.word = new_color.word;
+	clear_color.bytes[3] = 0x01;
+
+	BitmapUtilities::ClearBitmap(tmpBuffer, clear_color.word);
+
+	BPoint* points = script->ReturnPoints();
+	for (int32 i = 0; i < script->PointCount(); i++) {
+		BPoint point = points[i];
+		brush->draw(tmpBuffer, BPoint(point.x - brush_width_per_2, point.y - brush_height_per_2),
+			selection);
+		BRect updated_rect = BRect(point.x - brush_width_per_2, point.y - brush_height_per_2,
+			point.x + brush_width_per_2, point.y + brush_height_per_2);
+		BitmapUtilities::CompositeBitmapOnSource(
+			bitmap, srcBuffer, tmpBuffer, updated_rect, src_over_fixed, new_color.word);
+	}
+
+	delete brush;
+	delete srcBuffer;
+	delete tmpBuffer;
+	delete selection;
+
 	return B_OK;
 }
 
@@ -79,7 +79,7 @@ DrawingTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint viewP
 int32
 DrawingTool::UseToolWithScript(ToolScript*, BBitmap*)
 {
-	return B_OK;
+	return B_ERROR;
 }
 
 
@@ -47,6 +47,9 @@ public:
 							DrawingTool(const BString& name, const BString& shortcut, int32 type);
 	virtual					~DrawingTool();
 
+	// Draws the stroke that the script recorded to the bitmap without a
+	// view, as if nothing was selected. Returns B_ERROR if the tool does not
+	// draw to the image.
 	virtual	int32			UseToolWithScript(ToolScript*, BBitmap*);
 	virtual	ToolScript*		UseTool(ImageView*, uint32 buttons, BPoint point, BPoint viewPoint);
 
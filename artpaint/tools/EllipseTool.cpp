@@ -18,6 +18,7 @@
 #include "Image.h"
 #include "ImageUpdater.h"
 #include "ImageView.h"
+#include "MemoryBudget.h"
 #include "NumberSliderControl.h"
 #include "PaintApplication.h"
 #include "Selection.h"
@@ -67,7 +68,8 @@ EllipseTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 	drawing_mode old_mode;
 
 	ToolScript* the_script = new (std::nothrow)
-		ToolScript(Type(), fToolSettings, ((PaintApplication*)be_app)->Color(true));
+		ToolScript(Type(), fToolSettings,
+			((PaintApplication*)be_app)->Color(buttons != B_SECONDARY_MOUSE_BUTTON));
 	if (the_script == NULL) {
 		return NULL;
 	}
@@ -83,12 +85,14 @@ EllipseTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 
 		return NULL;
 	}
+	MemoryBudget::Track(srcBuffer, view, TOOL_MEMORY);
 	BBitmap* tmpBuffer = new (std::nothrow) BBitmap(buffer);
 	if (tmpBuffer == NULL) {
 		delete the_script;
-		delete srcBuffer;
+		MemoryBudget::DeleteBitmap(srcBuffer);
 		return NULL;
 	}
+	MemoryBudget::Track(tmpBuffer, view, TOOL_MEMORY);
 	union color_conversion clear_color, tmp_draw_color;
 	clear_color.word = 0xFFFFFFFF;
 	clear_color.bytes[3] = 0x00;
@@ -306,38 +310,16 @@ EllipseTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 			new_angle = 0.;
 		}
 
-		drawer->DrawEllipse(bitmap_rect.InsetByCopy(-half_width, -half_width), tmp_draw_color.word, use_fill,
-			use_anti_aliasing, selection, new_angle);
-		union color_conversion rev_color;
-		rev_color.word = tmp_draw_color.word;
-		rev_color.bytes[3] = 0xFF;
-		if (half_width > 0) {
-			int32 max_half_width = min_c(half_width, bitmap_rect.Width() / 2.);
-			int32 max_half_height = min_c(half_width, bitmap_rect.Height() / 2.);
-
-			drawer->DrawEllipse(bitmap_rect.InsetByCopy(max_half_width, max_half_height), rev_color.word, use_fill,
-				use_anti_aliasing, selection, new_angle, dst_out_fixed);
-		}
+		// The preview may still be in the buffer.
+		BitmapUtilities::ClearBitmap(tmpBuffer, clear_color.word);
+		BRect updatedRect = _DrawEllipse(drawer, bitmap_rect, new_angle, width, use_fill,
+			use_anti_aliasing, selection);
 
 		the_script->AddPoint(bitmap_rect.LeftTop());
 		the_script->AddPoint(bitmap_rect.RightTop());
 		the_script->AddPoint(bitmap_rect.RightBottom());
 		the_script->AddPoint(bitmap_rect.LeftBottom());
-
-        float max_dim = ceil(max_c(bitmap_rect.Width() + view_width, bitmap_rect.Height() + view_width) / 2.);
-		BPoint centroid = bitmap_rect.LeftTop() + bitmap_rect.RightTop()
-		  + bitmap_rect.RightBottom() + bitmap_rect.LeftBottom();
-		centroid.x /= 4;
-		centroid.y /= 4;
-
-		BRect updatedRect(0, 0, 1, 1);
-
-		updatedRect.top = centroid.y - max_dim;
-		updatedRect.left = centroid.x - max_dim;
-		updatedRect.bottom = centroid.y + max_dim;
-		updatedRect.right = centroid.x + max_dim;
-
-		updatedRect.InsetBy(-10,-10);
+		the_script->SetAngle(new_angle);
 
 		buffer->Lock();
 		BitmapUtilities::CompositeBitmapOnSource(
@@ -356,20 +338,99 @@ EllipseTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 
 	delete drawer;
 	delete imageUpdater;
-	delete tmpBuffer;
-	delete srcBuffer;
+	MemoryBudget::DeleteBitmap(tmpBuffer);
+	MemoryBudget::DeleteBitmap(srcBuffer);
 
 	return the_script;
 }
 
 
 int32
-EllipseTool::UseToolWithScript(ToolScript*, BBitmap*)
+EllipseTool::UseToolWithScript(ToolScript* script, BBitmap* bitmap)
 {
+	if (script->PointCount() < 4)
+		return B_OK;
+
+	tool_settings* settings = script->ReturnSettings();
+	bool use_fill = (settings->fill_enabled == B_CONTROL_ON);
+	bool use_anti_aliasing = (settings->anti_aliasing_level == B_CONTROL_ON);
+	int32 width = settings->width;
+
+	if (use_fill == false && width > 1)
+		use_fill = true;
+	else if (use_fill == true)
+		width = 0;
+
+	BBitmap* srcBuffer = new (std::nothrow) BBitmap(bitmap);
+	BBitmap* tmpBuffer = new (std::nothrow) BBitmap(bitmap);
+	Selection* selection = new (std::nothrow) Selection(bitmap->Bounds());
+	BitmapDrawer* drawer = NULL;
+	if (tmpBuffer != NULL)
+		drawer = new (std::nothrow) BitmapDrawer(tmpBuffer);
+	if (srcBuffer == NULL || tmpBuffer == NULL || selection == NULL || drawer == NULL) {
+		delete srcBuffer;
+		delete tmpBuffer;
+		delete selection;
+		delete drawer;
+		return B_NO_MEMORY;
+	}
+
+	union color_conversion clear_color;
+	clear_color.word = 0xFFFFFFFF;
+	clear_color.bytes[3] = 0x00;
+
+	BitmapUtilities::ClearBitmap(tmpBuffer, clear_color.word);
+
+	BPoint* points = script->ReturnPoints();
+	BRect bitmap_rect(points[0], points[2]);
+	BRect updatedRect = _DrawEllipse(drawer, bitmap_rect, script->ReturnAngle(), width,
+		use_fill, use_anti_aliasing, selection);
+
+	BitmapUtilities::CompositeBitmapOnSource(bitmap, srcBuffer, tmpBuffer, updatedRect,
+		src_over_fixed, RGBColorToBGRA(script->ReturnColor()));
+
+	delete drawer;
+	delete srcBuffer;
+	delete tmpBuffer;
+	delete selection;
+
 	return B_OK;
 }
 
 
+BRect
+EllipseTool::_DrawEllipse(BitmapDrawer* drawer, BRect bitmap_rect, float angle, int32 width,
+	bool use_fill, bool use_anti_aliasing, Selection* selection)
+{
+	int32 half_width = floor(width / 2.);
+
+	union color_conversion tmp_draw_color;
+	tmp_draw_color.word = 0xFFFFFFFF;
+
+	drawer->DrawEllipse(bitmap_rect.InsetByCopy(-half_width, -half_width), tmp_draw_color.word,
+		use_fill, use_anti_aliasing, selection, angle);
+	if (half_width > 0) {
+		int32 max_half_width = min_c(half_width, bitmap_rect.Width() / 2.);
+		int32 max_half_height = min_c(half_width, bitmap_rect.Height() / 2.);
+
+		drawer->DrawEllipse(bitmap_rect.InsetByCopy(max_half_width, max_half_height),
+			tmp_draw_color.word, use_fill, use_anti_aliasing, selection, angle, dst_out_fixed);
+	}
+
+	// The rotated ellipse fits in the circle around its bounds.
+	float max_dim = ceil(max_c(bitmap_rect.Width(), bitmap_rect.Height()) / 2.) + width;
+	BPoint centroid = bitmap_rect.LeftTop() + bitmap_rect.RightBottom();
+	centroid.x /= 2;
+	centroid.y /= 2;
+
+	BRect updatedRect(centroid.x - max_dim, centroid.y - max_dim, centroid.x + max_dim,
+		centroid.y + max_dim);
+	updatedRect.InsetBy(-10, -10);
+
+	return updatedRect;
+}
+
+
 BView*
 EllipseTool::ConfigView()
 {
@@ -16,9 +16,11 @@
 
 
 class BCheckBox;
+class BitmapDrawer;
 class BRadioButton;
 class BSeparatorView;
 class ImageView;
+class Selection;
 class ToolScript;
 
 
@@ -40,6 +42,13 @@ public:
 			BView*				ConfigView();
 			const void*			ToolCursor() const;
 			const char*			HelpString(bool isInUse) const;
+
+private:
+			// Draws the shape to the buffer and returns the area to composite.
+			BRect				_DrawEllipse(BitmapDrawer* drawer,
+									BRect bitmap_rect, float angle, int32 width,
+									bool use_fill, bool use_anti_aliasing,
+									Selection* selection);
 };
 
 
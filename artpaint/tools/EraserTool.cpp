@@ -21,6 +21,7 @@
 #include "Image.h"
 #include "ImageUpdater.h"
 #include "ImageView.h"
+#include "MemoryBudget.h"
 #include "NumberSliderControl.h"
 #include "PaintApplication.h"
 #include "PixelOperations.h"
@@ -77,8 +78,9 @@ EraserTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 		return NULL;
 	reading_coordinates = true;
 
+	// The background color is the one that is erased to.
 	ToolScript* the_script
-		= new ToolScript(Type(), fToolSettings, ((PaintApplication*)be_app)->Color(true));
+		= new ToolScript(Type(), fToolSettings, ((PaintApplication*)be_app)->Color(false));
 	if (the_script == NULL) {
 		delete coordinate_reader;
 
@@ -97,13 +99,15 @@ EraserTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 		delete the_script;
 		return NULL;
 	}
+	MemoryBudget::Track(srcBuffer, view, TOOL_MEMORY);
 	BBitmap* tmpBuffer = new (std::nothrow) BBitmap(buffer);
 	if (tmpBuffer == NULL) {
 		delete coordinate_reader;
 		delete the_script;
-		delete srcBuffer;
+		MemoryBudget::DeleteBitmap(srcBuffer);
 		return NULL;
 	}
+	MemoryBudget::Track(tmpBuffer, view, TOOL_MEMORY);
 
 	union color_conversion clear_color, tmp_draw_color;
 	clear_color.word = 0xFFFFFFFF;
@@ -150,6 +154,7 @@ EraserTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 
 	if (fToolSettings.use_current_brush == true) {
 		brush = ToolManager::Instance().GetCurrentBrush();
+		the_script->SetBrush(brush->GetInfo());
 		brush_width_per_2 = floor(brush->Width() / 2);
 		brush_height_per_2 = floor(brush->Height() / 2);
 
@@ -232,8 +237,8 @@ EraserTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 	imageUpdater->ForceUpdate();
 	delete imageUpdater;
 
-	delete srcBuffer;
-	delete tmpBuffer;
+	MemoryBudget::DeleteBitmap(srcBuffer);
+	MemoryBudget::DeleteBitmap(tmpBuffer);
 
 	delete drawer;
 	delete coordinate_reader;
@@ -242,9 +247,138 @@ EraserTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 
 
 int32
-EraserTool::UseToolWithScript(ToolScript*, BBitmap*)
+EraserTool::UseToolWithScript(ToolScript* script, BBitmap* bitmap)
 {
-	return B_ERROR;
+	tool_settings* settings = script->ReturnSettings();
+	BPoint* points = script->ReturnPoints();
+	int32 point_count = script->PointCount();
+	if (point_count == 0)
+		return B_OK;
+
+	Brush* brush = NULL;
+	if (settings->use_current_brush == true) {
+		if (script->ReturnBrush() == NULL)
+			return B_ERROR;
+
+		brush_info info = *script->ReturnBrush();
+		brush = new (std::nothrow) Brush(info);
+		if (brush == NULL)
+			return B_NO_MEMORY;
+	}
+
+	BBitmap* srcBuffer = new (std::nothrow) BBitmap(bitmap);
+	BBitmap* tmpBuffer = new (std::nothrow) BBitmap(bitmap);
+	Selection* selection = new (std::nothrow) Selection(bitmap->Bounds());
+	BitmapDrawer* drawer = NULL;
+	if (tmpBuffer != NULL)
+		drawer = new (std::nothrow) BitmapDrawer(tmpBuffer);
+	if (srcBuffer == NULL || tmpBuffer == NULL || selection == NULL || drawer == NULL) {
+		delete brush;
+		delete srcBuffer;
+		delete tmpBuffer;
+		delete selection;
+		delete drawer;
+		return B_NO_MEMORY;
+	}
+
+	uint32 (*composite_func)(uint32, uint32) = dst_out_fixed;
+
+	union color_conversion clear_color, tmp_draw_color;
+	clear_color.word = 0xFFFFFFFF;
+	clear_color.bytes[3] = 0x00;
+	tmp_draw_color.word = 0xFFFFFFFF;
+
+	BitmapUtilities::ClearBitmap(tmpBuffer, clear_color.word);
+
+	float pressure = (float)settings->pressure / 100.;
+
+	union color_conversion background;
+	background.word = 0xFFFFFFFF;
+
+	if (settings->mode == HS_ERASE_TO_BACKGROUND_MODE) {
+		rgb_color c = script->ReturnColor();
+		background.bytes[0] = c.blue;
+		background.bytes[1] = c.green;
+		background.bytes[2] = c.red;
+		background.bytes[3] = c.alpha * pressure;
+		composite_func = src_over_fixed;
+	} else
+		background.bytes[3] *= pressure;
+
+	int diameter = settings->size;
+	if ((diameter % 2) == 0)
+		diameter++;
+
+	float brush_width_per_2;
+	float brush_height_per_2;
+	BPoint prev_point = points[0];
+
+	if (brush != NULL) {
+		brush_width_per_2 = floor(brush->Width() / 2);
+		brush_height_per_2 = floor(brush->Height() / 2);
+
+		brush->draw(tmpBuffer,
+			BPoint(prev_point.x - brush_width_per_2, prev_point.y - brush_height_per_2), selection);
+	} else {
+		brush_width_per_2 = floor(settings->size / 2);
+		brush_height_per_2 = brush_width_per_2;
+
+		if (diameter != 1) {
+			drawer->DrawCircle(prev_point, diameter / 2, tmp_draw_color.word, true, true, selection,
+				src_over_fixed);
+		} else {
+			drawer->DrawHairLine(
+				prev_point, prev_point, tmp_draw_color.word, true, selection, src_over_fixed);
+		}
+	}
+
+	BRect updated_rect(prev_point.x - brush_width_per_2, prev_point.y - brush_height_per_2,
+		prev_point.x + brush_width_per_2, prev_point.y + brush_height_per_2);
+	BitmapUtilities::CompositeBitmapOnSource(
+		bitmap, srcBuffer, tmpBuffer, updated_rect, composite_func, background.word);
+
+	for (int32 i = 1; i < point_count; i++) {
+		BPoint point = points[i];
+		if (point == prev_point)
+			continue;
+
+		if (brush != NULL) {
+			brush->draw(tmpBuffer,
+				BPoint(point.x - brush_width_per_2, point.y - brush_height_per_2), selection);
+			brush->draw_line(tmpBuffer, point, prev_point, selection);
+		} else {
+			if (diameter != 1) {
+				drawer->DrawCircle(point, diameter / 2, tmp_draw_color.word, true, true,
+					selection, src_over_fixed);
+				drawer->DrawLine(prev_point, point, tmp_draw_color.word, diameter, true,
+					selection, src_over_fixed);
+			} else
+				drawer->DrawHairLine(
+					prev_point, point, background.word, true, selection, composite_func);
+		}
+
+		updated_rect.left
+			= min_c(point.x - brush_width_per_2 - 1, prev_point.x - brush_width_per_2 - 1);
+		updated_rect.top
+			= min_c(point.y - brush_height_per_2 - 1, prev_point.y - brush_height_per_2 - 1);
+		updated_rect.right
+			= max_c(point.x + brush_width_per_2 + 1, prev_point.x + brush_width_per_2 + 1);
+		updated_rect.bottom
+			= max_c(point.y + brush_height_per_2 + 1, prev_point.y + brush_height_per_2 + 1);
+
+		BitmapUtilities::CompositeBitmapOnSource(
+			bitmap, srcBuffer, tmpBuffer, updated_rect, composite_func, background.word);
+
+		prev_point = point;
+	}
+
+	delete brush;
+	delete drawer;
+	delete srcBuffer;
+	delete tmpBuffer;
+	delete selection;
+
+	return B_OK;
 }
 
 
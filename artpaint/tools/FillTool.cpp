@@ -22,6 +22,7 @@
 #include "ImageView.h"
 #include "NumberSliderControl.h"
 #include "PaintApplication.h"
+#include "PixelFormats.h"
 #include "PixelOperations.h"
 #include "Selection.h"
 #include "ToolScript.h"
@@ -38,6 +39,7 @@
 #include <SeparatorView.h>
 
 
+#include <new>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -94,8 +96,16 @@ FillTool::~FillTool()
 ToolScript*
 FillTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint viewPoint)
 {
-	ToolScript* toolScript
-		= new ToolScript(Type(), fToolSettings, ((PaintApplication*)be_app)->Color(true));
+	// A gradient is recorded with its first color in the settings and its
+	// second color as the color of the script.
+	rgb_color color;
+	if (fToolSettings.gradient_enabled == B_CONTROL_ON)
+		color = BGRAColorToRGB(gradient_color2);
+	else
+		color = ((PaintApplication*)be_app)->Color(buttons != B_SECONDARY_MOUSE_BUTTON);
+
+	ToolScript* toolScript = new ToolScript(Type(), fToolSettings, color);
+	toolScript->ReturnSettings()->gradient_color = gradient_color1;
 	toolScript->AddPoint(point);
 
 	Selection* selection = view->GetSelection();
@@ -114,8 +124,70 @@ FillTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint viewPoin
 
 
 int32
-FillTool::UseToolWithScript(ToolScript*, BBitmap*)
+FillTool::UseToolWithScript(ToolScript* script, BBitmap* bitmap)
 {
+	tool_settings* settings = script->ReturnSettings();
+	BPoint* points = script->ReturnPoints();
+	if (script->PointCount() == 0)
+		return B_OK;
+
+	BPoint start = points[0];
+	uint32 color = RGBColorToBGRA(script->ReturnColor());
+
+	if (settings->gradient_enabled != B_CONTROL_ON)
+		return FillBitmap(bitmap, start, color, *settings, NULL);
+
+	if (script->PointCount() < 2)
+		return B_ERROR;
+
+	BRect bitmap_bounds = bitmap->Bounds();
+	if (bitmap_bounds.Contains(start) == FALSE)
+		return B_OK;
+
+	BBitmap* srcBuffer = new (std::nothrow) BBitmap(bitmap);
+	BBitmap* tmpBuffer = new (std::nothrow) BBitmap(bitmap);
+	BitmapDrawer* drawer = NULL;
+	if (tmpBuffer != NULL)
+		drawer = new (std::nothrow) BitmapDrawer(tmpBuffer);
+	if (srcBuffer == NULL || tmpBuffer == NULL || drawer == NULL) {
+		delete srcBuffer;
+		delete tmpBuffer;
+		delete drawer;
+		return B_NO_MEMORY;
+	}
+
+	int32 min_x = (int32)bitmap_bounds.left;
+	int32 min_y = (int32)bitmap_bounds.top;
+	int32 max_x = (int32)bitmap_bounds.right;
+	int32 max_y = (int32)bitmap_bounds.bottom;
+
+	uint32 old_color = drawer->GetPixel(start);
+
+	BBitmap* binary_map;
+	if (settings->mode == B_CONTROL_OFF) {
+		binary_map = MakeBinaryMap(drawer, min_x, max_x, min_y, max_y, old_color,
+			settings->tolerance);
+	} else {
+		binary_map = MakeFloodBinaryMap(drawer, min_x, max_x, min_y, max_y, old_color, start,
+			settings->tolerance);
+	}
+
+	union color_conversion clear_color;
+	clear_color.word = 0xFFFFFFFF;
+	clear_color.bytes[3] = 0x00;
+	BitmapUtilities::ClearBitmap(tmpBuffer, clear_color.word);
+
+	FillGradient(settings->shape, drawer, binary_map, start, points[1], min_x, max_x, min_y,
+		max_y, color, settings->gradient_color, 1);
+
+	BitmapUtilities::CompositeBitmapOnSource(
+		bitmap, srcBuffer, tmpBuffer, bitmap_bounds, src_over_fixed);
+
+	delete binary_map;
+	delete drawer;
+	delete srcBuffer;
+	delete tmpBuffer;
+
 	return B_OK;
 }
 
@@ -135,13 +207,6 @@ FillTool::NormalFill(ImageView* view, uint32 buttons, BPoint start, Selection* s
 	if (window == NULL)
 		return B_ERROR;
 
-	uint32 tolerance = (uint32)((float)fToolSettings.tolerance / 100.0 * 255);
-
-	filled_bitmap = view->ReturnImage()->ReturnActiveBitmap();
-	BitmapDrawer* drawer = new BitmapDrawer(filled_bitmap);
-	BRect bitmap_bounds = filled_bitmap->Bounds();
-	bitmap_bounds.OffsetTo(BPoint(0, 0));
-
 	// Get the color for the fill.
 	bool use_fg_color = true;
 	if (buttons == B_SECONDARY_MOUSE_BUTTON)
@@ -150,6 +215,31 @@ FillTool::NormalFill(ImageView* view, uint32 buttons, BPoint start, Selection* s
 	rgb_color c = ((PaintApplication*)be_app)->Color(use_fg_color);
 	uint32 color = RGBColorToBGRA(c);
 
+	BBitmap* bitmap = view->ReturnImage()->ReturnActiveBitmap();
+	if (bitmap->Bounds().Contains(start) == TRUE) {
+		FillBitmap(bitmap, start, color, fToolSettings, sel);
+
+		SetLastUpdatedRect(bitmap->Bounds());
+		window->Lock();
+		view->UpdateImage(LastUpdatedRect());
+		view->Sync();
+		window->Unlock();
+	}
+	return B_OK;
+}
+
+
+status_t
+FillTool::FillBitmap(BBitmap* bitmap, BPoint start, uint32 color,
+	const tool_settings& settings, Selection* sel)
+{
+	uint32 tolerance = (uint32)((float)settings.tolerance / 100.0 * 255);
+
+	filled_bitmap = bitmap;
+	BitmapDrawer* drawer = new BitmapDrawer(filled_bitmap);
+	BRect bitmap_bounds = filled_bitmap->Bounds();
+	bitmap_bounds.OffsetTo(BPoint(0, 0));
+
 	// Get the old color.
 	uint32 old_color = drawer->GetPixel(start);
 
@@ -168,7 +258,7 @@ FillTool::NormalFill(ImageView* view, uint32 buttons, BPoint start, Selection* s
 	max_y = (int32)bitmap_bounds.bottom;
 
 	if (bitmap_bounds.Contains(start) == TRUE) {
-		if (fToolSettings.mode == B_CONTROL_ON) { // Do the flood fill
+		if (settings.mode == B_CONTROL_ON) { // Do the flood fill
 			// Here fill the area using drawer's SetPixel and GetPixel.
 			// The algorithm uses 4-connected version of flood-fill.
 			// The SetPixel and GetPixel functions are versions that
@@ -220,12 +310,6 @@ FillTool::NormalFill(ImageView* view, uint32 buttons, BPoint start, Selection* s
 				}
 			}
 		}
-
-		SetLastUpdatedRect(filled_bitmap->Bounds());
-		window->Lock();
-		view->UpdateImage(LastUpdatedRect());
-		view->Sync();
-		window->Unlock();
 	}
 	delete drawer;
 	return B_OK;
@@ -462,11 +546,12 @@ FillTool::GradientFill(
 		BBitmap* binary_map;
 		if (fToolSettings.mode == B_CONTROL_OFF) {
 			// Not flood-mode
-			binary_map = MakeBinaryMap(drawer, min_x, max_x, min_y, max_y, old_color, sel);
+			binary_map = MakeBinaryMap(drawer, min_x, max_x, min_y, max_y, old_color,
+				fToolSettings.tolerance, sel);
 		} else {
 			// Flood-mode
-			binary_map
-				= MakeFloodBinaryMap(drawer, min_x, max_x, min_y, max_y, old_color, start, sel);
+			binary_map = MakeFloodBinaryMap(drawer, min_x, max_x, min_y, max_y, old_color, start,
+				fToolSettings.tolerance, sel);
 		}
 
 		// Here calculate the bounding rectangle of the filled area and
@@ -535,19 +620,8 @@ FillTool::GradientFill(
 					// using some specialized function.
 					BitmapUtilities::ClearBitmap(tmpBuffer, clear_color.word);
 
-					if (fToolSettings.shape == GRADIENT_CONIC) {
-						FillGradientConic(drawer, binary_map, start, new_point, min_x, max_x, min_y,
-							max_y, color, gradient_color, 2, sel);
-					} else if (fToolSettings.shape == GRADIENT_RADIAL) {
-						FillGradientRadial(drawer, binary_map, start, new_point, min_x, max_x,
-							min_y, max_y, color, gradient_color, 2, sel);
-					} else if (fToolSettings.shape == GRADIENT_SQUARE) {
-						FillGradientSquare(drawer, binary_map, start, new_point, min_x, max_x,
-							min_y, max_y, color, gradient_color, 2, sel);
-					} else {
-						FillGradientLinear(drawer, binary_map, start, new_point, min_x, max_x,
-							min_y, max_y, color, gradient_color, 2, sel);
-					}
+					FillGradient(fToolSettings.shape, drawer, binary_map, start, new_point, min_x,
+						max_x, min_y, max_y, color, gradient_color, 2, sel);
 
 					bitmap->Lock();
 					BitmapUtilities::CompositeBitmapOnSource(
@@ -565,19 +639,8 @@ FillTool::GradientFill(
 		BitmapUtilities::ClearBitmap(tmpBuffer, clear_color.word);
 
 		// Here calculate the final gradient.
-		if (fToolSettings.shape == GRADIENT_CONIC) {
-			FillGradientConic(drawer, binary_map, start, new_point, min_x, max_x, min_y, max_y,
-				color, gradient_color, 1, sel);
-		} else if (fToolSettings.shape == GRADIENT_RADIAL) {
-			FillGradientRadial(drawer, binary_map, start, new_point, min_x, max_x, min_y, max_y,
-				color, gradient_color, 1, sel);
-		} else if (fToolSettings.shape == GRADIENT_SQUARE) {
-			FillGradientSquare(drawer, binary_map, start, new_point, min_x, max_x, min_y, max_y,
-				color, gradient_color, 1, sel);
-		} else {
-			FillGradientLinear(drawer, binary_map, start, new_point, min_x, max_x, min_y, max_y,
-				color, gradient_color, 1, sel);
-		}
+		FillGradient(fToolSettings.shape, drawer, binary_map, start, new_point, min_x, max_x,
+			min_y, max_y, color, gradient_color, 1, sel);
 		// Update the image-view.
 		bitmap->Lock();
 		BitmapUtilities::CompositeBitmapOnSource(
@@ -619,7 +682,7 @@ FillTool::GradientFill(
 
 BBitmap*
 FillTool::MakeBinaryMap(BitmapDrawer* drawer, int32 min_x, int32 max_x, int32 min_y, int32 max_y,
-	uint32 old_color, Selection* sel)
+	uint32 old_color, int32 tolerance_percent, Selection* sel)
 {
 	// This function makes a binary bitmap that has ones where the
 	// color of original bitmap is same as old_color, and zeroes elsewhere.
@@ -630,7 +693,7 @@ FillTool::MakeBinaryMap(BitmapDrawer* drawer, int32 min_x, int32 max_x, int32 mi
 	int32 binary_bpr = binary_map->BytesPerRow();
 
 	if ((sel == NULL) || (sel->IsEmpty() == TRUE)) {
-		if (fToolSettings.tolerance == 0) {
+		if (tolerance_percent == 0) {
 			// Always collect eight pixels from the bitmap and
 			// then move that data to the binary bitmap.
 			uchar next_value = 0x00;
@@ -656,7 +719,7 @@ FillTool::MakeBinaryMap(BitmapDrawer* drawer, int32 min_x, int32 max_x, int32 mi
 			// Always collect eight pixels from the bitmap and
 			// then move that data to the binary bitmap.
 			uchar next_value = 0x00;
-			uint32 tolerance = (uint32)((float)fToolSettings.tolerance / 100.0 * 255);
+			uint32 tolerance = (uint32)((float)tolerance_percent / 100.0 * 255);
 			for (int32 y = min_y; y <= max_y; y++) {
 				int32 bytes_advanced = 0;
 				for (int32 x = min_x; x <= max_x; x++) {
@@ -679,7 +742,7 @@ FillTool::MakeBinaryMap(BitmapDrawer* drawer, int32 min_x, int32 max_x, int32 mi
 			}
 		}
 	} else {
-		if (fToolSettings.tolerance == 0) {
+		if (tolerance_percent == 0) {
 			// Always collect eight pixels from the bitmap and
 			// then move that data to the binary bitmap.
 			uchar next_value = 0x00;
@@ -707,7 +770,7 @@ FillTool::MakeBinaryMap(BitmapDrawer* drawer, int32 min_x, int32 max_x, int32 mi
 			// Always collect eight pixels from the bitmap and
 			// then move that data to the binary bitmap.
 			uchar next_value = 0x00;
-			uint32 tolerance = (uint32)((float)fToolSettings.tolerance / 100.0 * 255);
+			uint32 tolerance = (uint32)((float)tolerance_percent / 100.0 * 255);
 			for (int32 y = min_y; y <= max_y; y++) {
 				int32 bytes_advanced = 0;
 				for (int32 x = min_x; x <= max_x; x++) {
@@ -737,7 +800,7 @@ FillTool::MakeBinaryMap(BitmapDrawer* drawer, int32 min_x, int32 max_x, int32 mi
 
 BBitmap*
 FillTool::MakeFloodBinaryMap(BitmapDrawer* drawer, int32 min_x, int32 max_x, int32 min_y,
-	int32 max_y, uint32 old_color, BPoint start, Selection* sel)
+	int32 max_y, uint32 old_color, BPoint start, int32 tolerance_percent, Selection* sel)
 {
 	// This function makes a binary bitmap of the image. It contains ones where
 	// the flood fill should fill and zeroes elsewhere.
@@ -762,7 +825,7 @@ FillTool::MakeFloodBinaryMap(BitmapDrawer* drawer, int32 min_x, int32 max_x, int
 
 	uint32 color = bg.word; // This is the temporary color that will be used
 							// to fill the bitmap.
-	uint32 tolerance = (uint32)((float)fToolSettings.tolerance / 100.0 * 255);
+	uint32 tolerance = (uint32)((float)tolerance_percent / 100.0 * 255);
 
 	PointStack stack;
 	stack.Push(start);
@@ -793,6 +856,27 @@ FillTool::MakeFloodBinaryMap(BitmapDrawer* drawer, int32 min_x, int32 max_x, int
 }
 
 
+void
+FillTool::FillGradient(int32 shape, BitmapDrawer* drawer, BBitmap* binary_map, BPoint start,
+	BPoint end, int32 min_x, int32 max_x, int32 min_y, int32 max_y, uint32 new_color,
+	uint32 gradient_color, uint8 skip, Selection* sel)
+{
+	if (shape == GRADIENT_CONIC) {
+		FillGradientConic(drawer, binary_map, start, end, min_x, max_x, min_y, max_y,
+			new_color, gradient_color, skip, sel);
+	} else if (shape == GRADIENT_RADIAL) {
+		FillGradientRadial(drawer, binary_map, start, end, min_x, max_x, min_y, max_y,
+			new_color, gradient_color, skip, sel);
+	} else if (shape == GRADIENT_SQUARE) {
+		FillGradientSquare(drawer, binary_map, start, end, min_x, max_x, min_y, max_y,
+			new_color, gradient_color, skip, sel);
+	} else {
+		FillGradientLinear(drawer, binary_map, start, end, min_x, max_x, min_y, max_y,
+			new_color, gradient_color, skip, sel);
+	}
+}
+
+
 void
 FillTool::FillGradientLinear(BitmapDrawer* drawer, BBitmap* binary_map, BPoint start, BPoint end,
 	int32 min_x, int32 max_x, int32 min_y, int32 max_y, uint32 new_color, uint32 gradient_color,
@@ -819,10 +903,8 @@ FillTool::FillGradientLinear(BitmapDrawer* drawer, BBitmap* binary_map, BPoint s
 	source.word = new_color;
 	dest.word = gradient_color;
 
-	int16 red_diff = (dest.bytes[2] - source.bytes[2]);
-	int16 green_diff = (dest.bytes[1] - source.bytes[1]);
-	int16 blue_diff = (dest.bytes[0] - source.bytes[0]);
-	int16 alpha_diff = (dest.bytes[3] - source.bytes[3]);
+	pixel16 source16 = to_pixel16(source.word);
+	pixel16 dest16 = to_pixel16(dest.word);
 
 	for (int32 y = min_y; y < max_y; y += skip) {
 		for (int32 x = min_x; x < max_x; x += skip) {
@@ -842,21 +924,11 @@ FillTool::FillGradientLinear(BitmapDrawer* drawer, BBitmap* binary_map, BPoint s
 				else {
 					float ratio = 1. - abs(dist / total_dist);
 
-					out_color.word = source.word;
-					float r = out_color.bytes[2];
-					float g = out_color.bytes[1];
-					float b = out_color.bytes[0];
-					float a = out_color.bytes[3];
-
-					r += (float)red_diff * ratio;
-					g += (float)green_diff * ratio;
-					b += (float)blue_diff * ratio;
-					a += (float)alpha_diff * ratio;
-
-					out_color.bytes[0] = (uint8)b;
-					out_color.bytes[1] = (uint8)g;
-					out_color.bytes[2] = (uint8)r;
-					out_color.bytes[3] = (uint8)a;
+					// Interpolate in linear light with 16 bits per channel and dither
+					// the result, this way the gradient does not show bands or dark
+					// midtones.
+					out_color.word = to_pixel8(mix_pixels<pixel16>(dest16, source16,
+						(uint32)(ratio * 65535)), ordered_dither(x, y));
 				}
 
 				for (int dy = 0; dy < skip; ++dy) {
@@ -887,10 +959,8 @@ FillTool::FillGradientRadial(BitmapDrawer* drawer, BBitmap* binary_map, BPoint s
 	source.word = new_color;
 	dest.word = gradient_color;
 
-	int16 red_diff = (dest.bytes[2] - source.bytes[2]);
-	int16 green_diff = (dest.bytes[1] - source.bytes[1]);
-	int16 blue_diff = (dest.bytes[0] - source.bytes[0]);
-	int16 alpha_diff = (dest.bytes[3] - source.bytes[3]);
+	pixel16 source16 = to_pixel16(source.word);
+	pixel16 dest16 = to_pixel16(dest.word);
 
 	for (int32 y = min_y; y < max_y; y += skip) {
 		for (int32 x = min_x; x < max_x; x += skip) {
@@ -905,21 +975,8 @@ FillTool::FillGradientRadial(BitmapDrawer* drawer, BBitmap* binary_map, BPoint s
 				else {
 					float ratio = 1. - abs(dist / total_dist);
 
-					out_color.word = source.word;
-					float r = out_color.bytes[2];
-					float g = out_color.bytes[1];
-					float b = out_color.bytes[0];
-					float a = out_color.bytes[3];
-
-					r += (float)red_diff * ratio;
-					g += (float)green_diff * ratio;
-					b += (float)blue_diff * ratio;
-					a += (float)alpha_diff * ratio;
-
-					out_color.bytes[0] = (uint8)b;
-					out_color.bytes[1] = (uint8)g;
-					out_color.bytes[2] = (uint8)r;
-					out_color.bytes[3] = (uint8)a;
+					out_color.word = to_pixel8(mix_pixels<pixel16>(dest16, source16,
+						(uint32)(ratio * 65535)), ordered_dither(x, y));
 				}
 
 				for (int dy = 0; dy < skip; ++dy) {
@@ -955,10 +1012,8 @@ FillTool::FillGradientSquare(BitmapDrawer* drawer, BBitmap* binary_map, BPoint s
 	source.word = new_color;
 	dest.word = gradient_color;
 
-	int16 red_diff = (dest.bytes[2] - source.bytes[2]);
-	int16 green_diff = (dest.bytes[1] - source.bytes[1]);
-	int16 blue_diff = (dest.bytes[0] - source.bytes[0]);
-	int16 alpha_diff = (dest.bytes[3] - source.bytes[3]);
+	pixel16 source16 = to_pixel16(source.word);
+	pixel16 dest16 = to_pixel16(dest.word);
 
 	for (int32 y = min_y; y < max_y; y += skip) {
 		for (int32 x = min_x; x < max_x; x += skip) {
@@ -975,21 +1030,8 @@ FillTool::FillGradientSquare(BitmapDrawer* drawer, BBitmap* binary_map, BPoint s
 				else {
 					float ratio = 1. - abs(dist / total_dist);
 
-					out_color.word = source.word;
-					float r = out_color.bytes[2];
-					float g = out_color.bytes[1];
-					float b = out_color.bytes[0];
-					float a = out_color.bytes[3];
-
-					r += (float)red_diff * ratio;
-					g += (float)green_diff * ratio;
-					b += (float)blue_diff * ratio;
-					a += (float)alpha_diff * ratio;
-
-					out_color.bytes[0] = (uint8)b;
-					out_color.bytes[1] = (uint8)g;
-					out_color.bytes[2] = (uint8)r;
-					out_color.bytes[3] = (uint8)a;
+					out_color.word = to_pixel8(mix_pixels<pixel16>(dest16, source16,
+						(uint32)(ratio * 65535)), ordered_dither(x, y));
 				}
 
 				for (int dy = 0; dy < skip; ++dy) {
@@ -1027,10 +1069,8 @@ FillTool::FillGradientConic(BitmapDrawer* drawer, BBitmap* binary_map, BPoint st
 	source.word = new_color;
 	dest.word = gradient_color;
 
-	int16 red_diff = (dest.bytes[2] - source.bytes[2]);
-	int16 green_diff = (dest.bytes[1] - source.bytes[1]);
-	int16 blue_diff = (dest.bytes[0] - source.bytes[0]);
-	int16 alpha_diff = (dest.bytes[3] - source.bytes[3]);
+	pixel16 source16 = to_pixel16(source.word);
+	pixel16 dest16 = to_pixel16(dest.word);
 
 	for (int32 y = min_y; y < max_y; y += skip) {
 		for (int32 x = min_x; x < max_x; x += skip) {
@@ -1048,21 +1088,8 @@ FillTool::FillGradientConic(BitmapDrawer* drawer, BBitmap* binary_map, BPoint st
 
 				union color_conversion out_color;
 
-				out_color.word = source.word;
-				float r = out_color.bytes[2];
-				float g = out_color.bytes[1];
-				float b = out_color.bytes[0];
-				float a = out_color.bytes[3];
-
-				r += (float)red_diff * ratio;
-				g += (float)green_diff * ratio;
-				b += (float)blue_diff * ratio;
-				a += (float)alpha_diff * ratio;
-
-				out_color.bytes[0] = (uint8)b;
-				out_color.bytes[1] = (uint8)g;
-				out_color.bytes[2] = (uint8)r;
-				out_color.bytes[3] = (uint8)a;
+				out_color.word = to_pixel8(mix_pixels<pixel16>(dest16, source16,
+					(uint32)(ratio * 65535)), ordered_dither(x, y));
 
 				for (int dy = 0; dy < skip; ++dy) {
 					for (int dx = 0; dx < skip; ++dx)
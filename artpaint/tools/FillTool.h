@@ -67,6 +67,8 @@ private:
 			BBitmap*			binary_fill_map;
 
 			status_t			NormalFill(ImageView*, uint32, BPoint, Selection* = NULL);
+			status_t			FillBitmap(BBitmap*, BPoint, uint32,
+									const tool_settings&, Selection* = NULL);
 
 			void				CheckSpans(BPoint, BitmapDrawer*,
 									PointStack&, int32, int32, uint32, uint32,
@@ -79,10 +81,15 @@ private:
 			BPoint				GradientFill(ImageView*, uint32, BPoint, BPoint,
 									Selection* = NULL);
 			BBitmap*			MakeBinaryMap(BitmapDrawer*, int32, int32,
-									int32, int32, uint32, Selection* = NULL);
+									int32, int32, uint32, int32,
+									Selection* = NULL);
 			BBitmap*			MakeFloodBinaryMap(BitmapDrawer*, int32, int32,
-									int32, int32, uint32, BPoint,
+									int32, int32, uint32, BPoint, int32,
 									Selection* = NULL);
+			void				FillGradient(int32, BitmapDrawer*, BBitmap*,
+									BPoint, BPoint, int32, int32, int32, int32,
+									uint32, uint32, uint8 skip = 1,
+									Selection* sel = NULL);
 			void				FillGradientLinear(BitmapDrawer*, BBitmap*, BPoint,
 									BPoint, int32, int32, int32, int32, uint32,
 									uint32, uint8 skip = 1, Selection* sel = NULL);
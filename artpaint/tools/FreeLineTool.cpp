@@ -21,6 +21,7 @@
 #include "Image.h"
 #include "ImageUpdater.h"
 #include "ImageView.h"
+#include "MemoryBudget.h"
 #include "NumberSliderControl.h"
 #include "PaintApplication.h"
 #include "PixelOperations.h"
@@ -70,8 +71,12 @@ FreeLineTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 	if (coordinate_reader == NULL)
 		return NULL;
 
+	bool use_fg_color = true;
+	if (buttons == B_SECONDARY_MOUSE_BUTTON)
+		use_fg_color = false;
+
 	ToolScript* the_script = new (std::nothrow)
-		ToolScript(Type(), fToolSettings, ((PaintApplication*)be_app)->Color(true));
+		ToolScript(Type(), fToolSettings, ((PaintApplication*)be_app)->Color(use_fg_color));
 	if (the_script == NULL) {
 		delete coordinate_reader;
 
@@ -91,13 +96,15 @@ FreeLineTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 
 		return NULL;
 	}
+	MemoryBudget::Track(srcBuffer, view, TOOL_MEMORY);
 	BBitmap* tmpBuffer = new (std::nothrow) BBitmap(buffer);
 	if (tmpBuffer == NULL) {
 		delete coordinate_reader;
 		delete the_script;
-		delete srcBuffer;
+		MemoryBudget::DeleteBitmap(srcBuffer);
 		return NULL;
 	}
+	MemoryBudget::Track(tmpBuffer, view, TOOL_MEMORY);
 	union color_conversion clear_color;
 	clear_color.word = 0xFFFFFFFF;
 	clear_color.bytes[3] = 0x00;
@@ -109,8 +116,8 @@ FreeLineTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 	if (drawer == NULL) {
 		delete coordinate_reader;
 		delete the_script;
-		delete srcBuffer;
-		delete tmpBuffer;
+		MemoryBudget::DeleteBitmap(srcBuffer);
+		MemoryBudget::DeleteBitmap(tmpBuffer);
 
 		return NULL;
 	}
@@ -125,9 +132,10 @@ FreeLineTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 	Brush* brush;
 	bool delete_brush = false;
 
-	if (fToolSettings.use_current_brush == true)
+	if (fToolSettings.use_current_brush == true) {
 		brush = ToolManager::Instance().GetCurrentBrush();
-	else {
+		the_script->SetBrush(brush->GetInfo());
+	} else {
 		brush_info default_free_brush;
 		default_free_brush.shape = HS_ELLIPTICAL_BRUSH;
 		default_free_brush.width = fToolSettings.size;
@@ -141,10 +149,6 @@ FreeLineTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 	float brush_width_per_2 = floor(brush->Width() / 2);
 	float brush_height_per_2 = floor(brush->Height() / 2);
 
-	bool use_fg_color = true;
-	if (buttons == B_SECONDARY_MOUSE_BUTTON)
-		use_fg_color = false;
-
 	float pressure = (float)fToolSettings.pressure / 100.;
 
 	new_color = ((PaintApplication*)be_app)->Color(use_fg_color);
@@ -205,8 +209,8 @@ FreeLineTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 	imageUpdater->ForceUpdate();
 	delete imageUpdater;
 
-	delete srcBuffer;
-	delete tmpBuffer;
+	MemoryBudget::DeleteBitmap(srcBuffer);
+	MemoryBudget::DeleteBitmap(tmpBuffer);
 
 	delete drawer;
 	delete coordinate_reader;
@@ -219,8 +223,88 @@ FreeLineTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 
 
 int32
-FreeLineTool::UseToolWithScript(ToolScript*, BBitmap*)
+FreeLineTool::UseToolWithScript(ToolScript* script, BBitmap* bitmap)
 {
+	tool_settings* settings = script->ReturnSettings();
+	BPoint* points = script->ReturnPoints();
+	int32 point_count = script->PointCount();
+	if (point_count == 0)
+		return B_OK;
+
+	brush_info info;
+	if (settings->use_current_brush == true && script->ReturnBrush() != NULL)
+		info = *script->ReturnBrush();
+	else {
+		info.shape = HS_ELLIPTICAL_BRUSH;
+		info.width = settings->size;
+		info.height = settings->size;
+		info.angle = 0;
+		info.hardness = 100;
+	}
+
+	Brush* brush = new (std::nothrow) Brush(info);
+	BBitmap* srcBuffer = new (std::nothrow) BBitmap(bitmap);
+	BBitmap* tmpBuffer = new (std::nothrow) BBitmap(bitmap);
+	Selection* selection = new (std::nothrow) Selection(bitmap->Bounds());
+	if (brush == NULL || srcBuffer == NULL || tmpBuffer == NULL || selection == NULL) {
+		delete brush;
+		delete srcBuffer;
+		delete tmpBuffer;
+		delete selection;
+		return B_NO_MEMORY;
+	}
+
+	union color_conversion clear_color;
+	clear_color.word = 0xFFFFFFFF;
+	clear_color.bytes[3] = 0x00;
+
+	BitmapUtilities::ClearBitmap(tmpBuffer, clear_color.word);
+
+	float brush_width_per_2 = floor(brush->Width() / 2);
+	float brush_height_per_2 = floor(brush->Height() / 2);
+
+	union color_conversion new_color_bgra;
+	new_color_bgra.word = RGBColorToBGRA(script->ReturnColor());
+	new_color_bgra.bytes[3] *= (float)settings->pressure / 100.;
+
+	BPoint prev_point = points[0];
+	brush->draw(tmpBuffer,
+		BPoint(prev_point.x - brush_width_per_2, prev_point.y - brush_height_per_2), selection);
+
+	BRect updated_rect(prev_point.x - brush_width_per_2, prev_point.y - brush_height_per_2,
+		prev_point.x + brush_width_per_2, prev_point.y + brush_height_per_2);
+	BitmapUtilities::CompositeBitmapOnSource(
+		bitmap, srcBuffer, tmpBuffer, updated_rect, src_over_fixed, new_color_bgra.word);
+
+	for (int32 i = 1; i < point_count; i++) {
+		BPoint point = points[i];
+		if (point == prev_point)
+			continue;
+
+		brush->draw(tmpBuffer,
+			BPoint(point.x - brush_width_per_2, point.y - brush_height_per_2), selection);
+		brush->draw_line(tmpBuffer, point, prev_point, selection);
+
+		updated_rect.left
+			= min_c(point.x - brush_width_per_2 - 1, prev_point.x - brush_width_per_2 - 1);
+		updated_rect.top
+			= min_c(point.y - brush_height_per_2 - 1, prev_point.y - brush_height_per_2 - 1);
+		updated_rect.right
+			= max_c(point.x + brush_width_per_2 + 1, prev_point.x + brush_width_per_2 + 1);
+		updated_rect.bottom
+			= max_c(point.y + brush_height_per_2 + 1, prev_point.y + brush_height_per_2 + 1);
+
+		BitmapUtilities::CompositeBitmapOnSource(
+			bitmap, srcBuffer, tmpBuffer, updated_rect, src_over_fixed, new_color_bgra.word);
+
+		prev_point = point;
+	}
+
+	delete brush;
+	delete srcBuffer;
+	delete tmpBuffer;
+	delete selection;
+
 	return B_OK;
 }
 
@@ -21,6 +21,7 @@
 #include "NumberSliderControl.h"
 #include "PaintApplication.h"
 #include "RandomNumberGenerator.h"
+#include "Selection.h"
 #include "ToolScript.h"
 #include "UtilityClasses.h"
 
@@ -32,7 +33,8 @@
 #include <Slider.h>
 
 
-#include <stdlib.h>
+#include <math.h>
+#include <new>
 
 
 #undef B_TRANSLATION_CONTEXT
@@ -60,73 +62,89 @@ HairyBrushTool::HairyBrushTool()
 }
 
 
-ToolScript*
-HairyBrushTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
+// HairyStroke holds the state of the hairs during one stroke. The random
+// numbers come from a stream that is seeded with the first point, so that a
+// recorded stroke is drawn the same way again.
+class HairyStroke {
+public:
+							HairyStroke(const tool_settings& settings,
+								rgb_color color, BPoint point);
+							~HairyStroke();
+
+			// Draws the first segment. The width grows while the mouse is
+			// held still at the first point.
+			BRect			Start(BitmapDrawer* drawer, BPoint original_point,
+								BPoint point, float initial_width,
+								BRect bounds, Selection* selection);
+			BRect			Continue(BitmapDrawer* drawer, BPoint prev_point,
+								BPoint point, BRect bounds,
+								Selection* selection);
+
+			float			MaximumWidth() const { return maximum_width; }
+
+private:
+			float			_RandomFraction();
+			int32			_RandomIndex(int32 j);
+			void			_UseColor(int32 i, float normal_length);
+			BRect			_RoundOut(BRect rect, BRect bounds);
+
+			RandomNumberGenerator* random_stream;
+
+			float			maximum_width;
+			float			minimum_width;
+			float			current_width;
+			float			number_of_consecutive_growths;
+
+			int32			hair_count;
+			float*			color_amount_array;
+			rgb_color*		color_array;
+			BPoint*			start_point_array;
+			int32*			index_array;
+};
+
+
+HairyStroke::HairyStroke(const tool_settings& settings, rgb_color color, BPoint point)
 {
-	// here we first get the necessary data from view
-	// and then start drawing while mousebutton is held down
+	random_stream = new RandomNumberGenerator(107 + int32(point.x), 1024);
 
-	// Wait for the last_updated_region to become empty
-	while (LastUpdatedRect().IsValid())
-		snooze(50000);
+	maximum_width = settings.pressure; // ceil(initial_width*1.5);
+	minimum_width = 0.5; // floor(max_c(2,initial_width*0.5));
+	current_width = maximum_width;
+	number_of_consecutive_growths = 0;
 
-	BBitmap* buffer = view->ReturnImage()->ReturnActiveBitmap();
-	if (!buffer)
-		return NULL;
-
-	ToolScript* the_script
-		= new ToolScript(Type(), fToolSettings, ((PaintApplication*)be_app)->Color(true));
-
-	Selection* selection = view->GetSelection();
-	BitmapDrawer* drawer = new BitmapDrawer(buffer);
-	CoordinateReader* reader = new CoordinateReader(view, NO_INTERPOLATION, false, true);
-	ImageUpdater* imageUpdater = new ImageUpdater(view, 0);
-	RandomNumberGenerator* random_stream = new RandomNumberGenerator(107 + int32(point.x), 1024);
-
-	BPoint prev_point = point;
-	BRect updated_rect;
-
-	float initial_width = GetCurrentValue(PRESSURE_OPTION);
-	float maximum_width = initial_width; // ceil(initial_width*1.5);
-	float minimum_width = 0.5; // floor(max_c(2,initial_width*0.5));
-	float current_width = initial_width;
-	float color_randomness = GetCurrentValue(TOLERANCE_OPTION);
+	float color_randomness = settings.tolerance;
 	float color_randomnessx2 = color_randomness * 2.0;
-	float initial_color_amount = GetCurrentValue(CONTINUITY_OPTION) / 10.0;
+	float initial_color_amount = settings.continuity / 10.0;
 	float color_amount_randomness = 4;
 
-	int32 hair_count = GetCurrentValue(SIZE_OPTION);
+	hair_count = settings.size;
 
-	float* color_amount_array = new float[hair_count];
-	rgb_color* color_array = new rgb_color[hair_count];
-	BPoint* start_point_array = new BPoint[hair_count];
-	int32* index_array = new int32[hair_count];
+	color_amount_array = new float[hair_count];
+	color_array = new rgb_color[hair_count];
+	start_point_array = new BPoint[hair_count];
+	index_array = new int32[hair_count];
 
 	for (int32 i = 0; i < hair_count; i++) {
 		float red, green, blue, alpha;
 		color_amount_array[i] = initial_color_amount - color_amount_randomness
-			+ random() % 1000 / 1000.0 * color_amount_randomness * 2.0;
-
-		bool use_fg_color = true;
-		if (buttons == B_SECONDARY_MOUSE_BUTTON)
-			use_fg_color = false;
+			+ _RandomFraction() * color_amount_randomness * 2.0;
 
-		color_array[i] = ((PaintApplication*)be_app)->Color(use_fg_color);
+		color_array[i] = color;
 		red = color_array[i].red;
 		green = color_array[i].green;
 		blue = color_array[i].blue;
 		alpha = color_array[i].alpha;
 
-		red = red - color_randomness + ((rand() % 1000) / 1000.0 * color_randomnessx2);
+		red = red - color_randomness + (_RandomFraction() * color_randomnessx2);
 		red = min_c(255, max_c(red, 0));
 
-		green = green - color_randomness + ((rand() % 1000) / 1000.0 * color_randomnessx2);
+		green = green - color_randomness + (_RandomFraction() * color_randomnessx2);
 		green = min_c(255, max_c(green, 0));
 
-		blue = blue - color_randomness + ((rand() % 1000) / 1000.0 * color_randomnessx2);
+		blue = blue - color_randomness + (_RandomFraction() * color_randomnessx2);
 		blue = min_c(255, max_c(blue, 0));
 
-		alpha = alpha - color_randomness + ((rand() % 1000) / 1000.0 * color_randomnessx2);
+		alpha = alpha - color_randomness + (_RandomFraction() * color_randomnessx2);
 		alpha = min_c(255, max_c(alpha, 0));
 
 		color_array[i].red = (uint8)red;
@@ -136,209 +154,272 @@ HairyBrushTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 
 		start_point_array[i] = point;
 	}
+}
+
+
+HairyStroke::~HairyStroke()
+{
+	delete[] index_array;
+	delete[] color_amount_array;
+	delete[] color_array;
+	delete[] start_point_array;
+	delete random_stream;
+}
+
+
+BRect
+HairyStroke::Start(BitmapDrawer* drawer, BPoint original_point, BPoint point,
+	float initial_width, BRect bounds, Selection* selection)
+{
+	BRect updated_rect = BRect(point, point);
+	current_width = initial_width;
+	BPoint line_normal;
+	line_normal.x = -(point - original_point).y;
+	line_normal.y = (point - original_point).x;
+	float normal_length = sqrt(pow(line_normal.x, 2) + pow(line_normal.y, 2));
+	line_normal.x /= normal_length;
+	line_normal.y /= normal_length;
+
+	for (int32 i = 0; i < hair_count; i++)
+		index_array[i] = i;
+
+	for (int32 j = hair_count - 1; j >= 0; j--) {
+		// First calculate the points where to draw this line
+		int32 random_index = _RandomIndex(j);
+		int32 i = index_array[random_index];
+		index_array[random_index] = index_array[j];
+		BPoint offset = line_normal;
+		offset.x = offset.x * current_width
+			- offset.x * ((float)i / (float)hair_count) * 2 * current_width;
+		offset.y = offset.y * current_width
+			- offset.y * ((float)i / (float)hair_count) * 2 * current_width;
+		BPoint start_point = start_point_array[i] + offset;
+
+		// Randomly weight the rounding
+		start_point.x
+			= random_round(start_point.x, random_stream->UniformDistribution(0.0, 1.0));
+		start_point.y
+			= random_round(start_point.y, random_stream->UniformDistribution(0.0, 1.0));
+
+		BPoint end_point = point + offset;
+		end_point.x = round(end_point.x);
+		end_point.y = round(end_point.y);
+		start_point_array[i] = end_point;
+
+		_UseColor(i, normal_length);
+
+		if (color_amount_array[i] > 0) {
+			drawer->DrawHairLine(
+				start_point, end_point, RGBColorToBGRA(color_array[i]), true, selection);
+		}
+
+		updated_rect = updated_rect | BRect(start_point, start_point);
+		updated_rect = updated_rect | BRect(end_point, end_point);
+	}
+
+	return _RoundOut(updated_rect, bounds);
+}
+
+
+BRect
+HairyStroke::Continue(BitmapDrawer* drawer, BPoint prev_point, BPoint point, BRect bounds,
+	Selection* selection)
+{
+	BPoint line_normal;
+	line_normal.x = -(point - prev_point).y;
+	line_normal.y = (point - prev_point).x;
+	float normal_length = sqrt(pow(line_normal.x, 2) + pow(line_normal.y, 2));
+	line_normal.x /= normal_length;
+	line_normal.y /= normal_length;
+
+	// This controls the width of resulting line
+	float width_coeff = min_c(normal_length / 30.0, 1.0);
+	float new_width = current_width * 0.5
+		+ 0.5 * (width_coeff * minimum_width + (1.0 - width_coeff) * maximum_width);
+	if (new_width > current_width) {
+		current_width += min_c(number_of_consecutive_growths / 20.0, 1.0)
+			* (new_width - current_width);
+		current_width = min_c(current_width, maximum_width);
+		number_of_consecutive_growths++;
+	} else if (new_width <= current_width) {
+		current_width = new_width;
+		number_of_consecutive_growths = 0;
+	}
+	BRect updated_rect = BRect(point, point);
+
+	// Here we make an array of indexes and also swap hairs with
+	// their neighbours randomly.
+	for (int32 i = 0; i < hair_count; i++) {
+		index_array[i] = i;
+		float number = _RandomFraction();
+		if (number > 0.9) {
+			float old_amount = color_amount_array[i];
+			rgb_color old_color = color_array[i];
+			int32 swap_index = (i + 1) % hair_count;
+			color_amount_array[i] = color_amount_array[swap_index];
+			color_array[i] = color_array[swap_index];
+			color_amount_array[swap_index] = old_amount;
+			color_array[swap_index] = old_color;
+		} else if (number > 0.8) {
+			// NOT: (i-1)%hair_count might be also negative if i happens to be 0.
+			int32 other_index = ((i >= 1) ? i - 1 : hair_count - 1);
+			float old_amount = color_amount_array[i];
+			rgb_color old_color = color_array[i];
+
+			color_amount_array[i] = color_amount_array[other_index];
+			color_array[i] = color_array[other_index];
+			color_amount_array[other_index] = old_amount;
+			color_array[other_index] = old_color;
+		}
+	}
+
+	for (int32 j = hair_count - 1; j >= 0; j--) {
+		// First calculate the points where to draw this line
+		int32 random_index = _RandomIndex(j);
+		int32 i = index_array[random_index];
+		index_array[random_index] = index_array[j];
+		BPoint offset = line_normal;
+		offset.x = offset.x * current_width
+			- offset.x * ((float)i / (float)hair_count) * 2 * current_width;
+		offset.y = offset.y * current_width
+			- offset.y * ((float)i / (float)hair_count) * 2 * current_width;
+		BPoint start_point = start_point_array[i];
+		BPoint end_point = point + offset;
+
+		// Randomly weight the rounding
+		end_point.x
+			= random_round(end_point.x, random_stream->UniformDistribution(0.0, 1.0));
+		end_point.y
+			= random_round(end_point.y, random_stream->UniformDistribution(0.0, 1.0));
+
+		start_point_array[i] = end_point;
+
+		_UseColor(i, normal_length);
+
+		if (color_amount_array[i] > 0) {
+			drawer->DrawHairLine(
+				start_point, end_point, RGBColorToBGRA(color_array[i]), true, selection);
+		}
+		updated_rect = updated_rect | BRect(start_point, start_point);
+		updated_rect = updated_rect | BRect(end_point, end_point);
+	}
+
+	return _RoundOut(updated_rect, bounds);
+}
+
+
+float
+HairyStroke::_RandomFraction()
+{
+	return random_stream->IntegerUniformDistribution(0, 999) / 1000.0;
+}
+
+
+int32
+HairyStroke::_RandomIndex(int32 j)
+{
+	if (j != 0)
+		return random_stream->IntegerUniformDistribution(0, j - 1);
+
+	return 0;
+}
+
+
+void
+HairyStroke::_UseColor(int32 i, float normal_length)
+{
+	// Calculate how much and what color will be used. Also calculate how
+	// the colors will be mixed with previous color.
+	if (color_amount_array[i] > 0)
+		color_amount_array[i] -= min_c(normal_length / 100.0, 0.1);
+	else {
+		// Borrow some color from our neighbours.
+		int32 neighbour_index = ((i >= 1) ? i - 1 : hair_count - 1);
+		if (color_amount_array[neighbour_index] > 0) {
+			color_amount_array[i] = color_amount_array[neighbour_index] / 4;
+			color_amount_array[neighbour_index] -= color_amount_array[i];
+		}
+		neighbour_index = (i + 1) % hair_count;
+		if (color_amount_array[neighbour_index] > 0) {
+			color_amount_array[i] += color_amount_array[neighbour_index] / 4;
+			color_amount_array[neighbour_index]
+				-= color_amount_array[neighbour_index] / 4;
+		}
+	}
+}
+
+
+BRect
+HairyStroke::_RoundOut(BRect rect, BRect bounds)
+{
+	rect.left = floor(rect.left);
+	rect.top = floor(rect.top);
+	rect.right = ceil(rect.right);
+	rect.bottom = ceil(rect.bottom);
+	rect.InsetBy(-1, -1);
+
+	return rect & bounds;
+}
+
+
+// #pragma mark -- HairyBrushTool
+
+
+ToolScript*
+HairyBrushTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
+{
+	// here we first get the necessary data from view
+	// and then start drawing while mousebutton is held down
+
+	// Wait for the last_updated_region to become empty
+	while (LastUpdatedRect().IsValid())
+		snooze(50000);
+
+	BBitmap* buffer = view->ReturnImage()->ReturnActiveBitmap();
+	if (!buffer)
+		return NULL;
+
+	rgb_color color
+		= ((PaintApplication*)be_app)->Color(buttons != B_SECONDARY_MOUSE_BUTTON);
+	ToolScript* the_script = new ToolScript(Type(), fToolSettings, color);
+
+	Selection* selection = view->GetSelection();
+	BitmapDrawer* drawer = new BitmapDrawer(buffer);
+	CoordinateReader* reader = new CoordinateReader(view, NO_INTERPOLATION, false, true);
+	ImageUpdater* imageUpdater = new ImageUpdater(view, 0);
+	HairyStroke* stroke = new HairyStroke(fToolSettings, color, point);
+
+	BPoint prev_point = point;
+	BRect updated_rect;
 
 	SetLastUpdatedRect(BRect(point, point));
 	the_script->AddPoint(point);
 
+	// All the points are recorded here, because the points where the mouse
+	// was held still make the first segment wider.
 	bool initialized = false;
-	initial_width = 1;
+	float initial_width = 1;
 	BPoint original_point = point;
 	while (!initialized && (reader->GetPoint(point) == B_OK)) {
+		the_script->AddPoint(point);
 		if (point != original_point) {
-			updated_rect = BRect(point, point);
 			initialized = true;
-			current_width = initial_width;
-			BPoint line_normal;
-			line_normal.x = -(point - original_point).y;
-			line_normal.y = (point - original_point).x;
-			float normal_length = sqrt(pow(line_normal.x, 2) + pow(line_normal.y, 2));
-			line_normal.x /= normal_length;
-			line_normal.y /= normal_length;
-
-			for (int32 i = 0; i < hair_count; i++)
-				index_array[i] = i;
-
-			for (int32 j = hair_count - 1; j >= 0; j--) {
-				// First calculate the points where to draw this line
-				int32 random_index;
-				if (j != 0)
-					random_index = random() % j;
-				else
-					random_index = 1;
-
-				int32 i = index_array[random_index];
-				index_array[random_index] = index_array[j];
-				BPoint offset = line_normal;
-				offset.x = offset.x * current_width
-					- offset.x * ((float)i / (float)hair_count) * 2 * current_width;
-				offset.y = offset.y * current_width
-					- offset.y * ((float)i / (float)hair_count) * 2 * current_width;
-				BPoint start_point = start_point_array[i] + offset;
-
-				// Randomly weight the rounding
-				start_point.x
-					= random_round(start_point.x, random_stream->UniformDistribution(0.0, 1.0));
-				start_point.y
-					= random_round(start_point.y, random_stream->UniformDistribution(0.0, 1.0));
-
-				BPoint end_point = point + offset;
-				end_point.x = round(end_point.x);
-				end_point.y = round(end_point.y);
-				start_point_array[i] = end_point;
-
-				// Then calculate how much and what color will be used. Also
-				// calculate how the colors will be mixed with previous color.
-				if (color_amount_array[i] > 0)
-					color_amount_array[i] -= min_c(normal_length / 100.0, 0.1);
-				else {
-					// Borrow some color from our neighbours.
-					int32 neighbour_index = ((i >= 1) ? i - 1 : hair_count - 1);
-					if (color_amount_array[neighbour_index] > 0) {
-						color_amount_array[i] = color_amount_array[neighbour_index] / 4;
-						color_amount_array[neighbour_index] -= color_amount_array[i];
-					}
-					neighbour_index = (i + 1) % hair_count;
-					if (color_amount_array[neighbour_index] > 0) {
-						color_amount_array[i] += color_amount_array[neighbour_index] / 4;
-						color_amount_array[neighbour_index]
-							-= color_amount_array[neighbour_index] / 4;
-					}
-				}
-
-				if (color_amount_array[i] > 0) {
-					drawer->DrawHairLine(
-						start_point, end_point, RGBColorToBGRA(color_array[i]), true, selection);
-				}
-
-				updated_rect = updated_rect | BRect(start_point, start_point);
-				updated_rect = updated_rect | BRect(end_point, end_point);
-			}
-			updated_rect.left = floor(updated_rect.left);
-			updated_rect.top = floor(updated_rect.top);
-			updated_rect.right = ceil(updated_rect.right);
-			updated_rect.bottom = ceil(updated_rect.bottom);
-			updated_rect.InsetBy(-1, -1);
-			updated_rect = updated_rect & buffer->Bounds();
+			updated_rect = stroke->Start(drawer, original_point, point, initial_width,
+				buffer->Bounds(), selection);
 
 			imageUpdater->AddRect(updated_rect);
 			SetLastUpdatedRect(updated_rect);
 		} else
-			initial_width = min_c(maximum_width, initial_width + 0.5);
+			initial_width = min_c(stroke->MaximumWidth(), initial_width + 0.5);
 	}
 	imageUpdater->ForceUpdate();
 
-	float number_of_consecutive_growths = 0;
-
 	while (reader->GetPoint(point) == B_OK) {
 		if (prev_point != point) {
 			the_script->AddPoint(point);
 
-			BPoint line_normal;
-			line_normal.x = -(point - prev_point).y;
-			line_normal.y = (point - prev_point).x;
-			float normal_length = sqrt(pow(line_normal.x, 2) + pow(line_normal.y, 2));
-			line_normal.x /= normal_length;
-			line_normal.y /= normal_length;
-
-			// This controls the width of resulting line
-			float width_coeff = min_c(normal_length / 30.0, 1.0);
-			float new_width = current_width * 0.5
-				+ 0.5 * (width_coeff * minimum_width + (1.0 - width_coeff) * maximum_width);
-			if (new_width > current_width) {
-				current_width += min_c(number_of_consecutive_growths / 20.0, 1.0)
-					* (new_width - current_width);
-				current_width = min_c(current_width, maximum_width);
-				number_of_consecutive_growths++;
-			} else if (new_width <= current_width) {
-				current_width = new_width;
-				number_of_consecutive_growths = 0;
-			}
-			updated_rect = BRect(point, point);
-
-			// Here we make an array of indexes and also swap hairs with
-			// their neighbours randomly.
-			for (int32 i = 0; i < hair_count; i++) {
-				index_array[i] = i;
-				float number = rand() % 1000 / 1000.0;
-				if (number > 0.9) {
-					float old_amount = color_amount_array[i];
-					rgb_color old_color = color_array[i];
-					int32 swap_index = (i + 1) % hair_count;
-					color_amount_array[i] = color_amount_array[swap_index];
-					color_array[i] = color_array[swap_index];
-					color_amount_array[swap_index] = old_amount;
-					color_array[swap_index] = old_color;
-				} else if (number > 0.8) {
-					// NOT: (i-1)%hair_count might be also negative if i happens to be 0.
-					int32 other_index = ((i >= 1) ? i - 1 : hair_count - 1);
-					float old_amount = color_amount_array[i];
-					rgb_color old_color = color_array[i];
-
-					color_amount_array[i] = color_amount_array[other_index];
-					color_array[i] = color_array[other_index];
-					color_amount_array[other_index] = old_amount;
-					color_array[other_index] = old_color;
-				}
-			}
-
-			for (int32 j = hair_count - 1; j >= 0; j--) {
-				// First calculate the points where to draw this line
-				int32 random_index;
-				if (j != 0)
-					random_index = random() % j;
-				else
-					random_index = 1;
-				int32 i = index_array[random_index];
-				index_array[random_index] = index_array[j];
-				BPoint offset = line_normal;
-				offset.x = offset.x * current_width
-					- offset.x * ((float)i / (float)hair_count) * 2 * current_width;
-				offset.y = offset.y * current_width
-					- offset.y * ((float)i / (float)hair_count) * 2 * current_width;
-				BPoint start_point = start_point_array[i];
-				BPoint end_point = point + offset;
-
-				// Randomly weight the rounding
-				end_point.x
-					= random_round(end_point.x, random_stream->UniformDistribution(0.0, 1.0));
-				end_point.y
-					= random_round(end_point.y, random_stream->UniformDistribution(0.0, 1.0));
-
-				start_point_array[i] = end_point;
-
-				// Then calculate how much and what color will be used. Also
-				// calculate how the colors will be mixed with previous color.
-				if (color_amount_array[i] > 0)
-					color_amount_array[i] -= min_c(normal_length / 100.0, 0.1);
-				else {
-					// Borrow some color from our neighbours.
-					int32 neighbour_index = ((i >= 1) ? i - 1 : hair_count - 1);
-					if (color_amount_array[neighbour_index] > 0) {
-						color_amount_array[i] = color_amount_array[neighbour_index] / 4;
-						color_amount_array[neighbour_index] -= color_amount_array[i];
-					}
-					neighbour_index = (i + 1) % hair_count;
-					if (color_amount_array[neighbour_index] > 0) {
-						color_amount_array[i] += color_amount_array[neighbour_index] / 4;
-						color_amount_array[neighbour_index]
-							-= color_amount_array[neighbour_index] / 4;
-					}
-				}
-
-				if (color_amount_array[i] > 0) {
-					drawer->DrawHairLine(
-						start_point, end_point, RGBColorToBGRA(color_array[i]), true, selection);
-				}
-				updated_rect = updated_rect | BRect(start_point, start_point);
-				updated_rect = updated_rect | BRect(end_point, end_point);
-			}
-			updated_rect.left = floor(updated_rect.left);
-			updated_rect.top = floor(updated_rect.top);
-			updated_rect.right = ceil(updated_rect.right);
-			updated_rect.bottom = ceil(updated_rect.bottom);
-			updated_rect.InsetBy(-1, -1);
-
-			updated_rect = updated_rect & buffer->Bounds();
+			updated_rect = stroke->Continue(drawer, prev_point, point, buffer->Bounds(),
+				selection);
 			SetLastUpdatedRect(LastUpdatedRect() | updated_rect);
 
 			imageUpdater->AddRect(updated_rect);
@@ -349,23 +430,58 @@ HairyBrushTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 	}
 	imageUpdater->ForceUpdate();
 
-	delete[] index_array;
-	delete[] color_amount_array;
-	delete[] color_array;
-	delete[] start_point_array;
+	delete stroke;
 	delete drawer;
 	delete reader;
 	delete imageUpdater;
-	delete random_stream;
 
 	return the_script;
 }
 
 
 int32
-HairyBrushTool::UseToolWithScript(ToolScript*, BBitmap*)
+HairyBrushTool::UseToolWithScript(ToolScript* script, BBitmap* bitmap)
 {
-	return B_ERROR;
+	int32 point_count = script->PointCount();
+	if (point_count < 1)
+		return B_OK;
+
+	BPoint* points = script->ReturnPoints();
+	Selection* selection = new (std::nothrow) Selection(bitmap->Bounds());
+	BitmapDrawer* drawer = new (std::nothrow) BitmapDrawer(bitmap);
+	HairyStroke* stroke = new (std::nothrow) HairyStroke(*script->ReturnSettings(),
+		script->ReturnColor(), points[0]);
+	if (selection == NULL || drawer == NULL || stroke == NULL) {
+		delete selection;
+		delete drawer;
+		delete stroke;
+		return B_NO_MEMORY;
+	}
+
+	BPoint original_point = points[0];
+	BPoint prev_point = original_point;
+	bool initialized = false;
+	float initial_width = 1;
+	for (int32 i = 1; i < point_count; i++) {
+		BPoint point = points[i];
+		if (!initialized) {
+			if (point != original_point) {
+				initialized = true;
+				stroke->Start(drawer, original_point, point, initial_width,
+					bitmap->Bounds(), selection);
+			} else
+				initial_width = min_c(stroke->MaximumWidth(), initial_width + 0.5);
+		} else if (prev_point != point) {
+			stroke->Continue(drawer, prev_point, point, bitmap->Bounds(), selection);
+			prev_point = point;
+		}
+	}
+
+	delete stroke;
+	delete drawer;
+	delete selection;
+
+	return B_OK;
 }
 
 
@@ -19,8 +19,10 @@
 #include "Image.h"
 #include "ImageUpdater.h"
 #include "ImageView.h"
+#include "MemoryBudget.h"
 #include "NumberSliderControl.h"
 #include "PaintApplication.h"
+#include "Selection.h"
 #include "ToolScript.h"
 #include "UtilityClasses.h"
 
@@ -70,7 +72,8 @@ RectangleTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint vie
 	drawing_mode old_mode;
 
 	ToolScript* the_script = new (std::nothrow)
-		ToolScript(Type(), fToolSettings, ((PaintApplication*)be_app)->Color(true));
+		ToolScript(Type(), fToolSettings,
+			((PaintApplication*)be_app)->Color(buttons != B_SECONDARY_MOUSE_BUTTON));
 	if (the_script == NULL) {
 		return NULL;
 	}
@@ -86,12 +89,14 @@ RectangleTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint vie
 
 		return NULL;
 	}
+	MemoryBudget::Track(srcBuffer, view, TOOL_MEMORY);
 	BBitmap* tmpBuffer = new (std::nothrow) BBitmap(buffer);
 	if (tmpBuffer == NULL) {
 		delete the_script;
-		delete srcBuffer;
+		MemoryBudget::DeleteBitmap(srcBuffer);
 		return NULL;
 	}
+	MemoryBudget::Track(tmpBuffer, view, TOOL_MEMORY);
 	union color_conversion clear_color, tmp_draw_color;
 	clear_color.word = 0xFFFFFFFF;
 	clear_color.bytes[3] = 0x00;
@@ -225,14 +230,7 @@ RectangleTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint vie
 			snooze(10 * 1000);
 		}
 
-		HSPolygon* poly;
 		BPoint* corners = new BPoint[4];
-		corners[0] = bitmap_rect.LeftTop();
-		corners[1] = bitmap_rect.RightTop();
-		corners[2] = bitmap_rect.RightBottom();
-		corners[3] = bitmap_rect.LeftBottom();
-		poly = new HSPolygon(corners, 4);
-
 		float new_angle, prev_angle = 0;
 
 		if (GetCurrentValue(ROTATION_ENABLED_OPTION) == B_CONTROL_ON) {
@@ -332,78 +330,28 @@ RectangleTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint vie
 					snooze(20 * 1000);
 				}
 			}
-			poly->RotateAboutCenter(prev_angle);
-
 		}
+		delete[] corners;
 
-		buffer->Lock();
 		if (draw_rectangle == true) {
-			if (poly->GetPointCount() == 4) {
-				if (width > 1) {
-					int32 max_half_width = min_c(half_width, bitmap_rect.Width() / 2.);
-					int32 max_half_height = min_c(half_width, bitmap_rect.Height() / 2.);
-					BRect outerRect = bitmap_rect.InsetByCopy(-half_width, -half_width);
-					BRect innerRect = bitmap_rect.InsetByCopy(max_half_width, max_half_height);
-
-					if (innerRect.Width() < 1)
-						innerRect.InsetBy(-1, 0);
-					if (innerRect.Height() < 1)
-						innerRect.InsetBy(0, -1);
-
-					corners[0] = outerRect.LeftTop();
-					corners[1] = outerRect.RightTop();
-					corners[2] = outerRect.RightBottom();
-					corners[3] = outerRect.LeftBottom();
-					HSPolygon* outerPoly = new HSPolygon(corners, 4);
-
-					corners[0] = innerRect.LeftTop();
-					corners[1] = innerRect.RightTop();
-					corners[2] = innerRect.RightBottom();
-					corners[3] = innerRect.LeftBottom();
-					HSPolygon* innerPoly = new HSPolygon(corners, 4);
-
-					innerPoly->RotateAboutCenter(prev_angle);
-					outerPoly->RotateAboutCenter(prev_angle);
-
-					drawer->DrawRectanglePolygon(
-						outerPoly->GetPointList(), tmp_draw_color.word, fill, anti_a, selection);
-
-					drawer->DrawRectanglePolygon(
-						innerPoly->GetPointList(), tmp_draw_color.word, fill, anti_a, selection,
-						dst_out_fixed);
-					BitmapUtilities::CompositeBitmapOnSource(
-						buffer, srcBuffer, tmpBuffer,
-						outerPoly->BoundingBox().InsetByCopy(-half_width, -half_width),
-						src_over_fixed, RGBColorToBGRA(c));
-				} else {
-					drawer->DrawRectanglePolygon(
-						poly->GetPointList(), tmp_draw_color.word, fill, anti_a, selection);
-					BitmapUtilities::CompositeBitmapOnSource(
-						buffer, srcBuffer, tmpBuffer, poly->BoundingBox().InsetByCopy(-width, -width),
-						src_over_fixed, RGBColorToBGRA(c));
-				}
-			} else {
-				drawer->DrawRectanglePolygon(corners, tmp_draw_color.word, fill, anti_a, selection);
-				BitmapUtilities::CompositeBitmapOnSource(
-					buffer, srcBuffer, tmpBuffer, poly->BoundingBox().InsetByCopy(-half_width, -half_width),
-					src_over_fixed, RGBColorToBGRA(c));
-			}
-		}
+			// The preview may still be in the buffer.
+			BitmapUtilities::ClearBitmap(tmpBuffer, clear_color.word);
+			BRect updatedRect = _DrawRectangle(drawer, bitmap_rect, prev_angle, width, fill,
+				anti_a, selection);
 
-		buffer->Unlock();
+			buffer->Lock();
+			BitmapUtilities::CompositeBitmapOnSource(
+				buffer, srcBuffer, tmpBuffer, updatedRect, src_over_fixed, RGBColorToBGRA(c));
+			buffer->Unlock();
 
-		SetLastUpdatedRect(poly->BoundingBox().InsetByCopy(-(1.0 + width), -(1.0 + width)));
+			SetLastUpdatedRect(updatedRect.InsetByCopy(-1, -1));
 
-		if (poly->GetPointCount() == 4) {
-			BPoint* points = poly->GetPointList();
-			for (int32 i = 0; i < 4; i++)
-				the_script->AddPoint(points[i]);
-		} else {
-			for (int32 i = 0; i < 4; i++)
-				the_script->AddPoint(corners[i]);
+			the_script->AddPoint(bitmap_rect.LeftTop());
+			the_script->AddPoint(bitmap_rect.RightTop());
+			the_script->AddPoint(bitmap_rect.RightBottom());
+			the_script->AddPoint(bitmap_rect.LeftBottom());
+			the_script->SetAngle(prev_angle);
 		}
-		delete poly;
-		delete[] corners;
 
 		window->Lock();
 		view->SetHighColor(old_color);
@@ -416,20 +364,132 @@ RectangleTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint vie
 		delete imageUpdater;
 	}
 
-	delete tmpBuffer;
-	delete srcBuffer;
+	MemoryBudget::DeleteBitmap(tmpBuffer);
+	MemoryBudget::DeleteBitmap(srcBuffer);
 
 	return the_script;
 }
 
 
 int32
-RectangleTool::UseToolWithScript(ToolScript*, BBitmap*)
+RectangleTool::UseToolWithScript(ToolScript* script, BBitmap* bitmap)
 {
+	if (script->PointCount() < 4)
+		return B_OK;
+
+	tool_settings* settings = script->ReturnSettings();
+	bool fill = (settings->fill_enabled == B_CONTROL_ON);
+	bool anti_a = (settings->anti_aliasing_level == B_CONTROL_ON);
+	int32 width = settings->width;
+
+	if (fill == false && width > 1)
+		fill = true;
+	else if (fill == true)
+		width = 0;
+
+	BBitmap* srcBuffer = new (std::nothrow) BBitmap(bitmap);
+	BBitmap* tmpBuffer = new (std::nothrow) BBitmap(bitmap);
+	Selection* selection = new (std::nothrow) Selection(bitmap->Bounds());
+	BitmapDrawer* drawer = NULL;
+	if (tmpBuffer != NULL)
+		drawer = new (std::nothrow) BitmapDrawer(tmpBuffer);
+	if (srcBuffer == NULL || tmpBuffer == NULL || selection == NULL || drawer == NULL) {
+		delete srcBuffer;
+		delete tmpBuffer;
+		delete selection;
+		delete drawer;
+		return B_NO_MEMORY;
+	}
+
+	union color_conversion clear_color;
+	clear_color.word = 0xFFFFFFFF;
+	clear_color.bytes[3] = 0x00;
+
+	BitmapUtilities::ClearBitmap(tmpBuffer, clear_color.word);
+
+	BPoint* points = script->ReturnPoints();
+	BRect bitmap_rect(points[0], points[2]);
+	BRect updatedRect = _DrawRectangle(drawer, bitmap_rect, script->ReturnAngle(), width,
+		fill, anti_a, selection);
+
+	BitmapUtilities::CompositeBitmapOnSource(bitmap, srcBuffer, tmpBuffer, updatedRect,
+		src_over_fixed, RGBColorToBGRA(script->ReturnColor()));
+
+	delete drawer;
+	delete srcBuffer;
+	delete tmpBuffer;
+	delete selection;
+
 	return B_OK;
 }
 
 
+BRect
+RectangleTool::_DrawRectangle(BitmapDrawer* drawer, BRect bitmap_rect, float angle,
+	int32 width, bool fill, bool anti_a, Selection* selection)
+{
+	union color_conversion tmp_draw_color;
+	tmp_draw_color.word = 0xFFFFFFFF;
+
+	BPoint corners[4];
+	if (width > 1) {
+		int32 half_width = ceil(width / 2.);
+		int32 max_half_width = min_c(half_width, bitmap_rect.Width() / 2.);
+		int32 max_half_height = min_c(half_width, bitmap_rect.Height() / 2.);
+		BRect outerRect = bitmap_rect.InsetByCopy(-half_width, -half_width);
+		BRect innerRect = bitmap_rect.InsetByCopy(max_half_width, max_half_height);
+
+		if (innerRect.Width() < 1)
+			innerRect.InsetBy(-1, 0);
+		if (innerRect.Height() < 1)
+			innerRect.InsetBy(0, -1);
+
+		corners[0] = outerRect.LeftTop();
+		corners[1] = outerRect.RightTop();
+		corners[2] = outerRect.RightBottom();
+		corners[3] = outerRect.LeftBottom();
+		HSPolygon outerPoly(corners, 4);
+
+		corners[0] = innerRect.LeftTop();
+		corners[1] = innerRect.RightTop();
+		corners[2] = innerRect.RightBottom();
+		corners[3] = innerRect.LeftBottom();
+		HSPolygon innerPoly(corners, 4);
+
+		if (angle != 0) {
+			outerPoly.RotateAboutCenter(angle);
+			innerPoly.RotateAboutCenter(angle);
+		}
+
+		drawer->DrawRectanglePolygon(
+			outerPoly.GetPointList(), tmp_draw_color.word, fill, anti_a, selection);
+		drawer->DrawRectanglePolygon(
+			innerPoly.GetPointList(), tmp_draw_color.word, fill, anti_a, selection,
+			dst_out_fixed);
+
+		return outerPoly.BoundingBox().InsetByCopy(-half_width, -half_width);
+	}
+
+	corners[0] = bitmap_rect.LeftTop();
+	corners[1] = bitmap_rect.RightTop();
+	corners[2] = bitmap_rect.RightBottom();
+	corners[3] = bitmap_rect.LeftBottom();
+	HSPolygon poly(corners, 4);
+
+	// A rectangle that is only a line or a point has less than four distinct
+	// corners.
+	if (poly.GetPointCount() == 4) {
+		if (angle != 0)
+			poly.RotateAboutCenter(angle);
+		drawer->DrawRectanglePolygon(poly.GetPointList(), tmp_draw_color.word, fill, anti_a,
+			selection);
+	} else
+		drawer->DrawRectanglePolygon(corners, tmp_draw_color.word, fill, anti_a, selection);
+
+	return poly.BoundingBox().InsetByCopy(-width, -width);
+}
+
+
 BView*
 RectangleTool::ConfigView()
 {
@@ -20,6 +20,7 @@
 #include "Image.h"
 #include "ImageUpdater.h"
 #include "ImageView.h"
+#include "MemoryBudget.h"
 #include "NumberSliderControl.h"
 #include "PaintApplication.h"
 #include "Selection.h"
@@ -83,12 +84,14 @@ StraightLineTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint
 	BBitmap* srcBuffer = new (std::nothrow) BBitmap(buffer);
 	if (srcBuffer == NULL)
 		return NULL;
+	MemoryBudget::Track(srcBuffer, view, TOOL_MEMORY);
 
 	BBitmap* tmpBuffer = new (std::nothrow) BBitmap(buffer);
 	if (tmpBuffer == NULL) {
-		delete srcBuffer;
+		MemoryBudget::DeleteBitmap(srcBuffer);
 		return NULL;
 	}
+	MemoryBudget::Track(tmpBuffer, view, TOOL_MEMORY);
 
 	union color_conversion clear_color, tmp_draw_color, draw_color;
 	clear_color.word = 0xFFFFFFFF;
@@ -107,14 +110,14 @@ StraightLineTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint
 	float hgt = tmpBuffer->Bounds().Height();
 
 	if (window != NULL) {
-		ToolScript* the_script
-			= new ToolScript(Type(), fToolSettings, ((PaintApplication*)be_app)->Color(true));
+		ToolScript* the_script = new ToolScript(Type(), fToolSettings,
+			((PaintApplication*)be_app)->Color(buttons != B_SECONDARY_MOUSE_BUTTON));
 
 		BitmapDrawer* drawer = new BitmapDrawer(tmpBuffer);
 		if (drawer == NULL) {
 			delete the_script;
-			delete srcBuffer;
-			delete tmpBuffer;
+			MemoryBudget::DeleteBitmap(srcBuffer);
+			MemoryBudget::DeleteBitmap(tmpBuffer);
 
 			return NULL;
 		}
@@ -150,6 +153,7 @@ StraightLineTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint
 			brush = ToolManager::Instance().GetCurrentBrush();
 			brush_width_per_2 = floor(brush->Width() / 2);
 			brush_height_per_2 = floor(brush->Height() / 2);
+			the_script->SetBrush(brush->GetInfo());
 
 			brush->draw(tmpBuffer,
 				BPoint(prev_point.x - brush_width_per_2, prev_point.y - brush_height_per_2),
@@ -392,24 +396,110 @@ StraightLineTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint
 
 		delete drawer;
 
-		delete srcBuffer;
-		delete tmpBuffer;
+		MemoryBudget::DeleteBitmap(srcBuffer);
+		MemoryBudget::DeleteBitmap(tmpBuffer);
+
+		// The width that was chosen after the line was drawn.
+		if (fToolSettings.mode == B_CONTROL_ON
+			&& fToolSettings.use_current_brush == B_CONTROL_OFF)
+			the_script->ReturnSettings()->size = size;
 
 		the_script->AddPoint(original_point);
 		the_script->AddPoint(point);
 		return the_script;
 	}
 
-	delete srcBuffer;
-	delete tmpBuffer;
+	MemoryBudget::DeleteBitmap(srcBuffer);
+	MemoryBudget::DeleteBitmap(tmpBuffer);
 
 	return NULL;
 }
 
 
 int32
-StraightLineTool::UseToolWithScript(ToolScript*, BBitmap*)
+StraightLineTool::UseToolWithScript(ToolScript* script, BBitmap* bitmap)
 {
+	// The line goes from the second last point to the last one.
+	int32 point_count = script->PointCount();
+	if (point_count < 2)
+		return B_OK;
+
+	BPoint original_point = script->ReturnPoints()[point_count - 2];
+	BPoint point = script->ReturnPoints()[point_count - 1];
+	tool_settings* settings = script->ReturnSettings();
+
+	BBitmap* srcBuffer = new (std::nothrow) BBitmap(bitmap);
+	BBitmap* tmpBuffer = new (std::nothrow) BBitmap(bitmap);
+	Selection* selection = new (std::nothrow) Selection(bitmap->Bounds());
+	BitmapDrawer* drawer = NULL;
+	if (tmpBuffer != NULL)
+		drawer = new (std::nothrow) BitmapDrawer(tmpBuffer);
+	Brush* brush = NULL;
+	bool use_brush = (settings->use_current_brush == true && script->ReturnBrush() != NULL);
+	if (use_brush) {
+		brush_info info = *script->ReturnBrush();
+		brush = new (std::nothrow) Brush(info);
+	}
+	if (srcBuffer == NULL || tmpBuffer == NULL || selection == NULL || drawer == NULL
+		|| (use_brush && brush == NULL)) {
+		delete srcBuffer;
+		delete tmpBuffer;
+		delete selection;
+		delete drawer;
+		delete brush;
+		return B_NO_MEMORY;
+	}
+
+	union color_conversion clear_color, tmp_draw_color, draw_color;
+	clear_color.word = 0xFFFFFFFF;
+	clear_color.bytes[3] = 0x00;
+	tmp_draw_color.word = 0xFFFFFFFF;
+
+	rgb_color c = script->ReturnColor();
+	draw_color.bytes[0] = c.blue;
+	draw_color.bytes[1] = c.green;
+	draw_color.bytes[2] = c.red;
+	draw_color.bytes[3] = c.alpha * ((float)settings->pressure / 100.);
+
+	BitmapUtilities::ClearBitmap(tmpBuffer, clear_color.word);
+
+	bool anti_alias = (settings->anti_aliasing_level == B_CONTROL_ON);
+	int32 size;
+	if (brush != NULL) {
+		brush->draw_line(tmpBuffer, original_point, point, selection);
+		size = max_c(brush->Width(), brush->Height());
+	} else if (settings->mode == B_CONTROL_OFF) {
+		size = settings->size;
+		if (size != 1) {
+			drawer->DrawLine(original_point, point, tmp_draw_color.word, size, anti_alias,
+				selection, src_over_fixed);
+		} else {
+			drawer->DrawHairLine(original_point, point, tmp_draw_color.word, anti_alias,
+				selection, src_over_fixed);
+		}
+	} else {
+		size = settings->size;
+		if (size > 2) {
+			drawer->DrawLine(original_point, point, tmp_draw_color.word, size, anti_alias,
+				selection, src_over_fixed);
+		} else {
+			drawer->DrawHairLine(original_point, point, tmp_draw_color.word, anti_alias,
+				selection, src_over_fixed);
+		}
+	}
+
+	BRect updated_rect = MakeRectFromPoints(original_point, point);
+	updated_rect.InsetBy(-(size / 2 + 2), -(size / 2 + 2));
+
+	BitmapUtilities::CompositeBitmapOnSource(
+		bitmap, srcBuffer, tmpBuffer, updated_rect, src_over_fixed, draw_color.word);
+
+	delete brush;
+	delete drawer;
+	delete srcBuffer;
+	delete tmpBuffer;
+	delete selection;
+
 	return B_OK;
 }
 
@@ -18,6 +18,7 @@
 #include "MessageConstants.h"
 #include "SettingsServer.h"
 #include "StatusView.h"
+#include "TraceRecorder.h"
 #include "ToolEventAdapter.h"
 #include "ToolSelectionWindow.h"
 #include "ToolSetupWindow.h"
@@ -120,8 +121,10 @@ ToolManager::StartTool(
 	clientData->fActiveTool = activeTool;
 	if (clientData->fActiveTool != NULL) {
 		view->SetToolHelpString(activeTool->HelpString(true));
+		bigtime_t tool_start = system_time();
 		ToolScript* the_script
 			= clientData->fActiveTool->UseTool(view, buttons, bitmap_point, view_point);
+		TraceRecorder::Record("tool", "UseTool", tool_start, system_time());
 		view->SetToolHelpString(activeTool->HelpString(false));
 
 		// When the tool has finished we should record the updated_rect into
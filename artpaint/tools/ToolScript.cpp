@@ -10,24 +10,90 @@
 #include "ToolScript.h"
 
 
+#include <Message.h>
+
+
+#include <string.h>
+
+
 ToolScript::ToolScript(int32 type, tool_settings set, rgb_color c)
 {
 	tool_type = type;
 	settings = set;
 	color = c;
 
+	has_brush = false;
+	angle = 0;
+
 	max_points = 1; // At least one point is needed
 	points = new BPoint[max_points];
 	point_count = 0;
 }
 
 
+ToolScript::ToolScript(const BMessage* archive)
+{
+	tool_type = NO_TOOL;
+	memset(&settings, 0, sizeof(tool_settings));
+	color.red = color.green = color.blue = 0;
+	color.alpha = 255;
+
+	has_brush = false;
+	angle = 0;
+
+	max_points = 1;
+	points = new BPoint[max_points];
+	point_count = 0;
+
+	archive->FindInt32("tool_type", &tool_type);
+
+	const void* data;
+	ssize_t size;
+	if (archive->FindData("settings", B_RAW_TYPE, &data, &size) == B_OK
+		&& size == sizeof(tool_settings))
+		memcpy(&settings, data, sizeof(tool_settings));
+
+	if (archive->FindData("color", B_RGB_COLOR_TYPE, &data, &size) == B_OK
+		&& size == sizeof(rgb_color))
+		memcpy(&color, data, sizeof(rgb_color));
+
+	if (archive->FindData("brush", B_RAW_TYPE, &data, &size) == B_OK
+		&& size == sizeof(brush_info)) {
+		memcpy(&brush, data, sizeof(brush_info));
+		has_brush = true;
+	}
+
+	archive->FindFloat("angle", &angle);
+
+	BPoint point;
+	for (int32 i = 0; archive->FindPoint("point", i, &point) == B_OK; i++)
+		AddPoint(point);
+}
+
+
 ToolScript::~ToolScript()
 {
 	delete[] points;
 }
 
 
+status_t
+ToolScript::Archive(BMessage* archive) const
+{
+	status_t status = archive->AddInt32("tool_type", tool_type);
+	status |= archive->AddData("settings", B_RAW_TYPE, &settings, sizeof(tool_settings));
+	status |= archive->AddData("color", B_RGB_COLOR_TYPE, &color, sizeof(rgb_color));
+	if (has_brush)
+		status |= archive->AddData("brush", B_RAW_TYPE, &brush, sizeof(brush_info));
+	status |= archive->AddFloat("angle", angle);
+
+	for (int32 i = 0; i < point_count; i++)
+		status |= archive->AddPoint("point", points[i]);
+
+	return status == B_OK ? B_OK : B_ERROR;
+}
+
+
 void
 ToolScript::AddPoint(BPoint p)
 {
@@ -44,6 +110,21 @@ ToolScript::AddPoint(BPoint p)
 }
 
 
+void
+ToolScript::SetBrush(const brush_info& info)
+{
+	brush = info;
+	has_brush = true;
+}
+
+
+void
+ToolScript::SetAngle(float new_angle)
+{
+	angle = new_angle;
+}
+
+
 tool_settings*
 ToolScript::ReturnSettings()
 {
@@ -58,6 +139,13 @@ ToolScript::ReturnColor()
 }
 
 
+const brush_info*
+ToolScript::ReturnBrush() const
+{
+	return has_brush ? &brush : NULL;
+}
+
+
 BPoint*
 ToolScript::ReturnPoints()
 {
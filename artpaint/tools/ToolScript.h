@@ -12,26 +12,53 @@
 #include <InterfaceDefs.h>
 #include <Point.h>
 
+#include "Brush.h"
 #include "Tools.h"
 
 
+class BMessage;
+
+
+/*
+	A ToolScript records one use of a tool: the settings and the color that
+	were used and the points that the tool visited. The tools record the
+	points in the order they drew them, so that DrawingTool::UseToolWithScript
+	draws the same stroke to another bitmap. A stroke that was drawn with the
+	current brush also records the brush, and a shape that was rotated records
+	its angle. The script can be archived to a BMessage.
+*/
 class ToolScript {
 	rgb_color 		color;
 	tool_settings	settings;
 	int32			tool_type;
 
+	brush_info		brush;
+	bool			has_brush;
+	float			angle;
+
 	BPoint*			points;
 	int32			point_count;
 	int32			max_points;
 
 public:
 					ToolScript(int32, tool_settings, rgb_color);
+					ToolScript(const BMessage* archive);
 					~ToolScript();
 
+	status_t		Archive(BMessage* archive) const;
+
 	void			AddPoint(BPoint);
+	void			SetBrush(const brush_info& info);
+	void			SetAngle(float new_angle);
 
+	int32			ToolType() const { return tool_type; }
 	tool_settings*	ReturnSettings();
 	rgb_color		ReturnColor();
+
+	// Returns NULL if the stroke was not drawn with the current brush.
+	const brush_info*	ReturnBrush() const;
+	float			ReturnAngle() const { return angle; }
+
 	BPoint*			ReturnPoints();
 	int32			PointCount();
 };
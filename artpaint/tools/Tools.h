@@ -86,7 +86,9 @@ enum controller_values {
 	HS_AIRBRUSH_MODE				=	'Aibm',
 	HS_SPRAY_MODE					=	'Sprm',
 	HS_ERASE_TO_BACKGROUND_MODE		=	'EtBg',
-	HS_ERASE_TO_TRANSPARENT_MODE	=	'EtTr'
+	HS_ERASE_TO_TRANSPARENT_MODE	=	'EtTr',
+	HS_BLUR_MODE					=	'Blrm',
+	HS_SHARPEN_MODE					=	'Shrm'
 };
 
 
@@ -54,6 +54,17 @@ TransparencyTool::TransparencyTool()
 	SetOption(PRESSURE_OPTION, 1);
 	SetOption(TRANSPARENCY_OPTION, 1);
 	SetOption(USE_BRUSH_OPTION, B_CONTROL_OFF);
+
+	// for the quick calculation of square-roots
+	sqrt_table = new float[5500];
+	for (int32 i = 0; i < 5500; i++)
+		sqrt_table[i] = sqrt(i);
+}
+
+
+TransparencyTool::~TransparencyTool()
+{
+	delete[] sqrt_table;
 }
 
 
@@ -76,39 +87,25 @@ TransparencyTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 	ToolScript* the_script
 		= new ToolScript(Type(), fToolSettings, ((PaintApplication*)be_app)->Color(true));
 
-	BRect bounds = bitmap->Bounds();
-	uint32* bits_origin = (uint32*)bitmap->Bits();
-	int32 bpr = bitmap->BytesPerRow() / 4;
-
 	Selection* selection = view->GetSelection();
 
-	// for the quick calculation of square-roots
-	float sqrt_table[5500];
-	for (int32 i = 0; i < 5500; i++)
-		sqrt_table[i] = sqrt(i);
-
 	float half_width = fToolSettings.size / 2;
 	float half_height = fToolSettings.size / 2;
-	Brush* brush;
-	BBitmap* brush_bmap;
-	uint32* brush_bits = NULL;
-	uint32 brush_bpr = 0;
+	Brush* brush = NULL;
 
 	if (fToolSettings.use_current_brush == true) {
 		brush = ToolManager::Instance().GetCurrentBrush();
-		brush_bmap = brush->GetBitmap();
-		brush_bits = (uint32*)brush_bmap->Bits();
-		brush_bpr = brush_bmap->BytesPerRow() / 4;
+		the_script->SetBrush(brush->GetInfo());
 		half_width = (brush->Width() - 1) / 2;
 		half_height = (brush->Height() - 1) / 2;
 	}
 
-	BRect rc = BRect(floor(point.x - half_width), floor(point.y - half_height),
-		ceil(point.x + half_width), ceil(point.y + half_height));
-
+	BRect bounds = bitmap->Bounds();
 	if (selection != NULL && selection->IsEmpty() == false)
 		bounds = selection->GetBoundingRect();
 
+	BRect rc = BRect(floor(point.x - half_width), floor(point.y - half_height),
+		ceil(point.x + half_width), ceil(point.y + half_height));
 	rc = rc & bounds;
 
 	SetLastUpdatedRect(rc);
@@ -116,69 +113,13 @@ TransparencyTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 	ImageUpdater* imageUpdater = new ImageUpdater(view, 2000);
 	imageUpdater->AddRect(rc);
 
-	union color_conversion color;
-
-	float pressure = (float)fToolSettings.pressure / 100.;
-
-	uint8 transparency_value = ((100. - (float)fToolSettings.transparency) / 100.) * 255;
-
 	while (coordinate_reader->GetPoint(point) == B_OK) {
 		if (selection == NULL || selection->IsEmpty() == true
 			|| selection->ContainsPoint(point)) {
 
 			the_script->AddPoint(point);
 
-			int32 x_dist, y_sqr;
-
-			rc = BRect(floor(point.x - half_width), floor(point.y - half_height),
-				ceil(point.x + half_width), ceil(point.y + half_height));
-			rc = rc & bounds;
-
-			int32 width = rc.IntegerWidth();
-			int32 height = rc.IntegerHeight();
-			if (fToolSettings.use_current_brush == true) {
-				width -= 1;
-				height -= 1;
-			}
-
-			for (int32 y = 0; y < height + 1; y++) {
-				y_sqr = (int32)(point.y - rc.top - y);
-				y_sqr *= y_sqr;
-				int32 real_y = (int32)(rc.top + y);
-				int32 real_y_times_bpr = real_y * bpr;
-				int32 real_x;
-				for (int32 x = 0; x < width + 1; x++) {
-					x_dist = (int32)(point.x - rc.left - x);
-					real_x = (int32)(rc.left + x);
-					float brush_val = 1.0;
-					if (fToolSettings.use_current_brush == true) {
-						union color_conversion brush_color;
-						brush_color.word = *(brush_bits + x + y * brush_bpr);
-						brush_val = brush_color.bytes[3] / 255.;
-					}
-					if ((fToolSettings.use_current_brush == true && brush_val > 0.0)
-						|| (fToolSettings.use_current_brush == false
-							&& sqrt_table[x_dist * x_dist + y_sqr] <= half_width)) {
-						color.word = *(bits_origin + real_y_times_bpr + real_x);
-						if (selection == NULL || selection->IsEmpty() == true
-							|| selection->ContainsPoint(real_x, real_y)) {
-
-							uint8 diff = fabs(color.bytes[3] - transparency_value);
-							uint8 step = (uint8)(ceil(diff * pressure * brush_val));
-
-							if (color.bytes[3] < transparency_value) {
-								color.bytes[3]
-									= (uint8)min_c(color.bytes[3] + step, transparency_value);
-								*(bits_origin + real_y_times_bpr + real_x) = color.word;
-							} else if (color.bytes[3] > transparency_value) {
-								color.bytes[3]
-									= (uint8)max_c(color.bytes[3] - step, transparency_value);
-								*(bits_origin + real_y_times_bpr + real_x) = color.word;
-							}
-						}
-					}
-				}
-			}
+			rc = _ApplyDab(bitmap, point, fToolSettings, brush, selection, bounds);
 
 			imageUpdater->AddRect(rc);
 
@@ -197,12 +138,111 @@ TransparencyTool::UseTool(ImageView* view, uint32 buttons, BPoint point, BPoint)
 
 
 int32
-TransparencyTool::UseToolWithScript(ToolScript*, BBitmap*)
+TransparencyTool::UseToolWithScript(ToolScript* script, BBitmap* bitmap)
 {
+	tool_settings* settings = script->ReturnSettings();
+
+	Brush* brush = NULL;
+	if (settings->use_current_brush == true) {
+		if (script->ReturnBrush() == NULL)
+			return B_ERROR;
+
+		brush_info info = *script->ReturnBrush();
+		brush = new (std::nothrow) Brush(info);
+		if (brush == NULL)
+			return B_NO_MEMORY;
+	}
+
+	BPoint* points = script->ReturnPoints();
+	for (int32 i = 0; i < script->PointCount(); i++)
+		_ApplyDab(bitmap, points[i], *settings, brush, NULL, bitmap->Bounds());
+
+	delete brush;
+
 	return B_OK;
 }
 
 
+BRect
+TransparencyTool::_ApplyDab(BBitmap* bitmap, BPoint point, const tool_settings& settings,
+	Brush* brush, Selection* selection, BRect bounds)
+{
+	uint32* bits_origin = (uint32*)bitmap->Bits();
+	int32 bpr = bitmap->BytesPerRow() / 4;
+
+	float half_width = settings.size / 2;
+	float half_height = settings.size / 2;
+	uint32* brush_bits = NULL;
+	uint32 brush_bpr = 0;
+
+	if (brush != NULL) {
+		BBitmap* brush_bmap = brush->GetBitmap();
+		brush_bits = (uint32*)brush_bmap->Bits();
+		brush_bpr = brush_bmap->BytesPerRow() / 4;
+		half_width = (brush->Width() - 1) / 2;
+		half_height = (brush->Height() - 1) / 2;
+	}
+
+	float pressure = (float)settings.pressure / 100.;
+
+	uint8 transparency_value = ((100. - (float)settings.transparency) / 100.) * 255;
+
+	union color_conversion color;
+	int32 x_dist, y_sqr;
+
+	BRect rc = BRect(floor(point.x - half_width), floor(point.y - half_height),
+		ceil(point.x + half_width), ceil(point.y + half_height));
+	rc = rc & bounds;
+
+	int32 width = rc.IntegerWidth();
+	int32 height = rc.IntegerHeight();
+	if (brush != NULL) {
+		width -= 1;
+		height -= 1;
+	}
+
+	for (int32 y = 0; y < height + 1; y++) {
+		y_sqr = (int32)(point.y - rc.top - y);
+		y_sqr *= y_sqr;
+		int32 real_y = (int32)(rc.top + y);
+		int32 real_y_times_bpr = real_y * bpr;
+		int32 real_x;
+		for (int32 x = 0; x < width + 1; x++) {
+			x_dist = (int32)(point.x - rc.left - x);
+			real_x = (int32)(rc.left + x);
+			float brush_val = 1.0;
+			if (brush != NULL) {
+				union color_conversion brush_color;
+				brush_color.word = *(brush_bits + x + y * brush_bpr);
+				brush_val = brush_color.bytes[3] / 255.;
+			}
+			if ((brush != NULL && brush_val > 0.0)
+				|| (brush == NULL && sqrt_table[x_dist * x_dist + y_sqr] <= half_width)) {
+				color.word = *(bits_origin + real_y_times_bpr + real_x);
+				if (selection == NULL || selection->IsEmpty() == true
+					|| selection->ContainsPoint(real_x, real_y)) {
+
+					uint8 diff = fabs(color.bytes[3] - transparency_value);
+					uint8 step = (uint8)(ceil(diff * pressure * brush_val));
+
+					if (color.bytes[3] < transparency_value) {
+						color.bytes[3]
+							= (uint8)min_c(color.bytes[3] + step, transparency_value);
+						*(bits_origin + real_y_times_bpr + real_x) = color.word;
+					} else if (color.bytes[3] > transparency_value) {
+						color.bytes[3]
+							= (uint8)max_c(color.bytes[3] - step, transparency_value);
+						*(bits_origin + real_y_times_bpr + real_x) = color.word;
+					}
+				}
+			}
+		}
+	}
+
+	return rc;
+}
+
+
 BView*
 TransparencyTool::ConfigView()
 {
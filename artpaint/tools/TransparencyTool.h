@@ -15,8 +15,10 @@
 
 
 class BCheckBox;
+class Brush;
 class CoordinateQueue;
 class ImageView;
+class Selection;
 class ToolScript;
 
 
@@ -31,6 +33,7 @@ using ArtPaint::Interface::NumberSliderControl;
 class TransparencyTool : public DrawingTool {
 public:
 								TransparencyTool();
+	virtual						~TransparencyTool();
 
 			int32				UseToolWithScript(ToolScript*, BBitmap*);
 			ToolScript*			UseTool(ImageView*, uint32, BPoint, BPoint);
@@ -40,10 +43,15 @@ public:
 			const void*			ToolCursor() const;
 			const char*			HelpString(bool isInUse) const;
 private:
+			BRect				_ApplyDab(BBitmap* bitmap, BPoint point,
+									const tool_settings& settings, Brush* brush,
+									Selection* selection, BRect bounds);
+
 			bool				reading_coordinates;
 
 			ImageView*			image_view;
 			CoordinateQueue*	coordinate_queue;
+			float*				sqrt_table;
 };
 
 
@@ -12,6 +12,7 @@
 
 #include "CropManipulator.h"
 
+#include "MemoryBudget.h"
 #include "MessageConstants.h"
 #include "NumberControl.h"
 #include "PixelOperations.h"
@@ -326,11 +327,12 @@ CropManipulator::SetPreviewBitmap(BBitmap* bm)
 	if ((bm == NULL) || (preview_bitmap == NULL) || (bm->Bounds() != preview_bitmap->Bounds())) {
 		try {
 			if (preview_bitmap != NULL)
-				delete copy_of_the_preview_bitmap;
+				MemoryBudget::DeleteBitmap(copy_of_the_preview_bitmap);
 
 			if (bm != NULL) {
 				preview_bitmap = bm;
 				copy_of_the_preview_bitmap = DuplicateBitmap(preview_bitmap);
+				MemoryBudget::Track(copy_of_the_preview_bitmap, NULL, PREVIEW_MEMORY);
 			} else {
 				preview_bitmap = NULL;
 				copy_of_the_preview_bitmap = NULL;
@@ -9,6 +9,7 @@
  */
 
 #include "FreeTransformManipulator.h"
+#include "MemoryBudget.h"
 #include "MessageConstants.h"
 #include "PixelOperations.h"
 
@@ -58,7 +59,7 @@ FreeTransformManipulator::~FreeTransformManipulator()
 		delete configuration_view;
 	}
 
-	delete copy_of_the_preview_bitmap;
+	MemoryBudget::DeleteBitmap(copy_of_the_preview_bitmap);
 }
 
 
@@ -158,7 +159,7 @@ FreeTransformManipulator::SetPreviewBitmap(BBitmap* bitmap)
 		|| (bitmap->Bounds() != preview_bitmap->Bounds())) {
 		try {
 			if (preview_bitmap)
-				delete copy_of_the_preview_bitmap;
+				MemoryBudget::DeleteBitmap(copy_of_the_preview_bitmap);
 
 			preview_bitmap = NULL;
 			copy_of_the_preview_bitmap = NULL;
@@ -166,6 +167,7 @@ FreeTransformManipulator::SetPreviewBitmap(BBitmap* bitmap)
 			if (bitmap) {
 				preview_bitmap = bitmap;
 				copy_of_the_preview_bitmap = DuplicateBitmap(preview_bitmap);
+				MemoryBudget::Track(copy_of_the_preview_bitmap, NULL, PREVIEW_MEMORY);
 			}
 		}
 		catch (const std::bad_alloc& e) {
@@ -21,6 +21,7 @@ Manipulator::Manipulator()
 {
 	add_on_id = -1;
 	fSystemClockSpeed = 0;
+	fCancelled = 0;
 
 	system_info info;
 	get_system_info(&info);
@@ -129,3 +130,28 @@ Manipulator::DuplicateBitmap(BBitmap* source, int32 inset, bool acceptViews)
 
 	return target;
 }
+
+
+void
+Manipulator::CancelProcessing()
+{
+	atomic_set(&fCancelled, 1);
+}
+
+
+status_t
+Manipulator::ParallelFor(int32 first, int32 last, range_function function,
+	void* data, BStatusBar* progress_bar, float progress_amount)
+{
+	if (ProcessingCancelled())
+		return B_CANCELED;
+
+	WorkerPool* pool = WorkerPool::Instance();
+	if (pool == NULL) {
+		function(data, first, last);
+		return B_OK;
+	}
+
+	return pool->ParallelFor(first, last, function, data, progress_bar,
+		progress_amount, &fCancelled);
+}
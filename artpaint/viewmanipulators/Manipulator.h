@@ -9,6 +9,8 @@
 #ifndef MANIPULATOR_H
 #define MANIPULATOR_H
 
+#include "WorkerPool.h"
+
 #include <image.h>
 
 
@@ -19,7 +21,7 @@ class ManipulatorSettings;
 
 
 enum {	  // increase on API changes
-	ADD_ON_API_VERSION	= 0x00000008
+	ADD_ON_API_VERSION	= 0x00000009
 };
 
 
@@ -70,15 +72,32 @@ public:
 	virtual void					SetSelection(Selection* new_selection) = 0;
 	virtual BBitmap*				ManipulateSelectionBitmap() { return NULL; }
 
+			// Can be called from any thread when the result will not be
+			// needed. The ranges that are being processed stop as soon as
+			// possible and the ones that are started later do nothing.
+			void					CancelProcessing();
+			bool					ProcessingCancelled() const
+										{ return fCancelled != 0; }
+
 protected:
 			BBitmap*				DuplicateBitmap(BBitmap* source,
 										int32 inset = 0,
 										bool acceptViews = false);
 
+			// Runs function for the rows (or columns) [first, last) in
+			// the threads of the WorkerPool. The status bar is advanced by
+			// progress_amount when the whole range has been processed.
+			status_t				ParallelFor(int32 first, int32 last,
+										range_function function, void* data,
+										BStatusBar* progress_bar = NULL,
+										float progress_amount = 100.0);
+
 private:
-			image_id				add_on_id;
+			// The index of the add-on in the ManipulatorServer.
+			int32					add_on_id;
 			double					fSystemClockSpeed;
 			int						fCpuCount;
+			vint32					fCancelled;
 };
 
 
@@ -11,6 +11,7 @@
 
 #include "ManipulatorServer.h"
 
+#include "AddOns.h"
 #include "CropManipulator.h"
 #include "FlipManipulator.h"
 #include "FreeTransformManipulator.h"
@@ -22,6 +23,7 @@
 #include "ScaleCanvasManipulator.h"
 #include "ScaleManipulator.h"
 #include "SettingsServer.h"
+#include "StartupProfile.h"
 #include "TextManipulator.h"
 #include "TranslationManipulator.h"
 #include "TransparencyManipulator.h"
@@ -31,17 +33,35 @@
 #include <Directory.h>
 #include <File.h>
 #include <FindDirectory.h>
+#include <LocaleRoster.h>
 #include <OS.h>
 #include <Path.h>
 
 
 #include <new>
+#include <sys/stat.h>
 
 
 BLocker ManipulatorServer::fLocker;
 ManipulatorServer* ManipulatorServer::fManipulatorServer = NULL;
 
 
+static const char skAddOnManifest[] = "add-ons";
+
+
+static BString
+preferred_language()
+{
+	// The names in the manifest are translated to this language.
+	BString language;
+	BMessage languages;
+	if (BLocaleRoster::Default()->GetPreferredLanguages(&languages) == B_OK)
+		languages.FindString("language", &language);
+
+	return language;
+}
+
+
 ManipulatorServer*
 ManipulatorServer::Instance()
 {
@@ -51,7 +71,9 @@ ManipulatorServer::Instance()
 
 ManipulatorServer::ManipulatorServer()
 	:
-	fAddonsLoaded(false)
+	fAddonsLoaded(false),
+	fManifestChanged(false),
+	fImageLocker("add-on images")
 {
 	thread_id threadId
 		= spawn_thread(_AddOnLoaderThread, "AddOnLoaderThread", B_NORMAL_PRIORITY, NULL);
@@ -62,9 +84,11 @@ ManipulatorServer::ManipulatorServer()
 
 ManipulatorServer::~ManipulatorServer()
 {
-	ImageList::const_iterator it;
-	for (it = fAddOnImages.begin(); it != fAddOnImages.end(); ++it)
-		unload_add_on(*it);
+	AddOnList::const_iterator it;
+	for (it = fAddOns.begin(); it != fAddOns.end(); ++it) {
+		if (it->image >= 0)
+			unload_add_on(it->image);
+	}
 	fManipulatorServer = NULL;
 }
 
@@ -92,24 +116,28 @@ ManipulatorServer::DestroyServer()
 
 
 Manipulator*
-ManipulatorServer::ManipulatorFor(manipulator_type type, image_id imageId) const
+ManipulatorServer::ManipulatorFor(manipulator_type type, int32 addOnId)
 {
 	Manipulator* manipulator = NULL;
 
 	switch (type) {
 		case ADD_ON_MANIPULATOR:
 		{
+			image_id imageId = AddOnImage(addOnId);
+			if (imageId < 0)
+				break;
+
 			Manipulator* (*Instantiate)(BBitmap*, ManipulatorInformer*);
 			status_t status = get_image_symbol(
 				imageId, "instantiate_add_on", B_SYMBOL_TYPE_TEXT, (void**)&Instantiate);
 			if (status == B_OK) {
 				manipulator = Instantiate(NULL, new ManipulatorInformer());
-				manipulator->add_on_id = imageId;
+				manipulator->add_on_id = addOnId;
 				// Here we also give the add-on a chance to load its settings if
 				// it is a GUIManipulator
 				BNode node;
 				GUIManipulator* gui_manipulator = dynamic_cast<GUIManipulator*>(manipulator);
-				if (gui_manipulator && _GetNodeFor(imageId, &node) == B_OK)
+				if (gui_manipulator && _GetNodeFor(addOnId, &node) == B_OK)
 					gui_manipulator->ReadSettings(&node);
 			}
 		} break;
@@ -239,9 +267,39 @@ ManipulatorServer::StoreManipulatorSettings(Manipulator* manipulator)
 }
 
 
+int32
+ManipulatorServer::FindAddOn(const char* fileName) const
+{
+	for (size_t i = 0; i < fAddOns.size(); i++) {
+		if (BString(BPath(fAddOns[i].path.String()).Leaf()).ICompare(fileName) == 0)
+			return i;
+	}
+	return -1;
+}
+
+
+image_id
+ManipulatorServer::AddOnImage(int32 addOnId)
+{
+	if (addOnId < 0 || addOnId >= (int32)fAddOns.size())
+		return B_BAD_VALUE;
+
+	BAutolock _(&fImageLocker);
+
+	add_on_info& info = fAddOns[addOnId];
+	if (info.image < 0)
+		info.image = load_add_on(info.path.String());
+
+	return info.image;
+}
+
+
 status_t
 ManipulatorServer::_AddOnLoaderThread(void* data)
 {
+	bigtime_t start = system_time();
+	fManipulatorServer->_ReadManifest();
+
 	BPath path;
 	PaintApplication::HomeDirectory(path);
 	if (path.Append("add-ons", true) == B_OK)
@@ -256,7 +314,16 @@ ManipulatorServer::_AddOnLoaderThread(void* data)
 		path.Append("ArtPaint");
 		fManipulatorServer->_LoadAddOns(path);
 	}
+
+	// Every add-on that was not changed is in the manifest, if there are
+	// more entries some of the add-ons have been removed.
+	if (fManipulatorServer->fManifestChanged
+		|| fManipulatorServer->fManifest.size() != fManipulatorServer->fAddOns.size())
+		fManipulatorServer->_WriteManifest();
+	fManipulatorServer->fManifest.clear();
+
 	fManipulatorServer->fAddonsLoaded = true;
+	StartupProfile::Phase("add-ons", start);
 
 	return B_OK;
 }
@@ -272,29 +339,144 @@ ManipulatorServer::_LoadAddOns(const BPath& path)
 	BDirectory addOnDir;
 	if (addOnDir.SetTo(&entry) == B_OK) {
 		while (addOnDir.GetNextEntry(&entry) == B_OK) {
+			char addOnName[B_FILE_NAME_LENGTH];
+			entry.GetName(addOnName);
+			if (fAddonNames.find(addOnName) != fAddonNames.end())
+				continue;
+
 			BPath addOnPath;
-			entry.GetPath(&addOnPath);
-			image_id imageId = load_add_on(addOnPath.Path());
-			if (imageId > 0) {
-				char addOnName[B_FILE_NAME_LENGTH];
-				entry.GetName(addOnName);
-				if (fAddonNames.find(addOnName) == fAddonNames.end()) {
-					fAddonNames.insert(addOnName);
-					fAddOnImages.push_back(imageId);
-				}
+			struct stat st;
+			if (entry.GetPath(&addOnPath) != B_OK || entry.GetStat(&st) != B_OK)
+				continue;
+
+			add_on_info info;
+			info.path = addOnPath.Path();
+			info.modified = st.st_mtime;
+			info.size = st.st_size;
+			info.image = -1;
+
+			std::map<BString, add_on_info>::const_iterator it = fManifest.find(info.path);
+			if (it != fManifest.end() && it->second.modified == info.modified
+				&& it->second.size == info.size) {
+				info = it->second;
+			} else {
+				// The add-on is new or has changed.
+				if (_ReadAddOnInfo(info) == false)
+					continue;
+				fManifestChanged = true;
 			}
+
+			fAddonNames.insert(addOnName);
+			fAddOns.push_back(info);
 		}
 	}
 }
 
 
+bool
+ManipulatorServer::_ReadAddOnInfo(add_on_info& info)
+{
+	image_id imageId = load_add_on(info.path.String());
+	if (imageId < 0)
+		return false;
+
+	info.type = GENERIC_ADD_ON;
+	info.api_version = -1;
+
+	int32* version;
+	if (get_image_symbol(imageId, "add_on_api_version", B_SYMBOL_TYPE_DATA,
+			(void**)&version) == B_OK)
+		info.api_version = *version;
+
+	add_on_types* type;
+	if (get_image_symbol(imageId, "add_on_type", B_SYMBOL_TYPE_DATA, (void**)&type) == B_OK)
+		info.type = *type;
+
+	// The names are the ones that the add-ons return, they may have been
+	// translated.
+	Manipulator* (*Instantiate)(BBitmap*, ManipulatorInformer*);
+	if (info.api_version == ADD_ON_API_VERSION
+		&& get_image_symbol(imageId, "instantiate_add_on", B_SYMBOL_TYPE_TEXT,
+			(void**)&Instantiate) == B_OK) {
+		Manipulator* manipulator = Instantiate(NULL, NULL);
+		if (manipulator != NULL) {
+			info.name = manipulator->ReturnName();
+			info.help = manipulator->ReturnHelpString();
+			delete manipulator;
+		}
+	}
+
+	unload_add_on(imageId);
+	info.image = -1;
+
+	return true;
+}
+
+
+void
+ManipulatorServer::_ReadManifest()
+{
+	BMessage manifest;
+	if (SettingsServer::ReadSettings(skAddOnManifest, &manifest) != B_OK)
+		return;
+
+	// The whole manifest is stale after an update of the add-on API or a
+	// change of the language.
+	BString language;
+	int32 version;
+	if (manifest.FindInt32("api_version", &version) != B_OK
+		|| version != ADD_ON_API_VERSION
+		|| manifest.FindString("language", &language) != B_OK
+		|| language != preferred_language())
+		return;
+
+	BMessage entry;
+	for (int32 i = 0; manifest.FindMessage("add_on", i, &entry) == B_OK; i++) {
+		add_on_info info;
+		if (entry.FindString("path", &info.path) != B_OK
+			|| entry.FindString("name", &info.name) != B_OK
+			|| entry.FindString("help", &info.help) != B_OK
+			|| entry.FindInt32("type", &info.type) != B_OK
+			|| entry.FindInt32("api_version", &info.api_version) != B_OK
+			|| entry.FindInt64("modified", &info.modified) != B_OK
+			|| entry.FindInt64("size", &info.size) != B_OK)
+			continue;
+
+		info.image = -1;
+		fManifest[info.path] = info;
+	}
+}
+
+
+void
+ManipulatorServer::_WriteManifest()
+{
+	BMessage manifest;
+	manifest.AddInt32("api_version", ADD_ON_API_VERSION);
+	manifest.AddString("language", preferred_language());
+
+	AddOnList::const_iterator it;
+	for (it = fAddOns.begin(); it != fAddOns.end(); ++it) {
+		BMessage entry;
+		entry.AddString("path", it->path);
+		entry.AddString("name", it->name);
+		entry.AddString("help", it->help);
+		entry.AddInt32("type", it->type);
+		entry.AddInt32("api_version", it->api_version);
+		entry.AddInt64("modified", it->modified);
+		entry.AddInt64("size", it->size);
+		manifest.AddMessage("add_on", &entry);
+	}
+
+	SettingsServer::WriteSettings(skAddOnManifest, manifest);
+}
+
+
 status_t
-ManipulatorServer::_GetNodeFor(image_id imageId, BNode* node) const
+ManipulatorServer::_GetNodeFor(int32 addOnId, BNode* node) const
 {
-	if (imageId > 0 && node != NULL) {
-		image_info imageInfo;
-		if (get_image_info(imageId, &imageInfo) == B_OK)
-			node->SetTo(imageInfo.name);
+	if (addOnId >= 0 && addOnId < (int32)fAddOns.size() && node != NULL) {
+		node->SetTo(fAddOns[addOnId].path.String());
 		return node->InitCheck();
 	}
 	return B_ERROR;
@@ -16,16 +16,41 @@
 #include <Locker.h>
 #include <String.h>
 
-#include <list>
+#include <map>
 #include <set>
+#include <vector>
 
 
+class BEntry;
 class BNode;
 class BPath;
 
 
 typedef std::set<BString> StringSet;
-typedef std::list<image_id> ImageList;
+
+
+/*
+	What the add-on menus need to know about an add-on is kept in a manifest
+	in the settings directory. At startup only the modification times and
+	sizes of the add-on files are compared with it, and an add-on is loaded
+	only when it is new or has changed. Otherwise it is loaded the first time
+	that it is used.
+*/
+struct add_on_info {
+	BString			path;
+	BString			name;
+	BString			help;
+	int32			type;
+	int32			api_version;
+	int64			modified;
+	int64			size;
+
+	// Valid after the add-on has been used.
+	image_id		image;
+};
+
+
+typedef std::vector<add_on_info> AddOnList;
 
 
 class ManipulatorServer {
@@ -35,12 +60,18 @@ public:
 	static	ManipulatorServer*		Instance();
 
 			Manipulator*			ManipulatorFor(manipulator_type type,
-										int32 imageId = -1) const;
+										int32 addOnId = -1);
 			void					StoreManipulatorSettings(Manipulator*);
 
+			// The add-ons are identified by their index in the list. The list
+			// does not change after the add-ons have been loaded.
 			bool					AddOnsLoaded() const { return fAddonsLoaded; }
-			int32					AddOnCount() const { return fAddOnImages.size(); }
-			const ImageList&		AddOnImageList() const { return fAddOnImages; }
+			int32					AddOnCount() const { return fAddOns.size(); }
+			const AddOnList&		AddOns() const { return fAddOns; }
+			int32					FindAddOn(const char* fileName) const;
+
+			// Loads the add-on if that has not been done yet.
+			image_id				AddOnImage(int32 addOnId);
 
 private:
 									ManipulatorServer();
@@ -52,13 +83,22 @@ private:
 
 	static	status_t				_AddOnLoaderThread(void* data);
 			void					_LoadAddOns(const BPath& path);
-			status_t				_GetNodeFor(image_id imageId, BNode* node) const;
+			bool					_ReadAddOnInfo(add_on_info& info);
+			void					_ReadManifest();
+			void					_WriteManifest();
+			status_t				_GetNodeFor(int32 addOnId, BNode* node) const;
 
 private:
 			StringSet				fAddonNames;
-			ImageList				fAddOnImages;
+			AddOnList				fAddOns;
 			bool					fAddonsLoaded;
 
+			// The add-ons of the manifest by their paths, and whether it
+			// has to be written again.
+			std::map<BString, add_on_info>	fManifest;
+			bool					fManifestChanged;
+			BLocker					fImageLocker;
+
 	static	BLocker					fLocker;
 	static	ManipulatorServer*		fManipulatorServer;
 };
@@ -12,6 +12,7 @@
 #include "BitmapUtilities.h"
 #include "HSPolygon.h"
 #include "ImageView.h"
+#include "MemoryBudget.h"
 #include "MessageConstants.h"
 #include "PixelOperations.h"
 #include "Selection.h"
@@ -73,7 +74,7 @@ RotationManipulator::RotationManipulator(BBitmap* bitmap)
 
 RotationManipulator::~RotationManipulator()
 {
-	delete copy_of_the_preview_bitmap;
+	MemoryBudget::DeleteBitmap(copy_of_the_preview_bitmap);
 	delete view_polygon;
 
 	if (config_view != NULL) {
@@ -98,11 +99,12 @@ RotationManipulator::SetPreviewBitmap(BBitmap* bitmap)
 		|| (bitmap->Bounds() != preview_bitmap->Bounds())) {
 		try {
 			if (preview_bitmap != NULL)
-				delete copy_of_the_preview_bitmap;
+				MemoryBudget::DeleteBitmap(copy_of_the_preview_bitmap);
 
 			if (bitmap != NULL) {
 				preview_bitmap = bitmap;
 				copy_of_the_preview_bitmap = DuplicateBitmap(preview_bitmap);
+				MemoryBudget::Track(copy_of_the_preview_bitmap, NULL, PREVIEW_MEMORY);
 				BRect bounds = preview_bitmap->Bounds();
 				settings->origo = BPoint((bounds.right - bounds.left) / 2 + bounds.left,
 					(bounds.bottom - bounds.top) / 2 + bounds.top);
@@ -277,7 +279,8 @@ RotationManipulator::ManipulateBitmap(
 	float y_times_sin = (-center_y) * sin_angle;
 	float y_times_cos = (-center_y) * cos_angle;
 
-	BWindow* status_bar_window = status_bar->Window();
+	BWindow* status_bar_window = (status_bar != NULL) ? status_bar->Window() : NULL;
+	float missed_update = 0;
 
 	float floor_x, ceil_x, floor_y, ceil_y; // was int32 before optimization
 
@@ -341,10 +344,16 @@ RotationManipulator::ManipulateBitmap(
 			}
 			y_times_sin += sin_angle;
 			y_times_cos += cos_angle;
+			// The window may be waiting for this thread to finish, so it is
+			// never waited for here.
 			if ((((int32)y % 20) == 0) && (status_bar != NULL) && (status_bar_window != NULL)) {
-				status_bar_window->Lock();
-				status_bar->Update(100.0 / (float)height * 20);
-				status_bar_window->Unlock();
+				float update_amount = 100.0 / (float)height * 20;
+				if (status_bar_window->LockWithTimeout(0) == B_OK) {
+					status_bar->Update(update_amount + missed_update);
+					status_bar_window->Unlock();
+					missed_update = 0;
+				} else
+					missed_update += update_amount;
 			}
 		}
 	} else {
@@ -12,6 +12,7 @@
 
 #include "ScaleCanvasManipulator.h"
 
+#include "MemoryBudget.h"
 #include "MessageConstants.h"
 #include "NumberControl.h"
 #include "PixelOperations.h"
@@ -66,7 +67,7 @@ ScaleCanvasManipulator::~ScaleCanvasManipulator()
 		delete configuration_view;
 	}
 
-	delete copy_of_the_preview_bitmap;
+	MemoryBudget::DeleteBitmap(copy_of_the_preview_bitmap);
 }
 
 
@@ -376,7 +377,7 @@ ScaleCanvasManipulator::SetPreviewBitmap(BBitmap* bitmap)
 	if (!bitmap || !preview_bitmap || bitmap->Bounds() != preview_bitmap->Bounds()) {
 		try {
 			if (preview_bitmap)
-				delete copy_of_the_preview_bitmap;
+				MemoryBudget::DeleteBitmap(copy_of_the_preview_bitmap);
 
 			preview_bitmap = NULL;
 			copy_of_the_preview_bitmap = NULL;
@@ -384,6 +385,7 @@ ScaleCanvasManipulator::SetPreviewBitmap(BBitmap* bitmap)
 			if (bitmap) {
 				preview_bitmap = bitmap;
 				copy_of_the_preview_bitmap = DuplicateBitmap(preview_bitmap);
+				MemoryBudget::Track(copy_of_the_preview_bitmap, NULL, PREVIEW_MEMORY);
 			}
 		}
 		catch (const std::bad_alloc& e) {
@@ -12,6 +12,7 @@
 
 #include "ScaleManipulator.h"
 
+#include "MemoryBudget.h"
 #include "MessageConstants.h"
 #include "NumberControl.h"
 #include "PixelOperations.h"
@@ -82,7 +83,7 @@ ScaleManipulator::~ScaleManipulator()
 	if (orig_selection_map != NULL)
 		delete orig_selection_map;
 
-	delete copy_of_the_preview_bitmap;
+	MemoryBudget::DeleteBitmap(copy_of_the_preview_bitmap);
 }
 
 
@@ -902,7 +903,7 @@ ScaleManipulator::SetPreviewBitmap(BBitmap* bitmap)
 	if (!bitmap || !preview_bitmap || bitmap->Bounds() != preview_bitmap->Bounds()) {
 		try {
 			if (preview_bitmap)
-				delete copy_of_the_preview_bitmap;
+				MemoryBudget::DeleteBitmap(copy_of_the_preview_bitmap);
 
 			preview_bitmap = NULL;
 			copy_of_the_preview_bitmap = NULL;
@@ -910,6 +911,7 @@ ScaleManipulator::SetPreviewBitmap(BBitmap* bitmap)
 			if (bitmap) {
 				preview_bitmap = bitmap;
 				copy_of_the_preview_bitmap = DuplicateBitmap(preview_bitmap);
+				MemoryBudget::Track(copy_of_the_preview_bitmap, NULL, PREVIEW_MEMORY);
 			}
 		}
 		catch (const std::bad_alloc& e) {
@@ -13,6 +13,7 @@
 #include "TextManipulator.h"
 
 #include "HSPolygon.h"
+#include "MemoryBudget.h"
 #include "MessageConstants.h"
 #include "NumberSliderControl.h"
 #include "PaintApplication.h"
@@ -72,7 +73,7 @@ TextManipulator::TextManipulator(BBitmap* bm)
 
 TextManipulator::~TextManipulator()
 {
-	delete copy_of_the_preview_bitmap;
+	MemoryBudget::DeleteBitmap(copy_of_the_preview_bitmap);
 
 	if (config_view != NULL) {
 		config_view->RemoveSelf();
@@ -412,10 +413,11 @@ void
 TextManipulator::SetPreviewBitmap(BBitmap* bm)
 {
 	if (bm != preview_bitmap) {
-		delete copy_of_the_preview_bitmap;
+		MemoryBudget::DeleteBitmap(copy_of_the_preview_bitmap);
 		if (bm != NULL) {
 			preview_bitmap = bm;
 			copy_of_the_preview_bitmap = DuplicateBitmap(bm, 0, TRUE);
+			MemoryBudget::Track(copy_of_the_preview_bitmap, NULL, PREVIEW_MEMORY);
 			BView* a_view = new BView(
 				copy_of_the_preview_bitmap->Bounds(), "a_view", B_FOLLOW_NONE, B_WILL_DRAW);
 			copy_of_the_preview_bitmap->AddChild(a_view);
@@ -10,6 +10,8 @@
 
 #include "BitmapUtilities.h"
 #include "ImageView.h"
+#include "Layer.h"
+#include "MemoryBudget.h"
 #include "MessageConstants.h"
 #include "NumberControl.h"
 #include "PixelOperations.h"
@@ -44,11 +46,11 @@ TranslationManipulator::TranslationManipulator(BBitmap* bm)
 	config_view(NULL),
 	selection(NULL),
 	orig_selection_map(NULL),
-	transform_selection_only(false)
+	transform_selection_only(false),
+	layer(NULL),
+	original_layer_offset(B_ORIGIN)
 {
 	preview_bitmap = bm;
-	if (preview_bitmap != NULL)
-		copy_of_the_preview_bitmap = DuplicateBitmap(preview_bitmap);
 
 	settings = new TranslationManipulatorSettings();
 	previous_x_translation = 0;
@@ -62,7 +64,7 @@ TranslationManipulator::TranslationManipulator(BBitmap* bm)
 TranslationManipulator::~TranslationManipulator()
 {
 	delete settings;
-	delete copy_of_the_preview_bitmap;
+	MemoryBudget::DeleteBitmap(copy_of_the_preview_bitmap);
 	delete orig_selection_map;
 
 	if (config_view != NULL) {
@@ -88,6 +90,36 @@ TranslationManipulator::SetSelection(Selection* new_selection)
 }
 
 
+void
+TranslationManipulator::SetLayer(Layer* new_layer)
+{
+	layer = new_layer;
+	if (layer != NULL)
+		original_layer_offset = layer->Offset();
+	else
+		original_layer_offset = B_ORIGIN;
+}
+
+
+bool
+TranslationManipulator::UsesLayerOffset()
+{
+	return transform_selection_only == false
+		&& (selection == NULL || selection->IsEmpty() == true);
+}
+
+
+void
+TranslationManipulator::MakeCopyOfPreviewBitmap()
+{
+	// The copy is only needed when the pixels are actually moved, so it is
+	// made on the first use.
+	if (copy_of_the_preview_bitmap == NULL && preview_bitmap != NULL)
+		copy_of_the_preview_bitmap = DuplicateBitmap(preview_bitmap);
+		MemoryBudget::Track(copy_of_the_preview_bitmap, NULL, PREVIEW_MEMORY);
+}
+
+
 void
 TranslationManipulator::MouseDown(BPoint point, uint32, BView*, bool first)
 {
@@ -139,6 +171,7 @@ TranslationManipulator::ManipulateBitmap(
 		if (new_bitmap->IsValid() == FALSE)
 			throw std::bad_alloc();
 	} else {
+		MakeCopyOfPreviewBitmap();
 		new_bitmap = original;
 		original = copy_of_the_preview_bitmap;
 	}
@@ -244,6 +277,31 @@ TranslationManipulator::ManipulateBitmap(
 }
 
 
+status_t
+TranslationManipulator::ManipulateLayer(
+	ManipulatorSettings* set, Layer* target, BPoint* old_offset)
+{
+	TranslationManipulatorSettings* new_settings = cast_as(set, TranslationManipulatorSettings);
+
+	if (new_settings == NULL || target == NULL)
+		return B_BAD_VALUE;
+
+	// The preview has already moved the offset of its layer.
+	BPoint offset = target->Offset();
+	if (target == layer)
+		offset = original_layer_offset;
+
+	if (old_offset != NULL)
+		*old_offset = offset;
+
+	offset.x += (int32)new_settings->x_translation;
+	offset.y += (int32)new_settings->y_translation;
+	target->SetOffset(offset);
+
+	return B_OK;
+}
+
+
 BBitmap*
 TranslationManipulator::ManipulateSelectionMap(ManipulatorSettings* set)
 {
@@ -324,13 +382,38 @@ TranslationManipulator::ManipulateSelectionMap(ManipulatorSettings* set)
 int32
 TranslationManipulator::PreviewBitmap(bool full_quality, BRegion* updated_region)
 {
-	if (preview_bitmap == NULL || copy_of_the_preview_bitmap == NULL)
+	if (preview_bitmap == NULL)
 		return 0;
 
 	if (transform_selection_only == true
 		&& ((selection == NULL || selection->IsEmpty() == true) && orig_selection_map == NULL))
 		return 0;
 
+	if (layer != NULL && UsesLayerOffset() == true) {
+		int32 x_translation_local = (int32)settings->x_translation;
+		int32 y_translation_local = (int32)settings->y_translation;
+		if ((previous_x_translation == x_translation_local)
+			&& (previous_y_translation == y_translation_local))
+			return 0;
+
+		BRect old_frame = layer->Frame();
+		layer->SetOffset(original_layer_offset
+			+ BPoint(x_translation_local, y_translation_local));
+
+		previous_x_translation = x_translation_local;
+		previous_y_translation = y_translation_local;
+		last_calculated_resolution = 1;
+
+		if (updated_region != NULL)
+			updated_region->Set((old_frame | layer->Frame()) & preview_bitmap->Bounds());
+
+		return last_calculated_resolution;
+	}
+
+	MakeCopyOfPreviewBitmap();
+	if (copy_of_the_preview_bitmap == NULL)
+		return 0;
+
 	// First decide the resolution of the bitmap
 	if ((previous_x_translation == settings->x_translation)
 		&& (previous_y_translation == settings->y_translation) && (full_quality == FALSE)) {
@@ -530,7 +613,10 @@ TranslationManipulator::Reset()
 	previous_x_translation = 0;
 	previous_y_translation = 0;
 
-	if (preview_bitmap != NULL) {
+	if (layer != NULL)
+		layer->SetOffset(original_layer_offset);
+
+	if (preview_bitmap != NULL && copy_of_the_preview_bitmap != NULL) {
 		// memcpy seems to be about 10-15% faster that copying with loop.
 		uint32* source = (uint32*)copy_of_the_preview_bitmap->Bits();
 		uint32* target = (uint32*)preview_bitmap->Bits();
@@ -549,12 +635,9 @@ TranslationManipulator::Reset()
 void
 TranslationManipulator::SetPreviewBitmap(BBitmap* bm)
 {
-	delete copy_of_the_preview_bitmap;
+	MemoryBudget::DeleteBitmap(copy_of_the_preview_bitmap);
+	copy_of_the_preview_bitmap = NULL;
 	preview_bitmap = bm;
-	if (preview_bitmap != NULL)
-		copy_of_the_preview_bitmap = DuplicateBitmap(preview_bitmap);
-	else
-		copy_of_the_preview_bitmap = NULL;
 
 	if (preview_bitmap != NULL) {
 		double speed = GetSystemClockSpeed() / 1000;
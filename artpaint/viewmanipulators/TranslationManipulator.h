@@ -14,6 +14,7 @@
 #include "WindowGUIManipulator.h"
 
 
+class Layer;
 class Selection;
 class TranslationManipulatorView;
 class TranslationManipulatorSettings;
@@ -52,6 +53,13 @@ class TranslationManipulator : public WindowGUIManipulator {
 			BBitmap*	orig_selection_map;
 			bool		transform_selection_only;
 
+			// When a whole layer is translated, the preview just moves the
+			// layer's offset instead of copying its pixels.
+			Layer*		layer;
+			BPoint		original_layer_offset;
+
+			void		MakeCopyOfPreviewBitmap();
+
 public:
 						TranslationManipulator(BBitmap*);
 						~TranslationManipulator();
@@ -62,8 +70,13 @@ public:
 			int32		PreviewBitmap(bool full_quality = FALSE, BRegion* updated_region = NULL);
 			BView*		MakeConfigurationView(const BMessenger& target);
 			void		SetPreviewBitmap(BBitmap*);
+			void		SetLayer(Layer*);
 			void		Reset();
 
+			bool		UsesLayerOffset();
+			status_t	ManipulateLayer(ManipulatorSettings*, Layer*,
+							BPoint* old_offset = NULL);
+
 			const char*	ReturnName();
 			const char*	ReturnHelpString();
 
@@ -11,6 +11,7 @@
 #include "AddOns.h"
 #include "Image.h"
 #include "Layer.h"
+#include "MemoryBudget.h"
 #include "MessageConstants.h"
 #include "PixelOperations.h"
 #include "TransparencyManipulator.h"
@@ -48,6 +49,7 @@ TransparencyManipulator::TransparencyManipulator(BBitmap* bm)
 	if (bm) {
 		preview_bitmap = bm;
 		copy_of_the_preview_bitmap = DuplicateBitmap(preview_bitmap);
+		MemoryBudget::Track(copy_of_the_preview_bitmap, NULL, PREVIEW_MEMORY);
 	}
 	settings = new TransparencyManipulatorSettings();
 }
@@ -55,7 +57,7 @@ TransparencyManipulator::TransparencyManipulator(BBitmap* bm)
 
 TransparencyManipulator::~TransparencyManipulator()
 {
-	delete copy_of_the_preview_bitmap;
+	MemoryBudget::DeleteBitmap(copy_of_the_preview_bitmap);
 	delete settings;
 	if (config_view) {
 		config_view->RemoveSelf();
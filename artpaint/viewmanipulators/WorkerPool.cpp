@@ -0,0 +1,229 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+
+#include "WorkerPool.h"
+
+
+#include <Autolock.h>
+#include <StatusBar.h>
+#include <Window.h>
+
+
+#include <new>
+
+
+// Each thread gets about this many chunks of a range, so that the ones
+// that finish early have something left to take.
+const int32 kChunksPerThread = 8;
+
+
+struct WorkerPool::parallel_job {
+	range_function	function;
+	void*			data;
+
+	vint32			next;
+	int32			last;
+	int32			chunk_size;
+	vint32*			cancel;
+
+	BStatusBar*		progress_bar;
+	BWindow*		progress_bar_window;
+	float			progress_per_item;
+	vint32			done;
+	// Only changed while holding the lock of the progress_bar_window.
+	int32			reported;
+};
+
+
+BLocker WorkerPool::fLocker;
+WorkerPool* WorkerPool::fWorkerPool = NULL;
+
+
+WorkerPool*
+WorkerPool::Instance()
+{
+	return Instantiate();
+}
+
+
+WorkerPool::WorkerPool()
+	:
+	fWorkers(NULL),
+	fWorkerCount(0),
+	fStartSem(-1),
+	fDoneSem(-1),
+	fActiveWorkers(0),
+	fBusy(0),
+	fJob(NULL)
+{
+	system_info info;
+	get_system_info(&info);
+	int32 worker_count = max_c((int32)info.cpu_count - 1, 0);
+	if (worker_count == 0)
+		return;
+
+	fStartSem = create_sem(0, "worker pool start");
+	fDoneSem = create_sem(0, "worker pool done");
+	fWorkers = new (std::nothrow) thread_id[worker_count];
+	if (fStartSem < 0 || fDoneSem < 0 || fWorkers == NULL)
+		return;
+
+	for (int32 i = 0; i < worker_count; i++) {
+		thread_id thread = spawn_thread(_WorkerThread, "worker pool thread",
+			B_NORMAL_PRIORITY, this);
+		if (thread < 0)
+			break;
+
+		fWorkers[fWorkerCount++] = thread;
+		resume_thread(thread);
+	}
+}
+
+
+WorkerPool::~WorkerPool()
+{
+	// Deleting the semaphore makes the waiting workers return.
+	delete_sem(fStartSem);
+	for (int32 i = 0; i < fWorkerCount; i++) {
+		status_t exit_value;
+		wait_for_thread(fWorkers[i], &exit_value);
+	}
+
+	delete_sem(fDoneSem);
+	delete[] fWorkers;
+
+	fWorkerPool = NULL;
+}
+
+
+WorkerPool*
+WorkerPool::Instantiate()
+{
+	if (fWorkerPool == NULL) {
+		BAutolock _(&fLocker);
+		if (fWorkerPool == NULL)
+			fWorkerPool = new (std::nothrow) WorkerPool();
+	}
+	return fWorkerPool;
+}
+
+
+void
+WorkerPool::DestroyPool()
+{
+	if (fWorkerPool) {
+		delete fWorkerPool;
+		fWorkerPool = NULL;
+	}
+}
+
+
+status_t
+WorkerPool::ParallelFor(int32 first, int32 last, range_function function,
+	void* data, BStatusBar* progress_bar, float progress_amount, vint32* cancel)
+{
+	if (function == NULL)
+		return B_BAD_VALUE;
+
+	if (first >= last)
+		return B_OK;
+
+	int32 count = last - first;
+
+	parallel_job job;
+	job.function = function;
+	job.data = data;
+	job.next = first;
+	job.last = last;
+	job.chunk_size = max_c(count / (CountThreads() * kChunksPerThread), 1);
+	job.cancel = cancel;
+	job.progress_bar = progress_bar;
+	job.progress_bar_window = NULL;
+	if (progress_bar != NULL)
+		job.progress_bar_window = progress_bar->Window();
+	job.progress_per_item = progress_amount / count;
+	job.done = 0;
+	job.reported = 0;
+
+	if (fWorkerCount > 0 && count > job.chunk_size
+		&& atomic_test_and_set(&fBusy, 1, 0) == 0) {
+		fJob = &job;
+		atomic_set(&fActiveWorkers, fWorkerCount);
+		release_sem_etc(fStartSem, fWorkerCount, B_DO_NOT_RESCHEDULE);
+
+		_Work(&job);
+
+		while (acquire_sem(fDoneSem) == B_INTERRUPTED)
+			;
+		fJob = NULL;
+		atomic_set(&fBusy, 0);
+	} else
+		_Work(&job);
+
+	_ReportProgress(&job);
+
+	if (atomic_get(&job.done) < count)
+		return B_CANCELED;
+
+	return B_OK;
+}
+
+
+int32
+WorkerPool::_WorkerThread(void* data)
+{
+	WorkerPool* pool = (WorkerPool*)data;
+
+	while (true) {
+		status_t status = acquire_sem(pool->fStartSem);
+		if (status == B_INTERRUPTED)
+			continue;
+		if (status != B_OK)
+			break;
+
+		_Work(pool->fJob);
+
+		if (atomic_add(&pool->fActiveWorkers, -1) == 1)
+			release_sem(pool->fDoneSem);
+	}
+
+	return B_OK;
+}
+
+
+void
+WorkerPool::_Work(parallel_job* job)
+{
+	while (job->cancel == NULL || atomic_get(job->cancel) == 0) {
+		int32 first = atomic_add(&job->next, job->chunk_size);
+		if (first >= job->last)
+			break;
+
+		int32 last = min_c(first + job->chunk_size, job->last);
+		job->function(job->data, first, last);
+
+		atomic_add(&job->done, last - first);
+		_ReportProgress(job);
+	}
+}
+
+
+void
+WorkerPool::_ReportProgress(parallel_job* job)
+{
+	// Whichever thread gets the lock reports the chunks that all of the
+	// threads have finished since the last update.
+	BWindow* window = job->progress_bar_window;
+	if (window == NULL || window->LockWithTimeout(0) != B_OK)
+		return;
+
+	int32 done = atomic_get(&job->done);
+	if (done > job->reported) {
+		job->progress_bar->Update((done - job->reported) * job->progress_per_item);
+		job->reported = done;
+	}
+	window->Unlock();
+}
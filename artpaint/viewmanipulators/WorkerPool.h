@@ -0,0 +1,86 @@
+/*
+ * Copyright 2026, ArtPaint contributors
+ * Distributed under the terms of the MIT License.
+ *
+ */
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <Locker.h>
+#include <OS.h>
+
+
+class BStatusBar;
+
+
+// Processes the items [first, last) of a range, usually rows or columns of
+// a bitmap.
+typedef void (*range_function)(void* data, int32 first, int32 last);
+
+
+/*
+	The WorkerPool keeps one thread for each extra processor waiting for
+	work, so that the manipulators do not have to spawn their own threads
+	for every pass over a bitmap. A range is split to small chunks and each
+	thread takes the next unprocessed chunk when it has finished the
+	previous one, so threads that get the cheap rows (outside of the
+	selection for example) go on to help with the rest.
+*/
+class WorkerPool {
+	friend class PaintApplication;
+
+public:
+	static	WorkerPool*			Instance();
+
+			// The number of threads that process a range, including the
+			// thread that calls ParallelFor().
+			int32				CountThreads() const
+									{ return fWorkerCount + 1; }
+
+			// Calls function for chunks of the range until all of it has
+			// been processed and returns when they are done. The calling
+			// thread processes chunks too. The progress_bar is advanced by
+			// progress_amount over the whole range. If cancel is not NULL
+			// and becomes non-zero, no new chunks are started and
+			// B_CANCELED is returned.
+			status_t			ParallelFor(int32 first, int32 last,
+									range_function function, void* data,
+									BStatusBar* progress_bar = NULL,
+									float progress_amount = 100.0,
+									vint32* cancel = NULL);
+
+private:
+	struct parallel_job;
+
+								WorkerPool();
+								WorkerPool(const WorkerPool& pool);
+								~WorkerPool();
+
+	static	WorkerPool*			Instantiate();
+	static	void				DestroyPool();
+
+	static	int32				_WorkerThread(void* data);
+	static	void				_Work(parallel_job* job);
+	static	void				_ReportProgress(parallel_job* job);
+
+			thread_id*			fWorkers;
+			int32				fWorkerCount;
+
+			// The workers wait on fStartSem, the last one to finish a job
+			// releases fDoneSem.
+			sem_id				fStartSem;
+			sem_id				fDoneSem;
+			vint32				fActiveWorkers;
+
+			// Only one range at a time is given to the workers. A range
+			// that is started while they are busy, from another window or
+			// from within a chunk, is processed by the calling thread.
+			vint32				fBusy;
+			parallel_job*		fJob;
+
+	static	BLocker				fLocker;
+	static	WorkerPool*			fWorkerPool;
+};
+
+
+#endif	// WORKER_POOL_H
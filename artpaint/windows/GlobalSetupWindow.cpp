@@ -19,6 +19,7 @@
 #include "Cursors.h"
 #include "LayerWindow.h"
 #include "ManipulatorWindow.h"
+#include "MemoryBudget.h"
 #include "NumberControl.h"
 #include "NumberSliderControl.h"
 #include "PaintWindow.h"
@@ -65,6 +66,7 @@ const uint32 kSetUndoDisabled = '_sud';
 const uint32 kSetUnlimitedUndo = '_suu';
 const uint32 kSetAdjustableUndo = '_sau';
 const uint32 kUndoDepthAdjusted = '_uda';
+const uint32 kMemoryBudgetAdjusted = '_mba';
 
 const uint32 kToolCursorMode = '_too';
 const uint32 kCrossHairCursorMode = '_cro';
@@ -266,17 +268,20 @@ private:
 
 private:
 	int32 			fUndoDepth;
+	int32 			fMemoryBudget;
 	BRadioButton* 	fUnlimitedUndo;
 	BRadioButton* 	fAdjustableUndo;
 	BRadioButton* 	fDisabledUndo;
 	NumberControl* 	fAdjustableUndoInput;
+	NumberControl* 	fMemoryBudgetInput;
 };
 
 
 GlobalSetupWindow::UndoControlView::UndoControlView()
 	:
 	BView("undo control view", 0),
-	fUndoDepth(UndoQueue::ReturnDepth())
+	fUndoDepth(UndoQueue::ReturnDepth()),
+	fMemoryBudget(MemoryBudget::Budget())
 {
 	BLayoutBuilder::Group<>(this, B_VERTICAL, 0)
 		.AddGroup(B_VERTICAL, B_USE_SMALL_SPACING)
@@ -294,6 +299,13 @@ GlobalSetupWindow::UndoControlView::UndoControlView()
 				new BMessage(kUndoDepthAdjusted)))
 			.AddGlue()
 		.End()
+		.AddStrut(B_USE_DEFAULT_SPACING)
+		.AddGroup(B_HORIZONTAL)
+			.Add(fMemoryBudgetInput
+				= new NumberControl(B_TRANSLATE("Memory limit (MB):"), "0",
+				new BMessage(kMemoryBudgetAdjusted), 6))
+			.AddGlue()
+		.End()
 		.AddGlue()
 		.SetInsets(
 			B_USE_BIG_SPACING, B_USE_DEFAULT_SPACING, B_USE_DEFAULT_SPACING, B_USE_DEFAULT_SPACING);
@@ -312,6 +324,10 @@ GlobalSetupWindow::UndoControlView::UndoControlView()
 		fAdjustableUndo->SetValue(B_CONTROL_ON);
 		fAdjustableUndoInput->SetValue(fUndoDepth);
 	}
+
+	// When the images take more memory than this, the oldest undo steps
+	// are dropped. 0 means no limit.
+	fMemoryBudgetInput->SetValue(fMemoryBudget);
 }
 
 
@@ -325,6 +341,7 @@ GlobalSetupWindow::UndoControlView::AttachedToWindow()
 	fUnlimitedUndo->SetTarget(this);
 	fAdjustableUndo->SetTarget(this);
 	fAdjustableUndoInput->SetTarget(this);
+	fMemoryBudgetInput->SetTarget(this);
 }
 
 
@@ -350,6 +367,10 @@ GlobalSetupWindow::UndoControlView::MessageReceived(BMessage* message)
 			fAdjustableUndoInput->SetValue(value);
 			fUndoDepth = value;
 		} break;
+		case kMemoryBudgetAdjusted:
+		{
+			fMemoryBudget = fMemoryBudgetInput->Value();
+		} break;
 		default:
 			BView::MessageReceived(message);
 	}
@@ -360,6 +381,7 @@ void
 GlobalSetupWindow::UndoControlView::ApplyChanges()
 {
 	UndoQueue::SetQueueDepth(fUndoDepth);
+	MemoryBudget::SetBudget(fMemoryBudget);
 }
 
 
@@ -527,8 +549,6 @@ GlobalSetupWindow::TransparencyControlView::ApplyChanges()
 		server->SetValue(SettingsServer::Application, skBgColor1, fColor1);
 		server->SetValue(SettingsServer::Application, skBgColor2, fColor2);
 	}
-
-	PaintWindow::Redraw();
 }
 
 